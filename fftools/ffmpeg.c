@@ -63,6 +63,7 @@
 #include "libavutil/time.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/trace.h"
 #include "libavcodec/mathops.h"
 #include "libavformat/os_support.h"
 
@@ -120,27 +121,23 @@ const char *const forced_keyframes_const_names[] = {
     NULL
 };
 
-typedef struct BenchmarkTimeStamps {
-    int64_t real_usec;
-    int64_t user_usec;
-    int64_t sys_usec;
-} BenchmarkTimeStamps;
-
-static void do_video_stats(OutputStream *ost, int frame_size);
+static int do_video_stats(OutputStream *ost, int frame_size);
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
 static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
 
 static int run_as_daemon  = 0;
-static int nb_frames_dup = 0;
+static atomic_int nb_frames_dup = ATOMIC_VAR_INIT(0);
 static unsigned dup_warning = 1000;
-static int nb_frames_drop = 0;
+static atomic_int nb_frames_drop = ATOMIC_VAR_INIT(0);
 static int64_t decode_error_stat[2];
 
 static int want_sdp = 1;
 
+/* -benchmark_all times of the main thread, encoders keep their own */
 static BenchmarkTimeStamps current_time;
 AVIOContext *progress_avio = NULL;
+AVIOContext *stats_json_avio = NULL;
 
 static uint8_t *subtitle_out;
 
@@ -166,8 +163,66 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_decoder_threads(void);
+static int free_filtergraph_threads(void);
+static int free_encoder_threads(void);
+#endif
+
+#if HAVE_PTHREADS
+/* Signalled by the input and filtergraph threads when they made progress,
+ * so that the main thread can wait for them instead of sleeping. Needs
+ * pthread_cond_timedwait(), which the other thread backends lack. */
+static pthread_mutex_t progress_lock;
+static pthread_cond_t  progress_cond;
+static int progress_initialized;
+static unsigned progress_count, progress_seen;
+
+static int init_progress(void)
+{
+    int ret;
+
+    if ((ret = pthread_mutex_init(&progress_lock, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&progress_cond, NULL))) {
+        pthread_mutex_destroy(&progress_lock);
+        return AVERROR(ret);
+    }
+    progress_count = progress_seen = 0;
+    progress_initialized = 1;
+    return 0;
+}
+
+/* must only be called once all the threads signalling it are joined */
+static void free_progress(void)
+{
+    if (!progress_initialized)
+        return;
+    pthread_cond_destroy(&progress_cond);
+    pthread_mutex_destroy(&progress_lock);
+    progress_initialized = 0;
+}
+
+static void signal_progress(void)
+{
+    pthread_mutex_lock(&progress_lock);
+    progress_count++;
+    pthread_cond_signal(&progress_cond);
+    pthread_mutex_unlock(&progress_lock);
+}
+#else
+static inline int  init_progress(void)   { return 0; }
+static inline void free_progress(void)   { }
+static inline void signal_progress(void) { }
 #endif
 
+/* output streams sorted by choose_output() */
+static OutputStream **output_heap;
+static int nb_output_heap;
+
+/* number of input files / output streams with eagain / unavailable set */
+static int nb_eagain_inputs;
+static int nb_unavailable_outputs;
+
 /* sub2video hack:
    Convert subtitles to video with alpha to insert them in filter graphs.
    This is a temporary solution until libavfilter gets real subtitles support.
@@ -489,8 +544,15 @@ static void ffmpeg_cleanup(int ret)
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
     }
 
+#if HAVE_THREADS
+    free_decoder_threads();
+    free_filtergraph_threads();
+    free_encoder_threads();
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        dump_filtergraph_profile(fg);
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             while (av_fifo_size(fg->inputs[j]->frame_queue)) {
@@ -541,6 +603,9 @@ static void ffmpeg_cleanup(int ret)
             avio_closep(&s->pb);
         avformat_free_context(s);
         av_dict_free(&of->opts);
+#if HAVE_THREADS
+        pthread_mutex_destroy(&of->mux_lock);
+#endif
 
         av_freep(&output_files[i]);
     }
@@ -585,6 +650,7 @@ static void ffmpeg_cleanup(int ret)
     }
 #if HAVE_THREADS
     free_input_threads();
+    free_progress();
 #endif
     for (i = 0; i < nb_input_files; i++) {
         avformat_close_input(&input_files[i]->ctx);
@@ -600,6 +666,7 @@ static void ffmpeg_cleanup(int ret)
         av_frame_free(&ist->sub2video.frame);
         av_freep(&ist->filters);
         av_freep(&ist->hwaccel_device);
+        av_buffer_unref(&ist->hw_frames_ctx);
         av_freep(&ist->dts_buffer);
 
         avcodec_free_context(&ist->dec_ctx);
@@ -615,9 +682,12 @@ static void ffmpeg_cleanup(int ret)
     }
     av_freep(&vstats_filename);
 
+    av_trace_stop();
+
     av_freep(&input_streams);
     av_freep(&input_files);
     av_freep(&output_streams);
+    av_freep(&output_heap);
     av_freep(&output_files);
 
     uninit_opts();
@@ -657,7 +727,8 @@ static void abort_codec_experimental(AVCodec *c, int encoder)
     exit_program(1);
 }
 
-static void update_benchmark(const char *fmt, ...)
+/* last holds the previous time stamps of the calling thread */
+static void update_benchmark(BenchmarkTimeStamps *last, const char *fmt, ...)
 {
     if (do_benchmark_all) {
         BenchmarkTimeStamps t = get_benchmark_time_stamps();
@@ -670,12 +741,92 @@ static void update_benchmark(const char *fmt, ...)
             va_end(va);
             av_log(NULL, AV_LOG_INFO,
                    "bench: %8" PRIu64 " user %8" PRIu64 " sys %8" PRIu64 " real %s \n",
-                   t.user_usec - current_time.user_usec,
-                   t.sys_usec - current_time.sys_usec,
-                   t.real_usec - current_time.real_usec, buf);
+                   t.user_usec - last->user_usec,
+                   t.sys_usec - last->sys_usec,
+                   t.real_usec - last->real_usec, buf);
         }
-        current_time = t;
+        *last = t;
+    }
+}
+
+typedef struct StageTimer {
+    int64_t real_usec;
+    int64_t cpu_usec;
+} StageTimer;
+
+static int64_t get_thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
+static void stage_start(StageTimer *t)
+{
+    if (!stats_json_avio) {
+        t->real_usec = t->cpu_usec = 0;
+        return;
     }
+    t->real_usec = av_gettime_relative();
+    t->cpu_usec  = get_thread_cpu_time();
+}
+
+static void stage_end(StageStats *s, const StageTimer *t)
+{
+    int64_t real;
+
+    if (!stats_json_avio || !t->real_usec)
+        return;
+
+    real = av_gettime_relative() - t->real_usec;
+    s->nb_calls++;
+    s->real_usec += real;
+    s->cpu_usec  += get_thread_cpu_time() - t->cpu_usec;
+    s->max_usec   = FFMAX(s->max_usec, real);
+    s->hist[FFMIN(av_log2(FFMAX(real, 1)), STAGE_HIST_SIZE - 1)]++;
+}
+
+#if HAVE_THREADS
+/* thread queue operations, recorded as trace spans as they may block */
+static int queue_send(AVThreadMessageQueue *mq, void *msg, unsigned flags,
+                      const char *name)
+{
+    int ret;
+
+    av_trace_begin(name, AV_NOPTS_VALUE);
+    ret = av_thread_message_queue_send(mq, msg, flags);
+    av_trace_end(name);
+    return ret;
+}
+
+static int queue_recv(AVThreadMessageQueue *mq, void *msg, unsigned flags,
+                      const char *name)
+{
+    int ret;
+
+    av_trace_begin(name, AV_NOPTS_VALUE);
+    ret = av_thread_message_queue_recv(mq, msg, flags);
+    av_trace_end(name);
+    return ret;
+}
+#endif
+
+static void mux_lock(OutputFile *of)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&of->mux_lock);
+#endif
+}
+
+static void mux_unlock(OutputFile *of)
+{
+#if HAVE_THREADS
+    pthread_mutex_unlock(&of->mux_lock);
+#endif
 }
 
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
@@ -683,14 +834,15 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
-        ost2->finished |= ost == ost2 ? this_stream : others;
+        atomic_fetch_or(&ost2->finished, ost == ost2 ? this_stream : others);
     }
 }
 
-static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
+static int write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    StageTimer timer;
     int ret;
 
     /*
@@ -702,11 +854,11 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
      * Do not count the packet when unqueued because it has been counted when queued.
      */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && ost->encoding_needed) && !unqueue) {
-        if (ost->frame_number >= ost->max_frames) {
+        if (atomic_load(&ost->frame_number) >= ost->max_frames) {
             av_packet_unref(pkt);
-            return;
+            return 0;
         }
-        ost->frame_number++;
+        atomic_fetch_add(&ost->frame_number, 1);
     }
 
     if (!of->header_written) {
@@ -719,18 +871,19 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                 av_log(NULL, AV_LOG_ERROR,
                        "Too many packets buffered for output stream %d:%d.\n",
                        ost->file_index, ost->st->index);
-                exit_program(1);
+                ret = AVERROR(ENOSPC);
+                goto fail;
             }
             ret = av_fifo_realloc2(ost->muxing_queue, new_size);
             if (ret < 0)
-                exit_program(1);
+                goto fail;
         }
         ret = av_packet_make_refcounted(pkt);
         if (ret < 0)
-            exit_program(1);
+            goto fail;
         av_packet_move_ref(&tmp_pkt, pkt);
         av_fifo_generic_write(ost->muxing_queue, &tmp_pkt, sizeof(tmp_pkt), NULL);
-        return;
+        return 0;
     }
 
     if ((st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
@@ -785,7 +938,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
                        ost->file_index, ost->st->index, ost->last_mux_dts, pkt->dts);
                 if (exit_on_error) {
                     av_log(NULL, AV_LOG_FATAL, "aborting.\n");
-                    exit_program(1);
+                    ret = AVERROR(EINVAL);
+                    goto fail;
                 }
                 av_log(s, loglevel, "changing to %"PRId64". This may result "
                        "in incorrect timestamps in the output file.\n",
@@ -813,23 +967,31 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+    stage_start(&timer);
     ret = av_interleaved_write_frame(s, pkt);
+    stage_end(&ost->mux_stats, &timer);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
     av_packet_unref(pkt);
+    return 0;
+fail:
+    av_packet_unref(pkt);
+    return ret;
 }
 
 static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
-    ost->finished |= ENCODER_FINISHED;
+    atomic_fetch_or(&ost->finished, ENCODER_FINISHED);
     if (of->shortest) {
         int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
+        mux_lock(of);
         of->recording_time = FFMIN(of->recording_time, end);
+        mux_unlock(of);
     }
 }
 
@@ -843,12 +1005,16 @@ static void close_output_stream(OutputStream *ost)
  * If eof is set, instead indicate EOF to all bitstream filters and
  * therefore flush any delayed packets to the output.  A blank packet
  * must be supplied in this case.
+ *
+ * @return  0 for success, <0 for errors which should stop transcoding
  */
-static void output_packet(OutputFile *of, AVPacket *pkt,
+static int output_packet(OutputFile *of, AVPacket *pkt,
                           OutputStream *ost, int eof)
 {
     int ret = 0;
 
+    mux_lock(of);
+
     /* apply the output bitstream filters, if any */
     if (ost->nb_bitstream_filters) {
         int idx;
@@ -880,27 +1046,42 @@ static void output_packet(OutputFile *of, AVPacket *pkt,
                 eof = 0;
             } else if (eof)
                 goto finish;
-            else
-                write_packet(of, pkt, ost, 0);
+            else if ((ret = write_packet(of, pkt, ost, 0)) < 0)
+                goto fail;
         }
-    } else if (!eof)
-        write_packet(of, pkt, ost, 0);
+    } else if (!eof && (ret = write_packet(of, pkt, ost, 0)) < 0)
+        goto fail;
 
 finish:
+    mux_unlock(of);
+
     if (ret < 0 && ret != AVERROR_EOF) {
         av_log(NULL, AV_LOG_ERROR, "Error applying bitstream filters to an output "
                "packet for stream #%d:%d.\n", ost->file_index, ost->index);
         if(exit_on_error)
-            exit_program(1);
+            return ret;
     }
+    return 0;
+fail:
+    mux_unlock(of);
+    return ret;
 }
 
 static int check_recording_time(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int64_t recording_time;
 
-    if (of->recording_time != INT64_MAX &&
-        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, of->recording_time,
+    /* only -shortest changes it while transcoding */
+    if (of->shortest) {
+        mux_lock(of);
+        recording_time = of->recording_time;
+        mux_unlock(of);
+    } else
+        recording_time = of->recording_time;
+
+    if (recording_time != INT64_MAX &&
+        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, recording_time,
                       AV_TIME_BASE_Q) >= 0) {
         close_output_stream(ost);
         return 0;
@@ -908,10 +1089,11 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
-static void do_audio_out(OutputFile *of, OutputStream *ost,
-                         AVFrame *frame)
+static int encode_audio_frame(OutputFile *of, OutputStream *ost,
+                              AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
+    StageTimer timer;
     AVPacket pkt;
     int ret;
 
@@ -919,36 +1101,23 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
     pkt.data = NULL;
     pkt.size = 0;
 
-    if (!check_recording_time(ost))
-        return;
-
-    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
-        frame->pts = ost->sync_opts;
-    ost->sync_opts = frame->pts + frame->nb_samples;
-    ost->samples_encoded += frame->nb_samples;
-    ost->frames_encoded++;
-
-    av_assert0(pkt.size || !pkt.data);
-    update_benchmark(NULL);
-    if (debug_ts) {
-        av_log(NULL, AV_LOG_INFO, "encoder <- type:audio "
-               "frame_pts:%s frame_pts_time:%s time_base:%d/%d\n",
-               av_ts2str(frame->pts), av_ts2timestr(frame->pts, &enc->time_base),
-               enc->time_base.num, enc->time_base.den);
-    }
-
+    update_benchmark(&ost->enc_bench, NULL);
+    stage_start(&timer);
     ret = avcodec_send_frame(enc, frame);
+    stage_end(&ost->encode_stats, &timer);
     if (ret < 0)
-        goto error;
+        return ret;
 
     while (1) {
+        stage_start(&timer);
         ret = avcodec_receive_packet(enc, &pkt);
+        stage_end(&ost->encode_stats, &timer);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
-            goto error;
+            return ret;
 
-        update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
+        update_benchmark(&ost->enc_bench, "encode_audio %d.%d", ost->file_index, ost->index);
 
         av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
 
@@ -959,127 +1128,361 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
         }
 
-        output_packet(of, &pkt, ost, 0);
+        ret = output_packet(of, &pkt, ost, 0);
+        if (ret < 0)
+            return ret;
     }
 
-    return;
-error:
-    av_log(NULL, AV_LOG_FATAL, "Audio encoding failed\n");
-    exit_program(1);
+    return 0;
 }
 
-static void do_subtitle_out(OutputFile *of,
-                            OutputStream *ost,
-                            AVSubtitle *sub)
+static int encode_video_frame(OutputFile *of, OutputStream *ost,
+                              AVFrame *frame)
 {
-    int subtitle_out_max_size = 1024 * 1024;
-    int subtitle_out_size, nb, i;
-    AVCodecContext *enc;
+    AVCodecContext *enc = ost->enc_ctx;
+    StageTimer timer;
     AVPacket pkt;
-    int64_t pts;
+    int frame_size = 0;
+    int ret;
 
-    if (sub->pts == AV_NOPTS_VALUE) {
-        av_log(NULL, AV_LOG_ERROR, "Subtitle packets must have a pts\n");
-        if (exit_on_error)
-            exit_program(1);
-        return;
-    }
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
 
-    enc = ost->enc_ctx;
+    update_benchmark(&ost->enc_bench, NULL);
+    stage_start(&timer);
+    ret = avcodec_send_frame(enc, frame);
+    stage_end(&ost->encode_stats, &timer);
+    if (ret < 0)
+        return ret;
 
-    if (!subtitle_out) {
-        subtitle_out = av_malloc(subtitle_out_max_size);
-        if (!subtitle_out) {
-            av_log(NULL, AV_LOG_FATAL, "Failed to allocate subtitle_out\n");
-            exit_program(1);
-        }
-    }
+    while (1) {
+        stage_start(&timer);
+        ret = avcodec_receive_packet(enc, &pkt);
+        stage_end(&ost->encode_stats, &timer);
+        update_benchmark(&ost->enc_bench, "encode_video %d.%d", ost->file_index, ost->index);
+        if (ret == AVERROR(EAGAIN))
+            break;
+        if (ret < 0)
+            return ret;
 
-    /* Note: DVB subtitle need one packet to draw them and one other
-       packet to clear them */
-    /* XXX: signal it in the codec context ? */
-    if (enc->codec_id == AV_CODEC_ID_DVB_SUBTITLE)
-        nb = 2;
-    else
-        nb = 1;
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
+                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                   av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
+                   av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
+        }
 
-    /* shift timestamp to honor -ss and make check_recording_time() work with -t */
-    pts = sub->pts;
-    if (output_files[ost->file_index]->start_time != AV_NOPTS_VALUE)
-        pts -= output_files[ost->file_index]->start_time;
-    for (i = 0; i < nb; i++) {
-        unsigned save_num_rects = sub->num_rects;
+        if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+            pkt.pts = frame->pts;
 
-        ost->sync_opts = av_rescale_q(pts, AV_TIME_BASE_Q, enc->time_base);
-        if (!check_recording_time(ost))
-            return;
+        av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
 
-        sub->pts = pts;
-        // start_display_time is required to be 0
-        sub->pts               += av_rescale_q(sub->start_display_time, (AVRational){ 1, 1000 }, AV_TIME_BASE_Q);
-        sub->end_display_time  -= sub->start_display_time;
-        sub->start_display_time = 0;
-        if (i == 1)
-            sub->num_rects = 0;
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
+                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->mux_timebase),
+                av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->mux_timebase));
+        }
 
-        ost->frames_encoded++;
+        frame_size = pkt.size;
+        ret = output_packet(of, &pkt, ost, 0);
+        if (ret < 0)
+            return ret;
 
-        subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
-                                                    subtitle_out_max_size, sub);
-        if (i == 1)
-            sub->num_rects = save_num_rects;
-        if (subtitle_out_size < 0) {
-            av_log(NULL, AV_LOG_FATAL, "Subtitle encoding failed\n");
-            exit_program(1);
+        /* if two pass, output log */
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
         }
+    }
 
-        av_init_packet(&pkt);
-        pkt.data = subtitle_out;
-        pkt.size = subtitle_out_size;
-        pkt.pts  = av_rescale_q(sub->pts, AV_TIME_BASE_Q, ost->mux_timebase);
-        pkt.duration = av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
-        if (enc->codec_id == AV_CODEC_ID_DVB_SUBTITLE) {
-            /* XXX: the pts correction is handled here. Maybe handling
-               it in the codec would be better */
-            if (i == 0)
-                pkt.pts += av_rescale_q(sub->start_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
-            else
-                pkt.pts += av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
-        }
-        pkt.dts = pkt.pts;
-        output_packet(of, &pkt, ost, 0);
+    if (vstats_filename && frame_size) {
+        mux_lock(of);
+        ret = do_video_stats(ost, frame_size);
+        mux_unlock(of);
+        if (ret < 0)
+            return ret;
     }
+
+    return 0;
 }
 
-static void do_video_out(OutputFile *of,
-                         OutputStream *ost,
-                         AVFrame *next_picture,
-                         double sync_ipts)
+/*
+ * Hand a frame over to the encoder of ost, either directly or through the
+ * encoder thread of the stream. The frame is not consumed, the encoder
+ * thread gets its own reference.
+ */
+static int send_frame_to_encoder(OutputFile *of, OutputStream *ost,
+                                 AVFrame *frame)
 {
-    int ret, format_video_sync;
-    AVPacket pkt;
-    AVCodecContext *enc = ost->enc_ctx;
-    AVCodecParameters *mux_par = ost->st->codecpar;
-    AVRational frame_rate;
-    int nb_frames, nb0_frames, i;
-    double delta, delta0;
-    double duration = 0;
-    int frame_size = 0;
-    InputStream *ist = NULL;
-    AVFilterContext *filter = ost->filter->filter;
+#if HAVE_THREADS
+    if (ost->enc_thread_queue) {
+        AVFrame *tmp = av_frame_clone(frame);
+        int ret;
 
-    if (ost->source_index >= 0)
-        ist = input_streams[ost->source_index];
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        ret = queue_send(ost->enc_thread_queue, &tmp, 0, "enc_queue_send");
+        if (ret < 0)
+            av_frame_free(&tmp);
+        return ret;
+    }
+#endif
+    if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO)
+        return encode_video_frame(of, ost, frame);
+    return encode_audio_frame(of, ost, frame);
+}
 
-    frame_rate = av_buffersink_get_frame_rate(filter);
-    if (frame_rate.num > 0 && frame_rate.den > 0)
-        duration = 1/(av_q2d(frame_rate) * av_q2d(enc->time_base));
+#if HAVE_THREADS
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    OutputFile    *of = output_files[ost->file_index];
+    AVFrame *frame;
+    int ret;
 
-    if(ist && ist->st->start_time != AV_NOPTS_VALUE && ist->st->first_dts != AV_NOPTS_VALUE && ost->frame_rate.num)
-        duration = FFMIN(duration, 1/(av_q2d(ost->frame_rate) * av_q2d(enc->time_base)));
+    while (queue_recv(ost->enc_thread_queue, &frame, 0, "enc_queue_recv") >= 0) {
+        if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO)
+            ret = encode_video_frame(of, ost, frame);
+        else
+            ret = encode_audio_frame(of, ost, frame);
+        av_frame_free(&frame);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error encoding a frame for output stream #%d:%d: %s\n",
+                   ost->file_index, ost->index, av_err2str(ret));
+            /* fail the next frame sent and leave the error to the main loop */
+            mux_lock(of);
+            ost->enc_thread_ret = ret;
+            mux_unlock(of);
+            av_thread_message_queue_set_err_send(ost->enc_thread_queue, ret);
+            break;
+        }
+    }
 
-    if (!ost->filters_script &&
-        !ost->filters &&
+    return NULL;
+}
+
+static void free_queued_frame(void *msg)
+{
+    av_frame_free((AVFrame **)msg);
+}
+
+/* wait for all queued frames to be encoded and stop the encoder thread */
+static int free_encoder_thread(OutputStream *ost)
+{
+    if (!ost)
+        return 0;
+    if (ost->enc_thread_queue) {
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+        pthread_join(ost->enc_thread, NULL);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+    }
+    return ost->enc_thread_ret;
+}
+
+static int free_encoder_threads(void)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < nb_output_streams; i++)
+        if (free_encoder_thread(output_streams[i]) < 0)
+            ret = output_streams[i]->enc_thread_ret;
+    return ret;
+}
+
+/*
+ * Check whether an encoder thread has failed. The thread is not joined here
+ * as the threads feeding it may still use its queue, the caller must stop
+ * transcoding and free all threads in order.
+ */
+static int check_encoder_threads(void)
+{
+    int i, ret;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        OutputFile    *of = output_files[ost->file_index];
+
+        if (!ost->enc_thread_queue)
+            continue;
+        mux_lock(of);
+        ret = ost->enc_thread_ret;
+        mux_unlock(of);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    if (!enc_threads_per_output ||
+        (ost->enc_ctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+         ost->enc_ctx->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+
+    ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                        FFMAX(enc_thread_queue_size, 1),
+                                        sizeof(AVFrame *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(ost->enc_thread_queue, free_queued_frame);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+#endif
+
+static int do_audio_out(OutputFile *of, OutputStream *ost,
+                        AVFrame *frame)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+    int ret;
+
+    if (!check_recording_time(ost))
+        return 0;
+
+    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
+        frame->pts = ost->sync_opts;
+    ost->sync_opts = frame->pts + frame->nb_samples;
+    ost->samples_encoded += frame->nb_samples;
+    ost->frames_encoded++;
+
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "encoder <- type:audio "
+               "frame_pts:%s frame_pts_time:%s time_base:%d/%d\n",
+               av_ts2str(frame->pts), av_ts2timestr(frame->pts, &enc->time_base),
+               enc->time_base.num, enc->time_base.den);
+    }
+
+    ret = send_frame_to_encoder(of, ost, frame);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Audio encoding failed\n");
+        return ret;
+    }
+
+    return 0;
+}
+
+static void do_subtitle_out(OutputFile *of,
+                            OutputStream *ost,
+                            AVSubtitle *sub)
+{
+    int subtitle_out_max_size = 1024 * 1024;
+    int subtitle_out_size, nb, i;
+    AVCodecContext *enc;
+    AVPacket pkt;
+    int64_t pts;
+
+    if (sub->pts == AV_NOPTS_VALUE) {
+        av_log(NULL, AV_LOG_ERROR, "Subtitle packets must have a pts\n");
+        if (exit_on_error)
+            exit_program(1);
+        return;
+    }
+
+    enc = ost->enc_ctx;
+
+    if (!subtitle_out) {
+        subtitle_out = av_malloc(subtitle_out_max_size);
+        if (!subtitle_out) {
+            av_log(NULL, AV_LOG_FATAL, "Failed to allocate subtitle_out\n");
+            exit_program(1);
+        }
+    }
+
+    /* Note: DVB subtitle need one packet to draw them and one other
+       packet to clear them */
+    /* XXX: signal it in the codec context ? */
+    if (enc->codec_id == AV_CODEC_ID_DVB_SUBTITLE)
+        nb = 2;
+    else
+        nb = 1;
+
+    /* shift timestamp to honor -ss and make check_recording_time() work with -t */
+    pts = sub->pts;
+    if (output_files[ost->file_index]->start_time != AV_NOPTS_VALUE)
+        pts -= output_files[ost->file_index]->start_time;
+    for (i = 0; i < nb; i++) {
+        unsigned save_num_rects = sub->num_rects;
+
+        ost->sync_opts = av_rescale_q(pts, AV_TIME_BASE_Q, enc->time_base);
+        if (!check_recording_time(ost))
+            return;
+
+        sub->pts = pts;
+        // start_display_time is required to be 0
+        sub->pts               += av_rescale_q(sub->start_display_time, (AVRational){ 1, 1000 }, AV_TIME_BASE_Q);
+        sub->end_display_time  -= sub->start_display_time;
+        sub->start_display_time = 0;
+        if (i == 1)
+            sub->num_rects = 0;
+
+        ost->frames_encoded++;
+
+        subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
+                                                    subtitle_out_max_size, sub);
+        if (i == 1)
+            sub->num_rects = save_num_rects;
+        if (subtitle_out_size < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Subtitle encoding failed\n");
+            exit_program(1);
+        }
+
+        av_init_packet(&pkt);
+        pkt.data = subtitle_out;
+        pkt.size = subtitle_out_size;
+        pkt.pts  = av_rescale_q(sub->pts, AV_TIME_BASE_Q, ost->mux_timebase);
+        pkt.duration = av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
+        if (enc->codec_id == AV_CODEC_ID_DVB_SUBTITLE) {
+            /* XXX: the pts correction is handled here. Maybe handling
+               it in the codec would be better */
+            if (i == 0)
+                pkt.pts += av_rescale_q(sub->start_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
+            else
+                pkt.pts += av_rescale_q(sub->end_display_time, (AVRational){ 1, 1000 }, ost->mux_timebase);
+        }
+        pkt.dts = pkt.pts;
+        if (output_packet(of, &pkt, ost, 0) < 0)
+            exit_program(1);
+    }
+}
+
+static int do_video_out(OutputFile *of,
+                        OutputStream *ost,
+                        AVFrame *next_picture,
+                        double sync_ipts)
+{
+    int ret, format_video_sync;
+    AVCodecContext *enc = ost->enc_ctx;
+    AVCodecParameters *mux_par = ost->st->codecpar;
+    AVRational frame_rate;
+    int nb_frames, nb0_frames, i;
+    double delta, delta0;
+    double duration = 0;
+    InputStream *ist = NULL;
+    AVFilterContext *filter = ost->filter->filter;
+
+    if (ost->source_index >= 0)
+        ist = input_streams[ost->source_index];
+
+    frame_rate = av_buffersink_get_frame_rate(filter);
+    if (frame_rate.num > 0 && frame_rate.den > 0)
+        duration = 1/(av_q2d(frame_rate) * av_q2d(enc->time_base));
+
+    if(ist && ist->st->start_time != AV_NOPTS_VALUE && ist->st->first_dts != AV_NOPTS_VALUE && ost->frame_rate.num)
+        duration = FFMIN(duration, 1/(av_q2d(ost->frame_rate) * av_q2d(enc->time_base)));
+
+    if (!ost->filters_script &&
+        !ost->filters &&
         (nb_filtergraphs == 0 || !filtergraphs[0]->graph_desc) &&
         next_picture &&
         ist &&
@@ -1133,7 +1536,7 @@ static void do_video_out(OutputFile *of,
 
         switch (format_video_sync) {
         case VSYNC_VSCFR:
-            if (ost->frame_number == 0 && delta0 >= 0.5) {
+            if (atomic_load(&ost->frame_number) == 0 && delta0 >= 0.5) {
                 av_log(NULL, AV_LOG_DEBUG, "Not duplicating %d initial frames\n", (int)lrintf(delta0));
                 delta = duration;
                 delta0 = 0;
@@ -1141,7 +1544,7 @@ static void do_video_out(OutputFile *of,
             }
         case VSYNC_CFR:
             // FIXME set to 0.5 after we fix some dts/pts bugs like in avidec.c
-            if (frame_drop_threshold && delta < frame_drop_threshold && ost->frame_number) {
+            if (frame_drop_threshold && delta < frame_drop_threshold && atomic_load(&ost->frame_number)) {
                 nb_frames = 0;
             } else if (delta < -1.1)
                 nb_frames = 0;
@@ -1166,7 +1569,7 @@ static void do_video_out(OutputFile *of,
         }
     }
 
-    nb_frames = FFMIN(nb_frames, ost->max_frames - ost->frame_number);
+    nb_frames = FFMIN(nb_frames, ost->max_frames - atomic_load(&ost->frame_number));
     nb0_frames = FFMIN(nb0_frames, nb_frames);
 
     memmove(ost->last_nb0_frames + 1,
@@ -1175,20 +1578,23 @@ static void do_video_out(OutputFile *of,
     ost->last_nb0_frames[0] = nb0_frames;
 
     if (nb0_frames == 0 && ost->last_dropped) {
-        nb_frames_drop++;
+        atomic_fetch_add(&nb_frames_drop, 1);
+        ost->frames_drop++;
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
-               ost->frame_number, ost->st->index, ost->last_frame->pts);
+               atomic_load(&ost->frame_number), ost->st->index, ost->last_frame->pts);
     }
     if (nb_frames > (nb0_frames && ost->last_dropped) + (nb_frames > nb0_frames)) {
         if (nb_frames > dts_error_threshold * 30) {
             av_log(NULL, AV_LOG_ERROR, "%d frame duplication too large, skipping\n", nb_frames - 1);
-            nb_frames_drop++;
-            return;
+            atomic_fetch_add(&nb_frames_drop, 1);
+            ost->frames_drop++;
+            return 0;
         }
-        nb_frames_dup += nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames);
+        atomic_fetch_add(&nb_frames_dup, nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames));
+        ost->frames_dup += nb_frames - (nb0_frames && ost->last_dropped) - (nb_frames > nb0_frames);
         av_log(NULL, AV_LOG_VERBOSE, "*** %d dup!\n", nb_frames - 1);
-        if (nb_frames_dup > dup_warning) {
+        if (atomic_load(&nb_frames_dup) > dup_warning) {
             av_log(NULL, AV_LOG_WARNING, "More than %d frames duplicated\n", dup_warning);
             dup_warning *= 10;
         }
@@ -1200,9 +1606,6 @@ static void do_video_out(OutputFile *of,
         AVFrame *in_picture;
         int forced_keyframe = 0;
         double pts_time;
-        av_init_packet(&pkt);
-        pkt.data = NULL;
-        pkt.size = 0;
 
         if (i < nb0_frames && ost->last_frame) {
             in_picture = ost->last_frame;
@@ -1210,12 +1613,12 @@ static void do_video_out(OutputFile *of,
             in_picture = next_picture;
 
         if (!in_picture)
-            return;
+            return 0;
 
         in_picture->pts = ost->sync_opts;
 
         if (!check_recording_time(ost))
-            return;
+            return 0;
 
         if (enc->flags & (AV_CODEC_FLAG_INTERLACED_DCT | AV_CODEC_FLAG_INTERLACED_ME) &&
             ost->top_field_first >= 0)
@@ -1275,7 +1678,6 @@ static void do_video_out(OutputFile *of,
             av_log(NULL, AV_LOG_DEBUG, "Forced keyframe at time %f\n", pts_time);
         }
 
-        update_benchmark(NULL);
         if (debug_ts) {
             av_log(NULL, AV_LOG_INFO, "encoder <- type:video "
                    "frame_pts:%s frame_pts_time:%s time_base:%d/%d\n",
@@ -1285,57 +1687,19 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
-        ret = avcodec_send_frame(enc, in_picture);
+        ret = send_frame_to_encoder(of, ost, in_picture);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
 
-        while (1) {
-            ret = avcodec_receive_packet(enc, &pkt);
-            update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
-            if (ret == AVERROR(EAGAIN))
-                break;
-            if (ret < 0)
-                goto error;
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                       "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                       av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
-                       av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
-            }
-
-            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
-                pkt.pts = ost->sync_opts;
-
-            av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                    "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                    av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->mux_timebase),
-                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->mux_timebase));
-            }
-
-            frame_size = pkt.size;
-            output_packet(of, &pkt, ost, 0);
-
-            /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
-        }
         ost->sync_opts++;
         /*
          * For video, number of frames in == number of packets out.
          * But there may be reordering, so we can't throw away frames on encoder
          * flush, we need to limit them here, before they go into encoder.
          */
-        ost->frame_number++;
-
-        if (vstats_filename && frame_size)
-            do_video_stats(ost, frame_size);
+        atomic_fetch_add(&ost->frame_number, 1);
     }
 
     if (!ost->last_frame)
@@ -1346,10 +1710,10 @@ static void do_video_out(OutputFile *of,
     else
         av_frame_free(&ost->last_frame);
 
-    return;
+    return 0;
 error:
     av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
-    exit_program(1);
+    return ret;
 }
 
 static double psnr(double d)
@@ -1357,7 +1721,7 @@ static double psnr(double d)
     return -10.0 * log10(d);
 }
 
-static void do_video_stats(OutputStream *ost, int frame_size)
+static int do_video_stats(OutputStream *ost, int frame_size)
 {
     AVCodecContext *enc;
     int frame_number;
@@ -1367,8 +1731,9 @@ static void do_video_stats(OutputStream *ost, int frame_size)
     if (!vstats_file) {
         vstats_file = fopen(vstats_filename, "w");
         if (!vstats_file) {
+            int ret = AVERROR(errno);
             perror("fopen");
-            exit_program(1);
+            return ret;
         }
     }
 
@@ -1398,6 +1763,8 @@ static void do_video_stats(OutputStream *ost, int frame_size)
                (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
         fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(ost->pict_type));
     }
+
+    return 0;
 }
 
 static int init_output_stream(OutputStream *ost, char *error, int error_len);
@@ -1407,119 +1774,154 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
-    ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
+    atomic_store(&ost->finished, ENCODER_FINISHED | MUXER_FINISHED);
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
-            output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
+            atomic_store(&output_streams[of->ost_index + i]->finished, ENCODER_FINISHED | MUXER_FINISHED);
     }
 }
 
 /**
- * Get and encode new output from any of the filtergraphs, without causing
- * activity.
+ * Get and encode new output from the filtergraph feeding ost, without
+ * causing activity.
  *
  * @return  0 for success, <0 for severe errors
  */
-static int reap_filters(int flush)
+static int reap_filter_output(OutputStream *ost, int flush)
 {
+    OutputFile    *of = output_files[ost->file_index];
     AVFrame *filtered_frame = NULL;
-    int i;
+    AVFilterContext *filter;
+    AVCodecContext *enc = ost->enc_ctx;
+    int ret = 0;
 
-    /* Reap all buffers present in the buffer sinks */
-    for (i = 0; i < nb_output_streams; i++) {
-        OutputStream *ost = output_streams[i];
-        OutputFile    *of = output_files[ost->file_index];
-        AVFilterContext *filter;
-        AVCodecContext *enc = ost->enc_ctx;
-        int ret = 0;
+    if (!ost->filter || !ost->filter->graph->graph)
+        return 0;
+    filter = ost->filter->filter;
 
-        if (!ost->filter || !ost->filter->graph->graph)
-            continue;
-        filter = ost->filter->filter;
+    if (!ost->initialized) {
+        char error[1024] = "";
+        ret = init_output_stream(ost, error, sizeof(error));
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error initializing output stream %d:%d -- %s\n",
+                   ost->file_index, ost->index, error);
+            return ret;
+        }
+    }
 
-        if (!ost->initialized) {
-            char error[1024] = "";
-            ret = init_output_stream(ost, error, sizeof(error));
-            if (ret < 0) {
-                av_log(NULL, AV_LOG_ERROR, "Error initializing output stream %d:%d -- %s\n",
-                       ost->file_index, ost->index, error);
-                exit_program(1);
+    if (!ost->filtered_frame && !(ost->filtered_frame = av_frame_alloc())) {
+        return AVERROR(ENOMEM);
+    }
+    filtered_frame = ost->filtered_frame;
+
+    while (1) {
+        double float_pts = AV_NOPTS_VALUE; // this is identical to filtered_frame.pts but with higher precision
+        ret = av_buffersink_get_frame_flags(filter, filtered_frame,
+                                           AV_BUFFERSINK_FLAG_NO_REQUEST);
+        if (ret < 0) {
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+                av_log(NULL, AV_LOG_WARNING,
+                       "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
+            } else if (flush && ret == AVERROR_EOF) {
+                if (av_buffersink_get_type(filter) == AVMEDIA_TYPE_VIDEO)
+                    return do_video_out(of, ost, NULL, AV_NOPTS_VALUE);
             }
+            break;
         }
+        if (atomic_load(&ost->finished)) {
+            av_frame_unref(filtered_frame);
+            continue;
+        }
+        if (filtered_frame->pts != AV_NOPTS_VALUE) {
+            int64_t start_time = (of->start_time == AV_NOPTS_VALUE) ? 0 : of->start_time;
+            AVRational filter_tb = av_buffersink_get_time_base(filter);
+            AVRational tb = enc->time_base;
+            int extra_bits = av_clip(29 - av_log2(tb.den), 0, 16);
 
-        if (!ost->filtered_frame && !(ost->filtered_frame = av_frame_alloc())) {
-            return AVERROR(ENOMEM);
+            tb.den <<= extra_bits;
+            float_pts =
+                av_rescale_q(filtered_frame->pts, filter_tb, tb) -
+                av_rescale_q(start_time, AV_TIME_BASE_Q, tb);
+            float_pts /= 1 << extra_bits;
+            // avoid exact midoints to reduce the chance of rounding differences, this can be removed in case the fps code is changed to work with integers
+            float_pts += FFSIGN(float_pts) * 1.0 / (1<<17);
+
+            filtered_frame->pts =
+                av_rescale_q(filtered_frame->pts, filter_tb, enc->time_base) -
+                av_rescale_q(start_time, AV_TIME_BASE_Q, enc->time_base);
         }
-        filtered_frame = ost->filtered_frame;
 
-        while (1) {
-            double float_pts = AV_NOPTS_VALUE; // this is identical to filtered_frame.pts but with higher precision
-            ret = av_buffersink_get_frame_flags(filter, filtered_frame,
-                                               AV_BUFFERSINK_FLAG_NO_REQUEST);
-            if (ret < 0) {
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
-                    av_log(NULL, AV_LOG_WARNING,
-                           "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
-                } else if (flush && ret == AVERROR_EOF) {
-                    if (av_buffersink_get_type(filter) == AVMEDIA_TYPE_VIDEO)
-                        do_video_out(of, ost, NULL, AV_NOPTS_VALUE);
-                }
-                break;
-            }
-            if (ost->finished) {
-                av_frame_unref(filtered_frame);
-                continue;
-            }
-            if (filtered_frame->pts != AV_NOPTS_VALUE) {
-                int64_t start_time = (of->start_time == AV_NOPTS_VALUE) ? 0 : of->start_time;
-                AVRational filter_tb = av_buffersink_get_time_base(filter);
-                AVRational tb = enc->time_base;
-                int extra_bits = av_clip(29 - av_log2(tb.den), 0, 16);
-
-                tb.den <<= extra_bits;
-                float_pts =
-                    av_rescale_q(filtered_frame->pts, filter_tb, tb) -
-                    av_rescale_q(start_time, AV_TIME_BASE_Q, tb);
-                float_pts /= 1 << extra_bits;
-                // avoid exact midoints to reduce the chance of rounding differences, this can be removed in case the fps code is changed to work with integers
-                float_pts += FFSIGN(float_pts) * 1.0 / (1<<17);
-
-                filtered_frame->pts =
-                    av_rescale_q(filtered_frame->pts, filter_tb, enc->time_base) -
-                    av_rescale_q(start_time, AV_TIME_BASE_Q, enc->time_base);
-            }
+        switch (av_buffersink_get_type(filter)) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (!ost->frame_aspect_ratio.num)
+                enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
 
-            switch (av_buffersink_get_type(filter)) {
-            case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
-                    enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
-                if (debug_ts) {
-                    av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
-                            av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
-                            float_pts,
-                            enc->time_base.num, enc->time_base.den);
-                }
+            if (debug_ts) {
+                av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s exact:%f time_base:%d/%d\n",
+                        av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
+                        float_pts,
+                        enc->time_base.num, enc->time_base.den);
+            }
 
-                do_video_out(of, ost, filtered_frame, float_pts);
-                break;
-            case AVMEDIA_TYPE_AUDIO:
-                if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
-                    enc->channels != filtered_frame->channels) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of, ost, filtered_frame);
+            ret = do_video_out(of, ost, filtered_frame, float_pts);
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            if (!(enc->codec->capabilities & AV_CODEC_CAP_PARAM_CHANGE) &&
+                enc->channels != filtered_frame->channels) {
+                av_log(NULL, AV_LOG_ERROR,
+                       "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
                 break;
-            default:
-                // TODO support subtitle filters
-                av_assert0(0);
             }
+            ret = do_audio_out(of, ost, filtered_frame);
+            break;
+        default:
+            // TODO support subtitle filters
+            av_assert0(0);
+        }
+
+        av_frame_unref(filtered_frame);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Get and encode new output from any of the filtergraphs, without causing
+ * activity. Filtergraphs running in their own thread are reaped by it, so
+ * this is only called from the main thread and failures are fatal.
+ *
+ * @return  0 for success
+ */
+static int reap_filters(int flush)
+{
+    int i;
+
+    /* Reap all buffers present in the buffer sinks */
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+#if HAVE_THREADS
+        if (ost->filter && ost->filter->graph->queue)
+            continue;
+#endif
+        if (reap_filter_output(ost, flush) < 0)
+            exit_program(1);
+    }
+
+    return 0;
+}
+
+static int reap_filtergraph(FilterGraph *fg, int flush)
+{
+    int i, ret;
 
-            av_frame_unref(filtered_frame);
-        }
+    for (i = 0; i < fg->nb_outputs; i++) {
+        ret = reap_filter_output(fg->outputs[i]->ost, flush);
+        if (ret < 0)
+            return ret;
     }
 
     return 0;
@@ -1642,6 +2044,115 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static void print_stage_json(AVBPrint *buf, const char *name, const StageStats *s)
+{
+    int i;
+
+    av_bprintf(buf, "\"%s\":{\"calls\":%"PRIu64",\"real_us\":%"PRId64","
+               "\"cpu_us\":%"PRId64",\"max_us\":%"PRId64",\"hist\":[",
+               name, s->nb_calls, s->real_usec, s->cpu_usec, s->max_usec);
+    for (i = 0; i < STAGE_HIST_SIZE; i++)
+        av_bprintf(buf, "%s%"PRIu64, i ? "," : "", s->hist[i]);
+    av_bprintf(buf, "]}");
+}
+
+static int queue_fill(AVThreadMessageQueue *q)
+{
+    int ret = q ? av_thread_message_queue_nb_elems(q) : 0;
+    return FFMAX(ret, 0);
+}
+
+/*
+ * Write one JSON object per report to -stats_json, with the time spent in
+ * each stage, the number of messages waiting in the thread queues and the
+ * memory held by buffers.
+ */
+static void print_stats_json(int is_last_report, int64_t timer_start, int64_t cur_time)
+{
+    AVBPrint buf;
+    int i, j;
+
+    av_bprint_init(&buf, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&buf, "{\"time_us\":%"PRId64",\"last\":%d,\"inputs\":[",
+               cur_time - timer_start, is_last_report);
+
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        int fill = 0, size = 0;
+#if HAVE_THREADS
+        fill = queue_fill(f->in_thread_queue);
+        size = f->in_thread_queue ? f->thread_queue_size : 0;
+#endif
+        av_bprintf(&buf, "%s{\"file\":%d,", i ? "," : "", i);
+        print_stage_json(&buf, "demux", &f->demux_stats);
+        av_bprintf(&buf, ",\"queue\":%d,\"queue_size\":%d,\"streams\":[",
+                   fill, size);
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+            int pkt_fill = 0, frame_fill = 0;
+#if HAVE_THREADS
+            pkt_fill   = queue_fill(ist->dec_pkt_queue);
+            frame_fill = queue_fill(ist->dec_frame_queue);
+#endif
+            av_bprintf(&buf, "%s{\"index\":%d,\"packets\":%"PRIu64","
+                       "\"frames\":%"PRIu64",", j ? "," : "", j,
+                       ist->nb_packets, ist->frames_decoded);
+            print_stage_json(&buf, "decode", &ist->decode_stats);
+            av_bprintf(&buf, ",\"packet_queue\":%d,\"frame_queue\":%d}",
+                       pkt_fill, frame_fill);
+        }
+        av_bprintf(&buf, "]}");
+    }
+
+    av_bprintf(&buf, "],\"filtergraphs\":[");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        int fill = 0;
+#if HAVE_THREADS
+        fill = queue_fill(fg->queue);
+#endif
+        av_bprintf(&buf, "%s{\"index\":%d,", i ? "," : "", fg->index);
+        print_stage_json(&buf, "filter", &fg->filter_stats);
+        av_bprintf(&buf, ",\"queue\":%d}", fill);
+    }
+
+    av_bprintf(&buf, "],\"outputs\":[");
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        int fill = 0;
+#if HAVE_THREADS
+        fill = queue_fill(ost->enc_thread_queue);
+#endif
+        mux_lock(output_files[ost->file_index]);
+        av_bprintf(&buf, "%s{\"file\":%d,\"index\":%d,\"frames\":%"PRIu64","
+                   "\"packets\":%"PRIu64",\"dup\":%"PRIu64",\"drop\":%"PRIu64",",
+                   i ? "," : "", ost->file_index, ost->index, ost->frames_encoded,
+                   ost->packets_written, ost->frames_dup, ost->frames_drop);
+        print_stage_json(&buf, "encode", &ost->encode_stats);
+        av_bprintf(&buf, ",");
+        print_stage_json(&buf, "mux", &ost->mux_stats);
+        av_bprintf(&buf, ",\"frame_queue\":%d,\"muxing_queue\":%d}", fill,
+                   ost->muxing_queue ? (int)(av_fifo_size(ost->muxing_queue) / sizeof(AVPacket)) : 0);
+        mux_unlock(output_files[ost->file_index]);
+    }
+
+    av_bprintf(&buf, "],\"memory\":{");
+    for (i = 0; i < AV_MEM_TAG_NB; i++) {
+        AVMemStats stats;
+        av_mem_get_stats(i, &stats);
+        av_bprintf(&buf, "%s\"%s\":{\"allocs\":%"PRId64",\"size\":%"PRId64","
+                   "\"peak_size\":%"PRId64"}", i ? "," : "", av_mem_tag_name(i),
+                   stats.nb_allocs, stats.size, stats.peak_size);
+    }
+    av_bprintf(&buf, "}}\n");
+
+    if (av_bprint_is_complete(&buf)) {
+        avio_write(stats_json_avio, buf.str, buf.len);
+        avio_flush(stats_json_avio);
+    }
+    av_bprint_finalize(&buf, NULL);
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     AVBPrint buf, buf_script;
@@ -1649,7 +2160,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     AVFormatContext *oc;
     int64_t total_size;
     AVCodecContext *enc;
-    int frame_number, vid, i;
+    int frame_number, frames_dup, frames_drop, vid, i;
     double bitrate;
     double speed;
     int64_t pts = INT64_MIN + 1;
@@ -1660,7 +2171,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     int ret;
     float t;
 
-    if (!print_stats && !is_last_report && !progress_avio)
+    if (!print_stats && !is_last_report && !progress_avio && !stats_json_avio)
         return;
 
     if (!is_last_report) {
@@ -1678,9 +2189,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+    mux_lock(output_files[0]);
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
+    mux_unlock(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
@@ -1689,6 +2202,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         float q = -1;
         ost = output_streams[i];
         enc = ost->enc_ctx;
+        /* the stats are updated by the threads muxing the packets */
+        mux_lock(output_files[ost->file_index]);
         if (!ost->stream_copy)
             q = ost->quality / (float) FF_QP2LAMBDA;
 
@@ -1700,7 +2215,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (!vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             float fps;
 
-            frame_number = ost->frame_number;
+            frame_number = atomic_load(&ost->frame_number);
             fps = t > 1 ? frame_number / t : 0;
             av_bprintf(&buf, "frame=%5d fps=%3.*f q=%3.1f ",
                      frame_number, fps < 9.95, fps, q);
@@ -1754,8 +2269,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE)
             pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
                                           ost->st->time_base, AV_TIME_BASE_Q));
-        if (is_last_report)
-            nb_frames_drop += ost->last_dropped;
+        if (is_last_report) {
+            atomic_fetch_add(&nb_frames_drop, ost->last_dropped);
+            ost->frames_drop += ost->last_dropped;
+        }
+        mux_unlock(output_files[ost->file_index]);
     }
 
     secs = FFABS(pts) / AV_TIME_BASE;
@@ -1799,10 +2317,12 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                    hours_sign, hours, mins, secs, us);
     }
 
-    if (nb_frames_dup || nb_frames_drop)
-        av_bprintf(&buf, " dup=%d drop=%d", nb_frames_dup, nb_frames_drop);
-    av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
-    av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+    frames_dup  = atomic_load(&nb_frames_dup);
+    frames_drop = atomic_load(&nb_frames_drop);
+    if (frames_dup || frames_drop)
+        av_bprintf(&buf, " dup=%d drop=%d", frames_dup, frames_drop);
+    av_bprintf(&buf_script, "dup_frames=%d\n", frames_dup);
+    av_bprintf(&buf_script, "drop_frames=%d\n", frames_drop);
 
     if (speed < 0) {
         av_bprintf(&buf, " speed=N/A");
@@ -1837,6 +2357,18 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         }
     }
 
+    if (stats_json_avio) {
+        print_stats_json(is_last_report, timer_start, cur_time);
+        if (is_last_report) {
+            AVIOContext *avio = stats_json_avio;
+
+            stats_json_avio = NULL;
+            if ((ret = avio_closep(&avio)) < 0)
+                av_log(NULL, AV_LOG_ERROR,
+                       "Error closing stats_json log, loss of information possible: %s\n", av_err2str(ret));
+        }
+    }
+
     if (is_last_report)
         print_final_stats(total_size);
 }
@@ -1858,6 +2390,14 @@ static void flush_encoders(void)
 {
     int i, ret;
 
+#if HAVE_THREADS
+    /* drain the encoder threads, the remaining work is done from here */
+    if (free_encoder_threads() < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Encoding failed\n");
+        exit_program(1);
+    }
+#endif
+
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream   *ost = output_streams[i];
         AVCodecContext *enc = ost->enc_ctx;
@@ -1930,7 +2470,7 @@ static void flush_encoders(void)
             pkt.data = NULL;
             pkt.size = 0;
 
-            update_benchmark(NULL);
+            update_benchmark(&ost->enc_bench, NULL);
 
             while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
                 ret = avcodec_send_frame(enc, NULL);
@@ -1942,7 +2482,7 @@ static void flush_encoders(void)
                 }
             }
 
-            update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
+            update_benchmark(&ost->enc_bench, "flush_%s %d.%d", desc, ost->file_index, ost->index);
             if (ret < 0 && ret != AVERROR_EOF) {
                 av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
                        desc,
@@ -1953,18 +2493,21 @@ static void flush_encoders(void)
                 fprintf(ost->logfile, "%s", enc->stats_out);
             }
             if (ret == AVERROR_EOF) {
-                output_packet(of, &pkt, ost, 1);
+                if (output_packet(of, &pkt, ost, 1) < 0)
+                    exit_program(1);
                 break;
             }
-            if (ost->finished & MUXER_FINISHED) {
+            if (atomic_load(&ost->finished) & MUXER_FINISHED) {
                 av_packet_unref(&pkt);
                 continue;
             }
             av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
             pkt_size = pkt.size;
-            output_packet(of, &pkt, ost, 0);
+            if (output_packet(of, &pkt, ost, 0) < 0)
+                exit_program(1);
             if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                do_video_stats(ost, pkt_size);
+                if (do_video_stats(ost, pkt_size) < 0)
+                    exit_program(1);
             }
         }
     }
@@ -1981,7 +2524,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (atomic_load(&ost->finished))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -2003,15 +2546,16 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
         av_init_packet(&opkt);
         opkt.data = NULL;
         opkt.size = 0;
-        output_packet(of, &opkt, ost, 1);
+        if (output_packet(of, &opkt, ost, 1) < 0)
+            exit_program(1);
         return;
     }
 
-    if ((!ost->frame_number && !(pkt->flags & AV_PKT_FLAG_KEY)) &&
+    if ((!atomic_load(&ost->frame_number) && !(pkt->flags & AV_PKT_FLAG_KEY)) &&
         !ost->copy_initial_nonkeyframes)
         return;
 
-    if (!ost->frame_number && !ost->copy_prior_start) {
+    if (!atomic_load(&ost->frame_number) && !ost->copy_prior_start) {
         int64_t comp_start = start_time;
         if (copy_ts && f->start_time != AV_NOPTS_VALUE)
             comp_start = FFMAX(start_time, f->start_time + f->ts_offset);
@@ -2064,7 +2608,8 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
 
     opkt.duration = av_rescale_q(pkt->duration, ist->st->time_base, ost->mux_timebase);
 
-    output_packet(of, &opkt, ost, 0);
+    if (output_packet(of, &opkt, ost, 0) < 0)
+        exit_program(1);
 }
 
 int guess_input_channel_layout(InputStream *ist)
@@ -2120,6 +2665,7 @@ static int ifilter_has_all_input_formats(FilterGraph *fg)
 static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
 {
     FilterGraph *fg = ifilter->graph;
+    StageTimer timer;
     int need_reinit, ret, i;
 
     /* determine if the parameters for this input changed */
@@ -2171,6 +2717,11 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
             }
         }
 
+#if HAVE_THREADS
+        if (fg->queue)
+            ret = reap_filtergraph(fg, 1);
+        else
+#endif
         ret = reap_filters(1);
         if (ret < 0 && ret != AVERROR_EOF) {
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2184,7 +2735,9 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
         }
     }
 
+    stage_start(&timer);
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+    stage_end(&fg->filter_stats, &timer);
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2200,42 +2753,407 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
 
     ifilter->eof = 1;
 
-    if (ifilter->filter) {
-        ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
-        if (ret < 0)
-            return ret;
-    } else {
-        // the filtergraph was never configured
-        if (ifilter->format < 0)
-            ifilter_parameters_from_codecpar(ifilter, ifilter->ist->st->codecpar);
-        if (ifilter->format < 0 && (ifilter->type == AVMEDIA_TYPE_AUDIO || ifilter->type == AVMEDIA_TYPE_VIDEO)) {
-            av_log(NULL, AV_LOG_ERROR, "Cannot determine format of input stream %d:%d after EOF\n", ifilter->ist->file_index, ifilter->ist->st->index);
-            return AVERROR_INVALIDDATA;
-        }
+    if (ifilter->filter) {
+        ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
+        if (ret < 0)
+            return ret;
+    } else {
+        // the filtergraph was never configured
+        if (ifilter->format < 0)
+            ifilter_parameters_from_codecpar(ifilter, ifilter->ist->st->codecpar);
+        if (ifilter->format < 0 && (ifilter->type == AVMEDIA_TYPE_AUDIO || ifilter->type == AVMEDIA_TYPE_VIDEO)) {
+            av_log(NULL, AV_LOG_ERROR, "Cannot determine format of input stream %d:%d after EOF\n", ifilter->ist->file_index, ifilter->ist->st->index);
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    return 0;
+}
+
+#if HAVE_THREADS
+typedef struct FilterGraphMsg {
+    InputFilter *ifilter;
+    AVFrame     *frame;     /* NULL to signal EOF */
+    int64_t      eof_pts;
+} FilterGraphMsg;
+
+static void *filtergraph_thread(void *arg)
+{
+    FilterGraph *fg = arg;
+    FilterGraphMsg msg;
+    int ret;
+
+    while (queue_recv(fg->queue, &msg, 0, "filter_queue_recv") >= 0) {
+        pthread_mutex_lock(&fg->lock);
+        if (msg.frame) {
+            ret = ifilter_send_frame(msg.ifilter, msg.frame);
+            av_frame_free(&msg.frame);
+            if (ret == AVERROR_EOF)
+                ret = 0; /* ignore */
+            if (ret < 0)
+                av_log(NULL, AV_LOG_ERROR,
+                       "Failed to inject frame into filter network: %s\n", av_err2str(ret));
+        } else {
+            ret = ifilter_send_eof(msg.ifilter, msg.eof_pts);
+        }
+        if (ret >= 0)
+            ret = reap_filtergraph(fg, 0);
+        if (ret < 0) {
+            /* leave the error for the main loop, which joins the thread */
+            fg->thread_ret = ret;
+            av_thread_message_queue_set_err_send(fg->queue, ret);
+        }
+        pthread_mutex_unlock(&fg->lock);
+        signal_progress();
+
+        if (ret < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+static void free_filtergraph_msg(void *msg)
+{
+    av_frame_free(&((FilterGraphMsg *)msg)->frame);
+}
+
+/* stop the thread of fg and return the error which stopped the graph */
+static int free_filtergraph_thread(FilterGraph *fg)
+{
+    if (fg->queue) {
+        av_thread_message_queue_set_err_recv(fg->queue, AVERROR_EOF);
+        pthread_join(fg->thread, NULL);
+        av_thread_message_queue_free(&fg->queue);
+        pthread_mutex_destroy(&fg->lock);
+    }
+    return fg->thread_ret;
+}
+
+static int free_filtergraph_threads(void)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        if (fg && free_filtergraph_thread(fg) < 0)
+            ret = fg->thread_ret;
+    }
+
+    return ret;
+}
+
+/*
+ * Check whether a filtergraph has failed, either in its thread or when
+ * reaped by the main thread. The failed thread is joined before the error
+ * is returned, so that the main thread alone decides how to terminate.
+ */
+static int check_filtergraph_threads(void)
+{
+    int i, ret;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        if (!fg->queue)
+            continue;
+        pthread_mutex_lock(&fg->lock);
+        ret = fg->thread_ret;
+        pthread_mutex_unlock(&fg->lock);
+        if (ret < 0)
+            return free_filtergraph_thread(fg);
+    }
+
+    return 0;
+}
+
+static int init_filtergraph_thread(FilterGraph *fg)
+{
+    int i, ret;
+
+    /* sub2video pushes frames into the graph from the main thread */
+    for (i = 0; i < fg->nb_inputs; i++)
+        if (fg->inputs[i]->type == AVMEDIA_TYPE_SUBTITLE)
+            return 0;
+
+    ret = av_thread_message_queue_alloc(&fg->queue, 8, sizeof(FilterGraphMsg));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(fg->queue, free_filtergraph_msg);
+
+    if ((ret = pthread_mutex_init(&fg->lock, NULL))) {
+        av_thread_message_queue_free(&fg->queue);
+        return AVERROR(ret);
+    }
+
+    if ((ret = pthread_create(&fg->thread, NULL, filtergraph_thread, fg))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        pthread_mutex_destroy(&fg->lock);
+        av_thread_message_queue_free(&fg->queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+static int init_filtergraph_threads(void)
+{
+    int i, ret;
+
+    if (!filtergraph_threads)
+        return 0;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        ret = init_filtergraph_thread(filtergraphs[i]);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+#endif
+
+/* send a frame to a filtergraph input, the frame is consumed */
+static int ifilter_submit_frame(InputFilter *ifilter, AVFrame *frame)
+{
+#if HAVE_THREADS
+    if (ifilter->graph->queue) {
+        FilterGraphMsg msg = { ifilter };
+        int ret;
+
+        msg.frame = av_frame_alloc();
+        if (!msg.frame)
+            return AVERROR(ENOMEM);
+        av_frame_move_ref(msg.frame, frame);
+
+        ret = queue_send(ifilter->graph->queue, &msg, 0, "filter_queue_send");
+        if (ret < 0)
+            av_frame_free(&msg.frame);
+        return ret;
+    }
+#endif
+    return ifilter_send_frame(ifilter, frame);
+}
+
+static int ifilter_submit_eof(InputFilter *ifilter, int64_t pts)
+{
+#if HAVE_THREADS
+    if (ifilter->graph->queue) {
+        FilterGraphMsg msg = { ifilter, NULL, pts };
+        return queue_send(ifilter->graph->queue, &msg, 0, "filter_queue_send");
+    }
+#endif
+    return ifilter_send_eof(ifilter, pts);
+}
+
+// This does not quite work like avcodec_decode_audio4/avcodec_decode_video2.
+// There is the following difference: if you got a frame, you must call
+// it again with pkt=NULL. pkt==NULL is treated differently from pkt->size==0
+// (pkt==NULL means get more output, pkt->size==0 is a flush/drain packet)
+#if HAVE_THREADS
+typedef struct DecodedFrameMsg {
+    AVFrame *frame;
+    int      ret;   /* return value of avcodec_receive_frame() */
+} DecodedFrameMsg;
+
+/*
+ * Every packet is answered with the frames it produced, followed by a
+ * message carrying the error which stopped avcodec_receive_frame(). This
+ * lets the main thread block on the frame queue alone without deadlocking.
+ */
+static void *decoder_thread(void *arg)
+{
+    InputStream *ist = arg;
+    StageTimer timer;
+    AVPacket pkt;
+    int ret;
+
+    while (queue_recv(ist->dec_pkt_queue, &pkt, 0, "dec_pkt_queue_recv") >= 0) {
+        int flush = !pkt.data && !pkt.side_data_elems;
+        DecodedFrameMsg msg = { NULL, 0 };
+
+        stage_start(&timer);
+        ret = avcodec_send_packet(ist->dec_ctx, &pkt);
+        stage_end(&ist->decode_stats, &timer);
+        av_packet_unref(&pkt);
+        if (ret < 0 && ret != AVERROR_EOF && !flush) {
+            msg.ret = ret;
+            if (queue_send(ist->dec_frame_queue, &msg, 0, "dec_frame_queue_send") < 0)
+                break;
+            continue;
+        }
+
+        do {
+            msg.frame = av_frame_alloc();
+            if (!msg.frame) {
+                msg.ret = AVERROR(ENOMEM);
+            } else {
+                stage_start(&timer);
+                msg.ret = avcodec_receive_frame(ist->dec_ctx, msg.frame);
+                stage_end(&ist->decode_stats, &timer);
+                if (msg.ret < 0)
+                    av_frame_free(&msg.frame);
+            }
+            if (queue_send(ist->dec_frame_queue, &msg, 0, "dec_frame_queue_send") < 0) {
+                av_frame_free(&msg.frame);
+                return NULL;
+            }
+        } while (msg.ret >= 0);
+    }
+
+    return NULL;
+}
+
+static int decode_mt(InputStream *ist, AVFrame *frame, int *got_frame, AVPacket *pkt)
+{
+    DecodedFrameMsg msg;
+    int ret;
+
+    if (ist->dec_eof)
+        return AVERROR_EOF;
+
+    if (pkt && !ist->dec_draining) {
+        av_assert0(!ist->dec_pkt_pending);
+        if (!pkt->data && !pkt->side_data_elems) {
+            av_init_packet(&ist->dec_pkt);
+            ist->dec_pkt.data = NULL;
+            ist->dec_pkt.size = 0;
+            ist->dec_draining = 1;
+        } else if ((ret = av_packet_ref(&ist->dec_pkt, pkt)) < 0) {
+            return ret;
+        }
+        ist->dec_pkt_pending = 1;
+    }
+
+    while (1) {
+        if (ist->dec_pkt_pending) {
+            ret = av_thread_message_queue_send(ist->dec_pkt_queue, &ist->dec_pkt,
+                                               AV_THREAD_MESSAGE_NONBLOCK);
+            if (ret >= 0) {
+                ist->dec_pkt_pending = 0;
+            } else if (ret != AVERROR(EAGAIN)) {
+                av_packet_unref(&ist->dec_pkt);
+                ist->dec_pkt_pending = 0;
+                return ret;
+            }
+        }
+
+        /* only wait for the decoder if it holds something we need */
+        ret = queue_recv(ist->dec_frame_queue, &msg,
+                         ist->dec_pkt_pending || ist->dec_draining ?
+                         0 : AV_THREAD_MESSAGE_NONBLOCK, "dec_frame_queue_recv");
+        if (ret == AVERROR(EAGAIN))
+            return 0;
+        if (ret < 0)
+            return ret;
+
+        if (msg.frame) {
+            av_frame_move_ref(frame, msg.frame);
+            av_frame_free(&msg.frame);
+            *got_frame = 1;
+            return 0;
+        }
+        if (msg.ret == AVERROR(EAGAIN))
+            continue;
+        if (msg.ret == AVERROR_EOF)
+            ist->dec_eof = 1;
+        return msg.ret;
+    }
+}
+
+static void free_decoded_frame_msg(void *msg)
+{
+    av_frame_free(&((DecodedFrameMsg *)msg)->frame);
+}
+
+static void free_queued_packet(void *msg)
+{
+    av_packet_unref(msg);
+}
+
+static void free_decoder_thread(InputStream *ist)
+{
+    if (!ist || !ist->dec_pkt_queue)
+        return;
+    av_thread_message_queue_set_err_recv(ist->dec_pkt_queue, AVERROR_EOF);
+    av_thread_message_queue_set_err_send(ist->dec_frame_queue, AVERROR_EOF);
+    pthread_join(ist->dec_thread, NULL);
+    av_thread_message_queue_free(&ist->dec_pkt_queue);
+    av_thread_message_queue_free(&ist->dec_frame_queue);
+    if (ist->dec_pkt_pending)
+        av_packet_unref(&ist->dec_pkt);
+    ist->dec_pkt_pending = 0;
+}
+
+static void free_decoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++)
+        free_decoder_thread(input_streams[i]);
+}
+
+static int init_decoder_thread(InputStream *ist)
+{
+    int queue_size = input_files[ist->file_index]->thread_queue_size;
+    int ret;
+
+    if (!dec_threads_per_input ||
+        (ist->dec_ctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+         ist->dec_ctx->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+
+    ret = av_thread_message_queue_alloc(&ist->dec_pkt_queue, queue_size,
+                                        sizeof(AVPacket));
+    if (ret < 0)
+        return ret;
+    ret = av_thread_message_queue_alloc(&ist->dec_frame_queue, queue_size,
+                                        sizeof(DecodedFrameMsg));
+    if (ret < 0) {
+        av_thread_message_queue_free(&ist->dec_pkt_queue);
+        return ret;
+    }
+    av_thread_message_queue_set_free_func(ist->dec_pkt_queue, free_queued_packet);
+    av_thread_message_queue_set_free_func(ist->dec_frame_queue, free_decoded_frame_msg);
+    ist->dec_next_dts = AV_NOPTS_VALUE;
+
+    if ((ret = pthread_create(&ist->dec_thread, NULL, decoder_thread, ist))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&ist->dec_pkt_queue);
+        av_thread_message_queue_free(&ist->dec_frame_queue);
+        return AVERROR(ret);
     }
 
     return 0;
 }
+#endif
 
-// This does not quite work like avcodec_decode_audio4/avcodec_decode_video2.
-// There is the following difference: if you got a frame, you must call
-// it again with pkt=NULL. pkt==NULL is treated differently from pkt->size==0
-// (pkt==NULL means get more output, pkt->size==0 is a flush/drain packet)
 static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
 {
+    InputStream *ist = avctx->opaque;
+    StageTimer timer;
     int ret;
 
     *got_frame = 0;
 
+#if HAVE_THREADS
+    if (ist->dec_pkt_queue)
+        return decode_mt(ist, frame, got_frame, pkt);
+#endif
+
     if (pkt) {
+        stage_start(&timer);
         ret = avcodec_send_packet(avctx, pkt);
+        stage_end(&ist->decode_stats, &timer);
         // In particular, we don't expect AVERROR(EAGAIN), because we read all
         // decoded frames with avcodec_receive_frame() until done.
         if (ret < 0 && ret != AVERROR_EOF)
             return ret;
     }
 
+    stage_start(&timer);
     ret = avcodec_receive_frame(avctx, frame);
+    stage_end(&ist->decode_stats, &timer);
     if (ret < 0 && ret != AVERROR(EAGAIN))
         return ret;
     if (ret >= 0)
@@ -2258,7 +3176,7 @@ static int send_frame_to_filters(InputStream *ist, AVFrame *decoded_frame)
                 break;
         } else
             f = decoded_frame;
-        ret = ifilter_send_frame(ist->filters[i], f);
+        ret = ifilter_submit_frame(ist->filters[i], f);
         if (ret == AVERROR_EOF)
             ret = 0; /* ignore */
         if (ret < 0) {
@@ -2284,9 +3202,15 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
         return AVERROR(ENOMEM);
     decoded_frame = ist->decoded_frame;
 
-    update_benchmark(NULL);
+#if HAVE_THREADS
+    /* nothing was decoded yet, so ist->dts still is the first packet's */
+    if (ist->dec_pkt_queue && ist->dec_next_dts == AV_NOPTS_VALUE)
+        ist->dec_next_dts = ist->dts;
+#endif
+
+    update_benchmark(&current_time, NULL);
     ret = decode(avctx, decoded_frame, got_output, pkt);
-    update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
+    update_benchmark(&current_time, "decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
@@ -2313,6 +3237,18 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
 
     if (decoded_frame->pts != AV_NOPTS_VALUE) {
         decoded_frame_tb   = ist->st->time_base;
+#if HAVE_THREADS
+    } else if (ist->dec_pkt_queue) {
+        /* pkt and ist->dts may be later than the packet of this frame, only
+         * use its own dts or continue from the previous frame */
+        if (decoded_frame->pkt_dts != AV_NOPTS_VALUE) {
+            decoded_frame->pts = decoded_frame->pkt_dts;
+            decoded_frame_tb   = ist->st->time_base;
+        } else {
+            decoded_frame->pts = ist->dec_next_dts;
+            decoded_frame_tb   = AV_TIME_BASE_Q;
+        }
+#endif
     } else if (pkt && pkt->pts != AV_NOPTS_VALUE) {
         decoded_frame->pts = pkt->pts;
         decoded_frame_tb   = ist->st->time_base;
@@ -2320,6 +3256,12 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
         decoded_frame->pts = ist->dts;
         decoded_frame_tb   = AV_TIME_BASE_Q;
     }
+#if HAVE_THREADS
+    if (ist->dec_pkt_queue && decoded_frame->pts != AV_NOPTS_VALUE)
+        ist->dec_next_dts = av_rescale_q(decoded_frame->pts, decoded_frame_tb, AV_TIME_BASE_Q) +
+                            ((int64_t)AV_TIME_BASE * decoded_frame->nb_samples) /
+                            avctx->sample_rate;
+#endif
     if (decoded_frame->pts != AV_NOPTS_VALUE)
         decoded_frame->pts = av_rescale_delta(decoded_frame_tb, decoded_frame->pts,
                                               (AVRational){1, avctx->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
@@ -2369,9 +3311,9 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
         ist->dts_buffer[ist->nb_dts_buffer++] = dts;
     }
 
-    update_benchmark(NULL);
+    update_benchmark(&current_time, NULL);
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
-    update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
+    update_benchmark(&current_time, "decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
@@ -2550,7 +3492,7 @@ static int send_filter_eof(InputStream *ist)
                                    AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
 
     for (i = 0; i < ist->nb_filters; i++) {
-        ret = ifilter_send_eof(ist->filters[i], pts);
+        ret = ifilter_submit_eof(ist->filters[i], pts);
         if (ret < 0)
             return ret;
     }
@@ -2740,7 +3682,7 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
     return !eof_reached;
 }
 
-static void print_sdp(void)
+static int print_sdp(void)
 {
     char sdp[16384];
     int i;
@@ -2750,12 +3692,12 @@ static void print_sdp(void)
 
     for (i = 0; i < nb_output_files; i++) {
         if (!output_files[i]->header_written)
-            return;
+            return 0;
     }
 
     avc = av_malloc_array(nb_output_files, sizeof(*avc));
     if (!avc)
-        exit_program(1);
+        return AVERROR(ENOMEM);
     for (i = 0, j = 0; i < nb_output_files; i++) {
         if (!strcmp(output_files[i]->ctx->oformat->name, "rtp")) {
             avc[j] = output_files[i]->ctx;
@@ -2783,6 +3725,7 @@ static void print_sdp(void)
 
 fail:
     av_freep(&avc);
+    return 0;
 }
 
 static enum AVPixelFormat get_format(AVCodecContext *s, const enum AVPixelFormat *pix_fmts)
@@ -2819,6 +3762,8 @@ static enum AVPixelFormat get_format(AVCodecContext *s, const enum AVPixelFormat
             }
 
             ret = hwaccel_decode_init(s);
+            if (ret >= 0)
+                ret = hw_frames_setup_for_decode(ist, s, *p);
             if (ret < 0) {
                 if (ist->hwaccel_id == HWACCEL_GENERIC) {
                     av_log(NULL, AV_LOG_FATAL,
@@ -2881,6 +3826,42 @@ static int get_buffer(AVCodecContext *s, AVFrame *frame, int flags)
     return avcodec_default_get_buffer2(s, frame, flags);
 }
 
+/* Use the decoder kept by avformat_find_stream_info() instead of opening a
+ * second one, if it was opened the same way. */
+static void take_probe_decoder(InputStream *ist)
+{
+    AVCodecContext *dec = av_stream_take_probe_decoder(ist->st);
+    AVDictionaryEntry *e = NULL;
+
+    if (!dec)
+        return;
+    if (dec->codec != ist->dec ||
+        dec->codec->capabilities & (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS) ||
+        dec->flags  != ist->dec_ctx->flags ||
+        dec->flags2 != ist->dec_ctx->flags2)
+        goto fail;
+    /* the other options were already applied when probing */
+    while ((e = av_dict_get(ist->decoder_opts, "", e, AV_DICT_IGNORE_SUFFIX)))
+        if (strcmp(e->key, "threads") && strcmp(e->key, "sub_text_format"))
+            goto fail;
+
+    dec->opaque                = ist->dec_ctx->opaque;
+    dec->get_format            = ist->dec_ctx->get_format;
+    dec->get_buffer2           = ist->dec_ctx->get_buffer2;
+    dec->thread_safe_callbacks = ist->dec_ctx->thread_safe_callbacks;
+    dec->pkt_timebase          = ist->dec_ctx->pkt_timebase;
+    av_opt_set_int(dec, "refcounted_frames", 1, 0);
+
+    avcodec_free_context(&ist->dec_ctx);
+    ist->dec_ctx = dec;
+    av_dict_free(&ist->decoder_opts);
+    av_log(NULL, AV_LOG_DEBUG, "Reusing the probe decoder for input stream #%d:%d\n",
+           ist->file_index, ist->st->index);
+    return;
+fail:
+    avcodec_free_context(&dec);
+}
+
 static int init_input_stream(int ist_index, char *error, int error_len)
 {
     int ret;
@@ -2927,7 +3908,11 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
 
-        if ((ret = avcodec_open2(ist->dec_ctx, codec, &ist->decoder_opts)) < 0) {
+        if (ist->dec_ctx->codec_type == AVMEDIA_TYPE_AUDIO)
+            take_probe_decoder(ist);
+
+        if (!avcodec_is_open(ist->dec_ctx) &&
+            (ret = avcodec_open2(ist->dec_ctx, codec, &ist->decoder_opts)) < 0) {
             if (ret == AVERROR_EXPERIMENTAL)
                 abort_codec_experimental(codec, 0);
 
@@ -2938,6 +3923,15 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
         assert_avoptions(ist->decoder_opts);
+
+#if HAVE_THREADS
+        ret = init_decoder_thread(ist);
+        if (ret < 0) {
+            snprintf(error, error_len, "Could not start the decoder thread "
+                     "for input stream #%d:%d", ist->file_index, ist->st->index);
+            return ret;
+        }
+#endif
     }
 
     ist->next_pts = AV_NOPTS_VALUE;
@@ -2971,8 +3965,17 @@ static int check_init_output_file(OutputFile *of, int file_index)
 
     of->ctx->interrupt_callback = int_cb;
 
+    mux_lock(of);
+
+    /* streams may be initialized from several filtergraph threads */
+    if (of->header_written) {
+        mux_unlock(of);
+        return 0;
+    }
+
     ret = avformat_write_header(of->ctx, &of->opts);
     if (ret < 0) {
+        mux_unlock(of);
         av_log(NULL, AV_LOG_ERROR,
                "Could not write header for output file #%d "
                "(incorrect codec parameters ?): %s\n",
@@ -2984,8 +3987,10 @@ static int check_init_output_file(OutputFile *of, int file_index)
 
     av_dump_format(of->ctx, file_index, of->ctx->url, 1);
 
-    if (sdp_filename || want_sdp)
-        print_sdp();
+    if ((sdp_filename || want_sdp) && (ret = print_sdp()) < 0) {
+        mux_unlock(of);
+        return ret;
+    }
 
     /* flush the muxing queues */
     for (i = 0; i < of->ctx->nb_streams; i++) {
@@ -2998,10 +4003,16 @@ static int check_init_output_file(OutputFile *of, int file_index)
         while (av_fifo_size(ost->muxing_queue)) {
             AVPacket pkt;
             av_fifo_generic_read(ost->muxing_queue, &pkt, sizeof(pkt), NULL);
-            write_packet(of, &pkt, ost, 1);
+            ret = write_packet(of, &pkt, ost, 1);
+            if (ret < 0) {
+                mux_unlock(of);
+                return ret;
+            }
         }
     }
 
+    mux_unlock(of);
+
     return 0;
 }
 
@@ -3155,7 +4166,7 @@ static int init_output_stream_streamcopy(OutputStream *ost)
     return 0;
 }
 
-static void set_encoder_id(OutputFile *of, OutputStream *ost)
+static int set_encoder_id(OutputFile *of, OutputStream *ost)
 {
     AVDictionaryEntry *e;
 
@@ -3165,42 +4176,42 @@ static void set_encoder_id(OutputFile *of, OutputStream *ost)
     int codec_flags = ost->enc_ctx->flags;
 
     if (av_dict_get(ost->st->metadata, "encoder",  NULL, 0))
-        return;
+        return 0;
 
     e = av_dict_get(of->opts, "fflags", NULL, 0);
     if (e) {
         const AVOption *o = av_opt_find(of->ctx, "fflags", NULL, 0, 0);
         if (!o)
-            return;
+            return 0;
         av_opt_eval_flags(of->ctx, o, e->value, &format_flags);
     }
     e = av_dict_get(ost->encoder_opts, "flags", NULL, 0);
     if (e) {
         const AVOption *o = av_opt_find(ost->enc_ctx, "flags", NULL, 0, 0);
         if (!o)
-            return;
+            return 0;
         av_opt_eval_flags(ost->enc_ctx, o, e->value, &codec_flags);
     }
 
     encoder_string_len = sizeof(LIBAVCODEC_IDENT) + strlen(ost->enc->name) + 2;
     encoder_string     = av_mallocz(encoder_string_len);
     if (!encoder_string)
-        exit_program(1);
+        return AVERROR(ENOMEM);
 
     if (!(format_flags & AVFMT_FLAG_BITEXACT) && !(codec_flags & AV_CODEC_FLAG_BITEXACT))
         av_strlcpy(encoder_string, LIBAVCODEC_IDENT " ", encoder_string_len);
     else
         av_strlcpy(encoder_string, "Lavc ", encoder_string_len);
     av_strlcat(encoder_string, ost->enc->name, encoder_string_len);
-    av_dict_set(&ost->st->metadata, "encoder",  encoder_string,
-                AV_DICT_DONT_STRDUP_VAL | AV_DICT_DONT_OVERWRITE);
+    return av_dict_set(&ost->st->metadata, "encoder",  encoder_string,
+                       AV_DICT_DONT_STRDUP_VAL | AV_DICT_DONT_OVERWRITE);
 }
 
-static void parse_forced_key_frames(char *kf, OutputStream *ost,
-                                    AVCodecContext *avctx)
+static int parse_forced_key_frames(char *kf, OutputStream *ost,
+                                   AVCodecContext *avctx)
 {
     char *p;
-    int n = 1, i, size, index = 0;
+    int n = 1, i, size, index = 0, ret;
     int64_t t, *pts;
 
     for (p = kf; *p; p++)
@@ -3210,7 +4221,7 @@ static void parse_forced_key_frames(char *kf, OutputStream *ost,
     pts = av_malloc_array(size, sizeof(*pts));
     if (!pts) {
         av_log(NULL, AV_LOG_FATAL, "Could not allocate forced key frames array.\n");
-        exit_program(1);
+        return AVERROR(ENOMEM);
     }
 
     p = kf;
@@ -3230,9 +4241,11 @@ static void parse_forced_key_frames(char *kf, OutputStream *ost,
                                      sizeof(*pts)))) {
                 av_log(NULL, AV_LOG_FATAL,
                        "Could not allocate forced key frames array.\n");
-                exit_program(1);
+                return AVERROR(ENOMEM);
             }
-            t = p[8] ? parse_time_or_die("force_key_frames", p + 8, 1) : 0;
+            t = 0;
+            if (p[8] && (ret = av_parse_time(&t, p + 8, 1)) < 0)
+                goto fail;
             t = av_rescale_q(t, AV_TIME_BASE_Q, avctx->time_base);
 
             for (j = 0; j < avf->nb_chapters; j++) {
@@ -3244,7 +4257,8 @@ static void parse_forced_key_frames(char *kf, OutputStream *ost,
 
         } else {
 
-            t = parse_time_or_die("force_key_frames", p, 1);
+            if ((ret = av_parse_time(&t, p, 1)) < 0)
+                goto fail;
             av_assert1(index < size);
             pts[index++] = av_rescale_q(t, AV_TIME_BASE_Q, avctx->time_base);
 
@@ -3257,6 +4271,11 @@ static void parse_forced_key_frames(char *kf, OutputStream *ost,
     qsort(pts, size, sizeof(*pts), compare_int64);
     ost->forced_kf_count = size;
     ost->forced_kf_pts   = pts;
+    return 0;
+fail:
+    av_log(NULL, AV_LOG_FATAL, "Invalid duration specification for force_key_frames: %s\n", p);
+    av_free(pts);
+    return ret;
 }
 
 static void init_encoder_time_base(OutputStream *ost, AVRational default_time_base)
@@ -3291,7 +4310,9 @@ static int init_output_stream_encode(OutputStream *ost)
     AVFormatContext *oc = output_files[ost->file_index]->ctx;
     int j, ret;
 
-    set_encoder_id(output_files[ost->file_index], ost);
+    ret = set_encoder_id(output_files[ost->file_index], ost);
+    if (ret < 0)
+        return ret;
 
     // Muxers use AV_PKT_DATA_DISPLAYMATRIX to signal rotation. On the other
     // hand, the legacy API makes demuxers set "rotate" metadata entries,
@@ -3418,7 +4439,9 @@ static int init_output_stream_encode(OutputStream *ost)
                 // Don't parse the 'forced_keyframes' in case of 'keep-source-keyframes',
                 // parse it only for static kf timings
             } else if(strncmp(ost->forced_keyframes, "source", 6)) {
-                parse_forced_key_frames(ost->forced_keyframes, ost, ost->enc_ctx);
+                ret = parse_forced_key_frames(ost->forced_keyframes, ost, ost->enc_ctx);
+                if (ret < 0)
+                    return ret;
             }
         }
         break;
@@ -3448,6 +4471,7 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
     if (ost->encoding_needed) {
         AVCodec      *codec = ost->enc;
         AVCodecContext *dec = NULL;
+        AVDictionaryEntry *e;
         InputStream *ist;
 
         ret = init_output_stream_encode(ost);
@@ -3506,8 +4530,12 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
         }
 
         if ((ret = avcodec_open2(ost->enc_ctx, codec, &ost->encoder_opts)) < 0) {
-            if (ret == AVERROR_EXPERIMENTAL)
-                abort_codec_experimental(codec, 1);
+            if (ret == AVERROR_EXPERIMENTAL) {
+                snprintf(error, error_len, "Experimental encoder '%s' was not "
+                         "enabled for output stream #%d:%d",
+                         codec->name, ost->file_index, ost->index);
+                return ret;
+            }
             snprintf(error, error_len,
                      "Error while opening encoder for output stream #%d:%d - "
                      "maybe incorrect parameters such as bit_rate, rate, width or height",
@@ -3518,7 +4546,11 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
             !(ost->enc->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
             av_buffersink_set_frame_size(ost->filter->filter,
                                             ost->enc_ctx->frame_size);
-        assert_avoptions(ost->encoder_opts);
+        /* not assert_avoptions(), this may run in a filtergraph thread */
+        if ((e = av_dict_get(ost->encoder_opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+            snprintf(error, error_len, "Option %s not found", e->key);
+            return AVERROR_OPTION_NOT_FOUND;
+        }
         if (ost->enc_ctx->bit_rate && ost->enc_ctx->bit_rate < 1000 &&
             ost->enc_ctx->codec_id != AV_CODEC_ID_CODEC2 /* don't complain about 700 bit/s modes */)
             av_log(NULL, AV_LOG_WARNING, "The bitrate parameter is set too low."
@@ -3526,9 +4558,9 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
 
         ret = avcodec_parameters_from_context(ost->st->codecpar, ost->enc_ctx);
         if (ret < 0) {
-            av_log(NULL, AV_LOG_FATAL,
-                   "Error initializing the output stream codec context.\n");
-            exit_program(1);
+            snprintf(error, error_len,
+                     "Error initializing the output stream codec context");
+            return ret;
         }
         /*
          * FIXME: ost->st->codec should't be needed here anymore.
@@ -3582,6 +4614,15 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
             ost->st->duration = av_rescale_q(ist->st->duration, ist->st->time_base, ost->st->time_base);
 
         ost->st->codec->codec= ost->enc_ctx->codec;
+
+#if HAVE_THREADS
+        ret = init_encoder_thread(ost);
+        if (ret < 0) {
+            snprintf(error, error_len, "Could not start the encoder thread "
+                     "for output stream #%d:%d", ost->file_index, ost->index);
+            return ret;
+        }
+#endif
     } else if (ost->stream_copy) {
         ret = init_output_stream_streamcopy(ost);
         if (ret < 0)
@@ -3834,11 +4875,18 @@ static int need_output(void)
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
+        int64_t size;
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (atomic_load(&ost->finished))
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+        if (os->pb) {
+            mux_lock(of);
+            size = avio_tell(os->pb);
+            mux_unlock(of);
+            if (size >= of->limit_filesize)
+                continue;
+        }
+        if (atomic_load(&ost->frame_number) >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3856,31 +4904,85 @@ static int need_output(void)
  *
  * @return  selected output stream, or NULL if none available
  */
+/*
+ * Streams not initialized yet come first, in order, then the others by
+ * increasing dts. As the keys only grow, the heap is only reordered lazily
+ * when the stream on top turns out to have moved on.
+ */
+static void update_sched_key(OutputStream *ost)
+{
+    ost->sched_class = ost->initialized || ost->inputs_done;
+    ost->sched_dts   = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
+                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+                                    AV_TIME_BASE_Q);
+    if (ost->st->cur_dts == AV_NOPTS_VALUE)
+        av_log(NULL, AV_LOG_DEBUG,
+            "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
+            ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, atomic_load(&ost->finished));
+    if (!ost->sched_class)
+        ost->sched_dts = 0;
+}
+
+static int sched_before(const OutputStream *a, const OutputStream *b)
+{
+    if (a->sched_class != b->sched_class)
+        return a->sched_class < b->sched_class;
+    if (a->sched_dts != b->sched_dts)
+        return a->sched_dts < b->sched_dts;
+    if (a->file_index != b->file_index)
+        return a->file_index < b->file_index;
+    return a->index < b->index;
+}
+
+static void output_heap_sift_down(int i)
+{
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= nb_output_heap)
+            break;
+        if (child + 1 < nb_output_heap &&
+            sched_before(output_heap[child + 1], output_heap[child]))
+            child++;
+        if (!sched_before(output_heap[child], output_heap[i]))
+            break;
+        FFSWAP(OutputStream *, output_heap[i], output_heap[child]);
+        i = child;
+    }
+}
+
 static OutputStream *choose_output(void)
 {
     int i;
-    int64_t opts_min = INT64_MAX;
-    OutputStream *ost_min = NULL;
 
-    for (i = 0; i < nb_output_streams; i++) {
-        OutputStream *ost = output_streams[i];
-        int64_t opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
-                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
-                                    AV_TIME_BASE_Q);
-        if (ost->st->cur_dts == AV_NOPTS_VALUE)
-            av_log(NULL, AV_LOG_DEBUG,
-                "cur_dts is invalid st:%d (%d) [init:%d i_done:%d finish:%d] (this is harmless if it occurs once at the start per stream)\n",
-                ost->st->index, ost->st->id, ost->initialized, ost->inputs_done, ost->finished);
+    if (!output_heap) {
+        output_heap = av_malloc_array(nb_output_streams, sizeof(*output_heap));
+        if (!output_heap)
+            exit_program(1);
+        for (i = 0; i < nb_output_streams; i++) {
+            update_sched_key(output_streams[i]);
+            output_heap[nb_output_heap++] = output_streams[i];
+        }
+        for (i = nb_output_heap / 2 - 1; i >= 0; i--)
+            output_heap_sift_down(i);
+    }
 
-        if (!ost->initialized && !ost->inputs_done)
+    while (nb_output_heap) {
+        OutputStream *ost = output_heap[0];
+        int     sched_class = ost->sched_class;
+        int64_t sched_dts   = ost->sched_dts;
+
+        update_sched_key(ost);
+        if (!ost->sched_class)
             return ost;
 
-        if (!ost->finished && opts < opts_min) {
-            opts_min = opts;
-            ost_min  = ost->unavailable ? NULL : ost;
+        if (atomic_load(&ost->finished)) {
+            output_heap[0] = output_heap[--nb_output_heap];
+        } else if (ost->sched_class == sched_class && ost->sched_dts == sched_dts) {
+            return ost->unavailable ? NULL : ost;
         }
+        output_heap_sift_down(0);
     }
-    return ost_min;
+    return NULL;
 }
 
 static void set_tty_echo(int on)
@@ -3940,6 +5042,10 @@ static int check_keyboard_interaction(int64_t cur_time)
                    target, time, command, arg);
             for (i = 0; i < nb_filtergraphs; i++) {
                 FilterGraph *fg = filtergraphs[i];
+#if HAVE_THREADS
+                if (fg->queue)
+                    pthread_mutex_lock(&fg->lock);
+#endif
                 if (fg->graph) {
                     if (time < 0) {
                         ret = avfilter_graph_send_command(fg->graph, target, command, arg, buf, sizeof(buf),
@@ -3954,6 +5060,10 @@ static int check_keyboard_interaction(int64_t cur_time)
                             fprintf(stderr, "Queuing command failed with error %s\n", av_err2str(ret));
                     }
                 }
+#if HAVE_THREADS
+                if (fg->queue)
+                    pthread_mutex_unlock(&fg->lock);
+#endif
             }
         } else {
             av_log(NULL, AV_LOG_ERROR,
@@ -4020,8 +5130,12 @@ static void *input_thread(void *arg)
     int ret = 0;
 
     while (1) {
+        StageTimer timer;
         AVPacket pkt;
+
+        stage_start(&timer);
         ret = av_read_frame(f->ctx, &pkt);
+        stage_end(&f->demux_stats, &timer);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -4029,12 +5143,13 @@ static void *input_thread(void *arg)
         }
         if (ret < 0) {
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
+            signal_progress();
             break;
         }
-        ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
+        ret = queue_send(f->in_thread_queue, &pkt, flags, "input_queue_send");
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
-            ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
+            ret = queue_send(f->in_thread_queue, &pkt, flags, "input_queue_send");
             av_log(f->ctx, AV_LOG_WARNING,
                    "Thread message queue blocking; consider raising the "
                    "thread_queue_size option (current value: %d)\n",
@@ -4047,8 +5162,10 @@ static void *input_thread(void *arg)
                        av_err2str(ret));
             av_packet_unref(&pkt);
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
+            signal_progress();
             break;
         }
+        signal_progress();
     }
 
     return NULL;
@@ -4089,8 +5206,9 @@ static int init_input_thread(int i)
     if (f->ctx->pb ? !f->ctx->pb->seekable :
         strcmp(f->ctx->iformat->name, "lavfi"))
         f->non_blocking = 1;
-    ret = av_thread_message_queue_alloc(&f->in_thread_queue,
-                                        f->thread_queue_size, sizeof(AVPacket));
+    ret = av_thread_message_queue_alloc2(&f->in_thread_queue,
+                                         f->thread_queue_size, sizeof(AVPacket),
+                                         AV_THREAD_MESSAGE_QUEUE_SPSC);
     if (ret < 0)
         return ret;
 
@@ -4117,48 +5235,136 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 {
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    return queue_recv(f->in_thread_queue, pkt,
+                      f->non_blocking ? AV_THREAD_MESSAGE_NONBLOCK : 0,
+                      "input_queue_recv");
 }
 #endif
 
-static int get_input_packet(InputFile *f, AVPacket *pkt)
+/**
+ * Check whether the next packet of a -re input may be read.
+ *
+ * A stream is due when its dts is reached by the wallclock, minus the
+ * allowed lead. Once a packet is due, the following ones due within the
+ * burst duration are read with it, so the input is woken up at most once
+ * per burst. An input that fell behind catches up at most at the catch-up
+ * speed instead of as fast as possible.
+ *
+ * @return 1 if the packet can be read now, 0 if the input is ahead and
+ *         f->rate_emu_wake was set to the time the packet is due
+ */
+static int rate_emu_ready(InputFile *f)
 {
-    if (f->rate_emu) {
-        int i;
-        for (i = 0; i < f->nb_streams; i++) {
-            InputStream *ist = input_streams[f->ist_index + i];
-            int64_t pts = av_rescale(ist->dts, 1000000, AV_TIME_BASE);
-            int64_t now = av_gettime_relative() - ist->start;
-            if (pts > now)
-                return AVERROR(EAGAIN);
-        }
+    int64_t now = av_gettime_relative();
+    int64_t due = INT64_MIN, max_dts = INT64_MIN;
+    int i;
+
+    for (i = 0; i < f->nb_streams; i++) {
+        InputStream *ist = input_streams[f->ist_index + i];
+        int64_t dts = av_rescale(ist->dts, 1000000, AV_TIME_BASE);
+        int64_t t;
+
+        max_dts = FFMAX(max_dts, dts);
+        t = ist->start + dts - f->rate_emu_lead;
+        if (f->rate_emu_catchup > 0 && f->rate_emu_wall != AV_NOPTS_VALUE)
+            t = FFMAX(t, f->rate_emu_wall + (int64_t)((dts - f->rate_emu_dts) / f->rate_emu_catchup));
+        due = FFMAX(due, t);
+    }
+
+    if (due > now + f->rate_emu_burst) {
+        f->rate_emu_wake = due;
+        return 0;
     }
 
+    f->rate_emu_wake = AV_NOPTS_VALUE;
+    f->rate_emu_wall = now;
+    f->rate_emu_dts  = max_dts;
+    return 1;
+}
+
+static int get_input_packet(InputFile *f, AVPacket *pkt)
+{
+    StageTimer timer;
+    int ret;
+
+    if (f->rate_emu && !rate_emu_ready(f))
+        return AVERROR(EAGAIN);
+
 #if HAVE_THREADS
     if (nb_input_files > 1)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    stage_start(&timer);
+    ret = av_read_frame(f->ctx, pkt);
+    stage_end(&f->demux_stats, &timer);
+    return ret;
+}
+
+static void set_input_eagain(InputFile *f)
+{
+    nb_eagain_inputs += !f->eagain;
+    f->eagain = 1;
+}
+
+static void set_output_unavailable(OutputStream *ost)
+{
+    nb_unavailable_outputs += !ost->unavailable;
+    ost->unavailable = 1;
 }
 
 static int got_eagain(void)
 {
+    return nb_unavailable_outputs > 0;
+}
+
+/**
+ * Return how long to wait for progress when no output can be processed:
+ * until the earliest packet of a -re input is due, at most 10 ms.
+ */
+static int64_t eagain_timeout(void)
+{
+    int64_t timeout = 10000, now = av_gettime_relative();
     int i;
-    for (i = 0; i < nb_output_streams; i++)
-        if (output_streams[i]->unavailable)
-            return 1;
-    return 0;
+
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        if (f->eagain && f->rate_emu && f->rate_emu_wake != AV_NOPTS_VALUE)
+            timeout = FFMIN(timeout, FFMAX(f->rate_emu_wake - now, 0));
+    }
+    return timeout;
 }
 
 static void reset_eagain(void)
 {
     int i;
-    for (i = 0; i < nb_input_files; i++)
-        input_files[i]->eagain = 0;
-    for (i = 0; i < nb_output_streams; i++)
-        output_streams[i]->unavailable = 0;
+    if (nb_eagain_inputs)
+        for (i = 0; i < nb_input_files; i++)
+            input_files[i]->eagain = 0;
+    if (nb_unavailable_outputs)
+        for (i = 0; i < nb_output_streams; i++)
+            output_streams[i]->unavailable = 0;
+    nb_eagain_inputs = nb_unavailable_outputs = 0;
+}
+
+/**
+ * Wait until an input or filtergraph thread made progress, or at most
+ * timeout microseconds for the inputs which are polled.
+ */
+static void wait_for_progress(int64_t timeout)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&progress_lock);
+    if (progress_count == progress_seen) {
+        int64_t t = av_gettime() + timeout;
+        struct timespec ts = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        pthread_cond_timedwait(&progress_cond, &progress_lock, &ts);
+    }
+    progress_seen = progress_count;
+    pthread_mutex_unlock(&progress_lock);
+#else
+    av_usleep(timeout);
+#endif
 }
 
 // set duration to max(tmp, duration) in a proper time base and return duration's time_base
@@ -4260,7 +5466,7 @@ static int process_input(int file_index)
     ret = get_input_packet(ifile, &pkt);
 
     if (ret == AVERROR(EAGAIN)) {
-        ifile->eagain = 1;
+        set_input_eagain(ifile);
         return ret;
     }
     if (ret < 0 && ifile->loop) {
@@ -4272,7 +5478,11 @@ static int process_input(int file_index)
                 ret = process_input_packet(ist, NULL, 1);
                 if (ret>0)
                     return 0;
+                /* a decoder thread is idle once it has returned EOF */
                 avcodec_flush_buffers(avctx);
+#if HAVE_THREADS
+                ist->dec_draining = ist->dec_eof = 0;
+#endif
             }
         }
 #if HAVE_THREADS
@@ -4289,7 +5499,7 @@ static int process_input(int file_index)
         else
             ret = get_input_packet(ifile, &pkt);
         if (ret == AVERROR(EAGAIN)) {
-            ifile->eagain = 1;
+            set_input_eagain(ifile);
             return ret;
         }
     }
@@ -4525,13 +5735,26 @@ discard_packet:
  */
 static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 {
+    StageTimer timer;
     int i, ret;
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
 
     *best_ist = NULL;
+    stage_start(&timer);
     ret = avfilter_graph_request_oldest(graph->graph);
+    stage_end(&graph->filter_stats, &timer);
+#if HAVE_THREADS
+    if (graph->queue && ret >= 0)
+        return reap_filtergraph(graph, 0);
+    if (graph->queue && ret == AVERROR_EOF) {
+        ret = reap_filtergraph(graph, 1);
+        for (i = 0; i < graph->nb_outputs; i++)
+            close_output_stream(graph->outputs[i]->ost);
+        return ret;
+    }
+#endif
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4559,11 +5782,83 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 
     if (!*best_ist)
         for (i = 0; i < graph->nb_outputs; i++)
-            graph->outputs[i]->ost->unavailable = 1;
+            set_output_unavailable(graph->outputs[i]->ost);
 
     return 0;
 }
 
+#if HAVE_THREADS
+/*
+ * Pick the input to read for an output fed by a filtergraph running in its
+ * own thread. The graph is only inspected if its thread is idle, otherwise
+ * the input lagging behind is read to keep the thread busy.
+ */
+static int transcode_from_threaded_filter(OutputStream *ost, InputStream **best_ist)
+{
+    FilterGraph *fg = ost->filter->graph;
+    int64_t min_dts = INT64_MAX;
+    int i, ret = 0;
+
+    *best_ist = NULL;
+
+    if (pthread_mutex_trylock(&fg->lock)) {
+        for (i = 0; i < fg->nb_inputs; i++) {
+            InputStream *ist = fg->inputs[i]->ist;
+            if (input_files[ist->file_index]->eagain ||
+                input_files[ist->file_index]->eof_reached)
+                continue;
+            if (!*best_ist || ist->dts < min_dts) {
+                min_dts   = ist->dts;
+                *best_ist = ist;
+            }
+        }
+        if (!*best_ist)
+            set_output_unavailable(ost);
+        return 0;
+    }
+
+    if (!fg->graph && ifilter_has_all_input_formats(fg)) {
+        ret = configure_filtergraph(fg);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error reinitializing filters!\n");
+            goto end;
+        }
+    }
+
+    if (fg->graph) {
+        if (!ost->initialized) {
+            char error[1024] = {0};
+            ret = init_output_stream(ost, error, sizeof(error));
+            if (ret < 0) {
+                av_log(NULL, AV_LOG_ERROR, "Error initializing output stream %d:%d -- %s\n",
+                       ost->file_index, ost->index, error);
+                exit_program(1);
+            }
+        }
+        ret = transcode_from_filter(fg, best_ist);
+        if (ret < 0) {
+            /* fail the graph as if its thread had hit the error */
+            fg->thread_ret = ret;
+            av_thread_message_queue_set_err_send(fg->queue, ret);
+        }
+    } else {
+        for (i = 0; i < fg->nb_inputs; i++) {
+            InputFilter *ifilter = fg->inputs[i];
+            if (!ifilter->ist->got_output && !input_files[ifilter->ist->file_index]->eof_reached) {
+                *best_ist = ifilter->ist;
+                break;
+            }
+        }
+        if (!*best_ist)
+            ost->inputs_done = 1;
+    }
+
+end:
+    pthread_mutex_unlock(&fg->lock);
+    return ret;
+}
+#endif
+
 /**
  * Run a single step of transcoding.
  *
@@ -4578,14 +5873,25 @@ static int transcode_step(void)
     ost = choose_output();
     if (!ost) {
         if (got_eagain()) {
+            int64_t timeout = eagain_timeout();
             reset_eagain();
-            av_usleep(10000);
+            wait_for_progress(timeout);
             return 0;
         }
         av_log(NULL, AV_LOG_VERBOSE, "No more inputs to read from, finishing.\n");
         return AVERROR_EOF;
     }
 
+#if HAVE_THREADS
+    if (ost->filter && ost->filter->graph->queue) {
+        if ((ret = transcode_from_threaded_filter(ost, &ist)) < 0)
+            return ret;
+        if (!ist)
+            return 0;
+        /* the graph belongs to its thread, only feed it more input */
+        goto read_input;
+    } else
+#endif
     if (ost->filter && !ost->filter->graph->graph) {
         if (ifilter_has_all_input_formats(ost->filter->graph)) {
             ret = configure_filtergraph(ost->filter->graph);
@@ -4628,10 +5934,13 @@ static int transcode_step(void)
         ist = input_streams[ost->source_index];
     }
 
+#if HAVE_THREADS
+read_input:
+#endif
     ret = process_input(ist->file_index);
     if (ret == AVERROR(EAGAIN)) {
         if (input_files[ist->file_index]->eagain)
-            ost->unavailable = 1;
+            set_output_unavailable(ost);
         return 0;
     }
 
@@ -4664,12 +5973,19 @@ static int transcode(void)
     timer_start = av_gettime_relative();
 
 #if HAVE_THREADS
+    if ((ret = init_progress()) < 0)
+        goto fail;
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_filtergraph_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
         int64_t cur_time= av_gettime_relative();
+#if HAVE_THREADS
+        int err;
+#endif
 
         /* if 'q' pressed, exits */
         if (stdin_interaction)
@@ -4683,6 +5999,18 @@ static int transcode(void)
         }
 
         ret = transcode_step();
+#if HAVE_THREADS
+        if ((err = check_filtergraph_threads()) < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error while filtering: %s\n", av_err2str(err));
+            ret = err;
+            goto fail;
+        }
+        if ((err = check_encoder_threads()) < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error while encoding: %s\n", av_err2str(err));
+            ret = err;
+            goto fail;
+        }
+#endif
         if (ret < 0 && ret != AVERROR_EOF) {
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
             break;
@@ -4702,6 +6030,13 @@ static int transcode(void)
             process_input_packet(ist, NULL, 0);
         }
     }
+#if HAVE_THREADS
+    free_decoder_threads();
+    if (free_filtergraph_threads() < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Error while filtering\n");
+        exit_program(1);
+    }
+#endif
     flush_encoders();
 
     term_exit();
@@ -4759,6 +6094,10 @@ static int transcode(void)
  fail:
 #if HAVE_THREADS
     free_input_threads();
+    free_decoder_threads();
+    free_filtergraph_threads();
+    free_encoder_threads();
+    free_progress();
 #endif
 
     if (output_streams) {
@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -71,10 +72,21 @@ typedef struct HWAccel {
     enum AVPixelFormat pix_fmt;
 } HWAccel;
 
+typedef struct HWSharedFrames {
+    AVBufferRef *frames_ref;
+    int nb_users;
+} HWSharedFrames;
+
 typedef struct HWDevice {
     const char *name;
     enum AVHWDeviceType type;
     AVBufferRef *device_ref;
+
+    // Decoder frames pools which are shared between input streams.
+    HWSharedFrames *shared_frames;
+    int          nb_shared_frames;
+    // Number of surfaces preallocated in frames pools of this device.
+    int nb_surfaces;
 } HWDevice;
 
 /* select an input stream for an output stream */
@@ -118,6 +130,9 @@ typedef struct OptionsContext {
     int64_t input_ts_offset;
     int loop;
     int rate_emu;
+    int64_t rate_emu_lead;
+    int64_t rate_emu_burst;
+    float rate_emu_catchup;
     int accurate_seek;
     int thread_queue_size;
 
@@ -279,6 +294,17 @@ typedef struct OutputFilter {
     int *sample_rates;
 } OutputFilter;
 
+#define STAGE_HIST_SIZE 20
+
+/* timing of one processing stage, reported with -stats_json */
+typedef struct StageStats {
+    uint64_t nb_calls;
+    int64_t  real_usec;         /* wall clock time spent in the stage */
+    int64_t  cpu_usec;          /* CPU time of the calling thread */
+    int64_t  max_usec;          /* longest single call */
+    uint64_t hist[STAGE_HIST_SIZE]; /* calls by log2 of their wall time in us */
+} StageStats;
+
 typedef struct FilterGraph {
     int            index;
     const char    *graph_desc;
@@ -290,6 +316,15 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *queue;   /* frames sent to the filtergraph thread */
+    pthread_t thread;           /* thread running this filtergraph */
+    pthread_mutex_t lock;       /* held while the graph is used */
+    int thread_ret;             /* error which stopped the thread */
+#endif
+
+    StageStats filter_stats;
 } FilterGraph;
 
 typedef struct InputStream {
@@ -388,6 +423,22 @@ typedef struct InputStream {
     int nb_dts_buffer;
 
     int got_output;
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *dec_pkt_queue;   /* packets sent to the decoder thread */
+    AVThreadMessageQueue *dec_frame_queue; /* frames returned by the decoder thread */
+    pthread_t dec_thread;       /* thread decoding this stream */
+    AVPacket dec_pkt;           /* packet waiting for room in dec_pkt_queue */
+    int dec_pkt_pending;
+    int dec_draining;           /* a flush packet was sent to the decoder thread */
+    int dec_eof;                /* the decoder thread returned EOF */
+    /* end of the last audio frame returned by the decoder thread, in
+     * AV_TIME_BASE, used for the frames without timestamps. ist->dts has
+     * already moved on to the packets sent after the one they come from. */
+    int64_t dec_next_dts;
+#endif
+
+    StageStats decode_stats;
 } InputStream;
 
 typedef struct InputFile {
@@ -410,6 +461,12 @@ typedef struct InputFile {
                              from ctx.nb_streams if new streams appear during av_read_frame() */
     int nb_streams_warn;  /* number of streams that the user was warned of */
     int rate_emu;
+    int64_t rate_emu_lead;    /* how far reading may be ahead of realtime, in microseconds */
+    int64_t rate_emu_burst;   /* packets due within this duration are read together */
+    float rate_emu_catchup;   /* maximum speed when behind realtime, 0 for unlimited */
+    int64_t rate_emu_wall;    /* time the last packet was read at, or AV_NOPTS_VALUE */
+    int64_t rate_emu_dts;     /* largest stream dts when the last packet was read */
+    int64_t rate_emu_wake;    /* time the next packet is due, or AV_NOPTS_VALUE */
     int accurate_seek;
 
 #if HAVE_THREADS
@@ -419,6 +476,8 @@ typedef struct InputFile {
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
 #endif
+
+    StageStats demux_stats;
 } InputFile;
 
 enum forced_keyframes_const {
@@ -439,13 +498,19 @@ typedef enum {
     MUXER_FINISHED = 2,
 } OSTFinished ;
 
+typedef struct BenchmarkTimeStamps {
+    int64_t real_usec;
+    int64_t user_usec;
+    int64_t sys_usec;
+} BenchmarkTimeStamps;
+
 typedef struct OutputStream {
     int file_index;          /* file index */
     int index;               /* stream index in the output file */
     int source_index;        /* InputStream index */
     AVStream *st;            /* stream in the output file */
     int encoding_needed;     /* true if encoding needed for this stream */
-    int frame_number;
+    atomic_int frame_number;
     /* input pts and corresponding output pts
        for A/V sync */
     struct InputStream *sync_ist; /* input stream to sync against */
@@ -509,7 +574,7 @@ typedef struct OutputStream {
     AVDictionary *swr_opts;
     AVDictionary *resample_opts;
     char *apad;
-    OSTFinished finished;        /* no more packets should be written for this stream */
+    atomic_int finished;         /* OSTFinished flags, no more packets should be written for this stream */
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
 
@@ -520,6 +585,11 @@ typedef struct OutputStream {
 
     int inputs_done;
 
+    /* key of the stream in the scheduling heap of choose_output(), as of
+     * the last time it was looked at */
+    int     sched_class;
+    int64_t sched_dts;
+
     const char *attachment_filename;
     int copy_initial_nonkeyframes;
     int copy_prior_start;
@@ -527,7 +597,7 @@ typedef struct OutputStream {
 
     int keep_pix_fmt;
 
-    /* stats */
+    /* stats, written with the mux_lock of the output file held */
     // combined size of all the packets written
     uint64_t data_size;
     // number of packets send to the muxer
@@ -549,6 +619,18 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *enc_thread_queue;
+    pthread_t enc_thread;       /* thread encoding frames for this stream */
+    int enc_thread_ret;         /* error which stopped the thread, under mux_lock */
+#endif
+    BenchmarkTimeStamps enc_bench; /* last -benchmark_all time of the encoder */
+
+    StageStats encode_stats;
+    StageStats mux_stats;
+    uint64_t frames_dup;
+    uint64_t frames_drop;
 } OutputStream;
 
 typedef struct OutputFile {
@@ -562,6 +644,10 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_THREADS
+    pthread_mutex_t mux_lock;   /* serializes muxing between encoder threads */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -604,12 +690,21 @@ extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
+extern AVIOContext *stats_json_avio;
 extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
+extern int dec_threads_per_input;
+extern int filtergraph_threads;
+extern int filter_profile;
+extern int filter_audio_min_samples;
+extern int enc_threads_per_output;
+extern int enc_thread_queue_size;
+extern int hw_frames_share;
+extern int hw_device_surfaces;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -643,6 +738,7 @@ int configure_output_filter(FilterGraph *fg, OutputFilter *ofilter, AVFilterInOu
 void check_filter_outputs(void);
 int ist_in_filtergraph(FilterGraph *fg, InputStream *ist);
 int filtergraph_is_simple(FilterGraph *fg);
+void dump_filtergraph_profile(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
 
@@ -663,6 +759,9 @@ void hw_device_free_all(void);
 int hw_device_setup_for_decode(InputStream *ist);
 int hw_device_setup_for_encode(OutputStream *ost);
 
+int hw_frames_setup_for_decode(InputStream *ist, AVCodecContext *avctx,
+                               enum AVPixelFormat hw_pix_fmt);
+
 int hwaccel_decode_init(AVCodecContext *avctx);
 
 #endif /* FFTOOLS_FFMPEG_H */
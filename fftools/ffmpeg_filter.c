@@ -112,10 +112,15 @@ void choose_sample_fmt(AVStream *st, AVCodec *codec)
     }
 }
 
-static char *choose_pix_fmts(OutputFilter *ofilter)
+/*
+ * Build the list of pixel formats the encoder of ofilter accepts, *out is
+ * set to NULL if there is no constraint.
+ */
+static int choose_pix_fmts(OutputFilter *ofilter, char **out)
 {
     OutputStream *ost = ofilter->ost;
     AVDictionaryEntry *strict_dict = av_dict_get(ost->encoder_opts, "strict", NULL, 0);
+    *out = NULL;
     if (strict_dict)
         // used by choose_pixel_fmt() and below
         av_opt_set(ost->enc_ctx, "strict", strict_dict->value, 0);
@@ -124,11 +129,10 @@ static char *choose_pix_fmts(OutputFilter *ofilter)
         avfilter_graph_set_auto_convert(ofilter->graph->graph,
                                             AVFILTER_AUTO_CONVERT_NONE);
         if (ost->enc_ctx->pix_fmt == AV_PIX_FMT_NONE)
-            return NULL;
-        return av_strdup(av_get_pix_fmt_name(ost->enc_ctx->pix_fmt));
-    }
-    if (ost->enc_ctx->pix_fmt != AV_PIX_FMT_NONE) {
-        return av_strdup(av_get_pix_fmt_name(choose_pixel_fmt(ost->st, ost->enc_ctx, ost->enc, ost->enc_ctx->pix_fmt)));
+            return 0;
+        *out = av_strdup(av_get_pix_fmt_name(ost->enc_ctx->pix_fmt));
+    } else if (ost->enc_ctx->pix_fmt != AV_PIX_FMT_NONE) {
+        *out = av_strdup(av_get_pix_fmt_name(choose_pixel_fmt(ost->st, ost->enc_ctx, ost->enc, ost->enc_ctx->pix_fmt)));
     } else if (ost->enc && ost->enc->pix_fmts) {
         const enum AVPixelFormat *p;
         AVIOContext *s = NULL;
@@ -136,7 +140,7 @@ static char *choose_pix_fmts(OutputFilter *ofilter)
         int len;
 
         if (avio_open_dyn_buf(&s) < 0)
-            exit_program(1);
+            return AVERROR(ENOMEM);
 
         p = ost->enc->pix_fmts;
         if (ost->enc_ctx->strict_std_compliance <= FF_COMPLIANCE_UNOFFICIAL) {
@@ -149,19 +153,22 @@ static char *choose_pix_fmts(OutputFilter *ofilter)
         }
         len = avio_close_dyn_buf(s, &ret);
         ret[len - 1] = 0;
-        return ret;
+        *out = ret;
     } else
-        return NULL;
+        return 0;
+
+    return *out ? 0 : AVERROR(ENOMEM);
 }
 
 /* Define a function for building a string containing a list of
  * allowed formats. */
 #define DEF_CHOOSE_FORMAT(suffix, type, var, supported_list, none, get_name)   \
-static char *choose_ ## suffix (OutputFilter *ofilter)                         \
+static int choose_ ## suffix (OutputFilter *ofilter, char **out)               \
 {                                                                              \
+    *out = NULL;                                                               \
     if (ofilter->var != none) {                                                \
         get_name(ofilter->var);                                                \
-        return av_strdup(name);                                                \
+        *out = av_strdup(name);                                                \
     } else if (ofilter->supported_list) {                                      \
         const type *p;                                                         \
         AVIOContext *s = NULL;                                                 \
@@ -169,7 +176,7 @@ static char *choose_ ## suffix (OutputFilter *ofilter)                         \
         int len;                                                               \
                                                                                \
         if (avio_open_dyn_buf(&s) < 0)                                         \
-            exit_program(1);                                                           \
+            return AVERROR(ENOMEM);                                            \
                                                                                \
         for (p = ofilter->supported_list; *p != none; p++) {                   \
             get_name(*p);                                                      \
@@ -177,9 +184,11 @@ static char *choose_ ## suffix (OutputFilter *ofilter)                         \
         }                                                                      \
         len = avio_close_dyn_buf(s, &ret);                                     \
         ret[len - 1] = 0;                                                      \
-        return ret;                                                            \
+        *out = ret;                                                            \
     } else                                                                     \
-        return NULL;                                                           \
+        return 0;                                                              \
+                                                                               \
+    return *out ? 0 : AVERROR(ENOMEM);                                         \
 }
 
 //DEF_CHOOSE_FORMAT(pix_fmts, enum AVPixelFormat, format, formats, AV_PIX_FMT_NONE,
@@ -494,7 +503,9 @@ static int configure_output_video_filter(FilterGraph *fg, OutputFilter *ofilter,
         pad_idx = 0;
     }
 
-    if ((pix_fmts = choose_pix_fmts(ofilter))) {
+    if ((ret = choose_pix_fmts(ofilter, &pix_fmts)) < 0)
+        return ret;
+    if (pix_fmts) {
         AVFilterContext *filter;
         snprintf(name, sizeof(name), "format_out_%d_%d",
                  ost->file_index, ost->index);
@@ -601,9 +612,17 @@ static int configure_output_audio_filter(FilterGraph *fg, OutputFilter *ofilter,
     if (codec->channels && !codec->channel_layout)
         codec->channel_layout = av_get_default_channel_layout(codec->channels);
 
-    sample_fmts     = choose_sample_fmts(ofilter);
-    sample_rates    = choose_sample_rates(ofilter);
-    channel_layouts = choose_channel_layouts(ofilter);
+    if ((ret = choose_sample_fmts(ofilter, &sample_fmts)) < 0)
+        return ret;
+    if ((ret = choose_sample_rates(ofilter, &sample_rates)) < 0) {
+        av_freep(&sample_fmts);
+        return ret;
+    }
+    if ((ret = choose_channel_layouts(ofilter, &channel_layouts)) < 0) {
+        av_freep(&sample_fmts);
+        av_freep(&sample_rates);
+        return ret;
+    }
     if (sample_fmts || sample_rates || channel_layouts) {
         AVFilterContext *format;
         char args[256];
@@ -677,7 +696,7 @@ int configure_output_filter(FilterGraph *fg, OutputFilter *ofilter, AVFilterInOu
 {
     if (!ofilter->ost) {
         av_log(NULL, AV_LOG_FATAL, "Filter %s has an unconnected output\n", ofilter->name);
-        exit_program(1);
+        return AVERROR(EINVAL);
     }
 
     switch (avfilter_pad_get_type(out->filter_ctx->output_pads, out->pad_idx)) {
@@ -991,9 +1010,23 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+void dump_filtergraph_profile(FilterGraph *fg)
+{
+    char *dump;
+
+    if (!fg->graph || !fg->graph->profile)
+        return;
+    dump = avfilter_graph_dump(fg->graph, "profile");
+    if (dump)
+        av_log(NULL, AV_LOG_INFO, "Filtergraph %d profile:\n%s", fg->index, dump);
+    av_free(dump);
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+
+    dump_filtergraph_profile(fg);
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -1011,6 +1044,8 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->profile = filter_profile;
+    fg->graph->audio_min_samples = filter_audio_min_samples;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -1102,7 +1137,10 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_inout_free(&inputs);
 
     for (cur = outputs, i = 0; cur; cur = cur->next, i++)
-        configure_output_filter(fg, fg->outputs[i], cur);
+        if ((ret = configure_output_filter(fg, fg->outputs[i], cur)) < 0) {
+            avfilter_inout_free(&outputs);
+            goto fail;
+        }
     avfilter_inout_free(&outputs);
 
     if ((ret = avfilter_graph_config(fg->graph, NULL)) < 0)
@@ -19,12 +19,17 @@
 #include <string.h>
 
 #include "libavutil/avstring.h"
+#include "libavutil/thread.h"
 
 #include "ffmpeg.h"
 
 static int nb_hw_devices;
 static HWDevice **hw_devices;
 
+// Protects the shared frames pools of all devices, since get_format()
+// may be called from several decoder threads at once.
+static AVMutex hw_frames_lock = AV_MUTEX_INITIALIZER;
+
 static HWDevice *hw_device_get_by_type(enum AVHWDeviceType type)
 {
     HWDevice *found = NULL;
@@ -271,8 +276,11 @@ fail:
 
 void hw_device_free_all(void)
 {
-    int i;
+    int i, j;
     for (i = 0; i < nb_hw_devices; i++) {
+        for (j = 0; j < hw_devices[i]->nb_shared_frames; j++)
+            av_buffer_unref(&hw_devices[i]->shared_frames[j].frames_ref);
+        av_freep(&hw_devices[i]->shared_frames);
         av_freep(&hw_devices[i]->name);
         av_buffer_unref(&hw_devices[i]->device_ref);
         av_freep(&hw_devices[i]);
@@ -480,3 +488,118 @@ int hwaccel_decode_init(AVCodecContext *avctx)
 
     return 0;
 }
+
+static HWDevice *hw_device_get_by_ref(const AVBufferRef *device_ref)
+{
+    int i;
+    for (i = 0; i < nb_hw_devices; i++) {
+        if (hw_devices[i]->device_ref->data == device_ref->data)
+            return hw_devices[i];
+    }
+    return NULL;
+}
+
+static int hw_frames_match(const AVHWFramesContext *a,
+                           const AVHWFramesContext *b)
+{
+    return a->format    == b->format    &&
+           a->sw_format == b->sw_format &&
+           a->width     == b->width     &&
+           a->height    == b->height;
+}
+
+static int hw_frames_get_shared(HWDevice *dev, AVBufferRef *params_ref,
+                                AVBufferRef **frames_ref)
+{
+    AVHWFramesContext *params = (AVHWFramesContext*)params_ref->data;
+    HWSharedFrames *shared;
+    int pool_size, i, err;
+
+    if (hw_frames_share > 0) {
+        for (i = 0; i < dev->nb_shared_frames; i++) {
+            shared = &dev->shared_frames[i];
+            if (shared->nb_users < hw_frames_share &&
+                hw_frames_match((AVHWFramesContext*)shared->frames_ref->data,
+                                params)) {
+                *frames_ref = av_buffer_ref(shared->frames_ref);
+                if (!*frames_ref)
+                    return AVERROR(ENOMEM);
+                shared->nb_users++;
+                return 0;
+            }
+        }
+
+        // A fixed-size pool has to hold the surfaces of all of the
+        // decoders which may end up using it.
+        params->initial_pool_size *= hw_frames_share;
+    }
+
+    pool_size = params->initial_pool_size;
+    if (hw_device_surfaces > 0 &&
+        dev->nb_surfaces + pool_size > hw_device_surfaces) {
+        av_log(NULL, AV_LOG_ERROR, "Allocating %d more surfaces on "
+               "device %s would exceed its budget of %d surfaces "
+               "(%d already in use).\n", pool_size, dev->name,
+               hw_device_surfaces, dev->nb_surfaces);
+        return AVERROR(ENOMEM);
+    }
+
+    err = av_hwframe_ctx_init(params_ref);
+    if (err < 0)
+        return err;
+
+    if (hw_frames_share > 0) {
+        err = av_reallocp_array(&dev->shared_frames, dev->nb_shared_frames + 1,
+                                sizeof(*dev->shared_frames));
+        if (err < 0) {
+            dev->nb_shared_frames = 0;
+            return err;
+        }
+        shared = &dev->shared_frames[dev->nb_shared_frames];
+        shared->frames_ref = av_buffer_ref(params_ref);
+        if (!shared->frames_ref)
+            return AVERROR(ENOMEM);
+        shared->nb_users = 1;
+        dev->nb_shared_frames++;
+    }
+
+    dev->nb_surfaces += pool_size;
+
+    *frames_ref = av_buffer_ref(params_ref);
+    if (!*frames_ref)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+int hw_frames_setup_for_decode(InputStream *ist, AVCodecContext *avctx,
+                               enum AVPixelFormat hw_pix_fmt)
+{
+    AVBufferRef *params_ref = NULL;
+    HWDevice *dev;
+    int err;
+
+    if (hw_frames_share <= 0 && hw_device_surfaces <= 0)
+        return 0;
+    if (!avctx->hw_device_ctx)
+        return 0;
+
+    dev = hw_device_get_by_ref(avctx->hw_device_ctx);
+    if (!dev)
+        return 0;
+
+    err = avcodec_get_hw_frames_parameters(avctx, avctx->hw_device_ctx,
+                                           hw_pix_fmt, &params_ref);
+    if (err < 0) {
+        // The decoder will have to allocate its frames itself.
+        return 0;
+    }
+
+    av_buffer_unref(&ist->hw_frames_ctx);
+
+    ff_mutex_lock(&hw_frames_lock);
+    err = hw_frames_get_shared(dev, params_ref, &ist->hw_frames_ctx);
+    ff_mutex_unlock(&hw_frames_lock);
+
+    av_buffer_unref(&params_ref);
+    return err;
+}
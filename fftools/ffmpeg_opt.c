@@ -41,6 +41,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/trace.h"
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
 
@@ -111,6 +112,14 @@ float max_error_rate  = 2.0/3;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
 int vstats_version = 2;
+int dec_threads_per_input = 0;
+int filtergraph_threads = 0;
+int filter_profile = 0;
+int filter_audio_min_samples = 0;
+int enc_threads_per_output = 0;
+int enc_thread_queue_size = 8;
+int hw_frames_share = 0;
+int hw_device_surfaces = 0;
 
 
 static int intra_only         = 0;
@@ -1092,7 +1101,7 @@ static int open_input_file(OptionsContext *o, const char *filename)
     ic->subtitle_codec_id  = subtitle_codec_name ? ic->subtitle_codec->id : AV_CODEC_ID_NONE;
     ic->data_codec_id      = data_codec_name     ? ic->data_codec->id     : AV_CODEC_ID_NONE;
 
-    ic->flags |= AVFMT_FLAG_NONBLOCK;
+    ic->flags |= AVFMT_FLAG_NONBLOCK | AVFMT_FLAG_KEEP_DECODERS;
     if (o->bitexact)
         ic->flags |= AVFMT_FLAG_BITEXACT;
     ic->interrupt_callback = int_cb;
@@ -1207,6 +1216,11 @@ static int open_input_file(OptionsContext *o, const char *filename)
     f->ts_offset  = o->input_ts_offset - (copy_ts ? (start_at_zero && ic->start_time != AV_NOPTS_VALUE ? ic->start_time : 0) : timestamp);
     f->nb_streams = ic->nb_streams;
     f->rate_emu   = o->rate_emu;
+    f->rate_emu_lead    = o->rate_emu_lead;
+    f->rate_emu_burst   = o->rate_emu_burst;
+    f->rate_emu_catchup = o->rate_emu_catchup;
+    f->rate_emu_wall    = AV_NOPTS_VALUE;
+    f->rate_emu_wake    = AV_NOPTS_VALUE;
     f->accurate_seek = o->accurate_seek;
     f->loop = o->loop;
     f->duration = 0;
@@ -1521,6 +1535,25 @@ static OutputStream *new_output_stream(OptionsContext *o, AVFormatContext *oc, e
         if (*bsfs)
             bsfs++;
     }
+    if (ost->nb_bitstream_filters > 1) {
+        /* run chains as a single list, so that libavcodec can share the
+         * parsing work between consecutive filters */
+        AVBSFList *bsf_list = av_bsf_list_alloc();
+        if (!bsf_list)
+            exit_program(1);
+        for (i = 0; i < ost->nb_bitstream_filters; i++) {
+            ret = av_bsf_list_append(bsf_list, ost->bsf_ctx[i]);
+            if (ret < 0)
+                exit_program(1);
+            ost->bsf_ctx[i] = NULL;
+        }
+        ret = av_bsf_list_finalize(&bsf_list, &ost->bsf_ctx[0]);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error allocating a bitstream filter list\n");
+            exit_program(1);
+        }
+        ost->nb_bitstream_filters = 1;
+    }
 
     MATCH_PER_STREAM_OPT(codec_tags, str, codec_tag, oc, st);
     if (codec_tag) {
@@ -1955,7 +1988,7 @@ static OutputStream *new_attachment_stream(OptionsContext *o, AVFormatContext *o
 {
     OutputStream *ost = new_output_stream(o, oc, AVMEDIA_TYPE_ATTACHMENT, source_index);
     ost->stream_copy = 1;
-    ost->finished    = 1;
+    atomic_store(&ost->finished, ENCODER_FINISHED);
     return ost;
 }
 
@@ -2137,6 +2170,10 @@ static int open_output_file(OptionsContext *o, const char *filename)
     if (!of)
         exit_program(1);
     output_files[nb_output_files - 1] = of;
+#if HAVE_THREADS
+    if (pthread_mutex_init(&of->mux_lock, NULL))
+        exit_program(1);
+#endif
 
     of->ost_index      = nb_output_streams;
     of->recording_time = o->recording_time;
@@ -3370,6 +3407,32 @@ static int opt_progress(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_trace_events(void *optctx, const char *opt, const char *arg)
+{
+    int ret = av_trace_start(arg);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Failed to start tracing: %s\n", av_err2str(ret));
+    return ret;
+}
+
+static int opt_stats_json(void *optctx, const char *opt, const char *arg)
+{
+    AVIOContext *avio = NULL;
+    int ret;
+
+    if (!strcmp(arg, "-"))
+        arg = "pipe:";
+    ret = avio_open2(&avio, arg, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open stats_json URL \"%s\": %s\n",
+               arg, av_err2str(ret));
+        return ret;
+    }
+    stats_json_avio = avio;
+    av_mem_accounting_enable(1);
+    return 0;
+}
+
 #define OFFSET(x) offsetof(OptionsContext, x)
 const OptionDef options[] = {
     /* main options */
@@ -3448,6 +3511,10 @@ const OptionDef options[] = {
       "add timings for each task" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
+    { "stats_json",     HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_stats_json },
+      "write per-stage timing statistics as JSON lines", "url" },
+    { "trace_events",   HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_trace_events },
+      "write trace events of the processing threads in Chrome trace format", "filename" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
       "enable or disable interaction on standard input" },
     { "timelimit",      HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_timelimit },
@@ -3459,6 +3526,15 @@ const OptionDef options[] = {
     { "re",             OPT_BOOL | OPT_EXPERT | OPT_OFFSET |
                         OPT_INPUT,                                   { .off = OFFSET(rate_emu) },
         "read input at native frame rate", "" },
+    { "re_lead",        HAS_ARG | OPT_TIME | OPT_EXPERT | OPT_OFFSET |
+                        OPT_INPUT,                                   { .off = OFFSET(rate_emu_lead) },
+        "with -re, read the input up to this far ahead of realtime", "duration" },
+    { "re_burst",       HAS_ARG | OPT_TIME | OPT_EXPERT | OPT_OFFSET |
+                        OPT_INPUT,                                   { .off = OFFSET(rate_emu_burst) },
+        "with -re, read the packets due within this duration together", "duration" },
+    { "re_catchup",     HAS_ARG | OPT_FLOAT | OPT_EXPERT | OPT_OFFSET |
+                        OPT_INPUT,                                   { .off = OFFSET(rate_emu_catchup) },
+        "with -re, limit the speed when behind realtime to this multiple of the native rate", "speed" },
     { "target",         HAS_ARG | OPT_PERFILE | OPT_OUTPUT,          { .func_arg = opt_target },
         "specify target file type (\"vcd\", \"svcd\", \"dvd\", \"dv\" or \"dv50\" "
         "with optional prefixes \"pal-\", \"ntsc-\" or \"film-\")", "type" },
@@ -3523,6 +3599,18 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "dec_threads_per_input", OPT_BOOL | OPT_EXPERT,                { &dec_threads_per_input },
+        "run the decoder of each input stream in its own thread" },
+    { "filtergraph_threads", OPT_BOOL | OPT_EXPERT,                  { &filtergraph_threads },
+        "run each filtergraph in its own thread" },
+    { "enc_threads_per_output", OPT_BOOL | OPT_EXPERT,               { &enc_threads_per_output },
+        "run the encoder of each output stream in its own thread" },
+    { "enc_thread_queue_size", HAS_ARG | OPT_INT | OPT_EXPERT,       { &enc_thread_queue_size },
+        "set the maximum number of frames queued for each encoder thread", "size" },
+    { "filter_profile", OPT_BOOL | OPT_EXPERT,                       { &filter_profile },
+        "print per-filter timing statistics" },
+    { "filter_audio_min_samples", HAS_ARG | OPT_INT | OPT_EXPERT,     { &filter_audio_min_samples },
+        "coalesce audio frames in filtergraphs to at least this many samples", "samples" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
@@ -3642,6 +3730,10 @@ const OptionDef options[] = {
     { "hwaccel_output_format", OPT_VIDEO | OPT_STRING | HAS_ARG | OPT_EXPERT |
                           OPT_SPEC | OPT_INPUT,                                  { .off = OFFSET(hwaccel_output_formats) },
         "select output format used with HW accelerated decoding", "format" },
+    { "hw_frames_share",  HAS_ARG | OPT_INT | OPT_EXPERT,                        { &hw_frames_share },
+        "share each HW decoder frames pool between up to this many streams", "count" },
+    { "hw_device_surfaces", HAS_ARG | OPT_INT | OPT_EXPERT,                      { &hw_device_surfaces },
+        "set the maximum number of surfaces preallocated on each HW device", "count" },
 #if CONFIG_VIDEOTOOLBOX
     { "videotoolbox_pixfmt", HAS_ARG | OPT_STRING | OPT_EXPERT, { &videotoolbox_pixfmt}, "" },
 #endif
@@ -93,6 +93,12 @@ const int program_birth_year = 2003;
 #define EXTERNAL_CLOCK_SPEED_MAX  1.010
 #define EXTERNAL_CLOCK_SPEED_STEP 0.001
 
+/* low latency mode: the external clock is sped up in proportion to the
+ * duration queued for decoding above the target, to catch up with the source */
+#define LOW_LATENCY_TARGET_DELAY 0.05
+#define LOW_LATENCY_SPEED_GAIN   0.2
+#define LOW_LATENCY_SPEED_MAX    1.1
+
 /* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
 #define AUDIO_DIFF_AVG_NB   20
 
@@ -129,6 +135,8 @@ typedef struct PacketQueue {
 #define VIDEO_PICTURE_QUEUE_SIZE 3
 #define SUBPICTURE_QUEUE_SIZE 16
 #define SAMPLE_QUEUE_SIZE 9
+/* the last shown frame and the next one */
+#define LOW_LATENCY_QUEUE_SIZE 2
 #define FRAME_QUEUE_SIZE FFMAX(SAMPLE_QUEUE_SIZE, FFMAX(VIDEO_PICTURE_QUEUE_SIZE, SUBPICTURE_QUEUE_SIZE))
 
 typedef struct AudioParams {
@@ -332,6 +340,7 @@ static int64_t start_time = AV_NOPTS_VALUE;
 static int64_t duration = AV_NOPTS_VALUE;
 static int fast = 0;
 static int genpts = 0;
+static int low_latency = 0;
 static int lowres = 0;
 static int decoder_reorder_pts = -1;
 static int autoexit;
@@ -1468,6 +1477,21 @@ static void check_external_clock_speed(VideoState *is) {
    }
 }
 
+static void check_low_latency_clock_speed(VideoState *is)
+{
+    double queued = 0, speed;
+
+    if (is->video_st)
+        queued = FFMAX(queued, is->videoq.duration * av_q2d(is->video_st->time_base));
+    if (is->audio_st)
+        queued = FFMAX(queued, is->audioq.duration * av_q2d(is->audio_st->time_base));
+
+    speed = 1.0 + (queued - LOW_LATENCY_TARGET_DELAY) * LOW_LATENCY_SPEED_GAIN;
+    speed = av_clipd(speed, 1.0, LOW_LATENCY_SPEED_MAX);
+    if (speed != is->extclk.speed)
+        set_clock_speed(&is->extclk, speed);
+}
+
 /* seek in the stream */
 static void stream_seek(VideoState *is, int64_t pos, int64_t rel, int seek_by_bytes)
 {
@@ -1578,8 +1602,12 @@ static void video_refresh(void *opaque, double *remaining_time)
 
     Frame *sp, *sp2;
 
-    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK && is->realtime)
-        check_external_clock_speed(is);
+    if (!is->paused && get_master_sync_type(is) == AV_SYNC_EXTERNAL_CLOCK) {
+        if (low_latency)
+            check_low_latency_clock_speed(is);
+        else if (is->realtime)
+            check_external_clock_speed(is);
+    }
 
     if (!display_disable && is->show_mode != SHOW_MODE_VIDEO && is->audio_st) {
         time = av_gettime_relative() / 1000000.0;
@@ -2511,7 +2539,8 @@ static int audio_open(void *opaque, int64_t wanted_channel_layout, int wanted_nb
         next_sample_rate_idx--;
     wanted_spec.format = AUDIO_S16SYS;
     wanted_spec.silence = 0;
-    wanted_spec.samples = FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(wanted_spec.freq / SDL_AUDIO_MAX_CALLBACKS_PER_SEC));
+    wanted_spec.samples = low_latency ? SDL_AUDIO_MIN_BUFFER_SIZE :
+                          FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(wanted_spec.freq / SDL_AUDIO_MAX_CALLBACKS_PER_SEC));
     wanted_spec.callback = sdl_audio_callback;
     wanted_spec.userdata = opaque;
     while (!(audio_dev = SDL_OpenAudioDevice(NULL, 0, &wanted_spec, &spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE))) {
@@ -2610,6 +2639,8 @@ static int stream_component_open(VideoState *is, int stream_index)
 
     if (fast)
         avctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    if (low_latency)
+        avctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
 
     opts = filter_codec_opts(codec_opts, avctx->codec_id, ic, ic->streams[stream_index], codec);
     if (!av_dict_get(opts, "threads", NULL, 0))
@@ -2795,6 +2826,8 @@ static int read_thread(void *arg)
 
     if (genpts)
         ic->flags |= AVFMT_FLAG_GENPTS;
+    if (low_latency)
+        ic->flags |= AVFMT_FLAG_NOBUFFER;
 
     av_format_inject_global_side_data(ic);
 
@@ -2913,7 +2946,7 @@ static int read_thread(void *arg)
         goto fail;
     }
 
-    if (infinite_buffer < 0 && is->realtime)
+    if (infinite_buffer < 0 && (is->realtime || low_latency))
         infinite_buffer = 1;
 
     for (;;) {
@@ -3076,11 +3109,13 @@ static VideoState *stream_open(const char *filename, AVInputFormat *iformat)
     is->xleft   = 0;
 
     /* start video display */
-    if (frame_queue_init(&is->pictq, &is->videoq, VIDEO_PICTURE_QUEUE_SIZE, 1) < 0)
+    if (frame_queue_init(&is->pictq, &is->videoq,
+                         low_latency ? LOW_LATENCY_QUEUE_SIZE : VIDEO_PICTURE_QUEUE_SIZE, 1) < 0)
         goto fail;
     if (frame_queue_init(&is->subpq, &is->subtitleq, SUBPICTURE_QUEUE_SIZE, 0) < 0)
         goto fail;
-    if (frame_queue_init(&is->sampq, &is->audioq, SAMPLE_QUEUE_SIZE, 1) < 0)
+    if (frame_queue_init(&is->sampq, &is->audioq,
+                         low_latency ? LOW_LATENCY_QUEUE_SIZE : SAMPLE_QUEUE_SIZE, 1) < 0)
         goto fail;
 
     if (packet_queue_init(&is->videoq) < 0 ||
@@ -3105,7 +3140,7 @@ static VideoState *stream_open(const char *filename, AVInputFormat *iformat)
     startup_volume = av_clip(SDL_MIX_MAXVOLUME * startup_volume / 100, 0, SDL_MIX_MAXVOLUME);
     is->audio_volume = startup_volume;
     is->muted = 0;
-    is->av_sync_type = av_sync_type;
+    is->av_sync_type = low_latency ? AV_SYNC_EXTERNAL_CLOCK : av_sync_type;
     is->read_tid     = SDL_CreateThread(read_thread, "read_thread", is);
     if (!is->read_tid) {
         av_log(NULL, AV_LOG_FATAL, "SDL_CreateThread(): %s\n", SDL_GetError());
@@ -3598,6 +3633,7 @@ static const OptionDef options[] = {
     { "loop", OPT_INT | HAS_ARG | OPT_EXPERT, { &loop }, "set number of times the playback shall be looped", "loop count" },
     { "framedrop", OPT_BOOL | OPT_EXPERT, { &framedrop }, "drop frames when cpu is too slow", "" },
     { "infbuf", OPT_BOOL | OPT_EXPERT, { &infinite_buffer }, "don't limit the input buffer size (useful with realtime streams)", "" },
+    { "lowlatency", OPT_BOOL | OPT_EXPERT, { &low_latency }, "minimize the display latency of live streams", "" },
     { "window_title", OPT_STRING | HAS_ARG, { &window_title }, "set window title", "window title" },
     { "left", OPT_INT | HAS_ARG | OPT_EXPERT, { &screen_left }, "set the x position for the left of the window", "x pos" },
     { "top", OPT_INT | HAS_ARG | OPT_EXPERT, { &screen_top }, "set the y position for the top of the window", "y pos" },
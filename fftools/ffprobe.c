@@ -44,6 +44,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/libm.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/threadmessage.h"
 #include "libavutil/timecode.h"
 #include "libavutil/timestamp.h"
 #include "libavdevice/avdevice.h"
@@ -84,6 +85,8 @@ const int program_birth_year = 2007;
 static int do_bitexact = 0;
 static int do_count_frames = 0;
 static int do_count_packets = 0;
+static int do_packets_from_index = 0;
+static int nb_shards = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
 static int do_show_chapters = 0;
@@ -2451,12 +2454,455 @@ end:
     return ret;
 }
 
-static int read_packets(WriterContext *w, InputFile *ifile)
+static void show_index_entry(WriterContext *w, InputFile *ifile, int stream_index,
+                             const AVIndexEntry *e)
+{
+    char val_str[128];
+    AVStream *st = ifile->streams[stream_index].st;
+    AVBPrint pbuf;
+    const char *s;
+
+    av_bprint_init(&pbuf, 1, AV_BPRINT_SIZE_UNLIMITED);
+
+    writer_print_section_header(w, SECTION_ID_PACKET);
+
+    s = av_get_media_type_string(st->codecpar->codec_type);
+    if (s) print_str    ("codec_type", s);
+    else   print_str_opt("codec_type", "unknown");
+    print_int("stream_index",     stream_index);
+    print_ts  ("dts",             e->timestamp);
+    print_time("dts_time",        e->timestamp, &st->time_base);
+    print_val("size",             e->size, unit_byte_str);
+    print_fmt("pos", "%"PRId64,   e->pos);
+    print_fmt("flags", "%c%c",    e->flags & AVINDEX_KEYFRAME      ? 'K' : '_',
+              e->flags & AVINDEX_DISCARD_FRAME ? 'D' : '_');
+    writer_print_section_footer(w);
+
+    av_bprint_finalize(&pbuf, NULL);
+}
+
+/*
+ * Show the packets listed in the demuxer index, in file order, without
+ * reading them. Returns AVERROR(ENOSYS) if a selected stream has no index.
+ */
+static int read_index_packets(WriterContext *w, InputFile *ifile)
+{
+    AVFormatContext *fmt_ctx = ifile->fmt_ctx;
+    int *next;
+    int i;
+
+    for (i = 0; i < fmt_ctx->nb_streams; i++) {
+        if (selected_streams[i] &&
+            !avformat_index_get_entries_count(fmt_ctx->streams[i])) {
+            av_log(NULL, AV_LOG_WARNING, "Stream #%d has no index, "
+                   "reading packets\n", i);
+            return AVERROR(ENOSYS);
+        }
+    }
+
+    next = av_mallocz_array(fmt_ctx->nb_streams, sizeof(*next));
+    if (!next)
+        return AVERROR(ENOMEM);
+
+    for (;;) {
+        const AVIndexEntry *e = NULL;
+        int stream_index = -1;
+
+        for (i = 0; i < fmt_ctx->nb_streams; i++) {
+            const AVIndexEntry *cur;
+            if (!selected_streams[i])
+                continue;
+            cur = avformat_index_get_entry(fmt_ctx->streams[i], next[i]);
+            if (cur && (!e || cur->pos < e->pos)) {
+                e = cur;
+                stream_index = i;
+            }
+        }
+        if (!e)
+            break;
+
+        if (do_show_packets)
+            show_index_entry(w, ifile, stream_index, e);
+        nb_streams_packets[stream_index]++;
+        next[stream_index]++;
+    }
+
+    av_free(next);
+    return 0;
+}
+
+#if HAVE_THREADS
+/* shards seek this long before their start, to a keyframe preceding the
+ * packets of all frames shown from the start on */
+#define SHARD_PREROLL    AV_TIME_BASE
+/* packets and frames queued by a shard before it waits for its output */
+#define SHARD_QUEUE_SIZE (1 << 16)
+
+static int open_input_file(InputFile *ifile, const char *filename,
+                           const char *print_filename);
+static void close_input_file(InputFile *ifile);
+
+typedef struct ShardItem {
+    int stream_index;
+    int is_frame;
+    AVPacket *pkt;      ///< packet to show, NULL if packets are only counted
+    AVFrame *frame;     ///< properties of the frame to show, NULL if
+                        ///< frames are only counted
+    AVSubtitle *sub;    ///< subtitle to show, NULL if counted
+} ShardItem;
+
+typedef struct ShardStream {
+    int packet_in_range;
+    int frame_in_range;
+    int done;
+} ShardStream;
+
+typedef struct Shard {
+    const char *filename;
+    int nb_streams;
+    int64_t start, end;   ///< range of the timestamps shown, in AV_TIME_BASE
+
+    InputFile ifile;
+    ShardStream *streams;
+    AVThreadMessageQueue *queue;
+    pthread_t thread;
+    int thread_started;
+} Shard;
+
+static void free_shard_item(void *arg)
+{
+    ShardItem *item = arg;
+
+    av_packet_free(&item->pkt);
+    av_frame_free(&item->frame);
+    if (item->sub)
+        avsubtitle_free(item->sub);
+    av_freep(&item->sub);
+}
+
+static int shard_send(Shard *s, ShardItem *item)
+{
+    int ret = av_thread_message_queue_send(s->queue, item, 0);
+    if (ret < 0)
+        free_shard_item(item);
+    return ret;
+}
+
+/* Timestamps in the shard range are shown, and so are the packets or frames
+ * without timestamp following them. */
+static int shard_in_range(Shard *s, int *in_range, int64_t ts, AVRational tb)
+{
+    if (ts != AV_NOPTS_VALUE) {
+        ts = av_rescale_q(ts, tb, AV_TIME_BASE_Q);
+        *in_range = ts >= s->start && ts < s->end;
+    }
+    return *in_range;
+}
+
+/* copy of the frame properties printed by show_frame(), without the data */
+static AVFrame *shard_frame_props(const AVFrame *src)
+{
+    AVFrame *dst = av_frame_alloc();
+
+    if (!dst)
+        return NULL;
+    dst->format         = src->format;
+    dst->width          = src->width;
+    dst->height         = src->height;
+    dst->nb_samples     = src->nb_samples;
+    dst->channels       = src->channels;
+    dst->channel_layout = src->channel_layout;
+    if (av_frame_copy_props(dst, src) < 0)
+        av_frame_free(&dst);
+    return dst;
+}
+
+/* Decode pkt, or flush the decoder if pkt is NULL, and queue the frames in
+ * the shard range. Decoding errors are skipped like in process_frame(). */
+static int shard_decode(Shard *s, int stream_index, AVPacket *pkt, AVFrame *frame)
+{
+    InputStream *ist = &s->ifile.streams[stream_index];
+    int *in_range = &s->streams[stream_index].frame_in_range;
+    ShardItem item = { .stream_index = stream_index, .is_frame = 1 };
+    int ret, got_frame = 0;
+
+    if (!ist->dec_ctx || !ist->dec_ctx->codec)
+        return 0;
+
+    switch (ist->st->codecpar->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+    case AVMEDIA_TYPE_AUDIO:
+        if (avcodec_send_packet(ist->dec_ctx, pkt) < 0)
+            return 0;
+        while (avcodec_receive_frame(ist->dec_ctx, frame) >= 0) {
+            ret = 0;
+            if (shard_in_range(s, in_range, frame->best_effort_timestamp,
+                               ist->st->time_base)) {
+                if (do_show_frames)
+                    item.frame = shard_frame_props(frame);
+                ret = do_show_frames && !item.frame ? AVERROR(ENOMEM) :
+                      shard_send(s, &item);
+            }
+            av_frame_unref(frame);
+            if (ret < 0)
+                return ret;
+        }
+        return 0;
+
+    case AVMEDIA_TYPE_SUBTITLE: {
+        AVSubtitle sub;
+
+        if (!pkt || avcodec_decode_subtitle2(ist->dec_ctx, &sub, &got_frame, pkt) < 0 ||
+            !got_frame)
+            return 0;
+        if (shard_in_range(s, in_range, sub.pts, AV_TIME_BASE_Q)) {
+            if (do_show_frames) {
+                item.sub = av_memdup(&sub, sizeof(sub));
+                if (!item.sub) {
+                    avsubtitle_free(&sub);
+                    return AVERROR(ENOMEM);
+                }
+            } else {
+                avsubtitle_free(&sub);
+            }
+            return shard_send(s, &item);
+        }
+        avsubtitle_free(&sub);
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+static int shard_read(Shard *s)
+{
+    AVFormatContext *fmt_ctx;
+    AVPacket pkt;
+    AVFrame *frame = NULL;
+    int i, ret, nb_selected = 0;
+
+    av_init_packet(&pkt);
+
+    ret = open_input_file(&s->ifile, s->filename, NULL);
+    if (ret < 0)
+        return ret;
+    fmt_ctx = s->ifile.fmt_ctx;
+    if (fmt_ctx->nb_streams != s->nb_streams) {
+        av_log(NULL, AV_LOG_ERROR, "Found different streams when opening "
+               "the input again for a shard\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->streams = av_mallocz_array(s->nb_streams, sizeof(*s->streams));
+    frame      = av_frame_alloc();
+    if (!s->streams || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < s->nb_streams; i++) {
+        if (selected_streams[i])
+            nb_selected++;
+        else
+            fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+        s->streams[i].packet_in_range =
+        s->streams[i].frame_in_range  = s->start == -INT64_MAX;
+    }
+
+    if (s->start != -INT64_MAX) {
+        int64_t target = s->start - SHARD_PREROLL;
+        ret = avformat_seek_file(fmt_ctx, -1, -INT64_MAX, target, target, 0);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Could not seek to shard start %s: %s\n",
+                   av_ts2timestr(s->start, &AV_TIME_BASE_Q), av_err2str(ret));
+            goto end;
+        }
+    }
+
+    ret = 0;
+    /* a stream is done with its first packet decoded after the shard end,
+     * as any frame shown before the end is decoded before it */
+    while (nb_selected && av_read_frame(fmt_ctx, &pkt) >= 0) {
+        int idx = pkt.stream_index;
+
+        if (idx < s->nb_streams && selected_streams[idx] && !s->streams[idx].done) {
+            AVRational tb = fmt_ctx->streams[idx]->time_base;
+            int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+
+            if (ts != AV_NOPTS_VALUE && av_rescale_q(ts, tb, AV_TIME_BASE_Q) >= s->end) {
+                s->streams[idx].done = 1;
+                nb_selected--;
+            } else {
+                if (do_read_packets &&
+                    shard_in_range(s, &s->streams[idx].packet_in_range, ts, tb)) {
+                    ShardItem item = { .stream_index = idx };
+                    if (do_show_packets)
+                        item.pkt = av_packet_clone(&pkt);
+                    ret = do_show_packets && !item.pkt ? AVERROR(ENOMEM) :
+                          shard_send(s, &item);
+                }
+                if (ret >= 0 && do_read_frames)
+                    ret = shard_decode(s, idx, &pkt, frame);
+            }
+        }
+        av_packet_unref(&pkt);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (i = 0; i < s->nb_streams && do_read_frames; i++) {
+        if (selected_streams[i]) {
+            ret = shard_decode(s, i, NULL, frame);
+            if (ret < 0)
+                goto end;
+        }
+    }
+
+end:
+    av_frame_free(&frame);
+    return ret;
+}
+
+static void *shard_thread(void *arg)
+{
+    Shard *s = arg;
+    int ret = shard_read(s);
+
+    av_thread_message_queue_set_err_recv(s->queue, ret < 0 ? ret : AVERROR_EOF);
+    return NULL;
+}
+
+static void show_shard_item(WriterContext *w, InputFile *ifile, ShardItem *item)
+{
+    AVStream *st = ifile->streams[item->stream_index].st;
+
+    if (item->is_frame) {
+        nb_streams_frames[item->stream_index]++;
+        if (item->frame)
+            show_frame(w, item->frame, st, ifile->fmt_ctx);
+        else if (item->sub)
+            show_subtitle(w, item->sub, st, ifile->fmt_ctx);
+    } else {
+        if (item->pkt)
+            show_packet(w, ifile, item->pkt, nb_streams_packets[item->stream_index]);
+        nb_streams_packets[item->stream_index]++;
+    }
+}
+
+/*
+ * Split the input in nb_shards time ranges read by separate threads, each
+ * with its own demuxer and decoders, and show their packets and frames in
+ * order. Returns AVERROR(ENOSYS) if the input cannot be split.
+ */
+static int read_shards(WriterContext *w, InputFile *ifile, const char *filename)
+{
+    AVFormatContext *fmt_ctx = ifile->fmt_ctx;
+    int64_t start = fmt_ctx->start_time != AV_NOPTS_VALUE ? fmt_ctx->start_time : 0;
+    int64_t duration = fmt_ctx->duration;
+    Shard *shards;
+    int i, ret = 0;
+
+    if (read_intervals_nb || do_show_log) {
+        av_log(NULL, AV_LOG_WARNING, "Read intervals and logs are not "
+               "supported with shards, reading sequentially\n");
+        return AVERROR(ENOSYS);
+    }
+    if (duration == AV_NOPTS_VALUE || duration <= 0 ||
+        (fmt_ctx->pb ? !(fmt_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL) :
+         !fmt_ctx->iformat->read_seek && !fmt_ctx->iformat->read_seek2)) {
+        av_log(NULL, AV_LOG_WARNING, "Input is not seekable or has no "
+               "duration, reading sequentially\n");
+        return AVERROR(ENOSYS);
+    }
+
+    shards = av_mallocz_array(nb_shards, sizeof(*shards));
+    if (!shards)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_shards; i++) {
+        Shard *s = &shards[i];
+
+        s->filename   = filename;
+        s->nb_streams = fmt_ctx->nb_streams;
+        s->start = i ? start + av_rescale(duration, i, nb_shards) : -INT64_MAX;
+        s->end   = i < nb_shards - 1 ?
+                   start + av_rescale(duration, i + 1, nb_shards) : INT64_MAX;
+
+        ret = av_thread_message_queue_alloc2(&s->queue, SHARD_QUEUE_SIZE,
+                                             sizeof(ShardItem),
+                                             AV_THREAD_MESSAGE_QUEUE_SPSC);
+        if (ret < 0)
+            goto end;
+        av_thread_message_queue_set_free_func(s->queue, free_shard_item);
+
+        ret = pthread_create(&s->thread, NULL, shard_thread, s);
+        if (ret) {
+            av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+            ret = AVERROR(ret);
+            goto end;
+        }
+        s->thread_started = 1;
+    }
+
+    for (i = 0; i < nb_shards; i++) {
+        ShardItem item;
+
+        av_log(NULL, AV_LOG_VERBOSE, "Showing shard %d\n", i);
+        while ((ret = av_thread_message_queue_recv(shards[i].queue, &item, 0)) >= 0) {
+            show_shard_item(w, ifile, &item);
+            free_shard_item(&item);
+        }
+        if (ret != AVERROR_EOF)
+            goto end;
+        ret = 0;
+    }
+
+end:
+    for (i = 0; i < nb_shards; i++) {
+        Shard *s = &shards[i];
+
+        if (s->thread_started) {
+            av_thread_message_queue_set_err_send(s->queue, AVERROR_EOF);
+            pthread_join(s->thread, NULL);
+        }
+        av_thread_message_flush(s->queue);
+        av_thread_message_queue_free(&s->queue);
+        if (s->ifile.fmt_ctx)
+            close_input_file(&s->ifile);
+        av_freep(&s->streams);
+    }
+    av_freep(&shards);
+    return ret;
+}
+#endif
+
+static int read_packets(WriterContext *w, InputFile *ifile, const char *filename)
 {
     AVFormatContext *fmt_ctx = ifile->fmt_ctx;
     int i, ret = 0;
     int64_t cur_ts = fmt_ctx->start_time;
 
+    if (do_packets_from_index) {
+        if (do_read_frames || read_intervals_nb) {
+            av_log(NULL, AV_LOG_WARNING, "Frames and read intervals need "
+                   "reading packets, ignoring -packets_from_index\n");
+        } else {
+            ret = read_index_packets(w, ifile);
+            if (ret != AVERROR(ENOSYS))
+                return ret;
+            ret = 0;
+        }
+    }
+
+#if HAVE_THREADS
+    if (nb_shards > 1) {
+        ret = read_shards(w, ifile, filename);
+        if (ret != AVERROR(ENOSYS))
+            return ret;
+        ret = 0;
+    }
+#endif
+
     if (read_intervals_nb == 0) {
         ReadInterval interval = (ReadInterval) { .has_start = 0, .has_end = 0 };
         ret = read_interval_packets(w, ifile, &interval, &cur_ts);
@@ -2842,6 +3288,7 @@ static int open_input_file(InputFile *ifile, const char *filename,
 {
     int err, i;
     AVFormatContext *fmt_ctx = NULL;
+    AVDictionary *opts = NULL;
     AVDictionaryEntry *t;
     int scan_all_pmts_set = 0;
 
@@ -2851,12 +3298,15 @@ static int open_input_file(InputFile *ifile, const char *filename,
         exit_program(1);
     }
 
-    if (!av_dict_get(format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
-        av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    /* work on a copy of the format options, as shards open the file again */
+    av_dict_copy(&opts, format_opts, 0);
+    if (!av_dict_get(opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
+        av_dict_set(&opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
     }
     if ((err = avformat_open_input(&fmt_ctx, filename,
-                                   iformat, &format_opts)) < 0) {
+                                   iformat, &opts)) < 0) {
+        av_dict_free(&opts);
         print_error(filename, err);
         return err;
     }
@@ -2866,11 +3316,14 @@ static int open_input_file(InputFile *ifile, const char *filename,
     }
     ifile->fmt_ctx = fmt_ctx;
     if (scan_all_pmts_set)
-        av_dict_set(&format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
-    if ((t = av_dict_get(format_opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        av_dict_set(&opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
+    t = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX);
+    if (t) {
         av_log(NULL, AV_LOG_ERROR, "Option %s not found.\n", t->key);
+        av_dict_free(&opts);
         return AVERROR_OPTION_NOT_FOUND;
     }
+    av_dict_free(&opts);
 
     if (find_stream_info) {
         AVDictionary **opts = setup_find_stream_info_opts(fmt_ctx, codec_opts);
@@ -2888,8 +3341,6 @@ static int open_input_file(InputFile *ifile, const char *filename,
         }
     }
 
-    av_dump_format(fmt_ctx, 0, filename, 0);
-
     ifile->streams = av_mallocz_array(fmt_ctx->nb_streams,
                                       sizeof(*ifile->streams));
     if (!ifile->streams)
@@ -2991,6 +3442,8 @@ static int probe_file(WriterContext *wctx, const char *filename,
     if (ret < 0)
         goto end;
 
+    av_dump_format(ifile.fmt_ctx, 0, filename, 0);
+
 #define CHECK_END if (ret < 0) goto end
 
     nb_streams = ifile.fmt_ctx->nb_streams;
@@ -3024,7 +3477,7 @@ static int probe_file(WriterContext *wctx, const char *filename,
             section_id = SECTION_ID_FRAMES;
         if (do_show_frames || do_show_packets)
             writer_print_section_header(wctx, section_id);
-        ret = read_packets(wctx, &ifile);
+        ret = read_packets(wctx, &ifile, filename);
         if (do_show_frames || do_show_packets)
             writer_print_section_footer(wctx);
         CHECK_END;
@@ -3547,6 +4000,8 @@ static const OptionDef real_options[] = {
     { "show_chapters", 0, { .func_arg = &opt_show_chapters }, "show chapters info" },
     { "count_frames", OPT_BOOL, {(void*)&do_count_frames}, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, {(void*)&do_count_packets}, "count the number of packets per stream" },
+    { "shards", OPT_INT | HAS_ARG, {(void*)&nb_shards}, "read and decode N time ranges of the input in parallel", "N" },
+    { "packets_from_index", OPT_BOOL, {(void*)&do_packets_from_index}, "show and count packets from the demuxer index, without reading them" },
     { "show_program_version",  0, { .func_arg = &opt_show_program_version },  "show ffprobe version" },
     { "show_library_versions", 0, { .func_arg = &opt_show_library_versions }, "show library versions" },
     { "show_versions",         0, { .func_arg = &opt_show_versions }, "show program and library versions" },
@@ -31,6 +31,7 @@
  * the following functions from aacenc_quantization/util.h. They're not included
  * explicitly here to make it possible to provide alternative implementations:
  *  - quantize_band_cost_bits
+ *  - quantize_band_cost_bits_pair
  *  - abs_pow34_v
  */
 
@@ -104,6 +105,7 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
         } else {
             float minbits = next_minbits;
             int mincb = next_mincb;
+            float next_bits = 0.0f;
             int startcb = sce->band_type[win*16+swb];
             startcb = aac_cb_in_map[startcb];
             next_minbits = INFINITY;
@@ -122,12 +124,28 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
                     path[swb+1][cb].run = 0;
                     continue;
                 }
-                for (w = 0; w < group_len; w++) {
-                    bits += quantize_band_cost_bits(s, &sce->coeffs[start + w*128],
-                                               &s->scoefs[start + w*128], size,
-                                               sce->sf_idx[win*16+swb],
-                                               aac_cb_out_map[cb],
-                                               0, INFINITY, NULL, NULL, 0);
+                if (cb & 1 && cb < ESC_BT) {
+                    /* the next codebook quantizes the same way, count
+                     * the bits for both at once */
+                    next_bits = 0.0f;
+                    for (w = 0; w < group_len; w++) {
+                        int b;
+                        bits += quantize_band_cost_bits_pair(s, &sce->coeffs[start + w*128],
+                                                             &s->scoefs[start + w*128], size,
+                                                             sce->sf_idx[win*16+swb],
+                                                             cb, &b, 0);
+                        next_bits += b;
+                    }
+                } else if (cb > startcb && cb < ESC_BT) {
+                    bits = next_bits;
+                } else {
+                    for (w = 0; w < group_len; w++) {
+                        bits += quantize_band_cost_bits(s, &sce->coeffs[start + w*128],
+                                                   &s->scoefs[start + w*128], size,
+                                                   sce->sf_idx[win*16+swb],
+                                                   aac_cb_out_map[cb],
+                                                   0, INFINITY, NULL, NULL, 0);
+                    }
                 }
                 cost_stay_here = path[swb][cb].cost + bits;
                 cost_get_here  = minbits            + bits + run_bits + 4;
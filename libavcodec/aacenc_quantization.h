@@ -256,20 +256,175 @@ static inline float quantize_band_cost(struct AACEncContext *s, const float *in,
                                          cb, lambda, uplim, bits, energy, rtz);
 }
 
+/**
+ * Calculate the number of bits needed to code a band with the given codebook,
+ * without reconstructing the quantized coefficients.
+ *
+ * @param next_bits if not NULL, set to the number of bits needed with the
+ *                  codebook cb + 1, which must quantize the same way
+ * @return the same number of bits as quantize_and_encode_band_cost_template()
+ */
+static av_always_inline int quantize_band_bits_template(
+                                struct AACEncContext *s, const float *in,
+                                const float *scaled, int size, int scale_idx,
+                                int cb, int *next_bits, int BT_ZERO, int BT_UNSIGNED,
+                                int BT_PAIR, int BT_ESC, int BT_NOISE, int BT_STEREO,
+                                const float ROUNDING)
+{
+    const int q_idx = POW_SF2_ZERO - scale_idx + SCALE_ONE_POS - SCALE_DIV_512;
+    const float Q   = ff_aac_pow2sf_tab [q_idx];
+    const float Q34 = ff_aac_pow34sf_tab[q_idx];
+    const float IQ  = ff_aac_pow2sf_tab [POW_SF2_ZERO + scale_idx - SCALE_ONE_POS + SCALE_DIV_512];
+    const float CLIPPED_ESCAPE = 165140.0f*IQ;
+    const int dim = BT_PAIR ? 2 : 4;
+    const int off = BT_UNSIGNED ? 0 : aac_cb_maxval[cb];
+    const uint8_t *spectral_bits = ff_aac_spectral_bits[cb-1];
+    int resbits = 0, nextbits = 0;
+    int i, j;
+
+    if (BT_ZERO || BT_NOISE || BT_STEREO) {
+        if (next_bits)
+            *next_bits = 0;
+        return 0;
+    }
+    if (!scaled) {
+        s->abs_pow34(s->scoefs, in, size);
+        scaled = s->scoefs;
+    }
+    s->quant_bands(s->qcoefs, in, scaled, size, !BT_UNSIGNED, aac_cb_maxval[cb], Q34, ROUNDING);
+    for (i = 0; i < size; i += dim) {
+        const int *quants = s->qcoefs + i;
+        int curidx = 0;
+
+        for (j = 0; j < dim; j++) {
+            curidx *= aac_cb_range[cb];
+            curidx += quants[j] + off;
+        }
+        resbits += spectral_bits[curidx];
+        if (!BT_ESC && next_bits)
+            nextbits += spectral_bits[curidx] - ff_aac_spectral_bits[cb][curidx];
+        if (BT_UNSIGNED) {
+            for (j = 0; j < dim; j++) {
+                if (!quants[j])
+                    continue;
+                /* sign bit */
+                resbits++;
+                if (BT_ESC && quants[j] == 16) {
+                    float t = fabsf(in[i+j]);
+                    if (t >= CLIPPED_ESCAPE) {
+                        resbits += 21;
+                    } else {
+                        int c = av_clip_uintp2(quant(t, Q, ROUNDING), 13);
+                        resbits += av_log2(c)*2 - 4 + 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (next_bits)
+        *next_bits = resbits - nextbits;
+    return resbits;
+}
+
+static inline int quantize_band_bits_NONE(struct AACEncContext *s, const float *in,
+                                          const float *scaled, int size, int scale_idx,
+                                          int cb, int *next_bits) {
+    av_assert0(0);
+    return 0;
+}
+
+#define QUANTIZE_BAND_BITS_FUNC(NAME, BT_ZERO, BT_UNSIGNED, BT_PAIR, BT_ESC, BT_NOISE, BT_STEREO, ROUNDING) \
+static int quantize_band_bits_ ## NAME(struct AACEncContext *s, const float *in,             \
+                                       const float *scaled, int size, int scale_idx,         \
+                                       int cb, int *next_bits) {                             \
+    return quantize_band_bits_template(s, in, scaled, size, scale_idx,                       \
+                                       BT_ESC ? ESC_BT : cb, next_bits,                      \
+                                       BT_ZERO, BT_UNSIGNED, BT_PAIR, BT_ESC, BT_NOISE,      \
+                                       BT_STEREO, ROUNDING);                                 \
+}
+
+QUANTIZE_BAND_BITS_FUNC(ZERO,  1, 0, 0, 0, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(SQUAD, 0, 0, 0, 0, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(UQUAD, 0, 1, 0, 0, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(SPAIR, 0, 0, 1, 0, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(UPAIR, 0, 1, 1, 0, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(ESC,   0, 1, 1, 1, 0, 0, ROUND_STANDARD)
+QUANTIZE_BAND_BITS_FUNC(ESC_RTZ, 0, 1, 1, 1, 0, 0, ROUND_TO_ZERO)
+
+static int (*const quantize_band_bits_arr[2][16])(
+                                struct AACEncContext *s, const float *in,
+                                const float *scaled, int size, int scale_idx,
+                                int cb, int *next_bits) = {
+    {
+        quantize_band_bits_ZERO,
+        quantize_band_bits_SQUAD,
+        quantize_band_bits_SQUAD,
+        quantize_band_bits_UQUAD,
+        quantize_band_bits_UQUAD,
+        quantize_band_bits_SPAIR,
+        quantize_band_bits_SPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_ESC,
+        quantize_band_bits_NONE,     /* CB 12 doesn't exist */
+        quantize_band_bits_ZERO,     /* noise and intensity stereo bands */
+        quantize_band_bits_ZERO,     /* cost no spectral bits */
+        quantize_band_bits_ZERO,
+    }, {
+        quantize_band_bits_ZERO,
+        quantize_band_bits_SQUAD,
+        quantize_band_bits_SQUAD,
+        quantize_band_bits_UQUAD,
+        quantize_band_bits_UQUAD,
+        quantize_band_bits_SPAIR,
+        quantize_band_bits_SPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_UPAIR,
+        quantize_band_bits_ESC_RTZ,
+        quantize_band_bits_NONE,     /* CB 12 doesn't exist */
+        quantize_band_bits_ZERO,
+        quantize_band_bits_ZERO,
+        quantize_band_bits_ZERO,
+    }
+};
+
 static inline int quantize_band_cost_bits(struct AACEncContext *s, const float *in,
                                 const float *scaled, int size, int scale_idx,
                                 int cb, const float lambda, const float uplim,
                                 int *bits, float *energy, int rtz)
 {
     int auxbits;
-    quantize_and_encode_band_cost(s, NULL, in, NULL, scaled, size, scale_idx,
-                                         cb, 0.0f, uplim, &auxbits, energy, rtz);
+
+    /* the distortion is not needed, so the coefficients need not be
+     * reconstructed unless the energy or an early exit are requested */
+    if (!energy && uplim == INFINITY)
+        auxbits = quantize_band_bits_arr[!!rtz][cb](s, in, scaled, size, scale_idx, cb, NULL);
+    else
+        quantize_and_encode_band_cost(s, NULL, in, NULL, scaled, size, scale_idx,
+                                      cb, 0.0f, uplim, &auxbits, energy, rtz);
     if (bits) {
         *bits = auxbits;
     }
     return auxbits;
 }
 
+/**
+ * Calculate the number of bits needed to code a band with the odd codebook cb
+ * and with the next one, which quantizes the same way, in one pass.
+ */
+static inline int quantize_band_cost_bits_pair(struct AACEncContext *s, const float *in,
+                                               const float *scaled, int size, int scale_idx,
+                                               int cb, int *next_bits, int rtz)
+{
+    av_assert1(cb & 1 && cb < ESC_BT);
+    return quantize_band_bits_arr[!!rtz][cb](s, in, scaled, size, scale_idx, cb, next_bits);
+}
+
 static inline void quantize_and_encode_band(struct AACEncContext *s, PutBitContext *pb,
                                             const float *in, float *out, int size, int scale_idx,
                                             int cb, const float lambda, int rtz)
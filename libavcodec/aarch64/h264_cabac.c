@@ -0,0 +1,142 @@
+/*
+ * H.264 CABAC residual decoding, aarch64 inline assembly
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Significance map decoding for H.264 CABAC, keeping the CABAC state in
+ * registers across the whole map instead of reloading it for every bin.
+ */
+
+#include <stddef.h>
+
+#include "libavcodec/cabac.h"
+#include "cabac.h"
+
+#if HAVE_INLINE_ASM
+
+#define decode_significance decode_significance_aarch64
+static int decode_significance_aarch64(CABACContext *c, int max_coeff,
+                                       uint8_t *significant_coeff_ctx_base,
+                                       int *index, ptrdiff_t last_off)
+{
+    uint8_t *sig_end = significant_coeff_ctx_base + max_coeff - 1;
+    uint8_t *sig     = significant_coeff_ctx_base;
+    int *idx = index;
+    int bit;
+    void *reg_a, *reg_b, *reg_c, *tmp, *state;
+
+    __asm__ volatile(
+        "3:                                                     \n\t"
+        GET_CABAC_AARCH64("%[sig]")
+        "tbz        %w[bit]       , #0          , 4f            \n\t"
+        "add        %[state]      , %[sig]      , %[last_off]   \n\t"
+        GET_CABAC_AARCH64("%[state]")
+        "sub        %w[tmp]       , %w[sig]     , %w[base]      \n\t"
+        "str        %w[tmp]       , [%[idx]]    , #4            \n\t"
+        "tbnz       %w[bit]       , #0          , 5f            \n\t"
+        "4:                                                     \n\t"
+        "add        %[sig]        , %[sig]      , #1            \n\t"
+        "cmp        %[sig]        , %[sig_end]                  \n\t"
+        "b.lo       3b                                          \n\t"
+        "sub        %w[tmp]       , %w[sig]     , %w[base]      \n\t"
+        "str        %w[tmp]       , [%[idx]]    , #4            \n\t"
+        "5:                                                     \n\t"
+        :    [bit]"=&r"(bit),
+             [low]"+&r"(c->low),
+           [range]"+&r"(c->range),
+             [r_a]"=&r"(reg_a),
+             [r_b]"=&r"(reg_b),
+             [r_c]"=&r"(reg_c),
+             [tmp]"=&r"(tmp),
+           [state]"=&r"(state),
+             [sig]"+&r"(sig),
+             [idx]"+&r"(idx)
+        :        [c]"r"(c),
+            [tables]"r"(ff_h264_cabac_tables),
+              [base]"r"(significant_coeff_ctx_base),
+           [sig_end]"r"(sig_end),
+          [last_off]"r"(last_off),
+              [byte]"i"(offsetof(CABACContext, bytestream)),
+               [end]"i"(offsetof(CABACContext, bytestream_end)),
+          [norm_off]"I"(H264_NORM_SHIFT_OFFSET),
+           [lps_off]"I"(H264_LPS_RANGE_OFFSET),
+          [mlps_off]"I"(H264_MLPS_STATE_OFFSET + 128)
+        : "memory", "cc"
+        );
+
+    return idx - index;
+}
+
+#define decode_significance_8x8 decode_significance_8x8_aarch64
+static int decode_significance_8x8_aarch64(CABACContext *c,
+                                           uint8_t *significant_coeff_ctx_base,
+                                           int *index, uint8_t *last_coeff_ctx_base,
+                                           const uint8_t *sig_off)
+{
+    int *idx = index;
+    int bit, last = 0;
+    void *reg_a, *reg_b, *reg_c, *tmp, *state;
+
+    __asm__ volatile(
+        "3:                                                     \n\t"
+        "ldrb       %w[state]     , [%[sig_off], %w[last], UXTW]\n\t"
+        "add        %[state]      , %[sig_base] , %[state]      \n\t"
+        GET_CABAC_AARCH64("%[state]")
+        "tbz        %w[bit]       , #0          , 4f            \n\t"
+        "add        %[state]      , %[tables]   , %w[last], UXTW\n\t"
+        "ldrb       %w[state]     , [%[state], %[last_flag_off]]\n\t"
+        "add        %[state]      , %[last_base], %[state]      \n\t"
+        GET_CABAC_AARCH64("%[state]")
+        "str        %w[last]      , [%[idx]]    , #4            \n\t"
+        "tbnz       %w[bit]       , #0          , 5f            \n\t"
+        "4:                                                     \n\t"
+        "add        %w[last]      , %w[last]    , #1            \n\t"
+        "cmp        %w[last]      , #63                         \n\t"
+        "b.lo       3b                                          \n\t"
+        "str        %w[last]      , [%[idx]]    , #4            \n\t"
+        "5:                                                     \n\t"
+        :    [bit]"=&r"(bit),
+             [low]"+&r"(c->low),
+           [range]"+&r"(c->range),
+             [r_a]"=&r"(reg_a),
+             [r_b]"=&r"(reg_b),
+             [r_c]"=&r"(reg_c),
+             [tmp]"=&r"(tmp),
+           [state]"=&r"(state),
+            [last]"+&r"(last),
+             [idx]"+&r"(idx)
+        :        [c]"r"(c),
+            [tables]"r"(ff_h264_cabac_tables),
+          [sig_base]"r"(significant_coeff_ctx_base),
+         [last_base]"r"(last_coeff_ctx_base),
+           [sig_off]"r"(sig_off),
+              [byte]"i"(offsetof(CABACContext, bytestream)),
+               [end]"i"(offsetof(CABACContext, bytestream_end)),
+     [last_flag_off]"i"(H264_LAST_COEFF_FLAG_OFFSET_8x8_OFFSET),
+          [norm_off]"I"(H264_NORM_SHIFT_OFFSET),
+           [lps_off]"I"(H264_LPS_RANGE_OFFSET),
+          [mlps_off]"I"(H264_MLPS_STATE_OFFSET + 128)
+        : "memory", "cc"
+        );
+
+    return idx - index;
+}
+
+#endif /* HAVE_INLINE_ASM */
@@ -0,0 +1,114 @@
+/*
+ * ARM NEON optimised HEVC DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/aarch64/cpu.h"
+#include "libavcodec/hevcdsp.h"
+
+void ff_hevc_add_residual_4x4_8_neon(uint8_t *_dst, int16_t *coeffs,
+                                     ptrdiff_t stride);
+void ff_hevc_add_residual_4x4_10_neon(uint8_t *_dst, int16_t *coeffs,
+                                      ptrdiff_t stride);
+void ff_hevc_add_residual_8x8_8_neon(uint8_t *_dst, int16_t *coeffs,
+                                     ptrdiff_t stride);
+void ff_hevc_add_residual_8x8_10_neon(uint8_t *_dst, int16_t *coeffs,
+                                      ptrdiff_t stride);
+void ff_hevc_add_residual_16x16_8_neon(uint8_t *_dst, int16_t *coeffs,
+                                       ptrdiff_t stride);
+void ff_hevc_add_residual_16x16_10_neon(uint8_t *_dst, int16_t *coeffs,
+                                        ptrdiff_t stride);
+void ff_hevc_add_residual_32x32_8_neon(uint8_t *_dst, int16_t *coeffs,
+                                       ptrdiff_t stride);
+void ff_hevc_add_residual_32x32_10_neon(uint8_t *_dst, int16_t *coeffs,
+                                        ptrdiff_t stride);
+void ff_hevc_idct_4x4_8_neon(int16_t *coeffs, int col_limit);
+void ff_hevc_idct_4x4_10_neon(int16_t *coeffs, int col_limit);
+void ff_hevc_idct_8x8_8_neon(int16_t *coeffs, int col_limit);
+void ff_hevc_idct_8x8_10_neon(int16_t *coeffs, int col_limit);
+void ff_hevc_idct_4x4_dc_8_neon(int16_t *coeffs);
+void ff_hevc_idct_8x8_dc_8_neon(int16_t *coeffs);
+void ff_hevc_idct_16x16_dc_8_neon(int16_t *coeffs);
+void ff_hevc_idct_32x32_dc_8_neon(int16_t *coeffs);
+void ff_hevc_idct_4x4_dc_10_neon(int16_t *coeffs);
+void ff_hevc_idct_8x8_dc_10_neon(int16_t *coeffs);
+void ff_hevc_idct_16x16_dc_10_neon(int16_t *coeffs);
+void ff_hevc_idct_32x32_dc_10_neon(int16_t *coeffs);
+
+#define PUT_PEL_FUNC(name)                                                  \
+void ff_hevc_put_hevc_ ## name ## _8_neon(int16_t *dst, uint8_t *src,       \
+                                          ptrdiff_t srcstride, int height,  \
+                                          intptr_t mx, intptr_t my,         \
+                                          int width)
+
+PUT_PEL_FUNC(pel_pixels);
+PUT_PEL_FUNC(qpel_h);
+PUT_PEL_FUNC(qpel_v);
+PUT_PEL_FUNC(epel_h);
+PUT_PEL_FUNC(epel_v);
+
+av_cold void ff_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth)
+{
+    int cpu_flags = av_get_cpu_flags();
+    int i;
+
+    if (!have_neon(cpu_flags))
+        return;
+
+    if (bit_depth == 8) {
+        c->add_residual[0] = ff_hevc_add_residual_4x4_8_neon;
+        c->add_residual[1] = ff_hevc_add_residual_8x8_8_neon;
+        c->add_residual[2] = ff_hevc_add_residual_16x16_8_neon;
+        c->add_residual[3] = ff_hevc_add_residual_32x32_8_neon;
+        c->idct[0]         = ff_hevc_idct_4x4_8_neon;
+        c->idct[1]         = ff_hevc_idct_8x8_8_neon;
+        c->idct_dc[0]      = ff_hevc_idct_4x4_dc_8_neon;
+        c->idct_dc[1]      = ff_hevc_idct_8x8_dc_8_neon;
+        c->idct_dc[2]      = ff_hevc_idct_16x16_dc_8_neon;
+        c->idct_dc[3]      = ff_hevc_idct_32x32_dc_8_neon;
+
+        /* The MC functions handle 8 pixels per iteration, so they are only
+         * used for the block widths 8, 16, 24, 32, 48 and 64. */
+        for (i = 3; i < 10; i++) {
+            if (i == 4)
+                continue;
+            c->put_hevc_qpel[i][0][0] = ff_hevc_put_hevc_pel_pixels_8_neon;
+            c->put_hevc_qpel[i][0][1] = ff_hevc_put_hevc_qpel_h_8_neon;
+            c->put_hevc_qpel[i][1][0] = ff_hevc_put_hevc_qpel_v_8_neon;
+            c->put_hevc_epel[i][0][0] = ff_hevc_put_hevc_pel_pixels_8_neon;
+            c->put_hevc_epel[i][0][1] = ff_hevc_put_hevc_epel_h_8_neon;
+            c->put_hevc_epel[i][1][0] = ff_hevc_put_hevc_epel_v_8_neon;
+        }
+    }
+    if (bit_depth == 10) {
+        c->add_residual[0] = ff_hevc_add_residual_4x4_10_neon;
+        c->add_residual[1] = ff_hevc_add_residual_8x8_10_neon;
+        c->add_residual[2] = ff_hevc_add_residual_16x16_10_neon;
+        c->add_residual[3] = ff_hevc_add_residual_32x32_10_neon;
+        c->idct[0]         = ff_hevc_idct_4x4_10_neon;
+        c->idct[1]         = ff_hevc_idct_8x8_10_neon;
+        c->idct_dc[0]      = ff_hevc_idct_4x4_dc_10_neon;
+        c->idct_dc[1]      = ff_hevc_idct_8x8_dc_10_neon;
+        c->idct_dc[2]      = ff_hevc_idct_16x16_dc_10_neon;
+        c->idct_dc[3]      = ff_hevc_idct_32x32_dc_10_neon;
+    }
+}
@@ -153,6 +153,7 @@ typedef struct AC3DSPContext {
 } AC3DSPContext;
 
 void ff_ac3dsp_init    (AC3DSPContext *c, int bit_exact);
+void ff_ac3dsp_init_aarch64(AC3DSPContext *c, int bit_exact);
 void ff_ac3dsp_init_arm(AC3DSPContext *c, int bit_exact);
 void ff_ac3dsp_init_x86(AC3DSPContext *c, int bit_exact);
 void ff_ac3dsp_init_mips(AC3DSPContext *c, int bit_exact);
@@ -950,6 +950,14 @@ typedef struct RcOverride{
  * Discard cropping information from SPS.
  */
 #define AV_CODEC_FLAG2_IGNORE_CROP    (1 << 16)
+/**
+ * With frame threading, return each frame as soon as the thread decoding it
+ * has finished, instead of waiting until a packet has been submitted to
+ * every thread. Frames finished while no packet is available are returned by
+ * avcodec_receive_frame() without waiting for the next packet.
+ * avctx->delay stays the worst case delay.
+ */
+#define AV_CODEC_FLAG2_THREAD_LOW_DELAY (1 << 17)
 
 /**
  * Show all frames before the first keyframe
@@ -1410,6 +1418,14 @@ enum AVPacketSideDataType {
      */
     AV_PKT_DATA_AFD,
 
+    /**
+     * Regions of interest, the data is an array of AVRegionOfInterest, the
+     * number of elements is implied by the side data size divided by
+     * AVRegionOfInterest.self_size. Decoders export it as
+     * AV_FRAME_DATA_REGIONS_OF_INTEREST.
+     */
+    AV_PKT_DATA_REGIONS_OF_INTEREST,
+
     /**
      * The number of side data types.
      * This is not part of the public API/ABI in the sense that it may
@@ -3384,6 +3400,64 @@ typedef struct AVCodecContext {
      * - encoding: set by user
      */
     int64_t max_samples;
+
+    /**
+     * Number of slice threads shared by the frame threads, for codecs that
+     * support combining frame and slice threading. This is only used when
+     * both FF_THREAD_FRAME and FF_THREAD_SLICE are set in thread_type and
+     * frame threading is selected; with 1 no slice threads are used.
+     * 0 selects a number automatically.
+     *
+     * - decoding: Set by user, may be overwritten by libavcodec.
+     * - encoding: unused
+     */
+    int slice_thread_count;
+
+    /**
+     * Comma-separated list of CPUs and ranges of CPUs, e.g. "0-7,16", the
+     * threads created by libavcodec are restricted to. NULL (the default)
+     * leaves their affinity unchanged.
+     *
+     * - decoding: Set by user.
+     * - encoding: Set by user.
+     */
+    char *thread_affinity;
+
+    /**
+     * NUMA node whose CPUs the threads created by libavcodec are restricted
+     * to, combined with thread_affinity. Since memory is placed on the node
+     * of the thread first writing it, this also keeps the frames decoded by
+     * these threads local to the node. -1 (the default) means no restriction.
+     *
+     * - decoding: Set by user.
+     * - encoding: Set by user.
+     */
+    int numa_node;
+
+    /**
+     * Size of the frames output by a hwaccel that can scale the decoded
+     * pictures while decoding, e.g. NVDEC. 0 (the default) keeps the size of
+     * the cropped picture. Other hwaccels ignore it.
+     *
+     * - decoding: Set by user.
+     * - encoding: unused
+     */
+    int hwaccel_output_width;
+    int hwaccel_output_height;
+
+    /**
+     * Number of pixels to crop from the edges of the decoded pictures by a
+     * hwaccel that can crop while decoding, before scaling them to
+     * hwaccel_output_width x hwaccel_output_height. Other hwaccels ignore
+     * them.
+     *
+     * - decoding: Set by user.
+     * - encoding: unused
+     */
+    int hwaccel_crop_top;
+    int hwaccel_crop_bottom;
+    int hwaccel_crop_left;
+    int hwaccel_crop_right;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -5823,6 +5897,8 @@ typedef struct AVBSFContext {
     AVRational time_base_out;
 } AVBSFContext;
 
+struct CodedBitstreamFragment;
+
 typedef struct AVBitStreamFilter {
     const char *name;
 
@@ -5857,6 +5933,15 @@ typedef struct AVBitStreamFilter {
     int (*filter)(AVBSFContext *ctx, AVPacket *pkt);
     void (*close)(AVBSFContext *ctx);
     void (*flush)(AVBSFContext *ctx);
+    /**
+     * Filter an access unit which has already been read by cbs, in place.
+     * Filters implementing this must register the CodedBitstreamContext they
+     * read with in init(), see ff_bsf_set_cbs_context(), so that consecutive
+     * such filters in a list read and write every packet only once.
+     * AVERROR(EAGAIN) means that the packet is to be dropped.
+     */
+    int (*filter_fragment)(AVBSFContext *ctx, struct CodedBitstreamFragment *frag,
+                           AVPacket *pkt);
 } AVBitStreamFilter;
 
 #if FF_API_OLD_BSF
@@ -26,6 +26,7 @@
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
+#include "libavutil/thread.h"
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
@@ -68,15 +69,56 @@ void av_packet_free(AVPacket **pkt)
     av_freep(pkt);
 }
 
+/* Small payloads are served from per size class pools, shared by the whole
+ * process, to keep high packet rates away from the allocator. Each pool keeps
+ * at most POOL_MAX_IDLE_SIZE bytes (and at least POOL_MIN_IDLE buffers) of
+ * unused buffers, so that a burst of packets does not stay allocated. */
+#define POOL_MIN_BITS 6
+#define POOL_MAX_BITS 16
+#define POOL_NB_CLASSES (POOL_MAX_BITS - POOL_MIN_BITS + 1)
+#define POOL_MAX_IDLE_SIZE (256 << 10)
+#define POOL_MIN_IDLE 4
+
+static AVBufferPool *packet_pools[POOL_NB_CLASSES];
+static AVOnce packet_pools_init = AV_ONCE_INIT;
+
+static void packet_pools_alloc(void)
+{
+    for (int i = 0; i < POOL_NB_CLASSES; i++) {
+        packet_pools[i] = av_buffer_pool_init(1 << (POOL_MIN_BITS + i), NULL);
+        if (!packet_pools[i])
+            continue;
+        av_buffer_pool_set_mem_tag(packet_pools[i], AV_MEM_TAG_PACKET);
+        av_buffer_pool_set_max_idle(packet_pools[i],
+                                    FFMAX(POOL_MAX_IDLE_SIZE >> (POOL_MIN_BITS + i),
+                                          POOL_MIN_IDLE));
+    }
+}
+
+static AVBufferRef *packet_pool_get(int size)
+{
+    int idx;
+
+    if (size > 1 << POOL_MAX_BITS ||
+        ff_thread_once(&packet_pools_init, packet_pools_alloc))
+        return NULL;
+
+    idx = FFMAX(av_log2(size - 1) + 1 - POOL_MIN_BITS, 0);
+    return packet_pools[idx] ? av_buffer_pool_get(packet_pools[idx]) : NULL;
+}
+
 static int packet_alloc(AVBufferRef **buf, int size)
 {
     int ret;
     if (size < 0 || size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
         return AVERROR(EINVAL);
 
-    ret = av_buffer_realloc(buf, size + AV_INPUT_BUFFER_PADDING_SIZE);
-    if (ret < 0)
-        return ret;
+    if (*buf || !(*buf = packet_pool_get(size + AV_INPUT_BUFFER_PADDING_SIZE))) {
+        ret = av_buffer_realloc(buf, size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (ret < 0)
+            return ret;
+        av_buffer_set_mem_tag(*buf, AV_MEM_TAG_PACKET);
+    }
 
     memset((*buf)->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
@@ -136,9 +178,9 @@ int av_grow_packet(AVPacket *pkt, int grow_by)
             pkt->data = pkt->buf->data + data_offset;
         }
     } else {
-        pkt->buf = av_buffer_alloc(new_size);
-        if (!pkt->buf)
-            return AVERROR(ENOMEM);
+        int ret = packet_alloc(&pkt->buf, pkt->size + grow_by);
+        if (ret < 0)
+            return ret;
         if (pkt->size > 0)
             memcpy(pkt->buf->data, pkt->data, pkt->size);
         pkt->data = pkt->buf->data;
@@ -394,6 +436,7 @@ const char *av_packet_side_data_name(enum AVPacketSideDataType type)
     case AV_PKT_DATA_ENCRYPTION_INIT_INFO:       return "Encryption initialization data";
     case AV_PKT_DATA_ENCRYPTION_INFO:            return "Encryption info";
     case AV_PKT_DATA_AFD:                        return "Active Format Description data";
+    case AV_PKT_DATA_REGIONS_OF_INTEREST:        return "Regions Of Interest";
     }
     return NULL;
 }
@@ -18,6 +18,8 @@
 
 #include <string.h>
 
+#include "config.h"
+
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -26,10 +28,12 @@
 
 #include "avcodec.h"
 #include "bsf.h"
+#include "cbs.h"
 
 struct AVBSFInternal {
     AVPacket *buffer_pkt;
     int eof;
+    CodedBitstreamContext *cbc;
 };
 
 void av_bsf_free(AVBSFContext **pctx)
@@ -252,12 +256,36 @@ int ff_bsf_get_packet_ref(AVBSFContext *ctx, AVPacket *pkt)
     return 0;
 }
 
+void ff_bsf_set_cbs_context(AVBSFContext *ctx, CodedBitstreamContext *cbc)
+{
+    ctx->internal->cbc = cbc;
+}
+
+/**
+ * A step of a filter list: either a single filter, or a run of filters
+ * implementing filter_fragment() on the same coded bitstream type, which
+ * share a single read and write of every packet.
+ */
+typedef struct BSFListStage {
+    int first;              // index of the first BSF of the stage
+    int nb;                 // number of BSFs in the stage
+
+    /* Fused stages only */
+    CodedBitstreamFragment fragment;
+    CodedBitstreamUnitType *decompose_unit_types;
+    AVPacket *pkt;          // filtered packet waiting to be received
+    int eof;
+} BSFListStage;
+
 typedef struct BSFListContext {
     const AVClass *class;
 
     AVBSFContext **bsfs;
     int nb_bsfs;
 
+    BSFListStage *stages;
+    int nb_stages;
+
     unsigned idx;           // index of currently processed BSF
     unsigned flushed_idx;   // index of BSF being flushed
 
@@ -265,6 +293,8 @@ typedef struct BSFListContext {
 } BSFListContext;
 
 
+static int bsf_list_make_stages(BSFListContext *lst);
+
 static int bsf_list_init(AVBSFContext *bsf)
 {
     BSFListContext *lst = bsf->priv_data;
@@ -289,11 +319,174 @@ static int bsf_list_init(AVBSFContext *bsf)
 
     bsf->time_base_out = tb;
     ret = avcodec_parameters_copy(bsf->par_out, cod_par);
+    if (ret < 0)
+        goto fail;
+
+    ret = bsf_list_make_stages(lst);
 
 fail:
     return ret;
 }
 
+static CodedBitstreamContext *bsf_list_fragment_cbc(const BSFListContext *lst,
+                                                    int idx)
+{
+    const AVBSFContext *bsf = lst->bsfs[idx];
+
+    if (!CONFIG_CBS || !bsf->filter->filter_fragment)
+        return NULL;
+    return bsf->internal->cbc;
+}
+
+static int bsf_list_fuse_stage(BSFListContext *lst, BSFListStage *stage)
+{
+    CodedBitstreamContext *cbc = lst->bsfs[stage->first]->internal->cbc;
+    int i, nb_types = 0;
+
+    stage->pkt = av_packet_alloc();
+    if (!stage->pkt)
+        return AVERROR(ENOMEM);
+
+    /* The first context reads for the whole stage, so it has to decompose
+     * every unit type any of the filters looks at. */
+    for (i = 0; i < stage->nb; i++) {
+        const CodedBitstreamContext *c = lst->bsfs[stage->first + i]->internal->cbc;
+        if (!c->decompose_unit_types) {
+            cbc->decompose_unit_types    = NULL;
+            cbc->nb_decompose_unit_types = 0;
+            return 0;
+        }
+        nb_types += c->nb_decompose_unit_types;
+    }
+
+    stage->decompose_unit_types = av_malloc_array(FFMAX(nb_types, 1),
+                                                  sizeof(*stage->decompose_unit_types));
+    if (!stage->decompose_unit_types)
+        return AVERROR(ENOMEM);
+
+    nb_types = 0;
+    for (i = 0; i < stage->nb; i++) {
+        const CodedBitstreamContext *c = lst->bsfs[stage->first + i]->internal->cbc;
+        memcpy(stage->decompose_unit_types + nb_types, c->decompose_unit_types,
+               c->nb_decompose_unit_types * sizeof(*c->decompose_unit_types));
+        nb_types += c->nb_decompose_unit_types;
+    }
+    cbc->decompose_unit_types    = stage->decompose_unit_types;
+    cbc->nb_decompose_unit_types = nb_types;
+
+    return 0;
+}
+
+static int bsf_list_make_stages(BSFListContext *lst)
+{
+    int i = 0, ret;
+
+    if (!lst->nb_bsfs)
+        return 0;
+
+    lst->stages = av_calloc(lst->nb_bsfs, sizeof(*lst->stages));
+    if (!lst->stages)
+        return AVERROR(ENOMEM);
+
+    while (i < lst->nb_bsfs) {
+        BSFListStage *stage = &lst->stages[lst->nb_stages++];
+        const CodedBitstreamContext *cbc = bsf_list_fragment_cbc(lst, i);
+
+        stage->first = i;
+        stage->nb    = 1;
+        if (cbc) {
+            while (i + stage->nb < lst->nb_bsfs) {
+                const CodedBitstreamContext *next =
+                    bsf_list_fragment_cbc(lst, i + stage->nb);
+                if (!next || next->codec != cbc->codec)
+                    break;
+                stage->nb++;
+            }
+            if (stage->nb > 1) {
+                av_log(lst, AV_LOG_VERBOSE, "Fusing %d filters "
+                       "sharing one coded bitstream pass.\n", stage->nb);
+                ret = bsf_list_fuse_stage(lst, stage);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+        i += stage->nb;
+    }
+
+    return 0;
+}
+
+static int bsf_list_filter_fragment(BSFListContext *lst, BSFListStage *stage,
+                                    AVPacket *pkt)
+{
+#if CONFIG_CBS
+    AVBSFContext            *bsf = lst->bsfs[stage->first];
+    CodedBitstreamContext   *cbc = bsf->internal->cbc;
+    CodedBitstreamFragment *frag = &stage->fragment;
+    int ret, i;
+
+    ret = ff_cbs_read_packet(cbc, frag, pkt);
+    if (ret < 0) {
+        av_log(bsf, AV_LOG_ERROR, "Failed to read packet.\n");
+        goto fail;
+    }
+
+    for (i = 0; i < stage->nb; i++) {
+        AVBSFContext *cur = lst->bsfs[stage->first + i];
+        ret = cur->filter->filter_fragment(cur, frag, pkt);
+        if (ret < 0)
+            goto fail;
+    }
+
+    ret = ff_cbs_write_packet(cbc, pkt, frag);
+    if (ret < 0)
+        av_log(bsf, AV_LOG_ERROR, "Failed to write packet.\n");
+
+fail:
+    ff_cbs_fragment_reset(cbc, frag);
+    return ret;
+#else
+    return AVERROR_BUG;
+#endif
+}
+
+static int bsf_list_stage_send(BSFListContext *lst, BSFListStage *stage,
+                               AVPacket *pkt)
+{
+    int ret;
+
+    if (stage->nb == 1)
+        return av_bsf_send_packet(lst->bsfs[stage->first], pkt);
+
+    if (!pkt) {
+        stage->eof = 1;
+        return 0;
+    }
+
+    ret = bsf_list_filter_fragment(lst, stage, pkt);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        return ret == AVERROR(EAGAIN) ? 0 : ret;
+    }
+    av_packet_move_ref(stage->pkt, pkt);
+
+    return 0;
+}
+
+static int bsf_list_stage_receive(BSFListContext *lst, BSFListStage *stage,
+                                  AVPacket *pkt)
+{
+    if (stage->nb == 1)
+        return av_bsf_receive_packet(lst->bsfs[stage->first], pkt);
+
+    if (stage->pkt->data) {
+        av_packet_move_ref(pkt, stage->pkt);
+        return 0;
+    }
+
+    return stage->eof ? AVERROR_EOF : AVERROR(EAGAIN);
+}
+
 static int bsf_list_filter(AVBSFContext *bsf, AVPacket *out)
 {
     BSFListContext *lst = bsf->priv_data;
@@ -304,7 +497,7 @@ static int bsf_list_filter(AVBSFContext *bsf, AVPacket *out)
 
     while (1) {
         if (lst->idx > lst->flushed_idx) {
-            ret = av_bsf_receive_packet(lst->bsfs[lst->idx-1], out);
+            ret = bsf_list_stage_receive(lst, &lst->stages[lst->idx-1], out);
             if (ret == AVERROR(EAGAIN)) {
                 /* no more packets from idx-1, try with previous */
                 lst->idx--;
@@ -325,7 +518,7 @@ static int bsf_list_filter(AVBSFContext *bsf, AVPacket *out)
                 break;
         }
 
-        if (lst->idx < lst->nb_bsfs) {
+        if (lst->idx < lst->nb_stages) {
             AVPacket *pkt;
             if (ret == AVERROR_EOF && lst->idx == lst->flushed_idx) {
                 /* ff_bsf_get_packet_ref returned EOF and idx is first
@@ -334,7 +527,7 @@ static int bsf_list_filter(AVBSFContext *bsf, AVPacket *out)
             } else {
                 pkt = out;
             }
-            ret = av_bsf_send_packet(lst->bsfs[lst->idx], pkt);
+            ret = bsf_list_stage_send(lst, &lst->stages[lst->idx], pkt);
             if (ret < 0)
                 break;
             lst->idx++;
@@ -356,6 +549,11 @@ static void bsf_list_flush(AVBSFContext *bsf)
 
     for (int i = 0; i < lst->nb_bsfs; i++)
         av_bsf_flush(lst->bsfs[i]);
+    for (int i = 0; i < lst->nb_stages; i++) {
+        if (lst->stages[i].pkt)
+            av_packet_unref(lst->stages[i].pkt);
+        lst->stages[i].eof = 0;
+    }
     lst->idx = lst->flushed_idx = 0;
 }
 
@@ -364,6 +562,18 @@ static void bsf_list_close(AVBSFContext *bsf)
     BSFListContext *lst = bsf->priv_data;
     int i;
 
+    for (i = 0; i < lst->nb_stages; i++) {
+        BSFListStage *stage = &lst->stages[i];
+#if CONFIG_CBS
+        if (stage->nb > 1)
+            ff_cbs_fragment_free(lst->bsfs[stage->first]->internal->cbc,
+                                 &stage->fragment);
+#endif
+        av_packet_free(&stage->pkt);
+        av_freep(&stage->decompose_unit_types);
+    }
+    av_freep(&lst->stages);
+
     for (i = 0; i < lst->nb_bsfs; ++i)
         av_bsf_free(&lst->bsfs[i]);
     av_freep(&lst->bsfs);
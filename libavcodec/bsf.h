@@ -39,6 +39,18 @@ int ff_bsf_get_packet(AVBSFContext *ctx, AVPacket **pkt);
  */
 int ff_bsf_get_packet_ref(AVBSFContext *ctx, AVPacket *pkt);
 
+struct CodedBitstreamContext;
+
+/**
+ * Called by bitstream filters implementing filter_fragment() from their init
+ * function, to tell which CodedBitstreamContext they read packets with.
+ *
+ * The context stays owned by the filter.  When the filter is fused with its
+ * neighbours in a list, the context of the first one reads and writes the
+ * packets, using the union of the decompose_unit_types of all of them.
+ */
+void ff_bsf_set_cbs_context(AVBSFContext *ctx, struct CodedBitstreamContext *cbc);
+
 const AVClass *ff_bsf_child_class_next(const AVClass *prev);
 
 #endif /* AVCODEC_BSF_H */
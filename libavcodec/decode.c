@@ -410,6 +410,12 @@ static int decode_simple_internal(AVCodecContext *avctx, AVFrame *frame)
     if (!pkt->data && !avci->draining) {
         av_packet_unref(pkt);
         ret = ff_decode_get_packet(avctx, pkt);
+        /* frame threads may have finished frames while no packet arrived,
+         * return them instead of waiting for the next packet */
+        if (ret == AVERROR(EAGAIN) && HAVE_THREADS &&
+            avctx->active_thread_type & FF_THREAD_FRAME &&
+            ff_thread_can_output_frame(avctx))
+            ret = 0;
         if (ret < 0 && ret != AVERROR_EOF)
             return ret;
     }
@@ -1332,6 +1338,15 @@ static int hwaccel_init(AVCodecContext *avctx,
         return AVERROR_PATCHWELCOME;
     }
 
+    if ((avctx->hwaccel_output_width || avctx->hwaccel_output_height ||
+         avctx->hwaccel_crop_top  || avctx->hwaccel_crop_bottom ||
+         avctx->hwaccel_crop_left || avctx->hwaccel_crop_right) &&
+        !(hwaccel->caps_internal & HWACCEL_CAP_OUTPUT_RESIZE)) {
+        av_log(avctx, AV_LOG_WARNING, "The %s hwaccel cannot scale or crop "
+               "while decoding, ignoring the output size and cropping.\n",
+               hwaccel->name);
+    }
+
     if (hwaccel->priv_data_size) {
         avctx->internal->hwaccel_priv_data =
             av_mallocz(hwaccel->priv_data_size);
@@ -1559,6 +1574,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
                     ret = AVERROR(ENOMEM);
                     goto fail;
                 }
+                av_buffer_pool_set_mem_tag(pool->pools[i], AV_MEM_TAG_FRAME);
             }
         }
         pool->format = frame->format;
@@ -1587,6 +1603,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
             ret = AVERROR(ENOMEM);
             goto fail;
         }
+        av_buffer_pool_set_mem_tag(pool->pools[0], AV_MEM_TAG_FRAME);
 
         pool->format     = frame->format;
         pool->planes     = planes;
@@ -1750,6 +1767,7 @@ int ff_decode_frame_props(AVCodecContext *avctx, AVFrame *frame)
         { AV_PKT_DATA_MASTERING_DISPLAY_METADATA, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA },
         { AV_PKT_DATA_CONTENT_LIGHT_LEVEL,        AV_FRAME_DATA_CONTENT_LIGHT_LEVEL },
         { AV_PKT_DATA_A53_CC,                     AV_FRAME_DATA_A53_CC },
+        { AV_PKT_DATA_REGIONS_OF_INTEREST,        AV_FRAME_DATA_REGIONS_OF_INTEREST },
     };
 
     if (pkt) {
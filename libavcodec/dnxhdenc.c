@@ -26,6 +26,7 @@
 #include "libavutil/attributes.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/qsort.h"
 #include "libavutil/timer.h"
 
 #include "avcodec.h"
@@ -1164,60 +1165,47 @@ static int dnxhd_find_qscale(DNXHDEncContext *ctx)
     return 0;
 }
 
-#define BUCKET_BITS 8
-#define RADIX_PASSES 4
+#define BUCKET_BITS 10
 #define NBUCKETS (1 << BUCKET_BITS)
 
-static inline int get_bucket(int value, int shift)
+static int cmp_rc_entry(const RCCMPEntry *a, const RCCMPEntry *b)
 {
-    value >>= shift;
-    value  &= NBUCKETS - 1;
-    return NBUCKETS - 1 - value;
+    if (a->value != b->value)
+        return (unsigned)a->value < (unsigned)b->value ? 1 : -1;
+    return a->mb - b->mb;
 }
 
-static void radix_count(const RCCMPEntry *data, int size,
-                        int buckets[RADIX_PASSES][NBUCKETS])
+/**
+ * Store the entries into buckets of decreasing values, keeping the order of
+ * the entries inside a bucket. Only the buckets actually reached by the rate
+ * control have to be sorted afterwards.
+ *
+ * @param start set to the index in dst of the first entry of each bucket,
+ *              start[NBUCKETS] being the number of entries
+ */
+static void bucket_split(RCCMPEntry *dst, const RCCMPEntry *data, int size,
+                         int start[NBUCKETS + 1])
 {
-    int i, j;
-    memset(buckets, 0, sizeof(buckets[0][0]) * RADIX_PASSES * NBUCKETS);
-    for (i = 0; i < size; i++) {
-        int v = data[i].value;
-        for (j = 0; j < RADIX_PASSES; j++) {
-            buckets[j][get_bucket(v, 0)]++;
-            v >>= BUCKET_BITS;
-        }
-        av_assert1(!v);
-    }
-    for (j = 0; j < RADIX_PASSES; j++) {
-        int offset = size;
-        for (i = NBUCKETS - 1; i >= 0; i--)
-            buckets[j][i] = offset -= buckets[j][i];
-        av_assert1(!buckets[j][0]);
-    }
-}
+    unsigned min = UINT_MAX, max = 0;
+    int i, shift = 0;
 
-static void radix_sort_pass(RCCMPEntry *dst, const RCCMPEntry *data,
-                            int size, int buckets[NBUCKETS], int pass)
-{
-    int shift = pass * BUCKET_BITS;
-    int i;
     for (i = 0; i < size; i++) {
-        int v   = get_bucket(data[i].value, shift);
-        int pos = buckets[v]++;
-        dst[pos] = data[i];
-    }
-}
-
-static void radix_sort(RCCMPEntry *data, RCCMPEntry *tmp, int size)
-{
-    int buckets[RADIX_PASSES][NBUCKETS];
-    radix_count(data, size, buckets);
-    radix_sort_pass(tmp, data, size, buckets[0], 0);
-    radix_sort_pass(data, tmp, size, buckets[1], 1);
-    if (buckets[2][NBUCKETS - 1] || buckets[3][NBUCKETS - 1]) {
-        radix_sort_pass(tmp, data, size, buckets[2], 2);
-        radix_sort_pass(data, tmp, size, buckets[3], 3);
+        min = FFMIN(min, (unsigned)data[i].value);
+        max = FFMAX(max, (unsigned)data[i].value);
     }
+    while ((max - min) >> shift >= NBUCKETS)
+        shift++;
+
+    memset(start, 0, sizeof(*start) * (NBUCKETS + 1));
+    for (i = 0; i < size; i++)
+        start[((max - (unsigned)data[i].value) >> shift) + 1]++;
+    for (i = 1; i <= NBUCKETS; i++)
+        start[i] += start[i - 1];
+    for (i = 0; i < size; i++)
+        dst[start[(max - (unsigned)data[i].value) >> shift]++] = data[i];
+    /* each start[i] now points at the end of its bucket */
+    memmove(start + 1, start, sizeof(*start) * NBUCKETS);
+    start[0] = 0;
 }
 
 static int dnxhd_encode_fast(AVCodecContext *avctx, DNXHDEncContext *ctx)
@@ -1247,14 +1235,27 @@ static int dnxhd_encode_fast(AVCodecContext *avctx, DNXHDEncContext *ctx)
         }
         max_bits += 31; // worst padding
     }
-    if (!ret) {
+    if (!ret && max_bits > ctx->frame_bits) {
+        RCCMPEntry *sorted = ctx->mb_cmp_tmp;
+        int start[NBUCKETS + 1];
+        int bucket = -1, end = 0;
+
         if (RC_VARIANCE)
             avctx->execute2(avctx, dnxhd_mb_var_thread,
                             NULL, NULL, ctx->m.mb_height);
-        radix_sort(ctx->mb_cmp, ctx->mb_cmp_tmp, ctx->m.mb_num);
+        bucket_split(sorted, ctx->mb_cmp, ctx->m.mb_num, start);
         for (x = 0; x < ctx->m.mb_num && max_bits > ctx->frame_bits; x++) {
-            int mb = ctx->mb_cmp[x].mb;
-            int rc = (ctx->qscale * ctx->m.mb_num ) + mb;
+            int mb, rc;
+
+            if (x == end) {
+                do {
+                    bucket++;
+                } while (start[bucket + 1] == x);
+                end = start[bucket + 1];
+                AV_QSORT(sorted + x, end - x, RCCMPEntry, cmp_rc_entry);
+            }
+            mb = sorted[x].mb;
+            rc = (ctx->qscale * ctx->m.mb_num ) + mb;
             max_bits -= ctx->mb_rc[rc].bits -
                         ctx->mb_rc[rc + ctx->m.mb_num].bits;
             ctx->mb_qscale[mb] = ctx->qscale + 1;
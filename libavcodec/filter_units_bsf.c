@@ -98,11 +98,36 @@ invalid:
     return AVERROR(EINVAL);
 }
 
+static int filter_units_filter_fragment(AVBSFContext *bsf,
+                                        CodedBitstreamFragment *frag,
+                                        AVPacket *pkt)
+{
+    FilterUnitsContext *ctx = bsf->priv_data;
+    int i, j;
+
+    for (i = frag->nb_units - 1; i >= 0; i--) {
+        for (j = 0; j < ctx->nb_types; j++) {
+            if (frag->units[i].type == ctx->type_list[j])
+                break;
+        }
+        if (ctx->mode == REMOVE ? j <  ctx->nb_types
+                                : j >= ctx->nb_types)
+            ff_cbs_delete_unit(ctx->cbc, frag, i);
+    }
+
+    if (frag->nb_units == 0) {
+        // Don't return packets with nothing in them.
+        return AVERROR(EAGAIN);
+    }
+
+    return 0;
+}
+
 static int filter_units_filter(AVBSFContext *bsf, AVPacket *pkt)
 {
     FilterUnitsContext      *ctx = bsf->priv_data;
     CodedBitstreamFragment *frag = &ctx->fragment;
-    int err, i, j;
+    int err;
 
     err = ff_bsf_get_packet_ref(bsf, pkt);
     if (err < 0)
@@ -117,21 +142,9 @@ static int filter_units_filter(AVBSFContext *bsf, AVPacket *pkt)
         goto fail;
     }
 
-    for (i = frag->nb_units - 1; i >= 0; i--) {
-        for (j = 0; j < ctx->nb_types; j++) {
-            if (frag->units[i].type == ctx->type_list[j])
-                break;
-        }
-        if (ctx->mode == REMOVE ? j <  ctx->nb_types
-                                : j >= ctx->nb_types)
-            ff_cbs_delete_unit(ctx->cbc, frag, i);
-    }
-
-    if (frag->nb_units == 0) {
-        // Don't return packets with nothing in them.
-        err = AVERROR(EAGAIN);
+    err = filter_units_filter_fragment(bsf, frag, pkt);
+    if (err < 0)
         goto fail;
-    }
 
     err = ff_cbs_write_packet(ctx->cbc, pkt, frag);
     if (err < 0) {
@@ -186,6 +199,8 @@ static int filter_units_init(AVBSFContext *bsf)
     ctx->cbc->decompose_unit_types    = ctx->type_list;
     ctx->cbc->nb_decompose_unit_types = 0;
 
+    ff_bsf_set_cbs_context(bsf, ctx->cbc);
+
     if (bsf->par_in->extradata) {
         CodedBitstreamFragment *frag = &ctx->fragment;
 
@@ -235,11 +250,12 @@ static const AVClass filter_units_class = {
 };
 
 const AVBitStreamFilter ff_filter_units_bsf = {
-    .name           = "filter_units",
-    .priv_data_size = sizeof(FilterUnitsContext),
-    .priv_class     = &filter_units_class,
-    .init           = &filter_units_init,
-    .close          = &filter_units_close,
-    .filter         = &filter_units_filter,
-    .codec_ids      = ff_cbs_all_codec_ids,
+    .name            = "filter_units",
+    .priv_data_size  = sizeof(FilterUnitsContext),
+    .priv_class      = &filter_units_class,
+    .init            = &filter_units_init,
+    .close           = &filter_units_close,
+    .filter          = &filter_units_filter,
+    .filter_fragment = &filter_units_filter_fragment,
+    .codec_ids       = ff_cbs_all_codec_ids,
 };
@@ -29,6 +29,7 @@
 #include "libavutil/thread.h"
 #include "avcodec.h"
 #include "internal.h"
+#include "pthread_internal.h"
 #include "thread.h"
 
 #define MAX_THREADS 64
@@ -65,6 +66,8 @@ static void * attribute_align_arg worker(void *v){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     AVPacket *pkt = NULL;
 
+    ff_thread_set_affinity(avctx);
+
     while (!atomic_load(&c->exit)) {
         int got_packet, ret;
         AVFrame *frame;
@@ -120,7 +123,13 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
 
 
     if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
+       || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY) && avctx->codec_id != AV_CODEC_ID_FFV1)
+        return 0;
+
+    /* FFV1 frames only are independent if each one is a keyframe, and
+     * the first pass statistics are accumulated over all frames */
+    if (avctx->codec_id == AV_CODEC_ID_FFV1 &&
+        (avctx->gop_size >= 2 || avctx->flags & AV_CODEC_FLAG_PASS1))
         return 0;
 
     if(   !avctx->thread_count
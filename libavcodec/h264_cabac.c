@@ -42,7 +42,9 @@
 #include "h264_mvpred.h"
 #include "mpegutils.h"
 
-#if ARCH_X86
+#if ARCH_AARCH64
+#include "aarch64/h264_cabac.c"
+#elif ARCH_X86
 #include "x86/h264_cabac.c"
 #endif
 
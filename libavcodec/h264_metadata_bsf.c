@@ -54,6 +54,7 @@ typedef struct H264MetadataContext {
     int done_first_au;
 
     int aud;
+    H264RawAUD aud_nal;
 
     AVRational sample_aspect_ratio;
 
@@ -275,27 +276,16 @@ static int h264_metadata_update_sps(AVBSFContext *bsf,
     return 0;
 }
 
-static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
+static int h264_metadata_filter_fragment(AVBSFContext *bsf,
+                                         CodedBitstreamFragment *au,
+                                         AVPacket *pkt)
 {
     H264MetadataContext *ctx = bsf->priv_data;
-    CodedBitstreamFragment *au = &ctx->access_unit;
     int err, i, j, has_sps;
-    H264RawAUD aud;
-
-    err = ff_bsf_get_packet_ref(bsf, pkt);
-    if (err < 0)
-        return err;
-
-    err = ff_cbs_read_packet(ctx->cbc, au, pkt);
-    if (err < 0) {
-        av_log(bsf, AV_LOG_ERROR, "Failed to read packet.\n");
-        goto fail;
-    }
 
     if (au->nb_units == 0) {
         av_log(bsf, AV_LOG_ERROR, "No NAL units in packet.\n");
-        err = AVERROR_INVALIDDATA;
-        goto fail;
+        return AVERROR_INVALIDDATA;
     }
 
     // If an AUD is present, it must be the first NAL unit.
@@ -333,20 +323,19 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
             if (j >= FF_ARRAY_ELEMS(primary_pic_type_table)) {
                 av_log(bsf, AV_LOG_ERROR, "No usable primary_pic_type: "
                        "invalid slice types?\n");
-                err = AVERROR_INVALIDDATA;
-                goto fail;
+                return AVERROR_INVALIDDATA;
             }
 
-            aud = (H264RawAUD) {
+            ctx->aud_nal = (H264RawAUD) {
                 .nal_unit_header.nal_unit_type = H264_NAL_AUD,
                 .primary_pic_type = j,
             };
 
-            err = ff_cbs_insert_unit_content(ctx->cbc, au,
-                                             0, H264_NAL_AUD, &aud, NULL);
+            err = ff_cbs_insert_unit_content(ctx->cbc, au, 0, H264_NAL_AUD,
+                                             &ctx->aud_nal, NULL);
             if (err < 0) {
                 av_log(bsf, AV_LOG_ERROR, "Failed to insert AUD.\n");
-                goto fail;
+                return err;
             }
         }
     }
@@ -356,7 +345,7 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
         if (au->units[i].type == H264_NAL_SPS) {
             err = h264_metadata_update_sps(bsf, au->units[i].content);
             if (err < 0)
-                goto fail;
+                return err;
             has_sps = 1;
         }
     }
@@ -392,8 +381,7 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
 
             udu->data_ref = av_buffer_alloc(len + 1);
             if (!udu->data_ref) {
-                err = AVERROR(ENOMEM);
-                goto fail;
+                return AVERROR(ENOMEM);
             }
 
             udu->data        = udu->data_ref->data;
@@ -404,15 +392,14 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
             if (err < 0) {
                 av_log(bsf, AV_LOG_ERROR, "Failed to add user data SEI "
                        "message to access unit.\n");
-                goto fail;
+                return err;
             }
 
         } else {
         invalid_user_data:
             av_log(bsf, AV_LOG_ERROR, "Invalid user data: "
                    "must be \"UUID+string\".\n");
-            err = AVERROR(EINVAL);
-            goto fail;
+            return AVERROR(EINVAL);
         }
     }
 
@@ -462,8 +449,7 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
 
                 matrix = av_malloc(9 * sizeof(int32_t));
                 if (!matrix) {
-                    err = AVERROR(ENOMEM);
-                    goto fail;
+                    return AVERROR(ENOMEM);
                 }
 
                 av_display_rotation_set(matrix,
@@ -481,7 +467,7 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
                     av_log(bsf, AV_LOG_ERROR, "Failed to attach extracted "
                            "displaymatrix side data to packet.\n");
                     av_freep(matrix);
-                    goto fail;
+                    return err;
                 }
             }
         }
@@ -551,19 +537,42 @@ static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
             if (err < 0) {
                 av_log(bsf, AV_LOG_ERROR, "Failed to add display orientation "
                        "SEI message to access unit.\n");
-                goto fail;
+                return err;
             }
         }
     }
 
+    ctx->done_first_au = 1;
+
+    return 0;
+}
+
+static int h264_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
+{
+    H264MetadataContext *ctx = bsf->priv_data;
+    CodedBitstreamFragment *au = &ctx->access_unit;
+    int err;
+
+    err = ff_bsf_get_packet_ref(bsf, pkt);
+    if (err < 0)
+        return err;
+
+    err = ff_cbs_read_packet(ctx->cbc, au, pkt);
+    if (err < 0) {
+        av_log(bsf, AV_LOG_ERROR, "Failed to read packet.\n");
+        goto fail;
+    }
+
+    err = h264_metadata_filter_fragment(bsf, au, pkt);
+    if (err < 0)
+        goto fail;
+
     err = ff_cbs_write_packet(ctx->cbc, pkt, au);
     if (err < 0) {
         av_log(bsf, AV_LOG_ERROR, "Failed to write packet.\n");
         goto fail;
     }
 
-    ctx->done_first_au = 1;
-
     err = 0;
 fail:
     ff_cbs_fragment_reset(ctx->cbc, au);
@@ -574,6 +583,12 @@ fail:
     return err;
 }
 
+// Unit types which need to be decomposed when neither slice headers nor
+// SEI messages are looked at; everything else is passed through as is.
+static const CodedBitstreamUnitType h264_metadata_sps_only[] = {
+    H264_NAL_SPS,
+};
+
 static int h264_metadata_init(AVBSFContext *bsf)
 {
     H264MetadataContext *ctx = bsf->priv_data;
@@ -584,6 +599,16 @@ static int h264_metadata_init(AVBSFContext *bsf)
     if (err < 0)
         return err;
 
+    ff_bsf_set_cbs_context(bsf, ctx->cbc);
+
+    if (ctx->aud != INSERT && !ctx->sei_user_data && !ctx->delete_filler &&
+        ctx->display_orientation == PASS) {
+        ctx->cbc->decompose_unit_types    =
+            (CodedBitstreamUnitType*)h264_metadata_sps_only;
+        ctx->cbc->nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(h264_metadata_sps_only);
+    }
+
     if (bsf->par_in->extradata) {
         err = ff_cbs_read_extradata(ctx->cbc, au, bsf->par_in);
         if (err < 0) {
@@ -757,11 +782,12 @@ static const enum AVCodecID h264_metadata_codec_ids[] = {
 };
 
 const AVBitStreamFilter ff_h264_metadata_bsf = {
-    .name           = "h264_metadata",
-    .priv_data_size = sizeof(H264MetadataContext),
-    .priv_class     = &h264_metadata_class,
-    .init           = &h264_metadata_init,
-    .close          = &h264_metadata_close,
-    .filter         = &h264_metadata_filter,
-    .codec_ids      = h264_metadata_codec_ids,
+    .name            = "h264_metadata",
+    .priv_data_size  = sizeof(H264MetadataContext),
+    .priv_class      = &h264_metadata_class,
+    .init            = &h264_metadata_init,
+    .close           = &h264_metadata_close,
+    .filter          = &h264_metadata_filter,
+    .filter_fragment = &h264_metadata_filter_fragment,
+    .codec_ids       = h264_metadata_codec_ids,
 };
@@ -39,30 +39,23 @@ typedef struct H264BSFContext {
     int      extradata_parsed;
 } H264BSFContext;
 
-static int alloc_and_copy(AVPacket *out,
-                          const uint8_t *sps_pps, uint32_t sps_pps_size,
-                          const uint8_t *in, uint32_t in_size, int ps)
+static void count_or_copy(uint8_t **out, uint64_t *out_size,
+                          const uint8_t *in, int in_size, int ps, int copy)
 {
-    uint32_t offset         = out->size;
-    uint8_t start_code_size = offset == 0 || ps ? 4 : 3;
-    int err;
-
-    err = av_grow_packet(out, sps_pps_size + in_size + start_code_size);
-    if (err < 0)
-        return err;
-
-    if (sps_pps)
-        memcpy(out->data + offset, sps_pps, sps_pps_size);
-    memcpy(out->data + sps_pps_size + start_code_size + offset, in, in_size);
-    if (start_code_size == 4) {
-        AV_WB32(out->data + offset + sps_pps_size, 1);
-    } else {
-        (out->data + offset + sps_pps_size)[0] =
-        (out->data + offset + sps_pps_size)[1] = 0;
-        (out->data + offset + sps_pps_size)[2] = 1;
+    uint8_t start_code_size = ps < 0 ? 0 : *out_size == 0 || ps ? 4 : 3;
+
+    if (copy) {
+        memcpy(*out + start_code_size, in, in_size);
+        if (start_code_size == 4) {
+            AV_WB32(*out, 1);
+        } else if (start_code_size) {
+            (*out)[0] =
+            (*out)[1] = 0;
+            (*out)[2] = 1;
+        }
+        *out  += start_code_size + in_size;
     }
-
-    return 0;
+    *out_size += start_code_size + in_size;
 }
 
 static int h264_extradata_to_annexb(AVBSFContext *ctx, const int padding)
@@ -164,18 +157,16 @@ static int h264_mp4toannexb_init(AVBSFContext *ctx)
     return 0;
 }
 
-static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
+static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
 {
     H264BSFContext *s = ctx->priv_data;
-
     AVPacket *in;
-    uint8_t unit_type;
-    int32_t nal_size;
-    uint32_t cumul_size    = 0;
+    uint8_t unit_type, new_idr, sps_seen, pps_seen;
     const uint8_t *buf;
     const uint8_t *buf_end;
-    int            buf_size;
-    int ret = 0, i;
+    uint8_t *out = NULL;
+    uint64_t out_size;
+    int ret;
 
     ret = ff_bsf_get_packet(ctx, &in);
     if (ret < 0)
@@ -183,94 +174,126 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
 
     /* nothing to filter */
     if (!s->extradata_parsed) {
-        av_packet_move_ref(out, in);
+        av_packet_move_ref(opkt, in);
         av_packet_free(&in);
         return 0;
     }
 
-    buf      = in->data;
-    buf_size = in->size;
     buf_end  = in->data + in->size;
 
-    do {
-        ret= AVERROR(EINVAL);
-        if (buf + s->length_size > buf_end)
-            goto fail;
-
-        for (nal_size = 0, i = 0; i<s->length_size; i++)
-            nal_size = (nal_size << 8) | buf[i];
-
-        buf += s->length_size;
-        unit_type = *buf & 0x1f;
-
-        if (nal_size > buf_end - buf || nal_size < 0)
-            goto fail;
-
-        if (unit_type == H264_NAL_SPS)
-            s->idr_sps_seen = s->new_idr = 1;
-        else if (unit_type == H264_NAL_PPS) {
-            s->idr_pps_seen = s->new_idr = 1;
-            /* if SPS has not been seen yet, prepend the AVCC one to PPS */
-            if (!s->idr_sps_seen) {
-                if (s->sps_offset == -1)
-                    av_log(ctx, AV_LOG_WARNING, "SPS not present in the stream, nor in AVCC, stream may be unreadable\n");
-                else {
-                    if ((ret = alloc_and_copy(out,
-                                         ctx->par_out->extradata + s->sps_offset,
-                                         s->pps_offset != -1 ? s->pps_offset : ctx->par_out->extradata_size - s->sps_offset,
-                                         buf, nal_size, 1)) < 0)
-                        goto fail;
-                    s->idr_sps_seen = 1;
-                    goto next_nal;
-                }
+#define LOG_ONCE(...) \
+    if (j) \
+        av_log(__VA_ARGS__)
+    /* The first pass only computes the size of the output, the second one
+     * writes it into a packet allocated once. */
+    for (int j = 0; j < 2; j++) {
+        buf      = in->data;
+        new_idr  = s->new_idr;
+        sps_seen = s->idr_sps_seen;
+        pps_seen = s->idr_pps_seen;
+        out_size = 0;
+
+        do {
+            int32_t nal_size = 0;
+            int ps;
+
+            if (buf + s->length_size > buf_end) {
+                ret = AVERROR(EINVAL);
+                goto fail;
             }
-        }
 
-        /* if this is a new IDR picture following an IDR picture, reset the idr flag.
-         * Just check first_mb_in_slice to be 0 as this is the simplest solution.
-         * This could be checking idr_pic_id instead, but would complexify the parsing. */
-        if (!s->new_idr && unit_type == H264_NAL_IDR_SLICE && (buf[1] & 0x80))
-            s->new_idr = 1;
-
-        /* prepend only to the first type 5 NAL unit of an IDR picture, if no sps/pps are already present */
-        if (s->new_idr && unit_type == H264_NAL_IDR_SLICE && !s->idr_sps_seen && !s->idr_pps_seen) {
-            if ((ret=alloc_and_copy(out,
-                               ctx->par_out->extradata, ctx->par_out->extradata_size,
-                               buf, nal_size, 1)) < 0)
-                goto fail;
-            s->new_idr = 0;
-        /* if only SPS has been seen, also insert PPS */
-        } else if (s->new_idr && unit_type == H264_NAL_IDR_SLICE && s->idr_sps_seen && !s->idr_pps_seen) {
-            if (s->pps_offset == -1) {
-                av_log(ctx, AV_LOG_WARNING, "PPS not present in the stream, nor in AVCC, stream may be unreadable\n");
-                if ((ret = alloc_and_copy(out, NULL, 0, buf, nal_size, 0)) < 0)
-                    goto fail;
-            } else if ((ret = alloc_and_copy(out,
-                                        ctx->par_out->extradata + s->pps_offset, ctx->par_out->extradata_size - s->pps_offset,
-                                        buf, nal_size, 1)) < 0)
+            for (int i = 0; i < s->length_size; i++)
+                nal_size = (nal_size << 8) | buf[i];
+
+            buf += s->length_size;
+            unit_type = *buf & 0x1f;
+
+            if (nal_size > buf_end - buf || nal_size < 0) {
+                ret = AVERROR(EINVAL);
                 goto fail;
-        } else {
-            if ((ret=alloc_and_copy(out, NULL, 0, buf, nal_size, unit_type == H264_NAL_SPS || unit_type == H264_NAL_PPS)) < 0)
+            }
+
+            ps = unit_type == H264_NAL_SPS || unit_type == H264_NAL_PPS;
+
+            if (unit_type == H264_NAL_SPS) {
+                sps_seen = new_idr = 1;
+            } else if (unit_type == H264_NAL_PPS) {
+                pps_seen = new_idr = 1;
+                /* if SPS has not been seen yet, prepend the AVCC one to PPS */
+                if (!sps_seen) {
+                    if (s->sps_offset == -1) {
+                        LOG_ONCE(ctx, AV_LOG_WARNING, "SPS not present in the stream, nor in AVCC, stream may be unreadable\n");
+                    } else {
+                        count_or_copy(&out, &out_size,
+                                      ctx->par_out->extradata + s->sps_offset,
+                                      s->pps_offset != -1 ? s->pps_offset : ctx->par_out->extradata_size - s->sps_offset,
+                                      -1, j);
+                        sps_seen = 1;
+                    }
+                }
+            }
+
+            /* if this is a new IDR picture following an IDR picture, reset the idr flag.
+             * Just check first_mb_in_slice to be 0 as this is the simplest solution.
+             * This could be checking idr_pic_id instead, but would complexify the parsing. */
+            if (!new_idr && unit_type == H264_NAL_IDR_SLICE && (buf[1] & 0x80))
+                new_idr = 1;
+
+            /* prepend only to the first type 5 NAL unit of an IDR picture, if no sps/pps are already present */
+            if (new_idr && unit_type == H264_NAL_IDR_SLICE && !sps_seen && !pps_seen) {
+                if (ctx->par_out->extradata)
+                    count_or_copy(&out, &out_size, ctx->par_out->extradata,
+                                  ctx->par_out->extradata_size, -1, j);
+                new_idr = 0;
+                ps      = 1;
+            /* if only SPS has been seen, also insert PPS */
+            } else if (new_idr && unit_type == H264_NAL_IDR_SLICE && sps_seen && !pps_seen) {
+                if (s->pps_offset == -1) {
+                    LOG_ONCE(ctx, AV_LOG_WARNING, "PPS not present in the stream, nor in AVCC, stream may be unreadable\n");
+                } else {
+                    count_or_copy(&out, &out_size,
+                                  ctx->par_out->extradata + s->pps_offset,
+                                  ctx->par_out->extradata_size - s->pps_offset,
+                                  -1, j);
+                    ps = 1;
+                }
+            } else if (!new_idr && unit_type == H264_NAL_SLICE) {
+                new_idr  = 1;
+                sps_seen = 0;
+                pps_seen = 0;
+            }
+
+            count_or_copy(&out, &out_size, buf, nal_size, ps, j);
+
+            buf += nal_size;
+        } while (buf < buf_end);
+
+        if (!j) {
+            if (out_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+                ret = AVERROR_INVALIDDATA;
                 goto fail;
-            if (!s->new_idr && unit_type == H264_NAL_SLICE) {
-                s->new_idr = 1;
-                s->idr_sps_seen = 0;
-                s->idr_pps_seen = 0;
             }
+            ret = av_new_packet(opkt, out_size);
+            if (ret < 0)
+                goto fail;
+            out = opkt->data;
         }
+    }
+#undef LOG_ONCE
+
+    av_assert1(out_size == opkt->size);
 
-next_nal:
-        buf        += nal_size;
-        cumul_size += nal_size + s->length_size;
-    } while (cumul_size < buf_size);
+    s->new_idr      = new_idr;
+    s->idr_sps_seen = sps_seen;
+    s->idr_pps_seen = pps_seen;
 
-    ret = av_packet_copy_props(out, in);
+    ret = av_packet_copy_props(opkt, in);
     if (ret < 0)
         goto fail;
 
 fail:
     if (ret < 0)
-        av_packet_unref(out);
+        av_packet_unref(opkt);
     av_packet_free(&in);
 
     return ret;
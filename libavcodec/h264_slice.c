@@ -182,6 +182,11 @@ static int init_table_pools(H264Context *h)
         return AVERROR(ENOMEM);
     }
 
+    av_buffer_pool_set_mem_tag(h->qscale_table_pool, AV_MEM_TAG_CODEC);
+    av_buffer_pool_set_mem_tag(h->mb_type_pool,      AV_MEM_TAG_CODEC);
+    av_buffer_pool_set_mem_tag(h->motion_val_pool,   AV_MEM_TAG_CODEC);
+    av_buffer_pool_set_mem_tag(h->ref_index_pool,    AV_MEM_TAG_CODEC);
+
     return 0;
 }
 
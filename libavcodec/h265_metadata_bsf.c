@@ -336,26 +336,16 @@ static int h265_metadata_update_sps(AVBSFContext *bsf,
     return 0;
 }
 
-static int h265_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
+static int h265_metadata_filter_fragment(AVBSFContext *bsf,
+                                         CodedBitstreamFragment *au,
+                                         AVPacket *pkt)
 {
     H265MetadataContext *ctx = bsf->priv_data;
-    CodedBitstreamFragment *au = &ctx->access_unit;
     int err, i;
 
-    err = ff_bsf_get_packet_ref(bsf, pkt);
-    if (err < 0)
-        return err;
-
-    err = ff_cbs_read_packet(ctx->cbc, au, pkt);
-    if (err < 0) {
-        av_log(bsf, AV_LOG_ERROR, "Failed to read packet.\n");
-        goto fail;
-    }
-
     if (au->nb_units == 0) {
         av_log(bsf, AV_LOG_ERROR, "No NAL units in packet.\n");
-        err = AVERROR_INVALIDDATA;
-        goto fail;
+        return AVERROR_INVALIDDATA;
     }
 
     // If an AUD is present, it must be the first NAL unit.
@@ -397,7 +387,7 @@ static int h265_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
                                              0, HEVC_NAL_AUD, aud, NULL);
             if (err < 0) {
                 av_log(bsf, AV_LOG_ERROR, "Failed to insert AUD.\n");
-                goto fail;
+                return err;
             }
         }
     }
@@ -409,15 +399,38 @@ static int h265_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
         if (au->units[i].type == HEVC_NAL_VPS) {
             err = h265_metadata_update_vps(bsf, au->units[i].content);
             if (err < 0)
-                goto fail;
+                return err;
         }
         if (au->units[i].type == HEVC_NAL_SPS) {
             err = h265_metadata_update_sps(bsf, au->units[i].content);
             if (err < 0)
-                goto fail;
+                return err;
         }
     }
 
+    return 0;
+}
+
+static int h265_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
+{
+    H265MetadataContext *ctx = bsf->priv_data;
+    CodedBitstreamFragment *au = &ctx->access_unit;
+    int err;
+
+    err = ff_bsf_get_packet_ref(bsf, pkt);
+    if (err < 0)
+        return err;
+
+    err = ff_cbs_read_packet(ctx->cbc, au, pkt);
+    if (err < 0) {
+        av_log(bsf, AV_LOG_ERROR, "Failed to read packet.\n");
+        goto fail;
+    }
+
+    err = h265_metadata_filter_fragment(bsf, au, pkt);
+    if (err < 0)
+        goto fail;
+
     err = ff_cbs_write_packet(ctx->cbc, pkt, au);
     if (err < 0) {
         av_log(bsf, AV_LOG_ERROR, "Failed to write packet.\n");
@@ -434,6 +447,14 @@ fail:
     return err;
 }
 
+// Unit types which need to be decomposed when slice headers are not
+// looked at; everything else is passed through as is.
+static const CodedBitstreamUnitType h265_metadata_parameter_sets[] = {
+    HEVC_NAL_VPS,
+    HEVC_NAL_SPS,
+    HEVC_NAL_PPS,
+};
+
 static int h265_metadata_init(AVBSFContext *bsf)
 {
     H265MetadataContext *ctx = bsf->priv_data;
@@ -444,6 +465,15 @@ static int h265_metadata_init(AVBSFContext *bsf)
     if (err < 0)
         return err;
 
+    ff_bsf_set_cbs_context(bsf, ctx->cbc);
+
+    if (ctx->aud != INSERT) {
+        ctx->cbc->decompose_unit_types    =
+            (CodedBitstreamUnitType*)h265_metadata_parameter_sets;
+        ctx->cbc->nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(h265_metadata_parameter_sets);
+    }
+
     if (bsf->par_in->extradata) {
         err = ff_cbs_read_extradata(ctx->cbc, au, bsf->par_in);
         if (err < 0) {
@@ -586,11 +616,12 @@ static const enum AVCodecID h265_metadata_codec_ids[] = {
 };
 
 const AVBitStreamFilter ff_hevc_metadata_bsf = {
-    .name           = "hevc_metadata",
-    .priv_data_size = sizeof(H265MetadataContext),
-    .priv_class     = &h265_metadata_class,
-    .init           = &h265_metadata_init,
-    .close          = &h265_metadata_close,
-    .filter         = &h265_metadata_filter,
-    .codec_ids      = h265_metadata_codec_ids,
+    .name            = "hevc_metadata",
+    .priv_data_size  = sizeof(H265MetadataContext),
+    .priv_class      = &h265_metadata_class,
+    .init            = &h265_metadata_init,
+    .close           = &h265_metadata_close,
+    .filter          = &h265_metadata_filter,
+    .filter_fragment = &h265_metadata_filter_fragment,
+    .codec_ids       = h265_metadata_codec_ids,
 };
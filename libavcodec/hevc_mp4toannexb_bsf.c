@@ -120,8 +120,9 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
     HEVCBSFContext *s = ctx->priv_data;
     AVPacket *in;
     GetByteContext gb;
+    uint8_t *dst = NULL;
+    uint64_t out_size;
 
-    int got_irap = 0;
     int i, ret = 0;
 
     ret = ff_bsf_get_packet(ctx, &in);
@@ -134,40 +135,57 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
         return 0;
     }
 
-    bytestream2_init(&gb, in->data, in->size);
+    /* The first pass only computes the size of the output, the second one
+     * writes it into a packet allocated once. */
+    for (int pass = 0; pass < 2; pass++) {
+        int got_irap = 0;
 
-    while (bytestream2_get_bytes_left(&gb)) {
-        uint32_t nalu_size = 0;
-        int      nalu_type;
-        int is_irap, add_extradata, extra_size, prev_size;
+        bytestream2_init(&gb, in->data, in->size);
+        out_size = 0;
 
-        for (i = 0; i < s->length_size; i++)
-            nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
+        while (bytestream2_get_bytes_left(&gb)) {
+            uint32_t nalu_size = 0;
+            int      nalu_type;
+            int is_irap, add_extradata, extra_size;
 
-        nalu_type = (bytestream2_peek_byte(&gb) >> 1) & 0x3f;
+            for (i = 0; i < s->length_size; i++)
+                nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
 
-        /* prepend extradata to IRAP frames */
-        is_irap       = nalu_type >= 16 && nalu_type <= 23;
-        add_extradata = is_irap && !got_irap;
-        extra_size    = add_extradata * ctx->par_out->extradata_size;
-        got_irap     |= is_irap;
+            nalu_type = (bytestream2_peek_byte(&gb) >> 1) & 0x3f;
 
-        if (SIZE_MAX - nalu_size < 4 ||
-            SIZE_MAX - 4 - nalu_size < extra_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
-        }
+            /* prepend extradata to IRAP frames */
+            is_irap       = nalu_type >= 16 && nalu_type <= 23;
+            add_extradata = is_irap && !got_irap;
+            extra_size    = add_extradata * ctx->par_out->extradata_size;
+            got_irap     |= is_irap;
 
-        prev_size = out->size;
+            if (nalu_size > bytestream2_get_bytes_left(&gb)) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
 
-        ret = av_grow_packet(out, 4 + nalu_size + extra_size);
-        if (ret < 0)
-            goto fail;
+            if (pass) {
+                if (add_extradata)
+                    memcpy(dst, ctx->par_out->extradata, extra_size);
+                AV_WB32(dst + extra_size, 1);
+                bytestream2_get_buffer(&gb, dst + extra_size + 4, nalu_size);
+                dst += extra_size + 4 + nalu_size;
+            } else {
+                bytestream2_skip(&gb, nalu_size);
+            }
+            out_size += extra_size + 4 + nalu_size;
+        }
 
-        if (add_extradata)
-            memcpy(out->data + prev_size, ctx->par_out->extradata, extra_size);
-        AV_WB32(out->data + prev_size + extra_size, 1);
-        bytestream2_get_buffer(&gb, out->data + prev_size + 4 + extra_size, nalu_size);
+        if (!pass) {
+            if (out_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+            ret = av_new_packet(out, out_size);
+            if (ret < 0)
+                goto fail;
+            dst = out->data;
+        }
     }
 
     ret = av_packet_copy_props(out, in);
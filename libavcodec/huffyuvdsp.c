@@ -86,6 +86,8 @@ av_cold void ff_huffyuvdsp_init(HuffYUVDSPContext *c, enum AVPixelFormat pix_fmt
     c->add_hfyu_median_pred_int16 = add_hfyu_median_pred_int16_c;
     c->add_hfyu_left_pred_bgr32 = add_hfyu_left_pred_bgr32_c;
 
+    if (ARCH_AARCH64)
+        ff_huffyuvdsp_init_aarch64(c, pix_fmt);
     if (ARCH_X86)
         ff_huffyuvdsp_init_x86(c, pix_fmt);
 }
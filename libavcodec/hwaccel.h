@@ -24,6 +24,7 @@
 
 
 #define HWACCEL_CAP_ASYNC_SAFE      (1 << 0)
+#define HWACCEL_CAP_OUTPUT_RESIZE   (1 << 1)
 
 
 typedef struct AVCodecHWConfigInternal {
@@ -68,6 +68,12 @@
  * Codec initializes slice-based threading with a main function
  */
 #define FF_CODEC_CAP_SLICE_THREAD_HAS_MF    (1 << 5)
+/**
+ * The codec supports slice threading inside each frame thread, using
+ * AVCodecContext.execute/execute2 and the ff_thread_*_progress2() functions
+ * from the frame thread contexts.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 6)
 
 #ifdef TRACE
 #   define ff_tlog(ctx, ...) av_log(ctx, AV_LOG_TRACE, __VA_ARGS__)
@@ -162,6 +168,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context of a frame thread when frame and slice
+     * threading are combined.
+     */
+    void *slice_thread_ctx;
+
     DecodeSimpleContext ds;
     DecodeFilterContext filter;
 
@@ -87,6 +87,15 @@ typedef struct Jpeg2000Tile {
     int coord[2][2];                    // border coordinates {{x0, x1}, {y0, y1}}
 } Jpeg2000Tile;
 
+/* A code-block to decode, when they are decoded in parallel */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                 bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -121,6 +130,12 @@ typedef struct Jpeg2000DecoderContext {
     Jpeg2000Tile    *tile;
     Jpeg2000DSPContext dsp;
 
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+    int             nb_cblk_jobs;
+    uint8_t         *comp_coded;    // per tile component, if any code-block has data
+    unsigned int    comp_coded_size;
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1693,6 +1708,42 @@ static inline void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     s->dsp.mct_decode[tile->codsty[0].transform](src[0], src[1], src[2], csize);
 }
 
+/* Decode a code-block and dequantize it into the component data.
+ * Return 0 if the code-block has no data. */
+static int decode_dequantize_cblk(Jpeg2000DecoderContext *s, Jpeg2000Component *comp,
+                                  Jpeg2000CodingStyle *codsty, Jpeg2000Band *band,
+                                  Jpeg2000Cblk *cblk, int bandpos,
+                                  Jpeg2000T1Context *t1)
+{
+    int x, y;
+    int ret;
+
+    t1->stride = (1<<codsty->log2_cblk_width) + 2;
+
+    ret = decode_cblk(s, codsty, t1, cblk,
+                      cblk->coord[0][1] - cblk->coord[0][0],
+                      cblk->coord[1][1] - cblk->coord[1][0],
+                      bandpos);
+    if (!ret)
+        return 0;
+
+    x = cblk->coord[0][0] - band->coord[0][0];
+    y = cblk->coord[1][0] - band->coord[1][0];
+
+    if (codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, comp, t1, band);
+    else if (codsty->transform == FF_DWT97_INT)
+        dequantization_int_97(x, y, cblk, comp, t1, band);
+    else
+        dequantization_int(x, y, cblk, comp, t1, band);
+    return 1;
+}
+
+static void dwt_decode(Jpeg2000Component *comp, Jpeg2000CodingStyle *codsty)
+{
+    ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+}
+
 static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
 {
     Jpeg2000T1Context t1;
@@ -1705,8 +1756,6 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
         Jpeg2000CodingStyle *codsty = tile->codsty + compno;
         int coded = 0;
 
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
-
         /* Loop on resolution levels */
         for (reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
             Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
@@ -1731,25 +1780,10 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
                     for (cblkno = 0;
                          cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
                          cblkno++) {
-                        int x, y;
                         Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        int ret = decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-                        if (ret)
+                        if (decode_dequantize_cblk(s, comp, codsty, band, cblk,
+                                                   bandpos, &t1))
                             coded = 1;
-                        else
-                            continue;
-                        x = cblk->coord[0][0] - band->coord[0][0];
-                        y = cblk->coord[1][0] - band->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else if (codsty->transform == FF_DWT97_INT)
-                            dequantization_int_97(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
@@ -1757,11 +1791,114 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
 
         /* inverse DWT */
         if (coded)
-            ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+            dwt_decode(comp, codsty);
 
     } /*end comp */
 }
 
+/* List the code-blocks of all the tiles, to decode them in parallel. */
+static int prepare_cblk_jobs(Jpeg2000DecoderContext *s)
+{
+    int nb_tiles = s->numXtiles * s->numYtiles;
+    int tileno, compno, reslevelno, bandno, precno, cblkno;
+    int nb_jobs = 0;
+    Jpeg2000CblkJob *job;
+
+    for (tileno = 0; tileno < nb_tiles; tileno++) {
+        Jpeg2000Tile *tile = s->tile + tileno;
+        for (compno = 0; compno < s->ncomponents; compno++) {
+            Jpeg2000Component *comp = tile->comp + compno;
+            for (reslevelno = 0; reslevelno < tile->codsty[compno].nreslevels2decode; reslevelno++) {
+                Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
+                for (bandno = 0; bandno < rlevel->nbands; bandno++) {
+                    Jpeg2000Band *band = rlevel->band + bandno;
+                    int nb_precincts = rlevel->num_precincts_x * rlevel->num_precincts_y;
+
+                    if (band->coord[0][0] == band->coord[0][1] ||
+                        band->coord[1][0] == band->coord[1][1])
+                        continue;
+                    for (precno = 0; precno < nb_precincts; precno++) {
+                        Jpeg2000Prec *prec = band->prec + precno;
+                        if (prec->nb_codeblocks_width * prec->nb_codeblocks_height > INT_MAX - nb_jobs)
+                            return AVERROR(ENOMEM);
+                        nb_jobs += prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+                    }
+                }
+            }
+        }
+    }
+
+    if (nb_jobs > INT_MAX / sizeof(*s->cblk_jobs))
+        return AVERROR(ENOMEM);
+    av_fast_malloc(&s->cblk_jobs, &s->cblk_jobs_size, nb_jobs * sizeof(*s->cblk_jobs));
+    av_fast_malloc(&s->comp_coded, &s->comp_coded_size, nb_tiles * s->ncomponents);
+    if (!s->cblk_jobs || !s->comp_coded)
+        return AVERROR(ENOMEM);
+    memset(s->comp_coded, 0, nb_tiles * s->ncomponents);
+
+    job = s->cblk_jobs;
+    for (tileno = 0; tileno < nb_tiles; tileno++) {
+        Jpeg2000Tile *tile = s->tile + tileno;
+        for (compno = 0; compno < s->ncomponents; compno++) {
+            Jpeg2000Component *comp     = tile->comp + compno;
+            Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+            for (reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
+                Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
+                for (bandno = 0; bandno < rlevel->nbands; bandno++) {
+                    Jpeg2000Band *band = rlevel->band + bandno;
+                    int nb_precincts = rlevel->num_precincts_x * rlevel->num_precincts_y;
+
+                    if (band->coord[0][0] == band->coord[0][1] ||
+                        band->coord[1][0] == band->coord[1][1])
+                        continue;
+                    for (precno = 0; precno < nb_precincts; precno++) {
+                        Jpeg2000Prec *prec = band->prec + precno;
+                        for (cblkno = 0;
+                             cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+                             cblkno++) {
+                            job->comp    = comp;
+                            job->codsty  = codsty;
+                            job->band    = band;
+                            job->cblk    = prec->cblk + cblkno;
+                            job->bandpos = bandno + (reslevelno > 0);
+                            if (job->cblk->length)
+                                s->comp_coded[tileno * s->ncomponents + compno] = 1;
+                            job++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    s->nb_cblk_jobs = nb_jobs;
+
+    return 0;
+}
+
+static int jpeg2000_decode_cblk_job(AVCodecContext *avctx, void *td,
+                                    int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000CblkJob *job      = s->cblk_jobs + jobnr;
+    Jpeg2000T1Context t1;
+
+    decode_dequantize_cblk(s, job->comp, job->codsty, job->band, job->cblk,
+                           job->bandpos, &t1);
+    return 0;
+}
+
+static int jpeg2000_dwt_job(AVCodecContext *avctx, void *td,
+                            int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000Tile *tile        = s->tile + jobnr / s->ncomponents;
+    int compno                = jobnr % s->ncomponents;
+
+    if (s->comp_coded[jobnr])
+        dwt_decode(tile->comp + compno, tile->codsty + compno);
+    return 0;
+}
+
 #define WRITE_FRAME(D, PIXEL)                                                                     \
     static inline void write_frame_ ## D(Jpeg2000DecoderContext * s, Jpeg2000Tile * tile,         \
                                          AVFrame * picture, int precision)                        \
@@ -1824,16 +1961,15 @@ WRITE_FRAME(16, uint16_t)
 
 #undef WRITE_FRAME
 
-static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
-                                int jobnr, int threadnr)
+/* Convert a tile with decoded code-blocks to pixels. */
+static int jpeg2000_write_tile(AVCodecContext *avctx, void *td,
+                               int jobnr, int threadnr)
 {
     Jpeg2000DecoderContext *s = avctx->priv_data;
     AVFrame *picture = td;
     Jpeg2000Tile *tile = s->tile + jobnr;
     int x;
 
-    tile_codeblocks(s, tile);
-
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
         mct_decode(s, tile);
@@ -1863,6 +1999,15 @@ static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
     return 0;
 }
 
+static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
+                                int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    tile_codeblocks(s, s->tile + jobnr);
+    return jpeg2000_write_tile(avctx, td, jobnr, threadnr);
+}
+
 static void jpeg2000_dec_cleanup(Jpeg2000DecoderContext *s)
 {
     int tileno, compno;
@@ -2237,7 +2382,21 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
     if (ret = jpeg2000_read_bitstream_packets(s))
         goto end;
 
-    avctx->execute2(avctx, jpeg2000_decode_tile, picture, NULL, s->numXtiles * s->numYtiles);
+    /* With fewer tiles than threads, typically a single tile, parallelize
+     * the code-block decoding and the per component DWT instead. */
+    if (avctx->active_thread_type == FF_THREAD_SLICE &&
+        s->numXtiles * s->numYtiles < avctx->thread_count) {
+        if ((ret = prepare_cblk_jobs(s)) < 0)
+            goto end;
+        if (s->nb_cblk_jobs)
+            avctx->execute2(avctx, jpeg2000_decode_cblk_job, NULL, NULL, s->nb_cblk_jobs);
+        avctx->execute2(avctx, jpeg2000_dwt_job, NULL, NULL,
+                        s->numXtiles * s->numYtiles * s->ncomponents);
+        avctx->execute2(avctx, jpeg2000_write_tile, picture, NULL,
+                        s->numXtiles * s->numYtiles);
+    } else {
+        avctx->execute2(avctx, jpeg2000_decode_tile, picture, NULL, s->numXtiles * s->numYtiles);
+    }
 
     jpeg2000_dec_cleanup(s);
 
@@ -2256,6 +2415,18 @@ end:
     return ret;
 }
 
+static av_cold int jpeg2000_decode_close(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+    av_freep(&s->comp_coded);
+    s->comp_coded_size = 0;
+
+    return 0;
+}
+
 #define OFFSET(x) offsetof(Jpeg2000DecoderContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 
@@ -2281,6 +2452,7 @@ AVCodec ff_jpeg2000_decoder = {
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init             = jpeg2000_decode_init,
     .decode           = jpeg2000_decode_frame,
+    .close            = jpeg2000_decode_close,
     .priv_class       = &jpeg2000_class,
     .max_lowres       = 5,
     .profiles         = NULL_IF_CONFIG_SMALL(ff_jpeg2000_profiles)
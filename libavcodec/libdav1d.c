@@ -25,6 +25,7 @@
 #include "libavutil/mastering_display_metadata.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 
 #include "avcodec.h"
 #include "decode.h"
@@ -36,6 +37,10 @@ typedef struct Libdav1dContext {
     AVBufferPool *pool;
     int pool_size;
 
+    AVCodecContext *avctx;
+    AVMutex get_buffer_lock;
+    int use_get_buffer;
+
     Dav1dData data;
     int tile_threads;
     int frame_threads;
@@ -62,18 +67,67 @@ static void libdav1d_log_callback(void *opaque, const char *fmt, va_list vl)
     av_vlog(c, AV_LOG_ERROR, fmt, vl);
 }
 
+/* Try to make the picture point into a frame from the user's get_buffer2(),
+ * which then directly receives the decoded picture. */
+static int libdav1d_get_buffer(Libdav1dContext *dav1d, Dav1dPicture *p,
+                               AVFrame *f, enum AVPixelFormat format)
+{
+    AVCodecContext *c = dav1d->avctx;
+    int nb_planes = p->p.layout == DAV1D_PIXEL_LAYOUT_I400 ? 1 : 3;
+    int ret;
+
+    f->format = format;
+    f->width  = FFALIGN(p->p.w, 128);
+    // dav1d wants DAV1D_PICTURE_ALIGNMENT bytes of padding after each plane.
+    f->height = FFALIGN(p->p.h, 128) + 2;
+
+    ff_mutex_lock(&dav1d->get_buffer_lock);
+    ret = dav1d->use_get_buffer ? c->get_buffer2(c, f, AV_GET_BUFFER_FLAG_REF)
+                                : AVERROR(ENOSYS);
+    ff_mutex_unlock(&dav1d->get_buffer_lock);
+    if (ret < 0)
+        return ret;
+
+    // dav1d uses a single stride for both chroma planes.
+    for (int i = 0; i < nb_planes; i++) {
+        if (!f->data[i] || (uintptr_t)f->data[i] % DAV1D_PICTURE_ALIGNMENT ||
+            f->linesize[i] % DAV1D_PICTURE_ALIGNMENT ||
+            f->linesize[i] != f->linesize[!!i])
+            ret = AVERROR(EINVAL);
+    }
+    if (ret < 0) {
+        av_frame_unref(f);
+        ff_mutex_lock(&dav1d->get_buffer_lock);
+        if (dav1d->use_get_buffer)
+            av_log(c, AV_LOG_VERBOSE, "Buffers from get_buffer2() are not "
+                   "suitable for libdav1d, using internal buffers.\n");
+        dav1d->use_get_buffer = 0;
+        ff_mutex_unlock(&dav1d->get_buffer_lock);
+        return ret;
+    }
+
+    return 0;
+}
+
 static int libdav1d_picture_allocator(Dav1dPicture *p, void *cookie)
 {
     Libdav1dContext *dav1d = cookie;
     enum AVPixelFormat format = pix_fmt[p->p.layout][p->seq_hdr->hbd];
     int ret, linesize[4], h = FFALIGN(p->p.h, 128);
     uint8_t *aligned_ptr, *data[4];
-    AVBufferRef *buf;
+    AVFrame *f;
+
+    f = av_frame_alloc();
+    if (!f)
+        return AVERROR(ENOMEM);
+
+    if (dav1d->use_get_buffer && libdav1d_get_buffer(dav1d, p, f, format) >= 0)
+        goto done;
 
     ret = av_image_fill_arrays(data, linesize, NULL, format, FFALIGN(p->p.w, 128),
                                h, DAV1D_PICTURE_ALIGNMENT);
     if (ret < 0)
-        return ret;
+        goto fail;
 
     if (ret != dav1d->pool_size) {
         av_buffer_pool_uninit(&dav1d->pool);
@@ -81,40 +135,50 @@ static int libdav1d_picture_allocator(Dav1dPicture *p, void *cookie)
         dav1d->pool = av_buffer_pool_init(ret + DAV1D_PICTURE_ALIGNMENT * 2, NULL);
         if (!dav1d->pool) {
             dav1d->pool_size = 0;
-            return AVERROR(ENOMEM);
+            ret = AVERROR(ENOMEM);
+            goto fail;
         }
         dav1d->pool_size = ret;
     }
-    buf = av_buffer_pool_get(dav1d->pool);
-    if (!buf)
-        return AVERROR(ENOMEM);
+    f->buf[0] = av_buffer_pool_get(dav1d->pool);
+    if (!f->buf[0]) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
 
     // libdav1d requires DAV1D_PICTURE_ALIGNMENT aligned buffers, which av_malloc()
     // doesn't guarantee for example when AVX is disabled at configure time.
     // Use the extra DAV1D_PICTURE_ALIGNMENT padding bytes in the buffer to align it
     // if required.
-    aligned_ptr = (uint8_t *)FFALIGN((uintptr_t)buf->data, DAV1D_PICTURE_ALIGNMENT);
+    aligned_ptr = (uint8_t *)FFALIGN((uintptr_t)f->buf[0]->data, DAV1D_PICTURE_ALIGNMENT);
     ret = av_image_fill_pointers(data, format, h, aligned_ptr, linesize);
-    if (ret < 0) {
-        av_buffer_unref(&buf);
-        return ret;
+    if (ret < 0)
+        goto fail;
+
+    for (int i = 0; i < 3; i++) {
+        f->data[i]     = data[i];
+        f->linesize[i] = linesize[i];
     }
 
-    p->data[0] = data[0];
-    p->data[1] = data[1];
-    p->data[2] = data[2];
-    p->stride[0] = linesize[0];
-    p->stride[1] = linesize[1];
-    p->allocator_data = buf;
+done:
+    p->data[0] = f->data[0];
+    p->data[1] = f->data[1];
+    p->data[2] = f->data[2];
+    p->stride[0] = f->linesize[0];
+    p->stride[1] = f->linesize[1];
+    p->allocator_data = f;
 
     return 0;
+fail:
+    av_frame_free(&f);
+    return ret;
 }
 
 static void libdav1d_picture_release(Dav1dPicture *p, void *cookie)
 {
-    AVBufferRef *buf = p->allocator_data;
+    AVFrame *f = p->allocator_data;
 
-    av_buffer_unref(&buf);
+    av_frame_free(&f);
 }
 
 static av_cold int libdav1d_init(AVCodecContext *c)
@@ -126,6 +190,8 @@ static av_cold int libdav1d_init(AVCodecContext *c)
 
     av_log(c, AV_LOG_INFO, "libdav1d %s\n", dav1d_version());
 
+    dav1d->avctx = c;
+
     dav1d_default_settings(&s);
     s.logger.cookie = c;
     s.logger.callback = libdav1d_log_callback;
@@ -149,9 +215,17 @@ static av_cold int libdav1d_init(AVCodecContext *c)
     av_log(c, AV_LOG_DEBUG, "Using %d frame threads, %d tile threads\n",
            s.n_frame_threads, s.n_tile_threads);
 
+    // With frame threads, pictures are allocated from dav1d's threads.
+    dav1d->use_get_buffer = c->get_buffer2 != avcodec_default_get_buffer2 &&
+                            (s.n_frame_threads == 1 || c->thread_safe_callbacks);
+    if (ff_mutex_init(&dav1d->get_buffer_lock, NULL))
+        return AVERROR(ENOMEM);
+
     res = dav1d_open(&dav1d->c, &s);
-    if (res < 0)
+    if (res < 0) {
+        ff_mutex_destroy(&dav1d->get_buffer_lock);
         return AVERROR(ENOMEM);
+    }
 
     return 0;
 }
@@ -243,10 +317,10 @@ static int libdav1d_receive_frame(AVCodecContext *c, AVFrame *frame)
     av_assert0(p->data[0] && p->allocator_data);
 
     // This requires the custom allocator above
-    frame->buf[0] = av_buffer_ref(p->allocator_data);
-    if (!frame->buf[0]) {
+    res = av_frame_ref(frame, p->allocator_data);
+    if (res < 0) {
         dav1d_picture_unref(p);
-        return AVERROR(ENOMEM);
+        return res;
     }
 
     frame->data[0] = p->data[0];
@@ -374,6 +448,7 @@ static av_cold int libdav1d_close(AVCodecContext *c)
     av_buffer_pool_uninit(&dav1d->pool);
     dav1d_data_unref(&dav1d->data);
     dav1d_close(&dav1d->c);
+    ff_mutex_destroy(&dav1d->get_buffer_lock);
 
     return 0;
 }
@@ -406,7 +481,7 @@ AVCodec ff_libdav1d_decoder = {
     .close          = libdav1d_close,
     .flush          = libdav1d_flush,
     .receive_frame  = libdav1d_receive_frame,
-    .capabilities   = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_AUTO_THREADS,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_AUTO_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_SETS_PKT_DTS,
     .priv_class     = &libdav1d_class,
     .wrapper_name   = "libdav1d",
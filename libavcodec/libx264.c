@@ -128,15 +128,18 @@ static int encode_nals(AVCodecContext *ctx, AVPacket *pkt,
 {
     X264Context *x4 = ctx->priv_data;
     uint8_t *p;
-    int i, size = x4->sei_size, ret;
+    int i, size, nals_size = 0, ret;
 
     if (!nnal)
         return 0;
 
     for (i = 0; i < nnal; i++)
-        size += nals[i].i_payload;
+        nals_size += nals[i].i_payload;
+    size = x4->sei_size + nals_size;
 
-    if ((ret = ff_alloc_packet2(ctx, pkt, size, 0)) < 0)
+    /* Allocate the final packet directly: going through the internal
+     * byte buffer would cost another copy of the whole frame. */
+    if ((ret = ff_alloc_packet2(ctx, pkt, size, size)) < 0)
         return ret;
 
     p = pkt->data;
@@ -153,10 +156,9 @@ static int encode_nals(AVCodecContext *ctx, AVPacket *pkt,
         av_freep(&x4->sei);
     }
 
-    for (i = 0; i < nnal; i++){
-        memcpy(p, nals[i].p_payload, nals[i].i_payload);
-        p += nals[i].i_payload;
-    }
+    /* x264 guarantees the payloads of all output NALs to be sequential
+     * in memory. */
+    memcpy(p, nals[0].p_payload, nals_size);
 
     return 1;
 }
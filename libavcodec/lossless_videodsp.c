@@ -118,6 +118,8 @@ void ff_llviddsp_init(LLVidDSPContext *c)
     c->add_left_pred_int16        = add_left_pred_int16_c;
     c->add_gradient_pred          = add_gradient_pred_c;
 
+    if (ARCH_AARCH64)
+        ff_llviddsp_init_aarch64(c);
     if (ARCH_PPC)
         ff_llviddsp_init_ppc(c);
     if (ARCH_X86)
@@ -316,6 +316,8 @@ av_cold int ff_mdct15_init(MDCT15Context **ps, int inverse, int N, double scale)
         s->exptab[20].im *= -1;
     }
 
+    if (ARCH_AARCH64)
+        ff_mdct15_init_aarch64(s);
     if (ARCH_X86)
         ff_mdct15_init_x86(s);
 
@@ -57,6 +57,7 @@ typedef struct MDCT15Context {
 int ff_mdct15_init(MDCT15Context **ps, int inverse, int N, double scale);
 void ff_mdct15_uninit(MDCT15Context **ps);
 
+void ff_mdct15_init_aarch64(MDCT15Context *s);
 void ff_mdct15_init_x86(MDCT15Context *s);
 
 #endif /* AVCODEC_MDCT15_H */
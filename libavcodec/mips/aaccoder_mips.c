@@ -1477,6 +1477,16 @@ static float quantize_band_cost_bits(struct AACEncContext *s, const float *in,
     return get_band_numbits(s, NULL, in, scaled, size, scale_idx, cb, lambda, uplim, bits);
 }
 
+static int quantize_band_cost_bits_pair(struct AACEncContext *s, const float *in,
+                                        const float *scaled, int size, int scale_idx,
+                                        int cb, int *next_bits, int rtz)
+{
+    *next_bits = quantize_band_cost_bits(s, in, scaled, size, scale_idx, cb + 1,
+                                         0.0f, INFINITY, NULL, NULL, rtz);
+    return quantize_band_cost_bits(s, in, scaled, size, scale_idx, cb,
+                                   0.0f, INFINITY, NULL, NULL, rtz);
+}
+
 /**
  * Functions developed from template function and optimized for getting the band cost
  */
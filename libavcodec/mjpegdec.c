@@ -770,10 +770,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -782,47 +783,48 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int16_t *block, int *last_dc, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
     val = av_clip_int16(val);
-    s->last_dc[component] = val;
+    last_dc[component] = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -832,7 +834,7 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[i];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -843,7 +845,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -1133,7 +1135,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
                 topleft[i] = top[i];
                 top[i]     = buffer[mb_x][i];
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1265,7 +1267,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1336,7 +1338,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1405,6 +1407,156 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+#define MAX_SCAN_JOBS 32
+
+typedef struct MJpegScanSlices {
+    MJpegDecodeContext *s;
+    int nb_components;
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    int bytes_per_pixel;
+    const int *offsets;     ///< start of the restart intervals following the first one
+    int nb_segments;
+    int nb_jobs;
+    GetBitContext end_gb;   ///< reader state after the last restart interval
+} MJpegScanSlices;
+
+/* Decode a run of restart intervals; every interval starts with its own
+ * reader and DC predictors, so the runs are independent of each other. */
+static int mjpeg_decode_scan_slice(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegScanSlices *sl    = arg;
+    MJpegDecodeContext *s  = sl->s;
+    const int first        = jobnr       * sl->nb_segments / sl->nb_jobs;
+    const int last         = (jobnr + 1) * sl->nb_segments / sl->nb_jobs;
+    const int nb_mbs       = s->mb_width * s->mb_height;
+    const int buf_size     = s->gb.size_in_bits >> 3;
+    LOCAL_ALIGNED_32(int16_t, block, [64]);
+    int seg, i;
+
+    for (seg = first; seg < last; seg++) {
+        const int mb_end = FFMIN(nb_mbs, (seg + 1) * s->restart_interval);
+        int last_dc[MAX_COMPONENTS];
+        GetBitContext gb;
+        int mb;
+
+        if (seg) {
+            int ret = init_get_bits8(&gb, s->gb.buffer + sl->offsets[seg - 1],
+                                     buf_size - sl->offsets[seg - 1]);
+            if (ret < 0)
+                return ret;
+        } else
+            gb = s->gb;
+
+        for (i = 0; i < sl->nb_components; i++)
+            last_dc[i] = (4 << s->bits);
+
+        for (mb = seg * s->restart_interval; mb < mb_end; mb++) {
+            const int mb_x = mb % s->mb_width;
+            const int mb_y = mb / s->mb_width;
+
+            if (get_bits_left(&gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+                return AVERROR_INVALIDDATA;
+            }
+            for (i = 0; i < sl->nb_components; i++) {
+                const int c = s->comp_index[i];
+                const int h = s->h_scount[i];
+                const int v = s->v_scount[i];
+                int x = 0, y = 0, j;
+
+                for (j = 0; j < s->nb_blocks[i]; j++) {
+                    int block_offset = (((sl->linesize[c] * (v * mb_y + y) * 8) +
+                                         (h * mb_x + x) * 8 * sl->bytes_per_pixel) >> avctx->lowres);
+
+                    if (s->interlaced && s->bottom_field)
+                        block_offset += sl->linesize[c] >> 1;
+
+                    s->bdsp.clear_block(block);
+                    if (decode_block(s, &gb, block, last_dc, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sl->chroma_width  : s->width)
+                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sl->chroma_height : s->height)) {
+                        uint8_t *ptr = sl->data[c] + block_offset;
+                        s->idsp.idct_put(ptr, sl->linesize[c], block);
+                        if (s->bits & 7)
+                            shift_output(s, ptr, sl->linesize[c]);
+                    }
+                    if (++x == h) {
+                        x = 0;
+                        y++;
+                    }
+                }
+            }
+        }
+        if (seg == sl->nb_segments - 1)
+            sl->end_gb = gb;
+    }
+    return 0;
+}
+
+/**
+ * Split a baseline scan at its RSTn markers and decode the restart
+ * intervals in parallel.
+ * @return AVERROR(EAGAIN) if the markers found in the scan do not match
+ *         the restart interval, in which case the scan must be decoded
+ *         sequentially
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s, int nb_components,
+                                      uint8_t *data[MAX_COMPONENTS],
+                                      const int linesize[MAX_COMPONENTS],
+                                      int chroma_width, int chroma_height)
+{
+    MJpegScanSlices sl = { 0 };
+    const int nb_mbs   = s->mb_width * s->mb_height;
+    const int start    = get_bits_count(&s->gb) >> 3;
+    int ret[MAX_SCAN_JOBS];
+    int first_rst, i;
+
+    if (s->gb.buffer != s->buffer)
+        return AVERROR(EAGAIN);
+
+    /* skip the markers of a previous field of the same packet */
+    for (first_rst = 0; first_rst < s->nb_rst_offsets; first_rst++)
+        if (s->rst_offsets[first_rst] > start)
+            break;
+
+    sl.nb_segments = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+    if (sl.nb_segments < 2 ||
+        s->nb_rst_offsets - first_rst < sl.nb_segments - 1)
+        return AVERROR(EAGAIN);
+
+    sl.s               = s;
+    sl.nb_components   = nb_components;
+    sl.chroma_width    = chroma_width;
+    sl.chroma_height   = chroma_height;
+    sl.bytes_per_pixel = 1 + (s->bits > 8);
+    sl.offsets         = s->rst_offsets + first_rst;
+    sl.nb_jobs         = FFMIN3(sl.nb_segments, s->avctx->thread_count, MAX_SCAN_JOBS);
+    for (i = 0; i < nb_components; i++) {
+        int c = s->comp_index[i];
+        sl.data[c]     = data[c];
+        sl.linesize[c] = linesize[c];
+    }
+
+    s->avctx->execute2(s->avctx, mjpeg_decode_scan_slice, &sl, ret, sl.nb_jobs);
+
+    for (i = 0; i < sl.nb_jobs; i++)
+        if (ret[i] < 0)
+            return ret[i];
+
+    s->gb            = sl.end_gb;
+    s->restart_count = 0;
+    return 0;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
@@ -1440,6 +1592,16 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
+    if (!s->progressive && !mb_bitmask && s->restart_interval &&
+        s->avctx->codec_id != AV_CODEC_ID_THP &&
+        (s->avctx->active_thread_type & FF_THREAD_SLICE) &&
+        s->avctx->thread_count > 1) {
+        int ret = mjpeg_decode_scan_threaded(s, nb_components, data, linesize,
+                                             chroma_width, chroma_height);
+        if (ret != AVERROR(EAGAIN))
+            return ret;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1481,7 +1643,7 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
                         } else {
                             s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
+                            if (decode_block(s, &s->gb, s->block, s->last_dc, i,
                                              s->dc_index[i], s->ac_index[i],
                                              s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
@@ -2203,6 +2365,8 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         const uint8_t *ptr = src;
         uint8_t *dst = s->buffer;
 
+        s->nb_rst_offsets = 0;
+
         #define copy_data_segment(skip) do {       \
             ptrdiff_t length = (ptr - src) - (skip);  \
             if (length > 0) {                         \
@@ -2240,6 +2404,14 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (s->avctx->active_thread_type & FF_THREAD_SLICE) {
+                        /* the marker is the tail of the pending segment */
+                        int *offsets = av_fast_realloc(s->rst_offsets, &s->rst_offsets_size,
+                                                       (s->nb_rst_offsets + 1) * sizeof(*offsets));
+                        if (!offsets)
+                            return AVERROR(ENOMEM);
+                        s->rst_offsets = offsets;
+                        s->rst_offsets[s->nb_rst_offsets++] = (dst - s->buffer) + (ptr - src);
                     }
                 }
             }
@@ -2814,6 +2986,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
         av_frame_unref(s->picture_ptr);
 
     av_freep(&s->buffer);
+    av_freep(&s->rst_offsets);
+    s->rst_offsets_size = 0;
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2867,7 +3041,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
@@ -114,6 +114,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *rst_offsets;             ///< byte offsets following each RSTn marker in the unescaped SOS buffer
+    unsigned int rst_offsets_size;
+    int nb_rst_offsets;
 
     int buggy_avid;
     int cs_itu601;
@@ -94,8 +94,10 @@ static int mpegaudio_parse(AVCodecParserContext *s1,
                     }
 
                     if (s1->flags & PARSER_FLAG_COMPLETE_FRAMES) {
+                        /* the rest of the packet is the frame payload,
+                         * do not scan it for further headers */
                         s->frame_size = 0;
-                        next = buf_size;
+                        next = i = buf_size;
                     } else if (codec_id == AV_CODEC_ID_MP3ADU) {
                         avpriv_report_missing_feature(avctx,
                             "MP3ADU full parser");
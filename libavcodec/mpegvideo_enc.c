@@ -1363,16 +1363,114 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return size;
 }
 
+typedef struct BCountCandidate {
+    MpegEncContext *s;
+    int b_count;        ///< number of consecutive B-frames tried
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;
+    int ret;
+} BCountCandidate;
+
+/* Encode the downscaled lookahead frames with one B-frame pattern;
+ * the candidates do not share any state and run in parallel. */
+static int estimate_b_count_thread(AVCodecContext *avctx, void *arg)
+{
+    BCountCandidate *cand = arg;
+    MpegEncContext *s     = cand->s;
+    const AVCodec *codec  = avcodec_find_encoder(avctx->codec_id);
+    AVFrame *frames[MAX_B_FRAMES + 2] = { NULL };
+    AVCodecContext *c;
+    int i, out_size, ret = 0;
+    int64_t rd = 0;
+
+    c = avcodec_alloc_context3(NULL);
+    if (!c) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    c->width        = s->width  >> s->brd_scale;
+    c->height       = s->height >> s->brd_scale;
+    c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
+    c->flags       |= avctx->flags & AV_CODEC_FLAG_QPEL;
+    c->mb_decision  = avctx->mb_decision;
+    c->me_cmp       = avctx->me_cmp;
+    c->mb_cmp       = avctx->mb_cmp;
+    c->me_sub_cmp   = avctx->me_sub_cmp;
+    c->pix_fmt      = AV_PIX_FMT_YUV420P;
+    c->time_base    = avctx->time_base;
+    c->max_b_frames = s->max_b_frames;
+
+    ret = avcodec_open2(c, codec, NULL);
+    if (ret < 0)
+        goto fail;
+
+    /* the picture types differ between the candidates, so every
+     * candidate gets its own references to the shared frames */
+    for (i = 0; i < s->max_b_frames + 2; i++) {
+        frames[i] = av_frame_clone(s->tmp_frames[i]);
+        if (!frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    frames[0]->pict_type = AV_PICTURE_TYPE_I;
+    frames[0]->quality   = 1 * FF_QP2LAMBDA;
+
+    out_size = encode_frame(c, frames[0]);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+
+    //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+
+    for (i = 0; i < s->max_b_frames + 1; i++) {
+        int is_p = i % (cand->b_count + 1) == cand->b_count || i == s->max_b_frames;
+
+        frames[i + 1]->pict_type = is_p ?
+                                   AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+        frames[i + 1]->quality   = is_p ? cand->p_lambda : cand->b_lambda;
+
+        out_size = encode_frame(c, frames[i + 1]);
+        if (out_size < 0) {
+            ret = out_size;
+            goto fail;
+        }
+
+        rd += (out_size * cand->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    out_size = encode_frame(c, NULL);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+    rd += (out_size * cand->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    cand->rd = rd;
+
+fail:
+    for (i = 0; i < FF_ARRAY_ELEMS(frames); i++)
+        av_frame_free(&frames[i]);
+    avcodec_free_context(&c);
+    cand->ret = ret;
+    return ret;
+}
+
 static int estimate_best_b_count(MpegEncContext *s)
 {
-    const AVCodec *codec = avcodec_find_encoder(s->avctx->codec_id);
+    BCountCandidate cand[MAX_B_FRAMES + 1];
     const int scale = s->brd_scale;
     int width  = s->width  >> scale;
     int height = s->height >> scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
+    int i, j, nb_cand, p_lambda, b_lambda, lambda2;
     int64_t best_rd  = INT64_MAX;
     int best_b_count = -1;
-    int ret = 0;
 
     av_assert0(scale >= 0 && scale <= 3);
 
@@ -1419,79 +1517,28 @@ static int estimate_best_b_count(MpegEncContext *s)
         }
     }
 
-    for (j = 0; j < s->max_b_frames + 1; j++) {
-        AVCodecContext *c;
-        int64_t rd = 0;
-
-        if (!s->input_picture[j])
+    for (nb_cand = 0; nb_cand < s->max_b_frames + 1; nb_cand++) {
+        if (!s->input_picture[nb_cand])
             break;
-
-        c = avcodec_alloc_context3(NULL);
-        if (!c)
-            return AVERROR(ENOMEM);
-
-        c->width        = width;
-        c->height       = height;
-        c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
-        c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
-        c->mb_decision  = s->avctx->mb_decision;
-        c->me_cmp       = s->avctx->me_cmp;
-        c->mb_cmp       = s->avctx->mb_cmp;
-        c->me_sub_cmp   = s->avctx->me_sub_cmp;
-        c->pix_fmt      = AV_PIX_FMT_YUV420P;
-        c->time_base    = s->avctx->time_base;
-        c->max_b_frames = s->max_b_frames;
-
-        ret = avcodec_open2(c, codec, NULL);
-        if (ret < 0)
-            goto fail;
-
-        s->tmp_frames[0]->pict_type = AV_PICTURE_TYPE_I;
-        s->tmp_frames[0]->quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, s->tmp_frames[0]);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
-
-            s->tmp_frames[i + 1]->pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            s->tmp_frames[i + 1]->quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, s->tmp_frames[i + 1]);
-            if (out_size < 0) {
-                ret = out_size;
-                goto fail;
-            }
-
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
-
-        /* get the delayed frames */
-        out_size = encode_frame(c, NULL);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-        rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-
-        rd += c->error[0] + c->error[1] + c->error[2];
-
-        if (rd < best_rd) {
-            best_rd = rd;
+        cand[nb_cand] = (BCountCandidate) {
+            .s        = s,
+            .b_count  = nb_cand,
+            .p_lambda = p_lambda,
+            .b_lambda = b_lambda,
+            .lambda2  = lambda2,
+        };
+    }
+
+    s->avctx->execute(s->avctx, estimate_b_count_thread, cand, NULL,
+                      nb_cand, sizeof(*cand));
+
+    for (j = 0; j < nb_cand; j++) {
+        if (cand[j].ret < 0)
+            return cand[j].ret;
+        if (cand[j].rd < best_rd) {
+            best_rd = cand[j].rd;
             best_b_count = j;
         }
-
-fail:
-        avcodec_free_context(&c);
-        if (ret < 0)
-            return ret;
     }
 
     return best_b_count;
@@ -49,6 +49,9 @@ typedef struct NVDECDecoder {
 
     CudaFunctions *cudl;
     CuvidFunctions *cvdl;
+
+    int resize;                 ///< whether the output is cropped or scaled
+    int output_width, output_height;
 } NVDECDecoder;
 
 typedef struct NVDECFramePool {
@@ -220,6 +223,11 @@ static int nvdec_decoder_create(AVBufferRef **out, AVBufferRef *hw_device_ref,
 
     ret = CHECK_CU(decoder->cvdl->cuvidCreateDecoder(&decoder->decoder, params));
 
+    // the display area is only set when cropping or scaling
+    decoder->resize        = params->display_area.right > 0;
+    decoder->output_width  = params->ulTargetWidth;
+    decoder->output_height = params->ulTargetHeight;
+
     CHECK_CU(decoder->cudl->cuCtxPopCurrent(&dummy));
 
     if (ret < 0) {
@@ -269,6 +277,41 @@ int ff_nvdec_decode_uninit(AVCodecContext *avctx)
     return 0;
 }
 
+/**
+ * Get the area of the decoded pictures which is output and the size it is
+ * scaled to, from the hwaccel_output_size and hwaccel_crop_* options.
+ *
+ * @return 0 if the pictures are output unchanged, 1 if they are cropped or
+ *         scaled, a negative error code on invalid options
+ */
+static int nvdec_output_area(AVCodecContext *avctx, int area[4],
+                             int *width, int *height)
+{
+    if (!avctx->hwaccel_output_width && !avctx->hwaccel_output_height &&
+        !avctx->hwaccel_crop_top  && !avctx->hwaccel_crop_bottom &&
+        !avctx->hwaccel_crop_left && !avctx->hwaccel_crop_right)
+        return 0;
+
+    area[0] = avctx->hwaccel_crop_left;
+    area[1] = avctx->hwaccel_crop_top;
+    area[2] = avctx->width  - avctx->hwaccel_crop_right;
+    area[3] = avctx->height - avctx->hwaccel_crop_bottom;
+    if (area[0] >= area[2] || area[1] >= area[3]) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid cropping %dx%dx%dx%d for a %dx%d picture\n",
+               avctx->hwaccel_crop_top, avctx->hwaccel_crop_bottom,
+               avctx->hwaccel_crop_left, avctx->hwaccel_crop_right,
+               avctx->width, avctx->height);
+        return AVERROR(EINVAL);
+    }
+
+    *width  = avctx->hwaccel_output_width  ? avctx->hwaccel_output_width  : area[2] - area[0];
+    *height = avctx->hwaccel_output_height ? avctx->hwaccel_output_height : area[3] - area[1];
+    *width  = (*width  + 1) & ~1;
+    *height = (*height + 1) & ~1;
+
+    return 1;
+}
+
 int ff_nvdec_decode_init(AVCodecContext *avctx)
 {
     NVDECContext *ctx = avctx->internal->hwaccel_priv_data;
@@ -281,6 +324,7 @@ int ff_nvdec_decode_init(AVCodecContext *avctx)
 
     cudaVideoSurfaceFormat output_format;
     int cuvid_codec_type, cuvid_chroma_format, chroma_444;
+    int area[4], output_width, output_height, resize;
     int ret = 0;
 
     sw_desc = av_pix_fmt_desc_get(avctx->sw_pix_fmt);
@@ -321,6 +365,10 @@ int ff_nvdec_decode_init(AVCodecContext *avctx)
         return AVERROR(ENOSYS);
     }
 
+    resize = nvdec_output_area(avctx, area, &output_width, &output_height);
+    if (resize < 0)
+        return resize;
+
     frames_ctx = (AVHWFramesContext*)avctx->hw_frames_ctx->data;
 
     params.ulWidth             = avctx->coded_width;
@@ -334,6 +382,18 @@ int ff_nvdec_decode_init(AVCodecContext *avctx)
     params.ulNumDecodeSurfaces = frames_ctx->initial_pool_size;
     params.ulNumOutputSurfaces = frames_ctx->initial_pool_size;
 
+    if (resize) {
+        // crop with the display area and scale to the target size on output
+        params.display_area.left   = area[0];
+        params.display_area.top    = area[1];
+        params.display_area.right  = area[2];
+        params.display_area.bottom = area[3];
+        params.ulTargetWidth       = output_width;
+        params.ulTargetHeight      = output_height;
+        params.target_rect.right   = output_width;
+        params.target_rect.bottom  = output_height;
+    }
+
     ret = nvdec_decoder_create(&ctx->decoder_ref, frames_ctx->device_ref, &params, avctx);
     if (ret < 0) {
         if (params.ulNumDecodeSurfaces > 32) {
@@ -451,6 +511,14 @@ static int nvdec_retrieve_data(void *logctx, AVFrame *frame)
     unmap_data->idx_ref = av_buffer_ref(cf->idx_ref);
     unmap_data->decoder_ref = av_buffer_ref(cf->decoder_ref);
 
+    if (decoder->resize) {
+        // the bitstream cropping is replaced by the cropping of the decoder
+        frame->width       = decoder->output_width;
+        frame->height      = decoder->output_height;
+        frame->crop_top    = frame->crop_bottom = 0;
+        frame->crop_left   = frame->crop_right  = 0;
+    }
+
     av_pix_fmt_get_chroma_sub_sample(hwctx->sw_format, &shift_h, &shift_v);
     for (i = 0; frame->linesize[i]; i++) {
         frame->data[i] = (uint8_t*)(devptr + offset);
@@ -593,6 +661,7 @@ int ff_nvdec_frame_params(AVCodecContext *avctx,
     AVHWFramesContext *frames_ctx = (AVHWFramesContext*)hw_frames_ctx->data;
     const AVPixFmtDescriptor *sw_desc;
     int cuvid_codec_type, cuvid_chroma_format, chroma_444;
+    int area[4], output_width, output_height, resize;
 
     sw_desc = av_pix_fmt_desc_get(avctx->sw_pix_fmt);
     if (!sw_desc)
@@ -611,9 +680,13 @@ int ff_nvdec_frame_params(AVCodecContext *avctx,
     }
     chroma_444 = supports_444 && cuvid_chroma_format == cudaVideoChromaFormat_444;
 
+    resize = nvdec_output_area(avctx, area, &output_width, &output_height);
+    if (resize < 0)
+        return resize;
+
     frames_ctx->format            = AV_PIX_FMT_CUDA;
-    frames_ctx->width             = (avctx->coded_width + 1) & ~1;
-    frames_ctx->height            = (avctx->coded_height + 1) & ~1;
+    frames_ctx->width             = resize ? output_width  : (avctx->coded_width + 1) & ~1;
+    frames_ctx->height            = resize ? output_height : (avctx->coded_height + 1) & ~1;
     /*
      * We add two extra frames to the pool to account for deinterlacing filters
      * holding onto their frames.
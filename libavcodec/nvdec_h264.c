@@ -26,6 +26,7 @@
 #include "avcodec.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 #include "internal.h"
 #include "h264dec.h"
 
@@ -181,4 +182,5 @@ const AVHWAccel ff_h264_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
@@ -26,6 +26,7 @@
 #include "avcodec.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 #include "internal.h"
 #include "hevcdec.h"
 #include "hevc_data.h"
@@ -320,4 +321,5 @@ const AVHWAccel ff_hevc_nvdec_hwaccel = {
     .init                 = nvdec_hevc_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
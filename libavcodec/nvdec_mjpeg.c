@@ -25,6 +25,7 @@
 #include "mjpegdec.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 
 static int nvdec_mjpeg_start_frame(AVCodecContext *avctx, const uint8_t *buffer, uint32_t size)
 {
@@ -82,5 +83,6 @@ AVHWAccel ff_mjpeg_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
 #endif
@@ -24,6 +24,7 @@
 #include "mpegvideo.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 
 static int nvdec_mpeg12_start_frame(AVCodecContext *avctx, const uint8_t *buffer, uint32_t size)
 {
@@ -103,6 +104,7 @@ const AVHWAccel ff_mpeg2_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
 #endif
 
@@ -119,5 +121,6 @@ const AVHWAccel ff_mpeg1_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
 #endif
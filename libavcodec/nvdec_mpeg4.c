@@ -24,6 +24,7 @@
 #include "mpeg4video.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 
 static int nvdec_mpeg4_start_frame(AVCodecContext *avctx, const uint8_t *buffer, uint32_t size)
 {
@@ -118,4 +119,5 @@ const AVHWAccel ff_mpeg4_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
@@ -23,6 +23,7 @@
 #include "avcodec.h"
 #include "nvdec.h"
 #include "decode.h"
+#include "hwaccel.h"
 #include "vc1.h"
 
 static int nvdec_vc1_start_frame(AVCodecContext *avctx, const uint8_t *buffer, uint32_t size)
@@ -122,6 +123,7 @@ const AVHWAccel ff_vc1_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
 
 #if CONFIG_WMV3_NVDEC_HWACCEL
@@ -137,5 +139,6 @@ const AVHWAccel ff_wmv3_nvdec_hwaccel = {
     .init                 = ff_nvdec_decode_init,
     .uninit               = ff_nvdec_decode_uninit,
     .priv_data_size       = sizeof(NVDECContext),
+    .caps_internal        = HWACCEL_CAP_OUTPUT_RESIZE,
 };
 #endif
@@ -2079,7 +2079,7 @@ int ff_nvenc_send_frame(AVCodecContext *avctx, const AVFrame *frame)
 {
     NVENCSTATUS nv_status;
     NvencSurface *tmp_out_surf, *in_surf;
-    int res, res2;
+    int res;
     NV_ENC_SEI_PAYLOAD *sei_data = NULL;
     size_t sei_size;
 
@@ -2108,21 +2108,22 @@ int ff_nvenc_send_frame(AVCodecContext *avctx, const AVFrame *frame)
         in_surf = get_free_frame(ctx);
         if (!in_surf)
             return AVERROR(EAGAIN);
+    }
 
-        res = nvenc_push_context(avctx);
-        if (res < 0)
-            return res;
+    /* the context stays current from the upload to the submission, so that
+     * the copy and the encode are queued back to back on the stream */
+    res = nvenc_push_context(avctx);
+    if (res < 0)
+        return res;
 
+    if (frame) {
         reconfig_encoder(avctx, frame);
 
         res = nvenc_upload_frame(avctx, frame, in_surf);
-
-        res2 = nvenc_pop_context(avctx);
-        if (res2 < 0)
-            return res2;
-
-        if (res)
+        if (res) {
+            nvenc_pop_context(avctx);
             return res;
+        }
 
         pic_params.inputBuffer = in_surf->input_surface;
         pic_params.bufferFmt = in_surf->format;
@@ -2167,10 +2168,6 @@ int ff_nvenc_send_frame(AVCodecContext *avctx, const AVFrame *frame)
         ctx->encoder_flushing = 1;
     }
 
-    res = nvenc_push_context(avctx);
-    if (res < 0)
-        return res;
-
     nv_status = p_nvenc->nvEncEncodePicture(ctx->nvencoder, &pic_params);
     av_free(sei_data);
 
@@ -73,6 +73,7 @@ static const AVOption avcodec_options[] = {
 {"noout", "skip bitstream encoding", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_NO_OUTPUT }, INT_MIN, INT_MAX, V|E, "flags2"},
 {"ignorecrop", "ignore cropping information from sps", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_IGNORE_CROP }, INT_MIN, INT_MAX, V|D, "flags2"},
 {"local_header", "place global headers at every keyframe instead of in extradata", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_LOCAL_HEADER }, INT_MIN, INT_MAX, V|E, "flags2"},
+{"thread_low_delay", "return frame threaded output as soon as it is decoded", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_THREAD_LOW_DELAY }, INT_MIN, INT_MAX, V|D, "flags2"},
 {"chunks", "Frame data might be split into multiple chunks", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_CHUNKS }, INT_MIN, INT_MAX, V|D, "flags2"},
 {"showall", "Show all frames before the first keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_SHOW_ALL }, INT_MIN, INT_MAX, V|D, "flags2"},
 {"export_mvs", "export motion vectors through frame side data", 0, AV_OPT_TYPE_CONST, {.i64 = AV_CODEC_FLAG2_EXPORT_MVS}, INT_MIN, INT_MAX, V|D, "flags2"},
@@ -432,6 +433,10 @@ static const AVOption avcodec_options[] = {
 {"thread_type", "select multithreading type", OFFSET(thread_type), AV_OPT_TYPE_FLAGS, {.i64 = FF_THREAD_SLICE|FF_THREAD_FRAME }, 0, INT_MAX, V|A|E|D, "thread_type"},
 {"slice", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_SLICE }, INT_MIN, INT_MAX, V|E|D, "thread_type"},
 {"frame", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_FRAME }, INT_MIN, INT_MAX, V|E|D, "thread_type"},
+{"slice_threads", "set the number of slice threads used along with frame threads", OFFSET(slice_thread_count), AV_OPT_TYPE_INT, {.i64 = 1 }, 0, INT_MAX, V|D, "slice_threads"},
+{"auto", "autodetect a suitable number of slice threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, INT_MIN, INT_MAX, V|D, "slice_threads"},
+{"thread_affinity", "set the list of CPUs the codec threads may run on", OFFSET(thread_affinity), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, V|A|E|D},
+{"numa_node", "restrict the codec threads to the CPUs of a NUMA node", OFFSET(numa_node), AV_OPT_TYPE_INT, {.i64 = -1 }, -1, INT_MAX, V|A|E|D},
 {"audio_service_type", "audio service type", OFFSET(audio_service_type), AV_OPT_TYPE_INT, {.i64 = AV_AUDIO_SERVICE_TYPE_MAIN }, 0, AV_AUDIO_SERVICE_TYPE_NB-1, A|E, "audio_service_type"},
 {"ma", "Main Audio Service", 0, AV_OPT_TYPE_CONST, {.i64 = AV_AUDIO_SERVICE_TYPE_MAIN },              INT_MIN, INT_MAX, A|E, "audio_service_type"},
 {"ef", "Effects",            0, AV_OPT_TYPE_CONST, {.i64 = AV_AUDIO_SERVICE_TYPE_EFFECTS },           INT_MIN, INT_MAX, A|E, "audio_service_type"},
@@ -482,6 +487,11 @@ static const AVOption avcodec_options[] = {
 {"allow_high_depth", "allow to output YUV pixel formats with a different chroma sampling than 4:2:0 and/or other than 8 bits per component", 0, AV_OPT_TYPE_CONST, {.i64 = AV_HWACCEL_FLAG_ALLOW_HIGH_DEPTH }, INT_MIN, INT_MAX, V | D, "hwaccel_flags"},
 {"allow_profile_mismatch", "attempt to decode anyway if HW accelerated decoder's supported profiles do not exactly match the stream", 0, AV_OPT_TYPE_CONST, {.i64 = AV_HWACCEL_FLAG_ALLOW_PROFILE_MISMATCH }, INT_MIN, INT_MAX, V | D, "hwaccel_flags"},
 {"extra_hw_frames", "Number of extra hardware frames to allocate for the user", OFFSET(extra_hw_frames), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, V|D },
+{"hwaccel_output_size", "scale the pictures to this size while decoding, if the hwaccel supports it", OFFSET(hwaccel_output_width), AV_OPT_TYPE_IMAGE_SIZE, {.str = NULL }, 0, INT_MAX, V|D },
+{"hwaccel_crop_top",    "crop the pictures while decoding, if the hwaccel supports it", OFFSET(hwaccel_crop_top),    AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, V|D },
+{"hwaccel_crop_bottom", "crop the pictures while decoding, if the hwaccel supports it", OFFSET(hwaccel_crop_bottom), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, V|D },
+{"hwaccel_crop_left",   "crop the pictures while decoding, if the hwaccel supports it", OFFSET(hwaccel_crop_left),   AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, V|D },
+{"hwaccel_crop_right",  "crop the pictures while decoding, if the hwaccel supports it", OFFSET(hwaccel_crop_right),  AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, V|D },
 {"discard_damaged_percentage", "Percentage of damaged samples to discard a frame", OFFSET(discard_damaged_percentage), AV_OPT_TYPE_INT, {.i64 = 95 }, 0, 100, V|D },
 {NULL},
 };
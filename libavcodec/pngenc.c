@@ -28,6 +28,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/libm.h"
 #include "libavutil/opt.h"
 #include "libavutil/color_utils.h"
@@ -191,6 +192,66 @@ static void png_filter_row(PNGEncContext *c, uint8_t *dst, int filter_type,
     }
 }
 
+/* filter bytes [start, end) of a row, start must be 0 or at least bpp */
+static void png_filter_range(PNGEncContext *c, uint8_t *dst, int filter_type,
+                             uint8_t *src, uint8_t *top, int start, int end, int bpp)
+{
+    int i;
+
+    if (!start) {
+        png_filter_row(c, dst, filter_type, src, top, end, bpp);
+        return;
+    }
+
+    switch (filter_type) {
+    case PNG_FILTER_VALUE_NONE:
+        memcpy(dst + start, src + start, end - start);
+        break;
+    case PNG_FILTER_VALUE_SUB:
+        c->llvidencdsp.diff_bytes(dst + start, src + start, src + start - bpp, end - start);
+        break;
+    case PNG_FILTER_VALUE_UP:
+        c->llvidencdsp.diff_bytes(dst + start, src + start, top + start, end - start);
+        break;
+    case PNG_FILTER_VALUE_AVG:
+        for (i = start; i < end; i++)
+            dst[i] = src[i] - ((src[i - bpp] + top[i]) >> 1);
+        break;
+    case PNG_FILTER_VALUE_PAETH:
+        sub_png_paeth_prediction(dst + start, src + start, top + start, end - start, bpp);
+        break;
+    }
+}
+
+/* sum of the absolute values of the bytes taken as signed, 8 bytes at a time */
+static int png_filter_cost(const uint8_t *buf, int size)
+{
+    const uint64_t lsb = 0x0101010101010101ULL;
+    uint64_t sum = 0;
+    int i = 0, cost = 0;
+
+    while (i + 8 <= size) {
+        /* the 16-bit lanes of sum grow by at most 256 per word */
+        int n = FFMIN((size - i) >> 3, 255);
+        for (; n > 0; n--, i += 8) {
+            uint64_t v    = AV_RN64(buf + i);
+            uint64_t sign = (v >> 7) & lsb;
+            v = (v ^ (sign * 0xFF)) + sign;
+            sum += (v & 0x00FF00FF00FF00FFULL) + ((v >> 8) & 0x00FF00FF00FF00FFULL);
+        }
+        sum = (sum & 0x0000FFFF0000FFFFULL) + ((sum >> 16) & 0x0000FFFF0000FFFFULL);
+        cost += (sum + (sum >> 32)) & 0xFFFFFFFF;
+        sum = 0;
+    }
+    for (; i < size; i++)
+        cost += abs((int8_t) buf[i]);
+    return cost;
+}
+
+/* rows are filtered in chunks of this size, so that a filter can be
+ * abandoned as soon as its cost exceeds the best one found so far */
+#define FILTER_CHUNK_SIZE 512
+
 static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
                                   uint8_t *src, uint8_t *top, int size, int bpp)
 {
@@ -199,15 +260,17 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
     if (!top && pred)
         pred = PNG_FILTER_VALUE_SUB;
     if (pred == PNG_FILTER_VALUE_MIXED) {
-        int i;
+        int start, end;
         int cost, bcost = INT_MAX;
         uint8_t *buf1 = dst, *buf2 = dst + size + 16;
         for (pred = 0; pred < 5; pred++) {
-            png_filter_row(s, buf1 + 1, pred, src, top, size, bpp);
             buf1[0] = pred;
-            cost = 0;
-            for (i = 0; i <= size; i++)
-                cost += abs((int8_t) buf1[i]);
+            cost = pred;
+            for (start = 0; start < size && cost < bcost; start = end) {
+                end = FFMIN(start + FILTER_CHUNK_SIZE, size);
+                png_filter_range(s, buf1 + 1, pred, src, top, start, end, bpp);
+                cost += png_filter_cost(buf1 + 1 + start, end - start);
+            }
             if (cost < bcost) {
                 bcost = cost;
                 FFSWAP(uint8_t *, buf1, buf2);
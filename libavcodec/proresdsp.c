@@ -88,6 +88,8 @@ av_cold int ff_proresdsp_init(ProresDSPContext *dsp, AVCodecContext *avctx)
         return AVERROR_BUG;
     }
 
+    if (ARCH_AARCH64)
+        ff_proresdsp_init_aarch64(dsp, avctx);
     if (ARCH_X86)
         ff_proresdsp_init_x86(dsp, avctx);
 
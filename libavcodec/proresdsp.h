@@ -35,6 +35,7 @@ typedef struct ProresDSPContext {
 
 int ff_proresdsp_init(ProresDSPContext *dsp, AVCodecContext *avctx);
 
+void ff_proresdsp_init_aarch64(ProresDSPContext *dsp, AVCodecContext *avctx);
 void ff_proresdsp_init_x86(ProresDSPContext *dsp, AVCodecContext *avctx);
 
 #endif /* AVCODEC_PRORESDSP_H */
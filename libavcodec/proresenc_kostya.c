@@ -60,6 +60,11 @@ enum {
     QUANT_MAT_DEFAULT,
 };
 
+enum {
+    QUANT_SEARCH_FULL = 0,
+    QUANT_SEARCH_FAST,
+};
+
 static const uint8_t prores_quant_matrices[][64] = {
     { // proxy
          4,  7,  9, 11, 13, 14, 15, 63,
@@ -254,6 +259,7 @@ typedef struct ProresContext {
     int bits_per_mb;
     int force_quant;
     int alpha_bits;
+    int quant_search;
     int warn;
 
     char *vendor;
@@ -801,9 +807,98 @@ static int estimate_alpha_plane(ProresContext *ctx,
     return bits;
 }
 
+static int estimate_slice_quant(ProresContext *ctx, int *error, int q,
+                                const uint16_t *src, const int *linesize,
+                                int mbs_per_slice, const int *num_cblocks,
+                                const int *plane_factor, int alpha_bits,
+                                ProresThreadData *td)
+{
+    const int16_t *qmat, *qmat_chroma;
+    int i, bits = alpha_bits;
+
+    if (q < MAX_STORED_Q) {
+        qmat        = ctx->quants[q];
+        qmat_chroma = ctx->quants_chroma[q];
+    } else {
+        for (i = 0; i < 64; i++) {
+            td->custom_q[i]        = ctx->quant_mat[i] * q;
+            td->custom_chroma_q[i] = ctx->quant_chroma_mat[i] * q;
+        }
+        qmat        = td->custom_q;
+        qmat_chroma = td->custom_chroma_q;
+    }
+
+    *error = 0;
+    bits  += estimate_slice_plane(ctx, error, 0,
+                                  src, linesize[0],
+                                  mbs_per_slice,
+                                  num_cblocks[0], plane_factor[0],
+                                  qmat, td); /* estimate luma plane */
+    for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
+        bits += estimate_slice_plane(ctx, error, i,
+                                     src, linesize[i],
+                                     mbs_per_slice,
+                                     num_cblocks[i], plane_factor[i],
+                                     qmat_chroma, td);
+    }
+
+    return bits;
+}
+
+/**
+ * Find the smallest quantiser above max_quant for which the slice fits into
+ * its bit budget. The result is the same as with a linear search as long as
+ * the slice size decreases with the quantiser, needing about
+ * 2 * log2(128 - max_quant) estimations instead of up to 128 - max_quant.
+ */
+static int find_overquant_fast(ProresContext *ctx, int *bits, int *error,
+                               int max_quant, const uint16_t *src,
+                               const int *linesize, int mbs_per_slice,
+                               const int *num_cblocks, const int *plane_factor,
+                               int alpha_bits, ProresThreadData *td)
+{
+    const int bits_limit = ctx->bits_per_mb * mbs_per_slice;
+    int lo = max_quant, hi, step = 1;
+    int hi_bits, hi_error, cur_bits, cur_error;
+
+    /* grow the step until the slice fits, the last quantiser is always used
+     * when nothing fits */
+    for (;;) {
+        hi       = FFMIN(lo + step, 127);
+        hi_bits  = estimate_slice_quant(ctx, &hi_error, hi, src, linesize,
+                                        mbs_per_slice, num_cblocks,
+                                        plane_factor, alpha_bits, td);
+        if (hi_bits <= bits_limit || hi == 127)
+            break;
+        lo    = hi;
+        step <<= 1;
+    }
+
+    /* bisect between the last quantiser known to not fit and the first one
+     * known to fit */
+    while (hi - lo > 1) {
+        int mid = (lo + hi) >> 1;
+
+        cur_bits = estimate_slice_quant(ctx, &cur_error, mid, src, linesize,
+                                        mbs_per_slice, num_cblocks,
+                                        plane_factor, alpha_bits, td);
+        if (cur_bits <= bits_limit) {
+            hi       = mid;
+            hi_bits  = cur_bits;
+            hi_error = cur_error;
+        } else {
+            lo = mid;
+        }
+    }
+
+    *bits  = hi_bits;
+    *error = hi_error;
+    return hi;
+}
+
 static int find_slice_quant(AVCodecContext *avctx,
                             int trellis_node, int x, int y, int mbs_per_slice,
-                            ProresThreadData *td)
+                            int pred_q, ProresThreadData *td)
 {
     ProresContext *ctx = avctx->priv_data;
     int i, q, pq, xp, yp;
@@ -813,12 +908,11 @@ static int find_slice_quant(AVCodecContext *avctx,
     int plane_factor[MAX_PLANES], is_chroma[MAX_PLANES];
     const int min_quant = ctx->profile_info->min_quant;
     const int max_quant = ctx->profile_info->max_quant;
+    int search_min = min_quant, search_max = max_quant;
     int error, bits, bits_limit;
     int mbs, prev, cur, new_score;
     int slice_bits[TRELLIS_WIDTH], slice_score[TRELLIS_WIDTH];
     int overquant;
-    uint16_t *qmat;
-    uint16_t *qmat_chroma;
     int linesize[4], line_add;
     int alpha_bits = 0;
 
@@ -866,25 +960,27 @@ static int find_slice_quant(AVCodecContext *avctx,
         td->nodes[trellis_node + q].quant     = q;
     }
 
+    /* in fast mode only the quantisers close to the one picked for the
+     * previous slice are tried, the others are marked as unusable */
+    if (ctx->quant_search == QUANT_SEARCH_FAST && pred_q >= 0) {
+        pred_q     = FFMIN(pred_q, max_quant);
+        search_min = FFMAX(pred_q - 1, min_quant);
+        search_max = FFMIN(pred_q + 1, max_quant);
+    }
+
     if (ctx->alpha_bits)
         alpha_bits = estimate_alpha_plane(ctx, src, linesize[3],
                                           mbs_per_slice, td->blocks[3]);
     // todo: maybe perform coarser quantising to fit into frame size when needed
     for (q = min_quant; q <= max_quant; q++) {
-        bits  = alpha_bits;
-        error = 0;
-        bits += estimate_slice_plane(ctx, &error, 0,
-                                     src, linesize[0],
-                                     mbs_per_slice,
-                                     num_cblocks[0], plane_factor[0],
-                                     ctx->quants[q], td); /* estimate luma plane */
-        for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-            bits += estimate_slice_plane(ctx, &error, i,
-                                         src, linesize[i],
-                                         mbs_per_slice,
-                                         num_cblocks[i], plane_factor[i],
-                                         ctx->quants_chroma[q], td);
+        if (q < search_min || (q > search_max && q != max_quant)) {
+            slice_bits[q]  = 0;
+            slice_score[q] = SCORE_LIMIT;
+            continue;
         }
+        bits = estimate_slice_quant(ctx, &error, q, src, linesize,
+                                    mbs_per_slice, num_cblocks, plane_factor,
+                                    alpha_bits, td);
         if (bits > 65000 * 8)
             error = SCORE_LIMIT;
 
@@ -895,33 +991,19 @@ static int find_slice_quant(AVCodecContext *avctx,
         slice_bits[max_quant + 1]  = slice_bits[max_quant];
         slice_score[max_quant + 1] = slice_score[max_quant] + 1;
         overquant = max_quant;
+    } else if (ctx->quant_search == QUANT_SEARCH_FAST) {
+        overquant = find_overquant_fast(ctx, &bits, &error, max_quant,
+                                        src, linesize, mbs_per_slice,
+                                        num_cblocks, plane_factor,
+                                        alpha_bits, td);
+
+        slice_bits[max_quant + 1]  = bits;
+        slice_score[max_quant + 1] = error;
     } else {
         for (q = max_quant + 1; q < 128; q++) {
-            bits  = alpha_bits;
-            error = 0;
-            if (q < MAX_STORED_Q) {
-                qmat = ctx->quants[q];
-                qmat_chroma = ctx->quants_chroma[q];
-            } else {
-                qmat = td->custom_q;
-                qmat_chroma = td->custom_chroma_q;
-                for (i = 0; i < 64; i++) {
-                    qmat[i] = ctx->quant_mat[i] * q;
-                    qmat_chroma[i] = ctx->quant_chroma_mat[i] * q;
-                }
-            }
-            bits += estimate_slice_plane(ctx, &error, 0,
-                                         src, linesize[0],
-                                         mbs_per_slice,
-                                         num_cblocks[0], plane_factor[0],
-                                         qmat, td);/* estimate luma plane */
-            for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-                bits += estimate_slice_plane(ctx, &error, i,
-                                             src, linesize[i],
-                                             mbs_per_slice,
-                                             num_cblocks[i], plane_factor[i],
-                                             qmat_chroma, td);
-            }
+            bits = estimate_slice_quant(ctx, &error, q, src, linesize,
+                                        mbs_per_slice, num_cblocks,
+                                        plane_factor, alpha_bits, td);
             if (bits <= ctx->bits_per_mb * mbs_per_slice)
                 break;
         }
@@ -983,7 +1065,7 @@ static int find_quant_thread(AVCodecContext *avctx, void *arg,
             mbs_per_slice >>= 1;
         q = find_slice_quant(avctx,
                              (mb + 1) * TRELLIS_WIDTH, x, y,
-                             mbs_per_slice, td);
+                             mbs_per_slice, mb ? td->nodes[q].quant : -1, td);
     }
 
     for (x = ctx->slices_width - 1; x >= 0; x--) {
@@ -1409,6 +1491,12 @@ static const AVOption options[] = {
         0, 0, VE, "quant_mat" },
     { "alpha_bits", "bits for alpha plane", OFFSET(alpha_bits), AV_OPT_TYPE_INT,
         { .i64 = 16 }, 0, 16, VE },
+    { "quant_search", "slice quantiser search", OFFSET(quant_search), AV_OPT_TYPE_INT,
+        { .i64 = QUANT_SEARCH_FULL }, QUANT_SEARCH_FULL, QUANT_SEARCH_FAST, VE, "quant_search" },
+    { "full",          "try all the quantisers", 0, AV_OPT_TYPE_CONST, { .i64 = QUANT_SEARCH_FULL },
+        0, 0, VE, "quant_search" },
+    { "fast",          "only try a few quantisers", 0, AV_OPT_TYPE_CONST, { .i64 = QUANT_SEARCH_FAST },
+        0, 0, VE, "quant_search" },
     { NULL }
 };
 
@@ -29,6 +29,8 @@
  * @see doc/multithreading.txt
  */
 
+#include "libavutil/cpu_internal.h"
+
 #include "avcodec.h"
 #include "internal.h"
 #include "pthread_internal.h"
@@ -40,6 +42,8 @@
  * Threading requires more than one thread.
  * Frame threading requires entire frames to be passed to the codec,
  * and introduces extra decoding delay, so is incompatible with low_delay.
+ * Codecs with FF_CODEC_CAP_FRAME_SLICE_THREADS can additionally use slice
+ * threads inside each frame thread.
  *
  * @param avctx The context.
  */
@@ -53,6 +57,9 @@ static void validate_thread_parameters(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
     } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
         avctx->active_thread_type = FF_THREAD_FRAME;
+        if (avctx->codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS &&
+            avctx->thread_type & FF_THREAD_SLICE && avctx->slice_thread_count != 1)
+            avctx->active_thread_type |= FF_THREAD_SLICE;
     } else if (avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
                avctx->thread_type & FF_THREAD_SLICE) {
         avctx->active_thread_type = FF_THREAD_SLICE;
@@ -71,14 +78,22 @@ int ff_thread_init(AVCodecContext *avctx)
 {
     validate_thread_parameters(avctx);
 
-    if (avctx->active_thread_type&FF_THREAD_SLICE)
-        return ff_slice_thread_init(avctx);
-    else if (avctx->active_thread_type&FF_THREAD_FRAME)
+    if (avctx->active_thread_type&FF_THREAD_FRAME)
         return ff_frame_thread_init(avctx);
+    else if (avctx->active_thread_type&FF_THREAD_SLICE)
+        return ff_slice_thread_init(avctx);
 
     return 0;
 }
 
+void ff_thread_set_affinity(AVCodecContext *avctx)
+{
+    int ret = avpriv_set_thread_affinity(avctx->thread_affinity, avctx->numa_node);
+    if (ret < 0)
+        av_log(avctx, AV_LOG_WARNING, "Could not set the affinity of a thread: %s\n",
+               av_err2str(ret));
+}
+
 void ff_thread_free(AVCodecContext *avctx)
 {
     if (avctx->active_thread_type&FF_THREAD_FRAME)
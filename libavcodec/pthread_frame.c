@@ -44,6 +44,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/trace.h"
 
 enum {
     ///< Set when the thread is awaiting a packet.
@@ -128,6 +129,8 @@ typedef struct FrameThreadContext {
     pthread_cond_t async_cond;
     int async_lock;
 
+    SliceThreadPool *slice_pool;   ///< Slice threads shared by all frame threads, if slice threading is active too.
+
     int next_decoding;             ///< The next context to submit a packet to.
     int next_finished;             ///< The next context to return output from.
 
@@ -171,6 +174,8 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
     AVCodecContext *avctx = p->avctx;
     const AVCodec *codec = avctx->codec;
 
+    ff_thread_set_affinity(avctx);
+
     pthread_mutex_lock(&p->mutex);
     while (1) {
         while (atomic_load(&p->state) == STATE_INPUT_READY && !p->die)
@@ -198,7 +203,9 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
 
         av_frame_unref(p->frame);
         p->got_frame = 0;
+        av_trace_begin("frame_thread_decode", p->avpkt.pts);
         p->result = codec->decode(avctx, p->frame, &p->got_frame, &p->avpkt);
+        av_trace_end("frame_thread_decode");
 
         if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
             if (avctx->internal->allocate_progress)
@@ -475,6 +482,9 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 {
     FrameThreadContext *fctx = avctx->internal->thread_ctx;
     int finished = fctx->next_finished;
+    /* an empty packet before draining only collects a finished frame,
+     * see ff_thread_can_output_frame() */
+    int output_only = !avpkt->size && !avctx->internal->draining;
     PerThreadContext *p;
     int err;
 
@@ -486,10 +496,14 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
      * Submit a packet to the next decoding thread.
      */
 
-    p = &fctx->threads[fctx->next_decoding];
-    err = submit_packet(p, avctx, avpkt);
-    if (err)
-        goto finish;
+    if (!output_only) {
+        p = &fctx->threads[fctx->next_decoding];
+        av_trace_begin("submit_packet", avpkt->pts);
+        err = submit_packet(p, avctx, avpkt);
+        av_trace_end("submit_packet");
+        if (err)
+            goto finish;
+    }
 
     /*
      * If we're still receiving the initial packets, don't return a frame.
@@ -498,6 +512,24 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
         fctx->delaying = 0;
 
+    if (avctx->flags2 & AV_CODEC_FLAG2_THREAD_LOW_DELAY) {
+        /*
+         * In low delay mode, only wait for the oldest thread once every
+         * thread has a packet; until then return its frame only if it is
+         * already done.
+         */
+        int next = fctx->next_decoding >= avctx->thread_count ? 0 : fctx->next_decoding;
+
+        fctx->delaying = 0;
+        if (avpkt->size && next != finished &&
+            atomic_load(&fctx->threads[finished].state) != STATE_INPUT_READY) {
+            *got_picture_ptr = 0;
+            fctx->next_decoding = next;
+            err = avpkt->size;
+            goto finish;
+        }
+    }
+
     if (fctx->delaying) {
         *got_picture_ptr=0;
         if (avpkt->size) {
@@ -517,10 +549,12 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
         p = &fctx->threads[finished++];
 
         if (atomic_load(&p->state) != STATE_INPUT_READY) {
+            av_trace_begin("await_frame", p->avpkt.pts);
             pthread_mutex_lock(&p->progress_mutex);
             while (atomic_load_explicit(&p->state, memory_order_relaxed) != STATE_INPUT_READY)
                 pthread_cond_wait(&p->output_cond, &p->progress_mutex);
             pthread_mutex_unlock(&p->progress_mutex);
+            av_trace_end("await_frame");
         }
 
         av_frame_move_ref(picture, p->frame);
@@ -538,7 +572,8 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
         p->result = 0;
 
         if (finished >= avctx->thread_count) finished = 0;
-    } while (!avpkt->size && !*got_picture_ptr && err >= 0 && finished != fctx->next_finished);
+    } while (!avpkt->size && !output_only && !*got_picture_ptr && err >= 0 &&
+             finished != fctx->next_finished);
 
     update_context_from_thread(avctx, p->avctx, 1);
 
@@ -554,6 +589,21 @@ finish:
     return err;
 }
 
+int ff_thread_can_output_frame(AVCodecContext *avctx)
+{
+    FrameThreadContext *fctx = avctx->internal->thread_ctx;
+    int next = fctx->next_decoding >= avctx->thread_count ? 0 : fctx->next_decoding;
+
+    /* in low delay mode, at most thread_count - 1 packets are pending between
+     * calls, so the oldest thread has one iff it is not the next one to get
+     * a packet */
+    if (!(avctx->flags2 & AV_CODEC_FLAG2_THREAD_LOW_DELAY) ||
+        next == fctx->next_finished)
+        return 0;
+
+    return atomic_load(&fctx->threads[fctx->next_finished].state) == STATE_INPUT_READY;
+}
+
 void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
@@ -592,10 +642,12 @@ void ff_thread_await_progress(ThreadFrame *f, int n, int field)
         av_log(f->owner[field], AV_LOG_DEBUG,
                "thread awaiting %d field %d from %p\n", n, field, progress);
 
+    av_trace_begin("await_progress", f->f ? f->f->pts : AV_NOPTS_VALUE);
     pthread_mutex_lock(&p->progress_mutex);
     while (atomic_load_explicit(&progress[field], memory_order_relaxed) < n)
         pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
     pthread_mutex_unlock(&p->progress_mutex);
+    av_trace_end("await_progress");
 }
 
 void ff_thread_finish_setup(AVCodecContext *avctx) {
@@ -694,6 +746,9 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         av_packet_unref(&p->avpkt);
         av_freep(&p->released_buffers);
 
+        if (p->avctx && p->avctx->internal)
+            ff_slice_thread_free_shared(p->avctx);
+
         if (i && p->avctx) {
             av_freep(&p->avctx->priv_data);
             av_freep(&p->avctx->slice_offset);
@@ -708,6 +763,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
     }
 
     av_freep(&fctx->threads);
+    ff_slice_thread_pool_free(&fctx->slice_pool);
     pthread_mutex_destroy(&fctx->buffer_mutex);
     pthread_mutex_destroy(&fctx->hwaccel_mutex);
     pthread_mutex_destroy(&fctx->async_mutex);
@@ -764,6 +820,24 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     fctx->async_lock = 1;
     fctx->delaying = 1;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        int slice_threads = avctx->slice_thread_count;
+
+        if (!slice_threads)
+            slice_threads = FFMIN(av_cpu_count() + 1, MAX_AUTO_THREADS);
+
+        err = ff_slice_thread_pool_init(avctx, &fctx->slice_pool, slice_threads);
+        if (err < 0) {
+            ff_frame_thread_free(avctx, 0);
+            return err;
+        }
+        if (fctx->slice_pool)
+            avctx->slice_thread_count = err;
+        else
+            avctx->active_thread_type &= ~FF_THREAD_SLICE;
+        err = 0;
+    }
+
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
         PerThreadContext *p  = &fctx->threads[i];
@@ -799,6 +873,7 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         }
         *copy->internal = *src->internal;
         copy->internal->thread_ctx = p;
+        copy->internal->slice_thread_ctx = NULL;
         copy->internal->last_pkt_props = &p->avpkt;
 
         if (!i) {
@@ -823,6 +898,12 @@ int ff_frame_thread_init(AVCodecContext *avctx)
 
         if (err) goto error;
 
+        if (fctx->slice_pool) {
+            err = ff_slice_thread_init_shared(copy, fctx->slice_pool);
+            if (err < 0)
+                goto error;
+        }
+
         atomic_init(&p->debug_threads, (copy->debug & FF_DEBUG_THREADS) != 0);
 
         err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
@@ -25,9 +25,34 @@
  * limit the number of threads to 16 for automatic detection */
 #define MAX_AUTO_THREADS 16
 
+typedef struct SliceThreadPool SliceThreadPool;
+
+/**
+ * Restrict the calling thread to the CPUs selected by the thread_affinity
+ * and numa_node options of avctx. Failures are only logged.
+ */
+void ff_thread_set_affinity(AVCodecContext *avctx);
+
 int ff_slice_thread_init(AVCodecContext *avctx);
 void ff_slice_thread_free(AVCodecContext *avctx);
 
+/**
+ * Create a slice thread pool to be shared by several frame threads.
+ *
+ * @return the number of threads in the pool, 0 if no pool was created
+ *         because it would have had only one thread, or a negative error code
+ */
+int ff_slice_thread_pool_init(AVCodecContext *avctx, SliceThreadPool **pool,
+                              int thread_count);
+void ff_slice_thread_pool_free(SliceThreadPool **pool);
+
+/**
+ * Set up slice threading for the context of a frame thread, using a shared
+ * pool. While the pool is used by another context, jobs run serially.
+ */
+int ff_slice_thread_init_shared(AVCodecContext *avctx, SliceThreadPool *pool);
+void ff_slice_thread_free_shared(AVCodecContext *avctx);
+
 int ff_frame_thread_init(AVCodecContext *avctx);
 void ff_frame_thread_free(AVCodecContext *avctx, int thread_count);
 
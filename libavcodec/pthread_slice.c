@@ -40,8 +40,20 @@ typedef int (action_func)(AVCodecContext *c, void *arg);
 typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
 typedef int (main_func)(AVCodecContext *c);
 
+/**
+ * Slice thread pool shared by the frame threads of a codec combining frame
+ * and slice threading. Only one frame thread can use it at a time.
+ */
+struct SliceThreadPool {
+    AVSliceThread *thread;
+    pthread_mutex_t lock;   ///< protects owner
+    AVCodecContext *owner;  ///< context whose jobs are currently executed
+    int thread_count;
+};
+
 typedef struct SliceThreadContext {
     AVSliceThread *thread;
+    SliceThreadPool *pool;  ///< shared pool used instead of thread, if set
     action_func *func;
     action_func2 *func2;
     main_func *mainfunc;
@@ -56,6 +68,12 @@ typedef struct SliceThreadContext {
     pthread_mutex_t *progress_mutex;
 } SliceThreadContext;
 
+static SliceThreadContext *get_slice_thread_ctx(AVCodecContext *avctx)
+{
+    return avctx->internal->slice_thread_ctx ? avctx->internal->slice_thread_ctx
+                                             : avctx->internal->thread_ctx;
+}
+
 static void main_function(void *priv) {
     AVCodecContext *avctx = priv;
     SliceThreadContext *c = avctx->internal->thread_ctx;
@@ -65,7 +83,7 @@ static void main_function(void *priv) {
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     AVCodecContext *avctx = priv;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_thread_ctx(avctx);
     int ret;
 
     ret = c->func ? c->func(avctx, (char *)c->args + c->job_size * jobnr)
@@ -74,12 +92,15 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
-void ff_slice_thread_free(AVCodecContext *avctx)
+static void pool_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
-    int i;
+    SliceThreadPool *pool = priv;
+    worker_func(pool->owner, jobnr, threadnr, nb_jobs, nb_threads);
+}
 
-    avpriv_slicethread_free(&c->thread);
+static void free_progress(SliceThreadContext *c)
+{
+    int i;
 
     for (i = 0; i < c->thread_count; i++) {
         pthread_mutex_destroy(&c->progress_mutex[i]);
@@ -89,12 +110,20 @@ void ff_slice_thread_free(AVCodecContext *avctx)
     av_freep(&c->entries);
     av_freep(&c->progress_mutex);
     av_freep(&c->progress_cond);
+}
+
+void ff_slice_thread_free(AVCodecContext *avctx)
+{
+    SliceThreadContext *c = avctx->internal->thread_ctx;
+
+    avpriv_slicethread_free(&c->thread);
+    free_progress(c);
     av_freep(&avctx->internal->thread_ctx);
 }
 
 static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_thread_ctx(avctx);
 
     if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
         return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
@@ -102,18 +131,42 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
     if (job_count <= 0)
         return 0;
 
+    if (c->pool) {
+        int busy;
+
+        pthread_mutex_lock(&c->pool->lock);
+        busy = !!c->pool->owner;
+        if (!busy)
+            c->pool->owner = avctx;
+        pthread_mutex_unlock(&c->pool->lock);
+
+        /* Another frame thread owns the pool, run the jobs here instead of
+         * waiting, as that thread may itself wait for our progress. */
+        if (busy) {
+            if (func)
+                return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
+            return avcodec_default_execute2(avctx, c->func2, arg, ret, job_count);
+        }
+    }
+
     c->job_size = job_size;
     c->args = arg;
     c->func = func;
     c->rets = ret;
 
-    avpriv_slicethread_execute(c->thread, job_count, !!c->mainfunc  );
+    if (c->pool) {
+        avpriv_slicethread_execute(c->pool->thread, job_count, 0);
+        pthread_mutex_lock(&c->pool->lock);
+        c->pool->owner = NULL;
+        pthread_mutex_unlock(&c->pool->lock);
+    } else
+        avpriv_slicethread_execute(c->thread, job_count, !!c->mainfunc  );
     return 0;
 }
 
 static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_thread_ctx(avctx);
     c->func2 = func2;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
@@ -165,15 +218,77 @@ int ff_slice_thread_init(AVCodecContext *avctx)
         return 0;
     }
     avctx->thread_count = thread_count;
+    avpriv_slicethread_set_affinity(c->thread, avctx->thread_affinity, avctx->numa_node);
 
     avctx->execute = thread_execute;
     avctx->execute2 = thread_execute2;
     return 0;
 }
 
+int ff_slice_thread_pool_init(AVCodecContext *avctx, SliceThreadPool **ppool,
+                              int thread_count)
+{
+    SliceThreadPool *pool = av_mallocz(sizeof(*pool));
+
+    *ppool = NULL;
+    if (!pool)
+        return AVERROR(ENOMEM);
+
+    pool->thread_count = avpriv_slicethread_create(&pool->thread, pool, pool_worker_func,
+                                                   NULL, thread_count);
+    if (pool->thread_count <= 1) {
+        int ret = pool->thread_count < 0 ? pool->thread_count : 0;
+        avpriv_slicethread_free(&pool->thread);
+        av_free(pool);
+        return ret;
+    }
+    avpriv_slicethread_set_affinity(pool->thread, avctx->thread_affinity, avctx->numa_node);
+    pthread_mutex_init(&pool->lock, NULL);
+
+    *ppool = pool;
+    return pool->thread_count;
+}
+
+void ff_slice_thread_pool_free(SliceThreadPool **ppool)
+{
+    SliceThreadPool *pool = *ppool;
+
+    if (!pool)
+        return;
+
+    avpriv_slicethread_free(&pool->thread);
+    pthread_mutex_destroy(&pool->lock);
+    av_freep(ppool);
+}
+
+int ff_slice_thread_init_shared(AVCodecContext *avctx, SliceThreadPool *pool)
+{
+    SliceThreadContext *c = av_mallocz(sizeof(*c));
+
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->pool = pool;
+
+    avctx->internal->slice_thread_ctx = c;
+    avctx->execute  = thread_execute;
+    avctx->execute2 = thread_execute2;
+    return 0;
+}
+
+void ff_slice_thread_free_shared(AVCodecContext *avctx)
+{
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
+
+    if (!c)
+        return;
+
+    free_progress(c);
+    av_freep(&avctx->internal->slice_thread_ctx);
+}
+
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = get_slice_thread_ctx(avctx);
     int *entries = p->entries;
 
     pthread_mutex_lock(&p->progress_mutex[thread]);
@@ -184,7 +299,7 @@ void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, in
 
 void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int shift)
 {
-    SliceThreadContext *p  = avctx->internal->thread_ctx;
+    SliceThreadContext *p  = get_slice_thread_ctx(avctx);
     int *entries      = p->entries;
 
     if (!entries || !field) return;
@@ -203,14 +318,15 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
     int i;
 
     if (avctx->active_thread_type & FF_THREAD_SLICE)  {
-        SliceThreadContext *p = avctx->internal->thread_ctx;
+        SliceThreadContext *p = get_slice_thread_ctx(avctx);
+        int thread_count = p->pool ? p->pool->thread_count : avctx->thread_count;
 
         if (p->entries) {
-            av_assert0(p->thread_count == avctx->thread_count);
+            av_assert0(p->thread_count == thread_count);
             av_freep(&p->entries);
         }
 
-        p->thread_count  = avctx->thread_count;
+        p->thread_count  = thread_count;
         p->entries       = av_mallocz_array(count, sizeof(int));
 
         if (!p->progress_mutex) {
@@ -237,6 +353,6 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
 
 void ff_reset_entries(AVCodecContext *avctx)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = get_slice_thread_ctx(avctx);
     memset(p->entries, 0, p->entries_count * sizeof(int));
 }
@@ -0,0 +1,203 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode with frame threads in low delay mode, stall the decoding of one
+ * frame and print the number of frames pending after each packet: it must
+ * go back to zero once the stalled frame is done.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define WIDTH       64
+#define HEIGHT      64
+#define NB_FRAMES   16
+#define NB_THREADS  4
+#define STALL_FRAME 5
+#define TIMEOUT     (10 * 1000000)
+
+static pthread_mutex_t stall_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  stall_cond  = PTHREAD_COND_INITIALIZER;
+static int stall_released;
+
+/* called by the decoding threads after the frame setup */
+static void stall_frame(AVCodecContext *avctx, const AVFrame *src,
+                        int offset[AV_NUM_DATA_POINTERS],
+                        int y, int type, int height)
+{
+    if (src->pts != STALL_FRAME || y)
+        return;
+
+    pthread_mutex_lock(&stall_mutex);
+    while (!stall_released)
+        pthread_cond_wait(&stall_cond, &stall_mutex);
+    pthread_mutex_unlock(&stall_mutex);
+}
+
+static void release_stall(void)
+{
+    pthread_mutex_lock(&stall_mutex);
+    stall_released = 1;
+    pthread_cond_broadcast(&stall_cond);
+    pthread_mutex_unlock(&stall_mutex);
+}
+
+static int encode_frames(AVPacket **pkts)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    AVCodecContext *enc = NULL;
+    AVFrame *frame = NULL;
+    int i, nb_pkts = 0, ret;
+
+    if (!codec) {
+        fprintf(stderr, "MPEG-4 encoder not found\n");
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+    enc   = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!enc || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    enc->width     = frame->width  = WIDTH;
+    enc->height    = frame->height = HEIGHT;
+    enc->pix_fmt   = frame->format = AV_PIX_FMT_YUV420P;
+    enc->time_base = (AVRational){ 1, 25 };
+    /* intra only, so that the frames after the stalled one do not wait for it */
+    enc->gop_size  = 1;
+    if ((ret = avcodec_open2(enc, codec, NULL)) < 0 ||
+        (ret = av_frame_get_buffer(frame, 0)) < 0)
+        goto end;
+
+    for (i = 0; i <= NB_FRAMES; i++) {
+        if (i < NB_FRAMES) {
+            if ((ret = av_frame_make_writable(frame)) < 0)
+                goto end;
+            memset(frame->data[0], 16 + 8 * i, frame->linesize[0] * HEIGHT);
+            memset(frame->data[1], 128, frame->linesize[1] * HEIGHT / 2);
+            memset(frame->data[2], 128, frame->linesize[2] * HEIGHT / 2);
+            frame->pts = i;
+        }
+        if ((ret = avcodec_send_frame(enc, i < NB_FRAMES ? frame : NULL)) < 0)
+            goto end;
+        while (nb_pkts < NB_FRAMES) {
+            if (!pkts[nb_pkts] && !(pkts[nb_pkts] = av_packet_alloc())) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            ret = avcodec_receive_packet(enc, pkts[nb_pkts]);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+                goto end;
+            nb_pkts++;
+        }
+    }
+    ret = nb_pkts == NB_FRAMES ? 0 : AVERROR_BUG;
+
+end:
+    av_frame_free(&frame);
+    avcodec_free_context(&enc);
+    return ret;
+}
+
+/* receive the available frames, waiting for the pending ones if asked to */
+static int receive_frames(AVCodecContext *dec, AVFrame *frame,
+                          int nb_sent, int *nb_received, int wait)
+{
+    int64_t start = av_gettime_relative();
+    int ret;
+
+    for (;;) {
+        ret = avcodec_receive_frame(dec, frame);
+        if (ret >= 0) {
+            av_frame_unref(frame);
+            (*nb_received)++;
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN))
+            return ret == AVERROR_EOF ? 0 : ret;
+        if (!wait || *nb_received == nb_sent ||
+            av_gettime_relative() - start > TIMEOUT)
+            return 0;
+        av_usleep(1000);
+    }
+}
+
+int main(void)
+{
+    AVPacket *pkts[NB_FRAMES] = { NULL };
+    const AVCodec *codec;
+    AVCodecContext *dec = NULL;
+    AVFrame *frame = NULL;
+    int i, nb_received = 0, ret;
+
+    if ((ret = encode_frames(pkts)) < 0)
+        goto end;
+
+    codec = avcodec_find_decoder(AV_CODEC_ID_MPEG4);
+    dec   = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!dec || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    dec->thread_count    = NB_THREADS;
+    dec->thread_type     = FF_THREAD_FRAME;
+    dec->flags2         |= AV_CODEC_FLAG2_THREAD_LOW_DELAY;
+    dec->draw_horiz_band = stall_frame;
+    dec->slice_flags     = SLICE_FLAG_CODED_ORDER;
+    if ((ret = avcodec_open2(dec, codec, NULL)) < 0)
+        goto end;
+
+    for (i = 0; i < NB_FRAMES; i++) {
+        /* keep sending packets while the stalled frame blocks its thread,
+         * then release it before every thread is busy */
+        int stalled = i >= STALL_FRAME && i < STALL_FRAME + NB_THREADS - 2;
+
+        if ((ret = avcodec_send_packet(dec, pkts[i])) < 0)
+            goto end;
+        if (i == STALL_FRAME + NB_THREADS - 2)
+            release_stall();
+        if ((ret = receive_frames(dec, frame, i + 1, &nb_received, !stalled)) < 0)
+            goto end;
+        printf("packet %2d: %d frames pending\n", i, i + 1 - nb_received);
+    }
+
+    if ((ret = avcodec_send_packet(dec, NULL)) < 0 ||
+        (ret = receive_frames(dec, frame, NB_FRAMES, &nb_received, 0)) < 0)
+        goto end;
+    printf("flush: %d frames decoded\n", nb_received);
+
+end:
+    for (i = 0; i < NB_FRAMES; i++)
+        av_packet_free(&pkts[i]);
+    av_frame_free(&frame);
+    avcodec_free_context(&dec);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
@@ -60,6 +60,17 @@ void ff_thread_flush(AVCodecContext *avctx);
 int ff_thread_decode_frame(AVCodecContext *avctx, AVFrame *picture,
                            int *got_picture_ptr, AVPacket *avpkt);
 
+/**
+ * Check whether a frame decoded with AV_CODEC_FLAG2_THREAD_LOW_DELAY can be
+ * returned before the next packet is submitted. It is then returned by
+ * ff_thread_decode_frame() called with an empty packet, which does not start
+ * draining the decoder.
+ *
+ * @param avctx The context.
+ * @return 1 if the oldest pending frame is decoded, 0 otherwise
+ */
+int ff_thread_can_output_frame(AVCodecContext *avctx);
+
 /**
  * If the codec defines update_thread_context(), call this
  * when they are ready for the next thread to start decoding
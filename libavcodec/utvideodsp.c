@@ -77,6 +77,8 @@ av_cold void ff_utvideodsp_init(UTVideoDSPContext *c)
     c->restore_rgb_planes   = restore_rgb_planes_c;
     c->restore_rgb_planes10 = restore_rgb_planes10_c;
 
+    if (ARCH_AARCH64)
+        ff_utvideodsp_init_aarch64(c);
     if (ARCH_X86)
         ff_utvideodsp_init_x86(c);
 }
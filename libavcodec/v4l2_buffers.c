@@ -32,8 +32,13 @@
 #include "libavutil/pixdesc.h"
 #include "v4l2_context.h"
 #include "v4l2_buffers.h"
+#include "v4l2_fmt.h"
 #include "v4l2_m2m.h"
 
+#if CONFIG_LIBDRM
+#include <drm_fourcc.h>
+#endif
+
 #define USEC_PER_SEC 1000000
 static AVRational v4l2_timebase = { 1, USEC_PER_SEC };
 
@@ -338,6 +343,102 @@ static int v4l2_buffer_buf_to_swframe(AVFrame *frame, V4L2Buffer *avbuf)
     return 0;
 }
 
+#if CONFIG_LIBDRM
+static int v4l2_buffer_buf_to_drmframe(AVFrame *frame, V4L2Buffer *avbuf)
+{
+    V4L2m2mContext *s = buf_to_m2mctx(avbuf);
+    int ret;
+
+    frame->format = AV_PIX_FMT_DRM_PRIME;
+
+    /* the descriptor lives as long as the buffer, which is only queued
+     * back to the driver once the frame is released */
+    frame->buf[0] = av_buffer_create((uint8_t *)&avbuf->drm_frame, sizeof(avbuf->drm_frame),
+                                     v4l2_free_buffer, avbuf, AV_BUFFER_FLAG_READONLY);
+    if (!frame->buf[0])
+        return AVERROR(ENOMEM);
+
+    ret = v4l2_buf_increase_ref(avbuf);
+    if (ret) {
+        av_buffer_unref(&frame->buf[0]);
+        return ret;
+    }
+
+    frame->data[0] = frame->buf[0]->data;
+
+    frame->hw_frames_ctx = av_buffer_ref(s->frames_ref);
+    if (!frame->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int v4l2_buffer_export_drm(V4L2Buffer *avbuf)
+{
+    V4L2Context *ctx = avbuf->context;
+    AVDRMFrameDescriptor *desc = &avbuf->drm_frame;
+    AVDRMLayerDescriptor *layer = &desc->layers[0];
+    int height = V4L2_TYPE_IS_MULTIPLANAR(ctx->type) ?
+                 ctx->format.fmt.pix_mp.height : ctx->format.fmt.pix.height;
+    int i;
+
+    for (i = 0; i < avbuf->num_planes; i++) {
+        struct v4l2_exportbuffer expbuf = {
+            .type  = ctx->type,
+            .index = avbuf->buf.index,
+            .plane = i,
+            .flags = O_RDONLY | O_CLOEXEC,
+        };
+
+        if (ioctl(buf_to_m2mctx(avbuf)->fd, VIDIOC_EXPBUF, &expbuf) < 0)
+            return AVERROR(errno);
+
+        desc->objects[i].fd              = expbuf.fd;
+        desc->objects[i].size            = avbuf->plane_info[i].length;
+        desc->objects[i].format_modifier = DRM_FORMAT_MOD_LINEAR;
+        desc->nb_objects = i + 1;
+
+        layer->planes[i].object_index = i;
+        layer->planes[i].offset       = 0;
+        layer->planes[i].pitch        = avbuf->plane_info[i].bytesperline;
+    }
+
+    desc->nb_layers  = 1;
+    layer->format    = ff_v4l2_format_avfmt_to_drm(ctx->av_pix_fmt);
+    layer->nb_planes = avbuf->num_planes;
+
+    /* the chroma planes of single plane formats follow the luma plane */
+    if (avbuf->num_planes > 1)
+        return 0;
+
+    switch (ctx->av_pix_fmt) {
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_NV21:
+    case AV_PIX_FMT_NV16:
+        layer->nb_planes = 2;
+        layer->planes[1].object_index = 0;
+        layer->planes[1].offset = layer->planes[0].pitch * height;
+        layer->planes[1].pitch  = layer->planes[0].pitch;
+        break;
+
+    case AV_PIX_FMT_YUV420P:
+        layer->nb_planes = 3;
+        layer->planes[1].object_index = 0;
+        layer->planes[1].offset = layer->planes[0].pitch * height;
+        layer->planes[1].pitch  = layer->planes[0].pitch >> 1;
+        layer->planes[2].object_index = 0;
+        layer->planes[2].offset = layer->planes[1].offset + ((layer->planes[0].pitch * height) >> 2);
+        layer->planes[2].pitch  = layer->planes[0].pitch >> 1;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+#endif
+
 static int v4l2_buffer_swframe_to_buf(const AVFrame *frame, V4L2Buffer *out)
 {
     int i, ret;
@@ -423,7 +524,12 @@ int ff_v4l2_buffer_buf_to_avframe(AVFrame *frame, V4L2Buffer *avbuf)
     av_frame_unref(frame);
 
     /* 1. get references to the actual data */
-    ret = v4l2_buffer_buf_to_swframe(frame, avbuf);
+#if CONFIG_LIBDRM
+    if (buf_to_m2mctx(avbuf)->output_drm)
+        ret = v4l2_buffer_buf_to_drmframe(frame, avbuf);
+    else
+#endif
+        ret = v4l2_buffer_buf_to_swframe(frame, avbuf);
     if (ret)
         return ret;
 
@@ -546,6 +652,14 @@ int ff_v4l2_buffer_initialize(V4L2Buffer* avbuf, int index)
     if (V4L2_TYPE_IS_OUTPUT(ctx->type))
         return 0;
 
+#if CONFIG_LIBDRM
+    if (buf_to_m2mctx(avbuf)->output_drm) {
+        ret = v4l2_buffer_export_drm(avbuf);
+        if (ret)
+            return ret;
+    }
+#endif
+
     if (V4L2_TYPE_IS_MULTIPLANAR(ctx->type)) {
         avbuf->buf.m.planes = avbuf->planes;
         avbuf->buf.length   = avbuf->num_planes;
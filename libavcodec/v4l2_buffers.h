@@ -27,6 +27,8 @@
 #include <stdatomic.h>
 #include <linux/videodev2.h>
 
+#include "libavutil/hwcontext_drm.h"
+
 #include "avcodec.h"
 
 enum V4L2Buffer_status {
@@ -56,6 +58,11 @@ typedef struct V4L2Buffer {
 
     int num_planes;
 
+    /* dmabufs of the planes exported with VIDIOC_EXPBUF, described as
+     * returned in AV_PIX_FMT_DRM_PRIME frames; nb_objects is 0 when the
+     * buffer is not exported */
+    AVDRMFrameDescriptor drm_frame;
+
     /* the v4l2_buffer buf.m.planes pointer uses the planes[] mem */
     struct v4l2_buffer buf;
     struct v4l2_plane planes[VIDEO_MAX_PLANES];
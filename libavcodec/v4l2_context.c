@@ -437,6 +437,9 @@ static int v4l2_release_buffers(V4L2Context* ctx)
                 if (munmap(p->mm_addr, p->length) < 0)
                     av_log(logger(ctx), AV_LOG_ERROR, "%s unmap plane (%s))\n", ctx->name, av_err2str(AVERROR(errno)));
         }
+
+        for (j = 0; j < buffer->drm_frame.nb_objects; j++)
+            close(buffer->drm_frame.objects[j].fd);
     }
 
     return ioctl(ctx_to_m2mctx(ctx)->fd, VIDIOC_REQBUFS, &req);
@@ -23,6 +23,13 @@
 
 #include <linux/videodev2.h>
 #include <search.h>
+
+#include "config.h"
+
+#if CONFIG_LIBDRM
+#include <drm_fourcc.h>
+#endif
+
 #include "v4l2_fmt.h"
 
 #define V4L2_FMT(x) V4L2_PIX_FMT_##x
@@ -129,6 +136,21 @@ uint32_t ff_v4l2_format_avfmt_to_v4l2(enum AVPixelFormat avfmt)
     return 0;
 }
 
+#if CONFIG_LIBDRM
+uint32_t ff_v4l2_format_avfmt_to_drm(enum AVPixelFormat avfmt)
+{
+    switch (avfmt) {
+    case AV_PIX_FMT_NV12:    return DRM_FORMAT_NV12;
+    case AV_PIX_FMT_NV21:    return DRM_FORMAT_NV21;
+    case AV_PIX_FMT_NV16:    return DRM_FORMAT_NV16;
+    case AV_PIX_FMT_YUV420P: return DRM_FORMAT_YUV420;
+    default:
+        break;
+    }
+    return 0;
+}
+#endif
+
 enum AVPixelFormat ff_v4l2_format_v4l2_to_avfmt(uint32_t v4l2_fmt, enum AVCodecID avcodec)
 {
     int i;
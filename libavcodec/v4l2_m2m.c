@@ -328,6 +328,9 @@ static void v4l2_m2m_destroy_context(void *opaque, uint8_t *context)
     ff_v4l2_context_release(&s->capture);
     sem_destroy(&s->refsync);
 
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+
     close(s->fd);
 
     av_free(s);
@@ -58,6 +58,11 @@ typedef struct V4L2m2mContext {
     int draining;
     AVPacket buf_pkt;
 
+    /* the capture buffers are exported and returned as DRM PRIME frames */
+    int output_drm;
+    AVBufferRef *device_ref;
+    AVBufferRef *frames_ref;
+
     /* Reference to self; only valid while codec is active. */
     AVBufferRef *self_ref;
 
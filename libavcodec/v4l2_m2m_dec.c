@@ -23,17 +23,79 @@
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include "libavutil/hwcontext.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/opt.h"
 #include "libavcodec/avcodec.h"
 #include "libavcodec/decode.h"
+#include "libavcodec/hwaccel.h"
 #include "libavcodec/internal.h"
 
 #include "v4l2_context.h"
 #include "v4l2_m2m.h"
 #include "v4l2_fmt.h"
 
+static int v4l2_get_pix_fmt(AVCodecContext *avctx)
+{
+    V4L2m2mContext *s = ((V4L2m2mPriv*)avctx->priv_data)->context;
+    V4L2Context *const capture = &s->capture;
+    enum AVPixelFormat pix_fmts[3] = { AV_PIX_FMT_NONE, AV_PIX_FMT_NONE, AV_PIX_FMT_NONE };
+    int n = 0, ret;
+
+    s->output_drm = 0;
+
+    if (capture->av_pix_fmt == AV_PIX_FMT_NONE) {
+        avctx->pix_fmt = AV_PIX_FMT_NONE;
+        return 0;
+    }
+
+#if CONFIG_LIBDRM
+    /* the capture buffers can be exported instead of being mapped */
+    if (ff_v4l2_format_avfmt_to_drm(capture->av_pix_fmt))
+        pix_fmts[n++] = AV_PIX_FMT_DRM_PRIME;
+#endif
+    pix_fmts[n++] = capture->av_pix_fmt;
+
+    ret = ff_get_format(avctx, pix_fmts);
+    if (ret < 0)
+        return AVERROR(EINVAL);
+    avctx->pix_fmt = ret;
+
+#if CONFIG_LIBDRM
+    if (avctx->pix_fmt == AV_PIX_FMT_DRM_PRIME) {
+        AVHWFramesContext *hwframes;
+
+        if (!s->device_ref) {
+            s->device_ref = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_DRM);
+            if (!s->device_ref)
+                return AVERROR(ENOMEM);
+            ret = av_hwdevice_ctx_init(s->device_ref);
+            if (ret < 0)
+                return ret;
+        }
+
+        av_buffer_unref(&s->frames_ref);
+        s->frames_ref = av_hwframe_ctx_alloc(s->device_ref);
+        if (!s->frames_ref)
+            return AVERROR(ENOMEM);
+
+        hwframes = (AVHWFramesContext*)s->frames_ref->data;
+        hwframes->format    = AV_PIX_FMT_DRM_PRIME;
+        hwframes->sw_format = capture->av_pix_fmt;
+        hwframes->width     = capture->width;
+        hwframes->height    = capture->height;
+        ret = av_hwframe_ctx_init(s->frames_ref);
+        if (ret < 0)
+            return ret;
+
+        s->output_drm = 1;
+    }
+#endif
+
+    return 0;
+}
+
 static int v4l2_try_start(AVCodecContext *avctx)
 {
     V4L2m2mContext *s = ((V4L2m2mPriv*)avctx->priv_data)->context;
@@ -63,8 +125,7 @@ static int v4l2_try_start(AVCodecContext *avctx)
     }
 
     /* 2.1 update the AVCodecContext */
-    avctx->pix_fmt = ff_v4l2_format_v4l2_to_avfmt(capture->format.fmt.pix_mp.pixelformat, AV_CODEC_ID_RAWVIDEO);
-    capture->av_pix_fmt = avctx->pix_fmt;
+    capture->av_pix_fmt = ff_v4l2_format_v4l2_to_avfmt(capture->format.fmt.pix_mp.pixelformat, AV_CODEC_ID_RAWVIDEO);
 
     /* 3. set the crop parameters */
     selection.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -83,6 +144,13 @@ static int v4l2_try_start(AVCodecContext *avctx)
         }
     }
 
+    /* 3.1 negotiate the output format now that the size is known */
+    ret = v4l2_get_pix_fmt(avctx);
+    if (ret < 0) {
+        av_log(avctx, AV_LOG_ERROR, "can't get the output format\n");
+        return ret;
+    }
+
     /* 4. init the capture context now that we have the capture format */
     if (!capture->buffers) {
         ret = ff_v4l2_context_init(capture);
@@ -228,10 +296,17 @@ static av_cold int v4l2_decode_close(AVCodecContext *avctx)
 static const AVOption options[] = {
     V4L_M2M_DEFAULT_OPTS,
     { "num_capture_buffers", "Number of buffers in the capture context",
-        OFFSET(num_capture_buffers), AV_OPT_TYPE_INT, {.i64 = 20}, 20, INT_MAX, FLAGS },
+        OFFSET(num_capture_buffers), AV_OPT_TYPE_INT, {.i64 = 20}, 2, INT_MAX, FLAGS },
     { NULL},
 };
 
+static const AVCodecHWConfigInternal *v4l2_m2m_hw_configs[] = {
+#if CONFIG_LIBDRM
+    HW_CONFIG_INTERNAL(DRM_PRIME),
+#endif
+    NULL
+};
+
 #define M2MDEC_CLASS(NAME) \
     static const AVClass v4l2_m2m_ ## NAME ## _dec_class = { \
         .class_name = #NAME "_v4l2m2m_decoder", \
@@ -253,6 +328,7 @@ static const AVOption options[] = {
         .receive_frame  = v4l2_receive_frame, \
         .close          = v4l2_decode_close, \
         .bsfs           = bsf_name, \
+        .hw_configs     = v4l2_m2m_hw_configs, \
         .capabilities   = AV_CODEC_CAP_HARDWARE | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_AVOID_PROBING, \
         .caps_internal  = FF_CODEC_CAP_SETS_PKT_DTS, \
         .wrapper_name   = "v4l2m2m", \
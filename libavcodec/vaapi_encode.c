@@ -1117,20 +1117,36 @@ int ff_vaapi_encode_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
             return AVERROR(EAGAIN);
     }
 
-    pic = NULL;
-    err = vaapi_encode_pick_next(avctx, &pic);
-    if (err < 0)
-        return err;
-    av_assert0(pic);
+    // Issue as many pictures as possible, so that the driver can work on
+    // them while the output of the oldest one is read.
+    while (av_fifo_space(ctx->encode_fifo) >= sizeof(pic)) {
+        pic = NULL;
+        err = vaapi_encode_pick_next(avctx, &pic);
+        if (err == AVERROR(EAGAIN) || err == AVERROR_EOF)
+            break;
+        if (err < 0)
+            return err;
+        av_assert0(pic);
 
-    pic->encode_order = ctx->encode_order++;
+        pic->encode_order = ctx->encode_order++;
 
-    err = vaapi_encode_issue(avctx, pic);
-    if (err < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Encode failed: %d.\n", err);
-        return err;
+        err = vaapi_encode_issue(avctx, pic);
+        if (err < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Encode failed: %d.\n", err);
+            return err;
+        }
+
+        av_fifo_generic_write(ctx->encode_fifo, &pic, sizeof(pic), NULL);
     }
 
+    if (!av_fifo_size(ctx->encode_fifo))
+        return ctx->end_of_stream ? AVERROR_EOF : AVERROR(EAGAIN);
+    // Keep async_depth pictures in flight until the end of the stream.
+    if (!ctx->end_of_stream && av_fifo_space(ctx->encode_fifo) >= sizeof(pic))
+        return AVERROR(EAGAIN);
+
+    av_fifo_generic_read(ctx->encode_fifo, &pic, sizeof(pic), NULL);
+
     err = vaapi_encode_output(avctx, pic, pkt);
     if (err < 0) {
         av_log(avctx, AV_LOG_ERROR, "Output failed: %d.\n", err);
@@ -2308,6 +2324,13 @@ av_cold int ff_vaapi_encode_init(AVCodecContext *avctx)
     ctx->output_delay = ctx->b_per_p;
     ctx->decode_delay = ctx->max_b_depth;
 
+    ctx->encode_fifo = av_fifo_alloc(ctx->async_depth *
+                                     sizeof(VAAPIEncodePicture*));
+    if (!ctx->encode_fifo) {
+        err = AVERROR(ENOMEM);
+        goto fail;
+    }
+
     if (ctx->codec->sequence_params_size > 0) {
         ctx->codec_sequence_params =
             av_mallocz(ctx->codec->sequence_params_size);
@@ -2375,6 +2398,7 @@ av_cold int ff_vaapi_encode_close(AVCodecContext *avctx)
     }
 
     av_buffer_pool_uninit(&ctx->output_buffer_pool);
+    av_fifo_freep(&ctx->encode_fifo);
 
     if (ctx->va_context != VA_INVALID_ID) {
         vaDestroyContext(ctx->hwctx->display, ctx->va_context);
@@ -27,6 +27,7 @@
 #include <va/va_str.h>
 #endif
 
+#include "libavutil/fifo.h"
 #include "libavutil/hwcontext.h"
 #include "libavutil/hwcontext_vaapi.h"
 
@@ -41,6 +42,7 @@ enum {
     MAX_DPB_SIZE           = 16,
     MAX_PICTURE_REFERENCES = 2,
     MAX_REORDER_DELAY      = 16,
+    MAX_ASYNC_DEPTH        = 64,
     MAX_PARAM_BUFFER_SIZE  = 1024,
 };
 
@@ -311,6 +313,12 @@ typedef struct VAAPIEncodeContext {
     int gop_counter;
     int end_of_stream;
 
+    // Maximum number of pictures issued to the driver and not yet
+    // output, set by the async_depth option.
+    int             async_depth;
+    // Pictures issued and not yet output, in encode order.
+    AVFifoBuffer   *encode_fifo;
+
     // Whether the driver supports ROI at all.
     int             roi_allowed;
     // Maximum number of regions supported by the driver.
@@ -436,7 +444,12 @@ int ff_vaapi_encode_close(AVCodecContext *avctx);
     { "b_depth", \
       "Maximum B-frame reference depth", \
       OFFSET(common.desired_b_depth), AV_OPT_TYPE_INT, \
-      { .i64 = 1 }, 1, INT_MAX, FLAGS }
+      { .i64 = 1 }, 1, INT_MAX, FLAGS }, \
+    { "async_depth", \
+      "Maximum number of pictures being encoded at once " \
+      "(1 waits for each picture before issuing the next one)", \
+      OFFSET(common.async_depth), AV_OPT_TYPE_INT, \
+      { .i64 = 2 }, 1, MAX_ASYNC_DEPTH, FLAGS }
 
 #define VAAPI_ENCODE_RC_MODE(name, desc) \
     { #name, desc, 0, AV_OPT_TYPE_CONST, { .i64 = RC_MODE_ ## name }, \
@@ -41,7 +41,7 @@
 static void vp9_free_entries(AVCodecContext *avctx) {
     VP9Context *s = avctx->priv_data;
 
-    if (avctx->active_thread_type & FF_THREAD_SLICE)  {
+    if (avctx->active_thread_type & FF_THREAD_SLICE && s->entries)  {
         pthread_mutex_destroy(&s->progress_mutex);
         pthread_cond_destroy(&s->progress_cond);
         av_freep(&s->entries);
@@ -53,17 +53,16 @@ static int vp9_alloc_entries(AVCodecContext *avctx, int n) {
     int i;
 
     if (avctx->active_thread_type & FF_THREAD_SLICE)  {
-        if (s->entries)
-            av_freep(&s->entries);
+        vp9_free_entries(avctx);
 
-        s->entries = av_malloc_array(n, sizeof(atomic_int));
+        s->entries = av_malloc_array(2 * n, sizeof(atomic_int));
 
         if (!s->entries) {
             av_freep(&s->entries);
             return AVERROR(ENOMEM);
         }
 
-        for (i  = 0; i < n; i++)
+        for (i  = 0; i < 2 * n; i++)
             atomic_init(&s->entries[i], 0);
 
         pthread_mutex_init(&s->progress_mutex, NULL);
@@ -75,7 +74,7 @@ static int vp9_alloc_entries(AVCodecContext *avctx, int n) {
 static void vp9_report_tile_progress(VP9Context *s, int field, int n) {
     pthread_mutex_lock(&s->progress_mutex);
     atomic_fetch_add_explicit(&s->entries[field], n, memory_order_release);
-    pthread_cond_signal(&s->progress_cond);
+    pthread_cond_broadcast(&s->progress_cond);
     pthread_mutex_unlock(&s->progress_mutex);
 }
 
@@ -84,7 +83,7 @@ static void vp9_await_tile_progress(VP9Context *s, int field, int n) {
         return;
 
     pthread_mutex_lock(&s->progress_mutex);
-    while (atomic_load_explicit(&s->entries[field], memory_order_relaxed) != n)
+    while (atomic_load_explicit(&s->entries[field], memory_order_relaxed) < n)
         pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
     pthread_mutex_unlock(&s->progress_mutex);
 }
@@ -243,6 +242,10 @@ static int update_size(AVCodecContext *avctx, int w, int h)
     s->rows      = (h + 7) >> 3;
     lflvl_len    = avctx->active_thread_type == FF_THREAD_SLICE ? s->sb_rows : 1;
 
+    // the progress entries are indexed by sb row
+    if ((ret = vp9_alloc_entries(avctx, s->sb_rows)) < 0)
+        return ret;
+
 #define assign(var, type, n) var = (type) p; p += s->sb_cols * (n) * sizeof(*var)
     av_freep(&s->intra_pred_data[0]);
     // FIXME we slightly over-allocate here for subsampled chroma, but a little
@@ -1359,12 +1362,57 @@ static int decode_tiles(AVCodecContext *avctx,
 }
 
 #if HAVE_THREADS
+/* Loop filter sb rows as they become available. Rows are claimed one at a
+ * time, so several threads can work on the frame as a wavefront: the top
+ * edge of a superblock modifies the bottom of the one above, and the left
+ * edge of the next superblock in that row modifies its right side, so
+ * (row, col) waits for (row - 1, col + 1) to be filtered. */
+static void loopfilter_rows(AVCodecContext *avctx)
+{
+    VP9Context *s = avctx->priv_data;
+    ptrdiff_t uvoff, yoff, ls_y, ls_uv;
+    VP9Filter *lflvl_ptr;
+    int bytesperpixel = s->bytesperpixel, col, i;
+    AVFrame *f;
+
+    f = s->s.frames[CUR_FRAME].tf.f;
+    ls_y = f->linesize[0];
+    ls_uv =f->linesize[1];
+
+    while ((i = atomic_fetch_add_explicit(&s->lf_row, 1, memory_order_relaxed)) < s->sb_rows) {
+        vp9_await_tile_progress(s, i, s->s.h.tiling.tile_cols);
+
+        if (s->s.h.filter.level) {
+            yoff = (ls_y * 64)*i;
+            uvoff =  (ls_uv * 64 >> s->ss_v)*i;
+            lflvl_ptr = s->lflvl+s->sb_cols*i;
+            for (col = 0; col < s->cols;
+                 col += 8, yoff += 64 * bytesperpixel,
+                 uvoff += 64 * bytesperpixel >> s->ss_h, lflvl_ptr++) {
+                if (i)
+                    vp9_await_tile_progress(s, s->sb_rows + i - 1,
+                                            FFMIN((col >> 3) + 2, s->sb_cols));
+                ff_vp9_loopfilter_sb(avctx, lflvl_ptr, i << 3, col,
+                                     yoff, uvoff);
+                vp9_report_tile_progress(s, s->sb_rows + i, 1);
+            }
+        }
+    }
+}
+
+static av_always_inline
+int loopfilter_proc(AVCodecContext *avctx)
+{
+    loopfilter_rows(avctx);
+    return 0;
+}
+
 static av_always_inline
 int decode_tiles_mt(AVCodecContext *avctx, void *tdata, int jobnr,
                               int threadnr)
 {
     VP9Context *s = avctx->priv_data;
-    VP9TileData *td = &s->td[jobnr];
+    VP9TileData *td;
     ptrdiff_t uvoff, yoff, ls_y, ls_uv;
     int bytesperpixel = s->bytesperpixel, row, col, tile_row;
     unsigned tile_cols_len;
@@ -1372,6 +1420,14 @@ int decode_tiles_mt(AVCodecContext *avctx, void *tdata, int jobnr,
     VP9Filter *lflvl_ptr_base;
     AVFrame *f;
 
+    // jobs past the tile columns only start once all tiles have been taken
+    // by a thread, so they can wait on them without risk of deadlock
+    if (jobnr >= s->s.h.tiling.tile_cols) {
+        loopfilter_rows(avctx);
+        return 0;
+    }
+
+    td = &s->td[jobnr];
     f = s->s.frames[CUR_FRAME].tf.f;
     ls_y = f->linesize[0];
     ls_uv =f->linesize[1];
@@ -1436,36 +1492,6 @@ int decode_tiles_mt(AVCodecContext *avctx, void *tdata, int jobnr,
     return 0;
 }
 
-static av_always_inline
-int loopfilter_proc(AVCodecContext *avctx)
-{
-    VP9Context *s = avctx->priv_data;
-    ptrdiff_t uvoff, yoff, ls_y, ls_uv;
-    VP9Filter *lflvl_ptr;
-    int bytesperpixel = s->bytesperpixel, col, i;
-    AVFrame *f;
-
-    f = s->s.frames[CUR_FRAME].tf.f;
-    ls_y = f->linesize[0];
-    ls_uv =f->linesize[1];
-
-    for (i = 0; i < s->sb_rows; i++) {
-        vp9_await_tile_progress(s, i, s->s.h.tiling.tile_cols);
-
-        if (s->s.h.filter.level) {
-            yoff = (ls_y * 64)*i;
-            uvoff =  (ls_uv * 64 >> s->ss_v)*i;
-            lflvl_ptr = s->lflvl+s->sb_cols*i;
-            for (col = 0; col < s->cols;
-                 col += 8, yoff += 64 * bytesperpixel,
-                 uvoff += 64 * bytesperpixel >> s->ss_h, lflvl_ptr++) {
-                ff_vp9_loopfilter_sb(avctx, lflvl_ptr, i << 3, col,
-                                     yoff, uvoff);
-            }
-        }
-    }
-    return 0;
-}
 #endif
 
 static int vp9_decode_frame(AVCodecContext *avctx, void *frame,
@@ -1600,8 +1626,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 #if HAVE_THREADS
     if (avctx->active_thread_type & FF_THREAD_SLICE) {
-        for (i = 0; i < s->sb_rows; i++)
+        for (i = 0; i < 2 * s->sb_rows; i++)
             atomic_store(&s->entries[i], 0);
+        atomic_store(&s->lf_row, 0);
     }
 #endif
 
@@ -1618,7 +1645,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 #if HAVE_THREADS
         if (avctx->active_thread_type == FF_THREAD_SLICE) {
-            int tile_row, tile_col;
+            int tile_row, tile_col, lf_jobs;
 
             av_assert1(!s->pass);
 
@@ -1646,7 +1673,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_slice_thread_execute_with_mainfunc(avctx, decode_tiles_mt, loopfilter_proc, s->td, NULL, s->s.h.tiling.tile_cols);
+            // idle slice threads help the main thread with the loop filter
+            lf_jobs = s->s.h.filter.level ?
+                      av_clip(avctx->thread_count - s->s.h.tiling.tile_cols, 0, s->sb_rows - 1) : 0;
+            ff_slice_thread_execute_with_mainfunc(avctx, decode_tiles_mt, loopfilter_proc, s->td, NULL,
+                                                  s->s.h.tiling.tile_cols + lf_jobs);
         } else
 #endif
         {
@@ -101,7 +101,9 @@ typedef struct VP9Context {
 #if HAVE_THREADS
     pthread_mutex_t progress_mutex;
     pthread_cond_t progress_cond;
-    atomic_int *entries;
+    atomic_int *entries;    ///< decoded tile columns per sb row, followed by
+                            ///< loop filtered superblocks per sb row
+    atomic_int lf_row;      ///< next sb row to be claimed by a loop filter thread
 #endif
 
     uint8_t ss_h, ss_v;
@@ -212,8 +214,8 @@ struct VP9TileData {
     DECLARE_ALIGNED(8, uint8_t, left_ref_ctx)[8];
     DECLARE_ALIGNED(8, uint8_t, left_filter_ctx)[8];
     // block reconstruction intermediates
-    DECLARE_ALIGNED(32, uint8_t, tmp_y)[64 * 64 * 2];
-    DECLARE_ALIGNED(32, uint8_t, tmp_uv)[2][64 * 64 * 2];
+    DECLARE_ALIGNED(64, uint8_t, tmp_y)[64 * 64 * 2];
+    DECLARE_ALIGNED(64, uint8_t, tmp_uv)[2][64 * 64 * 2];
     struct { int x, y; } min_mv, max_mv;
     int16_t *block_base, *block, *uvblock_base[2], *uvblock[2];
     uint8_t *eob_base, *uveob_base[2], *eob, *uveob[2];
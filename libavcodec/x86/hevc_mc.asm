@@ -95,6 +95,9 @@ SECTION .text
 
 %define hevc_qpel_filters_avx2_14 hevc_qpel_filters_avx2_10
 
+%define hevc_epel_filters_avx2_12 hevc_epel_filters_avx2_10
+%define hevc_qpel_filters_avx2_12 hevc_qpel_filters_avx2_10
+
 %if ARCH_X86_64
 
 %macro SIMPLE_BILOAD 4   ;width, tab, r1, r2
@@ -1655,18 +1658,23 @@ INIT_YMM avx2  ; adds ff_ and _avx2 to function name & enables 256b registers :
 
 HEVC_PUT_HEVC_PEL_PIXELS 32, 8
 HEVC_PUT_HEVC_PEL_PIXELS 16, 10
+HEVC_PUT_HEVC_PEL_PIXELS 16, 12
 
 HEVC_PUT_HEVC_EPEL 32, 8
 HEVC_PUT_HEVC_EPEL 16, 10
+HEVC_PUT_HEVC_EPEL 16, 12
 
 HEVC_PUT_HEVC_EPEL_HV 16, 10
+HEVC_PUT_HEVC_EPEL_HV 16, 12
 HEVC_PUT_HEVC_EPEL_HV 32, 8
 
 HEVC_PUT_HEVC_QPEL 32, 8
 
 HEVC_PUT_HEVC_QPEL 16, 10
+HEVC_PUT_HEVC_QPEL 16, 12
 
 HEVC_PUT_HEVC_QPEL_HV 16, 10
+HEVC_PUT_HEVC_QPEL_HV 16, 12
 
 %endif ;AVX2
 %endif ; ARCH_X86_64
@@ -106,6 +106,12 @@ void ff_hevc_put_hevc_pel_pixels32_10_avx2(int16_t *dst, uint8_t *_src, ptrdiff_
 void ff_hevc_put_hevc_pel_pixels48_10_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
 void ff_hevc_put_hevc_pel_pixels64_10_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
 
+void ff_hevc_put_hevc_pel_pixels16_12_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
+void ff_hevc_put_hevc_pel_pixels24_12_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
+void ff_hevc_put_hevc_pel_pixels32_12_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
+void ff_hevc_put_hevc_pel_pixels48_12_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
+void ff_hevc_put_hevc_pel_pixels64_12_avx2(int16_t *dst, uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
+
 
 
 void ff_hevc_put_hevc_uni_pel_pixels32_8_avx2(uint8_t *dst, ptrdiff_t dststride,uint8_t *_src, ptrdiff_t _srcstride, int height, intptr_t mx, intptr_t my,int width);
@@ -127,6 +133,12 @@ void ff_hevc_put_hevc_bi_pel_pixels32_10_avx2(uint8_t *_dst, ptrdiff_t _dststrid
 void ff_hevc_put_hevc_bi_pel_pixels48_10_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
 void ff_hevc_put_hevc_bi_pel_pixels64_10_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
 
+void ff_hevc_put_hevc_bi_pel_pixels16_12_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+void ff_hevc_put_hevc_bi_pel_pixels24_12_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+void ff_hevc_put_hevc_bi_pel_pixels32_12_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+void ff_hevc_put_hevc_bi_pel_pixels48_12_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+void ff_hevc_put_hevc_bi_pel_pixels64_12_avx2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride, int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+
 ///////////////////////////////////////////////////////////////////////////////
 // EPEL
 ///////////////////////////////////////////////////////////////////////////////
@@ -154,6 +166,12 @@ PEL_PROTOTYPE(epel_h32,10, avx2);
 PEL_PROTOTYPE(epel_h48,10, avx2);
 PEL_PROTOTYPE(epel_h64,10, avx2);
 
+PEL_PROTOTYPE(epel_h16,12, avx2);
+PEL_PROTOTYPE(epel_h24,12, avx2);
+PEL_PROTOTYPE(epel_h32,12, avx2);
+PEL_PROTOTYPE(epel_h48,12, avx2);
+PEL_PROTOTYPE(epel_h64,12, avx2);
+
 PEL_PROTOTYPE(epel_v16, 8, avx2);
 PEL_PROTOTYPE(epel_v24, 8, avx2);
 PEL_PROTOTYPE(epel_v32, 8, avx2);
@@ -166,6 +184,12 @@ PEL_PROTOTYPE(epel_v32,10, avx2);
 PEL_PROTOTYPE(epel_v48,10, avx2);
 PEL_PROTOTYPE(epel_v64,10, avx2);
 
+PEL_PROTOTYPE(epel_v16,12, avx2);
+PEL_PROTOTYPE(epel_v24,12, avx2);
+PEL_PROTOTYPE(epel_v32,12, avx2);
+PEL_PROTOTYPE(epel_v48,12, avx2);
+PEL_PROTOTYPE(epel_v64,12, avx2);
+
 PEL_PROTOTYPE(epel_hv16, 8, avx2);
 PEL_PROTOTYPE(epel_hv24, 8, avx2);
 PEL_PROTOTYPE(epel_hv32, 8, avx2);
@@ -178,6 +202,12 @@ PEL_PROTOTYPE(epel_hv32,10, avx2);
 PEL_PROTOTYPE(epel_hv48,10, avx2);
 PEL_PROTOTYPE(epel_hv64,10, avx2);
 
+PEL_PROTOTYPE(epel_hv16,12, avx2);
+PEL_PROTOTYPE(epel_hv24,12, avx2);
+PEL_PROTOTYPE(epel_hv32,12, avx2);
+PEL_PROTOTYPE(epel_hv48,12, avx2);
+PEL_PROTOTYPE(epel_hv64,12, avx2);
+
 ///////////////////////////////////////////////////////////////////////////////
 // QPEL
 ///////////////////////////////////////////////////////////////////////////////
@@ -205,6 +235,12 @@ PEL_PROTOTYPE(qpel_h32,10, avx2);
 PEL_PROTOTYPE(qpel_h48,10, avx2);
 PEL_PROTOTYPE(qpel_h64,10, avx2);
 
+PEL_PROTOTYPE(qpel_h16,12, avx2);
+PEL_PROTOTYPE(qpel_h24,12, avx2);
+PEL_PROTOTYPE(qpel_h32,12, avx2);
+PEL_PROTOTYPE(qpel_h48,12, avx2);
+PEL_PROTOTYPE(qpel_h64,12, avx2);
+
 PEL_PROTOTYPE(qpel_v16, 8, avx2);
 PEL_PROTOTYPE(qpel_v24, 8, avx2);
 PEL_PROTOTYPE(qpel_v32, 8, avx2);
@@ -217,6 +253,12 @@ PEL_PROTOTYPE(qpel_v32,10, avx2);
 PEL_PROTOTYPE(qpel_v48,10, avx2);
 PEL_PROTOTYPE(qpel_v64,10, avx2);
 
+PEL_PROTOTYPE(qpel_v16,12, avx2);
+PEL_PROTOTYPE(qpel_v24,12, avx2);
+PEL_PROTOTYPE(qpel_v32,12, avx2);
+PEL_PROTOTYPE(qpel_v48,12, avx2);
+PEL_PROTOTYPE(qpel_v64,12, avx2);
+
 PEL_PROTOTYPE(qpel_hv16, 8, avx2);
 PEL_PROTOTYPE(qpel_hv24, 8, avx2);
 PEL_PROTOTYPE(qpel_hv32, 8, avx2);
@@ -229,6 +271,12 @@ PEL_PROTOTYPE(qpel_hv32,10, avx2);
 PEL_PROTOTYPE(qpel_hv48,10, avx2);
 PEL_PROTOTYPE(qpel_hv64,10, avx2);
 
+PEL_PROTOTYPE(qpel_hv16,12, avx2);
+PEL_PROTOTYPE(qpel_hv24,12, avx2);
+PEL_PROTOTYPE(qpel_hv32,12, avx2);
+PEL_PROTOTYPE(qpel_hv48,12, avx2);
+PEL_PROTOTYPE(qpel_hv64,12, avx2);
+
 WEIGHTING_PROTOTYPES(8, sse4);
 WEIGHTING_PROTOTYPES(10, sse4);
 WEIGHTING_PROTOTYPES(12, sse4);
@@ -22,7 +22,13 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
+
+; for AVX-512 version only
+v210_luma_permute_avx512:   dw 32, 2, 3,36, 6, 7,40,10,11,44,14,15,48,18,19,52,22,23,56,26,27,60,30,31
+                            times 8 dw 0
+v210_chroma_permute_avx512: dw  0,34, 5, 8,42,13,16,50,21,24,58,29, 0, 0, 0, 0
+                            dw  1, 4,38, 9,12,46,17,20,54,25,28,62, 0, 0, 0, 0
 
 ; for AVX2 version only
 v210_luma_permute: dd 0,1,2,4,5,6,7,7  ; 32-byte alignment required
@@ -39,7 +45,7 @@ SECTION .text
 %macro v210_planar_unpack 1
 
 ; v210_planar_unpack(const uint32_t *src, uint16_t *y, uint16_t *u, uint16_t *v, int width)
-cglobal v210_planar_unpack_%1, 5, 5, 6 + 2 * cpuflag(avx2), src, y, u, v, w
+cglobal v210_planar_unpack_%1, 5, 5 + cpuflag(avx512), 6 + 2 * cpuflag(avx2), src, y, u, v, w, tmp
     movsxdifnidn wq, wd
     lea    yq, [yq+2*wq]
     add    uq, wq
@@ -48,7 +54,16 @@ cglobal v210_planar_unpack_%1, 5, 5, 6 + 2 * cpuflag(avx2), src, y, u, v, w
 
     VBROADCASTI128   m3, [v210_mult]
 
-%if cpuflag(avx2)
+%if cpuflag(avx512)
+    mova             m4, [v210_luma_permute_avx512]
+    mova             m5, [v210_chroma_permute_avx512]
+    mov            tmpd, 0xffffff
+    kmovd            k1, tmpd
+    mov            tmpd, 0xfff
+    kmovd            k2, tmpd
+    mov            tmpd, 0xffff
+    kmovw            k3, tmpd
+%elif cpuflag(avx2)
     VBROADCASTI128   m4, [v210_luma_shuf_avx2]
     VBROADCASTI128   m5, [v210_chroma_shuf_avx2]
     mova             m6, [v210_luma_permute]
@@ -59,7 +74,17 @@ cglobal v210_planar_unpack_%1, 5, 5, 6 + 2 * cpuflag(avx2), src, y, u, v, w
 %endif
 
 .loop:
-%ifidn %1, unaligned
+%if cpuflag(avx512)
+    ; width is a multiple of 12, so a short last iteration has 12 pixels left
+    cmp    wq, -(mmsize*3)/8
+    jle .full
+    kshiftrd k1, k1, 12
+    kshiftrd k2, k2, 6
+    kshiftrw k3, k3, 8
+.full:
+    ; only load the 32 bytes of source left on a short iteration
+    vmovdqu32 m0{k3}{z}, [srcq]
+%elifidn %1, unaligned
     movu   m0, [srcq]  ; yB v5 yA  u5 y9 v4  y8 u4 y7  v3 y6 u3  y5 v2 y4  u2 y3 v1  y2 u1 y1  v0 y0 u0
 %else
     mova   m0, [srcq]
@@ -70,7 +95,16 @@ cglobal v210_planar_unpack_%1, 5, 5, 6 + 2 * cpuflag(avx2), src, y, u, v, w
     psrlw  m1, 6                       ; yB yA u5 v4 y8 y7 v3 u3 y5 y4 u2 v1 y2 y1 v0 u0
     psrld  m0, 22                      ; 00 v5 00 y9 00 u4 00 y6 00 v2 00 y3 00 u1 00 y0
 
-%if cpuflag(avx2)
+%if cpuflag(avx512)
+    mova     m2, m4
+    vpermi2w m2, m1, m0                ; 8x00 y17 .. y1 y0
+    vmovdqu16 [yq+2*wq]{k1}, m2
+
+    vpermt2w m1, m5, m0                ; 4x00 vB .. v1 v0 4x00 uB .. u1 u0
+    vmovdqu16 [uq+wq]{k2}, ym1
+    vextracti64x4 ym1, m1, 1
+    vmovdqu16 [vq+wq]{k2}, ym1
+%elif cpuflag(avx2)
     vpblendd m2, m1, m0, 0x55          ; yB yA 00 y9 y8 y7 00 y6 y5 y4 00 y3 y2 y1 00 y0
     pshufb m2, m4                      ; 00 00 yB yA y9 y8 y7 y6 00 00 y5 y4 y3 y2 y1 y0
     vpermd m2, m6, m2                  ; 00 00 00 00 yB yA y9 y8 y7 y6 y5 y4 y3 y2 y1 y0
@@ -115,6 +149,11 @@ INIT_YMM avx2
 v210_planar_unpack unaligned
 %endif
 
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+v210_planar_unpack unaligned
+%endif
+
 INIT_XMM ssse3
 v210_planar_unpack aligned
 
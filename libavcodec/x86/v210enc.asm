@@ -21,17 +21,23 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
+
+; for AVX-512 version only
+v210_enc_luma_permute_10:   dw  0, 1, 2, 3, 4, 5, 0, 0, 6, 7, 8, 9,10,11, 0, 0
+                            dw 12,13,14,15,16,17, 0, 0,18,19,20,21,22,23, 0, 0
+v210_enc_chroma_permute_10: dw  0, 1, 2, 3,32,33,34,35, 3, 4, 5, 6,35,36,37,38
+                            dw  6, 7, 8, 9,38,39,40,41, 9,10,11,12,41,42,43,44
 
 cextern pw_4
 %define v210_enc_min_10 pw_4
 v210_enc_max_10: times 16 dw 0x3fb
 
-v210_enc_luma_mult_10: times 2 dw 4,1,16,4,1,16,0,0
-v210_enc_luma_shuf_10: times 2 db -1,0,1,-1,2,3,4,5,-1,6,7,-1,8,9,10,11
+v210_enc_luma_mult_10: times 4 dw 4,1,16,4,1,16,0,0
+v210_enc_luma_shuf_10: times 4 db -1,0,1,-1,2,3,4,5,-1,6,7,-1,8,9,10,11
 
-v210_enc_chroma_mult_10: times 2 dw 1,4,16,0,16,1,4,0
-v210_enc_chroma_shuf_10: times 2 db 0,1,8,9,-1,2,3,-1,10,11,4,5,-1,12,13,-1
+v210_enc_chroma_mult_10: times 4 dw 1,4,16,0,16,1,4,0
+v210_enc_chroma_shuf_10: times 4 db 0,1,8,9,-1,2,3,-1,10,11,4,5,-1,12,13,-1
 
 cextern pb_1
 %define v210_enc_min_8 pb_1
@@ -51,28 +57,50 @@ SECTION .text
 %macro v210_planar_pack_10 0
 
 ; v210_planar_pack_10(const uint16_t *y, const uint16_t *u, const uint16_t *v, uint8_t *dst, ptrdiff_t width)
-cglobal v210_planar_pack_10, 5, 5, 4+cpuflag(avx2), y, u, v, dst, width
+cglobal v210_planar_pack_10, 5, 5 + cpuflag(avx512), 4+cpuflag(avx2)+2*cpuflag(avx512), y, u, v, dst, width, tmp
     lea     r0, [yq+2*widthq]
     add     uq, widthq
     add     vq, widthq
     neg     widthq
 
+%if cpuflag(avx512)
+    vpbroadcastw m2, [v210_enc_min_10]
+    vpbroadcastw m3, [v210_enc_max_10]
+    mova         m5, [v210_enc_luma_permute_10]
+    mova         m6, [v210_enc_chroma_permute_10]
+    mov       tmpd, 0xffffff
+    kmovd       k1, tmpd
+    mov       tmpd, 0xfff
+    kmovd       k2, tmpd
+%else
     mova    m2, [v210_enc_min_10]
     mova    m3, [v210_enc_max_10]
+%endif
 
 .loop:
+%if cpuflag(avx512)
+    vmovdqu16    m0{k1}{z}, [yq+2*widthq]
+    vpermw       m0, m5, m0
+%else
     movu        xm0, [yq+2*widthq]
 %if cpuflag(avx2)
     vinserti128 m0,   m0, [yq+widthq*2+12], 1
+%endif
 %endif
     CLIPW   m0, m2, m3
 
+%if cpuflag(avx512)
+    vmovdqu16    m1{k2}{z}, [uq+widthq]
+    vmovdqu16    m4{k2}{z}, [vq+widthq]
+    vpermt2w     m1, m6, m4
+%else
     movq         xm1, [uq+widthq]
     movhps       xm1, [vq+widthq]
 %if cpuflag(avx2)
     movq         xm4, [uq+widthq+6]
     movhps       xm4, [vq+widthq+6]
     vinserti128  m1,   m1, xm4, 1
+%endif
 %endif
     CLIPW   m1, m2, m3
 
@@ -103,6 +131,11 @@ INIT_YMM avx2
 v210_planar_pack_10
 %endif
 
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+v210_planar_pack_10
+%endif
+
 %macro v210_planar_pack_8 0
 
 ; v210_planar_pack_8(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, ptrdiff_t width)
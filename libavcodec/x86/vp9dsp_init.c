@@ -43,6 +43,8 @@ decl_fpel_func(put, 32,   , avx);
 decl_fpel_func(put, 64,   , avx);
 decl_fpel_func(avg, 32, _8, avx2);
 decl_fpel_func(avg, 64, _8, avx2);
+decl_fpel_func(put, 64,   , avx512);
+decl_fpel_func(avg, 64, _8, avx512);
 
 decl_mc_funcs(4, mmxext, int16_t, 8, 8);
 decl_mc_funcs(8, sse2, int16_t,  8, 8);
@@ -407,6 +409,11 @@ av_cold void ff_vp9dsp_init_x86(VP9DSPContext *dsp, int bpp, int bitexact)
         init_ipred(32, avx2, tm, TM_VP8);
     }
 
+    if (EXTERNAL_AVX512(cpu_flags)) {
+        init_fpel_func(0, 0, 64, put, , avx512);
+        init_fpel_func(0, 1, 64, avg, _8, avx512);
+    }
+
 #undef init_fpel
 #undef init_subpel1
 #undef init_subpel2
@@ -566,6 +566,10 @@ filter_vx2_fn avg
 %if %2 == 4
 %define %%srcfn movh
 %define %%dstfn movh
+%elif mmsize == 64
+; frames and the callers' buffers are only guaranteed to be 32-byte aligned
+%define %%srcfn movu
+%define %%dstfn movu
 %else
 %define %%srcfn movu
 %define %%dstfn mova
@@ -669,7 +673,20 @@ fpel_fn avg,  32, strideq, strideq*2, stride3q, 4, 16
 fpel_fn avg,  64, mmsize,  strideq,   strideq+mmsize, 2, 16
 fpel_fn avg, 128, mmsize,  mmsize*2,  mmsize*3, 1, 16
 %endif
+
+%define d64 64
+%define s64 64
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+fpel_fn put,  64, strideq, strideq*2, stride3q, 4
+fpel_fn put, 128, mmsize,  strideq,   strideq+mmsize, 2
+fpel_fn avg,  64, strideq, strideq*2, stride3q, 4, 8
+fpel_fn avg,  64, strideq, strideq*2, stride3q, 4, 16
+fpel_fn avg, 128, mmsize,  strideq,   strideq+mmsize, 2, 16
+%endif
 %undef s16
 %undef d16
 %undef s32
 %undef d32
+%undef s64
+%undef d64
@@ -101,24 +101,48 @@ static VANCLineNumber vanc_line_numbers[] = {
     {bmdModeUnknown, 0, -1, -1, -1}
 };
 
+/* Room in front of each buffer to find its AVBufferRef again, keeping the
+ * returned pointer aligned. */
+#define ALLOCATOR_HEADER_SIZE 64
+
 class decklink_allocator : public IDeckLinkMemoryAllocator
 {
 public:
-        decklink_allocator(): _refs(1) { }
-        virtual ~decklink_allocator() { }
+        decklink_allocator(): _refs(1), _pool(NULL), _pool_size(0) { pthread_mutex_init(&_mutex, NULL); }
+        virtual ~decklink_allocator()
+        {
+            av_buffer_pool_uninit(&_pool);
+            pthread_mutex_destroy(&_mutex);
+        }
 
         // IDeckLinkMemoryAllocator methods
         virtual HRESULT STDMETHODCALLTYPE AllocateBuffer(unsigned int bufferSize, void* *allocatedBuffer)
         {
-            void *buf = av_malloc(bufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
-            if (!buf)
+            int size = ALLOCATOR_HEADER_SIZE + bufferSize + AV_INPUT_BUFFER_PADDING_SIZE;
+            AVBufferRef *ref;
+
+            // The driver asks for a buffer for every captured frame, always
+            // of the same size for a given mode, so recycle them.
+            pthread_mutex_lock(&_mutex);
+            if (!_pool || _pool_size != size) {
+                // Buffers still in use keep the old pool alive.
+                av_buffer_pool_uninit(&_pool);
+                _pool      = av_buffer_pool_init(size, av_buffer_alloc);
+                _pool_size = size;
+            }
+            ref = _pool ? av_buffer_pool_get(_pool) : NULL;
+            pthread_mutex_unlock(&_mutex);
+            if (!ref)
                 return E_OUTOFMEMORY;
-            *allocatedBuffer = buf;
+
+            *(AVBufferRef **)ref->data = ref;
+            *allocatedBuffer = ref->data + ALLOCATOR_HEADER_SIZE;
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE ReleaseBuffer(void* buffer)
         {
-            av_free(buffer);
+            AVBufferRef *ref = *(AVBufferRef **)((uint8_t *)buffer - ALLOCATOR_HEADER_SIZE);
+            av_buffer_unref(&ref);
             return S_OK;
         }
         virtual HRESULT STDMETHODCALLTYPE Commit() { return S_OK; }
@@ -137,6 +161,9 @@ public:
 
 private:
         std::atomic<int>  _refs;
+        pthread_mutex_t   _mutex;
+        AVBufferPool     *_pool;
+        int               _pool_size;
 };
 
 extern "C" {
@@ -39,6 +39,14 @@
 #include "libavformat/avformat.h"
 #include "libavformat/internal.h"
 
+// Scanout usually flips between two or three framebuffers.
+#define KMSGRAB_MAX_CACHED_FBS 4
+
+typedef struct KMSGrabCachedFB {
+    uint32_t     fb_id;
+    AVBufferRef *desc_ref;
+} KMSGrabCachedFB;
+
 typedef struct KMSGrabContext {
     const AVClass *class;
 
@@ -57,12 +65,18 @@ typedef struct KMSGrabContext {
     int64_t frame_delay;
     int64_t frame_last;
 
+    uint32_t vblank_type;
+    KMSGrabCachedFB cached_fbs[KMSGRAB_MAX_CACHED_FBS];
+    int             next_cached_fb;
+
     const char *device_path;
     enum AVPixelFormat format;
     int64_t drm_format_modifier;
     int64_t source_plane;
     int64_t source_crtc;
     AVRational framerate;
+    int cache_fbs;
+    int vblank;
 } KMSGrabContext;
 
 static void kmsgrab_free_desc(void *opaque, uint8_t *data)
@@ -81,69 +95,42 @@ static void kmsgrab_free_frame(void *opaque, uint8_t *data)
     av_frame_free(&frame);
 }
 
-static int kmsgrab_read_packet(AVFormatContext *avctx, AVPacket *pkt)
+static AVBufferRef *kmsgrab_export_fb(AVFormatContext *avctx, uint32_t fb_id)
 {
     KMSGrabContext *ctx = avctx->priv_data;
-    drmModePlane *plane;
     drmModeFB *fb;
     AVDRMFrameDescriptor *desc;
-    AVFrame *frame;
-    int64_t now;
-    int err, fd;
-
-    now = av_gettime();
-    if (ctx->frame_last) {
-        int64_t delay;
-        while (1) {
-            delay = ctx->frame_last + ctx->frame_delay - now;
-            if (delay <= 0)
-                break;
-            av_usleep(delay);
-            now = av_gettime();
-        }
-    }
-    ctx->frame_last = now;
-
-    plane = drmModeGetPlane(ctx->hwctx->fd, ctx->plane_id);
-    if (!plane) {
-        av_log(avctx, AV_LOG_ERROR, "Failed to get plane "
-               "%"PRIu32".\n", ctx->plane_id);
-        return AVERROR(EIO);
-    }
-    if (!plane->fb_id) {
-        av_log(avctx, AV_LOG_ERROR, "Plane %"PRIu32" no longer has "
-               "an associated framebuffer.\n", ctx->plane_id);
-        return AVERROR(EIO);
-    }
+    AVBufferRef *desc_ref = NULL;
+    struct drm_gem_close close_req = { 0 };
+    int err, fd = -1;
 
-    fb = drmModeGetFB(ctx->hwctx->fd, plane->fb_id);
+    fb = drmModeGetFB(ctx->hwctx->fd, fb_id);
     if (!fb) {
         av_log(avctx, AV_LOG_ERROR, "Failed to get framebuffer "
-               "%"PRIu32".\n", plane->fb_id);
-        return AVERROR(EIO);
+               "%"PRIu32".\n", fb_id);
+        return NULL;
     }
     if (fb->width != ctx->width || fb->height != ctx->height) {
         av_log(avctx, AV_LOG_ERROR, "Plane %"PRIu32" framebuffer "
                "dimensions changed: now %"PRIu32"x%"PRIu32".\n",
                ctx->plane_id, fb->width, fb->height);
-        return AVERROR(EIO);
+        goto end;
     }
     if (!fb->handle) {
         av_log(avctx, AV_LOG_ERROR, "No handle set on framebuffer.\n");
-        return AVERROR(EIO);
+        goto end;
     }
 
     err = drmPrimeHandleToFD(ctx->hwctx->fd, fb->handle, O_RDONLY, &fd);
     if (err < 0) {
-        err = errno;
         av_log(avctx, AV_LOG_ERROR, "Failed to get PRIME fd from "
                "framebuffer handle: %s.\n", strerror(errno));
-        return AVERROR(err);
+        goto end;
     }
 
     desc = av_mallocz(sizeof(*desc));
     if (!desc)
-        return AVERROR(ENOMEM);
+        goto end;
 
     *desc = (AVDRMFrameDescriptor) {
         .nb_objects = 1,
@@ -164,31 +151,151 @@ static int kmsgrab_read_packet(AVFormatContext *avctx, AVPacket *pkt)
         },
     };
 
+    desc_ref = av_buffer_create((uint8_t*)desc, sizeof(*desc),
+                                &kmsgrab_free_desc, avctx, 0);
+    if (!desc_ref) {
+        av_free(desc);
+        goto end;
+    }
+    fd = -1;
+
+end:
+    if (fd >= 0)
+        close(fd);
+    if (fb->handle) {
+        // drmModeGetFB() gives us a new GEM handle every time, which
+        // has to be closed again once the PRIME fd has been made.
+        close_req.handle = fb->handle;
+        drmIoctl(ctx->hwctx->fd, DRM_IOCTL_GEM_CLOSE, &close_req);
+    }
+    drmModeFreeFB(fb);
+    return desc_ref;
+}
+
+static AVBufferRef *kmsgrab_get_fb(AVFormatContext *avctx, uint32_t fb_id)
+{
+    KMSGrabContext *ctx = avctx->priv_data;
+    KMSGrabCachedFB *cached;
+    AVBufferRef *desc_ref;
+    int i;
+
+    if (!ctx->cache_fbs)
+        return kmsgrab_export_fb(avctx, fb_id);
+
+    for (i = 0; i < KMSGRAB_MAX_CACHED_FBS; i++) {
+        cached = &ctx->cached_fbs[i];
+        if (cached->desc_ref && cached->fb_id == fb_id)
+            return av_buffer_ref(cached->desc_ref);
+    }
+
+    desc_ref = kmsgrab_export_fb(avctx, fb_id);
+    if (!desc_ref)
+        return NULL;
+
+    cached = &ctx->cached_fbs[ctx->next_cached_fb];
+    ctx->next_cached_fb = (ctx->next_cached_fb + 1) % KMSGRAB_MAX_CACHED_FBS;
+
+    av_buffer_unref(&cached->desc_ref);
+    cached->desc_ref = av_buffer_ref(desc_ref);
+    cached->fb_id    = fb_id;
+
+    return desc_ref;
+}
+
+static int kmsgrab_wait_vblank(AVFormatContext *avctx)
+{
+    KMSGrabContext *ctx = avctx->priv_data;
+    drmVBlank vbl = {
+        .request = {
+            .type     = DRM_VBLANK_RELATIVE | ctx->vblank_type,
+            .sequence = 1,
+        },
+    };
+    int err;
+
+    err = drmWaitVBlank(ctx->hwctx->fd, &vbl);
+    if (err < 0) {
+        err = errno;
+        av_log(avctx, AV_LOG_ERROR, "Failed to wait for vblank: %s.\n",
+               strerror(err));
+        return AVERROR(err);
+    }
+    return 0;
+}
+
+static int kmsgrab_read_packet(AVFormatContext *avctx, AVPacket *pkt)
+{
+    KMSGrabContext *ctx = avctx->priv_data;
+    drmModePlane *plane;
+    AVFrame *frame;
+    int64_t now;
+    uint32_t fb_id;
+    int err;
+
+    now = av_gettime();
+    if (ctx->vblank) {
+        // Sample just after a page flip, skipping vblanks as needed to
+        // keep to the requested framerate.
+        do {
+            err = kmsgrab_wait_vblank(avctx);
+            if (err < 0)
+                return err;
+            now = av_gettime();
+        } while (ctx->frame_last &&
+                 now - ctx->frame_last < ctx->frame_delay - ctx->frame_delay / 4);
+    } else if (ctx->frame_last) {
+        int64_t delay;
+        while (1) {
+            delay = ctx->frame_last + ctx->frame_delay - now;
+            if (delay <= 0)
+                break;
+            av_usleep(delay);
+            now = av_gettime();
+        }
+    }
+    ctx->frame_last = now;
+
+    plane = drmModeGetPlane(ctx->hwctx->fd, ctx->plane_id);
+    if (!plane) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to get plane "
+               "%"PRIu32".\n", ctx->plane_id);
+        return AVERROR(EIO);
+    }
+    fb_id = plane->fb_id;
+    drmModeFreePlane(plane);
+    if (!fb_id) {
+        av_log(avctx, AV_LOG_ERROR, "Plane %"PRIu32" no longer has "
+               "an associated framebuffer.\n", ctx->plane_id);
+        return AVERROR(EIO);
+    }
+
     frame = av_frame_alloc();
     if (!frame)
         return AVERROR(ENOMEM);
 
-    frame->hw_frames_ctx = av_buffer_ref(ctx->frames_ref);
-    if (!frame->hw_frames_ctx)
-        return AVERROR(ENOMEM);
+    frame->buf[0] = kmsgrab_get_fb(avctx, fb_id);
+    if (!frame->buf[0]) {
+        av_frame_free(&frame);
+        return AVERROR(EIO);
+    }
 
-    frame->buf[0] = av_buffer_create((uint8_t*)desc, sizeof(*desc),
-                                     &kmsgrab_free_desc, avctx, 0);
-    if (!frame->buf[0])
+    frame->hw_frames_ctx = av_buffer_ref(ctx->frames_ref);
+    if (!frame->hw_frames_ctx) {
+        av_frame_free(&frame);
         return AVERROR(ENOMEM);
+    }
 
-    frame->data[0] = (uint8_t*)desc;
+    frame->data[0] = frame->buf[0]->data;
     frame->format  = AV_PIX_FMT_DRM_PRIME;
-    frame->width   = fb->width;
-    frame->height  = fb->height;
-
-    drmModeFreeFB(fb);
-    drmModeFreePlane(plane);
+    frame->width   = ctx->width;
+    frame->height  = ctx->height;
 
     pkt->buf = av_buffer_create((uint8_t*)frame, sizeof(*frame),
                                 &kmsgrab_free_frame, avctx, 0);
-    if (!pkt->buf)
+    if (!pkt->buf) {
+        av_frame_free(&frame);
         return AVERROR(ENOMEM);
+    }
 
     pkt->data   = (uint8_t*)frame;
     pkt->size   = sizeof(*frame);
@@ -233,6 +340,41 @@ static const struct {
     { AV_PIX_FMT_UYVY422,  DRM_FORMAT_UYVY     },
 };
 
+static av_cold int kmsgrab_init_vblank(AVFormatContext *avctx,
+                                       uint32_t crtc_id)
+{
+    KMSGrabContext *ctx = avctx->priv_data;
+    drmModeRes *res;
+    int i;
+
+    res = drmModeGetResources(ctx->hwctx->fd);
+    if (!res) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to get DRM resources: "
+               "%s.\n", strerror(errno));
+        return AVERROR(EIO);
+    }
+    for (i = 0; i < res->count_crtcs; i++) {
+        if (res->crtcs[i] == crtc_id)
+            break;
+    }
+    if (i == res->count_crtcs) {
+        av_log(avctx, AV_LOG_ERROR, "CRTC %"PRIu32" of the capture "
+               "plane not found.\n", crtc_id);
+        drmModeFreeResources(res);
+        return AVERROR(EINVAL);
+    }
+    drmModeFreeResources(res);
+
+    // The vblank ioctl addresses CRTCs by index rather than by ID.
+    if (i > 1)
+        ctx->vblank_type = (i << DRM_VBLANK_HIGH_CRTC_SHIFT) &
+                           DRM_VBLANK_HIGH_CRTC_MASK;
+    else if (i == 1)
+        ctx->vblank_type = DRM_VBLANK_SECONDARY;
+
+    return 0;
+}
+
 static av_cold int kmsgrab_read_header(AVFormatContext *avctx)
 {
     KMSGrabContext *ctx = avctx->priv_data;
@@ -400,6 +542,12 @@ static av_cold int kmsgrab_read_header(AVFormatContext *avctx)
     ctx->frame_delay = av_rescale_q(1, (AVRational) { ctx->framerate.den,
                 ctx->framerate.num }, AV_TIME_BASE_Q);
 
+    if (ctx->vblank) {
+        err = kmsgrab_init_vblank(avctx, plane->crtc_id);
+        if (err < 0)
+            goto fail;
+    }
+
     err = 0;
 fail:
     if (plane_res)
@@ -415,6 +563,10 @@ fail:
 static av_cold int kmsgrab_read_close(AVFormatContext *avctx)
 {
     KMSGrabContext *ctx = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < KMSGRAB_MAX_CACHED_FBS; i++)
+        av_buffer_unref(&ctx->cached_fbs[i].desc_ref);
 
     av_buffer_unref(&ctx->frames_ref);
     av_buffer_unref(&ctx->device_ref);
@@ -443,6 +595,12 @@ static const AVOption options[] = {
     { "framerate", "Framerate to capture at",
       OFFSET(framerate), AV_OPT_TYPE_RATIONAL,
       { .dbl = 30.0 }, 0, 1000, FLAGS },
+    { "cache_fbs", "Keep framebuffers exported across frames",
+      OFFSET(cache_fbs), AV_OPT_TYPE_BOOL,
+      { .i64 = 1 }, 0, 1, FLAGS },
+    { "vblank", "Synchronise sampling to the vblank of the CRTC",
+      OFFSET(vblank), AV_OPT_TYPE_BOOL,
+      { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -39,7 +39,12 @@
 #include <libv4l2.h>
 #endif
 
-static const int desired_video_buffers = 256;
+#if CONFIG_LIBDRM
+#include <drm_fourcc.h>
+
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_drm.h"
+#endif
 
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
@@ -80,6 +85,7 @@ struct video_data {
     int64_t last_time_m;
 
     int buffers;
+    int desired_buffers; /**< Set by a private option. */
     atomic_int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
@@ -103,6 +109,14 @@ struct video_data {
     ssize_t (*read_f)(int fd, void *buffer, size_t n);
     void *(*mmap_f)(void *start, size_t length, int prot, int flags, int fd, int64_t offset);
     int (*munmap_f)(void *_start, size_t length);
+
+#if CONFIG_LIBDRM
+    int export_dmabuf;  /**< Set by a private option. */
+    char *drm_device;   /**< Set by a private option. */
+    AVBufferRef *device_ref;
+    AVBufferRef *frames_ref;
+    AVDRMFrameDescriptor *drm_desc;
+#endif
 };
 
 struct buff_data {
@@ -340,7 +354,7 @@ static int mmap_init(AVFormatContext *ctx)
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
         .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .count  = desired_video_buffers,
+        .count  = s->desired_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
 
@@ -428,6 +442,204 @@ static void mmap_release_buffer(void *opaque, uint8_t *data)
     enqueue_buffer(s, &buf);
 }
 
+#if CONFIG_LIBDRM
+static const struct {
+    enum AVPixelFormat pix_fmt;
+    uint32_t drm_format;
+} drm_formats[] = {
+    { AV_PIX_FMT_YUV420P, DRM_FORMAT_YUV420 },
+    { AV_PIX_FMT_YUV422P, DRM_FORMAT_YUV422 },
+    { AV_PIX_FMT_NV12,    DRM_FORMAT_NV12   },
+    { AV_PIX_FMT_NV16,    DRM_FORMAT_NV16   },
+    { AV_PIX_FMT_YUYV422, DRM_FORMAT_YUYV   },
+    { AV_PIX_FMT_UYVY422, DRM_FORMAT_UYVY   },
+    { AV_PIX_FMT_BGR0,    DRM_FORMAT_XRGB8888 },
+    { AV_PIX_FMT_RGB0,    DRM_FORMAT_XBGR8888 },
+};
+
+static void dmabuf_release_frame(void *opaque, uint8_t *data)
+{
+    AVFrame *frame = (AVFrame*)data;
+
+    av_frame_free(&frame);
+}
+
+/**
+ * Export every capture buffer as a DMABUF with VIDIOC_EXPBUF and describe
+ * it as a DRM PRIME frame. The buffers are packed in the same way as for
+ * mmap capture, so all the planes of a frame live in one object.
+ */
+static int dmabuf_init(AVFormatContext *ctx, enum AVPixelFormat pix_fmt)
+{
+    struct video_data *s = ctx->priv_data;
+    AVHWFramesContext *frames;
+    const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(pix_fmt);
+    uint32_t drm_format = 0;
+    uint8_t *data[4];
+    int linesize[4];
+    int i, p, res;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(drm_formats); i++) {
+        if (drm_formats[i].pix_fmt == pix_fmt) {
+            drm_format = drm_formats[i].drm_format;
+            break;
+        }
+    }
+    if (!drm_format) {
+        av_log(ctx, AV_LOG_ERROR, "Pixel format %s cannot be exported "
+               "as DRM PRIME frames.\n", av_get_pix_fmt_name(pix_fmt));
+        return AVERROR(EINVAL);
+    }
+
+    /* Same packed layout as frame_size assumes. */
+    res = av_image_fill_linesizes(linesize, pix_fmt, s->width);
+    if (res < 0)
+        return res;
+    res = av_image_fill_pointers(data, pix_fmt, s->height, NULL, linesize);
+    if (res < 0)
+        return res;
+
+    s->drm_desc = av_mallocz_array(s->buffers, sizeof(*s->drm_desc));
+    if (!s->drm_desc)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->buffers; i++)
+        s->drm_desc[i].objects[0].fd = -1;
+
+    for (i = 0; i < s->buffers; i++) {
+        AVDRMFrameDescriptor *desc = &s->drm_desc[i];
+        AVDRMLayerDescriptor *layer = &desc->layers[0];
+        struct v4l2_exportbuffer expbuf = {
+            .type  = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .index = i,
+            .flags = O_RDONLY | O_CLOEXEC,
+        };
+
+        if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+            res = AVERROR(errno);
+            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n",
+                   av_err2str(res));
+            return res;
+        }
+
+        desc->nb_objects = 1;
+        desc->objects[0].fd              = expbuf.fd;
+        desc->objects[0].size            = s->buf_len[i];
+        desc->objects[0].format_modifier = DRM_FORMAT_MOD_LINEAR;
+
+        desc->nb_layers  = 1;
+        layer->format    = drm_format;
+        layer->nb_planes = av_pix_fmt_count_planes(pix_fmt);
+        for (p = 0; p < layer->nb_planes; p++) {
+            layer->planes[p].object_index = 0;
+            layer->planes[p].offset       = data[p] - data[0];
+            layer->planes[p].pitch        = linesize[p];
+        }
+    }
+
+    res = av_hwdevice_ctx_create(&s->device_ref, AV_HWDEVICE_TYPE_DRM,
+                                 s->drm_device, NULL, 0);
+    if (res < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to open DRM device.\n");
+        return res;
+    }
+
+    s->frames_ref = av_hwframe_ctx_alloc(s->device_ref);
+    if (!s->frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext*)s->frames_ref->data;
+
+    frames->format    = AV_PIX_FMT_DRM_PRIME;
+    frames->sw_format = pix_fmt;
+    frames->width     = s->width;
+    frames->height    = s->height;
+
+    res = av_hwframe_ctx_init(s->frames_ref);
+    if (res < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to initialise hardware frames "
+               "context: %s.\n", av_err2str(res));
+        return res;
+    }
+
+    av_log(ctx, AV_LOG_VERBOSE, "Exporting %d %s buffers as DMABUFs.\n",
+           s->buffers, pix_desc->name);
+    return 0;
+}
+
+static void dmabuf_close(struct video_data *s)
+{
+    int i;
+
+    if (s->drm_desc) {
+        for (i = 0; i < s->buffers; i++) {
+            if (s->drm_desc[i].objects[0].fd >= 0)
+                close(s->drm_desc[i].objects[0].fd);
+        }
+    }
+    av_freep(&s->drm_desc);
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+}
+
+/**
+ * Wrap the dequeued buffer into a DRM PRIME AVFrame. The buffer is only
+ * queued to the driver again once the frame and everything mapped from
+ * it have been released. On failure, the buffer is left to the caller.
+ */
+static int dmabuf_wrap_frame(AVFormatContext *ctx, AVPacket *pkt,
+                             struct v4l2_buffer *buf)
+{
+    struct video_data *s = ctx->priv_data;
+    struct buff_data *buf_descriptor;
+    AVFrame *frame;
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    frame->hw_frames_ctx = av_buffer_ref(s->frames_ref);
+    if (!frame->hw_frames_ctx) {
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+
+    pkt->buf = av_buffer_create((uint8_t*)frame, sizeof(*frame),
+                                dmabuf_release_frame, NULL, 0);
+    if (!pkt->buf) {
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+
+    buf_descriptor = av_malloc(sizeof(*buf_descriptor));
+    if (!buf_descriptor) {
+        av_buffer_unref(&pkt->buf);
+        return AVERROR(ENOMEM);
+    }
+    buf_descriptor->index = buf->index;
+    buf_descriptor->s     = s;
+
+    frame->buf[0] = av_buffer_create((uint8_t*)&s->drm_desc[buf->index],
+                                     sizeof(*s->drm_desc),
+                                     mmap_release_buffer, buf_descriptor,
+                                     AV_BUFFER_FLAG_READONLY);
+    if (!frame->buf[0]) {
+        av_free(buf_descriptor);
+        av_buffer_unref(&pkt->buf);
+        return AVERROR(ENOMEM);
+    }
+
+    frame->data[0] = frame->buf[0]->data;
+    frame->format  = AV_PIX_FMT_DRM_PRIME;
+    frame->width   = s->width;
+    frame->height  = s->height;
+
+    pkt->data   = (uint8_t*)frame;
+    pkt->size   = sizeof(*frame);
+    pkt->flags |= AV_PKT_FLAG_TRUSTED;
+
+    return 0;
+}
+#endif
+
 #if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
 static int64_t av_gettime_monotonic(void)
 {
@@ -545,6 +757,25 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
         }
     }
 
+#if CONFIG_LIBDRM
+    if (s->drm_desc) {
+        if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+            /* A DMABUF cannot be copied out here, so drop the frame
+             * rather than starve the driver of buffers. */
+            av_log(ctx, AV_LOG_WARNING, "Too few buffers queued, "
+                   "dropping a frame.\n");
+            res = enqueue_buffer(s, &buf);
+            return res < 0 ? res : AVERROR(EAGAIN);
+        }
+
+        res = dmabuf_wrap_frame(ctx, pkt, &buf);
+        if (res < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to wrap a DMABUF frame.\n");
+            enqueue_buffer(s, &buf);
+            return res;
+        }
+    } else
+#endif
     /* Image is at s->buff_start[buf.index] */
     if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
         /* when we start getting low on queued buffers, fall back on copying data */
@@ -949,9 +1180,24 @@ static int v4l2_read_header(AVFormatContext *ctx)
         s->frame_size = av_image_get_buffer_size(st->codecpar->format,
                                                  s->width, s->height, 1);
 
-    if ((res = mmap_init(ctx)) ||
-        (res = mmap_start(ctx)) < 0)
+    if ((res = mmap_init(ctx)) < 0)
+        goto fail;
+
+#if CONFIG_LIBDRM
+    if (s->export_dmabuf) {
+        if (codec_id != AV_CODEC_ID_RAWVIDEO) {
+            av_log(ctx, AV_LOG_ERROR, "DMABUF export is only supported "
+                   "for raw video.\n");
+            res = AVERROR(EINVAL);
+            goto fail;
+        }
+        if ((res = dmabuf_init(ctx, st->codecpar->format)) < 0)
             goto fail;
+    }
+#endif
+
+    if ((res = mmap_start(ctx)) < 0)
+        goto fail;
 
     s->top_field_first = first_field(s);
 
@@ -972,9 +1218,20 @@ static int v4l2_read_header(AVFormatContext *ctx)
     if (st->avg_frame_rate.den)
         st->codecpar->bit_rate = s->frame_size * av_q2d(st->avg_frame_rate) * 8;
 
+#if CONFIG_LIBDRM
+    if (s->drm_desc) {
+        st->codecpar->codec_id  = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->codec_tag = 0;
+        st->codecpar->format    = AV_PIX_FMT_DRM_PRIME;
+    }
+#endif
+
     return 0;
 
 fail:
+#if CONFIG_LIBDRM
+    dmabuf_close(s);
+#endif
     v4l2_close(s->fd);
     return res;
 }
@@ -1014,6 +1271,9 @@ static int v4l2_read_close(AVFormatContext *ctx)
                "close.\n");
 
     mmap_close(s);
+#if CONFIG_LIBDRM
+    dmabuf_close(s);
+#endif
 
     v4l2_close(s->fd);
     return 0;
@@ -1121,6 +1381,11 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "buffers",      "set the number of capture buffers to request",             OFFSET(desired_buffers), AV_OPT_TYPE_INT, {.i64 = 256}, 2, INT_MAX, DEC },
+#if CONFIG_LIBDRM
+    { "export_dmabuf", "output DRM PRIME frames exported from the capture buffers", OFFSET(export_dmabuf), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "drm_device",   "DRM device for the exported frames",                       OFFSET(drm_device),   AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0,      DEC },
+#endif
     { NULL },
 };
 
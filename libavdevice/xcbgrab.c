@@ -37,6 +37,11 @@
 #include <xcb/shape.h>
 #endif
 
+#define XCBGRAB_DAMAGE (CONFIG_LIBXCB_DAMAGE && CONFIG_LIBXCB_XFIXES)
+#if XCBGRAB_DAMAGE
+#include <xcb/damage.h>
+#endif
+
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
@@ -54,6 +59,14 @@ typedef struct XCBGrabContext {
     xcb_window_t window;
 #if CONFIG_LIBXCB_SHM
     AVBufferPool *shm_pool;
+#endif
+#if XCBGRAB_DAMAGE
+    xcb_damage_damage_t damage;
+    xcb_xfixes_region_t damage_region;
+    /* last grabbed frame, only the damaged parts are updated */
+    AVBufferRef *damage_frame;
+    int damage_x, damage_y;
+    int pointer_x, pointer_y;
 #endif
     int64_t time_frame;
     AVRational time_base;
@@ -69,6 +82,9 @@ typedef struct XCBGrabContext {
     int show_region;
     int region_border;
     int centered;
+    int use_damage;
+    int damage_skip;
+    AVRational damage_qoffset;
 
     const char *framerate;
 
@@ -77,6 +93,9 @@ typedef struct XCBGrabContext {
 
 #define FOLLOW_CENTER -1
 
+/* above this many damaged rectangles their bounding box is grabbed instead */
+#define MAX_DAMAGE_RECTS 16
+
 #define OFFSET(x) offsetof(XCBGrabContext, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
 static const AVOption options[] = {
@@ -92,6 +111,9 @@ static const AVOption options[] = {
     { "centered", "Keep the mouse pointer at the center of grabbing region when following.", 0, AV_OPT_TYPE_CONST, { .i64 = -1 }, INT_MIN, INT_MAX, D, "follow_mouse" },
     { "show_region", "Show the grabbing region.", OFFSET(show_region), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D },
     { "region_border", "Set the region border thickness.", OFFSET(region_border), AV_OPT_TYPE_INT, { .i64 = 3 }, 1, 128, D },
+    { "damage", "Only grab the parts of the screen reported as changed by XDamage.", OFFSET(use_damage), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "damage_skip", "Do not output frames in which nothing changed.", OFFSET(damage_skip), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "damage_qoffset", "Export the changed areas as regions of interest with this quantisation offset.", OFFSET(damage_qoffset), AV_OPT_TYPE_RATIONAL, { .dbl = 0 }, -1, 1, D },
     { NULL },
 };
 
@@ -397,6 +419,239 @@ static void xcbgrab_draw_mouse(AVFormatContext *s, AVPacket *pkt,
 }
 #endif /* CONFIG_LIBXCB_XFIXES */
 
+#if XCBGRAB_DAMAGE
+static int check_damage(xcb_connection_t *conn)
+{
+    xcb_damage_query_version_cookie_t cookie;
+    xcb_damage_query_version_reply_t *reply;
+
+    /* the damage region is an XFixes region */
+    if (!check_xfixes(conn))
+        return 0;
+
+    cookie = xcb_damage_query_version(conn, XCB_DAMAGE_MAJOR_VERSION,
+                                      XCB_DAMAGE_MINOR_VERSION);
+    reply  = xcb_damage_query_version_reply(conn, cookie, NULL);
+
+    if (reply) {
+        free(reply);
+        return 1;
+    }
+    return 0;
+}
+
+static void copy_lines(uint8_t *dst, int dst_linesize,
+                       const uint8_t *src, int src_linesize,
+                       int bytes, int h)
+{
+    for (; h > 0; h--) {
+        memcpy(dst, src, bytes);
+        dst += dst_linesize;
+        src += src_linesize;
+    }
+}
+
+/* Copy the w x h screen area at x, y to dst. */
+static int xcbgrab_copy_rect(AVFormatContext *s, int x, int y, int w, int h,
+                             uint8_t *dst, int linesize)
+{
+    XCBGrabContext *c = s->priv_data;
+    xcb_drawable_t drawable = c->screen->root;
+    xcb_generic_error_t *e = NULL;
+    xcb_get_image_cookie_t iq;
+    xcb_get_image_reply_t *img;
+
+#if CONFIG_LIBXCB_SHM
+    if (c->has_shm) {
+        xcb_shm_get_image_cookie_t siq;
+        xcb_shm_get_image_reply_t *simg;
+        AVBufferRef *buf = av_buffer_pool_get(c->shm_pool);
+
+        if (buf) {
+            siq  = xcb_shm_get_image(c->conn, drawable, x, y, w, h, ~0,
+                                     XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                     (xcb_shm_seg_t)av_buffer_pool_buffer_get_opaque(buf), 0);
+            simg = xcb_shm_get_image_reply(c->conn, siq, &e);
+            if (simg) {
+                copy_lines(dst, linesize, buf->data, simg->size / h,
+                           w * c->bpp / 8, h);
+                free(simg);
+            }
+            av_buffer_unref(&buf);
+            if (!e && simg)
+                return 0;
+            free(e);
+            e = NULL;
+        }
+        av_log(s, AV_LOG_WARNING, "Continuing without shared memory.\n");
+        c->has_shm = 0;
+    }
+#endif
+
+    iq  = xcb_get_image(c->conn, XCB_IMAGE_FORMAT_Z_PIXMAP, drawable,
+                        x, y, w, h, ~0);
+    img = xcb_get_image_reply(c->conn, iq, &e);
+
+    if (e) {
+        av_log(s, AV_LOG_ERROR,
+               "Cannot get the image data "
+               "event_error: response_type:%u error_code:%u "
+               "sequence:%u resource_id:%u minor_code:%u major_code:%u.\n",
+               e->response_type, e->error_code,
+               e->sequence, e->resource_id, e->minor_code, e->major_code);
+        free(e);
+        return AVERROR(EACCES);
+    }
+
+    if (!img)
+        return AVERROR(EAGAIN);
+
+    copy_lines(dst, linesize, xcb_get_image_data(img),
+               xcb_get_image_data_length(img) / h, w * c->bpp / 8, h);
+    free(img);
+
+    return 0;
+}
+
+/*
+ * Update the persistent frame with the areas damaged since the last call
+ * and return a reference to it. Frames without any change are repeats of
+ * the same buffer, or are skipped with damage_skip.
+ */
+static int xcbgrab_frame_damage(AVFormatContext *s, AVPacket *pkt,
+                                xcb_query_pointer_reply_t *p)
+{
+    XCBGrabContext *c = s->priv_data;
+    xcb_xfixes_fetch_region_cookie_t rc;
+    xcb_xfixes_fetch_region_reply_t *reg;
+    xcb_generic_event_t *ev;
+    xcb_rectangle_t full = { c->x, c->y, c->width, c->height };
+    xcb_rectangle_t *rects;
+    AVRegionOfInterest *roi = NULL;
+    int linesize = c->width * c->bpp / 8;
+    int nb_rects, nb_roi = 0, changed = 0;
+    int i, ret = 0;
+
+    /* The notify events only signal that the damage is no longer empty,
+     * the damaged area itself is fetched as a region. */
+    while ((ev = xcb_poll_for_event(c->conn)))
+        free(ev);
+
+    xcb_damage_subtract(c->conn, c->damage, XCB_NONE, c->damage_region);
+    rc  = xcb_xfixes_fetch_region(c->conn, c->damage_region);
+    reg = xcb_xfixes_fetch_region_reply(c->conn, rc, NULL);
+    if (!reg)
+        return AVERROR_EXTERNAL;
+
+    rects    = xcb_xfixes_fetch_region_rectangles(reg);
+    nb_rects = xcb_xfixes_fetch_region_rectangles_length(reg);
+    if (nb_rects > MAX_DAMAGE_RECTS) {
+        rects    = &reg->extents;
+        nb_rects = 1;
+    }
+    if (!c->damage_frame || c->damage_x != c->x || c->damage_y != c->y) {
+        rects    = &full;
+        nb_rects = 1;
+    }
+
+    if (!c->damage_frame) {
+        c->damage_frame = av_buffer_allocz(c->frame_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!c->damage_frame) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    if (c->damage_qoffset.num && nb_rects) {
+        roi = av_malloc_array(nb_rects, sizeof(*roi));
+        if (!roi) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    for (i = 0; i < nb_rects; i++) {
+        int x0 = FFMAX(rects[i].x, c->x);
+        int y0 = FFMAX(rects[i].y, c->y);
+        int x1 = FFMIN(rects[i].x + rects[i].width,  c->x + c->width);
+        int y1 = FFMIN(rects[i].y + rects[i].height, c->y + c->height);
+
+        if (x0 >= x1 || y0 >= y1)
+            continue;
+
+        /* downstream may still hold the previous frame */
+        if (!changed && (ret = av_buffer_make_writable(&c->damage_frame)) < 0)
+            goto end;
+        changed = 1;
+
+        ret = xcbgrab_copy_rect(s, x0, y0, x1 - x0, y1 - y0,
+                                c->damage_frame->data + (y0 - c->y) * linesize +
+                                (x0 - c->x) * c->bpp / 8, linesize);
+        if (ret < 0) {
+            /* the frame is incomplete, start over on the next one */
+            av_buffer_unref(&c->damage_frame);
+            goto end;
+        }
+
+        if (roi) {
+            roi[nb_roi++] = (AVRegionOfInterest) {
+                .self_size = sizeof(*roi),
+                .top       = y0 - c->y,
+                .bottom    = y1 - c->y,
+                .left      = x0 - c->x,
+                .right     = x1 - c->x,
+                .qoffset   = c->damage_qoffset,
+            };
+        }
+    }
+    c->damage_x = c->x;
+    c->damage_y = c->y;
+
+    if (c->draw_mouse && p && (p->root_x != c->pointer_x || p->root_y != c->pointer_y)) {
+        c->pointer_x = p->root_x;
+        c->pointer_y = p->root_y;
+        changed = 1;
+    }
+
+    if (!changed && c->damage_skip) {
+        ret = AVERROR(EAGAIN);
+        goto end;
+    }
+
+    av_init_packet(pkt);
+
+    if (c->draw_mouse) {
+        /* the pointer is drawn into the packet, not into the kept frame */
+        if ((ret = av_new_packet(pkt, c->frame_size)) < 0)
+            goto end;
+        memcpy(pkt->data, c->damage_frame->data, c->frame_size);
+    } else {
+        pkt->buf = av_buffer_ref(c->damage_frame);
+        if (!pkt->buf) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        pkt->data = pkt->buf->data;
+        pkt->size = c->frame_size;
+    }
+
+    if (nb_roi) {
+        ret = av_packet_add_side_data(pkt, AV_PKT_DATA_REGIONS_OF_INTEREST,
+                                      (uint8_t *)roi, nb_roi * sizeof(*roi));
+        if (ret < 0) {
+            av_packet_unref(pkt);
+            goto end;
+        }
+        roi = NULL;
+    }
+
+end:
+    av_free(roi);
+    free(reg);
+    return ret;
+}
+#endif /* XCBGRAB_DAMAGE */
+
 static void xcbgrab_update_region(AVFormatContext *s)
 {
     XCBGrabContext *c     = s->priv_data;
@@ -434,14 +689,20 @@ static int xcbgrab_read_packet(AVFormatContext *s, AVPacket *pkt)
     if (c->show_region)
         xcbgrab_update_region(s);
 
+    if (c->use_damage) {
+#if XCBGRAB_DAMAGE
+        ret = xcbgrab_frame_damage(s, pkt, p);
+#endif
+    } else {
 #if CONFIG_LIBXCB_SHM
-    if (c->has_shm && xcbgrab_frame_shm(s, pkt) < 0) {
-        av_log(s, AV_LOG_WARNING, "Continuing without shared memory.\n");
-        c->has_shm = 0;
-    }
+        if (c->has_shm && xcbgrab_frame_shm(s, pkt) < 0) {
+            av_log(s, AV_LOG_WARNING, "Continuing without shared memory.\n");
+            c->has_shm = 0;
+        }
 #endif
-    if (!c->has_shm)
-        ret = xcbgrab_frame(s, pkt);
+        if (!c->has_shm)
+            ret = xcbgrab_frame(s, pkt);
+    }
     pkt->dts = pkt->pts = pts;
     pkt->duration = c->frame_duration;
 
@@ -463,6 +724,13 @@ static av_cold int xcbgrab_read_close(AVFormatContext *s)
 #if CONFIG_LIBXCB_SHM
     av_buffer_pool_uninit(&ctx->shm_pool);
 #endif
+#if XCBGRAB_DAMAGE
+    if (ctx->damage) {
+        xcb_damage_destroy(ctx->conn, ctx->damage);
+        xcb_xfixes_destroy_region(ctx->conn, ctx->damage_region);
+    }
+    av_buffer_unref(&ctx->damage_frame);
+#endif
 
     xcb_disconnect(ctx->conn);
 
@@ -717,6 +985,23 @@ static av_cold int xcbgrab_read_header(AVFormatContext *s)
     }
 #endif
 
+    if (c->use_damage) {
+#if XCBGRAB_DAMAGE
+        if ((c->use_damage = check_damage(c->conn))) {
+            c->damage_region = xcb_generate_id(c->conn);
+            xcb_xfixes_create_region(c->conn, c->damage_region, 0, NULL);
+            c->damage = xcb_generate_id(c->conn);
+            xcb_damage_create(c->conn, c->damage, c->screen->root,
+                              XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+        }
+#else
+        c->use_damage = 0;
+#endif
+        if (!c->use_damage)
+            av_log(s, AV_LOG_WARNING,
+                   "XDamage not available, grabbing full frames.\n");
+    }
+
     if (c->show_region)
         setup_window(s);
 
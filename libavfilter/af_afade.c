@@ -23,12 +23,15 @@
  * fade audio filter
  */
 
+#include "libavutil/float_dsp.h"
 #include "libavutil/opt.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "internal.h"
 
+#define FADE_CHUNK 1024
+
 typedef struct AudioFadeContext {
     const AVClass *class;
     int type;
@@ -42,7 +45,12 @@ typedef struct AudioFadeContext {
     int crossfade_is_over;
     int64_t pts;
 
-    void (*fade_samples)(uint8_t **dst, uint8_t * const *src,
+    AVFloatDSPContext *fdsp;
+    /* gains of FADE_CHUNK samples, repeated for each channel of packed formats */
+    void *gain;
+
+    void (*fade_samples)(struct AudioFadeContext *s,
+                         uint8_t **dst, uint8_t * const *src,
                          int nb_samples, int channels, int direction,
                          int64_t start, int64_t range, int curve);
     void (*crossfade_samples)(uint8_t **dst, uint8_t * const *cf0,
@@ -162,7 +170,8 @@ static double fade_gain(int curve, int64_t index, int64_t range)
 }
 
 #define FADE_PLANAR(name, type)                                             \
-static void fade_samples_## name ##p(uint8_t **dst, uint8_t * const *src,   \
+static void fade_samples_## name ##p(AudioFadeContext *ctx,                 \
+                                     uint8_t **dst, uint8_t * const *src,   \
                                      int nb_samples, int channels, int dir, \
                                      int64_t start, int64_t range, int curve) \
 {                                                                           \
@@ -180,7 +189,8 @@ static void fade_samples_## name ##p(uint8_t **dst, uint8_t * const *src,   \
 }
 
 #define FADE(name, type)                                                    \
-static void fade_samples_## name (uint8_t **dst, uint8_t * const *src,      \
+static void fade_samples_## name (AudioFadeContext *ctx,                    \
+                                  uint8_t **dst, uint8_t * const *src,      \
                                   int nb_samples, int channels, int dir,    \
                                   int64_t start, int64_t range, int curve)  \
 {                                                                           \
@@ -195,16 +205,51 @@ static void fade_samples_## name (uint8_t **dst, uint8_t * const *src,      \
     }                                                                       \
 }
 
-FADE_PLANAR(dbl, double)
-FADE_PLANAR(flt, float)
 FADE_PLANAR(s16, int16_t)
 FADE_PLANAR(s32, int32_t)
 
-FADE(dbl, double)
-FADE(flt, float)
 FADE(s16, int16_t)
 FADE(s32, int32_t)
 
+/* For floating point samples, the gains of a chunk of samples are computed
+ * once and applied to each plane with a single vector multiplication. */
+#define FADE_VECTOR(name, type, vector_mul, planar)                         \
+static void fade_samples_## name (AudioFadeContext *ctx,                    \
+                                  uint8_t **dst, uint8_t * const *src,      \
+                                  int nb_samples, int channels, int dir,    \
+                                  int64_t start, int64_t range, int curve)  \
+{                                                                           \
+    const int nb_rep    = planar ? 1 : channels;                            \
+    const int nb_planes = planar ? channels : 1;                            \
+    type *gain = ctx->gain;                                                 \
+    int i, j, c, r, k;                                                      \
+                                                                            \
+    for (i = 0; i < nb_samples; i += FADE_CHUNK) {                          \
+        const int len = FFMIN(FADE_CHUNK, nb_samples - i) * nb_rep;         \
+        const int len_simd = len & ~15;                                     \
+                                                                            \
+        for (j = 0, k = 0; k < len; j++) {                                  \
+            type g = fade_gain(curve, start + (i + j) * dir, range);        \
+            for (r = 0; r < nb_rep; r++, k++)                               \
+                gain[k] = g;                                                \
+        }                                                                   \
+                                                                            \
+        for (c = 0; c < nb_planes; c++) {                                   \
+            type *d = (type *)dst[c] + i * nb_rep;                          \
+            const type *s = (const type *)src[c] + i * nb_rep;              \
+                                                                            \
+            ctx->fdsp->vector_mul(d, s, gain, len_simd);                    \
+            for (k = len_simd; k < len; k++)                                \
+                d[k] = s[k] * gain[k];                                      \
+        }                                                                   \
+    }                                                                       \
+}
+
+FADE_VECTOR(dblp, double, vector_dmul, 1)
+FADE_VECTOR(fltp, float,  vector_fmul, 1)
+FADE_VECTOR(dbl,  double, vector_dmul, 0)
+FADE_VECTOR(flt,  float,  vector_fmul, 0)
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -226,9 +271,28 @@ static int config_output(AVFilterLink *outlink)
     if (s->start_time)
         s->start_sample = av_rescale(s->start_time, outlink->sample_rate, AV_TIME_BASE);
 
+    if (!s->fdsp) {
+        s->fdsp = avpriv_float_dsp_alloc(0);
+        if (!s->fdsp)
+            return AVERROR(ENOMEM);
+    }
+
+    av_freep(&s->gain);
+    s->gain = av_malloc_array(FADE_CHUNK * outlink->channels, sizeof(double));
+    if (!s->gain)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    AudioFadeContext *s = ctx->priv;
+
+    av_freep(&s->fdsp);
+    av_freep(&s->gain);
+}
+
 #if CONFIG_AFADE_FILTER
 
 static const AVOption afade_options[] = {
@@ -312,7 +376,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
         else
             start = s->start_sample + s->nb_samples - cur_sample;
 
-        s->fade_samples(out_buf->extended_data, buf->extended_data,
+        s->fade_samples(s, out_buf->extended_data, buf->extended_data,
                         nb_samples, buf->channels,
                         s->type ? -1 : 1, start,
                         s->nb_samples, s->curve);
@@ -348,6 +412,7 @@ AVFilter ff_af_afade = {
     .query_formats = query_formats,
     .priv_size     = sizeof(AudioFadeContext),
     .init          = init,
+    .uninit        = uninit,
     .inputs        = avfilter_af_afade_inputs,
     .outputs       = avfilter_af_afade_outputs,
     .priv_class    = &afade_class,
@@ -525,7 +590,7 @@ static int activate(AVFilterContext *ctx)
                 return ret;
             }
 
-            s->fade_samples(out->extended_data, cf[0]->extended_data, s->nb_samples,
+            s->fade_samples(s, out->extended_data, cf[0]->extended_data, s->nb_samples,
                             outlink->channels, -1, s->nb_samples - 1, s->nb_samples, s->curve);
             out->pts = s->pts;
             s->pts += av_rescale_q(s->nb_samples,
@@ -545,7 +610,7 @@ static int activate(AVFilterContext *ctx)
                 return ret;
             }
 
-            s->fade_samples(out->extended_data, cf[1]->extended_data, s->nb_samples,
+            s->fade_samples(s, out->extended_data, cf[1]->extended_data, s->nb_samples,
                             outlink->channels, 1, 0, s->nb_samples, s->curve2);
             out->pts = s->pts;
             s->pts += av_rescale_q(s->nb_samples,
@@ -601,9 +666,7 @@ static int acrossfade_config_output(AVFilterLink *outlink)
     case AV_SAMPLE_FMT_S32P: s->crossfade_samples = crossfade_samples_s32p; break;
     }
 
-    config_output(outlink);
-
-    return 0;
+    return config_output(outlink);
 }
 
 static const AVFilterPad avfilter_af_acrossfade_inputs[] = {
@@ -632,6 +695,7 @@ AVFilter ff_af_acrossfade = {
     .description   = NULL_IF_CONFIG_SMALL("Cross fade two input audio streams."),
     .query_formats = query_formats,
     .priv_size     = sizeof(AudioFadeContext),
+    .uninit        = uninit,
     .activate      = activate,
     .priv_class    = &acrossfade_class,
     .inputs        = avfilter_af_acrossfade_inputs,
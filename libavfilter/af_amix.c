@@ -48,6 +48,10 @@
 #define INPUT_ON       1    /**< input is active */
 #define INPUT_EOF      2    /**< input has reached EOF (may still be active) */
 
+#define MIX_ALIGN     16    /**< number of samples mixed at once by float_dsp */
+#define MIX_BLOCK     64    /**< number of MIX_ALIGN units mixed from all inputs
+                                 before moving on, to keep the output in cache */
+
 #define DURATION_LONGEST  0
 #define DURATION_SHORTEST 1
 #define DURATION_FIRST    2
@@ -175,6 +179,7 @@ typedef struct MixContext {
     float *scale_norm;          /**< normalization factor for every input */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
+    AVFrame **in_bufs;          /**< samples of each active input for the current output frame */
 } MixContext;
 
 #define OFFSET(x) offsetof(MixContext, x)
@@ -267,7 +272,8 @@ static int config_output(AVFilterLink *outlink)
 
     s->input_scale = av_mallocz_array(s->nb_inputs, sizeof(*s->input_scale));
     s->scale_norm  = av_mallocz_array(s->nb_inputs, sizeof(*s->scale_norm));
-    if (!s->input_scale || !s->scale_norm)
+    s->in_bufs     = av_mallocz_array(s->nb_inputs, sizeof(*s->in_bufs));
+    if (!s->input_scale || !s->scale_norm || !s->in_bufs)
         return AVERROR(ENOMEM);
     for (i = 0; i < s->nb_inputs; i++)
         s->scale_norm[i] = s->weight_sum / FFABS(s->weights[i]);
@@ -282,6 +288,50 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+/**
+ * Mix a range of the MIX_ALIGN sample units of the planes of all active
+ * inputs into the output frame.
+ */
+static int mix_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MixContext *s = ctx->priv;
+    AVFrame *out_buf = arg;
+    const int planes      = s->planar ? s->nb_channels : 1;
+    const int plane_units = FFALIGN(out_buf->nb_samples * (s->planar ? 1 : s->nb_channels),
+                                    MIX_ALIGN) / MIX_ALIGN;
+    const int nb_units    = planes * plane_units;
+    const int unit_start  = (nb_units *  jobnr     ) / nb_jobs;
+    const int unit_end    = (nb_units * (jobnr + 1)) / nb_jobs;
+    const int is_float    = out_buf->format == AV_SAMPLE_FMT_FLT ||
+                            out_buf->format == AV_SAMPLE_FMT_FLTP;
+
+    for (int u = unit_start; u < unit_end;) {
+        const int p      = u / plane_units;
+        const int offset = u % plane_units;
+        const int len    = FFMIN3(unit_end - u, plane_units - offset, MIX_BLOCK);
+
+        for (int i = 0; i < s->nb_inputs; i++) {
+            const AVFrame *in_buf = s->in_bufs[i];
+
+            if (!in_buf)
+                continue;
+
+            if (is_float) {
+                s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p] + offset * MIX_ALIGN,
+                                            (float *) in_buf->extended_data[p] + offset * MIX_ALIGN,
+                                            s->input_scale[i], len * MIX_ALIGN);
+            } else {
+                s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p] + offset * MIX_ALIGN,
+                                            (double *) in_buf->extended_data[p] + offset * MIX_ALIGN,
+                                            s->input_scale[i], len * MIX_ALIGN);
+            }
+        }
+        u += len;
+    }
+
+    return 0;
+}
+
 /**
  * Read samples from the input FIFOs, mix, and write to the output link.
  */
@@ -289,8 +339,8 @@ static int output_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, i;
+    AVFrame *out_buf;
+    int nb_samples, ns, i, nb_units, ret = 0;
 
     if (s->input_state[0] & INPUT_ON) {
         /* first input live: use the corresponding frame size */
@@ -334,40 +384,31 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
-
     for (i = 0; i < s->nb_inputs; i++) {
         if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
+            s->in_bufs[i] = ff_get_audio_buffer(outlink, nb_samples);
+            if (!s->in_bufs[i]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
+            av_audio_fifo_read(s->fifos[i], (void **)s->in_bufs[i]->extended_data,
                                nb_samples);
+        }
+    }
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+    nb_units = (s->planar ? s->nb_channels : 1) *
+               (FFALIGN(nb_samples * (s->planar ? 1 : s->nb_channels), MIX_ALIGN) / MIX_ALIGN);
+    ctx->internal->execute(ctx, mix_slice, out_buf, NULL,
+                           FFMIN(nb_units, ff_filter_get_nb_threads(ctx)));
 
-            if (out_buf->format == AV_SAMPLE_FMT_FLT ||
-                out_buf->format == AV_SAMPLE_FMT_FLTP) {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                                (float *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            } else {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p],
-                                                (double *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            }
-        }
+fail:
+    for (i = 0; i < s->nb_inputs; i++)
+        av_frame_free(&s->in_bufs[i]);
+    if (ret < 0) {
+        av_frame_free(&out_buf);
+        return ret;
     }
-    av_frame_free(&in_buf);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -566,6 +607,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
     av_freep(&s->scale_norm);
+    av_freep(&s->in_bufs);
     av_freep(&s->weights);
     av_freep(&s->fdsp);
 
@@ -621,5 +663,5 @@ AVFilter ff_af_amix = {
     .query_formats  = query_formats,
     .inputs         = NULL,
     .outputs        = avfilter_af_amix_outputs,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -1236,16 +1236,22 @@ static void compute_dense(const DenseLayer *layer, float *output, const float *i
 {
     const int N = layer->nb_neurons, M = layer->nb_inputs, stride = N;
 
-    for (int i = 0; i < N; i++) {
-        /* Compute update gate. */
-        float sum = layer->bias[i];
+    /* The weights are stored input by input, so accumulate all the neurons
+     * at once in that order to get contiguous, vectorizable inner loops. */
+    for (int i = 0; i < N; i++)
+        output[i] = layer->bias[i];
 
-        for (int j = 0; j < M; j++)
-            sum += layer->input_weights[j * stride + i] * input[j];
+    for (int j = 0; j < M; j++) {
+        const float *weights = layer->input_weights + j * stride;
+        const float in = input[j];
 
-        output[i] = WEIGHTS_SCALE * sum;
+        for (int i = 0; i < N; i++)
+            output[i] += weights[i] * in;
     }
 
+    for (int i = 0; i < N; i++)
+        output[i] *= WEIGHTS_SCALE;
+
     if (layer->activation == ACTIVATION_SIGMOID) {
         for (int i = 0; i < N; i++)
             output[i] = sigmoid_approx(output[i]);
@@ -1265,6 +1271,7 @@ static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, c
     LOCAL_ALIGNED_32(float, z, [MAX_NEURONS]);
     LOCAL_ALIGNED_32(float, r, [MAX_NEURONS]);
     LOCAL_ALIGNED_32(float, h, [MAX_NEURONS]);
+    LOCAL_ALIGNED_32(float, rs, [MAX_NEURONS]);
     const int M = gru->nb_inputs;
     const int N = gru->nb_neurons;
     const int AN = FFALIGN(N, 4);
@@ -1287,15 +1294,17 @@ static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, c
         sum += s->fdsp->scalarproduct_float(gru->input_weights + AM + i * istride, input, AM);
         sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + AN + i * stride, state, AN);
         r[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
+        rs[i] = state[i] * r[i];
     }
+    for (int i = N; i < AN; i++)
+        rs[i] = 0.f;
 
     for (int i = 0; i < N; i++) {
         /* Compute output. */
         float sum = gru->bias[2 * N + i];
 
         sum += s->fdsp->scalarproduct_float(gru->input_weights + 2 * AM + i * istride, input, AM);
-        for (int j = 0; j < N; j++)
-            sum += gru->recurrent_weights[2 * AN + i * stride + j] * state[j] * r[j];
+        sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + 2 * AN + i * stride, rs, AN);
 
         if (gru->activation == ACTIVATION_SIGMOID)
             sum = sigmoid_approx(WEIGHTS_SCALE * sum);
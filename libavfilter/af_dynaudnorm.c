@@ -27,6 +27,7 @@
 #include <float.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/float_dsp.h"
 #include "libavutil/opt.h"
 
 #define FF_BUFQUEUE_SIZE 302
@@ -65,6 +66,9 @@ typedef struct DynamicAudioNormalizerContext {
     double *compress_threshold;
     double *fade_factors[2];
     double *weights;
+    double *amplification;
+
+    AVFloatDSPContext *fdsp;
 
     int channels;
     int eof;
@@ -278,6 +282,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->compress_threshold);
     av_freep(&s->fade_factors[0]);
     av_freep(&s->fade_factors[1]);
+    av_freep(&s->amplification);
+    av_freep(&s->fdsp);
 
     for (c = 0; c < s->channels; c++) {
         if (s->gain_history_original)
@@ -313,6 +319,8 @@ static int config_input(AVFilterLink *inlink)
 
     s->fade_factors[0] = av_malloc_array(s->frame_len, sizeof(*s->fade_factors[0]));
     s->fade_factors[1] = av_malloc_array(s->frame_len, sizeof(*s->fade_factors[1]));
+    s->amplification   = av_malloc_array(s->frame_len, sizeof(*s->amplification));
+    s->fdsp            = avpriv_float_dsp_alloc(0);
 
     s->prev_amplification_factor = av_malloc_array(inlink->channels, sizeof(*s->prev_amplification_factor));
     s->dc_correction_value = av_calloc(inlink->channels, sizeof(*s->dc_correction_value));
@@ -324,6 +332,7 @@ static int config_input(AVFilterLink *inlink)
     s->is_enabled = cqueue_create(s->filter_size);
     if (!s->prev_amplification_factor || !s->dc_correction_value ||
         !s->compress_threshold || !s->fade_factors[0] || !s->fade_factors[1] ||
+        !s->amplification || !s->fdsp ||
         !s->gain_history_original || !s->gain_history_minimum ||
         !s->gain_history_smoothed || !s->is_enabled || !s->weights)
         return AVERROR(ENOMEM);
@@ -646,6 +655,8 @@ static void analyze_frame(DynamicAudioNormalizerContext *s, AVFrame *frame)
 
 static void amplify_frame(DynamicAudioNormalizerContext *s, AVFrame *frame, int enabled)
 {
+    const int nb_samples = frame->nb_samples;
+    const int nb_simd    = nb_samples & ~15;
     int c, i;
 
     for (c = 0; c < s->channels; c++) {
@@ -654,15 +665,20 @@ static void amplify_frame(DynamicAudioNormalizerContext *s, AVFrame *frame, int
 
         cqueue_dequeue(s->gain_history_smoothed[c], &current_amplification_factor);
 
-        for (i = 0; i < frame->nb_samples && enabled; i++) {
-            const double amplification_factor = fade(s->prev_amplification_factor[c],
-                                                     current_amplification_factor, i,
-                                                     s->fade_factors);
+        if (enabled) {
+            /* build the gain ramp first, so that it can be applied with
+             * a vector multiplication */
+            for (i = 0; i < nb_samples; i++)
+                s->amplification[i] = fade(s->prev_amplification_factor[c],
+                                           current_amplification_factor, i,
+                                           s->fade_factors);
 
-            dst_ptr[i] *= amplification_factor;
+            s->fdsp->vector_dmul(dst_ptr, dst_ptr, s->amplification, nb_simd);
+            for (i = nb_simd; i < nb_samples; i++)
+                dst_ptr[i] *= s->amplification[i];
 
-            if (fabs(dst_ptr[i]) > s->peak_value)
-                dst_ptr[i] = copysign(s->peak_value, dst_ptr[i]);
+            for (i = 0; i < nb_samples; i++)
+                dst_ptr[i] = av_clipd(dst_ptr[i], -s->peak_value, s->peak_value);
         }
 
         s->prev_amplification_factor[c] = current_amplification_factor;
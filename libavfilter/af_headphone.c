@@ -27,6 +27,7 @@
 #include "libavutil/opt.h"
 #include "libavcodec/avfft.h"
 
+#include "af_afirdsp.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "internal.h"
@@ -79,6 +80,7 @@ typedef struct HeadphoneContext {
     FFTComplex *data_hrtf[2];
 
     AVFloatDSPContext *fdsp;
+    AudioFIRDSPContext afirdsp;
     struct headphone_inputs {
         AVFrame     *frame;
         int          ir_len;
@@ -297,14 +299,10 @@ static int headphone_fast_convolute(AVFilterContext *ctx, void *arg, int jobnr,
 
         av_fft_permute(fft, fft_in);
         av_fft_calc(fft, fft_in);
-        for (j = 0; j < n_fft; j++) {
-            const FFTComplex *hcomplex = hrtf_offset + j;
-            const float re = fft_in[j].re;
-            const float im = fft_in[j].im;
-
-            fft_acc[j].re += re * hcomplex->re - im * hcomplex->im;
-            fft_acc[j].im += re * hcomplex->im + im * hcomplex->re;
-        }
+        /* the element past the end of fft_in is zero, so the extra real
+         * product done by fcmul_add() leaves the padding of fft_acc alone */
+        s->afirdsp.fcmul_add((float *)fft_acc, (const float *)fft_in,
+                             (const float *)hrtf_offset, n_fft);
     }
 
     av_fft_permute(ifft, fft_acc);
@@ -443,10 +441,10 @@ static int convert_coeffs(AVFilterContext *ctx, AVFilterLink *inlink)
     } else {
         s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float));
         s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float));
-        s->temp_fft[0] = av_calloc(s->n_fft, sizeof(FFTComplex));
-        s->temp_fft[1] = av_calloc(s->n_fft, sizeof(FFTComplex));
-        s->temp_afft[0] = av_calloc(s->n_fft, sizeof(FFTComplex));
-        s->temp_afft[1] = av_calloc(s->n_fft, sizeof(FFTComplex));
+        s->temp_fft[0] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_fft[1] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_afft[0] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_afft[1] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
         if (!s->temp_fft[0] || !s->temp_fft[1] ||
             !s->temp_afft[0] || !s->temp_afft[1]) {
             ret = AVERROR(ENOMEM);
@@ -582,8 +580,8 @@ static int convert_coeffs(AVFilterContext *ctx, AVFilterLink *inlink)
         memcpy(s->data_ir[0], data_ir_l, sizeof(float) * nb_irs * s->air_len);
         memcpy(s->data_ir[1], data_ir_r, sizeof(float) * nb_irs * s->air_len);
     } else {
-        s->data_hrtf[0] = av_calloc(n_fft * s->nb_irs, sizeof(FFTComplex));
-        s->data_hrtf[1] = av_calloc(n_fft * s->nb_irs, sizeof(FFTComplex));
+        s->data_hrtf[0] = av_calloc(n_fft * s->nb_irs + 1, sizeof(FFTComplex));
+        s->data_hrtf[1] = av_calloc(n_fft * s->nb_irs + 1, sizeof(FFTComplex));
         if (!s->data_hrtf[0] || !s->data_hrtf[1]) {
             ret = AVERROR(ENOMEM);
             goto fail;
@@ -782,6 +780,8 @@ static av_cold int init(AVFilterContext *ctx)
         }
     }
 
+    ff_afir_init(&s->afirdsp);
+
     s->fdsp = avpriv_float_dsp_alloc(0);
     if (!s->fdsp)
         return AVERROR(ENOMEM);
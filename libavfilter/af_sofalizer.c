@@ -34,6 +34,7 @@
 #include "libavutil/float_dsp.h"
 #include "libavutil/intmath.h"
 #include "libavutil/opt.h"
+#include "af_afirdsp.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "internal.h"
@@ -112,6 +113,7 @@ typedef struct SOFAlizerContext {
     FFTComplex *data_hrtf[2];
 
     AVFloatDSPContext *fdsp;
+    AudioFIRDSPContext afirdsp;
 } SOFAlizerContext;
 
 static int close_sofa(struct MySofa *sofa)
@@ -523,17 +525,11 @@ static int sofalizer_fast_convolute(AVFilterContext *ctx, void *arg, int jobnr,
         /* transform input signal of current channel to frequency domain */
         av_fft_permute(fft, fft_in);
         av_fft_calc(fft, fft_in);
-        for (j = 0; j < n_fft; j++) {
-            const FFTComplex *hcomplex = hrtf_offset + j;
-            const float re = fft_in[j].re;
-            const float im = fft_in[j].im;
-
-            /* complex multiplication of input signal and HRTFs */
-            /* output channel (real): */
-            fft_acc[j].re += re * hcomplex->re - im * hcomplex->im;
-            /* output channel (imag): */
-            fft_acc[j].im += re * hcomplex->im + im * hcomplex->re;
-        }
+        /* complex multiplication of input signal and HRTFs, the element
+         * past the end of fft_in is zero, so the extra real product done by
+         * fcmul_add() leaves the padding of fft_acc alone */
+        s->afirdsp.fcmul_add((float *)fft_acc, (const float *)fft_in,
+                             (const float *)hrtf_offset, n_fft);
     }
 
     /* transform output signal of current channel back to time domain */
@@ -863,10 +859,10 @@ static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int
 
         s->ringbuffer[0] = av_calloc(s->buffer_length, sizeof(float));
         s->ringbuffer[1] = av_calloc(s->buffer_length, sizeof(float));
-        s->temp_fft[0] = av_malloc_array(s->n_fft, sizeof(FFTComplex));
-        s->temp_fft[1] = av_malloc_array(s->n_fft, sizeof(FFTComplex));
-        s->temp_afft[0] = av_malloc_array(s->n_fft, sizeof(FFTComplex));
-        s->temp_afft[1] = av_malloc_array(s->n_fft, sizeof(FFTComplex));
+        s->temp_fft[0] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_fft[1] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_afft[0] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
+        s->temp_afft[1] = av_calloc(s->n_fft + 1, sizeof(FFTComplex));
         if (!s->temp_fft[0] || !s->temp_fft[1] ||
             !s->temp_afft[0] || !s->temp_afft[1]) {
             ret = AVERROR(ENOMEM);
@@ -928,8 +924,8 @@ static int load_data(AVFilterContext *ctx, int azim, int elev, float radius, int
     }
 
     if (s->type == FREQUENCY_DOMAIN) {
-        s->data_hrtf[0] = av_malloc_array(n_fft * s->n_conv, sizeof(FFTComplex));
-        s->data_hrtf[1] = av_malloc_array(n_fft * s->n_conv, sizeof(FFTComplex));
+        s->data_hrtf[0] = av_calloc(n_fft * s->n_conv + 1, sizeof(FFTComplex));
+        s->data_hrtf[1] = av_calloc(n_fft * s->n_conv + 1, sizeof(FFTComplex));
         if (!s->data_hrtf[0] || !s->data_hrtf[1]) {
             ret = AVERROR(ENOMEM);
             goto fail;
@@ -978,6 +974,8 @@ static av_cold int init(AVFilterContext *ctx)
         return ret;
     }
 
+    ff_afir_init(&s->afirdsp);
+
     s->fdsp = avpriv_float_dsp_alloc(0);
     if (!s->fdsp)
         return AVERROR(ENOMEM);
@@ -304,10 +304,12 @@ extern AVFilter ff_vf_ocr;
 extern AVFilter ff_vf_ocv;
 extern AVFilter ff_vf_oscilloscope;
 extern AVFilter ff_vf_overlay;
+extern AVFilter ff_vf_overlay_cuda;
 extern AVFilter ff_vf_overlay_opencl;
 extern AVFilter ff_vf_overlay_qsv;
 extern AVFilter ff_vf_owdenoise;
 extern AVFilter ff_vf_pad;
+extern AVFilter ff_vf_pad_cuda;
 extern AVFilter ff_vf_palettegen;
 extern AVFilter ff_vf_paletteuse;
 extern AVFilter ff_vf_perms;
@@ -343,7 +345,10 @@ extern AVFilter ff_vf_rotate;
 extern AVFilter ff_vf_sab;
 extern AVFilter ff_vf_scale;
 extern AVFilter ff_vf_scale_cuda;
+extern AVFilter ff_vf_scale_cuda_ladder;
+extern AVFilter ff_vf_scale_ladder;
 extern AVFilter ff_vf_scale_npp;
+extern AVFilter ff_vf_scale_opencl;
 extern AVFilter ff_vf_scale_qsv;
 extern AVFilter ff_vf_scale_vaapi;
 extern AVFilter ff_vf_scale2ref;
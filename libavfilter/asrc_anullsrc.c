@@ -30,6 +30,7 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "internal.h"
@@ -42,6 +43,7 @@ typedef struct ANullContext {
     int     sample_rate;
     int nb_samples;             ///< number of samples per requested frame
     int64_t pts;
+    AVFrame *silence;           ///< cached silent frame, every output references it
 } ANullContext;
 
 #define OFFSET(x) offsetof(ANullContext, x)
@@ -75,6 +77,13 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ANullContext *null = ctx->priv;
+
+    av_frame_free(&null->silence);
+}
+
 static int query_formats(AVFilterContext *ctx)
 {
     ANullContext *null = ctx->priv;
@@ -109,16 +118,22 @@ static int request_frame(AVFilterLink *outlink)
     ANullContext *null = outlink->src->priv;
     AVFrame *samplesref;
 
-    samplesref = ff_get_audio_buffer(outlink, null->nb_samples);
+    if (!null->silence) {
+        null->silence = ff_get_audio_buffer(outlink, null->nb_samples);
+        if (!null->silence)
+            return AVERROR(ENOMEM);
+        av_samples_set_silence(null->silence->extended_data, 0, null->nb_samples,
+                               outlink->channels, outlink->format);
+        null->silence->channel_layout = null->channel_layout;
+        null->silence->sample_rate = outlink->sample_rate;
+    }
+
+    samplesref = av_frame_clone(null->silence);
     if (!samplesref)
         return AVERROR(ENOMEM);
-
     samplesref->pts = null->pts;
-    samplesref->channel_layout = null->channel_layout;
-    samplesref->sample_rate = outlink->sample_rate;
 
-    ret = ff_filter_frame(outlink, av_frame_clone(samplesref));
-    av_frame_free(&samplesref);
+    ret = ff_filter_frame(outlink, samplesref);
     if (ret < 0)
         return ret;
 
@@ -140,6 +155,7 @@ AVFilter ff_asrc_anullsrc = {
     .name          = "anullsrc",
     .description   = NULL_IF_CONFIG_SMALL("Null audio source, return empty audio frames."),
     .init          = init,
+    .uninit        = uninit,
     .query_formats = query_formats,
     .priv_size     = sizeof(ANullContext),
     .inputs        = NULL,
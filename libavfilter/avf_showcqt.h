@@ -79,10 +79,13 @@ typedef struct ShowCQTContext {
     void                (*cqt_calc)(FFTComplex *dst, const FFTComplex *src, const Coeffs *coeffs,
                                     int len, int fft_len);
     void                (*permute_coeffs)(float *v, int len);
+    /* the draw callbacks render the rows y0 to y1 - 1 of their area,
+     * y0 and y1 are even */
     void                (*draw_bar)(AVFrame *out, const float *h, const float *rcp_h,
-                                    const ColorFloat *c, int bar_h, float bar_t);
-    void                (*draw_axis)(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off);
-    void                (*draw_sono)(AVFrame *out, AVFrame *sono, int off, int idx);
+                                    const ColorFloat *c, int bar_h, float bar_t, int y0, int y1);
+    void                (*draw_axis)(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off,
+                                     int y0, int y1);
+    void                (*draw_sono)(AVFrame *out, AVFrame *sono, int off, int idx, int y0, int y1);
     void                (*update_sono)(AVFrame *sono, const ColorFloat *c, int idx);
     /* performance debugging */
     int64_t             fft_time;
@@ -28,13 +28,13 @@
 
 #include <math.h>
 
-#include "libavcodec/avfft.h"
 #include "libavutil/audio_fifo.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/tx.h"
 #include "libavutil/xga_font_data.h"
 #include "audio.h"
 #include "video.h"
@@ -72,11 +72,13 @@ typedef struct ShowSpectrumContext {
     int start, stop;            ///< zoom mode
     int data;
     int xpos;                   ///< x position (current column)
-    FFTContext **fft;           ///< Fast Fourier Transform context
-    FFTContext **ifft;          ///< Inverse Fast Fourier Transform context
+    AVTXContext **fft;          ///< Fast Fourier Transform context
+    AVTXContext **ifft;         ///< Inverse Fast Fourier Transform context
+    av_tx_fn tx_fn, itx_fn;
     int fft_bits;               ///< number of bits (FFT window size = 1<<fft_bits)
-    FFTComplex **fft_data;      ///< bins holder for each (displayed) channels
-    FFTComplex **fft_scratch;   ///< scratch buffers
+    AVComplexFloat **fft_in;    ///< FFT input for each (displayed) channels
+    AVComplexFloat **fft_data;  ///< bins holder for each (displayed) channels
+    AVComplexFloat **fft_scratch; ///< scratch buffers
     float *window_func_lut;     ///< Window function LUT
     float **magnitudes;
     float **phases;
@@ -305,14 +307,19 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->combine_buffer);
     if (s->fft) {
         for (i = 0; i < s->nb_display_channels; i++)
-            av_fft_end(s->fft[i]);
+            av_tx_uninit(&s->fft[i]);
     }
     av_freep(&s->fft);
     if (s->ifft) {
         for (i = 0; i < s->nb_display_channels; i++)
-            av_fft_end(s->ifft[i]);
+            av_tx_uninit(&s->ifft[i]);
     }
     av_freep(&s->ifft);
+    if (s->fft_in) {
+        for (i = 0; i < s->nb_display_channels; i++)
+            av_freep(&s->fft_in[i]);
+    }
+    av_freep(&s->fft_in);
     if (s->fft_data) {
         for (i = 0; i < s->nb_display_channels; i++)
             av_freep(&s->fft_data[i]);
@@ -387,14 +394,15 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
     const float *p = (float *)fin->extended_data[ch];
 
     for (n = 0; n < s->win_size; n++) {
-        s->fft_data[ch][n].re = p[n] * window_func_lut[n];
-        s->fft_data[ch][n].im = 0;
+        s->fft_in[ch][n].re = p[n] * window_func_lut[n];
+        s->fft_in[ch][n].im = 0;
     }
 
     if (s->stop) {
         float theta, phi, psi, a, b, S, c;
-        FFTComplex *g = s->fft_data[ch];
-        FFTComplex *h = s->fft_scratch[ch];
+        AVComplexFloat *f = s->fft_in[ch];
+        AVComplexFloat *g = s->fft_data[ch];
+        AVComplexFloat *h = s->fft_scratch[ch];
         int L = s->buf_size;
         int N = s->win_size;
         int M = s->win_size / 2;
@@ -402,46 +410,39 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
         phi = 2.f * M_PI * (s->stop - s->start) / (float)inlink->sample_rate / (M - 1);
         theta = 2.f * M_PI * s->start / (float)inlink->sample_rate;
 
-        for (int n = 0; n < M; n++) {
-            h[n].re = cosf(n * n / 2.f * phi);
-            h[n].im = sinf(n * n / 2.f * phi);
+        for (int n = 0; n < N; n++) {
+            psi = n * theta + n * n / 2.f * phi;
+            c =  cosf(psi);
+            S = -sinf(psi);
+            a = c * f[n].re - S * f[n].im;
+            b = S * f[n].re + c * f[n].im;
+            f[n].re = a;
+            f[n].im = b;
         }
 
-        for (int n = M; n < L; n++) {
-            h[n].re = 0.f;
-            h[n].im = 0.f;
+        for (int n = N; n < L; n++) {
+            f[n].re = 0.f;
+            f[n].im = 0.f;
         }
 
-        for (int n = L - N; n < L; n++) {
-            h[n].re = cosf((L - n) * (L - n) / 2.f * phi);
-            h[n].im = sinf((L - n) * (L - n) / 2.f * phi);
-        }
+        s->tx_fn(s->fft[ch], g, f, sizeof(float));
 
-        for (int n = 0; n < N; n++) {
-            g[n].re = s->fft_data[ch][n].re;
-            g[n].im = s->fft_data[ch][n].im;
+        for (int n = 0; n < M; n++) {
+            f[n].re = cosf(n * n / 2.f * phi);
+            f[n].im = sinf(n * n / 2.f * phi);
         }
 
-        for (int n = N; n < L; n++) {
-            g[n].re = 0.f;
-            g[n].im = 0.f;
+        for (int n = M; n < L; n++) {
+            f[n].re = 0.f;
+            f[n].im = 0.f;
         }
 
-        for (int n = 0; n < N; n++) {
-            psi = n * theta + n * n / 2.f * phi;
-            c =  cosf(psi);
-            S = -sinf(psi);
-            a = c * g[n].re - S * g[n].im;
-            b = S * g[n].re + c * g[n].im;
-            g[n].re = a;
-            g[n].im = b;
+        for (int n = L - N; n < L; n++) {
+            f[n].re = cosf((L - n) * (L - n) / 2.f * phi);
+            f[n].im = sinf((L - n) * (L - n) / 2.f * phi);
         }
 
-        av_fft_permute(s->fft[ch], h);
-        av_fft_calc(s->fft[ch], h);
-
-        av_fft_permute(s->fft[ch], g);
-        av_fft_calc(s->fft[ch], g);
+        s->tx_fn(s->fft[ch], h, f, sizeof(float));
 
         for (int n = 0; n < L; n++) {
             c = g[n].re;
@@ -449,12 +450,11 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
             a = c * h[n].re - S * h[n].im;
             b = S * h[n].re + c * h[n].im;
 
-            g[n].re = a / L;
-            g[n].im = b / L;
+            f[n].re = a / L;
+            f[n].im = b / L;
         }
 
-        av_fft_permute(s->ifft[ch], g);
-        av_fft_calc(s->ifft[ch], g);
+        s->itx_fn(s->ifft[ch], g, f, sizeof(float));
 
         for (int k = 0; k < M; k++) {
             psi = k * k / 2.f * phi;
@@ -462,13 +462,12 @@ static int run_channel_fft(AVFilterContext *ctx, void *arg, int jobnr, int nb_jo
             S = -sinf(psi);
             a = c * g[k].re - S * g[k].im;
             b = S * g[k].re + c * g[k].im;
-            s->fft_data[ch][k].re = a;
-            s->fft_data[ch][k].im = b;
+            g[k].re = a;
+            g[k].im = b;
         }
     } else {
         /* run FFT on each samples set */
-        av_fft_permute(s->fft[ch], s->fft_data[ch]);
-        av_fft_calc(s->fft[ch], s->fft_data[ch]);
+        s->tx_fn(s->fft[ch], s->fft_data[ch], s->fft_in[ch], sizeof(float));
     }
 
     return 0;
@@ -986,7 +985,7 @@ static int config_output(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     AVFilterLink *inlink = ctx->inputs[0];
     ShowSpectrumContext *s = ctx->priv;
-    int i, fft_bits, h, w;
+    int i, fft_bits, h, w, ret;
     float overlap;
 
     switch (s->fscale) {
@@ -1056,29 +1055,35 @@ static int config_output(AVFilterLink *outlink)
          * make sure the buffer is aligned in memory for the FFT functions. */
         for (i = 0; i < s->nb_display_channels; i++) {
             if (s->stop) {
-                av_fft_end(s->ifft[i]);
+                av_tx_uninit(&s->ifft[i]);
                 av_freep(&s->fft_scratch[i]);
             }
-            av_fft_end(s->fft[i]);
+            av_tx_uninit(&s->fft[i]);
+            av_freep(&s->fft_in[i]);
             av_freep(&s->fft_data[i]);
         }
+        av_freep(&s->fft_in);
         av_freep(&s->fft_data);
 
         s->nb_display_channels = inlink->channels;
         for (i = 0; i < s->nb_display_channels; i++) {
-            s->fft[i] = av_fft_init(fft_bits + !!s->stop, 0);
-            if (s->stop) {
-                s->ifft[i] = av_fft_init(fft_bits + !!s->stop, 1);
-                if (!s->ifft[i]) {
+            float scale = 1.f;
+
+            ret = av_tx_init(&s->fft[i], &s->tx_fn, AV_TX_FLOAT_FFT, 0,
+                             s->buf_size, &scale, 0);
+            if (s->stop && ret >= 0) {
+                ret = av_tx_init(&s->ifft[i], &s->itx_fn, AV_TX_FLOAT_FFT, 1,
+                                 s->buf_size, &scale, 0);
+                if (ret < 0) {
                     av_log(ctx, AV_LOG_ERROR, "Unable to create Inverse FFT context. "
                            "The window size might be too high.\n");
-                    return AVERROR(EINVAL);
+                    return ret;
                 }
             }
-            if (!s->fft[i]) {
+            if (ret < 0) {
                 av_log(ctx, AV_LOG_ERROR, "Unable to create FFT context. "
                        "The window size might be too high.\n");
-                return AVERROR(EINVAL);
+                return ret;
             }
         }
 
@@ -1110,6 +1115,9 @@ static int config_output(AVFilterLink *outlink)
                 return AVERROR(ENOMEM);
         }
 
+        s->fft_in = av_calloc(s->nb_display_channels, sizeof(*s->fft_in));
+        if (!s->fft_in)
+            return AVERROR(ENOMEM);
         s->fft_data = av_calloc(s->nb_display_channels, sizeof(*s->fft_data));
         if (!s->fft_data)
             return AVERROR(ENOMEM);
@@ -1117,6 +1125,10 @@ static int config_output(AVFilterLink *outlink)
         if (!s->fft_scratch)
             return AVERROR(ENOMEM);
         for (i = 0; i < s->nb_display_channels; i++) {
+            s->fft_in[i] = av_calloc(s->buf_size, sizeof(**s->fft_in));
+            if (!s->fft_in[i])
+                return AVERROR(ENOMEM);
+
             s->fft_data[i] = av_calloc(s->buf_size, sizeof(**s->fft_data));
             if (!s->fft_data[i])
                 return AVERROR(ENOMEM);
@@ -1174,7 +1186,7 @@ static int config_output(AVFilterLink *outlink)
     if (s->orientation == HORIZONTAL && s->sliding == FULLFRAME)
         s->auto_frame_rate.den *= s->h;
     if (!s->single_pic && strcmp(s->rate_str, "auto")) {
-        int ret = av_parse_video_rate(&s->frame_rate, s->rate_str);
+        ret = av_parse_video_rate(&s->frame_rate, s->rate_str);
         if (ret < 0)
             return ret;
     } else {
@@ -1274,57 +1286,69 @@ static void clear_combine_buffer(ShowSpectrumContext *s, int size)
     }
 }
 
-static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
+static int plot_spectrum_rows(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = inlink->dst;
-    AVFilterLink *outlink = ctx->outputs[0];
     ShowSpectrumContext *s = ctx->priv;
     AVFrame *outpicref = s->outpicref;
-    int ret, plane, x, y, z = s->orientation == VERTICAL ? s->h : s->w;
+    const int z = s->orientation == VERTICAL ? s->h : s->w;
+    const int start = (z *  jobnr     ) / nb_jobs;
+    const int end   = (z * (jobnr + 1)) / nb_jobs;
+    int plane, x, y;
 
-    /* fill a new spectrum column */
-    /* initialize buffer for combining to black */
-    clear_combine_buffer(s, z);
-
-    ctx->internal->execute(ctx, s->plot_channel, NULL, NULL, s->nb_display_channels);
-
-    for (y = 0; y < z * 3; y++) {
+    for (y = 3 * start; y < 3 * end; y++) {
         for (x = 0; x < s->nb_display_channels; x++) {
             s->combine_buffer[y] += s->color_buffer[x][y];
         }
     }
 
-    av_frame_make_writable(s->outpicref);
     /* copy to output */
     if (s->orientation == VERTICAL) {
-        if (s->sliding == SCROLL) {
-            for (plane = 0; plane < 3; plane++) {
-                for (y = 0; y < s->h; y++) {
-                    uint8_t *p = outpicref->data[plane] + s->start_x +
-                                 (y + s->start_y) * outpicref->linesize[plane];
+        for (plane = 0; plane < 3; plane++) {
+            for (y = start; y < end; y++) {
+                uint8_t *p = outpicref->data[plane] + s->start_x +
+                             (s->h - 1 - y + s->start_y) * outpicref->linesize[plane];
+
+                if (s->sliding == SCROLL)
                     memmove(p, p + 1, s->w - 1);
-                }
-            }
-            s->xpos = s->w - 1;
-        } else if (s->sliding == RSCROLL) {
-            for (plane = 0; plane < 3; plane++) {
-                for (y = 0; y < s->h; y++) {
-                    uint8_t *p = outpicref->data[plane] + s->start_x +
-                                 (y + s->start_y) * outpicref->linesize[plane];
+                else if (s->sliding == RSCROLL)
                     memmove(p + 1, p, s->w - 1);
-                }
+                p[s->xpos] = lrintf(av_clipf(s->combine_buffer[3 * y + plane], 0, 255));
             }
-            s->xpos = 0;
         }
+    } else {
         for (plane = 0; plane < 3; plane++) {
             uint8_t *p = outpicref->data[plane] + s->start_x +
-                         (outlink->h - 1 - s->start_y) * outpicref->linesize[plane] +
-                         s->xpos;
-            for (y = 0; y < s->h; y++) {
-                *p = lrintf(av_clipf(s->combine_buffer[3 * y + plane], 0, 255));
-                p -= outpicref->linesize[plane];
-            }
+                         (s->xpos + s->start_y) * outpicref->linesize[plane];
+            for (x = start; x < end; x++)
+                p[x] = lrintf(av_clipf(s->combine_buffer[3 * x + plane], 0, 255));
         }
+    }
+
+    return 0;
+}
+
+static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ShowSpectrumContext *s = ctx->priv;
+    AVFrame *outpicref = s->outpicref;
+    int ret, plane, y, z = s->orientation == VERTICAL ? s->h : s->w;
+
+    /* fill a new spectrum column */
+    /* initialize buffer for combining to black */
+    clear_combine_buffer(s, z);
+
+    ctx->internal->execute(ctx, s->plot_channel, NULL, NULL, s->nb_display_channels);
+
+    av_frame_make_writable(s->outpicref);
+    /* the rows of the spectrum are scrolled and written by the slice
+     * jobs, except for the horizontal scrolling which moves whole lines */
+    if (s->orientation == VERTICAL) {
+        if (s->sliding == SCROLL)
+            s->xpos = s->w - 1;
+        else if (s->sliding == RSCROLL)
+            s->xpos = 0;
     } else {
         if (s->sliding == SCROLL) {
             for (plane = 0; plane < 3; plane++) {
@@ -1345,15 +1369,9 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
             }
             s->xpos = 0;
         }
-        for (plane = 0; plane < 3; plane++) {
-            uint8_t *p = outpicref->data[plane] + s->start_x +
-                         (s->xpos + s->start_y) * outpicref->linesize[plane];
-            for (x = 0; x < s->w; x++) {
-                *p = lrintf(av_clipf(s->combine_buffer[3 * x + plane], 0, 255));
-                p++;
-            }
-        }
     }
+    ctx->internal->execute(ctx, plot_spectrum_rows, NULL, NULL,
+                           FFMIN(z, ff_filter_get_nb_threads(ctx)));
 
     if (s->sliding != FULLFRAME || s->xpos == 0)
         outpicref->pts = av_rescale_q(insamples->pts, inlink->time_base, outlink->time_base);
@@ -1366,7 +1384,7 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFrame *insamples)
     if (!s->single_pic && (s->sliding != FULLFRAME || s->xpos == 0)) {
         if (s->old_pts < outpicref->pts) {
             if (s->legend) {
-                char *units = get_time(ctx, insamples->pts /(float)inlink->sample_rate, x);
+                char *units = get_time(ctx, insamples->pts /(float)inlink->sample_rate, z);
                 if (!units)
                     return AVERROR(ENOMEM);
 
@@ -69,6 +69,7 @@ typedef struct ShowWavesContext {
     char *colors;
     int buf_idx;
     int16_t *buf_idy;    /* y coordinate of previous sample for each channel */
+    int16_t *job_idy;    /* buf_idy of each slice job */
     AVFrame *outpicref;
     int n;
     int pixstep;
@@ -126,6 +127,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_frame_free(&showwaves->outpicref);
     av_freep(&showwaves->buf_idy);
+    av_freep(&showwaves->job_idy);
     av_freep(&showwaves->fg);
 
     if (showwaves->single_pic) {
@@ -424,6 +426,9 @@ static int config_output(AVFilterLink *outlink)
         av_log(ctx, AV_LOG_ERROR, "Could not allocate showwaves buffer\n");
         return AVERROR(ENOMEM);
     }
+    if (!(showwaves->job_idy = av_malloc_array(ff_filter_get_nb_threads(ctx) * nb_channels,
+                                               sizeof(*showwaves->job_idy))))
+        return AVERROR(ENOMEM);
     outlink->w = showwaves->w;
     outlink->h = showwaves->h;
     outlink->sample_aspect_ratio = (AVRational){1,1};
@@ -668,50 +673,89 @@ static av_cold int init(AVFilterContext *ctx)
 
 #if CONFIG_SHOWWAVES_FILTER
 
+typedef struct ThreadData {
+    const int16_t *p;           ///< first sample to draw
+    int nb_samples;             ///< number of samples to draw, all in the current picture
+} ThreadData;
+
+/* Every sample is drawn in its own column, so the columns are split between
+ * the jobs. Each job starts from the y coordinate of the sample before its
+ * first one, which gives the same picture as drawing all samples in order. */
+static int draw_columns(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowWavesContext *showwaves = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData *td = arg;
+    const int nb_channels = ctx->inputs[0]->channels;
+    const int ch_height = showwaves->split_channels ? outlink->h / nb_channels : outlink->h;
+    const int linesize = showwaves->outpicref->linesize[0];
+    const int pixstep = showwaves->pixstep;
+    const int n = showwaves->n;
+    const int mod = showwaves->sample_count_mod;
+    const int nb_columns = (mod + td->nb_samples + n - 1) / n;
+    const int start = FFMAX(nb_columns *  jobnr      / nb_jobs * n - mod, 0);
+    const int end   = FFMIN(nb_columns * (jobnr + 1) / nb_jobs * n - mod, td->nb_samples);
+    int16_t *prev_y = showwaves->job_idy + jobnr * nb_channels;
+    int i, j;
+
+    for (j = 0; j < nb_channels; j++)
+        prev_y[j] = start ? showwaves->get_h(td->p[(start - 1) * nb_channels + j], ch_height)
+                          : showwaves->buf_idy[j];
+
+    for (i = start; i < end; i++) {
+        const int16_t *p = td->p + i * nb_channels;
+        uint8_t *buf = showwaves->outpicref->data[0] +
+                       (showwaves->buf_idx + (mod + i) / n) * pixstep;
+
+        for (j = 0; j < nb_channels; j++) {
+            int h = showwaves->get_h(p[j], ch_height);
+
+            showwaves->draw_sample(buf + (showwaves->split_channels ? j * ch_height * linesize : 0),
+                                   ch_height, linesize, &prev_y[j], &showwaves->fg[j * 4], h);
+        }
+    }
+
+    if (end == td->nb_samples)
+        memcpy(showwaves->buf_idy, prev_y, nb_channels * sizeof(*prev_y));
+    return 0;
+}
+
 static int showwaves_filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 {
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     ShowWavesContext *showwaves = ctx->priv;
     const int nb_samples = insamples->nb_samples;
-    AVFrame *outpicref = showwaves->outpicref;
     int16_t *p = (int16_t *)insamples->data[0];
     int nb_channels = inlink->channels;
-    int i, j, ret = 0;
-    const int pixstep = showwaves->pixstep;
+    int i, ret = 0;
     const int n = showwaves->n;
-    const int ch_height = showwaves->split_channels ? outlink->h / nb_channels : outlink->h;
 
-    /* draw data in the buffer */
-    for (i = 0; i < nb_samples; i++) {
+    /* draw data in the buffer, up to the end of each picture at once */
+    for (i = 0; i < nb_samples; ) {
+        ThreadData td;
+        int nb_columns;
 
         ret = alloc_out_frame(showwaves, p, inlink, outlink, insamples);
         if (ret < 0)
             goto end;
-        outpicref = showwaves->outpicref;
 
-        for (j = 0; j < nb_channels; j++) {
-            uint8_t *buf = outpicref->data[0] + showwaves->buf_idx * pixstep;
-            const int linesize = outpicref->linesize[0];
-            int h;
-
-            if (showwaves->split_channels)
-                buf += j*ch_height*linesize;
-            h = showwaves->get_h(*p++, ch_height);
-            showwaves->draw_sample(buf, ch_height, linesize,
-                                   &showwaves->buf_idy[j], &showwaves->fg[j * 4], h);
-        }
-
-        showwaves->sample_count_mod++;
-        if (showwaves->sample_count_mod == n) {
-            showwaves->sample_count_mod = 0;
-            showwaves->buf_idx++;
-        }
+        td.p          = p;
+        td.nb_samples = FFMIN((showwaves->w - showwaves->buf_idx) * n - showwaves->sample_count_mod,
+                              nb_samples - i);
+        nb_columns    = (showwaves->sample_count_mod + td.nb_samples + n - 1) / n;
+        ctx->internal->execute(ctx, draw_columns, &td, NULL,
+                               FFMIN(nb_columns, ff_filter_get_nb_threads(ctx)));
+
+        p += td.nb_samples * nb_channels;
+        i += td.nb_samples;
+        showwaves->sample_count_mod += td.nb_samples;
+        showwaves->buf_idx          += showwaves->sample_count_mod / n;
+        showwaves->sample_count_mod %= n;
         if (showwaves->buf_idx == showwaves->w ||
-            (ff_outlink_get_status(inlink) && i == nb_samples - 1))
+            (ff_outlink_get_status(inlink) && i == nb_samples))
             if ((ret = push_frame(outlink)) < 0)
                 break;
-        outpicref = showwaves->outpicref;
     }
 
 end:
@@ -770,6 +814,7 @@ AVFilter ff_avf_showwaves = {
     .activate      = activate,
     .outputs       = showwaves_outputs,
     .priv_class    = &showwaves_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 #endif // CONFIG_SHOWWAVES_FILTER
@@ -21,6 +21,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
 #include "libavutil/buffer.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
@@ -33,6 +34,8 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavutil/trace.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -551,6 +554,18 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
         return 0;
     }else if(!strcmp(cmd, "enable")) {
         return set_enable_expr(filter, arg);
+    }else if(!strcmp(cmd, "profile")) {
+        AVBPrint buf;
+        size_t len;
+
+        if (!filter->graph || !filter->graph->profile || !res)
+            return AVERROR(EINVAL);
+        len = strlen(res);
+        if (len < res_len) {
+            av_bprint_init_for_buffer(&buf, res + len, res_len - len);
+            ff_filter_dump_profile(&buf, filter);
+        }
+        return 0;
     }else if(filter->filter->process_command) {
         return filter->filter->process_command(filter, cmd, arg, res, res_len, flags);
     }
@@ -609,8 +624,9 @@ static const AVClass *filter_child_class_next(const AVClass *prev)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -777,6 +793,7 @@ void avfilter_free(AVFilterContext *filter)
     av_expr_free(filter->enable);
     filter->enable = NULL;
     av_freep(&filter->var_values);
+    av_dict_free(&filter->internal->init_options);
     av_freep(&filter->internal);
     av_free(filter);
 }
@@ -889,14 +906,23 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
+    av_dict_free(&ctx->internal->init_options);
+    ret = ff_filter_save_options(ctx, &ctx->internal->init_options);
+    if (ret < 0)
+        return ret;
+
     if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
-        ctx->thread_type       = AVFILTER_THREAD_SLICE;
+        ctx->thread_type       = AVFILTER_THREAD_SLICE |
+                                 (ctx->thread_type & AVFILTER_THREAD_FRAME);
         ctx->internal->execute = ctx->graph->internal->thread_execute;
     } else {
-        ctx->thread_type = 0;
+        ctx->thread_type &= AVFILTER_THREAD_FRAME;
     }
+    if (!(ctx->graph->thread_type & AVFILTER_THREAD_FRAME) ||
+        !ctx->graph->internal->activate_filters)
+        ctx->thread_type &= ~AVFILTER_THREAD_FRAME;
 
     if (ctx->filter->priv_class) {
         ret = av_opt_set_dict2(ctx->priv, options, AV_OPT_SEARCH_CHILDREN);
@@ -904,6 +930,15 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
             av_log(ctx, AV_LOG_ERROR, "Error applying options to the filter.\n");
             return ret;
         }
+        ret = ff_filter_save_options(ctx->priv, &ctx->internal->init_options);
+        if (ret < 0)
+            return ret;
+    }
+    // the options left are passed on to init_dict
+    if (ctx->filter->init_dict && options) {
+        ret = av_dict_copy(&ctx->internal->init_options, *options, 0);
+        if (ret < 0)
+            return ret;
     }
 
     if (ctx->filter->init_opaque)
@@ -967,7 +1002,8 @@ int avfilter_init_str(AVFilterContext *filter, const char *args)
 
             deprecated = strchr(p, ':') != NULL;
 
-            if (!strcmp(filter->filter->name, "aevalsrc")) {
+            if (!strcmp(filter->filter->name, "aevalsrc") ||
+                !strcmp(filter->filter->name, "pp")) {
                 deprecated = 0;
                 while ((p = strchr(p, ':')) && p[1] != ':') {
                     const char *epos = strchr(p + 1, '=');
@@ -977,7 +1013,8 @@ int avfilter_init_str(AVFilterContext *filter, const char *args)
                         p++;
                         break;
                     }
-                    /* next token does not contain a '=', assume a channel expression */
+                    /* next token does not contain a '=', assume a channel
+                     * expression or a pp subfilter option */
                     deprecated = 1;
                     *p++ = '|';
                 }
@@ -1413,16 +1450,40 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
  */
 
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    int64_t start = 0, start_cpu = 0;
+    int profile = filter->graph && filter->graph->profile;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
+    if (profile) {
+        start     = av_gettime_relative();
+        start_cpu = thread_cpu_time();
+    }
+    av_trace_begin(filter->filter->name, AV_NOPTS_VALUE);
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    av_trace_end(filter->filter->name);
+    if (profile) {
+        filter->internal->nb_activations++;
+        filter->internal->activate_time     += av_gettime_relative() - start;
+        filter->internal->activate_cpu_time += thread_cpu_time() - start_cpu;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -332,6 +332,21 @@ typedef struct AVFilter {
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Run independent filters of a graph concurrently, so that the stages of a
+ * filter chain can work on different frames at the same time.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
+
+/**
+ * Run the threaded work of the graph on the pool of threads shared by the
+ * whole process instead of on threads private to the graph, which avoids
+ * oversubscribing the CPUs when many graphs or codecs run concurrently.
+ * AVFilterGraph.nb_threads then bounds the number of threads working on one
+ * execution.
+ */
+#define AVFILTER_THREAD_SHARED (1 << 2)
+
 typedef struct AVFilterInternal AVFilterInternal;
 
 /** An instance of a filter */
@@ -858,6 +873,10 @@ typedef struct AVFilterGraph {
      * bit AND with AVFilterContext.thread_type to get the final mask used for
      * determining allowed threading types. I.e. a threading type needs to be
      * set in both to be allowed.
+     *
+     * AVFILTER_THREAD_FRAME and AVFILTER_THREAD_SHARED are not enabled by
+     * default and must be set before the first filter is allocated in the
+     * graph.
      */
     int thread_type;
 
@@ -896,6 +915,40 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Comma-separated list of CPUs and ranges of CPUs, e.g. "0-7,16", the
+     * threads created for this graph are restricted to. May be set by the
+     * caller before adding any filters to the filtergraph. NULL (the default)
+     * leaves their affinity unchanged. Not used with AVFILTER_THREAD_SHARED.
+     */
+    char *thread_affinity;
+
+    /**
+     * NUMA node whose CPUs the threads created for this graph are restricted
+     * to, combined with thread_affinity. May be set by the caller before
+     * adding any filters to the filtergraph. -1 (the default) means no
+     * restriction. Not used with AVFILTER_THREAD_SHARED.
+     */
+    int numa_node;
+
+    /**
+     * If nonzero, the time spent activating each filter and the time frames
+     * wait on each link are accumulated. The statistics can be printed with
+     * avfilter_graph_dump() using the "profile" option, or queried with the
+     * "profile" command. Must be set by the caller before adding any filters
+     * to the filtergraph.
+     */
+    int profile;
+
+    /**
+     * If nonzero, audio frames are coalesced so that filters which do not
+     * choose a frame size themselves and buffersinks receive at least this
+     * many samples per frame, except at the end of the stream. This amortizes
+     * the per-frame cost of the graph when the source produces many small
+     * frames. Must be set by the caller before avfilter_graph_config().
+     */
+    int audio_min_samples;
+
     /**
      * Private fields
      *
@@ -985,6 +1038,57 @@ enum {
  */
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx);
 
+/**
+ * A configured filter graph recorded to create identical graphs quickly.
+ *
+ * A template holds the filters of a graph with the options they were
+ * initialized with, their links and the formats negotiated on these links,
+ * including the conversion filters inserted automatically. Graphs created
+ * from it skip the insertion of conversion filters and the choice of the
+ * formats, which are most of the cost of avfilter_graph_config() for large
+ * graphs, and start from a fresh state.
+ *
+ * The graph-level settings, e.g. the number of threads, are not recorded;
+ * they are taken from the graph the template is instantiated into. Neither
+ * are the parameters set with av_buffersrc_parameters_set(): they must be set
+ * again on the new graph, without changing the formats.
+ */
+typedef struct AVFilterGraphTemplate AVFilterGraphTemplate;
+
+/**
+ * Create a template from a graph configured with avfilter_graph_config().
+ *
+ * @param tmpl  pointer set to the new template, to be freed with
+ *              avfilter_graph_template_free()
+ * @param graph the configured graph; it is not modified and can still be used
+ * @return >= 0 in case of success, a negative AVERROR code otherwise
+ */
+int avfilter_graph_template_create(AVFilterGraphTemplate **tmpl,
+                                   const AVFilterGraph *graph);
+
+/**
+ * Add the filters and links of a template to an empty graph. The links get
+ * the formats recorded in the template. avfilter_graph_config() still lets
+ * the filters query their supported formats, but fails instead of inserting
+ * conversion filters, and uses the recorded formats instead of choosing new
+ * ones. The filters keep their names, so avfilter_graph_get_filter() finds
+ * the sources and sinks of the graph.
+ *
+ * No filters must be added to the graph afterwards.
+ *
+ * @param tmpl  the template
+ * @param graph an empty graph
+ * @return >= 0 in case of success, a negative AVERROR code otherwise
+ */
+int avfilter_graph_template_instantiate(const AVFilterGraphTemplate *tmpl,
+                                        AVFilterGraph *graph);
+
+/**
+ * Free a template and set *tmpl to NULL.
+ * If *tmpl is NULL, do nothing.
+ */
+void avfilter_graph_template_free(AVFilterGraphTemplate **tmpl);
+
 /**
  * Free a graph, destroy its links, and set *graph to NULL.
  * If *graph is NULL, do nothing.
@@ -1135,7 +1239,9 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  * Dump a graph into a human-readable string representation.
  *
  * @param graph    the graph to dump
- * @param options  formatting options; currently ignored
+ * @param options  formatting options; "profile" prints the statistics
+ *                 collected with AVFilterGraph.profile instead of the
+ *                 graph layout, other values are currently ignored
  * @return  a string, or NULL in case of memory allocation failure;
  *          the string must be freed using av_free
  */
@@ -50,8 +50,18 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
+        { "shared", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SHARED }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
+    { "thread_affinity", "List of CPUs the threads may run on", OFFSET(thread_affinity),
+        AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, F|V|A },
+    { "numa_node",   "Restrict the threads to the CPUs of a NUMA node", OFFSET(numa_node),
+        AV_OPT_TYPE_INT,   { .i64 = -1 }, -1, INT_MAX, F|V|A },
+    { "profile",     "Collect per-filter and per-link timing statistics", OFFSET(profile),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
+    { "audio_min_samples", "Coalesce audio frames to at least this many samples", OFFSET(audio_min_samples),
+        AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -80,6 +90,10 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 }
 #endif
 
+/* number of shared frame pools kept warm after no link uses them anymore,
+ * e.g. across a resolution change and back */
+#define MAX_UNUSED_FRAME_POOLS 4
+
 AVFilterGraph *avfilter_graph_alloc(void)
 {
     AVFilterGraph *ret = av_mallocz(sizeof(*ret));
@@ -92,6 +106,13 @@ AVFilterGraph *avfilter_graph_alloc(void)
         return NULL;
     }
 
+    ret->internal->frame_pools = ff_frame_pool_set_alloc(MAX_UNUSED_FRAME_POOLS);
+    if (!ret->internal->frame_pools) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
@@ -131,10 +152,12 @@ void avfilter_graph_free(AVFilterGraph **graph)
 
     av_freep(&(*graph)->scale_sws_opts);
     av_freep(&(*graph)->aresample_swr_opts);
+    av_freep(&(*graph)->thread_affinity);
 #if FF_API_LAVR_OPTS
     av_freep(&(*graph)->resample_lavr_opts);
 #endif
     av_freep(&(*graph)->filters);
+    ff_frame_pool_set_free(&(*graph)->internal->frame_pools);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -199,6 +222,7 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
     graph->filters[graph->nb_filters++] = s;
 
     s->graph = graph;
+    graph->internal->frame_queues.profile = graph->profile;
 
     return s;
 }
@@ -266,6 +290,36 @@ static int graph_config_links(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+/**
+ * Apply AVFilterGraph.audio_min_samples to the audio links whose frame size
+ * is not chosen by their destination. Only filters using the legacy
+ * filter_frame() callback, which ff_filter_activate_default() feeds with
+ * ff_inlink_consume_samples(), and sinks, which read the link frame size,
+ * honor it; other filters with an activate() callback consume the frames as
+ * they were queued.
+ */
+static void graph_config_audio_batching(AVFilterGraph *graph)
+{
+    unsigned i, j;
+
+    if (!graph->audio_min_samples)
+        return;
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (filter->filter->activate && filter->nb_outputs)
+            continue;
+        for (j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *link = filter->inputs[j];
+
+            if (link->type != AVMEDIA_TYPE_AUDIO || link->min_samples)
+                continue;
+            link->min_samples = graph->audio_min_samples;
+            link->max_samples = INT_MAX;
+        }
+    }
+}
+
 static int graph_check_links(AVFilterGraph *graph, AVClass *log_ctx)
 {
     AVFilterContext *f;
@@ -529,6 +583,13 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                            link->src->name, link->dst->name);
                     return AVERROR(EINVAL);
                 }
+                if (graph->internal->formats_preset) {
+                    av_log(log_ctx, AV_LOG_ERROR,
+                           "The filters '%s' and '%s' do not have a common format, "
+                           "the graph does not match its template.\n",
+                           link->src->name, link->dst->name);
+                    return AVERROR(EINVAL);
+                }
 
                 /* couldn't merge format lists. auto-insert conversion filter */
                 switch (link->type) {
@@ -1266,18 +1327,98 @@ static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+static int formats_contain(const AVFilterFormats *formats, int fmt)
+{
+    unsigned i;
+
+    for (i = 0; i < formats->nb_formats; i++)
+        if (formats->formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static int preset_format_supported(AVFilterLink *link)
+{
+    AVFilterChannelLayouts *layouts = link->in_channel_layouts;
+    int i;
+
+    if (!link->in_formats || !formats_contain(link->in_formats, link->format))
+        return 0;
+    if (link->type != AVMEDIA_TYPE_AUDIO)
+        return 1;
+
+    if (link->in_samplerates && link->in_samplerates->nb_formats &&
+        !formats_contain(link->in_samplerates, link->sample_rate))
+        return 0;
+    if (!layouts || layouts->all_layouts)
+        return 1;
+    for (i = 0; i < layouts->nb_channel_layouts; i++)
+        if (layouts->channel_layouts[i] == link->channel_layout ||
+            layouts->channel_layouts[i] == FF_COUNT2LAYOUT(link->channels))
+            return 1;
+    return 0;
+}
+
+/**
+ * Configure the formats of a graph instantiated from a template: the
+ * filters still get to query their formats, since some of them set up
+ * their state there, but the formats recorded in the template are used
+ * instead of negotiating new ones.
+ */
+static int graph_config_preset_formats(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    unsigned i, j;
+    int ret;
+
+    while ((ret = query_formats(graph, log_ctx)) == AVERROR(EAGAIN))
+        av_log(graph, AV_LOG_DEBUG, "query_formats not finished\n");
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        for (j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *link = filter->inputs[j];
+
+            if (!preset_format_supported(link)) {
+                av_log(log_ctx, AV_LOG_ERROR, "The format of the link "
+                       "between '%s' and '%s' is no longer supported, "
+                       "the graph does not match its template.\n",
+                       link->src->name, link->dst->name);
+                return AVERROR(EINVAL);
+            }
+
+            ff_formats_unref(&link->in_formats);
+            ff_formats_unref(&link->out_formats);
+            ff_formats_unref(&link->in_samplerates);
+            ff_formats_unref(&link->out_samplerates);
+            ff_channel_layouts_unref(&link->in_channel_layouts);
+            ff_channel_layouts_unref(&link->out_channel_layouts);
+        }
+    }
+
+    return 0;
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
 
     if ((ret = graph_check_validity(graphctx, log_ctx)))
         return ret;
-    if ((ret = graph_insert_fifos(graphctx, log_ctx)) < 0)
-        return ret;
-    if ((ret = graph_config_formats(graphctx, log_ctx)))
+    /* a graph instantiated from a template has its fifos and formats already */
+    if (!graphctx->internal->formats_preset) {
+        if ((ret = graph_insert_fifos(graphctx, log_ctx)) < 0)
+            return ret;
+        if ((ret = graph_config_formats(graphctx, log_ctx)))
+            return ret;
+    } else if ((ret = graph_config_preset_formats(graphctx, log_ctx)) < 0) {
         return ret;
+    }
     if ((ret = graph_config_links(graphctx, log_ctx)))
         return ret;
+    graph_config_audio_batching(graphctx);
     if ((ret = graph_check_links(graphctx, log_ctx)))
         return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
@@ -1441,10 +1582,47 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+#define MAX_FRAME_BATCH 16
+
+static AVFilterContext *link_peer(AVFilterContext *f, unsigned i)
+{
+    return i < f->nb_inputs ? f->inputs[i]->src : f->outputs[i - f->nb_inputs]->dst;
+}
+
+/**
+ * Check whether two filters may touch the same state when activated:
+ * activating a filter modifies its links and the readiness of its
+ * neighbours, so the filters must be neither linked nor share a neighbour.
+ */
+static int filters_interfere(AVFilterContext *a, AVFilterContext *b)
+{
+    unsigned i, j;
+
+    if (a == b)
+        return 1;
+    for (i = 0; i < a->nb_inputs + a->nb_outputs; i++) {
+        AVFilterContext *peer = link_peer(a, i);
+        if (peer == b)
+            return 1;
+        for (j = 0; j < b->nb_inputs + b->nb_outputs; j++)
+            if (link_peer(b, j) == peer)
+                return 1;
+    }
+    return 0;
+}
+
+static int can_batch(AVFilterContext *filter)
+{
+    /* Sinks update the graph-wide heap of sink links. */
+    return filter->thread_type & AVFILTER_THREAD_FRAME && filter->nb_outputs;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
+    AVFilterContext *batch[MAX_FRAME_BATCH];
     AVFilterContext *filter;
     unsigned i;
+    int j, nb_batch, max_batch;
 
     av_assert0(graph->nb_filters);
     filter = graph->filters[0];
@@ -1453,5 +1631,30 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(filter);
+
+    max_batch = FFMIN(graph->nb_threads, MAX_FRAME_BATCH);
+    if (!graph->internal->activate_filters || max_batch < 2 || !can_batch(filter))
+        return ff_filter_activate(filter);
+
+    batch[0] = filter;
+    for (nb_batch = 1; nb_batch < max_batch; nb_batch++) {
+        AVFilterContext *next = NULL;
+        for (i = 0; i < graph->nb_filters; i++) {
+            AVFilterContext *f = graph->filters[i];
+            if (!f->ready || !can_batch(f) || (next && f->ready <= next->ready))
+                continue;
+            for (j = 0; j < nb_batch; j++)
+                if (filters_interfere(f, batch[j]))
+                    break;
+            if (j == nb_batch)
+                next = f;
+        }
+        if (!next)
+            break;
+        batch[nb_batch] = next;
+    }
+
+    if (nb_batch == 1)
+        return ff_filter_activate(filter);
+    return graph->internal->activate_filters(graph, batch, nb_batch);
 }
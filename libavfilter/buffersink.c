@@ -81,7 +81,8 @@ static int return_or_keep_frame(BufferSinkContext *buf, AVFrame *out, AVFrame *i
     }
 }
 
-static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, int samples)
+static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags,
+                              int samples, int max_samples)
 {
     BufferSinkContext *buf = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
@@ -93,7 +94,7 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
         return return_or_keep_frame(buf, frame, buf->peeked_frame, flags);
 
     while (1) {
-        ret = samples ? ff_inlink_consume_samples(inlink, samples, samples, &cur_frame) :
+        ret = samples ? ff_inlink_consume_samples(inlink, samples, max_samples, &cur_frame) :
                         ff_inlink_consume_frame(inlink, &cur_frame);
         if (ret < 0) {
             return ret;
@@ -116,13 +117,15 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
 
 int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
-    return get_frame_internal(ctx, frame, flags, ctx->inputs[0]->min_samples);
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    return get_frame_internal(ctx, frame, flags, inlink->min_samples, inlink->max_samples);
 }
 
 int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
                                                   AVFrame *frame, int nb_samples)
 {
-    return get_frame_internal(ctx, frame, 0, nb_samples);
+    return get_frame_internal(ctx, frame, 0, nb_samples, nb_samples);
 }
 
 #if FF_API_NEXT
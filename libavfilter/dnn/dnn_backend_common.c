@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * DNN functions shared by the backends.
+ */
+
+#include <stdatomic.h>
+
+#include "config.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "dnn_backend_common.h"
+
+typedef struct DNNAsyncExecution {
+    DNNModel *model;
+    DNNExecuteFunc execute;
+    DNNData *outputs;
+    uint32_t nb_output;
+    DNNReturnType result;
+    int pending;
+#if HAVE_PTHREADS
+    pthread_t thread;
+    atomic_int done;
+#endif
+} DNNAsyncExecution;
+
+static void *execute_thread(void *arg)
+{
+    DNNAsyncExecution *exec = arg;
+
+    exec->result = exec->execute(exec->model, exec->outputs, exec->nb_output);
+#if HAVE_PTHREADS
+    atomic_store_explicit(&exec->done, 1, memory_order_release);
+#endif
+    return NULL;
+}
+
+DNNReturnType ff_dnn_execute_model_async_common(DNNModel *model, DNNExecuteFunc execute,
+                                                DNNData *outputs, uint32_t nb_output)
+{
+    DNNAsyncExecution *exec = model->async;
+
+    if (!exec) {
+        exec = av_mallocz(sizeof(*exec));
+        if (!exec)
+            return DNN_ERROR;
+        model->async = exec;
+    }
+    if (exec->pending)
+        return DNN_ERROR;
+
+    exec->model     = model;
+    exec->execute   = execute;
+    exec->outputs   = outputs;
+    exec->nb_output = nb_output;
+    exec->pending   = 1;
+
+#if HAVE_PTHREADS
+    atomic_init(&exec->done, 0);
+    if (!pthread_create(&exec->thread, NULL, execute_thread, exec))
+        return DNN_SUCCESS;
+    exec->pending = 0;
+    return DNN_ERROR;
+#else
+    execute_thread(exec);
+    return DNN_SUCCESS;
+#endif
+}
+
+DNNAsyncStatusType ff_dnn_get_async_result_common(DNNModel *model, int wait)
+{
+    DNNAsyncExecution *exec = model->async;
+
+    if (!exec || !exec->pending)
+        return DAST_EMPTY_QUEUE;
+
+#if HAVE_PTHREADS
+    if (!wait && !atomic_load_explicit(&exec->done, memory_order_acquire))
+        return DAST_NOT_READY;
+    pthread_join(exec->thread, NULL);
+#endif
+    exec->pending = 0;
+
+    return exec->result == DNN_SUCCESS ? DAST_SUCCESS : DAST_FAIL;
+}
+
+void ff_dnn_async_uninit(DNNModel *model)
+{
+    ff_dnn_get_async_result_common(model, 1);
+    av_freep(&model->async);
+}
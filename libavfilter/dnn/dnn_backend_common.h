@@ -0,0 +1,46 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * DNN functions shared by the backends.
+ */
+
+#ifndef AVFILTER_DNN_DNN_BACKEND_COMMON_H
+#define AVFILTER_DNN_DNN_BACKEND_COMMON_H
+
+#include "../dnn_interface.h"
+
+typedef DNNReturnType (*DNNExecuteFunc)(const DNNModel *model, DNNData *outputs, uint32_t nb_output);
+
+/**
+ * Run execute on a background thread, or at once if threads are not
+ * available, and keep the result in model->async.
+ */
+DNNReturnType ff_dnn_execute_model_async_common(DNNModel *model, DNNExecuteFunc execute,
+                                                DNNData *outputs, uint32_t nb_output);
+
+DNNAsyncStatusType ff_dnn_get_async_result_common(DNNModel *model, int wait);
+
+/**
+ * Wait for the pending execution if any and free model->async,
+ * to be called before the model is freed.
+ */
+void ff_dnn_async_uninit(DNNModel *model);
+
+#endif
@@ -25,6 +25,7 @@
 
 #include "dnn_backend_native.h"
 #include "libavutil/avassert.h"
+#include "dnn_backend_common.h"
 #include "dnn_backend_native_layer_conv2d.h"
 #include "dnn_backend_native_layers.h"
 
@@ -42,6 +43,8 @@ static DNNReturnType get_input_native(void *model, DNNData *input, const char *i
             input->height = oprd->dims[1];
             input->width = oprd->dims[2];
             input->channels = oprd->dims[3];
+            // all the layers process any number of frames
+            input->batch_size = -1;
             return DNN_SUCCESS;
         }
     }
@@ -72,7 +75,7 @@ static DNNReturnType set_input_output_native(void *model, DNNData *input, const
     if (!oprd)
         return DNN_ERROR;
 
-    oprd->dims[0] = 1;
+    oprd->dims[0] = FFMAX(input->batch_size, 1);
     oprd->dims[1] = input->height;
     oprd->dims[2] = input->width;
     oprd->dims[3] = input->channels;
@@ -126,7 +129,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
     int32_t layer;
     DNNLayerType layer_type;
 
-    model = av_malloc(sizeof(DNNModel));
+    model = av_mallocz(sizeof(DNNModel));
     if (!model){
         return NULL;
     }
@@ -286,11 +289,17 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *output
         outputs[i].width = oprd->dims[2];
         outputs[i].channels = oprd->dims[3];
         outputs[i].dt = oprd->data_type;
+        outputs[i].batch_size = oprd->dims[0];
     }
 
     return DNN_SUCCESS;
 }
 
+DNNReturnType ff_dnn_execute_model_async_native(DNNModel *model, DNNData *outputs, uint32_t nb_output)
+{
+    return ff_dnn_execute_model_async_common(model, ff_dnn_execute_model_native, outputs, nb_output);
+}
+
 int32_t calculate_operand_dims_count(const DnnOperand *oprd)
 {
     int32_t result = 1;
@@ -314,6 +323,7 @@ void ff_dnn_free_model_native(DNNModel **model)
 
     if (*model)
     {
+        ff_dnn_async_uninit(*model);
         network = (ConvolutionalNetwork *)(*model)->model;
         for (layer = 0; layer < network->layers_num; ++layer){
             if (network->layers[layer].type == DLT_CONV2D){
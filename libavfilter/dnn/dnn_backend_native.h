@@ -116,6 +116,8 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename);
 
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, DNNData *outputs, uint32_t nb_output);
 
+DNNReturnType ff_dnn_execute_model_async_native(DNNModel *model, DNNData *outputs, uint32_t nb_output);
+
 void ff_dnn_free_model_native(DNNModel **model);
 
 int32_t calculate_operand_data_length(const DnnOperand *oprd);
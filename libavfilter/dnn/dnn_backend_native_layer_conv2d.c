@@ -19,6 +19,9 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/float_dsp.h"
+#include "libavutil/thread.h"
 #include "dnn_backend_native_layer_conv2d.h"
 
 #define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
@@ -83,6 +86,120 @@ int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int fil
     return dnn_size;
 }
 
+static av_always_inline float activate(DNNActivationFunc activation, float v)
+{
+    switch (activation) {
+    case RELU:
+        return FFMAX(v, 0.0);
+    case TANH:
+        return 2.0f  / (1.0f + exp(-2.0f * v)) - 1.0f;
+    case SIGMOID:
+        return 1.0f / (1.0f + exp(-v));
+    case LEAKY_RELU:
+        return FFMAX(v, 0.0) + 0.2 * FFMIN(v, 0.0);
+    case NONE:
+    default:
+        return v;
+    }
+}
+
+typedef struct Conv2dThreadData {
+    const ConvolutionalParams *conv_params;
+    AVFloatDSPContext *fdsp;
+    const float *input;
+    float *output;
+    /**
+     * the kernel reordered as [kernel_y][kernel_x][ch][n_filter], with the
+     * filters padded with zeros to aligned_num, so that each input pel is
+     * multiplied with all the filters in one vector_fmac_scalar() call
+     */
+    const float *kernel;
+    int aligned_num;
+    int height, width, pad_size;
+    // number of output rows of each frame of the batch
+    int nb_rows;
+} Conv2dThreadData;
+
+typedef struct Conv2dThread {
+    const Conv2dThreadData *td;
+    float *acc;
+    // output rows, counted across all the frames of the batch
+    int row_start, row_end;
+#if HAVE_PTHREADS
+    pthread_t thread;
+#endif
+} Conv2dThread;
+
+static void conv2d_rows(const Conv2dThreadData *td, float *acc, int row_start, int row_end)
+{
+    const ConvolutionalParams *conv_params = td->conv_params;
+    const int input_num   = conv_params->input_num;
+    const int output_num  = conv_params->output_num;
+    const int kernel_size = conv_params->kernel_size;
+    const int dilation    = conv_params->dilation;
+    const int radius = kernel_size >> 1;
+    const int height = td->height;
+    const int width  = td->width;
+    const int src_linesize = width * input_num;
+    const int tap_size = input_num * td->aligned_num;
+    float *output = td->output + row_start * (width - td->pad_size * 2) * output_num;
+
+    for (int row = row_start; row < row_end; ++row) {
+        const float *input = td->input + row / td->nb_rows * height * src_linesize;
+        int y = td->pad_size + row % td->nb_rows;
+
+        for (int x = td->pad_size; x < width - td->pad_size; ++x) {
+            if (conv_params->has_bias)
+                memcpy(acc, conv_params->biases, output_num * sizeof(*acc));
+            else
+                memset(acc, 0, output_num * sizeof(*acc));
+
+            for (int kernel_y = 0; kernel_y < kernel_size; ++kernel_y) {
+                int y_pos = y + (kernel_y - radius) * dilation;
+                if (conv_params->padding_method == SAME_CLAMP_TO_EDGE)
+                    y_pos = CLAMP_TO_EDGE(y_pos, height);
+                else if (y_pos < 0 || y_pos >= height)
+                    continue; // zero padding, no contribution
+
+                for (int kernel_x = 0; kernel_x < kernel_size; ++kernel_x) {
+                    const float *kernel = td->kernel + (kernel_y * kernel_size + kernel_x) * tap_size;
+                    const float *src;
+                    int x_pos = x + (kernel_x - radius) * dilation;
+                    if (conv_params->padding_method == SAME_CLAMP_TO_EDGE)
+                        x_pos = CLAMP_TO_EDGE(x_pos, width);
+                    else if (x_pos < 0 || x_pos >= width)
+                        continue;
+
+                    src = input + y_pos * src_linesize + x_pos * input_num;
+                    if (output_num < 16) {
+                        // not worth padding the few filters to a vector
+                        for (int ch = 0; ch < input_num; ++ch)
+                            for (int n_filter = 0; n_filter < output_num; ++n_filter)
+                                acc[n_filter] += src[ch] * kernel[ch * td->aligned_num + n_filter];
+                    } else {
+                        for (int ch = 0; ch < input_num; ++ch)
+                            td->fdsp->vector_fmac_scalar(acc, kernel + ch * td->aligned_num,
+                                                         src[ch], td->aligned_num);
+                    }
+                }
+            }
+
+            for (int n_filter = 0; n_filter < output_num; ++n_filter)
+                output[n_filter] = activate(conv_params->activation, acc[n_filter]);
+            output += output_num;
+        }
+    }
+}
+
+#if HAVE_PTHREADS
+static void *conv2d_thread(void *arg)
+{
+    Conv2dThread *thread = arg;
+    conv2d_rows(thread->td, thread->acc, thread->row_start, thread->row_end);
+    return NULL;
+}
+#endif
+
 int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters)
 {
@@ -95,11 +212,15 @@ int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_
     const float *input = operands[input_operand_index].data;
     const ConvolutionalParams *conv_params = (const ConvolutionalParams *)parameters;
 
-    int radius = conv_params->kernel_size >> 1;
-    int src_linesize = width * conv_params->input_num;
     int filter_linesize = conv_params->kernel_size * conv_params->input_num;
     int filter_size = conv_params->kernel_size * filter_linesize;
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
+    int aligned_num = FFALIGN(conv_params->output_num, 16);
+    int nb_rows = height - pad_size * 2;
+    int nb_threads, ret = -1;
+    Conv2dThreadData td;
+    Conv2dThread *threads = NULL;
+    float *kernel = NULL, *acc = NULL;
 
     DnnOperand *output_operand = &operands[output_operand_index];
     output_operand->dims[0] = number;
@@ -115,53 +236,60 @@ int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_
 
     av_assert0(channel == conv_params->input_num);
 
-    for (int y = pad_size; y < height - pad_size; ++y) {
-        for (int x = pad_size; x < width - pad_size; ++x) {
-            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
-                if (conv_params->has_bias)
-                    output[n_filter] = conv_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
-
-                for (int ch = 0; ch < conv_params->input_num; ++ch) {
-                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
-                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
-                            float input_pel;
-                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
-                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
-                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
-                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            } else {
-                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
-                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
-                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
-                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            }
-
-
-                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                                kernel_x * conv_params->input_num + ch];
-                        }
-                    }
-                }
-                switch (conv_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
-                }
-            }
-            output += conv_params->output_num;
-        }
+    if (number <= 0 || nb_rows <= 0 || width - pad_size * 2 <= 0)
+        return 0;
+
+    nb_threads = FFMIN(av_cpu_count(), number * nb_rows);
+    td.fdsp    = avpriv_float_dsp_alloc(0);
+    kernel     = av_mallocz_array(conv_params->kernel_size * filter_linesize, aligned_num * sizeof(*kernel));
+    acc        = av_mallocz_array(nb_threads, aligned_num * sizeof(*acc));
+    threads    = av_mallocz_array(nb_threads, sizeof(*threads));
+    if (!td.fdsp || !kernel || !acc || !threads)
+        goto end;
+
+    for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter)
+        for (int i = 0; i < filter_size; ++i)
+            kernel[i * aligned_num + n_filter] = conv_params->kernel[n_filter * filter_size + i];
+
+    td.conv_params = conv_params;
+    td.input       = input;
+    td.output      = output;
+    td.kernel      = kernel;
+    td.aligned_num = aligned_num;
+    td.height      = height;
+    td.width       = width;
+    td.pad_size    = pad_size;
+    td.nb_rows     = nb_rows;
+
+    for (int i = 0; i < nb_threads; i++) {
+        threads[i].td      = &td;
+        threads[i].acc     = acc + i * aligned_num;
+        threads[i].row_start = number * nb_rows *  i      / nb_threads;
+        threads[i].row_end   = number * nb_rows * (i + 1) / nb_threads;
+    }
+
+#if HAVE_PTHREADS
+    // the last slice is done on the calling thread, as are the slices of
+    // the threads which could not be created
+    for (int i = 0; i < nb_threads - 1; i++)
+        if (pthread_create(&threads[i].thread, NULL, conv2d_thread, &threads[i]))
+            threads[i].td = NULL;
+    conv2d_thread(&threads[nb_threads - 1]);
+    for (int i = 0; i < nb_threads - 1; i++) {
+        if (threads[i].td)
+            pthread_join(threads[i].thread, NULL);
+        else
+            conv2d_rows(&td, threads[i].acc, threads[i].row_start, threads[i].row_end);
     }
-    return 0;
+#else
+    conv2d_rows(&td, acc, 0, number * nb_rows);
+#endif
+    ret = 0;
+
+end:
+    av_freep(&td.fdsp);
+    av_freep(&kernel);
+    av_freep(&acc);
+    av_freep(&threads);
+    return ret;
 }
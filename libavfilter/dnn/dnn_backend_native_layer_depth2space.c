@@ -58,7 +58,7 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
     int channels = operands[input_operand_index].dims[3];
     const float *input = operands[input_operand_index].data;
 
-    int y, x, by, bx, ch;
+    int n, y, x, by, bx, ch;
     int new_channels = channels / (block_size * block_size);
     int output_linesize = width * channels;
     int by_linesize = output_linesize / block_size;
@@ -76,18 +76,20 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
         return -1;
     output = output_operand->data;
 
-    for (y = 0; y < height; ++y){
-        for (x = 0; x < width; ++x){
-            for (by = 0; by < block_size; ++by){
-                for (bx = 0; bx < block_size; ++bx){
-                    for (ch = 0; ch < new_channels; ++ch){
-                        output[by * by_linesize + x * x_linesize + bx * new_channels + ch] = input[ch];
+    for (n = 0; n < number; ++n){
+        for (y = 0; y < height; ++y){
+            for (x = 0; x < width; ++x){
+                for (by = 0; by < block_size; ++by){
+                    for (bx = 0; bx < block_size; ++bx){
+                        for (ch = 0; ch < new_channels; ++ch){
+                            output[by * by_linesize + x * x_linesize + bx * new_channels + ch] = input[ch];
+                        }
+                        input += new_channels;
                     }
-                    input += new_channels;
                 }
             }
+            output += output_linesize;
         }
-        output += output_linesize;
     }
     return 0;
 }
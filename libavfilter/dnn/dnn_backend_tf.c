@@ -24,6 +24,7 @@
  */
 
 #include "dnn_backend_tf.h"
+#include "dnn_backend_common.h"
 #include "dnn_backend_native.h"
 #include "dnn_backend_native_layer_conv2d.h"
 #include "dnn_backend_native_layer_depth2space.h"
@@ -87,7 +88,7 @@ static TF_Tensor *allocate_input_tensor(const DNNData *input)
 {
     TF_DataType dt;
     size_t size;
-    int64_t input_dims[] = {1, input->height, input->width, input->channels};
+    int64_t input_dims[] = {FFMAX(input->batch_size, 1), input->height, input->width, input->channels};
     switch (input->dt) {
     case DNN_FLOAT:
         dt = TF_FLOAT;
@@ -102,7 +103,7 @@ static TF_Tensor *allocate_input_tensor(const DNNData *input)
     }
 
     return TF_AllocateTensor(dt, input_dims, 4,
-                             input_dims[1] * input_dims[2] * input_dims[3] * size);
+                             input_dims[0] * input_dims[1] * input_dims[2] * input_dims[3] * size);
 }
 
 static DNNReturnType get_input_tf(void *model, DNNData *input, const char *input_name)
@@ -128,7 +129,7 @@ static DNNReturnType get_input_tf(void *model, DNNData *input, const char *input
     TF_DeleteStatus(status);
 
     // currently only NHWC is supported
-    av_assert0(dims[0] == 1);
+    input->batch_size = dims[0];
     input->height = dims[1];
     input->width = dims[2];
     input->channels = dims[3];
@@ -577,7 +578,7 @@ DNNModel *ff_dnn_load_model_tf(const char *model_filename)
     DNNModel *model = NULL;
     TFModel *tf_model = NULL;
 
-    model = av_malloc(sizeof(DNNModel));
+    model = av_mallocz(sizeof(DNNModel));
     if (!model){
         return NULL;
     }
@@ -636,16 +637,23 @@ DNNReturnType ff_dnn_execute_model_tf(const DNNModel *model, DNNData *outputs, u
         outputs[i].channels = TF_Dim(tf_model->output_tensors[i], 3);
         outputs[i].data = TF_TensorData(tf_model->output_tensors[i]);
         outputs[i].dt = TF_TensorType(tf_model->output_tensors[i]);
+        outputs[i].batch_size = TF_Dim(tf_model->output_tensors[i], 0);
     }
 
     return DNN_SUCCESS;
 }
 
+DNNReturnType ff_dnn_execute_model_async_tf(DNNModel *model, DNNData *outputs, uint32_t nb_output)
+{
+    return ff_dnn_execute_model_async_common(model, ff_dnn_execute_model_tf, outputs, nb_output);
+}
+
 void ff_dnn_free_model_tf(DNNModel **model)
 {
     TFModel *tf_model;
 
     if (*model){
+        ff_dnn_async_uninit(*model);
         tf_model = (TFModel *)(*model)->model;
         if (tf_model->graph){
             TF_DeleteGraph(tf_model->graph);
@@ -24,6 +24,7 @@
  */
 
 #include "../dnn_interface.h"
+#include "dnn_backend_common.h"
 #include "dnn_backend_native.h"
 #include "dnn_backend_tf.h"
 #include "libavutil/mem.h"
@@ -41,12 +42,16 @@ DNNModule *ff_get_dnn_module(DNNBackendType backend_type)
     case DNN_NATIVE:
         dnn_module->load_model = &ff_dnn_load_model_native;
         dnn_module->execute_model = &ff_dnn_execute_model_native;
+        dnn_module->execute_model_async = &ff_dnn_execute_model_async_native;
+        dnn_module->get_async_result = &ff_dnn_get_async_result_common;
         dnn_module->free_model = &ff_dnn_free_model_native;
         break;
     case DNN_TF:
     #if (CONFIG_LIBTENSORFLOW == 1)
         dnn_module->load_model = &ff_dnn_load_model_tf;
         dnn_module->execute_model = &ff_dnn_execute_model_tf;
+        dnn_module->execute_model_async = &ff_dnn_execute_model_async_tf;
+        dnn_module->get_async_result = &ff_dnn_get_async_result_common;
         dnn_module->free_model = &ff_dnn_free_model_tf;
     #else
         av_freep(&dnn_module);
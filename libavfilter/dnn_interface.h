@@ -34,10 +34,15 @@ typedef enum {DNN_NATIVE, DNN_TF} DNNBackendType;
 
 typedef enum {DNN_FLOAT = 1, DNN_UINT8 = 4} DNNDataType;
 
+typedef enum {DAST_FAIL, DAST_EMPTY_QUEUE, DAST_NOT_READY, DAST_SUCCESS} DNNAsyncStatusType;
+
 typedef struct DNNData{
     void *data;
     DNNDataType dt;
     int width, height, channels;
+    // Number of frames stored one after another in data, 0 means 1.
+    // For the model input returned by get_input, -1 means any number.
+    int batch_size;
 } DNNData;
 
 typedef struct DNNModel{
@@ -49,6 +54,9 @@ typedef struct DNNModel{
     // Sets model input and output.
     // Should be called at least once before model execution.
     DNNReturnType (*set_input_output)(void *model, DNNData *input, const char *input_name, const char **output_names, uint32_t nb_output);
+    // Execution started by DNNModule.execute_model_async and not retrieved yet,
+    // private to the DNN module.
+    void *async;
 } DNNModel;
 
 // Stores pointers to functions for loading, executing, freeing DNN models for one of the backends.
@@ -57,6 +65,13 @@ typedef struct DNNModule{
     DNNModel *(*load_model)(const char *model_filename);
     // Executes model with specified input and output. Returns DNN_ERROR otherwise.
     DNNReturnType (*execute_model)(const DNNModel *model, DNNData *outputs, uint32_t nb_output);
+    // Starts executing model on a background thread and returns immediately, the outputs
+    // are filled once get_async_result returns DAST_SUCCESS. Only one execution can be
+    // pending, and the input must not be changed until its result is retrieved.
+    DNNReturnType (*execute_model_async)(DNNModel *model, DNNData *outputs, uint32_t nb_output);
+    // Retrieves the result of the pending execution, waiting for its end if wait is set.
+    // Returns DAST_NOT_READY if it is still running, DAST_EMPTY_QUEUE if there is none.
+    DNNAsyncStatusType (*get_async_result)(DNNModel *model, int wait);
     // Frees memory allocated for model.
     void (*free_model)(DNNModel **model);
 } DNNModule;
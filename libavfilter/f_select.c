@@ -154,6 +154,12 @@ typedef struct SelectContext {
     ff_scene_sad_fn sad;            ///< Sum of the absolute difference function (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
     AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    int scene_scale;                ///< downscaling factor of the frames        (scene detect only)
+    int pixel_step;                 ///< number of samples per pixel in the SAD planes
+    ptrdiff_t scaled_width[4];      ///< width in samples of the downscaled planes
+    ptrdiff_t scaled_height[4];     ///< height of the downscaled planes
+    uint8_t *scaled[2];             ///< downscaled current and previous frames
+    int prev_w, prev_h;             ///< dimensions of the previous downscaled frame, 0 if none
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
@@ -166,6 +172,7 @@ static const AVOption filt_name##_options[] = {                     \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
     { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
+    { "scene_scale", "set the downscaling factor of the frames for scene detection", OFFSET(scene_scale), AV_OPT_TYPE_INT, {.i64 = 1}, 1, 16, .flags=FLAGS }, \
     { NULL }                                                            \
 }
 
@@ -266,16 +273,126 @@ static int config_input(AVFilterLink *inlink)
         select->sad = ff_scene_sad_get_fn(select->bitdepth == 8 ? 8 : 16);
         if (!select->sad)
             return AVERROR(EINVAL);
+
+        if (select->scene_scale > 1) {
+            const int scale = select->scene_scale;
+            size_t size = 0;
+
+            select->pixel_step = desc->comp[0].step >> (select->bitdepth > 8);
+            for (int plane = 0; plane < select->nb_planes; plane++) {
+                int w = select->width[plane] / select->pixel_step;
+
+                select->scaled_width[plane]  = FFMAX(w / scale, 1) * select->pixel_step;
+                select->scaled_height[plane] = FFMAX(select->height[plane] / scale, 1);
+                size += select->scaled_width[plane] * select->scaled_height[plane];
+            }
+            size <<= select->bitdepth > 8;
+
+            av_freep(&select->scaled[0]);
+            av_freep(&select->scaled[1]);
+            select->scaled[0] = av_malloc(size);
+            select->scaled[1] = av_malloc(size);
+            if (!select->scaled[0] || !select->scaled[1])
+                return AVERROR(ENOMEM);
+            select->prev_w = select->prev_h = 0;
+        }
     }
     return 0;
 }
 
+#define DEFINE_DOWNSCALE(type, name)                                            \
+static void downscale_##name(const uint8_t *ssrc, ptrdiff_t linesize,          \
+                             uint8_t *ddst, ptrdiff_t dst_w, ptrdiff_t dst_h,   \
+                             ptrdiff_t src_w, ptrdiff_t src_h,                  \
+                             int step, int scale)                               \
+{                                                                               \
+    type *dst = (type *)ddst;                                                   \
+    const int bw = FFMIN(scale, src_w / step);                                  \
+    const int bh = FFMIN(scale, src_h);                                         \
+    const unsigned area = bw * bh;                                              \
+                                                                                \
+    linesize /= sizeof(type);                                                   \
+    for (ptrdiff_t y = 0; y < dst_h; y++) {                                     \
+        const type *src = (const type *)ssrc + y * scale * linesize;            \
+                                                                                \
+        for (ptrdiff_t x = 0; x < dst_w; x += step) {                           \
+            for (int c = 0; c < step; c++) {                                    \
+                const type *s = src + x * scale + c;                            \
+                unsigned sum = 0;                                               \
+                                                                                \
+                for (int j = 0; j < bh; j++) {                                  \
+                    for (int i = 0; i < bw; i++)                                \
+                        sum += s[i * step];                                     \
+                    s += linesize;                                              \
+                }                                                               \
+                dst[x + c] = (sum + area / 2) / area;                           \
+            }                                                                   \
+        }                                                                       \
+        dst += dst_w;                                                           \
+    }                                                                           \
+}
+
+DEFINE_DOWNSCALE(uint8_t,  8)
+DEFINE_DOWNSCALE(uint16_t, 16)
+
+static double get_scaled_scene_score(AVFilterContext *ctx, AVFrame *frame)
+{
+    SelectContext *select = ctx->priv;
+    const int bpp = 1 + (select->bitdepth > 8);
+    uint8_t *cur = select->scaled[0], *prev = select->scaled[1];
+    double ret = 0;
+
+    for (int plane = 0; plane < select->nb_planes; plane++) {
+        ptrdiff_t dst_w = select->scaled_width[plane];
+        ptrdiff_t dst_h = select->scaled_height[plane];
+
+        (bpp == 1 ? downscale_8 : downscale_16)(frame->data[plane], frame->linesize[plane],
+                                                cur, dst_w, dst_h,
+                                                select->width[plane], select->height[plane],
+                                                select->pixel_step, select->scene_scale);
+        cur += dst_w * dst_h * bpp;
+    }
+    cur = select->scaled[0];
+
+    if (frame->width  == select->prev_w &&
+        frame->height == select->prev_h) {
+        uint64_t sad = 0;
+        double mafd, diff;
+        uint64_t count = 0;
+
+        for (int plane = 0; plane < select->nb_planes; plane++) {
+            ptrdiff_t w = select->scaled_width[plane];
+            ptrdiff_t h = select->scaled_height[plane];
+            uint64_t plane_sad;
+
+            select->sad(prev, w * bpp, cur, w * bpp, w, h, &plane_sad);
+            sad   += plane_sad;
+            count += w * h;
+            prev  += w * h * bpp;
+            cur   += w * h * bpp;
+        }
+
+        emms_c();
+        mafd = (double)sad / count / (1ULL << (select->bitdepth - 8));
+        diff = fabs(mafd - select->prev_mafd);
+        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+        select->prev_mafd = mafd;
+    }
+    FFSWAP(uint8_t *, select->scaled[0], select->scaled[1]);
+    select->prev_w = frame->width;
+    select->prev_h = frame->height;
+    return ret;
+}
+
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
     double ret = 0;
     SelectContext *select = ctx->priv;
     AVFrame *prev_picref = select->prev_picref;
 
+    if (select->scene_scale > 1)
+        return get_scaled_scene_score(ctx, frame);
+
     if (prev_picref &&
         frame->height == prev_picref->height &&
         frame->width  == prev_picref->width) {
@@ -445,6 +562,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (select->do_scene_detect) {
         av_frame_free(&select->prev_picref);
+        av_freep(&select->scaled[0]);
+        av_freep(&select->scaled[1]);
     }
 }
 
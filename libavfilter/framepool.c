@@ -18,6 +18,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "framepool.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
@@ -26,6 +28,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/thread.h"
 
 struct FFFramePool {
 
@@ -46,6 +49,15 @@ struct FFFramePool {
     int linesize[4];
     AVBufferPool *pools[4];
 
+    AVBufferRef* (*alloc)(int size);
+    atomic_int refcount;
+};
+
+struct FFFramePoolSet {
+    AVMutex mutex;
+    FFFramePool **pools;
+    int nb_pools;
+    int max_unused;
 };
 
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
@@ -66,6 +78,8 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
         return NULL;
 
     pool->type = AVMEDIA_TYPE_VIDEO;
+    pool->alloc = alloc;
+    atomic_init(&pool->refcount, 1);
     pool->width = width;
     pool->height = height;
     pool->format = format;
@@ -100,6 +114,7 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
                                              alloc);
         if (!pool->pools[i])
             goto fail;
+        av_buffer_pool_set_mem_tag(pool->pools[i], AV_MEM_TAG_FILTER);
     }
 
     if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
@@ -107,6 +122,7 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(int size),
         pool->pools[1] = av_buffer_pool_init(AVPALETTE_SIZE, alloc);
         if (!pool->pools[1])
             goto fail;
+        av_buffer_pool_set_mem_tag(pool->pools[1], AV_MEM_TAG_FILTER);
     }
 
     return pool;
@@ -132,6 +148,8 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
     planar = av_sample_fmt_is_planar(format);
 
     pool->type = AVMEDIA_TYPE_AUDIO;
+    pool->alloc = alloc;
+    atomic_init(&pool->refcount, 1);
     pool->planes = planar ? channels : 1;
     pool->channels = channels;
     pool->nb_samples = nb_samples;
@@ -146,6 +164,7 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
     pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
     if (!pool->pools[0])
         goto fail;
+    av_buffer_pool_set_mem_tag(pool->pools[0], AV_MEM_TAG_FILTER);
 
     return pool;
 
@@ -281,6 +300,12 @@ fail:
     return NULL;
 }
 
+FFFramePool *ff_frame_pool_ref(FFFramePool *pool)
+{
+    atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
+    return pool;
+}
+
 void ff_frame_pool_uninit(FFFramePool **pool)
 {
     int i;
@@ -288,9 +313,108 @@ void ff_frame_pool_uninit(FFFramePool **pool)
     if (!pool || !*pool)
         return;
 
+    if (atomic_fetch_sub_explicit(&(*pool)->refcount, 1,
+                                  memory_order_acq_rel) > 1) {
+        *pool = NULL;
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         av_buffer_pool_uninit(&(*pool)->pools[i]);
     }
 
     av_freep(pool);
 }
+
+FFFramePoolSet *ff_frame_pool_set_alloc(int max_unused)
+{
+    FFFramePoolSet *set = av_mallocz(sizeof(*set));
+    if (!set)
+        return NULL;
+
+    if (ff_mutex_init(&set->mutex, NULL)) {
+        av_free(set);
+        return NULL;
+    }
+    set->max_unused = max_unused;
+
+    return set;
+}
+
+void ff_frame_pool_set_free(FFFramePoolSet **pset)
+{
+    FFFramePoolSet *set = *pset;
+    int i;
+
+    if (!set)
+        return;
+
+    for (i = 0; i < set->nb_pools; i++)
+        ff_frame_pool_uninit(&set->pools[i]);
+    av_freep(&set->pools);
+    ff_mutex_destroy(&set->mutex);
+    av_freep(pset);
+}
+
+/* Drop the least recently added pools that only the set still references,
+ * keeping at most max_unused of them. Must be called with the mutex held. */
+static void pool_set_trim(FFFramePoolSet *set)
+{
+    int i, unused = 0;
+
+    for (i = 0; i < set->nb_pools; i++)
+        unused += atomic_load_explicit(&set->pools[i]->refcount,
+                                       memory_order_acquire) == 1;
+
+    for (i = 0; i < set->nb_pools && unused > set->max_unused; ) {
+        if (atomic_load_explicit(&set->pools[i]->refcount,
+                                 memory_order_acquire) == 1) {
+            ff_frame_pool_uninit(&set->pools[i]);
+            memmove(set->pools + i, set->pools + i + 1,
+                    (set->nb_pools - i - 1) * sizeof(*set->pools));
+            set->nb_pools--;
+            unused--;
+        } else {
+            i++;
+        }
+    }
+}
+
+FFFramePool *ff_frame_pool_set_get_video(FFFramePoolSet *set,
+                                         AVBufferRef* (*alloc)(int size),
+                                         int width,
+                                         int height,
+                                         enum AVPixelFormat format,
+                                         int align)
+{
+    FFFramePool *pool = NULL, **pools;
+    int i;
+
+    ff_mutex_lock(&set->mutex);
+
+    for (i = 0; i < set->nb_pools; i++) {
+        FFFramePool *p = set->pools[i];
+        if (p->type == AVMEDIA_TYPE_VIDEO && p->alloc == alloc &&
+            p->width == width && p->height == height &&
+            p->format == format && p->align == align) {
+            pool = ff_frame_pool_ref(p);
+            goto end;
+        }
+    }
+
+    pools = av_realloc_array(set->pools, set->nb_pools + 1, sizeof(*pools));
+    if (!pools)
+        goto end;
+    set->pools = pools;
+
+    pool = ff_frame_pool_video_init(alloc, width, height, format, align);
+    if (!pool)
+        goto end;
+    set->pools[set->nb_pools++] = ff_frame_pool_ref(pool);
+
+    pool_set_trim(set);
+
+end:
+    ff_mutex_unlock(&set->mutex);
+    return pool;
+}
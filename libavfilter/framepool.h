@@ -31,6 +31,15 @@
  */
 typedef struct FFFramePool FFFramePool;
 
+/**
+ * Set of video frame pools shared by all links of a filter graph, so that
+ * links with the same frame configuration draw from the same warm buffers.
+ * This structure is opaque; it is allocated with ff_frame_pool_set_alloc()
+ * and freed with ff_frame_pool_set_free(). All functions taking it are
+ * thread-safe.
+ */
+typedef struct FFFramePoolSet FFFramePoolSet;
+
 /**
  * Allocate and initialize a video frame pool.
  *
@@ -68,13 +77,54 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(int size),
                                       int align);
 
 /**
- * Deallocate the frame pool. It is safe to call this function while
- * some of the allocated frame are still in use.
+ * Add a reference to the frame pool. Each reference must be released with
+ * ff_frame_pool_uninit().
+ *
+ * @return pool
+ */
+FFFramePool *ff_frame_pool_ref(FFFramePool *pool);
+
+/**
+ * Release a reference to the frame pool and deallocate it when it was the
+ * last one. It is safe to call this function while some of the allocated
+ * frame are still in use.
  *
  * @param pool pointer to the frame pool to be freed. It will be set to NULL.
  */
 void ff_frame_pool_uninit(FFFramePool **pool);
 
+/**
+ * Allocate an empty frame pool set.
+ *
+ * @param max_unused maximum number of pools that are kept around after no
+ * user references them anymore
+ * @return newly created frame pool set on success, NULL on error.
+ */
+FFFramePoolSet *ff_frame_pool_set_alloc(int max_unused);
+
+/**
+ * Deallocate the frame pool set and release its references to the pools.
+ *
+ * @param set pointer to the frame pool set to be freed. It will be set to
+ * NULL.
+ */
+void ff_frame_pool_set_free(FFFramePoolSet **set);
+
+/**
+ * Get a reference to the video frame pool of the set with the given
+ * configuration, creating it if needed. Parameters are as for
+ * ff_frame_pool_video_init().
+ *
+ * @return a new reference to the pool, to be released with
+ * ff_frame_pool_uninit(), NULL on error.
+ */
+FFFramePool *ff_frame_pool_set_get_video(FFFramePoolSet *set,
+                                         AVBufferRef* (*alloc)(int size),
+                                         int width,
+                                         int height,
+                                         enum AVPixelFormat format,
+                                         int align);
+
 /**
  * Get the video frame pool configuration.
  *
@@ -20,6 +20,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/time.h"
 #include "framequeue.h"
 
 static inline FFFrameBucket *bucket(FFFrameQueue *fq, size_t idx)
@@ -29,6 +30,7 @@ static inline FFFrameBucket *bucket(FFFrameQueue *fq, size_t idx)
 
 void ff_framequeue_global_init(FFFrameQueueGlobal *fqg)
 {
+    fqg->profile = 0;
 }
 
 static void check_consistency(FFFrameQueue *fq)
@@ -48,6 +50,7 @@ void ff_framequeue_init(FFFrameQueue *fq, FFFrameQueueGlobal *fqg)
 {
     fq->queue = &fq->first_bucket;
     fq->allocated = 1;
+    fq->profile = fqg->profile;
 }
 
 void ff_framequeue_free(FFFrameQueue *fq)
@@ -88,7 +91,10 @@ int ff_framequeue_add(FFFrameQueue *fq, AVFrame *frame)
     }
     b = bucket(fq, fq->queued);
     b->frame = frame;
+    if (fq->profile)
+        b->time_added = av_gettime_relative();
     fq->queued++;
+    fq->max_queued = FFMAX(fq->max_queued, fq->queued);
     fq->total_frames_head++;
     fq->total_samples_head += frame->nb_samples;
     check_consistency(fq);
@@ -102,6 +108,12 @@ AVFrame *ff_framequeue_take(FFFrameQueue *fq)
     check_consistency(fq);
     av_assert1(fq->queued);
     b = bucket(fq, 0);
+    if (fq->profile) {
+        int64_t wait = av_gettime_relative() - b->time_added;
+        fq->wait_frames++;
+        fq->wait_total += wait;
+        fq->wait_max    = FFMAX(fq->wait_max, wait);
+    }
     fq->queued--;
     fq->tail++;
     fq->tail &= fq->allocated - 1;
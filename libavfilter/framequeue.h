@@ -33,6 +33,7 @@
 
 typedef struct FFFrameBucket {
     AVFrame *frame;
+    int64_t time_added; /* only set when profiling */
 } FFFrameBucket;
 
 /**
@@ -40,11 +41,14 @@ typedef struct FFFrameBucket {
  *
  * This structure is intended to allow implementing global control of the
  * frame queues, including memory consumption caps.
- *
- * It is currently empty.
  */
 typedef struct FFFrameQueueGlobal {
-    char dummy; /* C does not allow empty structs */
+
+    /**
+     * Record how long frames wait in the queues initialized from now on.
+     */
+    int profile;
+
 } FFFrameQueueGlobal;
 
 /**
@@ -105,6 +109,24 @@ typedef struct FFFrameQueue {
      */
     int samples_skipped;
 
+    /**
+     * Record the time frames spend in the queue.
+     */
+    int profile;
+
+    /**
+     * Highest number of frames queued at once.
+     */
+    size_t max_queued;
+
+    /**
+     * Number of timed frames dequeued from the queue, and their total and
+     * longest wait in microseconds; only updated when profiling.
+     */
+    uint64_t wait_frames;
+    int64_t wait_total;
+    int64_t wait_max;
+
 } FFFrameQueue;
 
 /**
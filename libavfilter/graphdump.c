@@ -24,6 +24,10 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/bprint.h"
 #include "libavutil/pixdesc.h"
+
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
 #include "avfilter.h"
 #include "internal.h"
 
@@ -151,15 +155,49 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
     }
 }
 
+void ff_filter_dump_profile(AVBPrint *buf, AVFilterContext *filter)
+{
+    const AVFilterInternal *fi = filter->internal;
+    unsigned i;
+
+    av_bprintf(buf, "%s (%s): activations:%"PRIu64" time:%"PRId64"us cpu:%"PRId64"us\n",
+               filter->name, filter->filter->name, fi->nb_activations,
+               fi->activate_time, fi->activate_cpu_time);
+    for (i = 0; i < filter->nb_inputs; i++) {
+        const AVFilterLink *l = filter->inputs[i];
+        const FFFrameQueue *fq = &l->fifo;
+
+        av_bprintf(buf, "  %s:%s -> %s: frames:%"PRId64" queued:%"SIZE_SPECIFIER
+                   " max_queued:%"SIZE_SPECIFIER" wait_avg:%"PRId64"us wait_max:%"PRId64"us\n",
+                   l->src->name, l->srcpad->name, l->dstpad->name,
+                   l->frame_count_out, fq->queued, fq->max_queued,
+                   fq->wait_frames ? fq->wait_total / (int64_t)fq->wait_frames : 0,
+                   fq->wait_max);
+    }
+}
+
+static void avfilter_graph_dump_profile_to_buf(AVBPrint *buf, AVFilterGraph *graph)
+{
+    unsigned i;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        ff_filter_dump_profile(buf, graph->filters[i]);
+}
+
 char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
 {
+    void (*dump_to_buf)(AVBPrint *buf, AVFilterGraph *graph) =
+        avfilter_graph_dump_to_buf;
     AVBPrint buf;
     char *dump = NULL;
 
+    if (options && !strcmp(options, "profile"))
+        dump_to_buf = avfilter_graph_dump_profile_to_buf;
+
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_COUNT_ONLY);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    dump_to_buf(&buf, graph);
     av_bprint_init(&buf, buf.len + 1, buf.len + 1);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    dump_to_buf(&buf, graph);
     av_bprint_finalize(&buf, &dump);
     return dump;
 }
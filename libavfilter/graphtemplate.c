@@ -0,0 +1,275 @@
+/*
+ * Filter graph templates
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
+#include "libavutil/dict.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+
+#include "avfilter.h"
+#include "internal.h"
+
+typedef struct TemplateFilter {
+    const AVFilter *filter;
+    char *name;
+    AVDictionary *options;
+    AVBufferRef *hw_device_ctx;
+} TemplateFilter;
+
+typedef struct TemplateLink {
+    unsigned src, srcpad;
+    unsigned dst, dstpad;
+
+    /* negotiated formats */
+    int format;
+    int sample_rate;
+    uint64_t channel_layout;
+    int channels;
+} TemplateLink;
+
+struct AVFilterGraphTemplate {
+    TemplateFilter *filters;
+    unsigned nb_filters;
+    TemplateLink *links;
+    unsigned nb_links;
+};
+
+int ff_filter_save_options(void *obj, AVDictionary **dict)
+{
+    const AVOption *o = NULL;
+    int ret;
+
+    while ((o = av_opt_next(obj, o))) {
+        uint8_t *val;
+
+        if (o->type == AV_OPT_TYPE_CONST ||
+            o->flags & (AV_OPT_FLAG_READONLY | AV_OPT_FLAG_DEPRECATED) ||
+            av_opt_is_set_to_default(obj, o) > 0)
+            continue;
+
+        if (o->type == AV_OPT_TYPE_DOUBLE || o->type == AV_OPT_TYPE_FLOAT) {
+            /* av_opt_get() only prints 6 decimals */
+            char buf[32];
+            double d;
+
+            if ((ret = av_opt_get_double(obj, o->name, 0, &d)) < 0)
+                return ret;
+            snprintf(buf, sizeof(buf), "%.17g", d);
+            ret = av_dict_set(dict, o->name, buf, 0);
+        } else {
+            if ((ret = av_opt_get(obj, o->name, 0, &val)) < 0)
+                return ret;
+            ret = av_dict_set(dict, o->name, val, AV_DICT_DONT_STRDUP_VAL);
+        }
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Restrict the output of a resampler to the formats it was configured with.
+ * Some filters, e.g. amerge, set up their state from the channel layouts
+ * offered by their inputs when querying formats, and would otherwise see
+ * every channel count instead of the layout negotiated in the original graph.
+ */
+static int pin_resampler_output(AVDictionary **options, const AVFilterLink *link)
+{
+    char buf[32];
+    int ret;
+
+    if ((ret = av_dict_set(options, "osf",
+                           av_get_sample_fmt_name(link->format), 0)) < 0 ||
+        (ret = av_dict_set_int(options, "osr", link->sample_rate, 0)) < 0)
+        return ret;
+    if (link->channel_layout) {
+        snprintf(buf, sizeof(buf), "0x%"PRIx64, link->channel_layout);
+        if ((ret = av_dict_set(options, "ocl", buf, 0)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int filter_index(const AVFilterGraph *graph, const AVFilterContext *ctx)
+{
+    unsigned i;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        if (graph->filters[i] == ctx)
+            return i;
+    return AVERROR_BUG;
+}
+
+int avfilter_graph_template_create(AVFilterGraphTemplate **ptmpl,
+                                   const AVFilterGraph *graph)
+{
+    AVFilterGraphTemplate *tmpl;
+    unsigned i, j, nb_links = 0;
+    int ret;
+
+    *ptmpl = NULL;
+
+    tmpl = av_mallocz(sizeof(*tmpl));
+    if (!tmpl)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < graph->nb_filters; i++)
+        nb_links += graph->filters[i]->nb_outputs;
+
+    tmpl->filters = av_mallocz_array(graph->nb_filters, sizeof(*tmpl->filters));
+    tmpl->links   = av_mallocz_array(nb_links, sizeof(*tmpl->links));
+    if ((graph->nb_filters && !tmpl->filters) || (nb_links && !tmpl->links)) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *ctx = graph->filters[i];
+        TemplateFilter    *f = &tmpl->filters[tmpl->nb_filters++];
+
+        f->filter = ctx->filter;
+        if (ctx->name && !(f->name = av_strdup(ctx->name))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if ((ret = av_dict_copy(&f->options, ctx->internal->init_options, 0)) < 0)
+            goto fail;
+        if (!strcmp(ctx->filter->name, "aresample") &&
+            ctx->outputs[0] && ctx->outputs[0]->format >= 0 &&
+            (ret = pin_resampler_output(&f->options, ctx->outputs[0])) < 0)
+            goto fail;
+        if (ctx->hw_device_ctx &&
+            !(f->hw_device_ctx = av_buffer_ref(ctx->hw_device_ctx))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        for (j = 0; j < ctx->nb_outputs; j++) {
+            AVFilterLink *link = ctx->outputs[j];
+            TemplateLink    *l = &tmpl->links[tmpl->nb_links++];
+            int dst;
+
+            if (!link || link->format < 0) {
+                av_log(ctx, AV_LOG_ERROR, "Output pad \"%s\" is not %s, "
+                       "only configured graphs can be used as templates.\n",
+                       avfilter_pad_get_name(ctx->output_pads, j),
+                       link ? "configured" : "connected");
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+
+            if ((dst = filter_index(graph, link->dst)) < 0) {
+                ret = dst;
+                goto fail;
+            }
+
+            l->src            = i;
+            l->srcpad         = j;
+            l->dst            = dst;
+            l->dstpad         = FF_INLINK_IDX(link);
+            l->format         = link->format;
+            l->sample_rate    = link->sample_rate;
+            l->channel_layout = link->channel_layout;
+            l->channels       = link->channels;
+        }
+    }
+
+    *ptmpl = tmpl;
+    return 0;
+fail:
+    avfilter_graph_template_free(&tmpl);
+    return ret;
+}
+
+int avfilter_graph_template_instantiate(const AVFilterGraphTemplate *tmpl,
+                                        AVFilterGraph *graph)
+{
+    unsigned i;
+    int ret;
+
+    if (graph->nb_filters) {
+        av_log(graph, AV_LOG_ERROR, "A template can only be instantiated "
+               "in an empty graph.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < tmpl->nb_filters; i++) {
+        const TemplateFilter *f = &tmpl->filters[i];
+        AVDictionary *options = NULL;
+        AVFilterContext *ctx;
+
+        ctx = avfilter_graph_alloc_filter(graph, f->filter, f->name);
+        if (!ctx)
+            return AVERROR(ENOMEM);
+        if (f->hw_device_ctx &&
+            !(ctx->hw_device_ctx = av_buffer_ref(f->hw_device_ctx)))
+            return AVERROR(ENOMEM);
+
+        if ((ret = av_dict_copy(&options, f->options, 0)) >= 0)
+            ret = avfilter_init_dict(ctx, &options);
+        av_dict_free(&options);
+        if (ret < 0)
+            return ret;
+    }
+
+    for (i = 0; i < tmpl->nb_links; i++) {
+        const TemplateLink *l = &tmpl->links[i];
+        AVFilterLink *link;
+
+        ret = avfilter_link(graph->filters[l->src], l->srcpad,
+                            graph->filters[l->dst], l->dstpad);
+        if (ret < 0)
+            return ret;
+
+        link = graph->filters[l->src]->outputs[l->srcpad];
+        link->format         = l->format;
+        link->sample_rate    = l->sample_rate;
+        link->channel_layout = l->channel_layout;
+        link->channels       = l->channels;
+    }
+
+    graph->internal->formats_preset = 1;
+    return 0;
+}
+
+void avfilter_graph_template_free(AVFilterGraphTemplate **ptmpl)
+{
+    AVFilterGraphTemplate *tmpl = *ptmpl;
+    unsigned i;
+
+    if (!tmpl)
+        return;
+
+    for (i = 0; i < tmpl->nb_filters; i++) {
+        av_freep(&tmpl->filters[i].name);
+        av_dict_free(&tmpl->filters[i].options);
+        av_buffer_unref(&tmpl->filters[i].hw_device_ctx);
+    }
+    av_freep(&tmpl->filters);
+    av_freep(&tmpl->links);
+    av_freep(ptmpl);
+}
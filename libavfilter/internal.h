@@ -137,13 +137,49 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+    /**
+     * Activate several unrelated filters concurrently; set when frame
+     * threading is available.
+     */
+    int (*activate_filters)(AVFilterGraph *graph, AVFilterContext **filters,
+                            int nb_filters);
     FFFrameQueueGlobal frame_queues;
+    /**
+     * Video frame pools shared by the links of the graph.
+     */
+    FFFramePoolSet *frame_pools;
+    /**
+     * Set when the formats of all links have been set from a template;
+     * avfilter_graph_config() then keeps them instead of negotiating.
+     */
+    int formats_preset;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Number of activations and the wall clock and thread CPU time they
+     * took in microseconds, accumulated when AVFilterGraph.profile is set.
+     */
+    uint64_t nb_activations;
+    int64_t activate_time;
+    int64_t activate_cpu_time;
+
+    /**
+     * Options the filter was initialized with, recorded for graph templates.
+     */
+    AVDictionary *init_options;
 };
 
+/**
+ * Add the options of obj which are not set to their default value to a
+ * dictionary, in a form that av_opt_set_dict() reads back.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_filter_save_options(void *obj, AVDictionary **dict);
+
 /**
  * Tell if an integer is contained in the provided -1-terminated list of integers.
  * This is useful for determining (for instance) if an AVPixelFormat is in an
@@ -358,6 +394,12 @@ int ff_filter_activate(AVFilterContext *filter);
  */
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter);
 
+/**
+ * Print the statistics collected for a filter and its input links when
+ * AVFilterGraph.profile is set.
+ */
+void ff_filter_dump_profile(struct AVBPrint *buf, AVFilterContext *filter);
+
 /**
  * The filter is aware of hardware frames, and any hardware frame context
  * should not be automatically propagated through it.
@@ -0,0 +1,162 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+enum ScaleAlgo {
+    SCALE_BILINEAR,
+    SCALE_BICUBIC,
+    SCALE_LANCZOS,
+};
+
+#define MAX_TAPS 64
+
+const sampler_t sampler = (CLK_NORMALIZED_COORDS_FALSE |
+                           CLK_ADDRESS_CLAMP_TO_EDGE   |
+                           CLK_FILTER_NEAREST);
+
+float sinc(float x)
+{
+    if (x == 0.0f)
+        return 1.0f;
+    x *= M_PI_F;
+    return sin(x) / x;
+}
+
+float filter_radius(int algo)
+{
+    switch (algo) {
+    case SCALE_BICUBIC: return 2.0f;
+    case SCALE_LANCZOS: return 3.0f;
+    default:            return 1.0f;
+    }
+}
+
+float filter_weight(int algo, float x)
+{
+    x = fabs(x);
+    switch (algo) {
+    case SCALE_BICUBIC:
+        /* Keys cubic with a = -0.5 */
+        if (x < 1.0f)
+            return (1.5f * x - 2.5f) * x * x + 1.0f;
+        if (x < 2.0f)
+            return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+        return 0.0f;
+    case SCALE_LANCZOS:
+        return x < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+    default:
+        return x < 1.0f ? 1.0f - x : 0.0f;
+    }
+}
+
+/*
+ * Compute the first source tap and the normalised weights for one output
+ * coordinate. The filter is stretched by the downscaling factor so that it
+ * also acts as the anti-aliasing low-pass.
+ */
+int filter_taps(int algo, int dst_pos, float scale, float *weights,
+                int *nb_taps)
+{
+    float stretch = fmax(scale, 1.0f);
+    float support = filter_radius(algo) * stretch;
+    float center  = (dst_pos + 0.5f) * scale - 0.5f;
+    int   first   = (int)floor(center - support) + 1;
+    int   n       = min((int)ceil(2.0f * support), MAX_TAPS);
+    float sum     = 0.0f;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        weights[i] = filter_weight(algo, (first + i - center) / stretch);
+        sum += weights[i];
+    }
+    for (i = 0; i < n; i++)
+        weights[i] /= sum;
+
+    *nb_taps = n;
+    return first;
+}
+
+float4 scale_sample(__read_only image2d_t src, int algo,
+                    int2 src_size, int2 dst_size, int2 pos)
+{
+    float sx = (float)src_size.x / dst_size.x;
+    float sy = (float)src_size.y / dst_size.y;
+    float wx[MAX_TAPS], wy[MAX_TAPS];
+    float4 acc = 0.0f;
+    int nx, ny, i, j;
+    int x0 = filter_taps(algo, pos.x, sx, wx, &nx);
+    int y0 = filter_taps(algo, pos.y, sy, wy, &ny);
+
+    for (j = 0; j < ny; j++) {
+        float4 row = 0.0f;
+        for (i = 0; i < nx; i++)
+            row += wx[i] * read_imagef(src, sampler, (int2)(x0 + i, y0 + j));
+        acc += wy[j] * row;
+    }
+
+    return clamp(acc, 0.0f, 1.0f);
+}
+
+__kernel void scale_luma(__write_only image2d_t dst,
+                         __read_only  image2d_t src,
+                         int algo)
+{
+    int2 dst_size = get_image_dim(dst);
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+
+    if (pos.x >= dst_size.x || pos.y >= dst_size.y)
+        return;
+
+    write_imagef(dst, pos, scale_sample(src, algo, get_image_dim(src),
+                                        dst_size, pos));
+}
+
+/*
+ * Chroma is scaled with both components at once, so that semi-planar
+ * (NV12, P010) and planar (YUV420P) layouts can be converted into each
+ * other. For a semi-planar side the same image is passed twice.
+ */
+__kernel void scale_chroma(__write_only image2d_t dst_u,
+                           __write_only image2d_t dst_v,
+                           __read_only  image2d_t src_u,
+                           __read_only  image2d_t src_v,
+                           int src_packed,
+                           int dst_packed,
+                           int algo)
+{
+    int2 dst_size = get_image_dim(dst_u);
+    int2 src_size = get_image_dim(src_u);
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+    float2 uv;
+
+    if (pos.x >= dst_size.x || pos.y >= dst_size.y)
+        return;
+
+    if (src_packed) {
+        uv = scale_sample(src_u, algo, src_size, dst_size, pos).xy;
+    } else {
+        uv.x = scale_sample(src_u, algo, src_size, dst_size, pos).x;
+        uv.y = scale_sample(src_v, algo, src_size, dst_size, pos).x;
+    }
+
+    if (dst_packed) {
+        write_imagef(dst_u, pos, (float4)(uv.x, uv.y, 0.0f, 1.0f));
+    } else {
+        write_imagef(dst_u, pos, (float4)(uv.x, 0.0f, 0.0f, 1.0f));
+        write_imagef(dst_v, pos, (float4)(uv.y, 0.0f, 0.0f, 1.0f));
+    }
+}
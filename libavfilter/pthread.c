@@ -42,6 +42,12 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* frame threading: pool running independent filters concurrently */
+    AVSliceThread *frame_thread;
+    AVFilterContext **batch;
+    int *batch_rets;
+    int in_batch;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
@@ -52,9 +58,16 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+static void frame_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+    c->batch_rets[jobnr] = ff_filter_activate(c->batch[jobnr]);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    avpriv_slicethread_free(&c->frame_thread);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -64,6 +77,19 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+
+    /* The slice pool is not reentrant: filters activated as part of a
+     * frame-threaded batch run their slices on their own thread. */
+    if (c->in_batch) {
+        int i;
+        for (i = 0; i < nb_jobs; i++) {
+            int r = func(ctx, arg, i, nb_jobs);
+            if (ret)
+                ret[i] = r;
+        }
+        return 0;
+    }
+
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
@@ -73,9 +99,50 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     return 0;
 }
 
-static int thread_init_internal(ThreadContext *c, int nb_threads)
+static int thread_activate_filters(AVFilterGraph *graph, AVFilterContext **filters,
+                                   int nb_filters)
+{
+    ThreadContext *c = graph->internal->thread;
+    int i, ret = 0;
+
+    c->batch    = filters;
+    c->in_batch = 1;
+    avpriv_slicethread_execute(c->frame_thread, nb_filters, 0);
+    c->in_batch = 0;
+
+    for (i = 0; i < nb_filters; i++)
+        if (c->batch_rets[i] < 0 && !ret)
+            ret = c->batch_rets[i];
+    return ret;
+}
+
+static int frame_thread_init(ThreadContext *c, int nb_threads, int shared)
 {
-    nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
+    int ret;
+
+    c->batch_rets = av_malloc_array(nb_threads, sizeof(*c->batch_rets));
+    if (!c->batch_rets)
+        return AVERROR(ENOMEM);
+
+    if (shared)
+        ret = avpriv_slicethread_create_shared(&c->frame_thread, c,
+                                               frame_worker_func, nb_threads);
+    else
+        ret = avpriv_slicethread_create(&c->frame_thread, c, frame_worker_func,
+                                        NULL, nb_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->frame_thread);
+        av_freep(&c->batch_rets);
+    }
+    return ret;
+}
+
+static int thread_init_internal(ThreadContext *c, int nb_threads, int shared)
+{
+    if (shared)
+        nb_threads = avpriv_slicethread_create_shared(&c->thread, c, worker_func, nb_threads);
+    else
+        nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
     if (nb_threads <= 1)
         avpriv_slicethread_free(&c->thread);
     return FFMAX(nb_threads, 1);
@@ -83,6 +150,8 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
 
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
+    const int shared = !!(graph->thread_type & AVFILTER_THREAD_SHARED);
+    ThreadContext *c;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -94,7 +163,7 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     if (!graph->internal->thread)
         return AVERROR(ENOMEM);
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(graph->internal->thread, graph->nb_threads, shared);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
@@ -102,15 +171,34 @@ int ff_graph_thread_init(AVFilterGraph *graph)
         return (ret < 0) ? ret : 0;
     }
     graph->nb_threads = ret;
+    c = graph->internal->thread;
+    avpriv_slicethread_set_affinity(c->thread, graph->thread_affinity, graph->numa_node);
 
     graph->internal->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_FRAME) {
+        ret = frame_thread_init(c, graph->nb_threads, shared);
+        if (ret < 0)
+            return ret;
+        if (c->frame_thread) {
+            avpriv_slicethread_set_affinity(c->frame_thread, graph->thread_affinity,
+                                            graph->numa_node);
+            graph->internal->activate_filters = thread_activate_filters;
+        }
+        else
+            graph->thread_type &= ~AVFILTER_THREAD_FRAME;
+    }
+
     return 0;
 }
 
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
-    if (graph->internal->thread)
-        slice_thread_uninit(graph->internal->thread);
+    ThreadContext *c = graph->internal->thread;
+
+    if (c) {
+        slice_thread_uninit(c);
+        av_freep(&c->batch_rets);
+    }
     av_freep(&graph->internal->thread);
 }
@@ -22,6 +22,7 @@
  */
 
 #include "libavutil/common.h"
+#include "libavutil/fifo.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/hwcontext.h"
 #include "libavutil/hwcontext_qsv.h"
@@ -41,9 +42,15 @@ typedef struct QSVFrame {
     AVFrame          *frame;
     mfxFrameSurface1 *surface;
     mfxFrameSurface1  surface_internal;  /* for system memory */
+    int               queued;            /* waiting in the async fifo */
     struct QSVFrame  *next;
 } QSVFrame;
 
+typedef struct QSVAsyncFrame {
+    mfxSyncPoint  sync;
+    QSVFrame     *frame;
+} QSVAsyncFrame;
+
 /* abstract struct for all QSV filters */
 struct QSVVPPContext {
     mfxSession          session;
@@ -66,6 +73,9 @@ struct QSVVPPContext {
     mfxExtOpaqueSurfaceAlloc opaque_alloc;
     mfxExtBuffer      **ext_buffers;
     int                 nb_ext_buffers;
+
+    int                 async_depth;
+    AVFifoBuffer       *async_fifo;
 };
 
 static const mfxHandleType handle_types[] = {
@@ -232,7 +242,7 @@ static int fill_frameinfo_by_link(mfxFrameInfo *frameinfo, AVFilterLink *link)
 static void clear_unused_frames(QSVFrame *list)
 {
     while (list) {
-        if (list->surface && !list->surface->Data.Locked) {
+        if (list->surface && !list->queued && !list->surface->Data.Locked) {
             list->surface = NULL;
             av_frame_free(&list->frame);
         }
@@ -630,7 +640,14 @@ int ff_qsvvpp_create(AVFilterContext *avctx, QSVVPPContext **vpp, QSVVPPParam *p
         s->vpp_param.ExtParam    = param->ext_buf;
     }
 
-    s->vpp_param.AsyncDepth = 1;
+    s->async_depth = FFMAX(param->async_depth, 1);
+    s->async_fifo  = av_fifo_alloc(s->async_depth * sizeof(QSVAsyncFrame));
+    if (!s->async_fifo) {
+        ret = AVERROR(ENOMEM);
+        goto failed;
+    }
+
+    s->vpp_param.AsyncDepth = s->async_depth;
 
     if (IS_SYSTEM_MEMORY(s->in_mem_mode))
         s->vpp_param.IOPattern |= MFX_IOPATTERN_IN_SYSTEM_MEMORY;
@@ -680,11 +697,38 @@ int ff_qsvvpp_free(QSVVPPContext **vpp)
     av_freep(&s->surface_ptrs_out);
     av_freep(&s->ext_buffers);
     av_freep(&s->frame_infos);
+    av_fifo_freep(&s->async_fifo);
     av_freep(vpp);
 
     return 0;
 }
 
+/* sync the oldest queued operation and pass its frame on */
+static int output_queued_frame(QSVVPPContext *s, AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QSVAsyncFrame    async;
+    QSVFrame        *out_frame;
+    int              ret;
+
+    av_fifo_generic_read(s->async_fifo, &async, sizeof(async), NULL);
+    out_frame = async.frame;
+    out_frame->queued = 0;
+
+    do {
+        ret = MFXVideoCORE_SyncOperation(s->session, async.sync, 1000);
+    } while (ret == MFX_WRN_IN_EXECUTION);
+    if (ret < 0)
+        av_log(ctx, AV_LOG_WARNING, "Sync failed.\n");
+
+    out_frame->frame->pts = av_rescale_q(out_frame->surface->Data.TimeStamp,
+                                         default_tb, outlink->time_base);
+
+    ret = s->filter_frame(outlink, out_frame->frame);
+    out_frame->frame = NULL;
+    return ret;
+}
+
 int ff_qsvvpp_filter_frame(QSVVPPContext *s, AVFilterLink *inlink, AVFrame *picref)
 {
     AVFilterContext  *ctx     = inlink->dst;
@@ -693,6 +737,15 @@ int ff_qsvvpp_filter_frame(QSVVPPContext *s, AVFilterLink *inlink, AVFrame *picr
     QSVFrame         *in_frame, *out_frame;
     int               ret, filter_ret;
 
+    if (!picref) {
+        while (av_fifo_size(s->async_fifo)) {
+            ret = output_queued_frame(s, outlink);
+            if (ret < 0)
+                return ret;
+        }
+        return 0;
+    }
+
     in_frame = submit_frame(s, inlink, picref);
     if (!in_frame) {
         av_log(ctx, AV_LOG_ERROR, "Failed to submit frame on input[%d]\n",
@@ -721,19 +774,19 @@ int ff_qsvvpp_filter_frame(QSVVPPContext *s, AVFilterLink *inlink, AVFrame *picr
             break;
         }
 
-        if (MFXVideoCORE_SyncOperation(s->session, sync, 1000) < 0)
-            av_log(ctx, AV_LOG_WARNING, "Sync failed.\n");
-
-        out_frame->frame->pts = av_rescale_q(out_frame->surface->Data.TimeStamp,
-                                             default_tb, outlink->time_base);
-
-        filter_ret = s->filter_frame(outlink, out_frame->frame);
-        if (filter_ret < 0) {
-            av_frame_free(&out_frame->frame);
-            ret = filter_ret;
-            break;
+        /* Keep up to async_depth operations in flight, so that the VPP
+         * does not stall on each frame waiting for the CPU. */
+        out_frame->queued = 1;
+        av_fifo_generic_write(s->async_fifo, &(QSVAsyncFrame){ sync, out_frame },
+                              sizeof(QSVAsyncFrame), NULL);
+
+        if (!av_fifo_space(s->async_fifo)) {
+            filter_ret = output_queued_frame(s, outlink);
+            if (filter_ret < 0) {
+                ret = filter_ret;
+                break;
+            }
         }
-        out_frame->frame = NULL;
     } while(ret == MFX_ERR_MORE_SURFACE);
 
     return ret;
@@ -60,6 +60,10 @@ typedef struct QSVVPPParam {
     /* Crop information for each input, if needed */
     int num_crop;
     QSVVPPCrop *crop;
+
+    /* Number of VPP operations in flight before the oldest one is synced,
+     * 0 or 1 to sync every frame */
+    int async_depth;
 } QSVVPPParam;
 
 /* create and initialize the QSV session */
@@ -68,7 +72,8 @@ int ff_qsvvpp_create(AVFilterContext *avctx, QSVVPPContext **vpp, QSVVPPParam *p
 /* release the resources (eg.surfaces) */
 int ff_qsvvpp_free(QSVVPPContext **vpp);
 
-/* vpp filter frame and call the cb if needed */
+/* vpp filter frame and call the cb if needed,
+ * a NULL frame flushes the frames still queued for sync */
 int ff_qsvvpp_filter_frame(QSVVPPContext *vpp, AVFilterLink *inlink, AVFrame *frame);
 
 #endif /* AVFILTER_QSVVPP_H */
@@ -0,0 +1,122 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run a graph configured the usual way and the same graph instantiated from
+ * a template, and print the output of both.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/frame.h"
+#include "libavutil/md5.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+static int print_output(AVFilterGraph *graph, const char *sink_name)
+{
+    AVFilterContext *sink = avfilter_graph_get_filter(graph, sink_name);
+    AVFrame *frame = av_frame_alloc();
+    struct AVMD5 *md5 = av_md5_alloc();
+    uint8_t digest[16];
+    char layout[64];
+    int nb_frames = 0, nb_samples = 0, ret, i;
+
+    if (!sink || !frame || !md5) {
+        ret = !sink ? AVERROR(EINVAL) : AVERROR(ENOMEM);
+        goto end;
+    }
+
+    av_md5_init(md5);
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        /* only packed formats are used by the tests */
+        av_md5_update(md5, frame->data[0], frame->nb_samples * frame->channels *
+                      av_get_bytes_per_sample(frame->format));
+        nb_samples += frame->nb_samples;
+        nb_frames++;
+        av_frame_unref(frame);
+    }
+    if (ret != AVERROR_EOF)
+        goto end;
+    ret = 0;
+    av_md5_final(md5, digest);
+
+    av_get_channel_layout_string(layout, sizeof(layout), 0,
+                                 av_buffersink_get_channel_layout(sink));
+    printf("%s %d %s, %d frames, %d samples, md5=",
+           av_get_sample_fmt_name(av_buffersink_get_format(sink)),
+           av_buffersink_get_sample_rate(sink), layout, nb_frames, nb_samples);
+    for (i = 0; i < 16; i++)
+        printf("%02x", digest[i]);
+    printf("\n");
+
+end:
+    av_frame_free(&frame);
+    av_free(md5);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVFilterGraphTemplate *tmpl = NULL;
+    AVFilterGraph *graph;
+    const char *desc, *sink_name;
+    int ret;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <graph> <sink name>\n", argv[0]);
+        return 1;
+    }
+    desc      = argv[1];
+    sink_name = argv[2];
+
+    if (!(graph = avfilter_graph_alloc()))
+        return 1;
+    if ((ret = avfilter_graph_parse_ptr(graph, desc, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0 ||
+        (ret = avfilter_graph_template_create(&tmpl, graph)) < 0)
+        goto end;
+    printf("graph:    ");
+    if ((ret = print_output(graph, sink_name)) < 0)
+        goto end;
+    avfilter_graph_free(&graph);
+
+    if (!(graph = avfilter_graph_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = avfilter_graph_template_instantiate(tmpl, graph)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+    printf("template: ");
+    ret = print_output(graph, sink_name);
+
+end:
+    avfilter_graph_template_free(&tmpl);
+    avfilter_graph_free(&graph);
+    fflush(stdout);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
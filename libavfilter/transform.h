@@ -132,4 +132,21 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Do the same as avfilter_transform(), but only for the destination rows
+ * y_start to y_end - 1. The whole source image may be read, so the rows can
+ * be transformed in parallel.
+ *
+ * @param y_start     first row to transform
+ * @param y_end       row after the last row to transform
+ * @see avfilter_transform()
+ * @return negative on error
+ */
+int avfilter_transform_rows(const uint8_t *src, uint8_t *dst,
+                             int src_stride, int dst_stride,
+                             int width, int height, int y_start, int y_end,
+                             const float *matrix,
+                             enum InterpolateMethod interpolate,
+                             enum FillMethod fill);
+
 #endif /* AVFILTER_TRANSFORM_H */
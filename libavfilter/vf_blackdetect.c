@@ -44,6 +44,9 @@ typedef struct BlackDetectContext {
     unsigned int pixel_black_th_i;
 
     unsigned int nb_black_pixels;   ///< number of black pixels counted so far
+    unsigned int *counter;          ///< number of black pixels counted by every job
+    int nb_threads;
+    int step;                       ///< spacing of the analyzed rows and columns
 } BlackDetectContext;
 
 #define OFFSET(x) offsetof(BlackDetectContext, x)
@@ -56,6 +59,7 @@ static const AVOption blackdetect_options[] = {
     { "pic_th",                 "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
     { "pixel_black_th", "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
     { "pix_th",         "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "step",           "set the spacing of the analyzed rows and columns", OFFSET(step), AV_OPT_TYPE_INT, {.i64=1}, 1, 64, FLAGS },
     { NULL }
 };
 
@@ -99,6 +103,12 @@ static int config_input(AVFilterLink *inlink)
              blackdetect->pixel_black_th *  255 :
         16 + blackdetect->pixel_black_th * (235 - 16);
 
+    blackdetect->nb_threads = ff_filter_get_nb_threads(ctx);
+    av_freep(&blackdetect->counter);
+    blackdetect->counter = av_calloc(blackdetect->nb_threads, sizeof(*blackdetect->counter));
+    if (!blackdetect->counter)
+        return AVERROR(ENOMEM);
+
     av_log(blackdetect, AV_LOG_VERBOSE,
            "black_min_duration:%s pixel_black_th:%f pixel_black_th_i:%d picture_black_ratio_th:%f\n",
            av_ts2timestr(blackdetect->black_min_duration, &inlink->time_base),
@@ -136,22 +146,53 @@ static int request_frame(AVFilterLink *outlink)
     return ret;
 }
 
+static int black_counter(AVFilterContext *ctx, void *arg,
+                         int jobnr, int nb_jobs)
+{
+    BlackDetectContext *s = ctx->priv;
+    const unsigned int threshold = s->pixel_black_th_i;
+    const int step = s->step;
+    AVFrame *in = arg;
+    const int linesize = in->linesize[0];
+    const int nb_rows = (in->height + step - 1) / step;
+    const int slice_start = (nb_rows *  jobnr     ) / nb_jobs * step;
+    const int slice_end   = (nb_rows * (jobnr + 1)) / nb_jobs * step;
+    const uint8_t *p = in->data[0] + slice_start * linesize;
+    unsigned int counter = 0;
+
+    for (int i = slice_start; i < slice_end; i += step) {
+        if (step == 1) {
+            for (int x = 0; x < in->width; x++)
+                counter += p[x] <= threshold;
+        } else {
+            for (int x = 0; x < in->width; x += step)
+                counter += p[x] <= threshold;
+        }
+        p += linesize * step;
+    }
+
+    s->counter[jobnr] = counter;
+
+    return 0;
+}
+
 // TODO: document metadata
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
 {
     AVFilterContext *ctx = inlink->dst;
     BlackDetectContext *blackdetect = ctx->priv;
+    const int step = blackdetect->step;
+    const int nb_rows = (inlink->h + step - 1) / step;
+    const int nb_cols = (inlink->w + step - 1) / step;
+    const int nb_jobs = FFMAX(1, FFMIN(nb_rows, blackdetect->nb_threads));
     double picture_black_ratio = 0;
-    const uint8_t *p = picref->data[0];
-    int x, i;
 
-    for (i = 0; i < inlink->h; i++) {
-        for (x = 0; x < inlink->w; x++)
-            blackdetect->nb_black_pixels += p[x] <= blackdetect->pixel_black_th_i;
-        p += picref->linesize[0];
-    }
+    ctx->internal->execute(ctx, black_counter, picref, NULL, nb_jobs);
+
+    for (int i = 0; i < nb_jobs; i++)
+        blackdetect->nb_black_pixels += blackdetect->counter[i];
 
-    picture_black_ratio = (double)blackdetect->nb_black_pixels / (inlink->w * inlink->h);
+    picture_black_ratio = (double)blackdetect->nb_black_pixels / (nb_cols * nb_rows);
 
     av_log(ctx, AV_LOG_DEBUG,
            "frame:%"PRId64" picture_black_ratio:%f pts:%s t:%s type:%c\n",
@@ -181,6 +222,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     return ff_filter_frame(inlink->dst->outputs[0], picref);
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    BlackDetectContext *s = ctx->priv;
+
+    av_freep(&s->counter);
+}
+
 static const AVFilterPad blackdetect_inputs[] = {
     {
         .name          = "default",
@@ -205,7 +253,9 @@ AVFilter ff_vf_blackdetect = {
     .description   = NULL_IF_CONFIG_SMALL("Detect video intervals that are (almost) black."),
     .priv_size     = sizeof(BlackDetectContext),
     .query_formats = query_formats,
+    .uninit        = uninit,
     .inputs        = blackdetect_inputs,
     .outputs       = blackdetect_outputs,
     .priv_class    = &blackdetect_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
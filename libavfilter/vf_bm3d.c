@@ -118,7 +118,7 @@ typedef struct BM3DContext {
                           int y, int x, int block_size, float *dst);
     double (*do_block_ssd)(struct BM3DContext *s, PosCode *pos,
                            const uint8_t *src, int src_stride,
-                           int r_y, int r_x);
+                           int r_y, int r_x, double max_dist);
     void (*do_output)(struct BM3DContext *s, uint8_t *dst, int dst_linesize,
                       int plane, int nb_jobs);
     void (*block_filtering)(struct BM3DContext *s,
@@ -225,27 +225,32 @@ static int search_boundary(int plane_boundary, int search_range, int search_step
     return do_search_boundary(vertical ? y : x, plane_boundary, search_range, search_step);
 }
 
-static int cmp_scores(const void *a, const void *b)
-{
-    const struct PosPairCode *pair1 = a;
-    const struct PosPairCode *pair2 = b;
-    return FFDIFFSIGN(pair1->score, pair2->score);
-}
-
-static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+/*
+ * The distance is accumulated exactly in integers, and the computation stops
+ * as soon as it exceeds max_dist, in which case the partial distance is
+ * returned.
+ */
+static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride,
+                           int r_y, int r_x, double max_dist)
 {
     const uint8_t *srcp = src + pos->y * src_stride + pos->x;
     const uint8_t *refp = src + r_y * src_stride + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    int64_t dist = 0;
     int x, y;
 
     for (y = 0; y < block_size; y++) {
+        int row = 0;
+
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
-            dist += temp * temp;
+            const int temp = refp[x] - srcp[x];
+            row += temp * temp;
         }
 
+        dist += row;
+        if (dist > max_dist)
+            break;
+
         srcp += src_stride;
         refp += src_stride;
     }
@@ -253,20 +258,27 @@ static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int
     return dist;
 }
 
-static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride,
+                             int r_y, int r_x, double max_dist)
 {
     const uint16_t *srcp = (uint16_t *)src + pos->y * src_stride / 2 + pos->x;
     const uint16_t *refp = (uint16_t *)src + r_y * src_stride / 2 + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    int64_t dist = 0;
     int x, y;
 
     for (y = 0; y < block_size; y++) {
+        int64_t row = 0;
+
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
-            dist += temp * temp;
+            const int64_t temp = refp[x] - srcp[x];
+            row += temp * temp;
         }
 
+        dist += row;
+        if (dist > max_dist)
+            break;
+
         srcp += src_stride / 2;
         refp += src_stride / 2;
     }
@@ -286,27 +298,39 @@ static void do_block_matching_multi(BM3DContext *s, const uint8_t *src, int src_
 
     for (i = 0; i < search_size; i++) {
         PosCode pos = search_pos[i];
-        double dist;
+        double max_dist = th_sse;
+        double dist, score;
+        int j;
 
-        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x);
+        /* A block which does not score better than the worst of a full group
+         * is discarded, so stop computing its distance as soon as it is
+         * sure to be too far. The margin keeps the rejection exact despite
+         * the rounding of the score. */
+        if (index >= s->group_size)
+            max_dist = FFMIN(max_dist, sc->match_blocks[index - 1].score * MSE2SSE * (1. + 1e-6));
 
-        // Only match similar blocks but not identical blocks
-        if (dist <= th_sse && dist != 0) {
-            const double score = dist * distMul;
+        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x, max_dist);
 
-            if (index >= s->group_size && score >= sc->match_blocks[index - 1].score) {
-                continue;
-            }
+        // Only match similar blocks but not identical blocks
+        if (dist > th_sse || dist == 0)
+            continue;
 
-            if (index >= s->group_size)
-                index = s->group_size - 1;
+        score = dist * distMul;
 
-            sc->match_blocks[index].score = score;
-            sc->match_blocks[index].y = pos.y;
-            sc->match_blocks[index].x = pos.x;
-            index++;
-            qsort(sc->match_blocks, index, sizeof(PosPairCode), cmp_scores);
+        if (index >= s->group_size) {
+            if (score >= sc->match_blocks[index - 1].score)
+                continue;
+            index = s->group_size - 1;
         }
+
+        /* insert the block after the ones with the same score, keeping the
+         * blocks sorted */
+        for (j = index; j > 0 && sc->match_blocks[j - 1].score > score; j--)
+            sc->match_blocks[j] = sc->match_blocks[j - 1];
+        sc->match_blocks[j].score = score;
+        sc->match_blocks[j].y = pos.y;
+        sc->match_blocks[j].x = pos.x;
+        index++;
     }
 
     sc->nb_match_blocks = index;
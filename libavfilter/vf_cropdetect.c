@@ -41,6 +41,7 @@ typedef struct CropDetectContext {
     int frame_nb;
     int max_pixsteps[4];
     int max_outliers;
+    int step;
 } CropDetectContext;
 
 static int query_formats(AVFilterContext *ctx)
@@ -166,6 +167,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     AVDictionary **metadata;
     int outliers, last_y;
     int limit = lrint(s->limit);
+    const int step = s->step;
 
     // ignore first 2 frames - they may be empty
     if (++s->frame_nb > 0) {
@@ -192,10 +194,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                 last_y = y INC;\
         }
 
-        FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-        FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
+        // every line is checked, but only one pixel out of step of each line
+        FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp * step, (frame->width  + step - 1) / step);
+        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp * step, (frame->width  + step - 1) / step);
+        FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0] * step, (frame->height + step - 1) / step);
+        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0] * step, (frame->height + step - 1) / step);
 
 
         // round x and y (up), important for yuv colorspaces
@@ -249,6 +252,7 @@ static const AVOption cropdetect_options[] = {
     { "reset", "Recalculate the crop area after this many frames",    OFFSET(reset_count), AV_OPT_TYPE_INT, { .i64 = 0 },  0, INT_MAX, FLAGS },
     { "reset_count", "Recalculate the crop area after this many frames",OFFSET(reset_count),AV_OPT_TYPE_INT,{ .i64 = 0 },  0, INT_MAX, FLAGS },
     { "max_outliers", "Threshold count of outliers",                  OFFSET(max_outliers),AV_OPT_TYPE_INT, { .i64 = 0 },  0, INT_MAX, FLAGS },
+    { "step",  "Spacing of the checked pixels along the lines",       OFFSET(step),        AV_OPT_TYPE_INT, { .i64 = 1 },  1, 64, FLAGS },
     { NULL }
 };
 
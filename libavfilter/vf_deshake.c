@@ -225,6 +225,40 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct MotionThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_cols, nb_rows;      ///< Number of blocks searched per row and column
+} MotionThreadData;
+
+static int find_motion_rows(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData *td = arg;
+    const int start = (td->nb_rows *  jobnr   ) / nb_jobs;
+    const int end   = (td->nb_rows * (jobnr+1)) / nb_jobs;
+    IntMotionVector mv = {0, 0};
+    int i, j, x, y;
+
+    for (i = start; i < end; i++) {
+        y = deshake->ry + i * deshake->blocksize * 2;
+        for (j = 0; j < td->nb_cols; j++) {
+            IntMotionVector *block_mv = &deshake->block_mvs[i * td->nb_cols + j];
+
+            x = deshake->rx + j * 16;
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mv);
+                *block_mv = mv;
+            } else {
+                block_mv->x = block_mv->y = -1;
+            }
+        }
+    }
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,19 +266,32 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData td;
+    int x, y, i, j, nb_jobs;
     int count_max_value = 0;
-    int contrast;
+    // We use a width of 16 here to match the sad function
+    const int x_end = width  - deshake->rx - 16;
+    const int y_end = height - deshake->ry - deshake->blocksize * 2;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
+    td.src1    = src1;
+    td.src2    = src2;
+    td.stride  = stride;
+    td.nb_cols = x_end > deshake->rx ? (x_end - deshake->rx + 15) / 16 : 0;
+    td.nb_rows = y_end > deshake->ry ? (y_end - deshake->ry + deshake->blocksize * 2 - 1) /
+                                       (deshake->blocksize * 2) : 0;
+
     av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    av_fast_malloc(&deshake->block_mvs, &deshake->block_mvs_size, td.nb_rows * td.nb_cols * sizeof(*deshake->block_mvs));
+    if (!deshake->angles || (!deshake->block_mvs && td.nb_rows && td.nb_cols))
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -253,25 +300,31 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // Find motion for every block, split into rows of blocks. Without a
+    // search range the smart search starts from the vector of the previous
+    // block, so the blocks have to be searched in order.
+    nb_jobs = deshake->search == SMART_EXHAUSTIVE && (!deshake->rx || !deshake->ry) ?
+              1 : FFMIN(td.nb_rows, ff_filter_get_nb_threads(ctx));
+    if (nb_jobs > 0)
+        ctx->internal->execute(ctx, find_motion_rows, &td, NULL, nb_jobs);
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    // Store the motion vectors in the counts, in the order of the blocks
+    for (i = 0; i < td.nb_rows; i++) {
+        y = deshake->ry + i * deshake->blocksize * 2;
+        for (j = 0; j < td.nb_cols; j++) {
+            IntMotionVector mv = deshake->block_mvs[i * td.nb_cols + j];
+
+            x = deshake->rx + j * 16;
+            // Honing in can move the vector out of a zero search range
+            if (mv.x != -1 && mv.y != -1 &&
+                FFABS(mv.x) <= deshake->rx && FFABS(mv.y) <= deshake->ry) {
+                deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+
+                center_x += mv.x;
+                center_y += mv.y;
             }
         }
     }
@@ -310,32 +363,62 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
-static int deshake_transform_c(AVFilterContext *ctx,
-                                    int width, int height, int cw, int ch,
-                                    const float *matrix_y, const float *matrix_uv,
-                                    enum InterpolateMethod interpolate,
-                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
-{
-    int i = 0, ret = 0;
+typedef struct TransformThreadData {
+    AVFrame *in, *out;
     const float *matrixs[3];
     int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+} TransformThreadData;
+
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TransformThreadData *td = arg;
+    int i, ret;
 
     for (i = 0; i < 3; i++) {
+        const int start = (td->plane_h[i] *  jobnr   ) / nb_jobs;
+        const int end   = (td->plane_h[i] * (jobnr+1)) / nb_jobs;
+
         // Transform the luma and chroma planes
-        ret = avfilter_transform(in->data[i], out->data[i], in->linesize[i], out->linesize[i],
-                                 plane_w[i], plane_h[i], matrixs[i], interpolate, fill);
+        ret = avfilter_transform_rows(td->in->data[i], td->out->data[i],
+                                      td->in->linesize[i], td->out->linesize[i],
+                                      td->plane_w[i], td->plane_h[i], start, end,
+                                      td->matrixs[i], td->interpolate, td->fill);
         if (ret < 0)
             return ret;
     }
-    return ret;
+    return 0;
+}
+
+static int deshake_transform_c(AVFilterContext *ctx,
+                                    int width, int height, int cw, int ch,
+                                    const float *matrix_y, const float *matrix_uv,
+                                    enum InterpolateMethod interpolate,
+                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
+{
+    TransformThreadData td;
+
+    if ((unsigned)interpolate >= INTERPOLATE_COUNT)
+        return AVERROR(EINVAL);
+
+    td.in  = in;
+    td.out = out;
+    td.matrixs[0] = matrix_y;
+    td.matrixs[1] = td.matrixs[2] = matrix_uv;
+    td.plane_w[0] = width;
+    td.plane_w[1] = td.plane_w[2] = cw;
+    td.plane_h[0] = height;
+    td.plane_h[1] = td.plane_h[2] = ch;
+    td.interpolate = interpolate;
+    td.fill        = fill;
+
+    ctx->internal->execute(ctx, transform_slice, &td, NULL,
+                           FFMIN(ch, ff_filter_get_nb_threads(ctx)));
+    return 0;
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -403,6 +486,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->block_mvs);
+    deshake->block_mvs_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -437,7 +522,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,7 +539,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&out);
+        av_frame_free(&in);
+        return ret;
     }
 
 
@@ -560,4 +650,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -29,6 +29,7 @@
 #include "libavutil/avassert.h"
 #include "avfilter.h"
 #include "dnn_interface.h"
+#include "filters.h"
 #include "formats.h"
 #include "internal.h"
 
@@ -40,6 +41,8 @@ typedef struct DnnProcessingContext {
     enum AVPixelFormat fmt;
     char *model_inputname;
     char *model_outputname;
+    int batch_size;
+    int async;
 
     DNNModule *dnn_module;
     DNNModel *model;
@@ -47,6 +50,16 @@ typedef struct DnnProcessingContext {
     // input & output of the model at execution time
     DNNData input;
     DNNData output;
+
+    // frames of the next batch, and of the batch being executed
+    AVFrame **queued;
+    int nb_queued;
+    AVFrame **running;
+    int nb_running;
+
+    int eof;
+    int eof_status;
+    int64_t eof_pts;
 } DnnProcessingContext;
 
 #define OFFSET(x) offsetof(DnnProcessingContext, x)
@@ -61,6 +74,8 @@ static const AVOption dnn_processing_options[] = {
     { "input",       "input name of the model",    OFFSET(model_inputname),  AV_OPT_TYPE_STRING,    { .str = NULL }, 0, 0, FLAGS },
     { "output",      "output name of the model",   OFFSET(model_outputname), AV_OPT_TYPE_STRING,    { .str = NULL }, 0, 0, FLAGS },
     { "fmt",         "AVPixelFormat of the frame", OFFSET(fmt),              AV_OPT_TYPE_PIXEL_FMT, { .i64=AV_PIX_FMT_RGB24 }, AV_PIX_FMT_NONE, AV_PIX_FMT_NB - 1, FLAGS },
+    { "batch_size",  "number of frames processed by one execution", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, 1024, FLAGS },
+    { "async",       "execute the model in the background while the next frames are read", OFFSET(async), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -116,6 +131,11 @@ static av_cold int init(AVFilterContext *context)
         return AVERROR(EINVAL);
     }
 
+    ctx->queued  = av_calloc(ctx->batch_size, sizeof(*ctx->queued));
+    ctx->running = av_calloc(ctx->batch_size, sizeof(*ctx->running));
+    if (!ctx->queued || !ctx->running)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -165,11 +185,17 @@ static int config_input(AVFilterLink *inlink)
         av_log(ctx, AV_LOG_ERROR, "only support dnn models with input data type as float32 and uint8.\n");
         return AVERROR(EIO);
     }
+    if (model_input.batch_size != -1 && FFMAX(model_input.batch_size, 1) != ctx->batch_size) {
+        av_log(ctx, AV_LOG_ERROR, "the model requires batch size %d but got %d\n",
+                                   model_input.batch_size, ctx->batch_size);
+        return AVERROR(EIO);
+    }
 
     ctx->input.width    = inlink->w;
     ctx->input.height   = inlink->h;
     ctx->input.channels = model_input.channels;
     ctx->input.dt = model_input.dt;
+    ctx->input.batch_size = ctx->batch_size;
 
     result = (ctx->model->set_input_output)(ctx->model->model,
                                         &ctx->input, ctx->model_inputname,
@@ -201,13 +227,15 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
-static int copy_from_frame_to_dnn(DNNData *dnn_input, const AVFrame *frame)
+static int copy_from_frame_to_dnn(DNNData *dnn_input, const AVFrame *frame, int index)
 {
+    size_t offset = (size_t)index * frame->height * frame->width * 3;
+
     // extend this function to support more formats
     av_assert0(frame->format == AV_PIX_FMT_RGB24 || frame->format == AV_PIX_FMT_BGR24);
 
     if (dnn_input->dt == DNN_FLOAT) {
-        float *dnn_input_data = dnn_input->data;
+        float *dnn_input_data = (float *)dnn_input->data + offset;
         for (int i = 0; i < frame->height; i++) {
             for(int j = 0; j < frame->width * 3; j++) {
                 int k = i * frame->linesize[0] + j;
@@ -216,7 +244,7 @@ static int copy_from_frame_to_dnn(DNNData *dnn_input, const AVFrame *frame)
             }
         }
     } else {
-        uint8_t *dnn_input_data = dnn_input->data;
+        uint8_t *dnn_input_data = (uint8_t *)dnn_input->data + offset;
         av_assert0(dnn_input->dt == DNN_UINT8);
         for (int i = 0; i < frame->height; i++) {
             for(int j = 0; j < frame->width * 3; j++) {
@@ -230,13 +258,15 @@ static int copy_from_frame_to_dnn(DNNData *dnn_input, const AVFrame *frame)
     return 0;
 }
 
-static int copy_from_dnn_to_frame(AVFrame *frame, const DNNData *dnn_output)
+static int copy_from_dnn_to_frame(AVFrame *frame, const DNNData *dnn_output, int index)
 {
+    size_t offset = (size_t)index * frame->height * frame->width * 3;
+
     // extend this function to support more formats
     av_assert0(frame->format == AV_PIX_FMT_RGB24 || frame->format == AV_PIX_FMT_BGR24);
 
     if (dnn_output->dt == DNN_FLOAT) {
-        float *dnn_output_data = dnn_output->data;
+        float *dnn_output_data = (float *)dnn_output->data + offset;
         for (int i = 0; i < frame->height; i++) {
             for(int j = 0; j < frame->width * 3; j++) {
                 int k = i * frame->linesize[0] + j;
@@ -245,7 +275,7 @@ static int copy_from_dnn_to_frame(AVFrame *frame, const DNNData *dnn_output)
             }
         }
     } else {
-        uint8_t *dnn_output_data = dnn_output->data;
+        uint8_t *dnn_output_data = (uint8_t *)dnn_output->data + offset;
         av_assert0(dnn_output->dt == DNN_UINT8);
         for (int i = 0; i < frame->height; i++) {
             for(int j = 0; j < frame->width * 3; j++) {
@@ -259,34 +289,128 @@ static int copy_from_dnn_to_frame(AVFrame *frame, const DNNData *dnn_output)
     return 0;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+// sends the frames of the executed batch
+static int output_batch(AVFilterContext *context)
 {
-    AVFilterContext *context  = inlink->dst;
     AVFilterLink *outlink = context->outputs[0];
+    DnnProcessingContext *ctx = context->priv;
+    int i, ret = 0;
+
+    av_assert0(ctx->output.channels == 3);
+
+    for (i = 0; i < ctx->nb_running && ret >= 0; i++) {
+        AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+
+        av_frame_copy_props(out, ctx->running[i]);
+        copy_from_dnn_to_frame(out, &ctx->output, i);
+        av_frame_free(&ctx->running[i]);
+        ret = ff_filter_frame(outlink, out);
+    }
+    for (; i < ctx->nb_running; i++)
+        av_frame_free(&ctx->running[i]);
+    ctx->nb_running = 0;
+
+    return ret;
+}
+
+// executes the queued frames, in the background if async is set
+static int execute_batch(AVFilterContext *context)
+{
     DnnProcessingContext *ctx = context->priv;
     DNNReturnType dnn_result;
-    AVFrame *out;
+    AVFrame **tmp;
+
+    for (int i = 0; i < ctx->nb_queued; i++)
+        copy_from_frame_to_dnn(&ctx->input, ctx->queued[i], i);
 
-    copy_from_frame_to_dnn(&ctx->input, in);
+    tmp = ctx->running;
+    ctx->running    = ctx->queued;
+    ctx->nb_running = ctx->nb_queued;
+    ctx->queued     = tmp;
+    ctx->nb_queued  = 0;
 
-    dnn_result = (ctx->dnn_module->execute_model)(ctx->model, &ctx->output, 1);
+    if (ctx->async)
+        dnn_result = (ctx->dnn_module->execute_model_async)(ctx->model, &ctx->output, 1);
+    else
+        dnn_result = (ctx->dnn_module->execute_model)(ctx->model, &ctx->output, 1);
     if (dnn_result != DNN_SUCCESS){
         av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
-        av_frame_free(&in);
         return AVERROR(EIO);
     }
-    av_assert0(ctx->output.channels == 3);
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!out) {
-        av_frame_free(&in);
-        return AVERROR(ENOMEM);
+    return ctx->async ? 0 : output_batch(context);
+}
+
+// retrieves the batch executed in the background, returns 0 if it is not done
+static int get_batch(AVFilterContext *context, int wait)
+{
+    DnnProcessingContext *ctx = context->priv;
+    DNNAsyncStatusType status;
+
+    status = (ctx->dnn_module->get_async_result)(ctx->model, wait);
+    if (status == DAST_NOT_READY)
+        return 0;
+    if (status != DAST_SUCCESS) {
+        av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+        return AVERROR(EIO);
     }
 
-    av_frame_copy_props(out, in);
-    copy_from_dnn_to_frame(out, &ctx->output);
-    av_frame_free(&in);
-    return ff_filter_frame(outlink, out);
+    return output_batch(context);
+}
+
+static int activate(AVFilterContext *context)
+{
+    AVFilterLink *inlink  = context->inputs[0];
+    AVFilterLink *outlink = context->outputs[0];
+    DnnProcessingContext *ctx = context->priv;
+    int ret, full;
+    AVFrame *in;
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    while (ctx->nb_queued < ctx->batch_size) {
+        ret = ff_inlink_consume_frame(inlink, &in);
+        if (ret < 0)
+            return ret;
+        if (!ret)
+            break;
+        ctx->queued[ctx->nb_queued++] = in;
+    }
+
+    if (!ctx->eof && ff_inlink_acknowledge_status(inlink, &ctx->eof_status, &ctx->eof_pts))
+        ctx->eof = 1;
+
+    // the last batch is executed even if it is not full
+    full = ctx->nb_queued == ctx->batch_size || ctx->eof;
+
+    // wait for the batch in flight only when the next one can be started
+    if (ctx->nb_running) {
+        ret = get_batch(context, full);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!ctx->nb_running && ctx->nb_queued && full) {
+        ret = execute_batch(context);
+        if (ret < 0)
+            return ret;
+        // carry on with the frames already queued in the link, or the flush
+        ff_filter_set_ready(context, 100);
+        return 0;
+    }
+
+    if (ctx->eof && !ctx->nb_running && !ctx->nb_queued) {
+        ff_outlink_set_status(outlink, ctx->eof_status, ctx->eof_pts);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+    return FFERROR_NOT_READY;
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -297,6 +421,13 @@ static av_cold void uninit(AVFilterContext *ctx)
         (context->dnn_module->free_model)(&context->model);
 
     av_freep(&context->dnn_module);
+
+    for (int i = 0; i < context->nb_queued; i++)
+        av_frame_free(&context->queued[i]);
+    for (int i = 0; i < context->nb_running; i++)
+        av_frame_free(&context->running[i]);
+    av_freep(&context->queued);
+    av_freep(&context->running);
 }
 
 static const AVFilterPad dnn_processing_inputs[] = {
@@ -304,7 +435,6 @@ static const AVFilterPad dnn_processing_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .config_props = config_input,
-        .filter_frame = filter_frame,
     },
     { NULL }
 };
@@ -325,6 +455,7 @@ AVFilter ff_vf_dnn_processing = {
     .init          = init,
     .uninit        = uninit,
     .query_formats = query_formats,
+    .activate      = activate,
     .inputs        = dnn_processing_inputs,
     .outputs       = dnn_processing_outputs,
     .priv_class    = &dnn_processing_class,
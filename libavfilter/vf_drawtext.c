@@ -160,6 +160,13 @@ typedef struct DrawTextContext {
     int y;                          ///< y position to start drawing text
     int max_glyph_w;                ///< max glyph width
     int max_glyph_h;                ///< max glyph height
+    int text_w, text_h;             ///< size of the laid out text
+    int ascent, descent;            ///< max ascent and min descent of the glyphs
+    int glyph_y0, glyph_y1;         ///< vertical extent of the glyph bitmaps
+    int border_y0, border_y1;       ///< vertical extent of the border bitmaps
+    AVBPrint layout_text;           ///< text the positions were computed for
+    unsigned int layout_fontsize;   ///< font size the positions were computed for
+    int layout_valid;               ///< positions and text metrics are up to date
     int shadowx, shadowy;
     int borderw;                    ///< border width
     char *fontsize_expr;            ///< expression for fontsize
@@ -780,6 +787,7 @@ static av_cold int init(AVFilterContext *ctx)
 
     av_bprint_init(&s->expanded_text, 0, AV_BPRINT_SIZE_UNLIMITED);
     av_bprint_init(&s->expanded_fontcolor, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_init(&s->layout_text, 0, AV_BPRINT_SIZE_UNLIMITED);
 
     return 0;
 }
@@ -823,6 +831,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_bprint_finalize(&s->expanded_text, NULL);
     av_bprint_finalize(&s->expanded_fontcolor, NULL);
+    av_bprint_finalize(&s->layout_text, NULL);
 }
 
 static int config_input(AVFilterLink *inlink)
@@ -1211,10 +1220,10 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+static void draw_glyphs(DrawTextContext *s, uint8_t *data[4], int linesize[4],
+                        int width, int height, int slice_y,
+                        FFDrawColor *color,
+                        int x, int y, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
@@ -1228,7 +1237,7 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
         GET_UTF8(code, *p++, continue;);
 
         /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (is_newline(code) || code == '\t')
             continue;
 
         dummy.code = code;
@@ -1237,22 +1246,16 @@ static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
 
         bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
-
         x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+        y1 = s->positions[i].y+s->y+y - borderw - slice_y;
 
         ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
+                      data, linesize, width, height,
                       bitmap.buffer, bitmap.pitch,
                       bitmap.width, bitmap.rows,
                       bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
                       0, x1, y1);
     }
-
-    return 0;
 }
 
 
@@ -1278,17 +1281,18 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+/**
+ * Load the glyphs of the expanded text and compute their positions and the
+ * text metrics. Nothing is done if the text and the font size did not change
+ * since the last call.
+ */
+static int layout_text(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
-
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text;
+    char *text = s->expanded_text.str;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -1296,44 +1300,12 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
-
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
-
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
+    if (s->layout_valid && s->layout_fontsize == s->fontsize &&
+        s->layout_text.len == s->expanded_text.len &&
+        !memcmp(s->layout_text.str, text, s->expanded_text.len))
+        return 0;
+    s->layout_valid = 0;
 
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
@@ -1341,26 +1313,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->nb_positions = len;
     }
 
-    if (s->fontcolor_expr[0]) {
-        /* If expression is set, evaluate and replace the static value */
-        av_bprint_clear(&s->expanded_fontcolor);
-        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
-            return ret;
-        if (!av_bprint_is_complete(&s->expanded_fontcolor))
-            return AVERROR(ENOMEM);
-        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
-        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
-        if (ret)
-            return ret;
-        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
-    }
-
-    x = 0;
-    y = 0;
-
-    if ((ret = update_fontsize(ctx)) < 0)
-        return ret;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
@@ -1375,6 +1327,11 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
                 return ret;
         }
 
+        if (!is_newline(code) && code != '\t' &&
+            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+            return AVERROR(EINVAL);
+
         y_min = FFMIN(glyph->bbox.yMin, y_min);
         y_max = FFMAX(glyph->bbox.yMax, y_max);
         x_min = FFMIN(glyph->bbox.xMin, x_min);
@@ -1383,6 +1340,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     s->max_glyph_h = y_max - y_min;
     s->max_glyph_w = x_max - x_min;
 
+    s->glyph_y0 = s->border_y0 = INT_MAX;
+    s->glyph_y1 = s->border_y1 = INT_MIN;
+
     /* compute and save position for each glyph */
     glyph = NULL;
     for (i = 0, p = text; *p; i++) {
@@ -1419,17 +1379,166 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->positions[i].y = y - glyph->bitmap_top + y_max;
         if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
         else              x += glyph->advance;
+
+        if (code != '\t') {
+            s->glyph_y0 = FFMIN(s->glyph_y0, s->positions[i].y);
+            s->glyph_y1 = FFMAX(s->glyph_y1, s->positions[i].y + (int)glyph->bitmap.rows);
+            if (s->borderw) {
+                s->border_y0 = FFMIN(s->border_y0, s->positions[i].y);
+                s->border_y1 = FFMAX(s->border_y1, s->positions[i].y + (int)glyph->border_bitmap.rows);
+            }
+        }
+    }
+
+    s->text_w  = FFMAX(x, max_text_line_w);
+    s->text_h  = y + s->max_glyph_h;
+    s->ascent  = y_max;
+    s->descent = y_min;
+
+    av_bprint_clear(&s->layout_text);
+    av_bprint_append_data(&s->layout_text, text, s->expanded_text.len);
+    if (!av_bprint_is_complete(&s->layout_text))
+        return AVERROR(ENOMEM);
+    s->layout_fontsize = s->fontsize;
+    s->layout_valid    = 1;
+
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    int width, height;
+    int y_start, y_end;             ///< rows touched by the drawing, aligned
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+} ThreadData;
+
+/**
+ * Draw the box and the text on a band of rows of the frame. The bands start
+ * on chroma row boundaries so that each job blends whole subsampled rows,
+ * and each job draws the layers in the same order as a single pass would.
+ */
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    const int align = 1 << s->dc.vsub_max;
+    const int nb_units = (td->y_end - td->y_start + align - 1) / align;
+    const int slice_start = td->y_start + (nb_units *  jobnr     ) / nb_jobs * align;
+    const int slice_end   = FFMIN(td->y_start + (nb_units * (jobnr + 1)) / nb_jobs * align,
+                                  td->height);
+    uint8_t *data[4] = { NULL };
+    int plane;
+
+    if (slice_start >= slice_end)
+        return 0;
+
+    for (plane = 0; plane < s->dc.nb_planes; plane++)
+        data[plane] = frame->data[plane] +
+                      (slice_start >> s->dc.vsub[plane]) * frame->linesize[plane];
+
+    /* draw box */
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, &td->boxcolor,
+                           data, frame->linesize, td->width, slice_end - slice_start,
+                           s->x - s->boxborderw, s->y - s->boxborderw - slice_start,
+                           s->text_w + s->boxborderw * 2, s->text_h + s->boxborderw * 2);
+
+    if (s->shadowx || s->shadowy)
+        draw_glyphs(s, data, frame->linesize, td->width, slice_end - slice_start,
+                    slice_start, &td->shadowcolor, s->shadowx, s->shadowy, 0);
+
+    if (s->borderw)
+        draw_glyphs(s, data, frame->linesize, td->width, slice_end - slice_start,
+                    slice_start, &td->bordercolor, 0, 0, s->borderw);
+
+    draw_glyphs(s, data, frame->linesize, td->width, slice_end - slice_start,
+                slice_start, &td->fontcolor, 0, 0, 0);
+
+    return 0;
+}
+
+static void extend_rows(int *y0, int *y1, int64_t start, int64_t end)
+{
+    if (start >= end)
+        return;
+    *y0 = FFMIN(*y0, av_clip64(start, INT_MIN, INT_MAX));
+    *y1 = FFMAX(*y1, av_clip64(end,   INT_MIN, INT_MAX));
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData td;
+    int ret, y0, y1, align, nb_jobs;
+    int box_w, box_h;
+    int64_t ys;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
     }
 
-    max_text_line_w = FFMAX(x, max_text_line_w);
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
 
-    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
-    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+
+    if (s->fontcolor_expr[0]) {
+        /* If expression is set, evaluate and replace the static value */
+        av_bprint_clear(&s->expanded_fontcolor);
+        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
+            return ret;
+        if (!av_bprint_is_complete(&s->expanded_fontcolor))
+            return AVERROR(ENOMEM);
+        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
+        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
+        if (ret)
+            return ret;
+        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
+    }
+
+    if ((ret = update_fontsize(ctx)) < 0)
+        return ret;
+
+    if ((ret = layout_text(ctx)) < 0)
+        return ret;
+
+    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = s->text_w;
+    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = s->text_h;
 
     s->var_values[VAR_MAX_GLYPH_W] = s->max_glyph_w;
     s->var_values[VAR_MAX_GLYPH_H] = s->max_glyph_h;
-    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = y_max;
-    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = y_min;
+    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = s->ascent;
+    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = s->descent;
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
@@ -1439,13 +1548,13 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
 
     update_alpha(s);
-    update_color_with_alpha(s, &fontcolor  , s->fontcolor  );
-    update_color_with_alpha(s, &shadowcolor, s->shadowcolor);
-    update_color_with_alpha(s, &bordercolor, s->bordercolor);
-    update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
+    update_color_with_alpha(s, &td.fontcolor  , s->fontcolor  );
+    update_color_with_alpha(s, &td.shadowcolor, s->shadowcolor);
+    update_color_with_alpha(s, &td.bordercolor, s->bordercolor);
+    update_color_with_alpha(s, &td.boxcolor   , s->boxcolor   );
 
-    box_w = max_text_line_w;
-    box_h = y + s->max_glyph_h;
+    box_w = s->text_w;
+    box_h = s->text_h;
 
     if (s->fix_bounds) {
 
@@ -1473,27 +1582,32 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
             s->y = FFMAX(height - box_h - offsetbottom, 0);
     }
 
-    /* draw box */
+    /* find the rows touched by the box and the glyph layers */
+    y0 = INT_MAX;
+    y1 = INT_MIN;
+    ys = s->y;
     if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
+        extend_rows(&y0, &y1, ys - s->boxborderw, ys + box_h + s->boxborderw);
+    if (s->shadowx || s->shadowy)
+        extend_rows(&y0, &y1, ys + s->shadowy + s->glyph_y0,
+                              ys + s->shadowy + s->glyph_y1);
+    if (s->borderw)
+        extend_rows(&y0, &y1, ys - s->borderw + s->border_y0,
+                              ys - s->borderw + s->border_y1);
+    extend_rows(&y0, &y1, ys + s->glyph_y0, ys + s->glyph_y1);
+    align = 1 << s->dc.vsub_max;
+    y0 = FFMAX(y0, 0) & ~(align - 1);
+    y1 = FFMIN(y1, height);
+    if (y0 >= y1)
+        return 0;
 
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    td.frame   = frame;
+    td.width   = width;
+    td.height  = height;
+    td.y_start = y0;
+    td.y_end   = y1;
+    nb_jobs = FFMIN((y1 - y0 + align - 1) / align, ff_filter_get_nb_threads(ctx));
+    ctx->internal->execute(ctx, draw_text_slice, &td, NULL, nb_jobs);
 
     return 0;
 }
@@ -1569,5 +1683,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
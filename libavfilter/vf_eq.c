@@ -293,7 +293,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         if (eq->param[i].adjust)
             eq->param[i].adjust(&eq->param[i], out->data[i], out->linesize[i],
                                  in->data[i], in->linesize[i], w, h);
-        else
+        else if (ff_video_frame_ref_plane(out, in, i) < 0)
             av_image_copy_plane(out->data[i], out->linesize[i],
                                 in->data[i], in->linesize[i], w, h);
     }
@@ -244,18 +244,26 @@ static int write_frame(AVFilterContext *ctx, FPSContext *s, AVFilterLink *outlin
         *again = 1;
         return 0;
 
-    /* Output a copy of the first buffered frame */
+    /* Output the first buffered frame, or a copy of it if it is output again
+     * after this one */
     } else {
-        frame = av_frame_clone(s->frames[0]);
-        if (!frame)
-            return AVERROR(ENOMEM);
-        // Make sure Closed Captions will not be duplicated
-        av_frame_remove_side_data(s->frames[0], AV_FRAME_DATA_A53_CC);
+        int64_t in_pts = s->frames[0]->pts;
+
+        s->cur_frame_out++;
+        if ((s->frames_count == 2 && s->frames[1]->pts <= s->next_pts + 1) ||
+            (s->status            && s->status_pts     <= s->next_pts + 1)) {
+            frame = shift_frame(ctx, s);
+        } else {
+            frame = av_frame_clone(s->frames[0]);
+            if (!frame)
+                return AVERROR(ENOMEM);
+            // Make sure Closed Captions will not be duplicated
+            av_frame_remove_side_data(s->frames[0], AV_FRAME_DATA_A53_CC);
+        }
         frame->pts = s->next_pts++;
 
         av_log(ctx, AV_LOG_DEBUG, "Writing frame with pts %"PRId64" to pts %"PRId64"\n",
-               s->frames[0]->pts, frame->pts);
-        s->cur_frame_out++;
+               in_pts, frame->pts);
         *again = 1;
         return ff_filter_frame(outlink, frame);
     }
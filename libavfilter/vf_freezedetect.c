@@ -29,6 +29,7 @@
 
 #include "avfilter.h"
 #include "filters.h"
+#include "internal.h"
 #include "scene_sad.h"
 
 typedef struct FreezeDetectContext {
@@ -45,6 +46,10 @@ typedef struct FreezeDetectContext {
 
     double noise;
     int64_t duration;            ///< minimum duration of frozen frame until notification
+    int step;                    ///< spacing of the analyzed rows
+
+    uint64_t *sad_jobs;          ///< SAD computed by every job
+    int nb_threads;
 } FreezeDetectContext;
 
 #define OFFSET(x) offsetof(FreezeDetectContext, x)
@@ -56,6 +61,7 @@ static const AVOption freezedetect_options[] = {
     { "noise",               "set noise tolerance",                       OFFSET(noise),  AV_OPT_TYPE_DOUBLE,   {.dbl=0.001},     0,       1.0, V|F },
     { "d",                   "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
     { "duration",            "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
+    { "step",                "set the spacing of the analyzed rows",       OFFSET(step),  AV_OPT_TYPE_INT,      {.i64=1},         1,        64, V|F },
 
     {NULL}
 };
@@ -115,6 +121,12 @@ static int config_input(AVFilterLink *inlink)
     if (!s->sad)
         return AVERROR(EINVAL);
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    av_freep(&s->sad_jobs);
+    s->sad_jobs = av_calloc(s->nb_threads, sizeof(*s->sad_jobs));
+    if (!s->sad_jobs)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -122,24 +134,59 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     FreezeDetectContext *s = ctx->priv;
     av_frame_free(&s->reference_frame);
+    av_freep(&s->sad_jobs);
 }
 
-static int is_frozen(FreezeDetectContext *s, AVFrame *reference, AVFrame *frame)
+typedef struct ThreadData {
+    AVFrame *reference, *frame;
+} ThreadData;
+
+static int sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FreezeDetectContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int step = s->step;
     uint64_t sad = 0;
-    uint64_t count = 0;
-    double mafd;
+
     for (int plane = 0; plane < 4; plane++) {
         if (s->width[plane]) {
+            const int nb_rows = (s->height[plane] + step - 1) / step;
+            const int slice_start = (nb_rows *  jobnr     ) / nb_jobs;
+            const int slice_end   = (nb_rows * (jobnr + 1)) / nb_jobs;
+            const ptrdiff_t linesize = td->frame->linesize[plane];
+            const ptrdiff_t ref_linesize = td->reference->linesize[plane];
             uint64_t plane_sad;
-            s->sad(frame->data[plane], frame->linesize[plane],
-                   reference->data[plane], reference->linesize[plane],
-                   s->width[plane], s->height[plane], &plane_sad);
+
+            if (slice_start >= slice_end)
+                continue;
+            s->sad(td->frame->data[plane] + slice_start * step * linesize, linesize * step,
+                   td->reference->data[plane] + slice_start * step * ref_linesize, ref_linesize * step,
+                   s->width[plane], slice_end - slice_start, &plane_sad);
             sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
         }
     }
     emms_c();
+    s->sad_jobs[jobnr] = sad;
+
+    return 0;
+}
+
+static int is_frozen(AVFilterContext *ctx, AVFrame *reference, AVFrame *frame)
+{
+    FreezeDetectContext *s = ctx->priv;
+    ThreadData td = { .reference = reference, .frame = frame };
+    const int nb_jobs = FFMAX(1, FFMIN((s->height[0] + s->step - 1) / s->step, s->nb_threads));
+    uint64_t sad = 0;
+    uint64_t count = 0;
+    double mafd;
+
+    ctx->internal->execute(ctx, sad_slice, &td, NULL, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++)
+        sad += s->sad_jobs[i];
+    for (int plane = 0; plane < 4; plane++) {
+        if (s->width[plane])
+            count += s->width[plane] * ((s->height[plane] + s->step - 1) / s->step);
+    }
     mafd = (double)sad / count / (1ULL << s->bitdepth);
     return (mafd <= s->noise);
 }
@@ -175,7 +222,7 @@ static int activate(AVFilterContext *ctx)
             else
                 duration = av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
 
-            frozen = is_frozen(s, s->reference_frame, frame);
+            frozen = is_frozen(ctx, s->reference_frame, frame);
             if (duration >= s->duration) {
                 if (!s->frozen)
                     set_meta(s, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
@@ -232,4 +279,5 @@ AVFilter ff_vf_freezedetect = {
     .inputs        = freezedetect_inputs,
     .outputs       = freezedetect_outputs,
     .activate      = activate,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
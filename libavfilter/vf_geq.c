@@ -60,6 +60,9 @@ typedef struct GEQContext {
 
     double *pixel_sums[NB_PLANES];
     int needs_sum[NB_PLANES];
+
+    double *xs;                 ///< values of X along a line
+    double *results;            ///< one line of expression results per job
 } GEQContext;
 
 enum { Y = 0, U, V, A, G, B, R };
@@ -347,6 +350,7 @@ static int geq_config_props(AVFilterLink *inlink)
 {
     GEQContext *geq = inlink->dst->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     av_assert0(desc);
 
@@ -354,6 +358,15 @@ static int geq_config_props(AVFilterLink *inlink)
     geq->vsub = desc->log2_chroma_h;
     geq->bps = desc->comp[0].depth;
     geq->planes = desc->nb_components;
+
+    av_freep(&geq->xs);
+    av_freep(&geq->results);
+    geq->xs      = av_malloc_array(inlink->w, sizeof(*geq->xs));
+    geq->results = av_malloc_array(inlink->w, ff_filter_get_nb_threads(inlink->dst) * sizeof(*geq->results));
+    if (!geq->xs || !geq->results)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < inlink->w; i++)
+        geq->xs[i] = i;
     return 0;
 }
 
@@ -374,7 +387,9 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     const int linesize = td->linesize;
     const int slice_start = (height *  jobnr) / nb_jobs;
     const int slice_end = (height * (jobnr+1)) / nb_jobs;
-    int x, y;
+    double *results = geq->results + jobnr * width;
+    const double *var_arrays[VAR_VARS_NB] = { [VAR_X] = geq->xs };
+    int x, y, ret;
     uint8_t *ptr;
     uint16_t *ptr16;
 
@@ -385,27 +400,30 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     values[VAR_SW] = geq->values[VAR_SW];
     values[VAR_SH] = geq->values[VAR_SH];
     values[VAR_T] = geq->values[VAR_T];
+    values[VAR_X] = 0;
 
     if (geq->bps == 8) {
         for (y = slice_start; y < slice_end; y++) {
             ptr = geq->dst + linesize * y;
             values[VAR_Y] = y;
 
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr[x] = av_expr_eval(geq->e[plane], values, geq);
-            }
-            ptr += linesize;
+            ret = av_expr_eval_array(geq->e[plane], results, width, values, var_arrays, geq);
+            if (ret < 0)
+                return ret;
+            for (x = 0; x < width; x++)
+                ptr[x] = results[x];
         }
     }
     else {
         for (y = slice_start; y < slice_end; y++) {
             ptr16 = geq->dst16 + (linesize/2) * y;
             values[VAR_Y] = y;
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr16[x] = av_expr_eval(geq->e[plane], values, geq);
-            }
+
+            ret = av_expr_eval_array(geq->e[plane], results, width, values, var_arrays, geq);
+            if (ret < 0)
+                return ret;
+            for (x = 0; x < width; x++)
+                ptr16[x] = results[x];
         }
     }
 
@@ -470,6 +488,8 @@ static av_cold void geq_uninit(AVFilterContext *ctx)
         av_expr_free(geq->e[i]);
     for (i = 0; i < NB_PLANES; i++)
         av_freep(&geq->pixel_sums);
+    av_freep(&geq->xs);
+    av_freep(&geq->results);
 }
 
 static const AVFilterPad geq_inputs[] = {
@@ -436,11 +436,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *inpic)
         create_luma_lut(hue);
 
     if (!direct) {
-        if (!hue->brightness)
+        if (!hue->brightness && ff_video_frame_ref_plane(outpic, inpic, 0) < 0)
             av_image_copy_plane(outpic->data[0], outpic->linesize[0],
                                 inpic->data[0],   inpic->linesize[0],
                                 inlink->w * bps, inlink->h);
-        if (inpic->data[3])
+        if (inpic->data[3] && ff_video_frame_ref_plane(outpic, inpic, 3) < 0)
             av_image_copy_plane(outpic->data[3], outpic->linesize[3],
                                 inpic->data[3],   inpic->linesize[3],
                                 inlink->w * bps, inlink->h);
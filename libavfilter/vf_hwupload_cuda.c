@@ -18,22 +18,48 @@
 
 #include "libavutil/buffer.h"
 #include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_cuda_internal.h"
+#include "libavutil/cuda_check.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
 
+#define MAX_QUEUE_DEPTH 16
+
+/**
+ * Page-locked staging buffer. The copy out of it is asynchronous, so it
+ * can only be reused once its event has completed.
+ */
+typedef struct CudaStagingBuffer {
+    uint8_t *host;
+    CUevent  event;
+    int      pending;
+} CudaStagingBuffer;
+
 typedef struct CudaUploadContext {
     const AVClass *class;
     int device_idx;
+    int queue_depth;
 
     AVBufferRef *hwdevice;
     AVBufferRef *hwframe;
+
+    CudaStagingBuffer staging[MAX_QUEUE_DEPTH];
+    int nb_staging;
+    int next_staging;
+    uint8_t *staging_data[4];
+    int      staging_linesize[4];
+    int      staging_size;
 } CudaUploadContext;
 
+#define CHECK_CU(x) FF_CUDA_CHECK_DL(ctx, hwctx->internal->cuda_dl, x)
+
 static av_cold int cudaupload_init(AVFilterContext *ctx)
 {
     CudaUploadContext *s = ctx->priv;
@@ -44,10 +70,88 @@ static av_cold int cudaupload_init(AVFilterContext *ctx)
     return av_hwdevice_ctx_create(&s->hwdevice, AV_HWDEVICE_TYPE_CUDA, buf, NULL, 0);
 }
 
+static void cudaupload_free_staging(AVFilterContext *ctx)
+{
+    CudaUploadContext          *s = ctx->priv;
+    AVHWDeviceContext *device_ctx = (AVHWDeviceContext*)s->hwdevice->data;
+    AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
+    CudaFunctions             *cu = hwctx->internal->cuda_dl;
+    CUcontext dummy;
+    int i;
+
+    if (!s->nb_staging)
+        return;
+
+    if (CHECK_CU(cu->cuCtxPushCurrent(hwctx->cuda_ctx)) < 0)
+        return;
+
+    for (i = 0; i < s->nb_staging; i++) {
+        CudaStagingBuffer *buf = &s->staging[i];
+        if (buf->event) {
+            if (buf->pending)
+                CHECK_CU(cu->cuEventSynchronize(buf->event));
+            CHECK_CU(cu->cuEventDestroy(buf->event));
+        }
+        if (buf->host)
+            CHECK_CU(cu->cuMemFreeHost(buf->host));
+    }
+    memset(s->staging, 0, sizeof(s->staging));
+    s->nb_staging   = 0;
+    s->next_staging = 0;
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+}
+
+static int cudaupload_alloc_staging(AVFilterContext *ctx,
+                                    enum AVPixelFormat format, int w, int h)
+{
+    CudaUploadContext          *s = ctx->priv;
+    AVHWDeviceContext *device_ctx = (AVHWDeviceContext*)s->hwdevice->data;
+    AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
+    CudaFunctions             *cu = hwctx->internal->cuda_dl;
+    CUcontext dummy;
+    int i, ret;
+
+    ret = av_image_fill_linesizes(s->staging_linesize, format, FFALIGN(w, 32));
+    if (ret < 0)
+        return ret;
+
+    ret = av_image_fill_pointers(s->staging_data, format, h, NULL,
+                                 s->staging_linesize);
+    if (ret < 0)
+        return ret;
+    s->staging_size = ret;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(hwctx->cuda_ctx));
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < s->queue_depth; i++) {
+        CudaStagingBuffer *buf = &s->staging[i];
+
+        s->nb_staging++;
+        ret = CHECK_CU(cu->cuMemAllocHost((void**)&buf->host, s->staging_size));
+        if (ret < 0)
+            break;
+        ret = CHECK_CU(cu->cuEventCreate(&buf->event, CU_EVENT_DISABLE_TIMING));
+        if (ret < 0)
+            break;
+    }
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+
+    if (ret < 0)
+        cudaupload_free_staging(ctx);
+    return ret;
+}
+
 static av_cold void cudaupload_uninit(AVFilterContext *ctx)
 {
     CudaUploadContext *s = ctx->priv;
 
+    if (s->hwdevice)
+        cudaupload_free_staging(ctx);
+
     av_buffer_unref(&s->hwframe);
     av_buffer_unref(&s->hwdevice);
 }
@@ -109,13 +213,95 @@ static int cudaupload_config_output(AVFilterLink *outlink)
     if (!outlink->hw_frames_ctx)
         return AVERROR(ENOMEM);
 
+    cudaupload_free_staging(ctx);
+    if (s->queue_depth) {
+        ret = cudaupload_alloc_staging(ctx, inlink->format, inlink->w, inlink->h);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
+/**
+ * Copy the frame into the next page-locked staging buffer and queue its
+ * transfer to the device on the device stream. Work submitted later to
+ * the same stream is ordered after the copy, so the output frame can be
+ * passed on immediately; only the staging buffer has to be waited for
+ * before it is reused, which lets up to queue_depth copies overlap with
+ * the rest of the pipeline.
+ */
+static int cudaupload_transfer_staged(AVFilterContext *ctx, AVFrame *out,
+                                      const AVFrame *in)
+{
+    CudaUploadContext          *s = ctx->priv;
+    AVHWDeviceContext *device_ctx = (AVHWDeviceContext*)s->hwdevice->data;
+    AVCUDADeviceContext    *hwctx = device_ctx->hwctx;
+    CudaFunctions             *cu = hwctx->internal->cuda_dl;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(in->format);
+    CudaStagingBuffer        *buf = &s->staging[s->next_staging];
+    uint8_t *data[4];
+    int widths[4];
+    CUcontext dummy;
+    int i, ret;
+
+    ret = av_image_fill_linesizes(widths, in->format, in->width);
+    if (ret < 0)
+        return ret;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(hwctx->cuda_ctx));
+    if (ret < 0)
+        return ret;
+
+    if (buf->pending) {
+        ret = CHECK_CU(cu->cuEventSynchronize(buf->event));
+        if (ret < 0)
+            goto exit;
+        buf->pending = 0;
+    }
+
+    for (i = 0; i < 4; i++)
+        data[i] = s->staging_data[i] ? buf->host + (s->staging_data[i] - s->staging_data[0]) : NULL;
+
+    av_image_copy(data, s->staging_linesize,
+                  (const uint8_t**)in->data, in->linesize,
+                  in->format, in->width, in->height);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(data) && data[i] && out->data[i]; i++) {
+        int vsub = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+        CUDA_MEMCPY2D cpy = {
+            .srcMemoryType = CU_MEMORYTYPE_HOST,
+            .dstMemoryType = CU_MEMORYTYPE_DEVICE,
+            .srcHost       = data[i],
+            .dstDevice     = (CUdeviceptr)out->data[i],
+            .srcPitch      = s->staging_linesize[i],
+            .dstPitch      = out->linesize[i],
+            .WidthInBytes  = widths[i],
+            .Height        = AV_CEIL_RSHIFT(in->height, vsub),
+        };
+
+        ret = CHECK_CU(cu->cuMemcpy2DAsync(&cpy, hwctx->stream));
+        if (ret < 0)
+            goto exit;
+    }
+
+    ret = CHECK_CU(cu->cuEventRecord(buf->event, hwctx->stream));
+    if (ret < 0)
+        goto exit;
+    buf->pending = 1;
+
+    s->next_staging = (s->next_staging + 1) % s->nb_staging;
+
+exit:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    return ret;
+}
+
 static int cudaupload_filter_frame(AVFilterLink *link, AVFrame *in)
 {
     AVFilterContext   *ctx = link->dst;
     AVFilterLink  *outlink = ctx->outputs[0];
+    CudaUploadContext   *s = ctx->priv;
 
     AVFrame *out = NULL;
     int ret;
@@ -129,7 +315,10 @@ static int cudaupload_filter_frame(AVFilterLink *link, AVFrame *in)
     out->width  = in->width;
     out->height = in->height;
 
-    ret = av_hwframe_transfer_data(out, in, 0);
+    if (s->nb_staging)
+        ret = cudaupload_transfer_staged(ctx, out, in);
+    else
+        ret = av_hwframe_transfer_data(out, in, 0);
     if (ret < 0) {
         av_log(ctx, AV_LOG_ERROR, "Error transferring data to the GPU\n");
         goto fail;
@@ -152,6 +341,7 @@ fail:
 #define FLAGS (AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
 static const AVOption cudaupload_options[] = {
     { "device", "Number of the device to use", OFFSET(device_idx), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "queue",  "Number of page-locked staging buffers to use, 0 to copy directly", OFFSET(queue_depth), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, MAX_QUEUE_DEPTH, FLAGS },
     { NULL },
 };
 
@@ -27,6 +27,7 @@
 #include <pthread.h>
 #include <libvmaf.h>
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
@@ -48,9 +49,8 @@ typedef struct LIBVMAFContext {
     pthread_mutex_t lock;
     pthread_cond_t cond;
     int eof;
-    AVFrame *gmain;
-    AVFrame *gref;
-    int frame_set;
+    AVFifoBuffer *fifo;         ///< pairs of main and reference frames waiting for libvmaf
+    int queue_size;
     char *model_path;
     char *log_path;
     char *log_fmt;
@@ -84,6 +84,7 @@ static const AVOption libvmaf_options[] = {
     {"n_threads", "Set number of threads to be used when computing vmaf.",              OFFSET(n_threads), AV_OPT_TYPE_INT, {.i64=0}, 0, UINT_MAX, FLAGS},
     {"n_subsample", "Set interval for frame subsampling used when computing vmaf.",     OFFSET(n_subsample), AV_OPT_TYPE_INT, {.i64=1}, 1, UINT_MAX, FLAGS},
     {"enable_conf_interval",  "Enables confidence interval.",                           OFFSET(enable_conf_interval), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"queue_size", "Set the number of frames queued for computing vmaf.",               OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=4}, 1, 64, FLAGS},
     { NULL }
 };
 
@@ -94,20 +95,27 @@ FRAMESYNC_DEFINE_CLASS(libvmaf, LIBVMAFContext, fs);
                                       float *temp_data, int stride, void *ctx)  \
 {                                                                               \
     LIBVMAFContext *s = (LIBVMAFContext *) ctx;                                 \
-    int ret;                                                                    \
+    AVFrame *frames[2] = { NULL };                                              \
     \
     pthread_mutex_lock(&s->lock);                                               \
     \
-    while (!s->frame_set && !s->eof) {                                          \
+    while (!av_fifo_size(s->fifo) && !s->eof) {                                 \
         pthread_cond_wait(&s->cond, &s->lock);                                  \
     }                                                                           \
     \
-    if (s->frame_set) {                                                         \
-        int ref_stride = s->gref->linesize[0];                                  \
-        int main_stride = s->gmain->linesize[0];                                \
+    if (av_fifo_size(s->fifo)) {                                                \
+        av_fifo_generic_read(s->fifo, frames, sizeof(frames), NULL);            \
+        pthread_cond_signal(&s->cond);                                          \
+    }                                                                           \
+    \
+    pthread_mutex_unlock(&s->lock);                                             \
+    \
+    if (frames[0]) {                                                            \
+        int ref_stride = frames[1]->linesize[0];                                \
+        int main_stride = frames[0]->linesize[0];                               \
         \
-        const type *ref_ptr = (const type *) s->gref->data[0];                  \
-        const type *main_ptr = (const type *) s->gmain->data[0];                \
+        const type *ref_ptr = (const type *) frames[1]->data[0];                \
+        const type *main_ptr = (const type *) frames[0]->data[0];               \
         \
         float *ptr = ref_data;                                                  \
         float factor = 1.f / (1 << (bits - 8));                                 \
@@ -134,22 +142,13 @@ FRAMESYNC_DEFINE_CLASS(libvmaf, LIBVMAFContext, fs);
             main_ptr += main_stride / sizeof(*main_ptr);                        \
             ptr += stride / sizeof(*ptr);                                       \
         }                                                                       \
+        \
+        av_frame_free(&frames[0]);                                              \
+        av_frame_free(&frames[1]);                                              \
+        return 0;                                                               \
     }                                                                           \
     \
-    ret = !s->frame_set;                                                        \
-    \
-    av_frame_unref(s->gref);                                                    \
-    av_frame_unref(s->gmain);                                                   \
-    s->frame_set = 0;                                                           \
-    \
-    pthread_cond_signal(&s->cond);                                              \
-    pthread_mutex_unlock(&s->lock);                                             \
-    \
-    if (ret) {                                                                  \
-        return 2;                                                               \
-    }                                                                           \
-    \
-    return 0;                                                                   \
+    return 2;                                                                   \
 }
 
 read_frame_fn(uint8_t, 8);
@@ -197,6 +196,7 @@ static int do_vmaf(FFFrameSync *fs)
     AVFilterContext *ctx = fs->parent;
     LIBVMAFContext *s = ctx->priv;
     AVFrame *master, *ref;
+    AVFrame *frames[2];
     int ret;
 
     ret = ff_framesync_dualinput_get(fs, &master, &ref);
@@ -205,9 +205,18 @@ static int do_vmaf(FFFrameSync *fs)
     if (!ref)
         return ff_filter_frame(ctx->outputs[0], master);
 
+    frames[0] = av_frame_clone(master);
+    frames[1] = av_frame_clone(ref);
+    if (!frames[0] || !frames[1]) {
+        av_frame_free(&frames[0]);
+        av_frame_free(&frames[1]);
+        av_frame_free(&master);
+        return AVERROR(ENOMEM);
+    }
+
     pthread_mutex_lock(&s->lock);
 
-    while (s->frame_set && !s->error) {
+    while (av_fifo_space(s->fifo) < sizeof(frames) && !s->error) {
         pthread_cond_wait(&s->cond, &s->lock);
     }
 
@@ -215,13 +224,13 @@ static int do_vmaf(FFFrameSync *fs)
         av_log(ctx, AV_LOG_ERROR,
                "libvmaf encountered an error, check log for details\n");
         pthread_mutex_unlock(&s->lock);
+        av_frame_free(&frames[0]);
+        av_frame_free(&frames[1]);
+        av_frame_free(&master);
         return AVERROR(EINVAL);
     }
 
-    av_frame_ref(s->gref, ref);
-    av_frame_ref(s->gmain, master);
-
-    s->frame_set = 1;
+    av_fifo_generic_write(s->fifo, frames, sizeof(frames), NULL);
 
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->lock);
@@ -233,9 +242,8 @@ static av_cold int init(AVFilterContext *ctx)
 {
     LIBVMAFContext *s = ctx->priv;
 
-    s->gref = av_frame_alloc();
-    s->gmain = av_frame_alloc();
-    if (!s->gref || !s->gmain)
+    s->fifo = av_fifo_alloc_array(s->queue_size, 2 * sizeof(AVFrame *));
+    if (!s->fifo)
         return AVERROR(ENOMEM);
 
     s->error = 0;
@@ -337,8 +345,14 @@ static av_cold void uninit(AVFilterContext *ctx)
         s->vmaf_thread_created = 0;
     }
 
-    av_frame_free(&s->gref);
-    av_frame_free(&s->gmain);
+    while (s->fifo && av_fifo_size(s->fifo)) {
+        AVFrame *frames[2];
+
+        av_fifo_generic_read(s->fifo, frames, sizeof(frames), NULL);
+        av_frame_free(&frames[0]);
+        av_frame_free(&frames[1]);
+    }
+    av_fifo_freep(&s->fifo);
 
     pthread_mutex_destroy(&s->lock);
     pthread_cond_destroy(&s->cond);
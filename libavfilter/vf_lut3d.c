@@ -68,6 +68,8 @@ typedef struct LUT3DContext {
     struct rgbvec *lut;
     int lutsize;
     int lutsize2;
+    int separable;              ///< each output component only depends on the same input component
+    uint16_t *prelut[3];        ///< output of each component for every input value, if separable
 #if CONFIG_HALDCLUT_FILTER
     uint8_t clut_rgba_map[4];
     int clut_step;
@@ -335,6 +337,86 @@ DEFINE_INTERP_FUNC(nearest,     16)
 DEFINE_INTERP_FUNC(trilinear,   16)
 DEFINE_INTERP_FUNC(tetrahedral, 16)
 
+#define DEFINE_PRELUT_FUNC_PLANAR(nbits, depth)                                                    \
+static int interp_##nbits##_prelut_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+{                                                                                                  \
+    int x, y;                                                                                      \
+    const LUT3DContext *lut3d = ctx->priv;                                                         \
+    const ThreadData *td = arg;                                                                    \
+    const AVFrame *in  = td->in;                                                                   \
+    const AVFrame *out = td->out;                                                                  \
+    const int direct = out == in;                                                                  \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                                    \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                                    \
+    const int mask = (1 << depth) - 1;                                                             \
+    const uint16_t *lut_r = lut3d->prelut[R];                                                      \
+    const uint16_t *lut_g = lut3d->prelut[G];                                                      \
+    const uint16_t *lut_b = lut3d->prelut[B];                                                      \
+                                                                                                   \
+    for (y = slice_start; y < slice_end; y++) {                                                    \
+        uint##nbits##_t *dstg = (uint##nbits##_t *)(out->data[0] + y * out->linesize[0]);          \
+        uint##nbits##_t *dstb = (uint##nbits##_t *)(out->data[1] + y * out->linesize[1]);          \
+        uint##nbits##_t *dstr = (uint##nbits##_t *)(out->data[2] + y * out->linesize[2]);          \
+        uint##nbits##_t *dsta = (uint##nbits##_t *)(out->data[3] + y * out->linesize[3]);          \
+        const uint##nbits##_t *srcg = (const uint##nbits##_t *)(in->data[0] + y * in->linesize[0]); \
+        const uint##nbits##_t *srcb = (const uint##nbits##_t *)(in->data[1] + y * in->linesize[1]); \
+        const uint##nbits##_t *srcr = (const uint##nbits##_t *)(in->data[2] + y * in->linesize[2]); \
+        const uint##nbits##_t *srca = (const uint##nbits##_t *)(in->data[3] + y * in->linesize[3]); \
+        for (x = 0; x < in->width; x++) {                                                          \
+            dstr[x] = lut_r[srcr[x] & mask];                                                       \
+            dstg[x] = lut_g[srcg[x] & mask];                                                       \
+            dstb[x] = lut_b[srcb[x] & mask];                                                       \
+        }                                                                                          \
+        if (!direct && in->linesize[3])                                                            \
+            memcpy(dsta, srca, in->width * sizeof(*dsta));                                         \
+    }                                                                                              \
+    return 0;                                                                                      \
+}
+
+DEFINE_PRELUT_FUNC_PLANAR(8,  8)
+DEFINE_PRELUT_FUNC_PLANAR(16, 9)
+DEFINE_PRELUT_FUNC_PLANAR(16, 10)
+DEFINE_PRELUT_FUNC_PLANAR(16, 12)
+DEFINE_PRELUT_FUNC_PLANAR(16, 14)
+DEFINE_PRELUT_FUNC_PLANAR(16, 16)
+
+#define DEFINE_PRELUT_FUNC(nbits)                                                                  \
+static int interp_##nbits##_prelut(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)        \
+{                                                                                                  \
+    int x, y;                                                                                      \
+    const LUT3DContext *lut3d = ctx->priv;                                                         \
+    const ThreadData *td = arg;                                                                    \
+    const AVFrame *in  = td->in;                                                                   \
+    const AVFrame *out = td->out;                                                                  \
+    const int direct = out == in;                                                                  \
+    const int step = lut3d->step;                                                                  \
+    const uint8_t r = lut3d->rgba_map[R];                                                          \
+    const uint8_t g = lut3d->rgba_map[G];                                                          \
+    const uint8_t b = lut3d->rgba_map[B];                                                          \
+    const uint8_t a = lut3d->rgba_map[A];                                                          \
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;                                    \
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;                                    \
+    const uint16_t *lut_r = lut3d->prelut[R];                                                      \
+    const uint16_t *lut_g = lut3d->prelut[G];                                                      \
+    const uint16_t *lut_b = lut3d->prelut[B];                                                      \
+                                                                                                   \
+    for (y = slice_start; y < slice_end; y++) {                                                    \
+        uint##nbits##_t *dst = (uint##nbits##_t *)(out->data[0] + y * out->linesize[0]);           \
+        const uint##nbits##_t *src = (const uint##nbits##_t *)(in->data[0] + y * in->linesize[0]); \
+        for (x = 0; x < in->width * step; x += step) {                                             \
+            dst[x + r] = lut_r[src[x + r]];                                                        \
+            dst[x + g] = lut_g[src[x + g]];                                                        \
+            dst[x + b] = lut_b[src[x + b]];                                                        \
+            if (!direct && step == 4)                                                              \
+                dst[x + a] = src[x + a];                                                           \
+        }                                                                                          \
+    }                                                                                              \
+    return 0;                                                                                      \
+}
+
+DEFINE_PRELUT_FUNC(8)
+DEFINE_PRELUT_FUNC(16)
+
 #define MAX_LINE_SIZE 512
 
 static int skip_line(const char *p)
@@ -685,6 +767,75 @@ static int set_identity_matrix(AVFilterContext *ctx, int size)
     return 0;
 }
 
+/**
+ * Check if the LUT is the combination of three 1D curves, in which case all
+ * the interpolation modes reduce to interpolating these curves.
+ */
+static int lut_is_separable(const LUT3DContext *lut3d)
+{
+    const int size  = lut3d->lutsize;
+    const int size2 = lut3d->lutsize2;
+    int i, j, k;
+
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+            for (k = 0; k < size; k++) {
+                const struct rgbvec *vec = &lut3d->lut[i * size2 + j * size + k];
+                if (vec->r != lut3d->lut[i * size2].r ||
+                    vec->g != lut3d->lut[j * size ].g ||
+                    vec->b != lut3d->lut[k        ].b)
+                    return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static inline float separable_curve(const LUT3DContext *lut3d, int comp, int i)
+{
+    switch (comp) {
+    case R:  return lut3d->lut[i * lut3d->lutsize2].r;
+    case G:  return lut3d->lut[i * lut3d->lutsize].g;
+    default: return lut3d->lut[i].b;
+    }
+}
+
+/**
+ * Tabulate the output of a separable LUT for every input value.
+ */
+static int build_prelut(LUT3DContext *lut3d, int depth)
+{
+    const int maxval = (1 << depth) - 1;
+    const float scale[3] = {
+        (lut3d->scale.r / ((1<<depth) - 1)) * (lut3d->lutsize - 1),
+        (lut3d->scale.g / ((1<<depth) - 1)) * (lut3d->lutsize - 1),
+        (lut3d->scale.b / ((1<<depth) - 1)) * (lut3d->lutsize - 1),
+    };
+    int comp, v;
+
+    for (comp = 0; comp < 3; comp++) {
+        av_freep(&lut3d->prelut[comp]);
+        lut3d->prelut[comp] = av_malloc_array(maxval + 1, sizeof(*lut3d->prelut[comp]));
+        if (!lut3d->prelut[comp])
+            return AVERROR(ENOMEM);
+
+        for (v = 0; v <= maxval; v++) {
+            const float s = v * scale[comp];
+            float f;
+
+            if (lut3d->interpolation == INTERPOLATE_NEAREST)
+                f = separable_curve(lut3d, comp, NEAR(s));
+            else
+                f = lerpf(separable_curve(lut3d, comp, PREV(s)),
+                          separable_curve(lut3d, comp, NEXT(s)), s - PREV(s));
+            lut3d->prelut[comp][v] = av_clip_uintp2(f * (float)maxval, depth);
+        }
+    }
+
+    return 0;
+}
+
 static int query_formats(AVFilterContext *ctx)
 {
     static const enum AVPixelFormat pix_fmts[] = {
@@ -743,6 +894,13 @@ static int config_input(AVFilterLink *inlink)
         av_assert0(0);
     }
 
+    if (lut3d->separable) {
+        int ret = build_prelut(lut3d, depth);
+        if (ret < 0)
+            return ret;
+        SET_FUNC(prelut);
+    }
+
     return 0;
 }
 
@@ -802,7 +960,11 @@ static av_cold int lut3d_init(AVFilterContext *ctx)
     lut3d->scale.r = lut3d->scale.g = lut3d->scale.b = 1.f;
 
     if (!lut3d->file) {
-        return set_identity_matrix(ctx, 32);
+        ret = set_identity_matrix(ctx, 32);
+        if (ret < 0)
+            return ret;
+        lut3d->separable = lut_is_separable(lut3d);
+        return 0;
     }
 
     f = fopen(lut3d->file, "r");
@@ -840,6 +1002,12 @@ static av_cold int lut3d_init(AVFilterContext *ctx)
         ret = AVERROR_INVALIDDATA;
     }
 
+    if (!ret) {
+        lut3d->separable = lut_is_separable(lut3d);
+        if (lut3d->separable)
+            av_log(ctx, AV_LOG_VERBOSE, "3D LUT is separable, using 1D lookups\n");
+    }
+
 end:
     fclose(f);
     return ret;
@@ -848,8 +1016,11 @@ end:
 static av_cold void lut3d_uninit(AVFilterContext *ctx)
 {
     LUT3DContext *lut3d = ctx->priv;
+    int i;
 
     av_freep(&lut3d->lut);
+    for (i = 0; i < 3; i++)
+        av_freep(&lut3d->prelut[i]);
 }
 
 static const AVFilterPad lut3d_inputs[] = {
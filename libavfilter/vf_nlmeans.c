@@ -38,11 +38,6 @@
 #include "vf_nlmeans.h"
 #include "video.h"
 
-struct weighted_avg {
-    float total_weight;
-    float sum;
-};
-
 typedef struct NLMeansContext {
     const AVClass *class;
     int nb_planes;
@@ -57,8 +52,9 @@ typedef struct NLMeansContext {
     uint32_t *ii;                               // integral image starting after the 0-line and 0-column
     int ii_w, ii_h;                             // width and height of the integral image
     ptrdiff_t ii_lz_32;                         // linesize in 32-bit units of the integral image
-    struct weighted_avg *wa;                    // weighted average of every pixel
-    ptrdiff_t wa_linesize;                      // linesize for wa in struct size unit
+    float *total_weight;                        // total weight of every pixel
+    float *sum;                                 // weighted sum of every pixel
+    ptrdiff_t wa_linesize;                      // linesize for the weighted averages in float unit
     float *weight_lut;                          // lookup table mapping (scaled) patch differences to their associated weights
     uint32_t max_meaningful_diff;               // maximum difference considered (if the patch difference is too high we ignore the pixel)
     NLMeansDSPContext dsp;
@@ -324,13 +320,66 @@ static int config_input(AVFilterLink *inlink)
 
     // allocate weighted average for every pixel
     s->wa_linesize = inlink->w;
-    s->wa = av_malloc_array(s->wa_linesize, inlink->h * sizeof(*s->wa));
-    if (!s->wa)
+    s->total_weight = av_malloc_array(s->wa_linesize, inlink->h * sizeof(*s->total_weight));
+    s->sum          = av_malloc_array(s->wa_linesize, inlink->h * sizeof(*s->sum));
+    if (!s->total_weight || !s->sum)
         return AVERROR(ENOMEM);
 
     return 0;
 }
 
+static void compute_weights_line_c(const uint32_t *iia, const uint32_t *iib,
+                                   const uint32_t *iid, const uint32_t *iie,
+                                   const uint8_t *src, float *total_weight, float *sum,
+                                   const float *weight_lut, int max_meaningful_diff,
+                                   int startx, int endx)
+{
+    int x;
+
+    for (x = startx; x < endx; x++) {
+        /*
+         * M is a discrete map where every entry contains the sum of all the entries
+         * in the rectangle from the top-left origin of M to its coordinate. In the
+         * following schema, "i" contains the sum of the whole map:
+         *
+         * M = +----------+-----------------+----+
+         *     |          |                 |    |
+         *     |          |                 |    |
+         *     |         a|                b|   c|
+         *     +----------+-----------------+----+
+         *     |          |                 |    |
+         *     |          |                 |    |
+         *     |          |        X        |    |
+         *     |          |                 |    |
+         *     |         d|                e|   f|
+         *     +----------+-----------------+----+
+         *     |          |                 |    |
+         *     |         g|                h|   i|
+         *     +----------+-----------------+----+
+         *
+         * The sum of the X box can be calculated with:
+         *    X = e-d-b+a
+         *
+         * See https://en.wikipedia.org/wiki/Summed_area_table
+         *
+         * The compute*_ssd functions compute the integral image M where every entry
+         * contains the sum of the squared difference of every corresponding pixels of
+         * two input planes of the same size as M.
+         */
+        const uint32_t a = iia[x];
+        const uint32_t b = iib[x];
+        const uint32_t d = iid[x];
+        const uint32_t e = iie[x];
+        const uint32_t patch_diff_sq = e - d - b + a;
+
+        if (patch_diff_sq < max_meaningful_diff) {
+            const float weight = weight_lut[patch_diff_sq]; // exp(-patch_diff_sq * s->pdiff_scale)
+            total_weight[x] += weight;
+            sum[x] += weight * src[x];
+        }
+    }
+}
+
 struct thread_data {
     const uint8_t *src;
     ptrdiff_t src_linesize;
@@ -342,7 +391,7 @@ struct thread_data {
 
 static int nlmeans_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y;
+    int y;
     NLMeansContext *s = ctx->priv;
     const struct thread_data *td = arg;
     const ptrdiff_t src_linesize = td->src_linesize;
@@ -359,49 +408,13 @@ static int nlmeans_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
 
     for (y = starty; y < endy; y++) {
         const uint8_t *src = td->src + y*src_linesize;
-        struct weighted_avg *wa = s->wa + y*s->wa_linesize;
-        for (x = td->startx; x < td->endx; x++) {
-            /*
-             * M is a discrete map where every entry contains the sum of all the entries
-             * in the rectangle from the top-left origin of M to its coordinate. In the
-             * following schema, "i" contains the sum of the whole map:
-             *
-             * M = +----------+-----------------+----+
-             *     |          |                 |    |
-             *     |          |                 |    |
-             *     |         a|                b|   c|
-             *     +----------+-----------------+----+
-             *     |          |                 |    |
-             *     |          |                 |    |
-             *     |          |        X        |    |
-             *     |          |                 |    |
-             *     |         d|                e|   f|
-             *     +----------+-----------------+----+
-             *     |          |                 |    |
-             *     |         g|                h|   i|
-             *     +----------+-----------------+----+
-             *
-             * The sum of the X box can be calculated with:
-             *    X = e-d-b+a
-             *
-             * See https://en.wikipedia.org/wiki/Summed_area_table
-             *
-             * The compute*_ssd functions compute the integral image M where every entry
-             * contains the sum of the squared difference of every corresponding pixels of
-             * two input planes of the same size as M.
-             */
-            const uint32_t a = ii[x];
-            const uint32_t b = ii[x + dist_b];
-            const uint32_t d = ii[x + dist_d];
-            const uint32_t e = ii[x + dist_e];
-            const uint32_t patch_diff_sq = e - d - b + a;
-
-            if (patch_diff_sq < s->max_meaningful_diff) {
-                const float weight = s->weight_lut[patch_diff_sq]; // exp(-patch_diff_sq * s->pdiff_scale)
-                wa[x].total_weight += weight;
-                wa[x].sum += weight * src[x];
-            }
-        }
+        float *total_weight = s->total_weight + y*s->wa_linesize;
+        float *sum = s->sum + y*s->wa_linesize;
+
+        s->dsp.compute_weights_line(ii, ii + dist_b, ii + dist_d, ii + dist_e,
+                                    src, total_weight, sum,
+                                    s->weight_lut, s->max_meaningful_diff,
+                                    td->startx, td->endx);
         ii += s->ii_lz_32;
     }
     return 0;
@@ -409,7 +422,7 @@ static int nlmeans_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
 
 static void weight_averages(uint8_t *dst, ptrdiff_t dst_linesize,
                             const uint8_t *src, ptrdiff_t src_linesize,
-                            struct weighted_avg *wa, ptrdiff_t wa_linesize,
+                            float *total_weight, float *sum, ptrdiff_t wa_linesize,
                             int w, int h)
 {
     int x, y;
@@ -417,13 +430,14 @@ static void weight_averages(uint8_t *dst, ptrdiff_t dst_linesize,
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
             // Also weight the centered pixel
-            wa[x].total_weight += 1.f;
-            wa[x].sum += 1.f * src[x];
-            dst[x] = av_clip_uint8(wa[x].sum / wa[x].total_weight + 0.5f);
+            total_weight[x] += 1.f;
+            sum[x] += 1.f * src[x];
+            dst[x] = av_clip_uint8(sum[x] / total_weight[x] + 0.5f);
         }
         dst += dst_linesize;
         src += src_linesize;
-        wa += wa_linesize;
+        total_weight += wa_linesize;
+        sum += wa_linesize;
     }
 }
 
@@ -439,7 +453,8 @@ static int nlmeans_plane(AVFilterContext *ctx, int w, int h, int p, int r,
     /* focus an integral pointer on the centered image (s1) */
     const uint32_t *centered_ii = s->ii + e*s->ii_lz_32 + e;
 
-    memset(s->wa, 0, s->wa_linesize * h * sizeof(*s->wa));
+    memset(s->total_weight, 0, s->wa_linesize * h * sizeof(*s->total_weight));
+    memset(s->sum,          0, s->wa_linesize * h * sizeof(*s->sum));
 
     for (offy = -r; offy <= r; offy++) {
         for (offx = -r; offx <= r; offx++) {
@@ -465,7 +480,7 @@ static int nlmeans_plane(AVFilterContext *ctx, int w, int h, int p, int r,
     }
 
     weight_averages(dst, dst_linesize, src, src_linesize,
-                    s->wa, s->wa_linesize, w, h);
+                    s->total_weight, s->sum, s->wa_linesize, w, h);
 
     return 0;
 }
@@ -509,9 +524,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 void ff_nlmeans_init(NLMeansDSPContext *dsp)
 {
     dsp->compute_safe_ssd_integral_image = compute_safe_ssd_integral_image_c;
+    dsp->compute_weights_line = compute_weights_line_c;
 
     if (ARCH_AARCH64)
         ff_nlmeans_init_aarch64(dsp);
+
+    if (ARCH_X86)
+        ff_nlmeans_init_x86(dsp);
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -556,7 +575,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     NLMeansContext *s = ctx->priv;
     av_freep(&s->weight_lut);
     av_freep(&s->ii_orig);
-    av_freep(&s->wa);
+    av_freep(&s->total_weight);
+    av_freep(&s->sum);
 }
 
 static const AVFilterPad nlmeans_inputs[] = {
@@ -45,6 +45,7 @@ typedef struct FrameData {
     int32_t *lcount[3];
     float *input;
     float *temp;
+    int temp_stride;
 } FrameData;
 
 typedef struct NNEDIContext {
@@ -59,6 +60,7 @@ typedef struct NNEDIContext {
     int64_t cur_pts;
 
     AVFloatDSPContext *fdsp;
+    int nb_threads;
     int nb_planes;
     int linesize[4];
     int planeheight[4];
@@ -84,8 +86,8 @@ typedef struct NNEDIContext {
     int max_value;
 
     void (*copy_pad)(const AVFrame *, FrameData *, struct NNEDIContext *, int);
-    void (*evalfunc_0)(struct NNEDIContext *, FrameData *);
-    void (*evalfunc_1)(struct NNEDIContext *, FrameData *);
+    void (*evalfunc_0)(struct NNEDIContext *, FrameData *, int jobnr, int nb_jobs);
+    void (*evalfunc_1)(struct NNEDIContext *, FrameData *, int jobnr, int nb_jobs);
 
     // Functions used in evalfunc_0
     void (*readpixels)(const uint8_t *, const int, float *);
@@ -154,6 +156,7 @@ static int config_input(AVFilterLink *inlink)
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     int ret;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
     s->nb_planes = av_pix_fmt_count_planes(inlink->format);
     if ((ret = av_image_fill_linesizes(s->linesize, inlink->format, inlink->w)) < 0)
         return ret;
@@ -415,11 +418,23 @@ static void compute_network0new(NNEDIContext *s, const float *datai, const float
     ((int *)d)[0] = mask;
 }
 
-static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
+/**
+ * Get the range of the lines of a field processed by a job, the lines of the
+ * field being the ones of the same parity as y0 below height.
+ */
+static void field_slice(int y0, int height, int jobnr, int nb_jobs, int *start, int *end)
+{
+    const int nb_lines = (height - y0 + 1) / 2;
+
+    *start = y0 + 2 * ((nb_lines *  jobnr     ) / nb_jobs);
+    *end   = y0 + 2 * ((nb_lines * (jobnr + 1)) / nb_jobs);
+}
+
+static void evalfunc_0(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
+    float *input = frame_data->input + jobnr * 512;
     const float *weights0 = s->weights0;
-    float *temp = frame_data->temp;
+    float *temp = frame_data->temp + jobnr * frame_data->temp_stride;
     uint8_t *tempu = (uint8_t *)temp;
     int plane, x, y;
 
@@ -440,15 +455,17 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
         if (!(s->process_plane & (1 << plane)))
             continue;
 
-        for (y = 1 - frame_data->field[plane]; y < height - 12; y += 2) {
+        field_slice(1 - frame_data->field[plane], height - 12, jobnr, nb_jobs, &ystart, &ystop);
+        for (y = ystart; y < ystop; y += 2) {
             memcpy(dstp + y * dst_stride,
                    srcp + 32 + (6 + y) * src_stride,
                    (width - 64) * sizeof(uint8_t));
 
         }
 
-        ystart = 6 + frame_data->field[plane];
-        ystop = height - 6;
+        field_slice(frame_data->field[plane], height - 12, jobnr, nb_jobs, &ystart, &ystop);
+        ystart += 6;
+        ystop  += 6;
         srcp += ystart * src_stride;
         dstp += (ystart - 6) * dst_stride - 32;
         src3p = srcp - src_stride * 3;
@@ -575,10 +592,10 @@ static void weighted_avg_elliott_mul5_m16(const float *w, const int n, float *ms
 }
 
 
-static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
+static void evalfunc_1(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
-    float *temp = frame_data->temp;
+    float *input = frame_data->input + jobnr * 512;
+    float *temp = frame_data->temp + jobnr * frame_data->temp_stride;
     float **weights1 = s->weights1;
     const int qual = s->qual;
     const int asize = s->asize;
@@ -599,13 +616,14 @@ static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
 
-        const int ystart = frame_data->field[plane];
-        const int ystop = height - 12;
+        int ystart, ystop;
         const uint8_t *srcpp;
 
         if (!(s->process_plane & (1 << plane)))
             continue;
 
+        field_slice(frame_data->field[plane], height - 12, jobnr, nb_jobs, &ystart, &ystop);
+
         srcp += (ystart + 6) * src_stride;
         dstp += ystart * dst_stride - 32;
         srcpp = srcp - (ydia - 1) * src_stride - xdiad2m1;
@@ -686,6 +704,20 @@ static int modnpf(const int m, const int n)
     return m + n - (m % n);
 }
 
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    NNEDIContext *s = ctx->priv;
+    FrameData *frame_data = arg;
+
+    // Handles prescreening and the cubic interpolation.
+    s->evalfunc_0(s, frame_data, jobnr, nb_jobs);
+
+    // The rest, which only depends on the lines of the same job.
+    s->evalfunc_1(s, frame_data, jobnr, nb_jobs);
+
+    return 0;
+}
+
 static int get_frame(AVFilterContext *ctx, int is_second)
 {
     NNEDIContext *s = ctx->priv;
@@ -693,8 +725,7 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     AVFrame *src = s->src;
     FrameData *frame_data;
     int effective_field = s->field;
-    size_t temp_size;
-    int field_n;
+    int field_n, nb_lines;
     int plane;
 
     if (effective_field > 1)
@@ -765,16 +796,18 @@ static int get_frame(AVFilterContext *ctx, int is_second)
         frame_data->field[plane] = field_n;
     }
 
+    // Every job uses its own input and temp buffers.
     if (!frame_data->input) {
-        frame_data->input = av_malloc(512 * sizeof(float));
+        frame_data->input = av_malloc_array(s->nb_threads, 512 * sizeof(float));
         if (!frame_data->input)
             return AVERROR(ENOMEM);
     }
     // evalfunc_0 requires at least padded_width[0] bytes.
     // evalfunc_1 requires at least 512 floats.
     if (!frame_data->temp) {
-        temp_size = FFMAX(frame_data->padded_width[0], 512 * sizeof(float));
-        frame_data->temp = av_malloc(temp_size);
+        frame_data->temp_stride = FFALIGN(FFMAX(frame_data->padded_width[0], 512 * sizeof(float)),
+                                          16 * sizeof(float)) / sizeof(float);
+        frame_data->temp = av_malloc_array(s->nb_threads, frame_data->temp_stride * sizeof(float));
         if (!frame_data->temp)
             return AVERROR(ENOMEM);
     }
@@ -782,11 +815,9 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     // Copy src to a padded "frame" in frame_data and mirror the edges.
     s->copy_pad(src, frame_data, s, field_n);
 
-    // Handles prescreening and the cubic interpolation.
-    s->evalfunc_0(s, frame_data);
-
-    // The rest.
-    s->evalfunc_1(s, frame_data);
+    nb_lines = (s->planeheight[0] + 1) / 2;
+    ctx->internal->execute(ctx, filter_slice, frame_data, NULL,
+                           FFMIN(nb_lines, s->nb_threads));
 
     return 0;
 }
@@ -1207,5 +1238,5 @@ AVFilter ff_vf_nnedi = {
     .query_formats = query_formats,
     .inputs        = inputs,
     .outputs       = outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
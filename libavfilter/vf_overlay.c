@@ -37,12 +37,14 @@
 #include "libavutil/timestamp.h"
 #include "internal.h"
 #include "drawutils.h"
+#include "filters.h"
 #include "framesync.h"
 #include "video.h"
 #include "vf_overlay.h"
 
 typedef struct ThreadData {
     AVFrame *dst, *src;
+    int x, y;
 } ThreadData;
 
 static const char *const var_names[] = {
@@ -83,6 +85,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     OverlayContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
+    av_buffer_unref(&s->bbox_buf);
     av_expr_free(s->x_pexpr); s->x_pexpr = NULL;
     av_expr_free(s->y_pexpr); s->y_pexpr = NULL;
 }
@@ -657,164 +660,213 @@ static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
 
 static int blend_slice_yuv420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv444(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva444(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrp(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrap(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv420_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva420_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 1, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv422_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva422_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 1, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuv444_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_yuva444_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_yuv(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrp_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_gbrap_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_planar_rgb(ctx, td->dst, td->src, 0, 0, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgb(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgba(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, s->x, s->y, 1, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, td->x, td->y, 1, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgb_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 0, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
 static int blend_slice_rgba_pm(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    OverlayContext *s = ctx->priv;
     ThreadData *td = arg;
-    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, s->x, s->y, 0, jobnr, nb_jobs);
+    blend_slice_packed_rgb(ctx, td->dst, td->src, 1, td->x, td->y, 0, jobnr, nb_jobs);
     return 0;
 }
 
+/* straight alpha rows for a main input without alpha; the subsampled variants
+ * leave the last pixel, whose alpha cannot be averaged, to blend_plane() */
+static int overlay_row_44_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        d[x] = FAST_DIV255(d[x] * (255 - a[x]) + s[x] * a[x]);
+    return w;
+}
+
+static int overlay_row_22_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w - 1; x++) {
+        int alpha = (a[2 * x] + ((a[2 * x] + a[2 * x + 1]) >> 1)) >> 1;
+        d[x] = FAST_DIV255(d[x] * (255 - alpha) + s[x] * alpha);
+    }
+    return FFMAX(w - 1, 0);
+}
+
+static int overlay_row_20_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                            int w, ptrdiff_t alinesize)
+{
+    int x;
+
+    for (x = 0; x < w - 1; x++) {
+        int alpha = (a[2 * x]             + a[2 * x + 1] +
+                     a[2 * x + alinesize] + a[2 * x + alinesize + 1]) >> 2;
+        d[x] = FAST_DIV255(d[x] * (255 - alpha) + s[x] * alpha);
+    }
+    return FFMAX(w - 1, 0);
+}
+
+av_cold void ff_overlay_init(OverlayContext *s, int format, int pix_format,
+                             int alpha_format, int main_has_alpha)
+{
+    memset(s->blend_row, 0, sizeof(s->blend_row));
+
+    if (!alpha_format && !main_has_alpha) {
+        switch (format) {
+        case OVERLAY_FORMAT_YUV444:
+        case OVERLAY_FORMAT_GBRP:
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_44_c;
+            s->blend_row[2] = overlay_row_44_c;
+            break;
+        case OVERLAY_FORMAT_YUV422:
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_22_c;
+            s->blend_row[2] = overlay_row_22_c;
+            break;
+        case OVERLAY_FORMAT_YUV420:
+            if (pix_format != AV_PIX_FMT_YUV420P)
+                break;
+            s->blend_row[0] = overlay_row_44_c;
+            s->blend_row[1] = overlay_row_20_c;
+            s->blend_row[2] = overlay_row_20_c;
+            break;
+        }
+    }
+
+    if (ARCH_X86)
+        ff_overlay_init_x86(s, format, pix_format, alpha_format, main_has_alpha);
+}
+
 static int config_input_main(AVFilterLink *inlink)
 {
     OverlayContext *s = inlink->dst->priv;
@@ -920,22 +972,107 @@ static int config_input_main(AVFilterLink *inlink)
     }
 
 end:
-    if (ARCH_X86)
-        ff_overlay_init_x86(s, s->format, inlink->format,
-                            s->alpha_format, s->main_has_alpha);
+    ff_overlay_init(s, s->format, inlink->format,
+                    s->alpha_format, s->main_has_alpha);
 
     return 0;
 }
 
+/**
+ * Find the bounding box of the pixels of the overlay with a non-zero alpha.
+ * It is rounded to even coordinates and extended by two fully transparent
+ * pixels where possible, so that the subsampled alpha of the chroma planes
+ * is computed as for the whole frame.
+ */
+static void overlay_bbox(OverlayContext *s, const AVFrame *src)
+{
+    /* GBRAP also has an RGBA map, only the descriptor tells it is planar */
+    const int planar = av_pix_fmt_desc_get(src->format)->flags & AV_PIX_FMT_FLAG_PLANAR;
+    const uint8_t *alpha = planar ? src->data[3] :
+                           src->data[0] + s->overlay_rgba_map[A];
+    const ptrdiff_t linesize = planar ? src->linesize[3] : src->linesize[0];
+    const int step = planar ? 1 : s->overlay_pix_step[0];
+    int x0 = src->width, x1 = -1, y0 = src->height, y1 = -1;
+    int x, y;
+
+    for (y = 0; y < src->height; y++) {
+        const uint8_t *a = alpha + y * linesize;
+
+        for (x = 0; x < src->width; x++) {
+            if (a[x * step]) {
+                x0 = FFMIN(x0, x);
+                x1 = FFMAX(x1, x);
+                y0 = FFMIN(y0, y);
+                y1 = y;
+            }
+        }
+    }
+
+    if (y1 < 0) {
+        s->bbox_x = s->bbox_y = s->bbox_w = s->bbox_h = 0;
+        return;
+    }
+
+    x0 &= ~1;
+    y0 &= ~1;
+    x1 = FFMIN(FFALIGN(x1 + 1, 2) + 2, src->width);
+    y1 = FFMIN(FFALIGN(y1 + 1, 2) + 2, src->height);
+    s->bbox_x = x0;
+    s->bbox_y = y0;
+    s->bbox_w = x1 - x0;
+    s->bbox_h = y1 - y0;
+}
+
+/**
+ * Restrict the overlay to its non-transparent part. This is only done for
+ * straight alpha, where blending a pixel with zero alpha leaves the main
+ * frame unchanged.
+ *
+ * @return 0 if the overlay is fully transparent, 1 otherwise
+ */
+static int overlay_crop(OverlayContext *s, AVFrame *view, int *x, int *y)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(view->format);
+    int p;
+
+    if (s->alpha_format || !s->overlay_has_alpha || !view->buf[0])
+        return 1;
+
+    if (!s->bbox_buf || s->bbox_buf->data != view->buf[0]->data) {
+        av_buffer_unref(&s->bbox_buf);
+        overlay_bbox(s, view);
+        /* holding a reference keeps the buffer from being reused for
+         * another frame while its bounding box is cached */
+        s->bbox_buf = av_buffer_ref(view->buf[0]);
+    }
+
+    if (!s->bbox_w)
+        return 0;
+
+    for (p = 0; p < 4 && view->data[p]; p++) {
+        int hsub = p == 1 || p == 2 ? desc->log2_chroma_w : 0;
+        int vsub = p == 1 || p == 2 ? desc->log2_chroma_h : 0;
+
+        view->data[p] += (s->bbox_y >> vsub) * view->linesize[p] +
+                         (s->bbox_x >> hsub) * s->overlay_pix_step[p];
+    }
+    view->width  = s->bbox_w;
+    view->height = s->bbox_h;
+    *x += s->bbox_x;
+    *y += s->bbox_y;
+
+    return 1;
+}
+
 static int do_blend(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
-    AVFrame *mainpic, *second;
+    AVFrame *mainpic, *second, view;
     OverlayContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
-    int ret;
+    int x, y, ret;
 
-    ret = ff_framesync_dualinput_get_writable(fs, &mainpic, &second);
+    ret = ff_framesync_dualinput_get(fs, &mainpic, &second);
     if (ret < 0)
         return ret;
     if (!second)
@@ -961,13 +1098,29 @@ static int do_blend(FFFrameSync *fs)
                s->var_values[VAR_Y], s->y);
     }
 
+    view = *second;
+    x = s->x;
+    y = s->y;
+
+    /* the main frame is only made writable if something is drawn on it */
     if (s->x < mainpic->width  && s->x + second->width  >= 0 &&
-        s->y < mainpic->height && s->y + second->height >= 0) {
+        s->y < mainpic->height && s->y + second->height >= 0 &&
+        overlay_crop(s, &view, &x, &y) &&
+        x < mainpic->width  && x + view.width  >= 0 &&
+        y < mainpic->height && y + view.height >= 0) {
         ThreadData td;
 
+        ret = ff_inlink_make_frame_writable(inlink, &mainpic);
+        if (ret < 0) {
+            av_frame_free(&mainpic);
+            return ret;
+        }
+
         td.dst = mainpic;
-        td.src = second;
-        ctx->internal->execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(s->y + second->height, FFMIN(second->height, mainpic->height), mainpic->height - s->y)),
+        td.src = &view;
+        td.x   = x;
+        td.y   = y;
+        ctx->internal->execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(y + view.height, FFMIN(view.height, mainpic->height), mainpic->height - y)),
                                                                      ff_filter_get_nb_threads(ctx)));
     }
     return ff_filter_frame(ctx->outputs[0], mainpic);
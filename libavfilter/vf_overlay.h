@@ -75,11 +75,18 @@ typedef struct OverlayContext {
 
     AVExpr *x_pexpr, *y_pexpr;
 
+    /* bounding box of the non-transparent pixels of the overlay frame
+     * referenced by bbox_buf, so that a static logo is scanned only once */
+    AVBufferRef *bbox_buf;
+    int bbox_x, bbox_y, bbox_w, bbox_h;
+
     int (*blend_row[4])(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a, int w,
                         ptrdiff_t alinesize);
     int (*blend_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } OverlayContext;
 
+void ff_overlay_init(OverlayContext *s, int format, int pix_format,
+                     int alpha_format, int main_has_alpha);
 void ff_overlay_init_x86(OverlayContext *s, int format, int pix_format,
                          int alpha_format, int main_has_alpha);
 
@@ -0,0 +1,377 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Overlay one CUDA video on top of another.
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_cuda_internal.h"
+#include "libavutil/cuda_check.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "avfilter.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "video.h"
+
+#define CHECK_CU(x) FF_CUDA_CHECK_DL(avctx, s->hwctx->internal->cuda_dl, x)
+
+#define DIV_UP(a, b) ( ((a) + (b) - 1) / (b) )
+#define BLOCKX 32
+#define BLOCKY 16
+
+extern char vf_overlay_cuda_ptx[];
+
+typedef struct OverlayCUDAContext {
+    const AVClass      *class;
+
+    AVCUDADeviceContext *hwctx;
+    CUcontext           cu_ctx;
+    CUstream            cu_stream;
+    CUmodule            cu_module;
+    CUfunction          cu_func_uchar;
+    CUfunction          cu_func_uchar2;
+
+    FFFrameSync fs;
+
+    enum AVPixelFormat  main_format;
+    enum AVPixelFormat  overlay_format;
+    int                 nb_planes;
+    int                 log2_chroma_w;
+    int                 log2_chroma_h;
+    int                 alpha_separate;
+
+    int                 x_position;
+    int                 y_position;
+} OverlayCUDAContext;
+
+static const enum AVPixelFormat supported_main_formats[] = {
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_YUV444P,
+};
+
+static int format_is_supported(enum AVPixelFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(supported_main_formats); i++)
+        if (supported_main_formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static int overlay_cuda_query_formats(AVFilterContext *avctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_CUDA, AV_PIX_FMT_NONE,
+    };
+
+    return ff_set_common_formats(avctx, ff_make_format_list(pix_fmts));
+}
+
+static int overlay_cuda_blend_plane(AVFilterContext *avctx, AVFrame *output,
+                                    const AVFrame *input_main,
+                                    const AVFrame *input_overlay, int plane)
+{
+    OverlayCUDAContext *s = avctx->priv;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    int uv_packed = s->main_format == AV_PIX_FMT_NV12 && plane == 1;
+    int pixel_size = uv_packed ? 2 : 1;
+    int shift_x = plane ? s->log2_chroma_w : 0;
+    int shift_y = plane ? s->log2_chroma_h : 0;
+    int alpha_adj_x = 1 << shift_x;
+    int alpha_adj_y = 1 << shift_y;
+    CUdeviceptr dst  = (CUdeviceptr)output->data[plane];
+    CUdeviceptr src  = (CUdeviceptr)input_main->data[plane];
+    CUdeviceptr ovl  = (CUdeviceptr)input_overlay->data[plane];
+    CUdeviceptr alpha = s->alpha_separate ?
+                        (CUdeviceptr)input_overlay->data[3] : 0;
+    int dst_pitch   = output->linesize[plane]        / pixel_size;
+    int main_pitch  = input_main->linesize[plane]    / pixel_size;
+    int ovl_pitch   = input_overlay->linesize[plane] / pixel_size;
+    int alpha_pitch = s->alpha_separate ? input_overlay->linesize[3] : 0;
+    int width       = AV_CEIL_RSHIFT(output->width,         shift_x);
+    int height      = AV_CEIL_RSHIFT(output->height,        shift_y);
+    int ovl_width   = AV_CEIL_RSHIFT(input_overlay->width,  shift_x);
+    int ovl_height  = AV_CEIL_RSHIFT(input_overlay->height, shift_y);
+    int x_position  = s->x_position >> shift_x;
+    int y_position  = s->y_position >> shift_y;
+    void *args[] = {
+        &dst, &dst_pitch, &src, &main_pitch, &ovl, &ovl_pitch,
+        &alpha, &alpha_pitch, &alpha_adj_x, &alpha_adj_y,
+        &width, &height, &x_position, &y_position,
+        &ovl_width, &ovl_height,
+    };
+
+    return CHECK_CU(cu->cuLaunchKernel(uv_packed ? s->cu_func_uchar2 : s->cu_func_uchar,
+                                       DIV_UP(width, BLOCKX), DIV_UP(height, BLOCKY), 1,
+                                       BLOCKX, BLOCKY, 1, 0, s->cu_stream, args, NULL));
+}
+
+static int overlay_cuda_blend(FFFrameSync *fs)
+{
+    AVFilterContext    *avctx = fs->parent;
+    AVFilterLink     *outlink = avctx->outputs[0];
+    OverlayCUDAContext     *s = avctx->priv;
+    CudaFunctions         *cu = s->hwctx->internal->cuda_dl;
+    AVFrame *input_main, *input_overlay;
+    AVFrame *output;
+    CUcontext dummy;
+    int plane, ret;
+
+    ret = ff_framesync_dualinput_get(fs, &input_main, &input_overlay);
+    if (ret < 0)
+        return ret;
+
+    if (!input_main)
+        return AVERROR_BUG;
+
+    if (!input_overlay) {
+        output = av_frame_clone(input_main);
+        if (!output)
+            return AVERROR(ENOMEM);
+        return ff_filter_frame(outlink, output);
+    }
+
+    output = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!output)
+        return AVERROR(ENOMEM);
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        goto fail;
+
+    for (plane = 0; plane < s->nb_planes; plane++) {
+        ret = overlay_cuda_blend_plane(avctx, output, input_main,
+                                       input_overlay, plane);
+        if (ret < 0)
+            break;
+    }
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    if (ret < 0)
+        goto fail;
+
+    ret = av_frame_copy_props(output, input_main);
+    if (ret < 0)
+        goto fail;
+
+    return ff_filter_frame(outlink, output);
+
+fail:
+    av_frame_free(&output);
+    return ret;
+}
+
+static int overlay_cuda_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext    *avctx = outlink->src;
+    OverlayCUDAContext     *s = avctx->priv;
+    AVFilterLink   *main_link = avctx->inputs[0];
+    AVFilterLink    *ovl_link = avctx->inputs[1];
+    AVHWFramesContext *main_frames, *ovl_frames, *output_frames;
+    const AVPixFmtDescriptor *desc;
+    CudaFunctions *cu;
+    CUcontext dummy;
+    int ret;
+
+    if (!main_link->hw_frames_ctx || !ovl_link->hw_frames_ctx) {
+        av_log(avctx, AV_LOG_ERROR, "A hardware frames reference is "
+               "required on both inputs.\n");
+        return AVERROR(EINVAL);
+    }
+    main_frames = (AVHWFramesContext*)main_link->hw_frames_ctx->data;
+    ovl_frames  = (AVHWFramesContext*)ovl_link->hw_frames_ctx->data;
+
+    if (main_frames->device_ref->data != ovl_frames->device_ref->data) {
+        av_log(avctx, AV_LOG_ERROR, "Both inputs must use the same "
+               "CUDA device.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->main_format    = main_frames->sw_format;
+    s->overlay_format = ovl_frames->sw_format;
+
+    if (!format_is_supported(s->main_format)) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported main input format: %s.\n",
+               av_get_pix_fmt_name(s->main_format));
+        return AVERROR(ENOSYS);
+    }
+    if (s->overlay_format != s->main_format &&
+        !(s->main_format    == AV_PIX_FMT_YUV420P &&
+          s->overlay_format == AV_PIX_FMT_YUVA420P)) {
+        av_log(avctx, AV_LOG_ERROR, "Overlay input format %s is not "
+               "compatible with main input format %s.\n",
+               av_get_pix_fmt_name(s->overlay_format),
+               av_get_pix_fmt_name(s->main_format));
+        return AVERROR(ENOSYS);
+    }
+
+    desc = av_pix_fmt_desc_get(s->main_format);
+    s->nb_planes      = av_pix_fmt_count_planes(s->main_format);
+    s->log2_chroma_w  = desc->log2_chroma_w;
+    s->log2_chroma_h  = desc->log2_chroma_h;
+    s->alpha_separate = s->overlay_format == AV_PIX_FMT_YUVA420P;
+
+    s->hwctx     = ((AVHWDeviceContext*)main_frames->device_ref->data)->hwctx;
+    s->cu_ctx    = s->hwctx->cuda_ctx;
+    s->cu_stream = s->hwctx->stream;
+    cu = s->hwctx->internal->cuda_dl;
+
+    outlink->w          = main_link->w;
+    outlink->h          = main_link->h;
+    outlink->time_base  = main_link->time_base;
+    outlink->frame_rate = main_link->frame_rate;
+    outlink->sample_aspect_ratio = main_link->sample_aspect_ratio;
+
+    /* Output frames come from a pool of our own, so that blending never
+     * holds on to surfaces of the (usually small) decoder pool. */
+    outlink->hw_frames_ctx = av_hwframe_ctx_alloc(main_frames->device_ref);
+    if (!outlink->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+    output_frames = (AVHWFramesContext*)outlink->hw_frames_ctx->data;
+
+    output_frames->format    = AV_PIX_FMT_CUDA;
+    output_frames->sw_format = s->main_format;
+    output_frames->width     = outlink->w;
+    output_frames->height    = outlink->h;
+
+    ret = ff_filter_init_hw_frames(avctx, outlink, 10);
+    if (ret < 0)
+        return ret;
+
+    ret = av_hwframe_ctx_init(outlink->hw_frames_ctx);
+    if (ret < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to initialise CUDA frame "
+               "context for output: %d\n", ret);
+        return ret;
+    }
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        return ret;
+
+    ret = CHECK_CU(cu->cuModuleLoadData(&s->cu_module, vf_overlay_cuda_ptx));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar, s->cu_module, "Overlay_Cuda_uchar"));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar2, s->cu_module, "Overlay_Cuda_uchar2"));
+    if (ret < 0)
+        goto exit;
+
+exit:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    if (ret < 0)
+        return ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, avctx);
+    if (ret < 0)
+        return ret;
+
+    return ff_framesync_configure(&s->fs);
+}
+
+static av_cold int overlay_cuda_init(AVFilterContext *avctx)
+{
+    OverlayCUDAContext *s = avctx->priv;
+
+    s->fs.on_event = &overlay_cuda_blend;
+
+    return 0;
+}
+
+static int overlay_cuda_activate(AVFilterContext *avctx)
+{
+    OverlayCUDAContext *s = avctx->priv;
+
+    return ff_framesync_activate(&s->fs);
+}
+
+static av_cold void overlay_cuda_uninit(AVFilterContext *avctx)
+{
+    OverlayCUDAContext *s = avctx->priv;
+
+    ff_framesync_uninit(&s->fs);
+
+    if (s->hwctx && s->cu_module) {
+        CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+        CUcontext dummy;
+
+        CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+        CHECK_CU(cu->cuModuleUnload(s->cu_module));
+        CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    }
+}
+
+#define OFFSET(x) offsetof(OverlayCUDAContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
+static const AVOption overlay_cuda_options[] = {
+    { "x", "Overlay x position",
+      OFFSET(x_position), AV_OPT_TYPE_INT, { .i64 = 0 }, INT_MIN, INT_MAX, .flags = FLAGS },
+    { "y", "Overlay y position",
+      OFFSET(y_position), AV_OPT_TYPE_INT, { .i64 = 0 }, INT_MIN, INT_MAX, .flags = FLAGS },
+    { NULL },
+};
+
+FRAMESYNC_DEFINE_CLASS(overlay_cuda, OverlayCUDAContext, fs);
+
+static const AVFilterPad overlay_cuda_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },
+    {
+        .name         = "overlay",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+static const AVFilterPad overlay_cuda_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = &overlay_cuda_config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_overlay_cuda = {
+    .name            = "overlay_cuda",
+    .description     = NULL_IF_CONFIG_SMALL("Overlay one video on top of another using CUDA"),
+    .priv_size       = sizeof(OverlayCUDAContext),
+    .priv_class      = &overlay_cuda_class,
+    .preinit         = overlay_cuda_framesync_preinit,
+    .init            = &overlay_cuda_init,
+    .uninit          = &overlay_cuda_uninit,
+    .query_formats   = &overlay_cuda_query_formats,
+    .activate        = &overlay_cuda_activate,
+    .inputs          = overlay_cuda_inputs,
+    .outputs         = overlay_cuda_outputs,
+    .flags_internal  = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
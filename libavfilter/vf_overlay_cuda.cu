@@ -0,0 +1,102 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+__device__ static inline unsigned char blend(unsigned char m, unsigned char o, int a)
+{
+    return (o * a + m * (255 - a) + 127) / 255;
+}
+
+/*
+ * Every output pixel is written exactly once: pixels outside the overlay
+ * rectangle are copied from the main frame, the others are blended with
+ * the overlay. Without an alpha plane the overlay is opaque.
+ */
+template<typename T>
+__device__ static inline void overlay(T *dst, int dst_pitch,
+                                      const T *main, int main_pitch,
+                                      const T *ovl, int ovl_pitch,
+                                      const unsigned char *alpha, int alpha_pitch,
+                                      int alpha_adj_x, int alpha_adj_y,
+                                      int width, int height,
+                                      int x_position, int y_position,
+                                      int ovl_width, int ovl_height,
+                                      T (*mix)(T, T, int))
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    int ox, oy;
+    T m;
+
+    if (x >= width || y >= height)
+        return;
+
+    m  = main[y * main_pitch + x];
+    ox = x - x_position;
+    oy = y - y_position;
+
+    if (ox >= 0 && oy >= 0 && ox < ovl_width && oy < ovl_height) {
+        int a = alpha ? alpha[oy * alpha_adj_y * alpha_pitch + ox * alpha_adj_x] : 255;
+        m = mix(m, ovl[oy * ovl_pitch + ox], a);
+    }
+
+    dst[y * dst_pitch + x] = m;
+}
+
+__device__ static unsigned char mix_uchar(unsigned char m, unsigned char o, int a)
+{
+    return blend(m, o, a);
+}
+
+__device__ static uchar2 mix_uchar2(uchar2 m, uchar2 o, int a)
+{
+    return make_uchar2(blend(m.x, o.x, a), blend(m.y, o.y, a));
+}
+
+extern "C" {
+
+__global__ void Overlay_Cuda_uchar(unsigned char *dst, int dst_pitch,
+                                   const unsigned char *main, int main_pitch,
+                                   const unsigned char *ovl, int ovl_pitch,
+                                   const unsigned char *alpha, int alpha_pitch,
+                                   int alpha_adj_x, int alpha_adj_y,
+                                   int width, int height,
+                                   int x_position, int y_position,
+                                   int ovl_width, int ovl_height)
+{
+    overlay(dst, dst_pitch, main, main_pitch, ovl, ovl_pitch,
+            alpha, alpha_pitch, alpha_adj_x, alpha_adj_y,
+            width, height, x_position, y_position,
+            ovl_width, ovl_height, mix_uchar);
+}
+
+__global__ void Overlay_Cuda_uchar2(uchar2 *dst, int dst_pitch,
+                                    const uchar2 *main, int main_pitch,
+                                    const uchar2 *ovl, int ovl_pitch,
+                                    const unsigned char *alpha, int alpha_pitch,
+                                    int alpha_adj_x, int alpha_adj_y,
+                                    int width, int height,
+                                    int x_position, int y_position,
+                                    int ovl_width, int ovl_height)
+{
+    overlay(dst, dst_pitch, main, main_pitch, ovl, ovl_pitch,
+            alpha, alpha_pitch, alpha_adj_x, alpha_adj_y,
+            width, height, x_position, y_position,
+            ovl_width, ovl_height, mix_uchar2);
+}
+
+}
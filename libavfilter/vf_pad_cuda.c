@@ -0,0 +1,474 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * CUDA video padding filter
+ */
+
+#include <float.h>
+
+#include "libavutil/colorspace.h"
+#include "libavutil/common.h"
+#include "libavutil/eval.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_cuda_internal.h"
+#include "libavutil/cuda_check.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define CHECK_CU(x) FF_CUDA_CHECK_DL(ctx, s->hwctx->internal->cuda_dl, x)
+
+#define DIV_UP(a, b) ( ((a) + (b) - 1) / (b) )
+#define BLOCKX 32
+#define BLOCKY 16
+
+extern char vf_pad_cuda_ptx[];
+
+static const enum AVPixelFormat supported_formats[] = {
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_P010,
+    AV_PIX_FMT_P016,
+    AV_PIX_FMT_YUV444P16,
+};
+
+static const char *const var_names[] = {
+    "in_w",   "iw",
+    "in_h",   "ih",
+    "out_w",  "ow",
+    "out_h",  "oh",
+    "x",
+    "y",
+    "a",
+    "sar",
+    "dar",
+    "hsub",
+    "vsub",
+    NULL
+};
+
+enum var_name {
+    VAR_IN_W,   VAR_IW,
+    VAR_IN_H,   VAR_IH,
+    VAR_OUT_W,  VAR_OW,
+    VAR_OUT_H,  VAR_OH,
+    VAR_X,
+    VAR_Y,
+    VAR_A,
+    VAR_SAR,
+    VAR_DAR,
+    VAR_HSUB,
+    VAR_VSUB,
+    VARS_NB
+};
+
+typedef struct PadCUDAContext {
+    const AVClass *class;
+
+    AVCUDADeviceContext *hwctx;
+    CUcontext   cu_ctx;
+    CUstream    cu_stream;
+    CUmodule    cu_module;
+    CUfunction  cu_func_uchar;
+    CUfunction  cu_func_uchar2;
+    CUfunction  cu_func_ushort;
+    CUfunction  cu_func_ushort2;
+
+    enum AVPixelFormat format;
+    const AVPixFmtDescriptor *desc;
+
+    int w, h;               ///< output dimensions, a value of 0 will result in the input size
+    int x, y;               ///< offsets of the input area with respect to the padded area
+    AVRational aspect;
+
+    char *w_expr;           ///< width  expression string
+    char *h_expr;           ///< height expression string
+    char *x_expr;           ///< x offset expression string
+    char *y_expr;           ///< y offset expression string
+    uint8_t rgba_color[4];  ///< color for the padding area
+
+    uint16_t plane_color[3];
+} PadCUDAContext;
+
+static int pad_cuda_query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_CUDA, AV_PIX_FMT_NONE,
+    };
+
+    return ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
+}
+
+static int format_is_supported(enum AVPixelFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(supported_formats); i++)
+        if (supported_formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static int eval_geometry(AVFilterContext *ctx, AVFilterLink *inlink)
+{
+    PadCUDAContext *s = ctx->priv;
+    AVRational adjusted_aspect = s->aspect;
+    int hsub = 1 << s->desc->log2_chroma_w;
+    int vsub = 1 << s->desc->log2_chroma_h;
+    double var_values[VARS_NB], res;
+    char *expr;
+    int ret;
+
+    var_values[VAR_IN_W]  = var_values[VAR_IW] = inlink->w;
+    var_values[VAR_IN_H]  = var_values[VAR_IH] = inlink->h;
+    var_values[VAR_OUT_W] = var_values[VAR_OW] = NAN;
+    var_values[VAR_OUT_H] = var_values[VAR_OH] = NAN;
+    var_values[VAR_A]     = (double) inlink->w / inlink->h;
+    var_values[VAR_SAR]   = inlink->sample_aspect_ratio.num ?
+        (double) inlink->sample_aspect_ratio.num / inlink->sample_aspect_ratio.den : 1;
+    var_values[VAR_DAR]   = var_values[VAR_A] * var_values[VAR_SAR];
+    var_values[VAR_HSUB]  = hsub;
+    var_values[VAR_VSUB]  = vsub;
+
+    /* evaluate width and height */
+    av_expr_parse_and_eval(&res, (expr = s->w_expr),
+                           var_names, var_values,
+                           NULL, NULL, NULL, NULL, NULL, 0, ctx);
+    s->w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->h_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->h = var_values[VAR_OUT_H] = var_values[VAR_OH] = res;
+    if (!s->h)
+        var_values[VAR_OUT_H] = var_values[VAR_OH] = s->h = inlink->h;
+
+    /* evaluate the width again, as it may depend on the evaluated output height */
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->w_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if (!s->w)
+        var_values[VAR_OUT_W] = var_values[VAR_OW] = s->w = inlink->w;
+
+    if (adjusted_aspect.num && adjusted_aspect.den) {
+        adjusted_aspect = av_div_q(adjusted_aspect, inlink->sample_aspect_ratio);
+        if (s->h < av_rescale(s->w, adjusted_aspect.den, adjusted_aspect.num)) {
+            s->h = var_values[VAR_OUT_H] = var_values[VAR_OH] = av_rescale(s->w, adjusted_aspect.den, adjusted_aspect.num);
+        } else {
+            s->w = var_values[VAR_OUT_W] = var_values[VAR_OW] = av_rescale(s->h, adjusted_aspect.num, adjusted_aspect.den);
+        }
+    }
+
+    /* evaluate x and y */
+    av_expr_parse_and_eval(&res, (expr = s->x_expr),
+                           var_names, var_values,
+                           NULL, NULL, NULL, NULL, NULL, 0, ctx);
+    s->x = var_values[VAR_X] = res;
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->y_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->y = var_values[VAR_Y] = res;
+    /* evaluate x again, as it may depend on the evaluated y value */
+    if ((ret = av_expr_parse_and_eval(&res, (expr = s->x_expr),
+                                      var_names, var_values,
+                                      NULL, NULL, NULL, NULL, NULL, 0, ctx)) < 0)
+        goto eval_fail;
+    s->x = var_values[VAR_X] = res;
+
+    if (s->x < 0 || s->x + inlink->w > s->w)
+        s->x = var_values[VAR_X] = (s->w - inlink->w) / 2;
+    if (s->y < 0 || s->y + inlink->h > s->h)
+        s->y = var_values[VAR_Y] = (s->h - inlink->h) / 2;
+
+    /* sanity check params */
+    if (s->w < 0 || s->h < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Negative values are not acceptable.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->w &= ~(hsub - 1);
+    s->h &= ~(vsub - 1);
+    s->x &= ~(hsub - 1);
+    s->y &= ~(vsub - 1);
+
+    av_log(ctx, AV_LOG_VERBOSE, "w:%d h:%d -> w:%d h:%d x:%d y:%d color:0x%02X%02X%02X%02X\n",
+           inlink->w, inlink->h, s->w, s->h, s->x, s->y,
+           s->rgba_color[0], s->rgba_color[1], s->rgba_color[2], s->rgba_color[3]);
+
+    if (s->x <  0 || s->y <  0                      ||
+        s->w <= 0 || s->h <= 0                      ||
+        (unsigned)s->x + (unsigned)inlink->w > s->w ||
+        (unsigned)s->y + (unsigned)inlink->h > s->h) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Input area %d:%d:%d:%d not within the padded area 0:0:%d:%d or zero-sized\n",
+               s->x, s->y, s->x + inlink->w, s->y + inlink->h, s->w, s->h);
+        return AVERROR(EINVAL);
+    }
+
+    return 0;
+
+eval_fail:
+    av_log(ctx, AV_LOG_ERROR,
+           "Error when evaluating the expression '%s'\n", expr);
+    return ret;
+}
+
+static int pad_cuda_config_props(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    PadCUDAContext   *s  = ctx->priv;
+    AVHWFramesContext *in_frames, *out_frames;
+    const uint8_t *rgba = s->rgba_color;
+    int shift, i, ret;
+    CudaFunctions *cu;
+    CUcontext dummy;
+
+    if (!inlink->hw_frames_ctx) {
+        av_log(ctx, AV_LOG_ERROR, "No hw context provided on input\n");
+        return AVERROR(EINVAL);
+    }
+    in_frames = (AVHWFramesContext*)inlink->hw_frames_ctx->data;
+
+    s->format = in_frames->sw_format;
+    if (!format_is_supported(s->format)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported input format: %s\n",
+               av_get_pix_fmt_name(s->format));
+        return AVERROR(ENOSYS);
+    }
+    s->desc = av_pix_fmt_desc_get(s->format);
+
+    ret = eval_geometry(ctx, inlink);
+    if (ret < 0)
+        return ret;
+
+    /* high bit depth formats keep their samples in the most significant bits */
+    shift = s->desc->comp[0].depth > 8 ? 8 : 0;
+    s->plane_color[0] = RGB_TO_Y_CCIR(rgba[0], rgba[1], rgba[2])    << shift;
+    s->plane_color[1] = RGB_TO_U_CCIR(rgba[0], rgba[1], rgba[2], 0) << shift;
+    s->plane_color[2] = RGB_TO_V_CCIR(rgba[0], rgba[1], rgba[2], 0) << shift;
+
+    s->hwctx     = ((AVHWDeviceContext*)in_frames->device_ref->data)->hwctx;
+    s->cu_ctx    = s->hwctx->cuda_ctx;
+    s->cu_stream = s->hwctx->stream;
+    cu = s->hwctx->internal->cuda_dl;
+
+    outlink->w = s->w;
+    outlink->h = s->h;
+
+    outlink->hw_frames_ctx = av_hwframe_ctx_alloc(in_frames->device_ref);
+    if (!outlink->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+    out_frames = (AVHWFramesContext*)outlink->hw_frames_ctx->data;
+
+    out_frames->format    = AV_PIX_FMT_CUDA;
+    out_frames->sw_format = s->format;
+    out_frames->width     = s->w;
+    out_frames->height    = s->h;
+
+    ret = ff_filter_init_hw_frames(ctx, outlink, 10);
+    if (ret < 0)
+        return ret;
+
+    ret = av_hwframe_ctx_init(outlink->hw_frames_ctx);
+    if (ret < 0)
+        return ret;
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        return ret;
+
+    ret = CHECK_CU(cu->cuModuleLoadData(&s->cu_module, vf_pad_cuda_ptx));
+    if (ret < 0)
+        goto exit;
+
+    for (i = 0; i < 4; i++) {
+        static const char *const names[] = {
+            "Pad_Cuda_uchar", "Pad_Cuda_uchar2", "Pad_Cuda_ushort", "Pad_Cuda_ushort2",
+        };
+        CUfunction *funcs[] = {
+            &s->cu_func_uchar, &s->cu_func_uchar2, &s->cu_func_ushort, &s->cu_func_ushort2,
+        };
+
+        ret = CHECK_CU(cu->cuModuleGetFunction(funcs[i], s->cu_module, names[i]));
+        if (ret < 0)
+            goto exit;
+    }
+
+exit:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+
+    return ret;
+}
+
+static int pad_cuda_plane(AVFilterContext *ctx, AVFrame *out, const AVFrame *in,
+                          int plane)
+{
+    PadCUDAContext *s = ctx->priv;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    const AVPixFmtDescriptor *desc = s->desc;
+    int shift_w   = plane ? desc->log2_chroma_w : 0;
+    int shift_h   = plane ? desc->log2_chroma_h : 0;
+    int word_size = desc->comp[0].depth > 8 ? 2 : 1;
+    /* the chroma components share a plane in semi-planar formats */
+    int channels  = plane && desc->comp[1].plane == desc->comp[2].plane ? 2 : 1;
+    int pixel_size = word_size * channels;
+    CUfunction func = word_size == 1 ? (channels == 1 ? s->cu_func_uchar  : s->cu_func_uchar2) :
+                                       (channels == 1 ? s->cu_func_ushort : s->cu_func_ushort2);
+    CUdeviceptr dst = (CUdeviceptr)out->data[plane];
+    CUdeviceptr src = (CUdeviceptr)in->data[plane];
+    int dst_pitch  = out->linesize[plane] / pixel_size;
+    int src_pitch  = in->linesize[plane]  / pixel_size;
+    int dst_width  = AV_CEIL_RSHIFT(out->width,  shift_w);
+    int dst_height = AV_CEIL_RSHIFT(out->height, shift_h);
+    int src_width  = AV_CEIL_RSHIFT(in->width,   shift_w);
+    int src_height = AV_CEIL_RSHIFT(in->height,  shift_h);
+    int x_position = s->x >> shift_w;
+    int y_position = s->y >> shift_h;
+    uint8_t  color8[2];
+    uint16_t color16[2];
+    void *args[] = {
+        &dst, &dst_pitch, &dst_width, &dst_height,
+        &src, &src_pitch, &src_width, &src_height,
+        &x_position, &y_position,
+        word_size == 1 ? (void *)color8 : (void *)color16,
+    };
+
+    color16[0] = s->plane_color[plane];
+    color16[1] = s->plane_color[channels == 2 ? 2 : plane];
+    color8[0]  = color16[0];
+    color8[1]  = color16[1];
+
+    return CHECK_CU(cu->cuLaunchKernel(func,
+                                       DIV_UP(dst_width, BLOCKX), DIV_UP(dst_height, BLOCKY), 1,
+                                       BLOCKX, BLOCKY, 1, 0, s->cu_stream, args, NULL));
+}
+
+static int pad_cuda_filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx     = inlink->dst;
+    PadCUDAContext  *s       = ctx->priv;
+    AVFilterLink    *outlink = ctx->outputs[0];
+    CudaFunctions   *cu      = s->hwctx->internal->cuda_dl;
+    AVFrame *out;
+    CUcontext dummy;
+    int plane, ret;
+
+    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        goto fail;
+
+    for (plane = 0; plane < av_pix_fmt_count_planes(s->format); plane++) {
+        ret = pad_cuda_plane(ctx, out, in, plane);
+        if (ret < 0)
+            break;
+    }
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    if (ret < 0)
+        goto fail;
+
+    ret = av_frame_copy_props(out, in);
+    if (ret < 0)
+        goto fail;
+
+    av_frame_free(&in);
+    return ff_filter_frame(outlink, out);
+
+fail:
+    av_frame_free(&in);
+    av_frame_free(&out);
+    return ret;
+}
+
+static av_cold void pad_cuda_uninit(AVFilterContext *ctx)
+{
+    PadCUDAContext *s = ctx->priv;
+
+    if (s->hwctx && s->cu_module) {
+        CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+        CUcontext dummy;
+
+        CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+        CHECK_CU(cu->cuModuleUnload(s->cu_module));
+        CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    }
+}
+
+#define OFFSET(x) offsetof(PadCUDAContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+static const AVOption pad_cuda_options[] = {
+    { "width",  "set the pad area width expression",       OFFSET(w_expr), AV_OPT_TYPE_STRING, {.str = "iw"}, 0, 0, FLAGS },
+    { "w",      "set the pad area width expression",       OFFSET(w_expr), AV_OPT_TYPE_STRING, {.str = "iw"}, 0, 0, FLAGS },
+    { "height", "set the pad area height expression",      OFFSET(h_expr), AV_OPT_TYPE_STRING, {.str = "ih"}, 0, 0, FLAGS },
+    { "h",      "set the pad area height expression",      OFFSET(h_expr), AV_OPT_TYPE_STRING, {.str = "ih"}, 0, 0, FLAGS },
+    { "x",      "set the x offset expression for the input image position", OFFSET(x_expr), AV_OPT_TYPE_STRING, {.str = "0"}, 0, 0, FLAGS },
+    { "y",      "set the y offset expression for the input image position", OFFSET(y_expr), AV_OPT_TYPE_STRING, {.str = "0"}, 0, 0, FLAGS },
+    { "color",  "set the color of the padded area border", OFFSET(rgba_color), AV_OPT_TYPE_COLOR, {.str = "black"}, .flags = FLAGS },
+    { "aspect", "pad to fit an aspect instead of a resolution", OFFSET(aspect), AV_OPT_TYPE_RATIONAL, {.dbl = 0}, 0, DBL_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(pad_cuda);
+
+static const AVFilterPad pad_cuda_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = pad_cuda_filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad pad_cuda_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = pad_cuda_config_props,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_pad_cuda = {
+    .name           = "pad_cuda",
+    .description    = NULL_IF_CONFIG_SMALL("Pad the input video using CUDA."),
+    .priv_size      = sizeof(PadCUDAContext),
+    .priv_class     = &pad_cuda_class,
+    .uninit         = pad_cuda_uninit,
+    .query_formats  = pad_cuda_query_formats,
+    .inputs         = pad_cuda_inputs,
+    .outputs        = pad_cuda_outputs,
+    .flags_internal = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
@@ -0,0 +1,69 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Copy the input into the (x, y) offset of the output and fill the
+ * remaining border with the pad colour, in a single pass over the
+ * output plane.
+ */
+template<typename T>
+__device__ static inline void pad(T *dst, int dst_pitch,
+                                  int dst_width, int dst_height,
+                                  const T *src, int src_pitch,
+                                  int src_width, int src_height,
+                                  int x_position, int y_position,
+                                  T color)
+{
+    int xo = blockIdx.x * blockDim.x + threadIdx.x;
+    int yo = blockIdx.y * blockDim.y + threadIdx.y;
+    int xi = xo - x_position;
+    int yi = yo - y_position;
+
+    if (xo >= dst_width || yo >= dst_height)
+        return;
+
+    if (xi >= 0 && yi >= 0 && xi < src_width && yi < src_height)
+        dst[yo * dst_pitch + xo] = src[yi * src_pitch + xi];
+    else
+        dst[yo * dst_pitch + xo] = color;
+}
+
+extern "C" {
+
+#define PAD_KERNEL(T)                                                       \
+__global__ void Pad_Cuda_ ## T(T *dst, int dst_pitch,                       \
+                               int dst_width, int dst_height,               \
+                               const T *src, int src_pitch,                 \
+                               int src_width, int src_height,               \
+                               int x_position, int y_position,              \
+                               T color)                                     \
+{                                                                           \
+    pad(dst, dst_pitch, dst_width, dst_height,                              \
+        src, src_pitch, src_width, src_height,                              \
+        x_position, y_position, color);                                     \
+}
+
+typedef unsigned char  uchar;
+typedef unsigned short ushort;
+
+PAD_KERNEL(uchar)
+PAD_KERNEL(uchar2)
+PAD_KERNEL(ushort)
+PAD_KERNEL(ushort2)
+
+}
@@ -25,7 +25,9 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "internal.h"
 
 #include "libpostproc/postprocess.h"
@@ -35,13 +37,32 @@ typedef struct PPFilterContext {
     char *subfilters;
     int mode_id;
     pp_mode *modes[PP_QUALITY_MAX + 1];
-    void *pp_ctx;
+    int slices;
+    int nb_slices;
+    int nb_planes;
+    int hsub, vsub;
+    void **pp_ctx;          ///< one context per slice
+    AVFrame **bands;        ///< output of each slice with its context lines, with more than one slice
 } PPFilterContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int aligned_w;
+    const int8_t *qp_table;
+    int qstride;
+    int pict_type;
+} ThreadData;
+
+/* Lines processed above and below each slice so that the filters reading
+ * neighbouring blocks see the same picture as when processing all at once.
+ * This is 2 block rows of chroma for vertically subsampled formats. */
+#define SLICE_CONTEXT 32
+
 #define OFFSET(x) offsetof(PPFilterContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 static const AVOption pp_options[] = {
     { "subfilters", "set postprocess subfilters", OFFSET(subfilters), AV_OPT_TYPE_STRING, {.str="de"}, .flags = FLAGS },
+    { "slices",     "set number of slices processed in parallel", OFFSET(slices), AV_OPT_TYPE_INT, {.i64=1}, 1, 256, .flags = FLAGS },
     { NULL }
 };
 
@@ -96,6 +117,8 @@ static int pp_config_props(AVFilterLink *inlink)
 {
     int flags = PP_CPU_CAPS_AUTO;
     PPFilterContext *pp = inlink->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i, band_h;
 
     switch (inlink->format) {
     case AV_PIX_FMT_GRAY8:
@@ -112,9 +135,94 @@ static int pp_config_props(AVFilterLink *inlink)
     default: av_assert0(0);
     }
 
-    pp->pp_ctx = pp_get_context(inlink->w, inlink->h, flags);
+    /* slices start on macroblock rows, so that they can use the QP table
+     * of the frame */
+    pp->nb_planes = av_pix_fmt_count_planes(inlink->format);
+    pp->hsub      = desc->log2_chroma_w;
+    pp->vsub      = desc->log2_chroma_h;
+    pp->nb_slices = FFMIN(pp->slices, (inlink->h + 15) >> 4);
+    band_h        = pp->nb_slices > 1 ?
+                    FFMIN(FFALIGN(inlink->h, 16 * pp->nb_slices) / pp->nb_slices + 2 * SLICE_CONTEXT,
+                          inlink->h) : inlink->h;
+
+    pp->pp_ctx = av_mallocz_array(pp->nb_slices, sizeof(*pp->pp_ctx));
     if (!pp->pp_ctx)
         return AVERROR(ENOMEM);
+    for (i = 0; i < pp->nb_slices; i++) {
+        pp->pp_ctx[i] = pp_get_context(inlink->w, band_h, flags);
+        if (!pp->pp_ctx[i])
+            return AVERROR(ENOMEM);
+    }
+
+    if (pp->nb_slices > 1) {
+        pp->bands = av_mallocz_array(pp->nb_slices, sizeof(*pp->bands));
+        if (!pp->bands)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < pp->nb_slices; i++) {
+            int ret;
+            AVFrame *band = pp->bands[i] = av_frame_alloc();
+            if (!band)
+                return AVERROR(ENOMEM);
+            band->format = inlink->format;
+            band->width  = FFALIGN(inlink->w, 8);
+            band->height = FFALIGN(band_h, 8);
+            if ((ret = av_frame_get_buffer(band, 32)) < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+static int pp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PPFilterContext *pp = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    const int h       = in->height;
+    const int mb_rows = (h + 15) >> 4;
+    const int y0 = 16 * (mb_rows *  jobnr      / nb_jobs);
+    const int y1 = FFMIN(16 * (mb_rows * (jobnr + 1) / nb_jobs), h);
+    const int b0 = FFMAX(y0 - SLICE_CONTEXT, 0);
+    const int b1 = FFMIN(y1 + SLICE_CONTEXT, h);
+    const uint8_t *src[3] = { NULL };
+    uint8_t *dst[3] = { NULL };
+    AVFrame *band;
+    int p;
+
+    if (nb_jobs == 1) {
+        pp_postprocess((const uint8_t **)in->data, in->linesize,
+                       out->data,                  out->linesize,
+                       td->aligned_w, h,
+                       td->qp_table,
+                       td->qstride,
+                       pp->modes[pp->mode_id],
+                       pp->pp_ctx[0],
+                       td->pict_type);
+        return 0;
+    }
+
+    band = pp->bands[jobnr];
+    for (p = 0; p < pp->nb_planes; p++) {
+        int vsub = p ? pp->vsub : 0;
+        src[p] = in->data[p] + (b0 >> vsub) * in->linesize[p];
+        dst[p] = band->data[p];
+    }
+
+    pp_postprocess(src, in->linesize, dst, band->linesize,
+                   td->aligned_w, b1 - b0,
+                   td->qp_table ? td->qp_table + (b0 >> 4) * td->qstride : NULL,
+                   td->qstride,
+                   pp->modes[pp->mode_id],
+                   pp->pp_ctx[jobnr],
+                   td->pict_type);
+
+    for (p = 0; p < pp->nb_planes; p++) {
+        int hsub = p ? pp->hsub : 0;
+        int vsub = p ? pp->vsub : 0;
+        av_image_copy_plane(out->data[p] + (y0 >> vsub) * out->linesize[p], out->linesize[p],
+                            band->data[p] + ((y0 - b0) >> vsub) * band->linesize[p], band->linesize[p],
+                            td->aligned_w >> hsub, (y1 >> vsub) - (y0 >> vsub));
+    }
     return 0;
 }
 
@@ -126,6 +234,7 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFrame *inbuf)
     const int aligned_w = FFALIGN(outlink->w, 8);
     const int aligned_h = FFALIGN(outlink->h, 8);
     AVFrame *outbuf;
+    ThreadData td;
     int qstride, qp_type;
     int8_t *qp_table ;
 
@@ -139,14 +248,13 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFrame *inbuf)
     outbuf->height = inbuf->height;
     qp_table = av_frame_get_qp_table(inbuf, &qstride, &qp_type);
 
-    pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
-                   outbuf->data,                 outbuf->linesize,
-                   aligned_w, outlink->h,
-                   qp_table,
-                   qstride,
-                   pp->modes[pp->mode_id],
-                   pp->pp_ctx,
-                   outbuf->pict_type | (qp_type ? PP_PICT_TYPE_QP2 : 0));
+    td.in        = inbuf;
+    td.out       = outbuf;
+    td.aligned_w = aligned_w;
+    td.qp_table  = qp_table;
+    td.qstride   = qstride;
+    td.pict_type = outbuf->pict_type | (qp_type ? PP_PICT_TYPE_QP2 : 0);
+    ctx->internal->execute(ctx, pp_slice, &td, NULL, pp->nb_slices);
 
     av_frame_free(&inbuf);
     return ff_filter_frame(outlink, outbuf);
@@ -159,8 +267,14 @@ static av_cold void pp_uninit(AVFilterContext *ctx)
 
     for (i = 0; i <= PP_QUALITY_MAX; i++)
         pp_free_mode(pp->modes[i]);
-    if (pp->pp_ctx)
-        pp_free_context(pp->pp_ctx);
+    for (i = 0; i < pp->nb_slices; i++) {
+        if (pp->pp_ctx && pp->pp_ctx[i])
+            pp_free_context(pp->pp_ctx[i]);
+        if (pp->bands)
+            av_frame_free(&pp->bands[i]);
+    }
+    av_freep(&pp->pp_ctx);
+    av_freep(&pp->bands);
 }
 
 static const AVFilterPad pp_inputs[] = {
@@ -192,5 +306,5 @@ AVFilter ff_vf_pp = {
     .outputs         = pp_outputs,
     .process_command = pp_process_command,
     .priv_class      = &pp_class,
-    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
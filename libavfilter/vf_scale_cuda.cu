@@ -208,4 +208,93 @@ __global__ void Subsample_Bilinear_ushort4(cudaTextureObject_t ushort4_tex,
     }
 }
 
+
+}
+
+/*
+ * Ladder kernels: one launch scales a plane to up to LADDER_MAX_OUTPUTS
+ * sizes, blockIdx.z selecting the output. All outputs sample the same
+ * texture, so the source plane is fetched from device memory once and
+ * served from the texture cache for the remaining rungs.
+ */
+
+#define LADDER_MAX_OUTPUTS 8
+
+struct LadderOutput {
+    void *dst;
+    int width;
+    int height;
+    int pitch;
+};
+
+struct LadderOutputs {
+    LadderOutput out[LADDER_MAX_OUTPUTS];
+};
+
+__device__ static inline unsigned char avg4(unsigned char a, unsigned char b,
+                                            unsigned char c, unsigned char d)
+{
+    return ((int)a + (int)b + (int)c + (int)d + 2) >> 2;
+}
+
+__device__ static inline unsigned short avg4(unsigned short a, unsigned short b,
+                                             unsigned short c, unsigned short d)
+{
+    return ((int)a + (int)b + (int)c + (int)d + 2) >> 2;
+}
+
+__device__ static inline uchar2 avg4(uchar2 a, uchar2 b, uchar2 c, uchar2 d)
+{
+    return make_uchar2(avg4(a.x, b.x, c.x, d.x), avg4(a.y, b.y, c.y, d.y));
+}
+
+__device__ static inline ushort2 avg4(ushort2 a, ushort2 b, ushort2 c, ushort2 d)
+{
+    return make_ushort2(avg4(a.x, b.x, c.x, d.x), avg4(a.y, b.y, c.y, d.y));
+}
+
+template<typename T>
+__device__ static inline void subsample_bilinear_ladder(cudaTextureObject_t tex,
+                                                        const LadderOutputs &outputs,
+                                                        int src_width, int src_height)
+{
+    const LadderOutput &o = outputs.out[blockIdx.z];
+    int xo = blockIdx.x * blockDim.x + threadIdx.x;
+    int yo = blockIdx.y * blockDim.y + threadIdx.y;
+
+    if (yo < o.height && xo < o.width)
+    {
+        float hscale = (float)src_width / (float)o.width;
+        float vscale = (float)src_height / (float)o.height;
+        float xi = (xo + 0.5f) * hscale;
+        float yi = (yo + 0.5f) * vscale;
+        // 3-tap filter weights are {wh,1.0,wh} and {wv,1.0,wv}
+        float wh = min(max(0.5f * (hscale - 1.0f), 0.0f), 1.0f);
+        float wv = min(max(0.5f * (vscale - 1.0f), 0.0f), 1.0f);
+        // Convert weights to two bilinear weights -> {wh,1.0,wh} -> {wh,0.5,0} + {0,0.5,wh}
+        float dx = wh / (0.5f + wh);
+        float dy = wv / (0.5f + wv);
+        T c0 = tex2D<T>(tex, xi-dx, yi-dy);
+        T c1 = tex2D<T>(tex, xi+dx, yi-dy);
+        T c2 = tex2D<T>(tex, xi-dx, yi+dy);
+        T c3 = tex2D<T>(tex, xi+dx, yi+dy);
+        ((T *)o.dst)[yo*o.pitch+xo] = avg4(c0, c1, c2, c3);
+    }
+}
+
+extern "C" {
+
+#define LADDER_KERNEL(name, T)                                                      \
+__global__ void Subsample_Bilinear_Ladder_ ## name(cudaTextureObject_t tex,         \
+                                                   LadderOutputs outputs,           \
+                                                   int src_width, int src_height)   \
+{                                                                                   \
+    subsample_bilinear_ladder<T>(tex, outputs, src_width, src_height);              \
+}
+
+LADDER_KERNEL(uchar,   unsigned char)
+LADDER_KERNEL(uchar2,  uchar2)
+LADDER_KERNEL(ushort,  unsigned short)
+LADDER_KERNEL(ushort2, ushort2)
+
 }
@@ -0,0 +1,471 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scale CUDA frames to several resolutions at once.
+ *
+ * Every plane of the source frame is bound to a single texture and
+ * scaled to all outputs by one kernel launch, instead of one launch and
+ * one full read of the source per output as with split + scale_cuda.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_cuda_internal.h"
+#include "libavutil/cuda_check.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define DIV_UP(a, b) ( ((a) + (b) - 1) / (b) )
+#define BLOCKX 32
+#define BLOCKY 16
+
+/* must match vf_scale_cuda.cu */
+#define LADDER_MAX_OUTPUTS 8
+
+typedef struct LadderOutput {
+    CUdeviceptr dst;
+    int width;
+    int height;
+    int pitch;
+} LadderOutput;
+
+typedef struct LadderOutputs {
+    LadderOutput out[LADDER_MAX_OUTPUTS];
+} LadderOutputs;
+
+#define CHECK_CU(x) FF_CUDA_CHECK_DL(ctx, s->hwctx->internal->cuda_dl, x)
+
+static const enum AVPixelFormat supported_formats[] = {
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_P010,
+    AV_PIX_FMT_P016,
+    AV_PIX_FMT_YUV444P16,
+};
+
+typedef struct CUDAScaleLadderContext {
+    const AVClass *class;
+
+    AVCUDADeviceContext *hwctx;
+    CUcontext   cu_ctx;
+    CUstream    cu_stream;
+    CUmodule    cu_module;
+    CUfunction  cu_func_uchar;
+    CUfunction  cu_func_uchar2;
+    CUfunction  cu_func_ushort;
+    CUfunction  cu_func_ushort2;
+
+    enum AVPixelFormat format;
+    const AVPixFmtDescriptor *desc;
+
+    char *sizes_str;
+    int nb_outputs;
+    struct {
+        int width;
+        int height;
+    } sizes[LADDER_MAX_OUTPUTS];
+} CUDAScaleLadderContext;
+
+static int format_is_supported(enum AVPixelFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(supported_formats); i++)
+        if (supported_formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static int ladder_load_module(AVFilterContext *ctx)
+{
+    CUDAScaleLadderContext *s = ctx->priv;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    CUcontext dummy;
+    int ret;
+
+    extern char vf_scale_cuda_ptx[];
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        return ret;
+
+    ret = CHECK_CU(cu->cuModuleLoadData(&s->cu_module, vf_scale_cuda_ptx));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar, s->cu_module, "Subsample_Bilinear_Ladder_uchar"));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_uchar2, s->cu_module, "Subsample_Bilinear_Ladder_uchar2"));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_ushort, s->cu_module, "Subsample_Bilinear_Ladder_ushort"));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuModuleGetFunction(&s->cu_func_ushort2, s->cu_module, "Subsample_Bilinear_Ladder_ushort2"));
+    if (ret < 0)
+        goto exit;
+
+exit:
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    return ret;
+}
+
+static int ladder_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext        *ctx = outlink->src;
+    AVFilterLink        *inlink = ctx->inputs[0];
+    CUDAScaleLadderContext   *s = ctx->priv;
+    int idx = FF_OUTLINK_IDX(outlink);
+    AVHWFramesContext *in_frames, *out_frames;
+    int ret;
+
+    if (!inlink->hw_frames_ctx) {
+        av_log(ctx, AV_LOG_ERROR, "No hw context provided on input\n");
+        return AVERROR(EINVAL);
+    }
+    in_frames = (AVHWFramesContext*)inlink->hw_frames_ctx->data;
+
+    if (!s->cu_module) {
+        s->format = in_frames->sw_format;
+        if (!format_is_supported(s->format)) {
+            av_log(ctx, AV_LOG_ERROR, "Unsupported input format: %s\n",
+                   av_get_pix_fmt_name(s->format));
+            return AVERROR(ENOSYS);
+        }
+        s->desc = av_pix_fmt_desc_get(s->format);
+
+        s->hwctx     = ((AVHWDeviceContext*)in_frames->device_ref->data)->hwctx;
+        s->cu_ctx    = s->hwctx->cuda_ctx;
+        s->cu_stream = s->hwctx->stream;
+
+        ret = ladder_load_module(ctx);
+        if (ret < 0)
+            return ret;
+    }
+
+    outlink->w = s->sizes[idx].width;
+    outlink->h = s->sizes[idx].height;
+
+    if (inlink->sample_aspect_ratio.num) {
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h*inlink->w,
+                                                             outlink->w*inlink->h},
+                                                inlink->sample_aspect_ratio);
+    } else {
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    }
+
+    outlink->hw_frames_ctx = av_hwframe_ctx_alloc(in_frames->device_ref);
+    if (!outlink->hw_frames_ctx)
+        return AVERROR(ENOMEM);
+    out_frames = (AVHWFramesContext*)outlink->hw_frames_ctx->data;
+
+    out_frames->format    = AV_PIX_FMT_CUDA;
+    out_frames->sw_format = s->format;
+    out_frames->width     = outlink->w;
+    out_frames->height    = outlink->h;
+
+    ret = ff_filter_init_hw_frames(ctx, outlink, 10);
+    if (ret < 0)
+        return ret;
+
+    ret = av_hwframe_ctx_init(outlink->hw_frames_ctx);
+    if (ret < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "%s: w:%d h:%d -> w:%d h:%d\n",
+           ctx->output_pads[idx].name, inlink->w, inlink->h, outlink->w, outlink->h);
+
+    return 0;
+}
+
+static av_cold int ladder_init(AVFilterContext *ctx)
+{
+    CUDAScaleLadderContext *s = ctx->priv;
+    char *sizes, *p, *saveptr = NULL;
+    int ret = 0;
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (p = sizes; ; p = NULL) {
+        AVFilterPad pad = { 0 };
+        char *size = av_strtok(p, "|", &saveptr);
+
+        if (!size)
+            break;
+
+        if (s->nb_outputs == LADDER_MAX_OUTPUTS) {
+            av_log(ctx, AV_LOG_ERROR, "At most %d outputs are supported.\n",
+                   LADDER_MAX_OUTPUTS);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+
+        ret = av_parse_video_size(&s->sizes[s->nb_outputs].width,
+                                  &s->sizes[s->nb_outputs].height, size);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'.\n", size);
+            goto end;
+        }
+
+        pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.name = av_asprintf("out%d", s->nb_outputs);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        pad.config_props = ladder_config_output;
+
+        if ((ret = ff_insert_outpad(ctx, s->nb_outputs, &pad)) < 0) {
+            av_freep(&pad.name);
+            goto end;
+        }
+        s->nb_outputs++;
+    }
+
+    if (!s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        ret = AVERROR(EINVAL);
+    }
+
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static av_cold void ladder_uninit(AVFilterContext *ctx)
+{
+    CUDAScaleLadderContext *s = ctx->priv;
+    int i;
+
+    if (s->hwctx && s->cu_module) {
+        CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+        CUcontext dummy;
+
+        CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+        CHECK_CU(cu->cuModuleUnload(s->cu_module));
+        CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int ladder_query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pixel_formats[] = {
+        AV_PIX_FMT_CUDA, AV_PIX_FMT_NONE,
+    };
+
+    return ff_set_common_formats(ctx, ff_make_format_list(pixel_formats));
+}
+
+static int ladder_scale_plane(AVFilterContext *ctx, AVFrame **out, int nb_out,
+                              const AVFrame *in, int plane)
+{
+    CUDAScaleLadderContext *s = ctx->priv;
+    CudaFunctions *cu = s->hwctx->internal->cuda_dl;
+    const AVPixFmtDescriptor *desc = s->desc;
+    int shift_w    = plane ? desc->log2_chroma_w : 0;
+    int shift_h    = plane ? desc->log2_chroma_h : 0;
+    int word_size  = desc->comp[0].depth > 8 ? 2 : 1;
+    /* the chroma components share a plane in semi-planar formats */
+    int channels   = plane && desc->comp[1].plane == desc->comp[2].plane ? 2 : 1;
+    int pixel_size = word_size * channels;
+    int src_width  = in->width  >> shift_w;
+    int src_height = in->height >> shift_h;
+    int max_width = 0, max_height = 0;
+    CUfunction func = word_size == 1 ? (channels == 1 ? s->cu_func_uchar  : s->cu_func_uchar2) :
+                                       (channels == 1 ? s->cu_func_ushort : s->cu_func_ushort2);
+    LadderOutputs outputs = { 0 };
+    CUtexObject tex = 0;
+    void *args[] = { &tex, &outputs, &src_width, &src_height };
+    int i, ret;
+
+    CUDA_TEXTURE_DESC tex_desc = {
+        .filterMode = CU_TR_FILTER_MODE_LINEAR,
+        .flags = CU_TRSF_READ_AS_INTEGER,
+    };
+
+    CUDA_RESOURCE_DESC res_desc = {
+        .resType = CU_RESOURCE_TYPE_PITCH2D,
+        .res.pitch2D.format = word_size == 1 ?
+                              CU_AD_FORMAT_UNSIGNED_INT8 :
+                              CU_AD_FORMAT_UNSIGNED_INT16,
+        .res.pitch2D.numChannels = channels,
+        .res.pitch2D.width = src_width,
+        .res.pitch2D.height = src_height,
+        .res.pitch2D.pitchInBytes = in->linesize[plane],
+        .res.pitch2D.devPtr = (CUdeviceptr)in->data[plane],
+    };
+
+    for (i = 0; i < nb_out; i++) {
+        LadderOutput *o = &outputs.out[i];
+
+        o->dst    = (CUdeviceptr)out[i]->data[plane];
+        o->width  = out[i]->width  >> shift_w;
+        o->height = out[i]->height >> shift_h;
+        o->pitch  = out[i]->linesize[plane] / pixel_size;
+        max_width  = FFMAX(max_width,  o->width);
+        max_height = FFMAX(max_height, o->height);
+    }
+
+    ret = CHECK_CU(cu->cuTexObjectCreate(&tex, &res_desc, &tex_desc, NULL));
+    if (ret < 0)
+        goto exit;
+
+    ret = CHECK_CU(cu->cuLaunchKernel(func,
+                                      DIV_UP(max_width, BLOCKX), DIV_UP(max_height, BLOCKY), nb_out,
+                                      BLOCKX, BLOCKY, 1, 0, s->cu_stream, args, NULL));
+
+exit:
+    if (tex)
+        CHECK_CU(cu->cuTexObjectDestroy(tex));
+
+    return ret;
+}
+
+static int ladder_filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext      *ctx = inlink->dst;
+    CUDAScaleLadderContext *s = ctx->priv;
+    CudaFunctions         *cu = s->hwctx->internal->cuda_dl;
+    AVFrame *out[LADDER_MAX_OUTPUTS] = { NULL };
+    int      out_idx[LADDER_MAX_OUTPUTS];
+    int i, plane, nb_out = 0, ret = 0;
+    CUcontext dummy;
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        if (ff_outlink_get_status(outlink))
+            continue;
+
+        out[nb_out] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[nb_out]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        out_idx[nb_out++] = i;
+    }
+
+    if (!nb_out) {
+        av_frame_free(&in);
+        return AVERROR_EOF;
+    }
+
+    ret = CHECK_CU(cu->cuCtxPushCurrent(s->cu_ctx));
+    if (ret < 0)
+        goto fail;
+
+    for (plane = 0; plane < av_pix_fmt_count_planes(s->format); plane++) {
+        ret = ladder_scale_plane(ctx, out, nb_out, in, plane);
+        if (ret < 0)
+            break;
+    }
+
+    CHECK_CU(cu->cuCtxPopCurrent(&dummy));
+    if (ret < 0)
+        goto fail;
+
+    for (i = 0; i < nb_out; i++) {
+        AVFilterLink *outlink = ctx->outputs[out_idx[i]];
+        AVFrame *frame = out[i];
+
+        out[i] = NULL;
+
+        ret = av_frame_copy_props(frame, in);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            goto fail;
+        }
+
+        av_reduce(&frame->sample_aspect_ratio.num, &frame->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+
+        ret = ff_filter_frame(outlink, frame);
+        if (ret < 0)
+            goto fail;
+    }
+
+fail:
+    for (i = 0; i < nb_out; i++)
+        av_frame_free(&out[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(CUDAScaleLadderContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM)
+static const AVOption options[] = {
+    { "sizes", "'|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = "hd720|nhd" }, .flags = FLAGS },
+    { NULL },
+};
+
+static const AVClass cudascale_ladder_class = {
+    .class_name = "cudascale_ladder",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+static const AVFilterPad ladder_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = ladder_filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_scale_cuda_ladder = {
+    .name          = "scale_cuda_ladder",
+    .description   = NULL_IF_CONFIG_SMALL("GPU accelerated multi-resolution resizer"),
+
+    .init          = ladder_init,
+    .uninit        = ladder_uninit,
+    .query_formats = ladder_query_formats,
+
+    .priv_size     = sizeof(CUDAScaleLadderContext),
+    .priv_class    = &cudascale_ladder_class,
+
+    .inputs        = ladder_inputs,
+    .outputs       = NULL,
+
+    .flags          = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags_internal = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
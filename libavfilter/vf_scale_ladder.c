@@ -0,0 +1,407 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scale video to several resolutions at once.
+ *
+ * Each output is scaled from the smallest larger rung that is at most
+ * max_ratio times its size, and from the source only when there is none,
+ * so a ladder of successive downscales reads the full resolution frame
+ * once or twice instead of once per rung as with split + scale.
+ *
+ * The rungs scaled from the same level of the ladder are independent and
+ * run as jobs of the filter's slice threading, one per rung.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define LADDER_MAX_OUTPUTS 16
+
+typedef struct LadderRung {
+    int width;
+    int height;
+    /* index of the rung this one is scaled from, -1 for the input */
+    int parent;
+    struct SwsContext *sws;
+} LadderRung;
+
+typedef struct ScaleLadderContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    char *flags_str;
+    int flags;
+    double max_ratio;
+
+    int nb_outputs;
+    LadderRung rungs[LADDER_MAX_OUTPUTS];
+    /* rungs in processing order, grouped by their distance to the input */
+    int order[LADDER_MAX_OUTPUTS];
+    /* end of each group in order[] */
+    int level_end[LADDER_MAX_OUTPUTS];
+    int nb_levels;
+} ScaleLadderContext;
+
+typedef struct ThreadData {
+    AVFrame *in;
+    AVFrame **out;
+    /* rungs of the level being scaled */
+    const int *rungs;
+} ThreadData;
+
+/* Pick the smallest rung covering this one within max_ratio in both
+ * dimensions. Rungs with a larger area come first in case of equal sizes,
+ * which keeps the graph acyclic. */
+static int ladder_find_parent(ScaleLadderContext *s, int idx)
+{
+    const LadderRung *rung = &s->rungs[idx];
+    int64_t area = (int64_t)rung->width * rung->height;
+    int64_t best_area = INT64_MAX;
+    int i, best = -1;
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        const LadderRung *p = &s->rungs[i];
+        int64_t p_area = (int64_t)p->width * p->height;
+
+        if (i == idx || p->width < rung->width || p->height < rung->height)
+            continue;
+        if (p_area < area || (p_area == area && i > idx))
+            continue;
+        if (p->width  > rung->width  * s->max_ratio ||
+            p->height > rung->height * s->max_ratio)
+            continue;
+        if (p_area < best_area) {
+            best_area = p_area;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+static int ladder_config_input(AVFilterLink *inlink)
+{
+    AVFilterContext  *ctx = inlink->dst;
+    ScaleLadderContext *s = ctx->priv;
+    int level[LADDER_MAX_OUTPUTS] = { 0 };
+    int i, n = 0;
+
+    for (i = 0; i < s->nb_outputs; i++)
+        s->rungs[i].parent = ladder_find_parent(s, i);
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        int parent;
+
+        for (parent = s->rungs[i].parent; parent >= 0; parent = s->rungs[parent].parent)
+            level[i]++;
+    }
+
+    for (s->nb_levels = 0; n < s->nb_outputs; s->nb_levels++) {
+        for (i = 0; i < s->nb_outputs; i++)
+            if (level[i] == s->nb_levels)
+                s->order[n++] = i;
+        s->level_end[s->nb_levels] = n;
+    }
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        LadderRung *rung = &s->rungs[i];
+        int src_w = rung->parent < 0 ? inlink->w : s->rungs[rung->parent].width;
+        int src_h = rung->parent < 0 ? inlink->h : s->rungs[rung->parent].height;
+        int ret;
+
+        sws_freeContext(rung->sws);
+        rung->sws = sws_alloc_context();
+        if (!rung->sws)
+            return AVERROR(ENOMEM);
+
+        av_opt_set_int(rung->sws, "srcw", src_w, 0);
+        av_opt_set_int(rung->sws, "srch", src_h, 0);
+        av_opt_set_int(rung->sws, "src_format", inlink->format, 0);
+        av_opt_set_int(rung->sws, "dstw", rung->width, 0);
+        av_opt_set_int(rung->sws, "dsth", rung->height, 0);
+        av_opt_set_int(rung->sws, "dst_format", inlink->format, 0);
+        av_opt_set_int(rung->sws, "sws_flags", s->flags, 0);
+        /* the filter threads already run the rungs concurrently */
+        av_opt_set_int(rung->sws, "threads", 1, 0);
+
+        if ((ret = sws_init_context(rung->sws, NULL, NULL)) < 0)
+            return ret;
+
+        av_log(ctx, AV_LOG_VERBOSE, "out%d: w:%d h:%d -> w:%d h:%d (from %s)\n",
+               i, src_w, src_h, rung->width, rung->height,
+               rung->parent < 0 ? "input" : ctx->output_pads[rung->parent].name);
+    }
+
+    return 0;
+}
+
+static int ladder_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext    *ctx = outlink->src;
+    AVFilterLink    *inlink = ctx->inputs[0];
+    ScaleLadderContext   *s = ctx->priv;
+    int idx = FF_OUTLINK_IDX(outlink);
+
+    outlink->w = s->rungs[idx].width;
+    outlink->h = s->rungs[idx].height;
+
+    if (inlink->sample_aspect_ratio.num) {
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h*inlink->w,
+                                                             outlink->w*inlink->h},
+                                                inlink->sample_aspect_ratio);
+    } else {
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    }
+
+    return 0;
+}
+
+static av_cold int ladder_init(AVFilterContext *ctx)
+{
+    ScaleLadderContext *s = ctx->priv;
+    char *sizes, *p, *saveptr = NULL;
+    int ret = 0;
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (p = sizes; ; p = NULL) {
+        AVFilterPad pad = { 0 };
+        char *size = av_strtok(p, "|", &saveptr);
+        LadderRung *rung = &s->rungs[s->nb_outputs];
+
+        if (!size)
+            break;
+
+        if (s->nb_outputs == LADDER_MAX_OUTPUTS) {
+            av_log(ctx, AV_LOG_ERROR, "At most %d outputs are supported.\n",
+                   LADDER_MAX_OUTPUTS);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+
+        ret = av_parse_video_size(&rung->width, &rung->height, size);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'.\n", size);
+            goto end;
+        }
+
+        pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.name = av_asprintf("out%d", s->nb_outputs);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        pad.config_props = ladder_config_output;
+
+        if ((ret = ff_insert_outpad(ctx, s->nb_outputs, &pad)) < 0) {
+            av_freep(&pad.name);
+            goto end;
+        }
+        s->nb_outputs++;
+    }
+
+    if (!s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        ret = AVERROR(EINVAL);
+    }
+
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static av_cold void ladder_uninit(AVFilterContext *ctx)
+{
+    ScaleLadderContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < s->nb_outputs; i++)
+        sws_freeContext(s->rungs[i].sws);
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int ladder_query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    /* the rungs are scaled from each other, so all links share one format */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    return ff_set_common_formats(ctx, formats);
+}
+
+static int ladder_scale_rung(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleLadderContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int idx = td->rungs[jobnr];
+    const LadderRung *rung = &s->rungs[idx];
+    const AVFrame *src = rung->parent < 0 ? td->in : td->out[rung->parent];
+    AVFrame *dst = td->out[idx];
+    int ret;
+
+    ret = sws_scale(rung->sws, (const uint8_t * const *)src->data,
+                    src->linesize, 0, src->height,
+                    dst->data, dst->linesize);
+    return FFMIN(ret, 0);
+}
+
+static int ladder_filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext  *ctx = inlink->dst;
+    ScaleLadderContext *s = ctx->priv;
+    AVFrame *out[LADDER_MAX_OUTPUTS] = { NULL };
+    int job_ret[LADDER_MAX_OUTPUTS];
+    ThreadData td = { .in = in, .out = out };
+    int i, j, ret = 0, eof = 1;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        eof &= !!ff_outlink_get_status(ctx->outputs[i]);
+    if (eof) {
+        av_frame_free(&in);
+        return AVERROR_EOF;
+    }
+
+    /* closed outputs are still scaled, other rungs may be built from them */
+    for (i = 0; i < s->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        ret = av_frame_copy_props(out[i], in);
+        if (ret < 0)
+            goto fail;
+
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+    }
+
+    /* each level only reads the frames of the previous ones */
+    for (i = 0; i < s->nb_levels; i++) {
+        int start = i ? s->level_end[i - 1] : 0;
+        int nb_jobs = s->level_end[i] - start;
+
+        td.rungs = s->order + start;
+        ctx->internal->execute(ctx, ladder_scale_rung, &td, job_ret, nb_jobs);
+        for (j = 0; j < nb_jobs; j++) {
+            if (job_ret[j] < 0) {
+                ret = job_ret[j];
+                goto fail;
+            }
+        }
+    }
+
+    /* only hand the frames over once no other rung reads them */
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFrame *frame = out[i];
+
+        out[i] = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&frame);
+            continue;
+        }
+
+        ret = ff_filter_frame(ctx->outputs[i], frame);
+        if (ret < 0)
+            goto fail;
+    }
+
+fail:
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_frame_free(&out[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(ScaleLadderContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM)
+static const AVOption scale_ladder_options[] = {
+    { "sizes",     "'|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = "hd720|nhd" }, .flags = FLAGS },
+    { "flags",     "Flags to pass to libswscale",        OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" },   .flags = FLAGS },
+    { "max_ratio", "largest downscale ratio of a rung scaled from another one", OFFSET(max_ratio), AV_OPT_TYPE_DOUBLE, { .dbl = 2 }, 1, 16, FLAGS },
+    { NULL },
+};
+
+AVFILTER_DEFINE_CLASS(scale_ladder);
+
+static const AVFilterPad ladder_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = ladder_filter_frame,
+        .config_props = ladder_config_input,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_scale_ladder = {
+    .name          = "scale_ladder",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input to several resolutions."),
+
+    .init          = ladder_init,
+    .uninit        = ladder_uninit,
+    .query_formats = ladder_query_formats,
+
+    .priv_size     = sizeof(ScaleLadderContext),
+    .priv_class    = &scale_ladder_class,
+
+    .inputs        = ladder_inputs,
+    .outputs       = NULL,
+
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -0,0 +1,351 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "avfilter.h"
+#include "internal.h"
+#include "opencl.h"
+#include "opencl_source.h"
+#include "scale_eval.h"
+#include "video.h"
+
+enum ScaleAlgo {
+    SCALE_BILINEAR,
+    SCALE_BICUBIC,
+    SCALE_LANCZOS,
+};
+
+static const enum AVPixelFormat supported_formats[] = {
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_P010,
+    AV_PIX_FMT_YUV420P,
+};
+
+typedef struct ScaleOpenCLContext {
+    OpenCLFilterContext ocf;
+
+    int              initialised;
+    cl_kernel        kernel_luma;
+    cl_kernel        kernel_chroma;
+    cl_command_queue command_queue;
+
+    int              passthrough;
+    int              src_packed;
+    int              dst_packed;
+
+    char            *w_expr;
+    char            *h_expr;
+    enum AVPixelFormat format;
+    int              algo;
+} ScaleOpenCLContext;
+
+static int format_is_supported(enum AVPixelFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(supported_formats); i++)
+        if (supported_formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
+static int scale_opencl_init(AVFilterContext *avctx)
+{
+    ScaleOpenCLContext *ctx = avctx->priv;
+    cl_int cle;
+    int err;
+
+    err = ff_opencl_filter_load_program(avctx, &ff_opencl_source_scale, 1);
+    if (err < 0)
+        goto fail;
+
+    ctx->command_queue = clCreateCommandQueue(ctx->ocf.hwctx->context,
+                                              ctx->ocf.hwctx->device_id,
+                                              0, &cle);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to create OpenCL "
+                     "command queue %d.\n", cle);
+
+    ctx->kernel_luma = clCreateKernel(ctx->ocf.program, "scale_luma", &cle);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to create kernel %d.\n", cle);
+
+    ctx->kernel_chroma = clCreateKernel(ctx->ocf.program, "scale_chroma", &cle);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to create kernel %d.\n", cle);
+
+    ctx->initialised = 1;
+    return 0;
+
+fail:
+    if (ctx->command_queue)
+        clReleaseCommandQueue(ctx->command_queue);
+    if (ctx->kernel_luma)
+        clReleaseKernel(ctx->kernel_luma);
+    if (ctx->kernel_chroma)
+        clReleaseKernel(ctx->kernel_chroma);
+    return err;
+}
+
+static int scale_opencl_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *avctx = outlink->src;
+    ScaleOpenCLContext *ctx = avctx->priv;
+    AVFilterLink *inlink = avctx->inputs[0];
+    AVHWFramesContext *input_frames;
+    enum AVPixelFormat in_format, out_format;
+    int w, h, err;
+
+    input_frames = (AVHWFramesContext*)inlink->hw_frames_ctx->data;
+    in_format  = input_frames->sw_format;
+    out_format = ctx->format == AV_PIX_FMT_NONE ? in_format : ctx->format;
+
+    if (!format_is_supported(in_format)) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported input format: %s\n",
+               av_get_pix_fmt_name(in_format));
+        return AVERROR(ENOSYS);
+    }
+    if (!format_is_supported(out_format)) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported output format: %s\n",
+               av_get_pix_fmt_name(out_format));
+        return AVERROR(ENOSYS);
+    }
+
+    if ((err = ff_scale_eval_dimensions(ctx, ctx->w_expr, ctx->h_expr,
+                                        inlink, outlink, &w, &h)) < 0)
+        return err;
+
+    ff_scale_adjust_dimensions(inlink, &w, &h, 0, 1);
+
+    if (inlink->w == w && inlink->h == h && in_format == out_format) {
+        ctx->passthrough = 1;
+        outlink->hw_frames_ctx = av_buffer_ref(inlink->hw_frames_ctx);
+        if (!outlink->hw_frames_ctx)
+            return AVERROR(ENOMEM);
+        outlink->w = w;
+        outlink->h = h;
+    } else {
+        ctx->passthrough = 0;
+        ctx->src_packed  = in_format  != AV_PIX_FMT_YUV420P;
+        ctx->dst_packed  = out_format != AV_PIX_FMT_YUV420P;
+
+        ctx->ocf.output_format = out_format;
+        ctx->ocf.output_width  = w;
+        ctx->ocf.output_height = h;
+
+        err = ff_opencl_filter_config_output(outlink);
+        if (err < 0)
+            return err;
+    }
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w,
+                                                             outlink->w * inlink->h},
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(avctx, AV_LOG_VERBOSE, "w:%d h:%d fmt:%s -> w:%d h:%d fmt:%s%s\n",
+           inlink->w, inlink->h, av_get_pix_fmt_name(in_format),
+           outlink->w, outlink->h, av_get_pix_fmt_name(out_format),
+           ctx->passthrough ? " (passthrough)" : "");
+
+    return 0;
+}
+
+static int scale_opencl_filter_frame(AVFilterLink *inlink, AVFrame *input)
+{
+    AVFilterContext    *avctx = inlink->dst;
+    AVFilterLink     *outlink = avctx->outputs[0];
+    ScaleOpenCLContext   *ctx = avctx->priv;
+    AVFrame *output = NULL;
+    size_t global_work[2];
+    cl_mem dst_u, dst_v, src_u, src_v, mem;
+    cl_int cle;
+    int err;
+
+    av_log(ctx, AV_LOG_DEBUG, "Filter input: %s, %ux%u (%"PRId64").\n",
+           av_get_pix_fmt_name(input->format),
+           input->width, input->height, input->pts);
+
+    if (!input->hw_frames_ctx)
+        return AVERROR(EINVAL);
+
+    if (ctx->passthrough)
+        return ff_filter_frame(outlink, input);
+
+    if (!ctx->initialised) {
+        err = scale_opencl_init(avctx);
+        if (err < 0)
+            goto fail;
+    }
+
+    output = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!output) {
+        err = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    err = av_frame_copy_props(output, input);
+    if (err < 0)
+        goto fail;
+
+    av_reduce(&output->sample_aspect_ratio.num, &output->sample_aspect_ratio.den,
+              (int64_t)input->sample_aspect_ratio.num * outlink->h * inlink->w,
+              (int64_t)input->sample_aspect_ratio.den * outlink->w * inlink->h,
+              INT_MAX);
+
+    mem = (cl_mem)output->data[0];
+    CL_SET_KERNEL_ARG(ctx->kernel_luma, 0, cl_mem, &mem);
+    mem = (cl_mem)input->data[0];
+    CL_SET_KERNEL_ARG(ctx->kernel_luma, 1, cl_mem, &mem);
+    CL_SET_KERNEL_ARG(ctx->kernel_luma, 2, cl_int, &ctx->algo);
+
+    err = ff_opencl_filter_work_size_from_image(avctx, global_work, output, 0, 16);
+    if (err < 0)
+        goto fail;
+
+    cle = clEnqueueNDRangeKernel(ctx->command_queue, ctx->kernel_luma, 2, NULL,
+                                 global_work, NULL, 0, NULL, NULL);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to enqueue luma kernel: %d.\n", cle);
+
+    src_u = (cl_mem)input->data[1];
+    src_v = (cl_mem)input->data[ctx->src_packed ? 1 : 2];
+    dst_u = (cl_mem)output->data[1];
+    dst_v = (cl_mem)output->data[ctx->dst_packed ? 1 : 2];
+
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 0, cl_mem, &dst_u);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 1, cl_mem, &dst_v);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 2, cl_mem, &src_u);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 3, cl_mem, &src_v);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 4, cl_int, &ctx->src_packed);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 5, cl_int, &ctx->dst_packed);
+    CL_SET_KERNEL_ARG(ctx->kernel_chroma, 6, cl_int, &ctx->algo);
+
+    err = ff_opencl_filter_work_size_from_image(avctx, global_work, output, 1, 16);
+    if (err < 0)
+        goto fail;
+
+    cle = clEnqueueNDRangeKernel(ctx->command_queue, ctx->kernel_chroma, 2, NULL,
+                                 global_work, NULL, 0, NULL, NULL);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to enqueue chroma kernel: %d.\n", cle);
+
+    cle = clFinish(ctx->command_queue);
+    CL_FAIL_ON_ERROR(AVERROR(EIO), "Failed to finish command queue: %d.\n", cle);
+
+    av_frame_free(&input);
+
+    av_log(ctx, AV_LOG_DEBUG, "Filter output: %s, %ux%u (%"PRId64").\n",
+           av_get_pix_fmt_name(output->format),
+           output->width, output->height, output->pts);
+
+    return ff_filter_frame(outlink, output);
+
+fail:
+    clFinish(ctx->command_queue);
+    av_frame_free(&input);
+    av_frame_free(&output);
+    return err;
+}
+
+static av_cold void scale_opencl_uninit(AVFilterContext *avctx)
+{
+    ScaleOpenCLContext *ctx = avctx->priv;
+    cl_int cle;
+
+    if (ctx->kernel_luma) {
+        cle = clReleaseKernel(ctx->kernel_luma);
+        if (cle != CL_SUCCESS)
+            av_log(avctx, AV_LOG_ERROR, "Failed to release "
+                   "kernel: %d.\n", cle);
+    }
+
+    if (ctx->kernel_chroma) {
+        cle = clReleaseKernel(ctx->kernel_chroma);
+        if (cle != CL_SUCCESS)
+            av_log(avctx, AV_LOG_ERROR, "Failed to release "
+                   "kernel: %d.\n", cle);
+    }
+
+    if (ctx->command_queue) {
+        cle = clReleaseCommandQueue(ctx->command_queue);
+        if (cle != CL_SUCCESS)
+            av_log(avctx, AV_LOG_ERROR, "Failed to release "
+                   "command queue: %d.\n", cle);
+    }
+
+    ff_opencl_filter_uninit(avctx);
+}
+
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    ScaleOpenCLContext *s = inlink->dst->priv;
+
+    return s->passthrough ?
+        ff_null_get_video_buffer   (inlink, w, h) :
+        ff_default_get_video_buffer(inlink, w, h);
+}
+
+#define OFFSET(x) offsetof(ScaleOpenCLContext, x)
+#define FLAGS (AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
+static const AVOption scale_opencl_options[] = {
+    { "w", "Output video width",  OFFSET(w_expr), AV_OPT_TYPE_STRING, { .str = "iw" }, .flags = FLAGS },
+    { "h", "Output video height", OFFSET(h_expr), AV_OPT_TYPE_STRING, { .str = "ih" }, .flags = FLAGS },
+    { "format", "Output video pixel format", OFFSET(format), AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE }, AV_PIX_FMT_NONE, INT_MAX, .flags = FLAGS },
+    { "algo", "Scaling algorithm", OFFSET(algo), AV_OPT_TYPE_INT, { .i64 = SCALE_BICUBIC }, 0, SCALE_LANCZOS, FLAGS, "algo" },
+        { "bilinear", "bilinear",          0, AV_OPT_TYPE_CONST, { .i64 = SCALE_BILINEAR }, .flags = FLAGS, .unit = "algo" },
+        { "bicubic",  "bicubic",           0, AV_OPT_TYPE_CONST, { .i64 = SCALE_BICUBIC  }, .flags = FLAGS, .unit = "algo" },
+        { "lanczos",  "3-lobed lanczos",   0, AV_OPT_TYPE_CONST, { .i64 = SCALE_LANCZOS  }, .flags = FLAGS, .unit = "algo" },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scale_opencl);
+
+static const AVFilterPad scale_opencl_inputs[] = {
+    {
+        .name             = "default",
+        .type             = AVMEDIA_TYPE_VIDEO,
+        .get_video_buffer = get_video_buffer,
+        .filter_frame     = &scale_opencl_filter_frame,
+        .config_props     = &ff_opencl_filter_config_input,
+    },
+    { NULL }
+};
+
+static const AVFilterPad scale_opencl_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = &scale_opencl_config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_scale_opencl = {
+    .name           = "scale_opencl",
+    .description    = NULL_IF_CONFIG_SMALL("Scale and convert the format of OpenCL frames"),
+    .priv_size      = sizeof(ScaleOpenCLContext),
+    .priv_class     = &scale_opencl_class,
+    .init           = &ff_opencl_filter_init,
+    .uninit         = &scale_opencl_uninit,
+    .query_formats  = &ff_opencl_filter_query_formats,
+    .inputs         = scale_opencl_inputs,
+    .outputs        = scale_opencl_outputs,
+    .flags_internal = FF_FILTER_FLAG_HWFRAME_AWARE,
+};
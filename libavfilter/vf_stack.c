@@ -22,6 +22,9 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#if CONFIG_XSTACK_FILTER
+#include "libswscale/swscale.h"
+#endif
 
 #include "avfilter.h"
 #include "formats.h"
@@ -33,6 +36,7 @@ typedef struct StackItem {
     int x[4], y[4];
     int linesize[4];
     int height[4];
+    struct SwsContext *sws;
 } StackItem;
 
 typedef struct StackContext {
@@ -44,14 +48,65 @@ typedef struct StackContext {
     int is_vertical;
     int is_horizontal;
     int nb_planes;
+    int tile_w, tile_h;
 
     StackItem *items;
     AVFrame **frames;
     FFFrameSync fs;
 } StackContext;
 
+#if CONFIG_XSTACK_FILTER
+static int tile_format_supported(enum AVPixelFormat fmt)
+{
+    return sws_isSupportedInput(fmt) && sws_isSupportedOutput(fmt);
+}
+
+/* (re)create the scaler of each input for the size of its current frame */
+static int tile_update_scalers(StackContext *s, AVFilterLink *outlink)
+{
+    for (int i = 0; i < s->nb_inputs; i++) {
+        StackItem *item = &s->items[i];
+        AVFrame *in = s->frames[i];
+
+        item->sws = sws_getCachedContext(item->sws, in->width, in->height, in->format,
+                                         s->tile_w, s->tile_h, outlink->format,
+                                         SWS_BICUBIC, NULL, NULL, NULL);
+        if (!item->sws)
+            return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+/* scale an input straight to its position in the output frame */
+static void tile_scale(StackContext *s, AVFrame *out, int i)
+{
+    StackItem *item = &s->items[i];
+    AVFrame *in = s->frames[i];
+    uint8_t *dst[4] = { NULL };
+
+    for (int p = 0; p < s->nb_planes; p++)
+        dst[p] = out->data[p] + out->linesize[p] * item->y[p] + item->x[p];
+
+    sws_scale(item->sws, (const uint8_t * const *)in->data, in->linesize,
+              0, in->height, dst, out->linesize);
+}
+
+static void tile_free_scalers(StackContext *s)
+{
+    for (int i = 0; i < s->nb_inputs; i++)
+        sws_freeContext(s->items[i].sws);
+}
+#else
+static int tile_format_supported(enum AVPixelFormat fmt) { return 1; }
+static int tile_update_scalers(StackContext *s, AVFilterLink *outlink) { return 0; }
+static void tile_scale(StackContext *s, AVFrame *out, int i) { }
+static void tile_free_scalers(StackContext *s) { }
+#endif
+
 static int query_formats(AVFilterContext *ctx)
 {
+    StackContext *s = ctx->priv;
     AVFilterFormats *pix_fmts = NULL;
     int fmt, ret;
 
@@ -60,6 +115,7 @@ static int query_formats(AVFilterContext *ctx)
         if (!(desc->flags & AV_PIX_FMT_FLAG_PAL ||
               desc->flags & AV_PIX_FMT_FLAG_HWACCEL ||
               desc->flags & AV_PIX_FMT_FLAG_BITSTREAM) &&
+            (!s->tile_w || tile_format_supported(fmt)) &&
             (ret = ff_add_format(&pix_fmts, fmt)) < 0)
             return ret;
     }
@@ -127,6 +183,11 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     for (int i = start; i < end; i++) {
         StackItem *item = &s->items[i];
 
+        if (s->tile_w) {
+            tile_scale(s, out, i);
+            continue;
+        }
+
         for (int p = 0; p < s->nb_planes; p++) {
             av_image_copy_plane(out->data[p] + out->linesize[p] * item->y[p] + item->x[p],
                                 out->linesize[p],
@@ -159,6 +220,11 @@ static int process_frame(FFFrameSync *fs)
     out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
     out->sample_aspect_ratio = outlink->sample_aspect_ratio;
 
+    if (s->tile_w && (ret = tile_update_scalers(s, outlink)) < 0) {
+        av_frame_free(&out);
+        return ret;
+    }
+
     ctx->internal->execute(ctx, process_slice, out, NULL, FFMIN(s->nb_inputs, ff_filter_get_nb_threads(ctx)));
 
     return ff_filter_frame(outlink, out);
@@ -234,21 +300,29 @@ static int config_output(AVFilterLink *outlink)
         char *arg3, *p3, *saveptr3 = NULL;
         int inw, inh, size;
 
+        if (s->tile_w) {
+            width  = s->tile_w;
+            height = s->tile_h;
+        }
+
         for (i = 0; i < s->nb_inputs; i++) {
             AVFilterLink *inlink = ctx->inputs[i];
             StackItem *item = &s->items[i];
+            /* in tile mode, every input is scaled to the tile size */
+            int w = s->tile_w ? s->tile_w : inlink->w;
+            int h = s->tile_w ? s->tile_h : inlink->h;
 
             if (!(arg = av_strtok(p, "|", &saveptr)))
                 return AVERROR(EINVAL);
 
             p = NULL;
 
-            if ((ret = av_image_fill_linesizes(item->linesize, inlink->format, inlink->w)) < 0) {
+            if ((ret = av_image_fill_linesizes(item->linesize, inlink->format, w)) < 0) {
                 return ret;
             }
 
-            item->height[1] = item->height[2] = AV_CEIL_RSHIFT(inlink->h, s->desc->log2_chroma_h);
-            item->height[0] = item->height[3] = inlink->h;
+            item->height[1] = item->height[2] = AV_CEIL_RSHIFT(h, s->desc->log2_chroma_h);
+            item->height[0] = item->height[3] = h;
 
             p2 = arg;
             inw = inh = 0;
@@ -266,17 +340,17 @@ static int config_output(AVFilterLink *outlink)
                             return AVERROR(EINVAL);
 
                         if (!j)
-                            inw += ctx->inputs[size]->w;
+                            inw += s->tile_w ? s->tile_w : ctx->inputs[size]->w;
                         else
-                            inh += ctx->inputs[size]->w;
+                            inh += s->tile_w ? s->tile_w : ctx->inputs[size]->w;
                     } else if (sscanf(arg3, "h%d", &size) == 1) {
                         if (size == i || size < 0 || size >= s->nb_inputs)
                             return AVERROR(EINVAL);
 
                         if (!j)
-                            inw += ctx->inputs[size]->h;
+                            inw += s->tile_w ? s->tile_h : ctx->inputs[size]->h;
                         else
-                            inh += ctx->inputs[size]->h;
+                            inh += s->tile_w ? s->tile_h : ctx->inputs[size]->h;
                     } else if (sscanf(arg3, "%d", &size) == 1) {
                         if (size < 0)
                             return AVERROR(EINVAL);
@@ -298,8 +372,8 @@ static int config_output(AVFilterLink *outlink)
             item->y[1] = item->y[2] = AV_CEIL_RSHIFT(inh, s->desc->log2_chroma_h);
             item->y[0] = item->y[3] = inh;
 
-            width  = FFMAX(width,  inlink->w + inw);
-            height = FFMAX(height, inlink->h + inh);
+            width  = FFMAX(width,  w + inw);
+            height = FFMAX(height, h + inh);
         }
     }
 
@@ -350,6 +424,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     ff_framesync_uninit(&s->fs);
     av_freep(&s->frames);
+    if (s->items)
+        tile_free_scalers(s);
     av_freep(&s->items);
 
     for (i = 0; i < ctx->nb_inputs; i++)
@@ -425,6 +501,7 @@ static const AVOption xstack_options[] = {
     { "inputs", "set number of inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64=2}, 2, INT_MAX, .flags = FLAGS },
     { "layout", "set custom layout", OFFSET(layout), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, .flags = FLAGS },
     { "shortest", "force termination when the shortest input terminates", OFFSET(shortest), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
+    { "tile_size", "scale all inputs to this size", OFFSET(tile_w), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, .flags = FLAGS },
     { NULL },
 };
 
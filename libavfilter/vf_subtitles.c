@@ -60,6 +60,10 @@ typedef struct AssContext {
     int original_w, original_h;
     int shaping;
     FFDrawContext draw;
+    FFDrawColor *colors;       ///< colors of the images of the last rendered frame
+    unsigned int colors_size;
+    int nb_images;
+    int y_start, y_end;        ///< rows covered by the images, aligned to the chroma subsampling
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -131,6 +135,7 @@ static av_cold void uninit(AVFilterContext *ctx)
         ass_renderer_done(ass->renderer);
     if (ass->library)
         ass_library_done(ass->library);
+    av_freep(&ass->colors);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -160,19 +165,78 @@ static int config_input(AVFilterLink *inlink)
 #define AB(c)  (((c)>>8) &0xFF)
 #define AA(c)  ((0xFF-(c)) &0xFF)
 
-static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+/**
+ * Compute the colors and the vertical extent of a newly rendered image list.
+ */
+static int update_ass_images(AssContext *ass, const ASS_Image *image, int height)
 {
-    for (; image; image = image->next) {
-        uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
-        FFDrawColor color;
-        ff_draw_color(&ass->draw, &color, rgba_color);
-        ff_blend_mask(&ass->draw, &color,
-                      picref->data, picref->linesize,
-                      picref->width, picref->height,
-                      image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+    const ASS_Image *img;
+    int nb_images = 0, y0 = INT_MAX, y1 = INT_MIN;
+
+    for (img = image; img; img = img->next)
+        nb_images++;
+
+    if (nb_images > SIZE_MAX / sizeof(*ass->colors))
+        return AVERROR(ENOMEM);
+    av_fast_malloc(&ass->colors, &ass->colors_size, FFMAX(nb_images, 1) * sizeof(*ass->colors));
+    if (!ass->colors) {
+        ass->nb_images = 0;
+        return AVERROR(ENOMEM);
     }
+
+    for (nb_images = 0, img = image; img; img = img->next, nb_images++) {
+        uint8_t rgba_color[] = {AR(img->color), AG(img->color), AB(img->color), AA(img->color)};
+        ff_draw_color(&ass->draw, &ass->colors[nb_images], rgba_color);
+        if (img->w > 0 && img->h > 0) {
+            y0 = FFMIN(y0, img->dst_y);
+            y1 = FFMAX(y1, img->dst_y + img->h);
+        }
+    }
+
+    ass->nb_images = nb_images;
+    ass->y_start   = FFMAX(y0, 0) & ~((1 << ass->draw.vsub_max) - 1);
+    ass->y_end     = FFMIN(y1, height);
+    return 0;
+}
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    const ASS_Image *image;
+} ThreadData;
+
+/**
+ * Blend the images on a band of rows of the frame. The bands start on chroma
+ * row boundaries, so that the result does not depend on the number of jobs.
+ */
+static int overlay_ass_image_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AssContext *ass = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *picref = td->frame;
+    const ASS_Image *image;
+    const int align = 1 << ass->draw.vsub_max;
+    const int nb_units = (ass->y_end - ass->y_start + align - 1) / align;
+    const int slice_start = ass->y_start + (nb_units *  jobnr     ) / nb_jobs * align;
+    const int slice_end   = FFMIN(ass->y_start + (nb_units * (jobnr + 1)) / nb_jobs * align,
+                                  picref->height);
+    uint8_t *data[4] = { NULL };
+    int i, plane;
+
+    if (slice_start >= slice_end)
+        return 0;
+
+    for (plane = 0; plane < ass->draw.nb_planes; plane++)
+        data[plane] = picref->data[plane] +
+                      (slice_start >> ass->draw.vsub[plane]) * picref->linesize[plane];
+
+    for (i = 0, image = td->image; image; image = image->next, i++)
+        ff_blend_mask(&ass->draw, &ass->colors[i],
+                      data, picref->linesize,
+                      picref->width, slice_end - slice_start,
+                      image->bitmap, image->stride, image->w, image->h,
+                      3, 0, image->dst_x, image->dst_y - slice_start);
+
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
@@ -180,15 +244,29 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AssContext *ass = ctx->priv;
-    int detect_change = 0;
+    int detect_change = 0, ret;
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
+    ThreadData td;
 
-    if (detect_change)
+    /* the images are only walked again if libass reports a change */
+    if (detect_change || !ass->colors) {
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
+        if ((ret = update_ass_images(ass, image, picref->height)) < 0) {
+            av_frame_free(&picref);
+            return ret;
+        }
+    }
 
-    overlay_ass_image(ass, picref, image);
+    if (image && ass->y_start < ass->y_end) {
+        const int align = 1 << ass->draw.vsub_max;
+        td.frame = picref;
+        td.image = image;
+        ctx->internal->execute(ctx, overlay_ass_image_slice, &td, NULL,
+                               FFMIN((ass->y_end - ass->y_start + align - 1) / align,
+                                     ff_filter_get_nb_threads(ctx)));
+    }
 
     return ff_filter_frame(outlink, picref);
 }
@@ -256,6 +334,7 @@ AVFilter ff_vf_ass = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &ass_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -494,5 +573,6 @@ AVFilter ff_vf_subtitles = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &subtitles_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
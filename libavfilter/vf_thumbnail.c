@@ -28,7 +28,9 @@
  */
 
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "avfilter.h"
+#include "formats.h"
 #include "internal.h"
 
 #define HIST_SIZE (3*256)
@@ -44,6 +46,11 @@ typedef struct ThumbContext {
     int n_frames;               ///< number of frames for analysis
     struct thumb_frame *frames; ///< the n_frames frames
     AVRational tb;              ///< copy of the input timebase to ease access
+    int luma;                   ///< accept YUV input and only use its luma
+    int is_rgb;                 ///< the input is packed RGB
+    int nb_bins;                ///< number of histogram bins used
+    int nb_threads;
+    int *thread_histogram;      ///< partial histograms of the slice jobs
 } ThumbContext;
 
 #define OFFSET(x) offsetof(ThumbContext, x)
@@ -51,6 +58,7 @@ typedef struct ThumbContext {
 
 static const AVOption thumbnail_options[] = {
     { "n", "set the frames batch size", OFFSET(n_frames), AV_OPT_TYPE_INT, {.i64=100}, 2, INT_MAX, FLAGS },
+    { "luma", "accept YUV input and only use its luma", OFFSET(luma), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -76,12 +84,13 @@ static av_cold int init(AVFilterContext *ctx)
  * @param median average color distribution histogram
  * @return       sum of squared errors
  */
-static double frame_sum_square_err(const int *hist, const double *median)
+static double frame_sum_square_err(const int *hist, const double *median,
+                                   int nb_bins)
 {
     int i;
     double err, sum_sq_err = 0;
 
-    for (i = 0; i < HIST_SIZE; i++) {
+    for (i = 0; i < nb_bins; i++) {
         err = median[i] - (double)hist[i];
         sum_sq_err += err*err;
     }
@@ -97,7 +106,7 @@ static AVFrame *get_best_frame(AVFilterContext *ctx)
     double avg_hist[HIST_SIZE] = {0}, sq_err, min_sq_err = -1;
 
     // average histogram of the N frames
-    for (j = 0; j < FF_ARRAY_ELEMS(avg_hist); j++) {
+    for (j = 0; j < s->nb_bins; j++) {
         for (i = 0; i < nb_frames; i++)
             avg_hist[j] += (double)s->frames[i].histogram[j];
         avg_hist[j] /= nb_frames;
@@ -105,7 +114,7 @@ static AVFrame *get_best_frame(AVFilterContext *ctx)
 
     // find the frame closer to the average using the sum of squared errors
     for (i = 0; i < nb_frames; i++) {
-        sq_err = frame_sum_square_err(s->frames[i].histogram, avg_hist);
+        sq_err = frame_sum_square_err(s->frames[i].histogram, avg_hist, s->nb_bins);
         if (i == 0 || sq_err < min_sq_err)
             best_frame_idx = i, min_sq_err = sq_err;
     }
@@ -128,26 +137,57 @@ static AVFrame *get_best_frame(AVFilterContext *ctx)
     return picref;
 }
 
+static int histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThumbContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    int *hist = s->thread_histogram + jobnr * HIST_SIZE;
+    const int h = frame->height;
+    const int w = frame->width;
+    const int slice_start = (h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (h * (jobnr+1)) / nb_jobs;
+    const uint8_t *p = frame->data[0] + slice_start * frame->linesize[0];
+
+    memset(hist, 0, s->nb_bins * sizeof(*hist));
+
+    if (s->is_rgb) {
+        for (int j = slice_start; j < slice_end; j++) {
+            for (int i = 0; i < w; i++) {
+                hist[0*256 + p[i*3    ]]++;
+                hist[1*256 + p[i*3 + 1]]++;
+                hist[2*256 + p[i*3 + 2]]++;
+            }
+            p += frame->linesize[0];
+        }
+    } else {
+        for (int j = slice_start; j < slice_end; j++) {
+            for (int i = 0; i < w; i++)
+                hist[p[i]]++;
+            p += frame->linesize[0];
+        }
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
-    int i, j;
     AVFilterContext *ctx  = inlink->dst;
     ThumbContext *s   = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     int *hist = s->frames[s->n].histogram;
-    const uint8_t *p = frame->data[0];
+    const int nb_jobs = FFMIN(frame->height, s->nb_threads);
 
     // keep a reference of each frame
     s->frames[s->n].buf = frame;
 
-    // update current frame RGB histogram
-    for (j = 0; j < inlink->h; j++) {
-        for (i = 0; i < inlink->w; i++) {
-            hist[0*256 + p[i*3    ]]++;
-            hist[1*256 + p[i*3 + 1]]++;
-            hist[2*256 + p[i*3 + 2]]++;
-        }
-        p += frame->linesize[0];
+    // update current frame histogram
+    ctx->internal->execute(ctx, histogram_slice, frame, NULL, nb_jobs);
+    for (int j = 0; j < nb_jobs; j++) {
+        const int *thread_hist = s->thread_histogram + j * HIST_SIZE;
+
+        for (int i = 0; i < s->nb_bins; i++)
+            hist[i] += thread_hist[i];
     }
 
     // no selection until the buffer of N frames is filled up
@@ -165,6 +205,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < s->n_frames && s->frames[i].buf; i++)
         av_frame_free(&s->frames[i].buf);
     av_freep(&s->frames);
+    av_freep(&s->thread_histogram);
 }
 
 static int request_frame(AVFilterLink *link)
@@ -188,8 +229,18 @@ static int config_props(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     ThumbContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
 
     s->tb = inlink->time_base;
+    s->is_rgb = !!(desc->flags & AV_PIX_FMT_FLAG_RGB);
+    s->nb_bins = s->is_rgb ? HIST_SIZE : 256;
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    av_freep(&s->thread_histogram);
+    s->thread_histogram = av_calloc(s->nb_threads, HIST_SIZE * sizeof(*s->thread_histogram));
+    if (!s->thread_histogram)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -199,7 +250,19 @@ static int query_formats(AVFilterContext *ctx)
         AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
         AV_PIX_FMT_NONE
     };
-    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    static const enum AVPixelFormat luma_pix_fmts[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P,
+        AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUVJ440P,
+        AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVA420P, AV_PIX_FMT_YUVA422P, AV_PIX_FMT_YUVA444P,
+        AV_PIX_FMT_NV12, AV_PIX_FMT_NV21, AV_PIX_FMT_GRAY8,
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+        AV_PIX_FMT_NONE
+    };
+    ThumbContext *s = ctx->priv;
+    AVFilterFormats *fmts_list = ff_make_format_list(s->luma ? luma_pix_fmts : pix_fmts);
     if (!fmts_list)
         return AVERROR(ENOMEM);
     return ff_set_common_formats(ctx, fmts_list);
@@ -234,4 +297,5 @@ AVFilter ff_vf_thumbnail = {
     .inputs        = thumbnail_inputs,
     .outputs       = thumbnail_outputs,
     .priv_class    = &thumbnail_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
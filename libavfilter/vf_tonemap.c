@@ -50,6 +50,15 @@ enum TonemapAlgorithm {
     TONEMAP_MAX,
 };
 
+#define CURVE_LUT_SIZE 4096
+
+#define ST2084_MAX_LUMINANCE 10000.0
+#define ST2084_M1 0.1593017578125
+#define ST2084_M2 78.84375
+#define ST2084_C1 0.8359375
+#define ST2084_C2 18.8515625
+#define ST2084_C3 18.6875
+
 static const struct LumaCoefficients luma_coefficients[AVCOL_SPC_NB] = {
     [AVCOL_SPC_FCC]        = { 0.30,   0.59,   0.11   },
     [AVCOL_SPC_BT470BG]    = { 0.299,  0.587,  0.114  },
@@ -67,11 +76,30 @@ typedef struct TonemapContext {
     double param;
     double desat;
     double peak;
+    int lut;
 
     const struct LumaCoefficients *coeffs;
+
+    /* constant parts of the curves, computed once per frame */
+    float hable_peak;
+    float mobius_a, mobius_b, mobius_scale;
+
+    float curve_lut[CURVE_LUT_SIZE + 1]; ///< curve sampled on [0; peak]
+    double lut_peak;                ///< peak curve_lut was computed for
+    float lut_scale;
+
+    float linearize[1024];          ///< linear light of the 10-bit PQ code values
 } TonemapContext;
 
-static const enum AVPixelFormat pix_fmts[] = {
+static const enum AVPixelFormat in_pix_fmts[] = {
+    AV_PIX_FMT_GBRPF32,
+    AV_PIX_FMT_GBRAPF32,
+    AV_PIX_FMT_GBRP10,
+    AV_PIX_FMT_GBRAP10,
+    AV_PIX_FMT_NONE,
+};
+
+static const enum AVPixelFormat out_pix_fmts[] = {
     AV_PIX_FMT_GBRPF32,
     AV_PIX_FMT_GBRAPF32,
     AV_PIX_FMT_NONE,
@@ -79,7 +107,11 @@ static const enum AVPixelFormat pix_fmts[] = {
 
 static int query_formats(AVFilterContext *ctx)
 {
-    return ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
+    int ret;
+
+    if ((ret = ff_formats_ref(ff_make_format_list(in_pix_fmts), &ctx->inputs[0]->out_formats)) < 0)
+        return ret;
+    return ff_formats_ref(ff_make_format_list(out_pix_fmts), &ctx->outputs[0]->in_formats);
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -113,51 +145,32 @@ static float hable(float in)
     return (in * (in * a + b * c) + d * e) / (in * (in * a + b) + d * f) - e / f;
 }
 
-static float mobius(float in, float j, double peak)
+static float mobius(TonemapContext *s, float in, float j)
 {
-    float a, b;
-
     if (in <= j)
         return in;
 
-    a = -j * j * (peak - 1.0f) / (j * j - 2.0f * j + peak);
-    b = (j * j - 2.0f * j * peak + peak) / FFMAX(peak - 1.0f, 1e-6);
-
-    return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
+    return s->mobius_scale * (in + s->mobius_a) / (in + s->mobius_b);
 }
 
-#define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
-static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
-                    const AVPixFmtDescriptor *desc, int x, int y, double peak)
+/**
+ * Compute the parts of the curves which only depend on the peak.
+ */
+static void curve_init(TonemapContext *s, double peak)
 {
-    const float *r_in = (const float *)(in->data[0] + x * desc->comp[0].step + y * in->linesize[0]);
-    const float *b_in = (const float *)(in->data[1] + x * desc->comp[1].step + y * in->linesize[1]);
-    const float *g_in = (const float *)(in->data[2] + x * desc->comp[2].step + y * in->linesize[2]);
-    float *r_out = (float *)(out->data[0] + x * desc->comp[0].step + y * out->linesize[0]);
-    float *b_out = (float *)(out->data[1] + x * desc->comp[1].step + y * out->linesize[1]);
-    float *g_out = (float *)(out->data[2] + x * desc->comp[2].step + y * out->linesize[2]);
-    float sig, sig_orig;
+    float j = s->param, a, b;
 
-    /* load values */
-    *r_out = *r_in;
-    *b_out = *b_in;
-    *g_out = *g_in;
-
-    /* desaturate to prevent unnatural colors */
-    if (s->desat > 0) {
-        float luma = s->coeffs->cr * *r_in + s->coeffs->cg * *g_in + s->coeffs->cb * *b_in;
-        float overbright = FFMAX(luma - s->desat, 1e-6) / FFMAX(luma, 1e-6);
-        *r_out = MIX(*r_in, luma, overbright);
-        *g_out = MIX(*g_in, luma, overbright);
-        *b_out = MIX(*b_in, luma, overbright);
-    }
+    s->hable_peak = hable(peak);
 
-    /* pick the brightest component, reducing the value range as necessary
-     * to keep the entire signal in range and preventing discoloration due to
-     * out-of-bounds clipping */
-    sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
-    sig_orig = sig;
+    a = -j * j * (peak - 1.0f) / (j * j - 2.0f * j + peak);
+    b = (j * j - 2.0f * j * peak + peak) / FFMAX(peak - 1.0f, 1e-6);
+    s->mobius_a     = a;
+    s->mobius_b     = b;
+    s->mobius_scale = (b * b + 2.0f * b * j + j * j) / (b - a);
+}
 
+static float curve(TonemapContext *s, float sig, double peak)
+{
     switch(s->tonemap) {
     default:
     case TONEMAP_NONE:
@@ -174,16 +187,77 @@ static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
         sig = av_clipf(sig * s->param, 0, 1.0f);
         break;
     case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
+        sig = hable(sig) / s->hable_peak;
         break;
     case TONEMAP_REINHARD:
         sig = sig / (sig + s->param) * (peak + s->param) / peak;
         break;
     case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
+        sig = mobius(s, sig, s->param);
         break;
     }
 
+    return sig;
+}
+
+static void curve_lut_init(TonemapContext *s, double peak)
+{
+    int i;
+
+    for (i = 0; i <= CURVE_LUT_SIZE; i++)
+        s->curve_lut[i] = curve(s, FFMAX(i * peak / CURVE_LUT_SIZE, 1e-6), peak);
+    s->lut_scale = CURVE_LUT_SIZE / peak;
+    s->lut_peak  = peak;
+}
+
+static av_always_inline float curve_lut(TonemapContext *s, float sig)
+{
+    float pos = sig * s->lut_scale;
+    int i = FFMIN((int)pos, CURVE_LUT_SIZE - 1);
+
+    return s->curve_lut[i] + (s->curve_lut[i + 1] - s->curve_lut[i]) * (pos - i);
+}
+
+static double eotf_st2084(double x)
+{
+    double p = pow(x, 1.0 / ST2084_M2);
+    double a = FFMAX(p - ST2084_C1, 0.0);
+    double b = FFMAX(ST2084_C2 - ST2084_C3 * p, 1e-6);
+    double c = pow(a / b, 1.0 / ST2084_M1);
+    return x > 0.0 ? c * ST2084_MAX_LUMINANCE / REFERENCE_WHITE : 0.0;
+}
+
+#define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
+static av_always_inline void tonemap(TonemapContext *s, float *r_out, float *g_out, float *b_out,
+                                     float r_in, float g_in, float b_in, double peak)
+{
+    float sig, sig_orig;
+
+    /* load values */
+    *r_out = r_in;
+    *b_out = b_in;
+    *g_out = g_in;
+
+    /* desaturate to prevent unnatural colors */
+    if (s->desat > 0) {
+        float luma = s->coeffs->cr * r_in + s->coeffs->cg * g_in + s->coeffs->cb * b_in;
+        float overbright = FFMAX(luma - s->desat, 1e-6) / FFMAX(luma, 1e-6);
+        *r_out = MIX(r_in, luma, overbright);
+        *g_out = MIX(g_in, luma, overbright);
+        *b_out = MIX(b_in, luma, overbright);
+    }
+
+    /* pick the brightest component, reducing the value range as necessary
+     * to keep the entire signal in range and preventing discoloration due to
+     * out-of-bounds clipping */
+    sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
+    sig_orig = sig;
+
+    if (s->lut && sig < peak)
+        sig = curve_lut(s, sig);
+    else
+        sig = curve(s, sig, peak);
+
     /* apply the computed scale factor to the color,
      * linearly to prevent discoloration */
     *r_out *= sig / sig_orig;
@@ -208,9 +282,46 @@ static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs
     const int slice_end = (in->height * (jobnr+1)) / nb_jobs;
     double peak = td->peak;
 
-    for (int y = slice_start; y < slice_end; y++)
-        for (int x = 0; x < out->width; x++)
-            tonemap(s, out, in, desc, x, y, peak);
+    for (int y = slice_start; y < slice_end; y++) {
+        float *r_out = (float *)(out->data[0] + y * out->linesize[0]);
+        float *b_out = (float *)(out->data[1] + y * out->linesize[1]);
+        float *g_out = (float *)(out->data[2] + y * out->linesize[2]);
+
+        if (desc->comp[0].depth == 10) {
+            const uint16_t *r_in = (const uint16_t *)(in->data[0] + y * in->linesize[0]);
+            const uint16_t *b_in = (const uint16_t *)(in->data[1] + y * in->linesize[1]);
+            const uint16_t *g_in = (const uint16_t *)(in->data[2] + y * in->linesize[2]);
+
+            for (int x = 0; x < out->width; x++)
+                tonemap(s, &r_out[x], &g_out[x], &b_out[x],
+                        s->linearize[r_in[x] & 1023],
+                        s->linearize[g_in[x] & 1023],
+                        s->linearize[b_in[x] & 1023], peak);
+        } else {
+            const float *r_in = (const float *)(in->data[0] + y * in->linesize[0]);
+            const float *b_in = (const float *)(in->data[1] + y * in->linesize[1]);
+            const float *g_in = (const float *)(in->data[2] + y * in->linesize[2]);
+
+            for (int x = 0; x < out->width; x++)
+                tonemap(s, &r_out[x], &g_out[x], &b_out[x],
+                        r_in[x], g_in[x], b_in[x], peak);
+        }
+    }
+
+    return 0;
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    TonemapContext *s = inlink->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i;
+
+    if (desc->comp[0].depth == 10)
+        for (i = 0; i < FF_ARRAY_ELEMS(s->linearize); i++)
+            s->linearize[i] = eotf_st2084(i / 1023.0);
+
+    s->lut_peak = 0;
 
     return 0;
 }
@@ -246,7 +357,14 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     }
 
     /* input and output transfer will be linear */
-    if (in->color_trc == AVCOL_TRC_UNSPECIFIED) {
+    if (desc->comp[0].depth == 10) {
+        /* integer input is linearized here */
+        if (in->color_trc == AVCOL_TRC_UNSPECIFIED)
+            av_log(s, AV_LOG_WARNING, "Untagged transfer, assuming SMPTE ST 2084\n");
+        else if (in->color_trc != AVCOL_TRC_SMPTE2084)
+            av_log(s, AV_LOG_WARNING, "Integer input must use the SMPTE ST 2084 transfer\n");
+        out->color_trc = AVCOL_TRC_LINEAR;
+    } else if (in->color_trc == AVCOL_TRC_UNSPECIFIED) {
         av_log(s, AV_LOG_WARNING, "Untagged transfer, assuming linear light\n");
         out->color_trc = AVCOL_TRC_LINEAR;
     } else if (in->color_trc != AVCOL_TRC_LINEAR)
@@ -254,10 +372,16 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     /* read peak from side data if not passed in */
     if (!peak) {
+        if (desc->comp[0].depth == 10 && in->color_trc == AVCOL_TRC_UNSPECIFIED)
+            in->color_trc = AVCOL_TRC_SMPTE2084;
         peak = ff_determine_signal_peak(in);
         av_log(s, AV_LOG_DEBUG, "Computed signal peak: %f\n", peak);
     }
 
+    curve_init(s, peak);
+    if (s->lut && peak != s->lut_peak)
+        curve_lut_init(s, peak);
+
     /* load original color space even if pixel format is RGB to compute overbrights */
     s->coeffs = &luma_coefficients[in->colorspace];
     if (s->desat > 0 && (in->colorspace == AVCOL_SPC_UNSPECIFIED || !s->coeffs)) {
@@ -278,7 +402,15 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     ctx->internal->execute(ctx, tonemap_slice, &td, NULL, FFMIN(in->height, ff_filter_get_nb_threads(ctx)));
 
     /* copy/generate alpha if needed */
-    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA &&
+        desc->comp[3].depth == 10) {
+        for (y = 0; y < out->height; y++) {
+            const uint16_t *src = (const uint16_t *)(in->data[3] + y * in->linesize[3]);
+            float *dst = (float *)(out->data[3] + y * out->linesize[3]);
+            for (x = 0; x < out->width; x++)
+                dst[x] = src[x] / 1023.0f;
+        }
+    } else if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
         av_image_copy_plane(out->data[3], out->linesize[3],
                             in->data[3], in->linesize[3],
                             out->linesize[3], outlink->h);
@@ -312,6 +444,7 @@ static const AVOption tonemap_options[] = {
     { "param",        "tonemap parameter", OFFSET(param), AV_OPT_TYPE_DOUBLE, {.dbl = NAN}, DBL_MIN, DBL_MAX, FLAGS },
     { "desat",        "desaturation strength", OFFSET(desat), AV_OPT_TYPE_DOUBLE, {.dbl = 2}, 0, DBL_MAX, FLAGS },
     { "peak",         "signal peak override", OFFSET(peak), AV_OPT_TYPE_DOUBLE, {.dbl = 0}, 0, DBL_MAX, FLAGS },
+    { "lut",          "evaluate the curve through a lookup table", OFFSET(lut), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -322,6 +455,7 @@ static const AVFilterPad tonemap_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .config_props = config_input,
     },
     { NULL }
 };
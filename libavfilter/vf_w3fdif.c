@@ -265,6 +265,28 @@ static void filter16_scale(uint8_t *out_pixel8, const int32_t *work_pixel, int l
         *out_pixel = av_clip(*work_pixel, 0, max) >> 15;
 }
 
+av_cold void ff_w3fdif_init(W3FDIFDSPContext *dsp, int depth)
+{
+    if (depth <= 8) {
+        dsp->filter_simple_low   = filter_simple_low;
+        dsp->filter_complex_low  = filter_complex_low;
+        dsp->filter_simple_high  = filter_simple_high;
+        dsp->filter_complex_high = filter_complex_high;
+        dsp->filter_scale        = filter_scale;
+    } else {
+        dsp->filter_simple_low   = filter16_simple_low;
+        dsp->filter_complex_low  = filter16_complex_low;
+        dsp->filter_simple_high  = filter16_simple_high;
+        dsp->filter_complex_high = filter16_complex_high;
+        dsp->filter_scale        = filter16_scale;
+    }
+
+    if (ARCH_AARCH64)
+        ff_w3fdif_init_aarch64(dsp, depth);
+    if (ARCH_X86)
+        ff_w3fdif_init_x86(dsp, depth);
+}
+
 static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -297,22 +319,7 @@ static int config_input(AVFilterLink *inlink)
 
     depth = desc->comp[0].depth;
     s->max = ((1 << depth) - 1) * 256 * 128;
-    if (depth <= 8) {
-        s->dsp.filter_simple_low   = filter_simple_low;
-        s->dsp.filter_complex_low  = filter_complex_low;
-        s->dsp.filter_simple_high  = filter_simple_high;
-        s->dsp.filter_complex_high = filter_complex_high;
-        s->dsp.filter_scale        = filter_scale;
-    } else {
-        s->dsp.filter_simple_low   = filter16_simple_low;
-        s->dsp.filter_complex_low  = filter16_complex_low;
-        s->dsp.filter_simple_high  = filter16_simple_high;
-        s->dsp.filter_complex_high = filter16_complex_high;
-        s->dsp.filter_scale        = filter16_scale;
-    }
-
-    if (ARCH_X86)
-        ff_w3fdif_init_x86(&s->dsp, depth);
+    ff_w3fdif_init(&s->dsp, depth);
 
     return 0;
 }
@@ -44,6 +44,8 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/avassert.h"
 
+#define MAX_THREADS 32
+
 static const char *const var_names[] = {
     "in_w",   "iw",
     "in_h",   "ih",
@@ -110,13 +112,19 @@ typedef struct ZScaleContext {
 
     int force_original_aspect_ratio;
 
-    void *tmp;
-    size_t tmp_size;
+    int nb_jobs;                      ///< number of bands the output is split into
+    int out_slice_start[MAX_THREADS]; ///< first output row of each band
+    int out_slice_end[MAX_THREADS];
+    double in_slice_start[MAX_THREADS]; ///< input area mapped to each band
+    double in_slice_end[MAX_THREADS];
+
+    void *tmp[MAX_THREADS];
+    size_t tmp_size[MAX_THREADS];
 
     zimg_image_format src_format, dst_format;
     zimg_image_format alpha_src_format, alpha_dst_format;
     zimg_graph_builder_params alpha_params, params;
-    zimg_filter_graph *alpha_graph, *graph;
+    zimg_filter_graph *alpha_graph[MAX_THREADS], *graph[MAX_THREADS];
 
     enum AVColorSpace in_colorspace, out_colorspace;
     enum AVColorTransferCharacteristic in_trc, out_trc;
@@ -474,15 +482,49 @@ static void format_init(zimg_image_format *format, AVFrame *frame, const AVPixFm
     format->chroma_location = location == -1 ? convert_chroma_location(frame->chroma_location) : location;
 }
 
+/**
+ * Split the output into bands of whole chroma rows, one per job, and map each
+ * of them to the area of the input it is computed from.
+ */
+static void slices_init(ZScaleContext *s, int nb_threads, int in_h, int out_h,
+                        const AVPixFmtDescriptor *odesc)
+{
+    const int align = 1 << odesc->log2_chroma_h;
+    const int nb_units = FFMAX(out_h / align, 1);
+    int i;
+
+    s->nb_jobs = av_clip(nb_threads, 1, FFMIN(MAX_THREADS, nb_units));
+    for (i = 0; i < s->nb_jobs; i++) {
+        s->out_slice_start[i] = nb_units *  i      / s->nb_jobs * align;
+        s->out_slice_end[i]   = i == s->nb_jobs - 1 ? out_h :
+                                nb_units * (i + 1) / s->nb_jobs * align;
+        s->in_slice_start[i]  = s->out_slice_start[i] * (double)in_h / out_h;
+        s->in_slice_end[i]    = s->out_slice_end[i]   * (double)in_h / out_h;
+    }
+}
+
+/**
+ * Build the graph computing the band job_nr of the output. All the graphs
+ * read the whole input, the active region tells which part of it the band
+ * maps to, so that the bands join without seams.
+ */
 static int graph_build(zimg_filter_graph **graph, zimg_graph_builder_params *params,
-                       zimg_image_format *src_format, zimg_image_format *dst_format,
-                       void **tmp, size_t *tmp_size)
+                       const zimg_image_format *src_format, const zimg_image_format *dst_format,
+                       ZScaleContext *s, int job_nr, void **tmp, size_t *tmp_size)
 {
+    zimg_image_format src_slice = *src_format;
+    zimg_image_format dst_slice = *dst_format;
     int ret;
     size_t size;
 
+    src_slice.active_region.left   = 0;
+    src_slice.active_region.width  = src_format->width;
+    src_slice.active_region.top    = s->in_slice_start[job_nr];
+    src_slice.active_region.height = s->in_slice_end[job_nr] - s->in_slice_start[job_nr];
+    dst_slice.height = s->out_slice_end[job_nr] - s->out_slice_start[job_nr];
+
     zimg_filter_graph_free(*graph);
-    *graph = zimg_filter_graph_build(src_format, dst_format, params);
+    *graph = zimg_filter_graph_build(&src_slice, &dst_slice, params);
     if (!*graph)
         return print_zimg_error(NULL);
 
@@ -502,16 +544,67 @@ static int graph_build(zimg_filter_graph **graph, zimg_graph_builder_params *par
     return 0;
 }
 
+typedef struct ThreadData {
+    const AVPixFmtDescriptor *desc, *odesc;
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int job_nr, int n_jobs)
+{
+    ZScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVPixFmtDescriptor *desc = td->desc;
+    const AVPixFmtDescriptor *odesc = td->odesc;
+    const int out_slice_start = s->out_slice_start[job_nr];
+    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
+    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    int ret, plane;
+
+    for (plane = 0; plane < 3; plane++) {
+        const int vsub = plane ? odesc->log2_chroma_h : 0;
+        int p = desc->comp[plane].plane;
+        src_buf.plane[plane].data   = td->in->data[p];
+        src_buf.plane[plane].stride = td->in->linesize[p];
+        src_buf.plane[plane].mask   = -1;
+
+        p = odesc->comp[plane].plane;
+        dst_buf.plane[plane].data   = td->out->data[p] +
+                                      (out_slice_start >> vsub) * td->out->linesize[p];
+        dst_buf.plane[plane].stride = td->out->linesize[p];
+        dst_buf.plane[plane].mask   = -1;
+    }
+
+    ret = zimg_filter_graph_process(s->graph[job_nr], &src_buf, &dst_buf, s->tmp[job_nr], 0, 0, 0, 0);
+    if (ret)
+        return print_zimg_error(ctx);
+
+    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        src_buf.plane[0].data   = td->in->data[3];
+        src_buf.plane[0].stride = td->in->linesize[3];
+        src_buf.plane[0].mask   = -1;
+
+        dst_buf.plane[0].data   = td->out->data[3] + out_slice_start * td->out->linesize[3];
+        dst_buf.plane[0].stride = td->out->linesize[3];
+        dst_buf.plane[0].mask   = -1;
+
+        ret = zimg_filter_graph_process(s->alpha_graph[job_nr], &src_buf, &dst_buf, s->tmp[job_nr], 0, 0, 0, 0);
+        if (ret)
+            return print_zimg_error(ctx);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ZScaleContext *s = link->dst->priv;
     AVFilterLink *outlink = link->dst->outputs[0];
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
-    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
-    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    ThreadData td;
     char buf[32];
-    int ret = 0, plane;
+    int ret = 0, i;
+    int rets[MAX_THREADS];
     AVFrame *out;
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -583,10 +676,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         if (s->chromal != -1)
             out->chroma_location = (int)s->dst_format.chroma_location - 1;
 
-        ret = graph_build(&s->graph, &s->params, &s->src_format, &s->dst_format,
-                          &s->tmp, &s->tmp_size);
-        if (ret < 0)
-            goto fail;
+        slices_init(s, ff_filter_get_nb_threads(link->dst), in->height, out->height, odesc);
+        for (i = 0; i < s->nb_jobs; i++) {
+            ret = graph_build(&s->graph[i], &s->params, &s->src_format, &s->dst_format,
+                              s, i, &s->tmp[i], &s->tmp_size[i]);
+            if (ret < 0)
+                goto fail;
+        }
 
         s->in_colorspace  = in->colorspace;
         s->in_trc         = in->color_trc;
@@ -618,11 +714,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             s->alpha_dst_format.pixel_type = (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) ? ZIMG_PIXEL_FLOAT : odesc->comp[0].depth > 8 ? ZIMG_PIXEL_WORD : ZIMG_PIXEL_BYTE;
             s->alpha_dst_format.color_family = ZIMG_COLOR_GREY;
 
-            zimg_filter_graph_free(s->alpha_graph);
-            s->alpha_graph = zimg_filter_graph_build(&s->alpha_src_format, &s->alpha_dst_format, &s->alpha_params);
-            if (!s->alpha_graph) {
-                ret = print_zimg_error(link->dst);
-                goto fail;
+            for (i = 0; i < s->nb_jobs; i++) {
+                ret = graph_build(&s->alpha_graph[i], &s->alpha_params,
+                                  &s->alpha_src_format, &s->alpha_dst_format,
+                                  s, i, &s->tmp[i], &s->tmp_size[i]);
+                if (ret < 0)
+                    goto fail;
             }
         }
     }
@@ -644,39 +741,19 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    for (plane = 0; plane < 3; plane++) {
-        int p = desc->comp[plane].plane;
-        src_buf.plane[plane].data   = in->data[p];
-        src_buf.plane[plane].stride = in->linesize[p];
-        src_buf.plane[plane].mask   = -1;
-
-        p = odesc->comp[plane].plane;
-        dst_buf.plane[plane].data   = out->data[p];
-        dst_buf.plane[plane].stride = out->linesize[p];
-        dst_buf.plane[plane].mask   = -1;
-    }
-
-    ret = zimg_filter_graph_process(s->graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-    if (ret) {
-        ret = print_zimg_error(link->dst);
-        goto fail;
-    }
-
-    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        src_buf.plane[0].data   = in->data[3];
-        src_buf.plane[0].stride = in->linesize[3];
-        src_buf.plane[0].mask   = -1;
-
-        dst_buf.plane[0].data   = out->data[3];
-        dst_buf.plane[0].stride = out->linesize[3];
-        dst_buf.plane[0].mask   = -1;
-
-        ret = zimg_filter_graph_process(s->alpha_graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-        if (ret) {
-            ret = print_zimg_error(link->dst);
+    td.desc  = desc;
+    td.odesc = odesc;
+    td.in    = in;
+    td.out   = out;
+    link->dst->internal->execute(link->dst, filter_slice, &td, rets, s->nb_jobs);
+    for (i = 0; i < s->nb_jobs; i++) {
+        if (rets[i] < 0) {
+            ret = rets[i];
             goto fail;
         }
-    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+    }
+
+    if (!(desc->flags & AV_PIX_FMT_FLAG_ALPHA) && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
         int x, y;
 
         if (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) {
@@ -706,10 +783,14 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     ZScaleContext *s = ctx->priv;
 
-    zimg_filter_graph_free(s->graph);
-    zimg_filter_graph_free(s->alpha_graph);
-    av_freep(&s->tmp);
-    s->tmp_size = 0;
+    int i;
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        zimg_filter_graph_free(s->graph[i]);
+        zimg_filter_graph_free(s->alpha_graph[i]);
+        av_freep(&s->tmp[i]);
+        s->tmp_size[i] = 0;
+    }
 }
 
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
@@ -891,4 +972,5 @@ AVFilter ff_vf_zscale = {
     .inputs          = avfilter_vf_zscale_inputs,
     .outputs         = avfilter_vf_zscale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
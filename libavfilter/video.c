@@ -35,6 +35,17 @@
 
 #define BUFFER_ALIGN 32
 
+static FFFramePool *video_pool_init(AVFilterLink *link, int w, int h)
+{
+    /* links of the same graph with the same configuration share a pool */
+    if (link->graph)
+        return ff_frame_pool_set_get_video(link->graph->internal->frame_pools,
+                                           av_buffer_allocz, w, h,
+                                           link->format, BUFFER_ALIGN);
+
+    return ff_frame_pool_video_init(av_buffer_allocz, w, h,
+                                    link->format, BUFFER_ALIGN);
+}
 
 AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
 {
@@ -65,8 +76,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     }
 
     if (!link->frame_pool) {
-        link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                    link->format, BUFFER_ALIGN);
+        link->frame_pool = video_pool_init(link, w, h);
         if (!link->frame_pool)
             return NULL;
     } else {
@@ -80,8 +90,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
             pool_format != link->format || pool_align != BUFFER_ALIGN) {
 
             ff_frame_pool_uninit((FFFramePool **)&link->frame_pool);
-            link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
-                                                        link->format, BUFFER_ALIGN);
+            link->frame_pool = video_pool_init(link, w, h);
             if (!link->frame_pool)
                 return NULL;
         }
@@ -96,6 +105,40 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     return frame;
 }
 
+int ff_video_frame_ref_plane(AVFrame *dst, const AVFrame *src, int plane)
+{
+    AVBufferRef *buf, *ref;
+    uint8_t *start, *end;
+    int i;
+
+    if (plane < 0 || plane >= FF_ARRAY_ELEMS(dst->buf) || !dst->buf[plane])
+        return AVERROR(EINVAL);
+
+    /* the plane must have a buffer of its own in dst, or replacing the
+     * buffer would free data still used by the other planes */
+    start = dst->buf[plane]->data;
+    end   = start + dst->buf[plane]->size;
+    if (dst->data[plane] < start || dst->data[plane] >= end)
+        return AVERROR(EINVAL);
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+        if (i != plane && dst->data[i] >= start && dst->data[i] < end)
+            return AVERROR(EINVAL);
+
+    buf = av_frame_get_plane_buffer((AVFrame *)src, plane);
+    if (!buf)
+        return AVERROR(EINVAL);
+    ref = av_buffer_ref(buf);
+    if (!ref)
+        return AVERROR(ENOMEM);
+
+    av_buffer_unref(&dst->buf[plane]);
+    dst->buf[plane]      = ref;
+    dst->data[plane]     = src->data[plane];
+    dst->linesize[plane] = src->linesize[plane];
+
+    return 0;
+}
+
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     AVFrame *ret = NULL;
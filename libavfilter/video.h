@@ -38,4 +38,19 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h);
  */
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h);
 
+/**
+ * Make a plane of dst reference the same plane of src instead of its own
+ * buffer, for filters writing out of place that pass some planes through
+ * unchanged. The plane is shared with src rather than copied, so dst is
+ * only writable once src and its other references are gone.
+ *
+ * @param dst   frame obtained with ff_get_video_buffer()
+ * @param src   frame with the same dimensions and format as dst
+ * @param plane index of the plane
+ * @return 0 on success, AVERROR(EINVAL) if the plane does not have a
+ *         buffer of its own in dst, which the caller may handle by copying
+ *         the plane instead, or another negative AVERROR code on failure
+ */
+int ff_video_frame_ref_plane(AVFrame *dst, const AVFrame *src, int plane);
+
 #endif /* AVFILTER_VIDEO_H */
@@ -43,6 +43,12 @@ typedef struct W3FDIFDSPContext {
                          int linesize, int max);
 } W3FDIFDSPContext;
 
+/**
+ * Set the line functions for the given bit depth.
+ */
+void ff_w3fdif_init(W3FDIFDSPContext *dsp, int depth);
+
+void ff_w3fdif_init_aarch64(W3FDIFDSPContext *dsp, int depth);
 void ff_w3fdif_init_x86(W3FDIFDSPContext *dsp, int depth);
 
 #endif /* AVFILTER_W3FDIF_H */
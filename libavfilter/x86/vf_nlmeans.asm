@@ -0,0 +1,89 @@
+;*****************************************************************************
+;* x86-optimized functions for nlmeans filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+
+SECTION_RODATA 32
+
+pd_0to7: dd 0, 1, 2, 3, 4, 5, 6, 7
+
+SECTION .text
+
+; void ff_compute_weights_line_avx2(const uint32_t *iia, const uint32_t *iib,
+;                                   const uint32_t *iid, const uint32_t *iie,
+;                                   const uint8_t *src, float *total_weight, float *sum,
+;                                   const float *weight_lut, int max_meaningful_diff,
+;                                   int startx, int endx);
+
+; The pixels past endx are masked out of the loads and stores of the integral
+; image and the weighted averages, so only src may be read past the line end.
+; The weight of a pixel outside of the meaningful range is masked out of the
+; gather and left to 0, which does not change its weighted average.
+
+INIT_YMM avx2
+cglobal compute_weights_line, 11, 12, 11, iia, iib, iid, iie, src, total_weight, sum, weight_lut, max_diff, x, endx, rem
+    movsxdifnidn    xq, xd
+    movsxdifnidn endxq, endxd
+    cmp             xq, endxq
+    jge .end
+    movd           xm0, max_diffd
+    vpbroadcastd    m0, xm0
+    mova           m10, [pd_0to7]
+
+    .loop:
+        mov           remd, endxd
+        sub           remd, xd
+        movd           xm9, remd
+        vpbroadcastd    m9, xm9
+        pcmpgtd         m9, m10
+
+        vpmaskmovd      m1, m9, [iiaq + xq * 4]
+        vpmaskmovd      m2, m9, [iibq + xq * 4]
+        vpmaskmovd      m3, m9, [iidq + xq * 4]
+        vpmaskmovd      m4, m9, [iieq + xq * 4]
+        psubd           m4, m3
+        psubd           m4, m2
+        paddd           m4, m1
+
+        pcmpgtd         m5, m0, m4
+        pand            m5, m9
+        pxor            m6, m6
+        vgatherdps      m6, [weight_lutq + m4 * 4], m5
+
+        pmovzxbd        m7, [srcq + xq]
+        cvtdq2ps        m7, m7
+        mulps           m7, m6
+        vmaskmovps      m1, m9, [total_weightq + xq * 4]
+        vmaskmovps      m2, m9, [sumq + xq * 4]
+        addps           m1, m6
+        addps           m2, m7
+        vmaskmovps      [total_weightq + xq * 4], m9, m1
+        vmaskmovps      [sumq + xq * 4], m9, m2
+
+        add             xq, mmsize / 4
+        cmp             xq, endxq
+        jl .loop
+
+.end:
+    RET
+
+%endif
@@ -24,6 +24,8 @@
 
 uint64_t ff_sse_line_8bit_sse2(const uint8_t *buf, const uint8_t *ref, int w);
 uint64_t ff_sse_line_16bit_sse2(const uint8_t *buf, const uint8_t *ref, int w);
+uint64_t ff_sse_line_8bit_avx2(const uint8_t *buf, const uint8_t *ref, int w);
+uint64_t ff_sse_line_16bit_avx2(const uint8_t *buf, const uint8_t *ref, int w);
 
 void ff_psnr_init_x86(PSNRDSPContext *dsp, int bpp)
 {
@@ -36,4 +38,12 @@ void ff_psnr_init_x86(PSNRDSPContext *dsp, int bpp)
             dsp->sse_line = ff_sse_line_16bit_sse2;
         }
     }
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        if (bpp <= 8) {
+            dsp->sse_line = ff_sse_line_8bit_avx2;
+        } else if (bpp <= 15) {
+            dsp->sse_line = ff_sse_line_16bit_avx2;
+        }
+    }
 }
@@ -22,9 +22,9 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
-pw_1: times 8 dw 1
+pw_1: times 16 dw 1
 ssim_c1: times 4 dd 416 ;(.01*.01*255*255*64 + .5)
 ssim_c2: times 4 dd 235963 ;(.03*.03*255*255*64*63 + .5)
 
@@ -73,6 +73,12 @@ cglobal ssim_4x4_line, 5, 7, %1, buf, buf_stride, ref, ref_stride, sums, buf_str
     paddw             m0, m5
     paddw             m1, m7
     vpmadcswd         m4, m7, m7, m4
+%else
+%if mmsize == 32
+    pmovzxbw          m0, [bufq+buf_strideq*0]  ; a1
+    pmovzxbw          m1, [refq+ref_strideq*0]  ; b1
+    pmovzxbw          m2, [bufq+buf_strideq*1]  ; a2
+    pmovzxbw          m3, [refq+ref_strideq*1]  ; b2
 %else
     movh              m0, [bufq+buf_strideq*0]  ; a1
     movh              m1, [refq+ref_strideq*0]  ; b1
@@ -82,6 +88,7 @@ cglobal ssim_4x4_line, 5, 7, %1, buf, buf_stride, ref, ref_stride, sums, buf_str
     punpcklbw         m1, m7                    ; s2 [word]
     punpcklbw         m2, m7                    ; s1 [word]
     punpcklbw         m3, m7                    ; s2 [word]
+%endif
     pmaddwd           m4, m0, m0                ; a1 * a1
     pmaddwd           m5, m1, m1                ; b1 * b1
     pmaddwd           m8, m2, m2                ; a2 * a2
@@ -95,6 +102,12 @@ cglobal ssim_4x4_line, 5, 7, %1, buf, buf_stride, ref, ref_stride, sums, buf_str
     paddd             m6, m5                    ; s12
     paddd             m4, m8                    ; ss
 
+%if mmsize == 32
+    pmovzxbw          m2, [bufq+buf_strideq*2]  ; a3
+    pmovzxbw          m3, [refq+ref_strideq*2]  ; b3
+    pmovzxbw          m5, [bufq+buf_stride3q]   ; a4
+    pmovzxbw          m8, [refq+ref_stride3q]   ; b4
+%else
     movh              m2, [bufq+buf_strideq*2]  ; a3
     movh              m3, [refq+ref_strideq*2]  ; b3
     movh              m5, [bufq+buf_stride3q]   ; a4
@@ -103,6 +116,7 @@ cglobal ssim_4x4_line, 5, 7, %1, buf, buf_stride, ref, ref_stride, sums, buf_str
     punpcklbw         m3, m7                    ; s2 [word]
     punpcklbw         m5, m7                    ; s1 [word]
     punpcklbw         m8, m7                    ; s2 [word]
+%endif
     pmaddwd           m9, m2, m2                ; a3 * a3
     pmaddwd          m10, m3, m3                ; b3 * b3
     pmaddwd          m12, m5, m5                ; a4 * a4
@@ -148,8 +162,16 @@ cglobal ssim_4x4_line, 5, 7, %1, buf, buf_stride, ref, ref_stride, sums, buf_str
     punpcklqdq        m0, m2                    ; [dword] a s1, s2, ss, s12
 %endif
 
+%if mmsize == 32
+    ; the lanes hold the blocks a, b and c, d
+    vperm2i128        m2, m0, m1, 0x20          ; [dword] a, b
+    vperm2i128        m1, m0, m1, 0x31          ; [dword] c, d
+    movu  [sumsq+     0], m2
+    movu  [sumsq+mmsize], m1
+%else
     mova  [sumsq+     0], m0
     mova  [sumsq+mmsize], m1
+%endif
 
     add             bufq, mmsize/2
     add             refq, mmsize/2
@@ -167,6 +189,10 @@ SSIM_4X4_LINE 16
 INIT_XMM xop
 SSIM_4X4_LINE 8
 %endif
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SSIM_4X4_LINE 16
+%endif
 
 INIT_XMM sse4
 cglobal ssim_end_line, 3, 3, 6, sum0, sum1, w
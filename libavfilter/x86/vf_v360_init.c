@@ -38,6 +38,9 @@ void ff_remap1_16bit_line_avx2(uint8_t *dst, int width, const uint8_t *src, ptrd
 void ff_remap2_16bit_line_avx2(uint8_t *dst, int width, const uint8_t *src, ptrdiff_t in_linesize,
                               const uint16_t *u, const uint16_t *v, const int16_t *ker);
 
+void ff_remap4_16bit_line_avx2(uint8_t *dst, int width, const uint8_t *src, ptrdiff_t in_linesize,
+                               const uint16_t *u, const uint16_t *v, const int16_t *ker);
+
 av_cold void ff_v360_init_x86(V360Context *s, int depth)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -58,5 +61,9 @@ av_cold void ff_v360_init_x86(V360Context *s, int depth)
     if (EXTERNAL_AVX2_FAST(cpu_flags) && (s->interp == BICUBIC ||
                                           s->interp == LANCZOS) && depth <= 8)
         s->remap_line = ff_remap4_8bit_line_avx2;
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && (s->interp == BICUBIC ||
+                                          s->interp == LANCZOS) && depth > 8)
+        s->remap_line = ff_remap4_16bit_line_avx2;
 #endif
 }
@@ -34,6 +34,7 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 #include "url.h"
 #include <stdint.h>
 
@@ -44,6 +45,7 @@
 #define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define MAX_BUFFERS             16
 
 typedef struct RingBuffer
 {
@@ -51,6 +53,8 @@ typedef struct RingBuffer
     int           read_back_capacity;
 
     int           read_pos;
+    int64_t       end_pos;      ///< logical position of the end of the data
+    int64_t       last_used;
 } RingBuffer;
 
 typedef struct Context {
@@ -59,7 +63,6 @@ typedef struct Context {
 
     int             seek_request;
     int64_t         seek_pos;
-    int             seek_whence;
     int             seek_completed;
     int64_t         seek_ret;
 
@@ -69,7 +72,9 @@ typedef struct Context {
 
     int64_t         logical_pos;
     int64_t         logical_size;
-    RingBuffer      ring;
+    RingBuffer     *ring;
+    RingBuffer     *rings;
+    int64_t         nb_seeks;
 
     pthread_cond_t  cond_wakeup_main;
     pthread_cond_t  cond_wakeup_background;
@@ -78,6 +83,16 @@ typedef struct Context {
 
     int             abort_request;
     AVIOInterruptCB interrupt_callback;
+
+    /* options */
+    int             buffer_size;
+    int             read_back_size;
+    int             nb_buffers;
+
+    /* statistics */
+    int64_t         seek_hits;
+    int64_t         seek_misses;
+    int64_t         stall_time;
 } Context;
 
 static int ring_init(RingBuffer *ring, unsigned int capacity, int read_back_capacity)
@@ -96,10 +111,11 @@ static void ring_destroy(RingBuffer *ring)
     av_fifo_freep(&ring->fifo);
 }
 
-static void ring_reset(RingBuffer *ring)
+static void ring_reset(RingBuffer *ring, int64_t pos)
 {
     av_fifo_reset(ring->fifo);
     ring->read_pos = 0;
+    ring->end_pos  = pos;
 }
 
 static int ring_size(RingBuffer *ring)
@@ -147,6 +163,53 @@ static int ring_drain(RingBuffer *ring, int offset)
     return 0;
 }
 
+/* must be called from the background thread with the mutex held */
+static int64_t buffers_seek(URLContext *h, int64_t pos)
+{
+    Context    *c    = h->priv_data;
+    RingBuffer *ring = NULL;
+    int64_t     ret;
+    int         i;
+
+    c->ring->last_used = ++c->nb_seeks;
+
+    /* look for another buffer which already holds the target position */
+    for (i = 0; i < c->nb_buffers; i++) {
+        RingBuffer *r   = &c->rings[i];
+        int         len = av_fifo_size(r->fifo);
+
+        if (r != c->ring && len && pos >= r->end_pos - len && pos <= r->end_pos) {
+            ring = r;
+            break;
+        }
+    }
+
+    if (ring) {
+        ret = ffurl_seek(c->inner, ring->end_pos, SEEK_SET);
+        if (ret < 0)
+            return ret;
+        ring->read_pos = pos - (ring->end_pos - av_fifo_size(ring->fifo));
+        if (ring->read_pos > ring->read_back_capacity) {
+            av_fifo_drain(ring->fifo, ring->read_pos - ring->read_back_capacity);
+            ring->read_pos = ring->read_back_capacity;
+        }
+        c->seek_hits++;
+    } else {
+        ret = ffurl_seek(c->inner, pos, SEEK_SET);
+        if (ret < 0)
+            return ret;
+        /* recycle the least recently used buffer */
+        for (i = 0; i < c->nb_buffers; i++)
+            if (!ring || c->rings[i].last_used < ring->last_used)
+                ring = &c->rings[i];
+        ring_reset(ring, pos);
+        c->seek_misses++;
+    }
+    c->ring = ring;
+
+    return pos;
+}
+
 static int async_check_interrupt(void *arg)
 {
     URLContext *h   = arg;
@@ -177,7 +240,7 @@ static void *async_buffer_task(void *arg)
 {
     URLContext   *h    = arg;
     Context      *c    = h->priv_data;
-    RingBuffer   *ring = &c->ring;
+    RingBuffer   *ring;
     int           ret  = 0;
     int64_t       seek_ret;
 
@@ -185,6 +248,7 @@ static void *async_buffer_task(void *arg)
         int fifo_space, to_copy;
 
         pthread_mutex_lock(&c->mutex);
+        ring = c->ring;
         if (async_check_interrupt(h)) {
             c->io_eof_reached = 1;
             c->io_error       = AVERROR_EXIT;
@@ -194,11 +258,10 @@ static void *async_buffer_task(void *arg)
         }
 
         if (c->seek_request) {
-            seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
+            seek_ret = buffers_seek(h, c->seek_pos);
             if (seek_ret >= 0) {
                 c->io_eof_reached = 0;
                 c->io_error       = 0;
-                ring_reset(ring);
             }
 
             c->seek_completed = 1;
@@ -224,6 +287,8 @@ static void *async_buffer_task(void *arg)
         ret = ring_generic_write(ring, (void *)h, to_copy, wrapped_url_read);
 
         pthread_mutex_lock(&c->mutex);
+        if (ret > 0)
+            ring->end_pos += ret;
         if (ret <= 0) {
             c->io_eof_reached = 1;
             if (c->inner_io_error < 0)
@@ -240,14 +305,22 @@ static void *async_buffer_task(void *arg)
 static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     Context         *c = h->priv_data;
-    int              ret;
+    int              i, ret;
     AVIOInterruptCB  interrupt_callback = {.callback = async_check_interrupt, .opaque = h};
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
-    if (ret < 0)
+    c->rings = av_mallocz_array(c->nb_buffers, sizeof(*c->rings));
+    if (!c->rings) {
+        ret = AVERROR(ENOMEM);
         goto fifo_fail;
+    }
+    c->ring = c->rings;
+    for (i = 0; i < c->nb_buffers; i++) {
+        ret = ring_init(&c->rings[i], c->buffer_size, c->read_back_size);
+        if (ret < 0)
+            goto url_fail;
+    }
 
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
@@ -295,7 +368,9 @@ cond_wakeup_main_fail:
 mutex_fail:
     ffurl_close(c->inner);
 url_fail:
-    ring_destroy(&c->ring);
+    for (i = 0; i < c->nb_buffers; i++)
+        ring_destroy(&c->rings[i]);
+    av_freep(&c->rings);
 fifo_fail:
     return ret;
 }
@@ -303,7 +378,7 @@ fifo_fail:
 static int async_close(URLContext *h)
 {
     Context *c = h->priv_data;
-    int      ret;
+    int      i, ret;
 
     pthread_mutex_lock(&c->mutex);
     c->abort_request = 1;
@@ -318,7 +393,12 @@ static int async_close(URLContext *h)
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
     ffurl_close(c->inner);
-    ring_destroy(&c->ring);
+    for (i = 0; i < c->nb_buffers; i++)
+        ring_destroy(&c->rings[i]);
+    av_freep(&c->rings);
+
+    av_log(h, AV_LOG_VERBOSE, "Statistics, seek hits:%"PRId64" seek misses:%"PRId64
+           " stall time:%"PRId64"us\n", c->seek_hits, c->seek_misses, c->stall_time);
 
     return 0;
 }
@@ -327,9 +407,10 @@ static int async_read_internal(URLContext *h, void *dest, int size, int read_com
                                void (*func)(void*, void*, int))
 {
     Context      *c       = h->priv_data;
-    RingBuffer   *ring    = &c->ring;
+    RingBuffer   *ring    = c->ring;
     int           to_read = size;
     int           ret     = 0;
+    int64_t       t;
 
     pthread_mutex_lock(&c->mutex);
 
@@ -361,7 +442,9 @@ static int async_read_internal(URLContext *h, void *dest, int size, int read_com
             break;
         }
         pthread_cond_signal(&c->cond_wakeup_background);
+        t = av_gettime_relative();
         pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+        c->stall_time += av_gettime_relative() - t;
     }
 
     pthread_cond_signal(&c->cond_wakeup_background);
@@ -382,7 +465,7 @@ static void fifo_do_not_copy_func(void* dest, void* src, int size) {
 static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 {
     Context      *c    = h->priv_data;
-    RingBuffer   *ring = &c->ring;
+    RingBuffer   *ring = c->ring;
     int64_t       ret;
     int64_t       new_logical_pos;
     int fifo_size;
@@ -411,6 +494,7 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
     } else if ((new_logical_pos >= (c->logical_pos - fifo_size_of_read_back)) &&
                (new_logical_pos < (c->logical_pos + fifo_size + SHORT_SEEK_THRESHOLD))) {
         int pos_delta = (int)(new_logical_pos - c->logical_pos);
+        c->seek_hits++;
         /* fast seek */
         av_log(h, AV_LOG_TRACE, "async_seek: fask_seek %"PRId64" from %d dist:%d/%d\n",
                 new_logical_pos, (int)c->logical_pos,
@@ -438,7 +522,6 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 
     c->seek_request   = 1;
     c->seek_pos       = new_logical_pos;
-    c->seek_whence    = SEEK_SET;
     c->seek_completed = 0;
     c->seek_ret       = 0;
 
@@ -466,6 +549,12 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 #define D AV_OPT_FLAG_DECODING_PARAM
 
 static const AVOption options[] = {
+    { "async_buffer_size", "size of each read ahead buffer", OFFSET(buffer_size), AV_OPT_TYPE_INT, { .i64 = BUFFER_CAPACITY }, 4096, INT_MAX / 4, D },
+    { "async_read_back_size", "amount of consumed data kept for backward seeks", OFFSET(read_back_size), AV_OPT_TYPE_INT, { .i64 = READ_BACK_CAPACITY }, 0, INT_MAX / 4, D },
+    { "async_buffers", "number of buffers kept around for seeks back to earlier ranges", OFFSET(nb_buffers), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, MAX_BUFFERS, D },
+    { "seek_hits", "number of seeks served from the buffers", OFFSET(seek_hits), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "seek_misses", "number of seeks forwarded to the inner protocol", OFFSET(seek_misses), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "stall_time", "time spent waiting for the background thread, in microseconds", OFFSET(stall_time), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     {NULL},
 };
 
@@ -1248,6 +1248,21 @@ void  av_stream_set_recommended_encoder_configuration(AVStream *s, char *configu
 
 struct AVCodecParserContext *av_stream_get_parser(const AVStream *s);
 
+/**
+ * Take the decoder kept for the stream by avformat_find_stream_info() when
+ * AVFMT_FLAG_KEEP_DECODERS is set, to avoid opening a second one.
+ *
+ * Decoders are only kept for audio streams, when nothing has been decoded
+ * with them and they match the final codec parameters of the stream, so
+ * they are in the same state as a decoder opened with those parameters and
+ * the options given to avformat_find_stream_info() for the stream (with the
+ * thread count forced to 1).
+ *
+ * @return the open decoder, to be freed by the caller with
+ *         avcodec_free_context(), or NULL if none was kept
+ */
+AVCodecContext *av_stream_take_probe_decoder(AVStream *st);
+
 /**
  * Returns the pts of the last muxed packet + its duration
  *
@@ -1501,6 +1516,14 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+#define AVFMT_FLAG_KEEP_DECODERS 0x400000 ///< Keep the audio decoders opened by avformat_find_stream_info(), see av_stream_take_probe_decoder()
+/**
+ * In avformat_find_stream_info(), trust the codec parameters given by the
+ * container and take the missing pixel format from the parsers, so that
+ * frames are only decoded when a parameter cannot be found otherwise. The
+ * decoding delay and the channel configuration are not verified by decoding.
+ */
+#define AVFMT_FLAG_FAST_PROBE 0x800000
 
     /**
      * Maximum size of the data read from input for determining
@@ -2842,6 +2865,27 @@ int av_find_default_stream_index(AVFormatContext *s);
  */
 int av_index_search_timestamp(AVStream *st, int64_t timestamp, int flags);
 
+/**
+ * Get the number of entries in the index of a stream.
+ *
+ * @param st stream
+ * @return the number of index entries, which may be 0 if the demuxer does
+ *         not build an index or has not seen the whole file
+ */
+int avformat_index_get_entries_count(const AVStream *st);
+
+/**
+ * Get an entry of the index of a stream.
+ *
+ * @param st  stream
+ * @param idx index of the entry, between 0 and
+ *            avformat_index_get_entries_count() - 1
+ * @return a pointer to the entry, or NULL if idx is out of range. It is only
+ *         valid until the next call to a function reading from or seeking in
+ *         the input, which may add entries to the index.
+ */
+const AVIndexEntry *avformat_index_get_entry(const AVStream *st, int idx);
+
 /**
  * Add an index entry into a sorted list. Update the entry if the list
  * already contains it.
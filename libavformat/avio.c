@@ -357,6 +357,26 @@ int ffurl_open(URLContext **puc, const char *filename, int flags,
                                 int_cb, options, NULL, NULL, NULL);
 }
 
+/**
+ * Wait before retrying a transfer which returned AVERROR(EAGAIN).
+ */
+static int retry_transfer_wait(URLContext *h, int *fast_retries,
+                               int64_t *wait_since)
+{
+    if (*fast_retries) {
+        (*fast_retries)--;
+    } else {
+        if (h->rw_timeout) {
+            if (!*wait_since)
+                *wait_since = av_gettime_relative();
+            else if (av_gettime_relative() > *wait_since + h->rw_timeout)
+                return AVERROR(EIO);
+        }
+        av_usleep(1000);
+    }
+    return 0;
+}
+
 static inline int retry_transfer_wrapper(URLContext *h, uint8_t *buf,
                                          int size, int size_min,
                                          int (*transfer_func)(URLContext *h,
@@ -377,18 +397,9 @@ static inline int retry_transfer_wrapper(URLContext *h, uint8_t *buf,
         if (h->flags & AVIO_FLAG_NONBLOCK)
             return ret;
         if (ret == AVERROR(EAGAIN)) {
-            ret = 0;
-            if (fast_retries) {
-                fast_retries--;
-            } else {
-                if (h->rw_timeout) {
-                    if (!wait_since)
-                        wait_since = av_gettime_relative();
-                    else if (av_gettime_relative() > wait_since + h->rw_timeout)
-                        return AVERROR(EIO);
-                }
-                av_usleep(1000);
-            }
+            ret = retry_transfer_wait(h, &fast_retries, &wait_since);
+            if (ret < 0)
+                return ret;
         } else if (ret == AVERROR_EOF)
             return (len > 0) ? len : AVERROR_EOF;
         else if (ret < 0)
@@ -429,6 +440,72 @@ int ffurl_write(URLContext *h, const unsigned char *buf, int size)
                                   h->prot->url_write);
 }
 
+int ffurl_writev(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    URLIOVec cur[URL_IOVEC_MAX];
+    int fast_retries = 5;
+    int64_t wait_since = 0;
+    int i = 0, off = 0, len = 0, ret, n;
+
+    if (!(h->flags & AVIO_FLAG_WRITE))
+        return AVERROR(EIO);
+
+    if (!h->prot->url_writev) {
+        for (i = 0; i < nb_vec; i++) {
+            if ((ret = ffurl_write(h, vec[i].data, vec[i].size)) < 0)
+                return ret;
+            len += ret;
+        }
+        return len;
+    }
+
+    while (i < nb_vec) {
+        if (off == vec[i].size) {
+            i++;
+            off = 0;
+            continue;
+        }
+        if (ff_check_interrupt(&h->interrupt_callback))
+            return AVERROR_EXIT;
+
+        n = FFMIN(nb_vec - i, URL_IOVEC_MAX);
+        memcpy(cur, vec + i, n * sizeof(*cur));
+        cur[0].data += off;
+        cur[0].size -= off;
+        ret = h->prot->url_writev(h, cur, n);
+        if (ret == AVERROR(EINTR))
+            continue;
+        if (h->flags & AVIO_FLAG_NONBLOCK)
+            return ret < 0 ? ret : len + ret;
+        if (ret == AVERROR(EAGAIN)) {
+            ret = retry_transfer_wait(h, &fast_retries, &wait_since);
+            if (ret < 0)
+                return ret;
+            continue;
+        } else if (ret < 0) {
+            return ret;
+        }
+        if (ret) {
+            fast_retries = FFMAX(fast_retries, 2);
+            wait_since = 0;
+        }
+
+        /* skip what was written */
+        len += ret;
+        while (ret > 0) {
+            int left = vec[i].size - off;
+            if (ret < left) {
+                off += ret;
+                break;
+            }
+            ret -= left;
+            i++;
+            off = 0;
+        }
+    }
+    return len;
+}
+
 int64_t ffurl_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
@@ -652,6 +729,13 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_get_mapping(URLContext *h, AVBufferRef **buf, int64_t *size)
+{
+    if (!h || !h->prot || !h->prot->url_get_mapping)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_mapping(h, buf, size);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
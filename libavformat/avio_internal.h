@@ -53,6 +53,20 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Read size bytes from AVIOContext as a reference to the I/O memory holding
+ * them, without copying, if it is refcounted. This is the case with memory
+ * mapped resources, as long as the data is followed by at least
+ * AV_INPUT_BUFFER_PADDING_SIZE bytes of the mapping. The padding is then not
+ * zeroed, and the memory is read-only.
+ *
+ * @param buf  set to a new reference to the buffer containing the data
+ * @param data set to the start of the data within buf
+ * @return size on success, 0 if the data is not available as a reference
+ *         and nothing was read, a negative AVERROR code on failure
+ */
+int ffio_read_ref(AVIOContext *s, int size, AVBufferRef **buf, const uint8_t **data);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
@@ -42,8 +42,16 @@
  */
 #define SHORT_SEEK_THRESHOLD 4096
 
+/**
+ * Size of the part of a memory mapped resource used as buffer at once, as
+ * the buffer size is an int.
+ */
+#define IO_MAP_WINDOW (1 << 30)
+
 typedef struct AVIOInternal {
     URLContext *h;
+    AVBufferRef *map;       ///< mapping of the whole resource, if any
+    int64_t map_size;
 } AVIOInternal;
 
 static void *ff_avio_child_next(void *obj, void *prev)
@@ -77,6 +85,19 @@ const AVClass ff_avio_class = {
 
 static void fill_buffer(AVIOContext *s);
 static int url_resetbuf(AVIOContext *s, int flags);
+static int io_read_packet(void *opaque, uint8_t *buf, int buf_size);
+static int io_write_packet(void *opaque, uint8_t *buf, int buf_size);
+
+/**
+ * Return whether the buffer is a window into a memory mapping of the
+ * resource rather than an allocated buffer, in which case reads do not copy
+ * the data and seeks within the mapping do not have to access the protocol.
+ */
+static int is_mapped(AVIOContext *s)
+{
+    return s->read_packet == io_read_packet &&
+           ((AVIOInternal *)s->opaque)->map;
+}
 
 int ffio_init_context(AVIOContext *s,
                   unsigned char *buffer,
@@ -177,6 +198,49 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
     s->pos += len;
 }
 
+/**
+ * Return whether data can be written together with the buffer contents by a
+ * single vectored write of the protocol.
+ */
+static int is_vectored(AVIOContext *s)
+{
+    return s->write_packet == io_write_packet && !s->write_data_type &&
+           !s->update_checksum &&
+           ((AVIOInternal *)s->opaque)->h->prot->url_writev;
+}
+
+/**
+ * Write the buffer contents followed by data, without copying data into the
+ * buffer.
+ */
+static void writeout_vec(AVIOContext *s, const uint8_t *data, int len)
+{
+    AVIOInternal *internal = s->opaque;
+    URLIOVec vec[2] = {
+        { s->buffer, s->buf_ptr - s->buffer },
+        { data,      len                    },
+    };
+
+    len += vec[0].size;
+    if (!s->error) {
+        int ret = ffurl_writev(internal->h, vec, 2);
+        if (ret < 0) {
+            s->error = ret;
+        } else {
+            if (s->pos + len > s->written)
+                s->written = s->pos + len;
+        }
+    }
+    if (s->current_type == AVIO_DATA_MARKER_SYNC_POINT ||
+        s->current_type == AVIO_DATA_MARKER_BOUNDARY_POINT) {
+        s->current_type = AVIO_DATA_MARKER_UNKNOWN;
+    }
+    s->last_time = AV_NOPTS_VALUE;
+    s->writeout_count ++;
+    s->pos += len;
+    s->buf_ptr = s->buf_ptr_max = s->buffer;
+}
+
 static void flush_buffer(AVIOContext *s)
 {
     s->buf_ptr_max = FFMAX(s->buf_ptr, s->buf_ptr_max);
@@ -222,6 +286,13 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         writeout(s, buf, size);
         return;
     }
+    /* large payloads are not copied but written along with the buffer,
+     * unless a seek back left data after the current position */
+    if (size >= s->buffer_size / 2 && s->buf_ptr >= s->buf_ptr_max &&
+        is_vectored(s)) {
+        writeout_vec(s, buf, size);
+        return;
+    }
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
@@ -549,6 +620,31 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 /* Input stream */
 
+static void fill_mapped(AVIOContext *s)
+{
+    AVIOInternal *internal = s->opaque;
+    uint8_t *dst;
+
+    if (s->pos >= internal->map_size) {
+        s->eof_reached = 1;
+        return;
+    }
+    dst = internal->map->data + s->pos;
+
+    if (s->update_checksum) {
+        if (s->buf_end > s->checksum_ptr)
+            s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
+                                             s->buf_end - s->checksum_ptr);
+        s->checksum_ptr = dst;
+    }
+
+    s->buffer      = s->buf_ptr = dst;
+    s->buffer_size = FFMIN(internal->map_size - s->pos, IO_MAP_WINDOW);
+    s->buf_end     = dst + s->buffer_size;
+    s->pos        += s->buffer_size;
+    s->bytes_read += s->buffer_size;
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     int max_buffer_size = s->max_packet_size ?
@@ -565,6 +661,11 @@ static void fill_buffer(AVIOContext *s)
     if (s->eof_reached)
         return;
 
+    if (is_mapped(s)) {
+        fill_mapped(s);
+        return;
+    }
+
     if (s->update_checksum && dst == s->buffer) {
         if (s->buf_end > s->checksum_ptr)
             s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
@@ -655,7 +756,8 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
     while (size > 0) {
         len = FFMIN(s->buf_end - s->buf_ptr, size);
         if (len == 0 || s->write_flag) {
-            if((s->direct || size > s->buffer_size) && !s->update_checksum) {
+            if ((s->direct || size > s->buffer_size) && !s->update_checksum &&
+                !is_mapped(s)) {
                 // bypass the buffer and read data directly into buf
                 len = read_packet_wrapper(s, buf, size);
                 if (len == AVERROR_EOF) {
@@ -716,6 +818,29 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_read_ref(AVIOContext *s, int size, AVBufferRef **buf, const uint8_t **data)
+{
+    AVIOInternal *internal = s->opaque;
+    int64_t pos, ret;
+
+    /* the checksum would miss the skipped data when moving the window */
+    if (size <= 0 || !is_mapped(s) || s->update_checksum)
+        return 0;
+
+    pos = avio_tell(s);
+    if (pos + size > internal->map_size - AV_INPUT_BUFFER_PADDING_SIZE)
+        return 0;
+
+    if (!(*buf = av_buffer_ref(internal->map)))
+        return AVERROR(ENOMEM);
+    if ((ret = avio_skip(s, size)) < 0) {
+        av_buffer_unref(buf);
+        return ret;
+    }
+    *data = internal->map->data + pos;
+    return size;
+}
+
 int avio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -984,6 +1109,8 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
 {
     AVIOInternal *internal = NULL;
     uint8_t *buffer = NULL;
+    AVBufferRef *map = NULL;
+    int64_t map_size;
     int buffer_size, max_packet_size;
 
     max_packet_size = h->max_packet_size;
@@ -992,15 +1119,26 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     } else {
         buffer_size = IO_BUFFER_SIZE;
     }
-    buffer = av_malloc(buffer_size);
-    if (!buffer)
-        return AVERROR(ENOMEM);
+
+    /* read mapped resources in place, the buffer is then set up by
+     * fill_buffer() as a window into the mapping */
+    if (!(h->flags & (AVIO_FLAG_WRITE | AVIO_FLAG_DIRECT)) &&
+        ffurl_get_mapping(h, &map, &map_size) >= 0) {
+        buffer      = map->data;
+        buffer_size = 0;
+    } else {
+        buffer = av_malloc(buffer_size);
+        if (!buffer)
+            return AVERROR(ENOMEM);
+    }
 
     internal = av_mallocz(sizeof(*internal));
     if (!internal)
         goto fail;
 
-    internal->h = h;
+    internal->h        = h;
+    internal->map      = map;
+    internal->map_size = map ? map_size : 0;
 
     *s = avio_alloc_context(buffer, buffer_size, h->flags & AVIO_FLAG_WRITE,
                             internal, io_read_packet, io_write_packet, io_seek);
@@ -1034,7 +1172,10 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     return 0;
 fail:
     av_freep(&internal);
-    av_freep(&buffer);
+    if (map)
+        av_buffer_unref(&map);
+    else
+        av_freep(&buffer);
     return AVERROR(ENOMEM);
 }
 
@@ -1061,7 +1202,7 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 
     buf_size += s->buf_ptr - s->buffer + max_buffer_size;
 
-    if (buf_size < filled || s->seekable || !s->read_packet)
+    if (buf_size < filled || s->seekable || !s->read_packet || is_mapped(s))
         return 0;
     av_assert0(!s->write_flag);
 
@@ -1083,6 +1224,10 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 int ffio_set_buf_size(AVIOContext *s, int buf_size)
 {
     uint8_t *buffer;
+
+    if (is_mapped(s))
+        return 0;
+
     buffer = av_malloc(buf_size);
     if (!buffer)
         return AVERROR(ENOMEM);
@@ -1101,6 +1246,9 @@ int ffio_realloc_buf(AVIOContext *s, int buf_size)
     uint8_t *buffer;
     int data_size;
 
+    if (is_mapped(s))
+        return 0;
+
     if (!s->buffer_size)
         return ffio_set_buf_size(s, buf_size);
 
@@ -1153,6 +1301,12 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char **bufp, int buf_si
         return AVERROR(EINVAL);
     }
 
+    /* the probe data is still in the mapping */
+    if (is_mapped(s)) {
+        av_freep(bufp);
+        return FFMIN(avio_seek(s, 0, SEEK_SET), 0);
+    }
+
     buffer_size = s->buf_end - s->buffer;
 
     /* the buffers must touch or overlap */
@@ -1226,8 +1380,11 @@ int avio_close(AVIOContext *s)
     internal = s->opaque;
     h        = internal->h;
 
+    if (internal->map)
+        av_buffer_unref(&internal->map);
+    else
+        av_freep(&s->buffer);
     av_freep(&s->opaque);
-    av_freep(&s->buffer);
     if (s->write_flag)
         av_log(s, AV_LOG_VERBOSE, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
@@ -18,12 +18,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 #include "avformat.h"
 #include "internal.h"
@@ -66,6 +69,16 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int preopen;
+#if HAVE_THREADS
+    AVIOInterruptCB interrupt_callback;
+    pthread_t preopen_thread;
+    int preopen_started;
+    atomic_int preopen_abort;
+    AVFormatContext *preopen_avf;
+    unsigned preopen_fileno;
+    int preopen_ret;
+#endif
 } ConcatContext;
 
 static int concat_probe(const AVProbeData *probe)
@@ -325,29 +338,131 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+static int alloc_file_context(AVFormatContext *avf, AVFormatContext **pavf,
+                              const AVIOInterruptCB *interrupt_callback)
 {
-    ConcatContext *cat = avf->priv_data;
-    ConcatFile *file = &cat->files[fileno];
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
-
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+    *pavf = avformat_alloc_context();
+    if (!*pavf)
         return AVERROR(ENOMEM);
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
+    (*pavf)->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    (*pavf)->interrupt_callback = *interrupt_callback;
 
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
+    if ((ret = ff_copy_whiteblacklists(*pavf, avf)) < 0) {
+        avformat_free_context(*pavf);
+        *pavf = NULL;
         return ret;
+    }
+    return 0;
+}
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, NULL)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
-        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
+static int open_file_context(AVFormatContext **pavf, const char *url)
+{
+    int ret;
+
+    if ((ret = avformat_open_input(pavf, url, NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(*pavf, NULL)) < 0)
+        avformat_close_input(pavf);
+    return ret;
+}
+
+#if HAVE_THREADS
+static int preopen_interrupt_cb(void *opaque)
+{
+    ConcatContext *cat = opaque;
+
+    return atomic_load(&cat->preopen_abort) ||
+           ff_check_interrupt(&cat->interrupt_callback);
+}
+
+static void *preopen_thread(void *arg)
+{
+    ConcatContext *cat = arg;
+
+    cat->preopen_ret = open_file_context(&cat->preopen_avf,
+                                         cat->files[cat->preopen_fileno].url);
+    return NULL;
+}
+
+/**
+ * Open and probe the given file in the background, so that switching to it
+ * once the current file is finished does not stall.
+ */
+static int start_preopen(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    AVIOInterruptCB cb = { preopen_interrupt_cb, cat };
+    int ret;
+
+    if (!cat->preopen || fileno >= cat->nb_files)
+        return 0;
+
+    if ((ret = alloc_file_context(avf, &cat->preopen_avf, &cb)) < 0)
+        return ret;
+    atomic_store(&cat->preopen_abort, 0);
+    cat->preopen_fileno = fileno;
+    ret = pthread_create(&cat->preopen_thread, NULL, preopen_thread, cat);
+    if (ret) {
+        av_log(avf, AV_LOG_WARNING, "Could not pre-open '%s': %s\n",
+               cat->files[fileno].url, av_err2str(AVERROR(ret)));
+        avformat_free_context(cat->preopen_avf);
+        cat->preopen_avf = NULL;
+        return 0;
+    }
+    cat->preopen_started = 1;
+    return 0;
+}
+
+/**
+ * Wait for the background opening to finish and return its context if it
+ * is the one of the given file, discard it otherwise.
+ */
+static int finish_preopen(ConcatContext *cat, unsigned fileno,
+                          AVFormatContext **pavf)
+{
+    int ret = 0;
+
+    if (!cat->preopen_started)
+        return 0;
+    if (cat->preopen_fileno != fileno)
+        atomic_store(&cat->preopen_abort, 1);
+    pthread_join(cat->preopen_thread, NULL);
+    cat->preopen_started = 0;
+    /* a context taken from a previous pre-opening uses the same callback */
+    atomic_store(&cat->preopen_abort, 0);
+
+    if (cat->preopen_fileno == fileno && pavf) {
+        *pavf = cat->preopen_avf;
+        cat->preopen_avf = NULL;
+        ret = cat->preopen_ret;
+    } else {
+        avformat_close_input(&cat->preopen_avf);
+    }
+    return ret;
+}
+#endif
+
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret = 0;
+
+    if (cat->avf)
         avformat_close_input(&cat->avf);
+
+#if HAVE_THREADS
+    ret = finish_preopen(cat, fileno, &cat->avf);
+#endif
+    if (!cat->avf && ret >= 0) {
+        if ((ret = alloc_file_context(avf, &cat->avf, &avf->interrupt_callback)) < 0)
+            return ret;
+        ret = open_file_context(&cat->avf, file->url);
+    }
+    if (ret < 0) {
+        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
         return ret;
     }
     cat->cur_file = file;
@@ -370,6 +485,10 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
        if ((ret = avformat_seek_file(cat->avf, -1, INT64_MIN, file->inpoint, file->inpoint, 0)) < 0)
            return ret;
     }
+#if HAVE_THREADS
+    if ((ret = start_preopen(avf, fileno + 1)) < 0)
+        return ret;
+#endif
     return 0;
 }
 
@@ -378,6 +497,9 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+#if HAVE_THREADS
+    finish_preopen(cat, UINT_MAX, NULL);
+#endif
     for (i = 0; i < cat->nb_files; i++) {
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
@@ -508,6 +630,9 @@ static int concat_read_header(AVFormatContext *avf)
 
     cat->stream_match_mode = avf->nb_streams ? MATCH_EXACT_ID :
                                                MATCH_ONE_TO_ONE;
+#if HAVE_THREADS
+    cat->interrupt_callback = avf->interrupt_callback;
+#endif
     if ((ret = open_file(avf, 0)) < 0)
         goto fail;
     av_bprint_finalize(&bp, NULL);
@@ -767,6 +892,8 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "preopen", "open the next file in the background while reading the current one",
+      OFFSET(preopen), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
     { NULL }
 };
 
@@ -27,6 +27,8 @@
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
+#include "http.h"
+#include "prefetch.h"
 
 #define INITIAL_BUFFER_SIZE 32768
 
@@ -76,6 +78,11 @@ struct representation {
     char *url_template;
     AVIOContext pb;
     AVIOContext *input;
+    FFPrefetch *prefetch;
+    /* current fragment, if it was downloaded by the prefetcher */
+    uint8_t *prefetched_data;
+    int prefetched_size;
+    int prefetched_pos;
     AVFormatContext *parent;
     AVFormatContext *ctx;
     AVPacket pkt;
@@ -162,6 +169,7 @@ typedef struct DASHContext {
     char *allowed_extensions;
     AVDictionary *avio_opts;
     int max_url_size;
+    int prefetch_segments;
 
     /* Flags for init section*/
     int is_init_section_common_video;
@@ -357,6 +365,8 @@ static void free_timelines_list(struct representation *pls)
 
 static void free_representation(struct representation *pls)
 {
+    ff_prefetch_free(&pls->prefetch);
+    av_freep(&pls->prefetched_data);
     free_fragment_list(pls);
     free_timelines_list(pls);
     free_fragment(&pls->cur_seg);
@@ -1688,7 +1698,15 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetched_data) {
+        ret = FFMIN(buf_size, pls->prefetched_size - pls->prefetched_pos);
+        if (ret <= 0)
+            return AVERROR_EOF;
+        memcpy(buf, pls->prefetched_data + pls->prefetched_pos, ret);
+        pls->prefetched_pos += ret;
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1727,6 +1745,109 @@ cleanup:
     return ret;
 }
 
+/* called on the prefetch thread, see FFPrefetchOpenFunc */
+static int prefetch_open(void *opaque, AVIOContext **pb, const char *url,
+                         int64_t offset, int64_t size, AVDictionary **opts)
+{
+    struct representation *pls = opaque;
+    AVDictionary *tmp = NULL;
+    int ret;
+
+    if (size >= 0) {
+        av_dict_set_int(&tmp, "offset", offset, 0);
+        av_dict_set_int(&tmp, "end_offset", offset + size, 0);
+    }
+
+#if CONFIG_HTTP_PROTOCOL
+    if (*pb) {
+        /* reuse the connection of the previous fragment */
+        AVDictionary *keepalive_opts = NULL;
+
+        av_dict_copy(&keepalive_opts, *opts, 0);
+        av_dict_copy(&keepalive_opts, tmp, 0);
+        (*pb)->eof_reached = 0;
+        ret = ff_http_do_new_request2(ffio_geturlcontext(*pb), url, &keepalive_opts);
+        av_dict_free(&keepalive_opts);
+        if (ret >= 0) {
+            av_dict_free(&tmp);
+            return ret;
+        }
+        ff_format_io_close(pls->parent, pb);
+    }
+#endif
+
+    if (av_strstart(url, "http", NULL))
+        av_dict_set(&tmp, "multiple_requests", "1", 0);
+    ret = open_url(pls->parent, pb, url, *opts, tmp, NULL);
+    av_dict_free(&tmp);
+    return ret;
+}
+
+/* Queue the fragments following the current one for prefetching. */
+static void prefetch_next_fragments(DASHContext *c, struct representation *pls)
+{
+    char *tmpfilename, *url = NULL;
+    int64_t max_seq_no = 0;
+    int i, ret;
+
+    if (!c->prefetch_segments || pls->n_fragments == 1)
+        return;
+
+    if (!pls->prefetch) {
+        ret = ff_prefetch_alloc(&pls->prefetch, pls->parent, c->prefetch_segments,
+                                prefetch_open, pls, c->avio_opts, 1);
+        if (ret < 0) {
+            av_log(pls->parent, AV_LOG_WARNING,
+                   "Unable to start fragment prefetching: %s\n", av_err2str(ret));
+            c->prefetch_segments = 0;
+            return;
+        }
+    }
+
+    ff_prefetch_discard(pls->prefetch, pls->cur_seq_no + 1,
+                        pls->cur_seq_no + c->prefetch_segments);
+
+    if (!pls->n_fragments) {
+        if (!pls->url_template)
+            return;
+        max_seq_no = c->is_live ? calc_max_seg_no(pls, c) : pls->last_seq_no;
+    }
+
+    tmpfilename = av_mallocz(c->max_url_size);
+    url         = av_mallocz(c->max_url_size);
+    if (!tmpfilename || !url)
+        goto end;
+
+    for (i = 1; i <= c->prefetch_segments; i++) {
+        int64_t seq_no = pls->cur_seq_no + i;
+        int64_t offset = 0, size = -1;
+
+        if (pls->n_fragments) {
+            struct fragment *seg;
+
+            if (seq_no >= pls->n_fragments)
+                break;
+            seg    = pls->fragments[seq_no];
+            offset = seg->url_offset;
+            size   = seg->size;
+            ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+        } else {
+            if (seq_no > max_seq_no)
+                break;
+            ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0,
+                                     get_segment_start_time_based_on_timeline(pls, seq_no));
+            ff_make_absolute_url(url, c->max_url_size, c->base_url, tmpfilename);
+        }
+
+        if (ff_prefetch_add(pls->prefetch, seq_no, url, offset, size) < 0)
+            break;
+    }
+
+end:
+    av_free(tmpfilename);
+    av_free(url);
+}
+
 static int update_init_section(struct representation *pls)
 {
     static const int max_init_section_size = 1024 * 1024;
@@ -1777,6 +1898,14 @@ static int update_init_section(struct representation *pls)
 static int64_t seek_data(void *opaque, int64_t offset, int whence)
 {
     struct representation *v = opaque;
+    if (v->prefetched_data) {
+        /* the prefetched data starts at url_offset if a range was requested */
+        int64_t pos = offset - (v->cur_seg->size >= 0 ? v->cur_seg->url_offset : 0);
+        if (whence != SEEK_SET || pos < 0 || pos > v->prefetched_size)
+            return AVERROR(ENOSYS);
+        v->prefetched_pos = v->cur_seg_offset = pos;
+        return offset;
+    }
     if (v->n_fragments && !v->init_sec_data_len) {
         return avio_seek(v->input, offset, whence);
     }
@@ -1791,7 +1920,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->prefetched_data) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1804,7 +1933,16 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
+        if (v->prefetch &&
+            ff_prefetch_get(v->prefetch, v->cur_seq_no, &v->prefetched_data,
+                            &v->prefetched_size) >= 0) {
+            v->prefetched_pos = 0;
+            v->cur_seg_offset = 0;
+            v->cur_seg_size   = v->cur_seg->size;
+            ret = 0;
+        } else {
+            ret = open_input(c, v, v->cur_seg);
+        }
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
                 ret = AVERROR_EXIT;
@@ -1814,6 +1952,8 @@ restart:
             v->cur_seq_no++;
             goto restart;
         }
+
+        prefetch_next_fragments(c, v);
     }
 
     if (v->init_sec_buf_read_offset < v->init_sec_data_len) {
@@ -1851,7 +1991,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy",
+        "connection_pool", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
@@ -2183,6 +2324,8 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            ff_prefetch_free(&pls->prefetch);
+            av_freep(&pls->prefetched_data);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2244,6 +2387,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            av_freep(&cur->prefetched_data);
             ret = reopen_demux_for_component(s, cur);
             cur->is_restart_needed = 0;
         }
@@ -2282,6 +2426,7 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    av_freep(&pls->prefetched_data);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2378,6 +2523,8 @@ static const AVOption dash_options[] = {
         OFFSET(allowed_extensions), AV_OPT_TYPE_STRING,
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm"},
         INT_MIN, INT_MAX, FLAGS},
+    {"prefetch_segments", "Number of upcoming fragments of each representation to download in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
     {NULL}
 };
 
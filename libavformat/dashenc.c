@@ -46,6 +46,7 @@
 #include "internal.h"
 #include "isom.h"
 #include "os_support.h"
+#include "uploader.h"
 #include "url.h"
 #include "vpcc.h"
 #include "dash.h"
@@ -150,6 +151,9 @@ typedef struct DASHContext {
     int master_publish_rate;
     int nr_of_streams_to_flush;
     int nr_of_streams_flushed;
+    int upload_threads;
+    int upload_retries;
+    FFUploader *uploader;
 } DASHContext;
 
 static struct codec_string {
@@ -179,6 +183,15 @@ static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
+
+    /* with async uploads, files are written to memory and queued at close,
+     * only the failure of a previous upload is reported here */
+    if (c->uploader && http_base_proto) {
+        if ((err = ff_uploader_error(c->uploader)) < 0)
+            return err;
+        return avio_open_dyn_buf(pb);
+    }
+
     if (!*pb || !http_base_proto || !c->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
@@ -193,6 +206,8 @@ static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     return err;
 }
 
+static void set_http_options(AVDictionary **options, DASHContext *c);
+
 static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename) {
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
@@ -200,7 +215,19 @@ static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filenam
     if (!*pb)
         return;
 
-    if (!http_base_proto || !c->http_persistent) {
+    if (c->uploader && http_base_proto) {
+        /* manifests are only uploaded once the segments queued before are */
+        int flags = pb == &c->mpd_out || pb == &c->m3u8_out ? FF_UPLOADER_MANIFEST : 0;
+        AVDictionary *opts = NULL;
+        uint8_t *buf = NULL;
+        int size = avio_close_dyn_buf(*pb, &buf);
+
+        *pb = NULL;
+        set_http_options(&opts, c);
+        if (ff_uploader_add(c->uploader, filename, opts, buf, size, flags) < 0)
+            av_log(s, AV_LOG_ERROR, "Failed to queue upload of '%s'\n", filename);
+        av_dict_free(&opts);
+    } else if (!http_base_proto || !c->http_persistent) {
         ff_format_io_close(s, pb);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -577,6 +604,15 @@ static void dash_free(AVFormatContext *s)
         c->nb_as = 0;
     }
 
+    /* files opened for an async upload are dynamic buffers */
+    if (c->uploader) {
+        ff_uploader_free(&c->uploader);
+        ffio_free_dyn_buf(&c->mpd_out);
+        ffio_free_dyn_buf(&c->m3u8_out);
+        for (i = 0; c->streams && i < s->nb_streams; i++)
+            ffio_free_dyn_buf(&c->streams[i].out);
+    }
+
     if (!c->streams)
         return;
     for (i = 0; i < s->nb_streams; i++) {
@@ -1180,6 +1216,16 @@ static int dash_init(AVFormatContext *s)
         c->global_sidx = 0;
     }
 
+    if (c->upload_threads > 0 && ff_is_http_proto(s->url)) {
+        if (c->single_file || c->streaming) {
+            av_log(s, AV_LOG_WARNING, "Asynchronous uploads are not supported "
+                   "with single_file or streaming, disabling upload_threads\n");
+        } else if ((ret = ff_uploader_alloc(&c->uploader, s, c->upload_threads,
+                                            c->upload_retries, c->http_persistent)) < 0) {
+            return ret;
+        }
+    }
+
     av_strlcpy(c->dirname, s->url, sizeof(c->dirname));
     ptr = strrchr(c->dirname, '/');
     if (ptr) {
@@ -1293,7 +1339,7 @@ static int dash_init(AVFormatContext *s)
         if (!c->single_file) {
             if ((ret = avio_open_dyn_buf(&ctx->pb)) < 0)
                 return ret;
-            ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, &opts);
+            ret = dashenc_io_open(s, &os->out, filename, &opts);
         } else {
             ctx->url = av_strdup(filename);
             ret = avio_open2(&ctx->pb, filename, AVIO_FLAG_WRITE, NULL, &opts);
@@ -1500,7 +1546,8 @@ static void dashenc_delete_file(AVFormatContext *s, char *filename) {
         set_http_options(&http_opts, c);
         av_dict_set(&http_opts, "method", "DELETE", 0);
 
-        if (dashenc_io_open(s, &out, filename, &http_opts) < 0) {
+        /* deletions are not queued behind the async uploads */
+        if (s->io_open(s, &out, filename, AVIO_FLAG_WRITE, &http_opts) < 0) {
             av_log(s, AV_LOG_ERROR, "failed to delete %s\n", filename);
         }
 
@@ -1876,6 +1923,13 @@ static int dash_write_trailer(AVFormatContext *s)
         }
     }
 
+    /* wait for the queued uploads, only failures are reported here */
+    if (c->uploader) {
+        int ret = ff_uploader_flush(c->uploader);
+        if (ret < 0 && !c->ignore_io_errors)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -1936,6 +1990,8 @@ static const AVOption options[] = {
     { "ignore_io_errors", "Ignore IO errors during open and write. Useful for long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { "lhls", "Enable Low-latency HLS(Experimental). Adds #EXT-X-PREFETCH tag with current segment's URI", OFFSET(lhls), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { "master_m3u8_publish_rate", "Publish master playlist every after this many segment intervals", OFFSET(master_publish_rate), AV_OPT_TYPE_INT, {.i64 = 0}, 0, UINT_MAX, E},
+    { "upload_threads", "number of threads uploading segments and manifests over HTTP in the background, 0 to upload them synchronously", OFFSET(upload_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, E },
+    { "upload_retries", "number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, { .i64 = 2 }, 0, INT_MAX, E },
     { NULL },
 };
 
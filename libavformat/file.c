@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _DEFAULT_SOURCE
+
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
@@ -35,6 +37,17 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP || HAVE_IO_URING
+#include <sys/mman.h>
+#endif
+#if HAVE_IO_URING
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#if HAVE_IO_URING || HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -67,6 +80,10 @@
 
 /* standard file protocol */
 
+#if HAVE_IO_URING
+typedef struct FileUring FileUring;
+#endif
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -74,6 +91,17 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int io_uring;
+    int io_uring_depth;
+    int mmap;
+#if HAVE_IO_URING
+    FileUring *uring;
+#endif
+#if HAVE_MMAP
+    AVBufferRef *map;
+    int64_t map_size;
+    int64_t map_pos;
+#endif
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +112,9 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring", "use io_uring for asynchronous I/O", offsetof(FileContext, io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring_depth", "set the number of io_uring requests in flight", offsetof(FileContext, io_uring_depth), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, 64, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "read through a memory mapping of the file", offsetof(FileContext, mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -106,11 +137,484 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_IO_URING
+
+/* Reads and writes are split into blocks of this size, each a separate
+ * request, up to io_uring_depth of which are in flight at once. */
+#define URING_BLOCK_SIZE 262144
+
+enum FileUringState {
+    URING_FREE,
+    URING_FILL,             ///< being filled with data to write
+    URING_BUSY,             ///< request in flight
+    URING_DONE,             ///< request completed, len is valid
+};
+
+typedef struct FileUringBuf {
+    enum FileUringState state;
+    uint8_t *data;
+    int64_t pos;            ///< file offset of data
+    int size;               ///< size of the request
+    int len;                ///< result of the request
+} FileUringBuf;
+
+struct FileUring {
+    int fd;
+    int file;
+    int write;
+    int fixed;              ///< the buffers are registered with the kernel
+
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    atomic_uint *sq_tail, *cq_head, *cq_tail;
+    unsigned sq_mask, cq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    struct io_uring_cqe *cqes;
+    int to_submit;
+
+    uint8_t *data;
+    struct iovec *iov;
+    FileUringBuf *bufs;
+    int nb_bufs;
+    int head;               ///< buffer at the current position
+    int nb_used;            ///< buffers in use starting from head, for reads
+    int64_t pos;            ///< current position
+    int64_t next_pos;       ///< offset of the next read request
+    int read_off;           ///< offset of pos in the head buffer
+    int error;              ///< first failed write
+};
+
+static int uring_enter(FileUring *r, unsigned min_complete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, r->fd, r->to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        return AVERROR(errno);
+    r->to_submit -= ret;
+    return 0;
+}
+
+static void uring_queue(FileUring *r, int idx)
+{
+    FileUringBuf *b = &r->bufs[idx];
+    unsigned tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+    unsigned slot = tail & r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd        = r->file;
+    sqe->off       = b->pos;
+    sqe->user_data = idx;
+    if (r->fixed) {
+        sqe->opcode    = r->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->addr      = (uintptr_t)b->data;
+        sqe->len       = b->size;
+        sqe->buf_index = idx;
+    } else {
+        r->iov[idx].iov_len = b->size;
+        sqe->opcode    = r->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->addr      = (uintptr_t)&r->iov[idx];
+        sqe->len       = 1;
+    }
+    r->sq_array[slot] = slot;
+    atomic_store_explicit(r->sq_tail, tail + 1, memory_order_release);
+
+    b->state = URING_BUSY;
+    r->to_submit++;
+}
+
+static void uring_reap(FileUring *r)
+{
+    unsigned head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(r->cq_tail, memory_order_acquire);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+        FileUringBuf *b = &r->bufs[cqe->user_data];
+        b->len   = cqe->res;
+        b->state = URING_DONE;
+    }
+    atomic_store_explicit(r->cq_head, head, memory_order_release);
+}
+
+static int uring_wait(FileUring *r, FileUringBuf *b)
+{
+    int ret;
+
+    for (;;) {
+        uring_reap(r);
+        if (b->state != URING_BUSY)
+            return 0;
+        if ((ret = uring_enter(r, 1)) < 0)
+            return ret;
+    }
+}
+
+static int uring_write_done(FileContext *c, FileUringBuf *b)
+{
+    FileUring *r = c->uring;
+    int ret = uring_wait(r, b);
+
+    if (ret >= 0 && b->state == URING_DONE) {
+        int off = FFMAX(b->len, 0);
+        ret = b->len;
+        /* complete short writes synchronously, they are not expected on
+         * regular files */
+        while (ret >= 0 && off < b->size) {
+            ret = pwrite(c->fd, b->data + off, b->size - off, b->pos + off);
+            if (ret < 0)
+                ret = AVERROR(errno);
+            else
+                off += ret;
+        }
+    }
+    b->state = URING_FREE;
+    if (ret < 0 && !r->error)
+        r->error = ret;
+    return r->error;
+}
+
+/**
+ * Wait for all the requests in flight and drop the data read ahead, or
+ * write out all the data written so far.
+ */
+static int uring_flush(FileContext *c)
+{
+    FileUring *r = c->uring;
+    int i, ret = 0;
+
+    if (r->write && r->bufs[r->head].state == URING_FILL) {
+        uring_queue(r, r->head);
+        r->head = (r->head + 1) % r->nb_bufs;
+    }
+    for (i = 0; i < r->nb_bufs; i++) {
+        FileUringBuf *b = &r->bufs[(r->head + i) % r->nb_bufs];
+        if (r->write) {
+            ret = uring_write_done(c, b);
+        } else {
+            int err = uring_wait(r, b);
+            if (err < 0 && !ret)
+                ret = err;
+            b->state = URING_FREE;
+        }
+    }
+    r->head     = 0;
+    r->nb_used  = 0;
+    r->read_off = 0;
+    r->next_pos = r->pos;
+    return ret;
+}
+
+static void uring_free(FileContext *c)
+{
+    FileUring *r = c->uring;
+
+    if (r->bufs)
+        uring_flush(c);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ptr && r->cq_ptr != r->sq_ptr)
+        munmap(r->cq_ptr, r->cq_size);
+    if (r->sq_ptr)
+        munmap(r->sq_ptr, r->sq_size);
+    if (r->fd >= 0)
+        close(r->fd);
+    av_freep(&r->bufs);
+    av_freep(&r->iov);
+    av_freep(&r->data);
+    av_freep(&c->uring);
+}
+
+static int uring_init(URLContext *h, int write)
+{
+    FileContext *c = h->priv_data;
+    struct io_uring_params p = { 0 };
+    FileUring *r;
+    int i, ret;
+
+    r = c->uring = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->write   = write;
+    r->nb_bufs = c->io_uring_depth;
+
+    r->fd = syscall(__NR_io_uring_setup, r->nb_bufs, &p);
+    if (r->fd < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->sq_size = r->cq_size = FFMAX(r->sq_size, r->cq_size);
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        r->sq_ptr = NULL;
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    r->cq_ptr = r->sq_ptr;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            r->cq_ptr = NULL;
+            ret = AVERROR(errno);
+            goto fail;
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    r->sq_tail  = (atomic_uint *)((uint8_t *)r->sq_ptr + p.sq_off.tail);
+    r->sq_mask  = *(unsigned *)((uint8_t *)r->sq_ptr + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((uint8_t *)r->sq_ptr + p.sq_off.array);
+    r->cq_head  = (atomic_uint *)((uint8_t *)r->cq_ptr + p.cq_off.head);
+    r->cq_tail  = (atomic_uint *)((uint8_t *)r->cq_ptr + p.cq_off.tail);
+    r->cq_mask  = *(unsigned *)((uint8_t *)r->cq_ptr + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((uint8_t *)r->cq_ptr + p.cq_off.cqes);
+
+    r->data = av_malloc_array(r->nb_bufs, URING_BLOCK_SIZE);
+    r->iov  = av_malloc_array(r->nb_bufs, sizeof(*r->iov));
+    r->bufs = av_mallocz_array(r->nb_bufs, sizeof(*r->bufs));
+    if (!r->data || !r->iov || !r->bufs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < r->nb_bufs; i++) {
+        r->bufs[i].data     = r->data + i * URING_BLOCK_SIZE;
+        r->iov[i].iov_base  = r->bufs[i].data;
+        r->iov[i].iov_len   = URING_BLOCK_SIZE;
+    }
+
+    /* Registered buffers save mapping the pages for every request, but
+     * count against RLIMIT_MEMLOCK on older kernels. */
+    r->fixed = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS,
+                       r->iov, r->nb_bufs) >= 0;
+    if (!r->fixed)
+        av_log(h, AV_LOG_VERBOSE, "Could not register io_uring buffers: %s\n",
+               av_err2str(AVERROR(errno)));
+
+    r->file = c->fd;
+    r->pos = r->next_pos = lseek(c->fd, 0, SEEK_CUR);
+    if (r->pos < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    uring_free(c);
+    return ret;
+}
+
+static int uring_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    FileUring *r = c->uring;
+    FileUringBuf *b;
+    int ret;
+
+again:
+    b = &r->bufs[r->head];
+    /* keep all the buffers busy reading ahead */
+    while (r->nb_used < r->nb_bufs) {
+        int idx = (r->head + r->nb_used++) % r->nb_bufs;
+        r->bufs[idx].pos  = r->next_pos;
+        r->bufs[idx].size = URING_BLOCK_SIZE;
+        uring_queue(r, idx);
+        r->next_pos += URING_BLOCK_SIZE;
+    }
+    if (r->to_submit && (ret = uring_enter(r, 0)) < 0)
+        return ret;
+
+    if ((ret = uring_wait(r, b)) < 0)
+        return ret;
+    if (b->len <= r->read_off) {
+        /* End of file, error, or a seek past the end of a short read:
+         * restart reading ahead from the current position. */
+        ret = b->len < 0 ? b->len : AVERROR_EOF;
+        uring_flush(c);
+        if (b->len > 0)
+            goto again;
+        return ret;
+    }
+
+    size = FFMIN(size, b->len - r->read_off);
+    memcpy(buf, b->data + r->read_off, size);
+    r->read_off += size;
+    r->pos      += size;
+
+    if (r->read_off == b->len) {
+        if (b->len < b->size) {
+            /* a short read, the following requests are of no use */
+            uring_flush(c);
+        } else {
+            b->state = URING_FREE;
+            r->head  = (r->head + 1) % r->nb_bufs;
+            r->nb_used--;
+            r->read_off = 0;
+        }
+    }
+    return size;
+}
+
+static int uring_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    FileUring *r = c->uring;
+    int ret, done = 0;
+
+    while (done < size) {
+        FileUringBuf *b = &r->bufs[r->head];
+        int len;
+
+        if (b->state != URING_FILL) {
+            if ((ret = uring_write_done(c, b)) < 0)
+                return ret;
+            b->state = URING_FILL;
+            b->pos   = r->pos;
+            b->size  = 0;
+        }
+        len = FFMIN(size - done, URING_BLOCK_SIZE - b->size);
+        memcpy(b->data + b->size, buf + done, len);
+        b->size += len;
+        r->pos  += len;
+        done    += len;
+
+        if (b->size == URING_BLOCK_SIZE) {
+            uring_queue(r, r->head);
+            r->head = (r->head + 1) % r->nb_bufs;
+        }
+    }
+    if (r->to_submit && (ret = uring_enter(r, 0)) < 0)
+        return ret;
+    return r->error < 0 ? r->error : size;
+}
+
+static int64_t uring_seek(URLContext *h, int64_t pos, int whence)
+{
+    FileContext *c = h->priv_data;
+    FileUring *r = c->uring;
+    int64_t ret;
+
+    if (whence == SEEK_CUR) {
+        pos   += r->pos;
+        whence = SEEK_SET;
+    }
+    if (whence == SEEK_SET && pos == r->pos)
+        return pos;
+
+    if (whence == AVSEEK_SIZE) {
+        struct stat st;
+        if (r->write && (ret = uring_flush(c)) < 0)
+            return ret;
+        ret = fstat(c->fd, &st);
+        return ret < 0 ? AVERROR(errno) : st.st_size;
+    }
+
+    if (!r->write && whence == SEEK_SET && pos > r->pos && pos < r->next_pos) {
+        /* skip forward within the data read ahead */
+        while (pos >= r->bufs[r->head].pos + URING_BLOCK_SIZE) {
+            FileUringBuf *b = &r->bufs[r->head];
+            if ((ret = uring_wait(r, b)) < 0)
+                return ret;
+            b->state = URING_FREE;
+            r->head  = (r->head + 1) % r->nb_bufs;
+            r->nb_used--;
+        }
+        r->read_off = pos - r->bufs[r->head].pos;
+        r->pos      = pos;
+        return pos;
+    }
+
+    if ((ret = uring_flush(c)) < 0)
+        return ret;
+
+    ret = lseek(c->fd, pos, whence);
+    if (ret < 0)
+        return AVERROR(errno);
+    r->pos = r->next_pos = ret;
+    return ret;
+}
+
+#endif /* HAVE_IO_URING */
+
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    /* the size of the buffer is clipped to INT_MAX, the opaque is the real
+     * size of the mapping */
+    munmap(data, (uintptr_t)opaque);
+}
+
+static int file_map(URLContext *h, int64_t size)
+{
+    FileContext *c = h->priv_data;
+    void *data;
+
+    if (size <= 0 || size > SIZE_MAX)
+        return AVERROR(EINVAL);
+    data = mmap(NULL, size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (data == MAP_FAILED)
+        return AVERROR(errno);
+
+    c->map = av_buffer_create(data, FFMIN(size, INT_MAX), file_unmap,
+                              (void *)(uintptr_t)size, AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(data, size);
+        return AVERROR(ENOMEM);
+    }
+    c->map_size = size;
+    c->map_pos  = 0;
+    return 0;
+}
+
+static int file_get_mapping(URLContext *h, AVBufferRef **buf, int64_t *size)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    if (!(*buf = av_buffer_ref(c->map)))
+        return AVERROR(ENOMEM);
+    *size = c->map_size;
+    return 0;
+}
+#endif /* HAVE_MMAP */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_MMAP
+    if (c->map) {
+        if (c->map_pos >= c->map_size)
+            return AVERROR_EOF;
+        size = FFMIN(size, c->map_size - c->map_pos);
+        memcpy(buf, c->map->data + c->map_pos, size);
+        c->map_pos += size;
+        return size;
+    }
+#endif
+#if HAVE_IO_URING
+    if (c->uring)
+        return uring_read(h, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -124,10 +628,44 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_IO_URING
+    if (c->uring)
+        return uring_write(h, buf, size);
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
 
+#if HAVE_WRITEV
+static int file_writev(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    FileContext *c = h->priv_data;
+    struct iovec iov[URL_IOVEC_MAX];
+    int i, ret, size = 0;
+
+    for (i = 0; i < nb_vec && size < c->blocksize; i++) {
+        iov[i].iov_base = (void *)vec[i].data;
+        iov[i].iov_len  = FFMIN(vec[i].size, c->blocksize - size);
+        size += iov[i].iov_len;
+    }
+#if HAVE_IO_URING
+    if (c->uring) {
+        for (size = 0, nb_vec = i, i = 0; i < nb_vec; i++) {
+            ret = uring_write(h, iov[i].iov_base, iov[i].iov_len);
+            if (ret < 0)
+                return size ? size : ret;
+            size += ret;
+            if (ret < iov[i].iov_len)
+                break;
+        }
+        return size;
+    }
+#endif
+    ret = writev(c->fd, iov, i);
+    return (ret == -1) ? AVERROR(errno) : ret;
+}
+#endif
+
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
@@ -209,7 +747,7 @@ static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
     int access;
-    int fd;
+    int fd, ret, regular;
     struct stat st;
 
     av_strstart(filename, "file:", &filename);
@@ -233,7 +771,9 @@ static int file_open(URLContext *h, const char *filename, int flags)
         return AVERROR(errno);
     c->fd = fd;
 
-    h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+    ret = fstat(fd, &st);
+    h->is_streamed = !ret && S_ISFIFO(st.st_mode);
+    regular        = !ret && S_ISREG(st.st_mode);
 
     /* Buffer writes more than the default 32k to improve throughput especially
      * with networked file systems */
@@ -243,6 +783,37 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->mmap) {
+#if HAVE_MMAP
+        if (!regular || h->is_streamed || c->follow || flags & AVIO_FLAG_WRITE) {
+            av_log(h, AV_LOG_VERBOSE, "mmap is only used for reading seekable "
+                   "regular files\n");
+        } else if ((ret = file_map(h, st.st_size)) < 0) {
+            av_log(h, AV_LOG_WARNING, "Could not map the file, falling back "
+                   "to read(): %s\n", av_err2str(ret));
+        } else {
+            return 0;
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "mmap is not supported by this build\n");
+#endif
+    }
+
+    if (c->io_uring) {
+#if HAVE_IO_URING
+        if (!regular || c->follow ||
+            (flags & AVIO_FLAG_READ && flags & AVIO_FLAG_WRITE)) {
+            av_log(h, AV_LOG_VERBOSE, "io_uring is only used for reading or "
+                   "writing regular files\n");
+        } else if ((ret = uring_init(h, flags & AVIO_FLAG_WRITE)) < 0) {
+            av_log(h, AV_LOG_WARNING, "Could not set up io_uring, falling "
+                   "back to blocking I/O: %s\n", av_err2str(ret));
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "io_uring is not supported by this build\n");
+#endif
+    }
+
     return 0;
 }
 
@@ -252,6 +823,26 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if HAVE_IO_URING
+    if (c->uring)
+        return uring_seek(h, pos, whence);
+#endif
+#if HAVE_MMAP
+    if (c->map) {
+        if (whence == AVSEEK_SIZE)
+            return c->map_size;
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -266,6 +857,19 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+#if HAVE_MMAP
+    av_buffer_unref(&c->map);
+#endif
+#if HAVE_IO_URING
+    if (c->uring) {
+        int ret = uring_flush(c);
+        uring_free(c);
+        if (ret < 0) {
+            close(c->fd);
+            return ret;
+        }
+    }
+#endif
     return close(c->fd);
 }
 
@@ -358,9 +962,15 @@ const URLProtocol ff_file_protocol = {
     .url_open            = file_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+#if HAVE_MMAP
+    .url_get_mapping     = file_get_mapping,
+#endif
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -404,6 +1014,9 @@ const URLProtocol ff_pipe_protocol = {
     .url_open            = pipe_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
     .priv_data_size      = sizeof(FileContext),
@@ -38,6 +38,7 @@
 #include "internal.h"
 #include "avio_internal.h"
 #include "id3v2.h"
+#include "prefetch.h"
 
 #define INITIAL_BUFFER_SIZE 32768
 
@@ -98,6 +99,11 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    FFPrefetch *prefetch;
+    /* current segment, if it was downloaded by the prefetcher */
+    uint8_t *prefetched_data;
+    int prefetched_size;
+    int prefetched_pos;
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -212,6 +218,7 @@ typedef struct HLSContext {
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
     AVIOContext *playlist_pb;
 } HLSContext;
 
@@ -248,6 +255,8 @@ static void free_playlist_list(HLSContext *c)
     int i;
     for (i = 0; i < c->n_playlists; i++) {
         struct playlist *pls = c->playlists[i];
+        ff_prefetch_free(&pls->prefetch);
+        av_freep(&pls->prefetched_data);
         free_segment_list(pls);
         free_init_section_list(pls);
         av_freep(&pls->main_streams);
@@ -976,7 +985,15 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetched_data) {
+        ret = FFMIN(buf_size, pls->prefetched_size - pls->prefetched_pos);
+        if (ret <= 0)
+            return AVERROR_EOF;
+        memcpy(buf, pls->prefetched_data + pls->prefetched_pos, ret);
+        pls->prefetched_pos += ret;
+    } else {
+        ret = avio_read(pls->input, buf, buf_size);
+    }
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1268,6 +1285,76 @@ cleanup:
     return ret;
 }
 
+/* called on the prefetch thread, see FFPrefetchOpenFunc */
+static int prefetch_open(void *opaque, AVIOContext **pb, const char *url,
+                         int64_t offset, int64_t size, AVDictionary **opts)
+{
+    struct playlist *pls = opaque;
+    HLSContext *c = pls->parent->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+    int is_http = 0;
+
+    if (c->http_persistent)
+        av_dict_set(&tmp, "multiple_requests", "1", 0);
+
+    if (size >= 0) {
+        av_dict_set_int(&tmp, "offset", offset, 0);
+        av_dict_set_int(&tmp, "end_offset", offset + size, 0);
+    }
+
+    ret = open_url(pls->parent, pb, url, *opts, tmp, &is_http);
+    if (ret == 0 && !is_http && offset) {
+        int64_t seekret = avio_seek(*pb, offset, SEEK_SET);
+        if (seekret < 0) {
+            ret = seekret;
+            ff_format_io_close(pls->parent, pb);
+        }
+    }
+
+    av_dict_free(&tmp);
+    return ret;
+}
+
+/* Queue the segments following the current one for prefetching. */
+static void prefetch_next_segments(HLSContext *c, struct playlist *pls)
+{
+    int i, ret;
+
+    if (!c->prefetch_segments)
+        return;
+
+    if (!pls->prefetch) {
+        ret = ff_prefetch_alloc(&pls->prefetch, pls->parent, c->prefetch_segments,
+                                prefetch_open, pls, c->avio_opts,
+                                c->http_persistent);
+        if (ret < 0) {
+            av_log(pls->parent, AV_LOG_WARNING,
+                   "Unable to start segment prefetching: %s\n", av_err2str(ret));
+            c->prefetch_segments = 0;
+            return;
+        }
+    }
+
+    ff_prefetch_discard(pls->prefetch, pls->cur_seq_no + 1,
+                        pls->cur_seq_no + c->prefetch_segments);
+
+    for (i = 1; i <= c->prefetch_segments; i++) {
+        int n = pls->cur_seq_no - pls->start_seq_no + i;
+        struct segment *seg;
+
+        if (n >= pls->n_segments)
+            break;
+        seg = pls->segments[n];
+        /* encrypted segments need the key state of the demuxer thread */
+        if (seg->key_type != KEY_NONE)
+            continue;
+        if (ff_prefetch_add(pls->prefetch, pls->cur_seq_no + i, seg->url,
+                            seg->url_offset, seg->size) < 0)
+            break;
+    }
+}
+
 static int update_init_section(struct playlist *pls, struct segment *seg)
 {
     static const int max_init_section_size = 1024*1024;
@@ -1391,7 +1478,8 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if ((!v->input && !v->prefetched_data) ||
+        (c->http_persistent && v->input_read_done)) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1462,7 +1550,13 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (v->prefetch &&
+            ff_prefetch_get(v->prefetch, v->cur_seq_no, &v->prefetched_data,
+                            &v->prefetched_size) >= 0) {
+            v->prefetched_pos = 0;
+            v->cur_seg_offset = 0;
+            ret = 0;
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1480,9 +1574,11 @@ reload:
             goto reload;
         }
         just_opened = 1;
+
+        prefetch_next_segments(c, v);
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1492,7 +1588,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !c->prefetch_segments && !v->input_next_requested &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1525,7 +1621,10 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->prefetched_data) {
+        av_freep(&v->prefetched_data);
+        v->input_read_done = 1;
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -1663,7 +1762,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
     static const char * const opts[] = {
-        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy", NULL };
+        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy",
+        "connection_pool", NULL };
     const char * const * opt = opts;
     uint8_t *buf;
     int ret = 0;
@@ -2036,6 +2136,8 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            ff_prefetch_free(&pls->prefetch);
+            av_freep(&pls->prefetched_data);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2278,6 +2380,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        av_freep(&pls->prefetched_data);
         av_packet_unref(&pls->pkt);
         pls->pb.eof_reached = 0;
         /* Clear any buffered data */
@@ -2339,6 +2442,8 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of upcoming segments to download in the background",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
     {NULL}
 };
 
@@ -51,6 +51,7 @@
 #include "hlsplaylist.h"
 #include "internal.h"
 #include "os_support.h"
+#include "uploader.h"
 
 typedef enum {
     HLS_START_SEQUENCE_AS_START_NUMBER = 0,
@@ -67,6 +68,15 @@ typedef enum {
 #define LINE_BUFFER_SIZE MAX_URL_SIZE
 #define HLS_MICROSECOND_UNIT   1000000
 #define POSTFIX_PATTERN "_%d"
+#define HLS_PART_SEGMENTS 3 // number of segments whose parts are listed
+
+typedef struct HLSPart {
+    char *url;
+    double duration; /* in seconds */
+    int independent;
+
+    struct HLSPart *next;
+} HLSPart;
 
 typedef struct HLSSegment {
     char filename[MAX_URL_SIZE];
@@ -82,6 +92,8 @@ typedef struct HLSSegment {
     char key_uri[LINE_BUFFER_SIZE + 1];
     char iv_string[KEYSIZE*2 + 1];
 
+    HLSPart *parts;
+
     struct HLSSegment *next;
 } HLSSegment;
 
@@ -102,6 +114,7 @@ typedef enum HLSFlags {
     HLS_PERIODIC_REKEY = (1 << 12),
     HLS_INDEPENDENT_SEGMENTS = (1 << 13),
     HLS_I_FRAMES_ONLY = (1 << 14),
+    HLS_CAN_BLOCK_RELOAD = (1 << 15),
 } HLSFlags;
 
 typedef enum {
@@ -144,6 +157,14 @@ typedef struct VariantStream {
     HLSSegment *last_segment;
     HLSSegment *old_segments;
 
+    HLSPart *parts;       // parts of the segment being written
+    HLSPart *last_part;
+    int nb_parts;
+    AVIOContext *part_buf; // data of these parts, to be written to the segment
+    int64_t part_start_pts;
+    double parts_duration;
+    int part_independent;
+
     char *basename;
     char *vtt_basename;
     char *vtt_m3u8_name;
@@ -160,6 +181,7 @@ typedef struct VariantStream {
     CodecAttributeStatus attr_status;
     unsigned int nb_streams;
     int m3u8_created; /* status of media play-list creation */
+    struct VariantStream *shared; /* earlier variant with the same streams, whose segments and playlist are reused */
     int is_default; /* default status of audio group */
     char *language; /* audio lauguage name */
     char *agroup; /* audio group name */
@@ -181,6 +203,7 @@ typedef struct HLSContext {
 
     float time;            // Set by a private option.
     float init_time;       // Set by a private option.
+    float part_time;       // Set by a private option.
     int max_nb_segments;   // Set by a private option.
     int hls_delete_threshold; // Set by a private option.
 #if FF_API_HLS_WRAP
@@ -240,14 +263,45 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+    int upload_threads;
+    int upload_retries;
+    FFUploader *uploader;
 } HLSContext;
 
+static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSContext *c)
+{
+    int http_base_proto = ff_is_http_proto(s->url);
+
+    if (c->method) {
+        av_dict_set(options, "method", c->method, 0);
+    } else if (http_base_proto) {
+        av_dict_set(options, "method", "PUT", 0);
+    }
+    if (c->user_agent)
+        av_dict_set(options, "user_agent", c->user_agent, 0);
+    if (c->http_persistent)
+        av_dict_set_int(options, "multiple_requests", 1, 0);
+    if (c->timeout >= 0)
+        av_dict_set_int(options, "timeout", c->timeout, 0);
+    if (c->headers)
+        av_dict_set(options, "headers", c->headers, 0);
+}
+
 static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
                           AVDictionary **options)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
+
+    /* with async uploads, files are written to memory and queued at close,
+     * only the failure of a previous upload is reported here */
+    if (hls->uploader && http_base_proto) {
+        if ((err = ff_uploader_error(hls->uploader)) < 0)
+            return err;
+        return avio_open_dyn_buf(pb);
+    }
+
     if (!*pb || !http_base_proto || !hls->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
@@ -263,6 +317,22 @@ static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     return err;
 }
 
+static int hlsenc_upload(AVFormatContext *s, AVIOContext **pb, char *filename,
+                         int flags)
+{
+    HLSContext *hls = s->priv_data;
+    AVDictionary *options = NULL;
+    uint8_t *buffer = NULL;
+    int size, ret;
+
+    size = avio_close_dyn_buf(*pb, &buffer);
+    *pb = NULL;
+    set_http_options(s, &options, hls);
+    ret = ff_uploader_add(hls->uploader, filename, options, buffer, size, flags);
+    av_dict_free(&options);
+    return ret;
+}
+
 static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
 {
     HLSContext *hls = s->priv_data;
@@ -270,7 +340,9 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     int ret = 0;
     if (!*pb)
         return ret;
-    if (!http_base_proto || !hls->http_persistent || hls->key_info_file || hls->encrypt) {
+    if (hls->uploader && http_base_proto) {
+        return hlsenc_upload(s, pb, filename, 0);
+    } else if (!http_base_proto || !hls->http_persistent || hls->key_info_file || hls->encrypt) {
         ff_format_io_close(s, pb);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -284,23 +356,14 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     return ret;
 }
 
-static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSContext *c)
+/* Playlists are only uploaded once the segments queued before are. */
+static int hlsenc_io_close_playlist(AVFormatContext *s, AVIOContext **pb, char *filename)
 {
-    int http_base_proto = ff_is_http_proto(s->url);
+    HLSContext *hls = s->priv_data;
 
-    if (c->method) {
-        av_dict_set(options, "method", c->method, 0);
-    } else if (http_base_proto) {
-        av_dict_set(options, "method", "PUT", 0);
-    }
-    if (c->user_agent)
-        av_dict_set(options, "user_agent", c->user_agent, 0);
-    if (c->http_persistent)
-        av_dict_set_int(options, "multiple_requests", 1, 0);
-    if (c->timeout >= 0)
-        av_dict_set_int(options, "timeout", c->timeout, 0);
-    if (c->headers)
-        av_dict_set(options, "headers", c->headers, 0);
+    if (*pb && hls->uploader && filename && ff_is_http_proto(filename))
+        return hlsenc_upload(s, pb, filename, FF_UPLOADER_MANIFEST);
+    return hlsenc_io_close(s, pb, filename);
 }
 
 static void write_codec_attr(AVStream *st, VariantStream *vs)
@@ -483,6 +546,194 @@ static void reflush_dynbuf(VariantStream *vs, int *range_length)
 #define SEPARATOR '/'
 #endif
 
+static void write_init_section(AVFormatContext *s, VariantStream *vs)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
+    uint8_t *buffer = NULL;
+    int range_length;
+
+    range_length = avio_close_dyn_buf(oc->pb, &buffer);
+    avio_write(vs->out, buffer, range_length);
+    av_freep(&buffer);
+    vs->init_range_length = range_length;
+    avio_open_dyn_buf(&oc->pb);
+    vs->packets_written = 0;
+    vs->start_pos = range_length;
+    if (!byterange_mode) {
+        hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
+    }
+}
+
+static void hls_free_parts(HLSPart *p)
+{
+    HLSPart *part;
+
+    while (p) {
+        part = p;
+        p = p->next;
+        av_freep(&part->url);
+        av_freep(&part);
+    }
+}
+
+/* Name the index-th part of the current segment like the segment, with
+ * ".part<index>" inserted before the extension. */
+static char *get_part_url(HLSContext *hls, VariantStream *vs, int index)
+{
+    const char *url = vs->avf->url;
+    const char *proto = avio_find_protocol_name(url);
+    int len = strlen(url);
+    int ext, i;
+
+    if (proto && !strcmp(proto, "file") && (hls->flags & HLS_TEMP_FILE))
+        len -= 4; /* strip ".tmp" */
+    ext = len;
+    for (i = len - 1; i >= 0 && url[i] != '/' && url[i] != SEPARATOR; i--) {
+        if (url[i] == '.') {
+            ext = i;
+            break;
+        }
+    }
+
+    return av_asprintf("%.*s.part%d%.*s", ext, url, index, len - ext, url + ext);
+}
+
+static const char *get_part_filename(HLSContext *hls, HLSPart *part)
+{
+    return hls->use_localtime_mkdir ? part->url : av_basename(part->url);
+}
+
+/* Parts are only listed for the last segments of the playlist. */
+static void hls_drop_parts(AVFormatContext *s, HLSContext *hls,
+                           VariantStream *vs, HLSSegment *segment)
+{
+    const char *proto = avio_find_protocol_name(s->url);
+    AVDictionary *options = NULL;
+    AVIOContext *out = NULL;
+    HLSPart *part;
+
+    for (part = segment->parts; part && (hls->flags & HLS_DELETE_SEGMENTS); part = part->next) {
+        av_log(hls, AV_LOG_DEBUG, "deleting old part %s\n", part->url);
+        if (hls->method || (proto && !av_strcasecmp(proto, "http"))) {
+            av_dict_set(&options, "method", "DELETE", 0);
+            if (vs->avf->io_open(vs->avf, &out, part->url, AVIO_FLAG_WRITE, &options) >= 0)
+                ff_format_io_close(vs->avf, &out);
+            av_dict_free(&options);
+        } else if (unlink(part->url) < 0) {
+            av_log(hls, AV_LOG_ERROR, "failed to delete old part %s: %s\n",
+                   part->url, strerror(errno));
+        }
+    }
+    hls_free_parts(segment->parts);
+    segment->parts = NULL;
+}
+
+/* Write the data muxed since the last part boundary to a new part file. */
+static int hls_write_part(AVFormatContext *s, VariantStream *vs, double duration)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    AVDictionary *options = NULL;
+    const char *proto;
+    HLSPart *part;
+    uint8_t *buffer = NULL;
+    char *filename = NULL;
+    int use_temp_file, size, ret;
+
+    av_write_frame(oc, NULL); /* Flush any buffered data */
+    avio_flush(oc->pb);
+    size = avio_close_dyn_buf(oc->pb, &buffer);
+    if ((ret = avio_open_dyn_buf(&oc->pb)) < 0 || !size)
+        goto fail;
+
+    if (!vs->part_buf && (ret = avio_open_dyn_buf(&vs->part_buf)) < 0)
+        goto fail;
+    avio_write(vs->part_buf, buffer, size);
+
+    part = av_mallocz(sizeof(*part));
+    if (!part) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    part->url = get_part_url(hls, vs, vs->nb_parts);
+    if (!part->url) {
+        av_freep(&part);
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    part->duration    = duration;
+    part->independent = vs->part_independent;
+
+    if (!vs->parts)
+        vs->parts = part;
+    else
+        vs->last_part->next = part;
+    vs->last_part = part;
+    vs->nb_parts++;
+    vs->parts_duration += duration;
+
+    proto = avio_find_protocol_name(part->url);
+    use_temp_file = proto && !strcmp(proto, "file") && (hls->flags & HLS_TEMP_FILE);
+    filename = av_asprintf(use_temp_file ? "%s.tmp" : "%s", part->url);
+    if (!filename) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    set_http_options(s, &options, hls);
+    ret = hlsenc_io_open(s, &vs->out, filename, &options);
+    if (ret < 0) {
+        av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+               "Failed to open file '%s'\n", filename);
+        goto fail;
+    }
+    avio_write(vs->out, buffer, size);
+    ret = hlsenc_io_close(s, &vs->out, filename);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "upload part failed,"
+               " will retry with a new http session.\n");
+        ff_format_io_close(s, &vs->out);
+        if ((ret = hlsenc_io_open(s, &vs->out, filename, &options)) >= 0) {
+            avio_write(vs->out, buffer, size);
+            ret = hlsenc_io_close(s, &vs->out, filename);
+        }
+        if (ret < 0)
+            goto fail;
+    }
+    if (use_temp_file)
+        ff_rename(filename, part->url, s);
+
+fail:
+    if (ret < 0 && hls->ignore_io_errors && ret != AVERROR(ENOMEM))
+        ret = 0;
+    av_dict_free(&options);
+    av_freep(&filename);
+    av_free(buffer);
+    return ret;
+}
+
+/* Write the rest of the segment as its last part, and put the data of all
+ * its parts back into the muxer buffer, so that the whole segment is
+ * written as usual. */
+static int hls_finish_parts(AVFormatContext *s, VariantStream *vs, double duration)
+{
+    uint8_t *buffer = NULL;
+    int size, ret;
+
+    if ((ret = hls_write_part(s, vs, FFMAX(duration, 0))) < 0)
+        return ret;
+    if (!vs->part_buf)
+        return 0;
+
+    size = avio_close_dyn_buf(vs->part_buf, &buffer);
+    vs->part_buf = NULL;
+    avio_write(vs->avf->pb, buffer, size);
+    av_free(buffer);
+    return 0;
+}
+
 static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                                    VariantStream *vs)
 {
@@ -610,6 +861,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         av_freep(&path);
         previous_segment = segment;
         segment = previous_segment->next;
+        hls_free_parts(previous_segment->parts);
         av_freep(&previous_segment);
     }
 
@@ -1062,6 +1314,12 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
     en->keyframe_size     = vs->video_keyframe_size;
     en->next     = NULL;
     en->discont  = 0;
+    en->parts    = vs->parts;
+
+    vs->parts          = NULL;
+    vs->last_part      = NULL;
+    vs->nb_parts       = 0;
+    vs->parts_duration = 0;
 
     if (vs->discontinuity) {
         en->discont = 1;
@@ -1080,6 +1338,16 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
 
     vs->last_segment = en;
 
+    if (hls->part_time > 0) {
+        HLSSegment *seg;
+        int nb_segments = 0;
+
+        for (seg = vs->segments; seg; seg = seg->next)
+            nb_segments++;
+        for (seg = vs->segments; seg && nb_segments > HLS_PART_SEGMENTS; seg = seg->next, nb_segments--)
+            hls_drop_parts(s, hls, vs, seg);
+    }
+
     // EVENT or VOD playlists imply sliding window cannot be used
     if (hls->pl_type != PLAYLIST_TYPE_NONE)
         hls->max_nb_segments = 0;
@@ -1088,6 +1356,7 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
         en = vs->segments;
         vs->initial_prog_date_time += en->duration;
         vs->segments = en->next;
+        hls_drop_parts(s, hls, vs, en);
         if (en && hls->flags & HLS_DELETE_SEGMENTS &&
 #if FF_API_HLS_WRAP
                 !(hls->flags & HLS_SINGLE_FILE || hls->wrap)) {
@@ -1208,6 +1477,7 @@ static void hls_free_segments(HLSSegment *p)
     while (p) {
         en = p;
         p = p->next;
+        hls_free_parts(en->parts);
         av_freep(&en);
     }
 }
@@ -1407,7 +1677,7 @@ static int create_master_playlist(AVFormatContext *s,
 fail:
     if (ret >=0)
         hls->master_m3u8_created = 1;
-    hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
+    hlsenc_io_close_playlist(s, &hls->m3u8_out, temp_filename);
     if (use_temp_file)
         ff_rename(temp_filename, hls->master_m3u8_url, s);
 
@@ -1418,6 +1688,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 {
     HLSContext *hls = s->priv_data;
     HLSSegment *en;
+    HLSPart *part;
     int target_duration = 0;
     int ret = 0;
     char temp_filename[MAX_URL_SIZE];
@@ -1475,6 +1746,8 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     if (vs->has_video && (hls->flags & HLS_INDEPENDENT_SEGMENTS)) {
         avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-INDEPENDENT-SEGMENTS\n");
     }
+    if (hls->part_time > 0)
+        ff_hls_write_server_control(vs->out, hls->flags & HLS_CAN_BLOCK_RELOAD, hls->part_time);
     for (en = vs->segments; en; en = en->next) {
         if ((hls->encrypt || hls->key_info_file) && (!key_uri || strcmp(en->key_uri, key_uri) ||
                                     av_strcasecmp(en->iv_string, iv_string))) {
@@ -1491,7 +1764,14 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
                                    hls->flags & HLS_SINGLE_FILE, vs->init_range_length, 0);
         }
 
-        ret = ff_hls_write_file_entry(byterange_mode ? hls->m3u8_out : vs->out, en->discont, byterange_mode,
+        /* the parts of a segment precede it, after its discontinuity */
+        if (en->parts && en->discont)
+            avio_printf(vs->out, "#EXT-X-DISCONTINUITY\n");
+        for (part = en->parts; part; part = part->next)
+            ff_hls_write_part(vs->out, part->duration, vs->baseurl,
+                              get_part_filename(hls, part), part->independent);
+
+        ret = ff_hls_write_file_entry(byterange_mode ? hls->m3u8_out : vs->out, en->discont && !en->parts, byterange_mode,
                                       en->duration, hls->flags & HLS_ROUND_DURATIONS,
                                       en->size, en->pos, vs->baseurl,
                                       en->filename, prog_date_time_p, en->keyframe_size, en->keyframe_pos, hls->flags & HLS_I_FRAMES_ONLY);
@@ -1500,6 +1780,22 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
         }
     }
 
+    if (hls->part_time > 0 && !last) {
+        HLSPart next = { 0 };
+
+        for (part = vs->parts; part; part = part->next)
+            ff_hls_write_part(vs->out, part->duration, vs->baseurl,
+                              get_part_filename(hls, part), part->independent);
+
+        next.url = get_part_url(hls, vs, vs->nb_parts);
+        if (!next.url) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ff_hls_write_preload_hint(vs->out, vs->baseurl, get_part_filename(hls, &next));
+        av_freep(&next.url);
+    }
+
     if (last && (hls->flags & HLS_OMIT_ENDLIST)==0)
         ff_hls_write_end_list(byterange_mode ? hls->m3u8_out : vs->out);
 
@@ -1528,11 +1824,11 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
 fail:
     av_dict_free(&options);
-    ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
+    ret = hlsenc_io_close_playlist(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
     if (ret < 0) {
         return ret;
     }
-    hlsenc_io_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
+    hlsenc_io_close_playlist(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
     if (use_temp_file) {
         ff_rename(temp_filename, vs->m3u8_name, s);
         if (vs->vtt_m3u8_name)
@@ -1980,16 +2276,6 @@ static int parse_variant_stream_mapstring(AVFormatContext *s)
                         return AVERROR(EINVAL);
                     }
                 }
-                for (j = 0; nb_varstreams > 1 && j < nb_varstreams - 1; j++) {
-                    for (i = 0; i < hls->var_streams[j].nb_streams; i++) {
-                        if (hls->var_streams[j].streams[i] == s->streams[stream_index]) {
-                            av_log(s, AV_LOG_ERROR, "Same elementary stream found more than once "
-                                   "in two different variant definitions #%d and #%d\n",
-                                   j, nb_varstreams - 1);
-                            return AVERROR(EINVAL);
-                        }
-                    }
-                }
                 vs->streams[nb_streams++] = s->streams[stream_index];
             } else {
                 av_log(s, AV_LOG_ERROR, "Unable to map stream at %s\n", keyval);
@@ -1997,6 +2283,33 @@ static int parse_variant_stream_mapstring(AVFormatContext *s)
             }
         }
     }
+
+    /* An elementary stream can be part of several variant streams. Variant
+     * streams made of the same elementary streams, e.g. an audio rendition
+     * listed in several audio groups, only write one set of segments and one
+     * media playlist, which the master playlist refers to for all of them. */
+    for (i = 1; i < hls->nb_varstreams; i++) {
+        vs = &hls->var_streams[i];
+        for (j = 0; j < i && !vs->shared; j++) {
+            VariantStream *vs_prev = &hls->var_streams[j];
+            int k, l;
+
+            if (vs_prev->shared || vs_prev->nb_streams != vs->nb_streams)
+                continue;
+            for (k = 0; k < vs->nb_streams; k++) {
+                for (l = 0; l < vs_prev->nb_streams; l++)
+                    if (vs_prev->streams[l] == vs->streams[k])
+                        break;
+                if (l == vs_prev->nb_streams)
+                    break;
+            }
+            if (k == vs->nb_streams) {
+                av_log(s, AV_LOG_VERBOSE, "Variant stream #%d has the same streams as #%d, "
+                       "reusing its segments\n", i, j);
+                vs->shared = vs_prev;
+            }
+        }
+    }
     av_log(s, AV_LOG_DEBUG, "Number of variant streams %d\n",
             hls->nb_varstreams);
 
@@ -2177,14 +2490,21 @@ static int hls_write_header(AVFormatContext *s)
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
-        ret = avformat_write_header(vs->avf, NULL);
-        if (ret < 0)
-            return ret;
+        if (!vs->shared) {
+            ret = avformat_write_header(vs->avf, NULL);
+            if (ret < 0)
+                return ret;
+        }
         //av_assert0(s->nb_streams == hls->avf->nb_streams);
         for (j = 0; j < vs->nb_streams; j++) {
             AVStream *inner_st;
             AVStream *outer_st = vs->streams[j];
 
+            if (vs->shared) {
+                write_codec_attr(outer_st, vs);
+                continue;
+            }
+
             if (hls->max_seg_size > 0) {
                 if ((outer_st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) &&
                     (outer_st->codecpar->bit_rate > hls->max_seg_size)) {
@@ -2223,46 +2543,40 @@ static int hls_write_header(AVFormatContext *s)
     return ret;
 }
 
-static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
+static int hls_update_window(AVFormatContext *s, VariantStream *vs)
+{
+    int ret;
+
+    if ((ret = hls_window(s, 0, vs)) < 0) {
+        av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
+        ff_format_io_close(s, &vs->out);
+        vs->out = NULL;
+        ret = hls_window(s, 0, vs);
+    }
+    return ret;
+}
+
+/**
+ * Write a packet to one of the variant streams containing its stream.
+ *
+ * @param split decision to start a new segment at this packet, taken by the
+ *              first variant stream using the stream of the packet as
+ *              reference stream and followed by the others, or -1
+ */
+static int hls_write_variant_packet(AVFormatContext *s, VariantStream *vs,
+                                    AVFormatContext *oc, int stream_index,
+                                    AVPacket *pkt, int *split)
 {
     HLSContext *hls = s->priv_data;
-    AVFormatContext *oc = NULL;
     AVStream *st = s->streams[pkt->stream_index];
     int64_t end_pts = 0;
     int is_ref_pkt = 1;
-    int ret = 0, can_split = 1, i, j;
-    int stream_index = 0;
+    int ret = 0, can_split = 1, do_split;
     int range_length = 0;
     const char *proto = NULL;
     int use_temp_file = 0;
-    uint8_t *buffer = NULL;
-    VariantStream *vs = NULL;
     char *old_filename = NULL;
 
-    for (i = 0; i < hls->nb_varstreams; i++) {
-        vs = &hls->var_streams[i];
-        for (j = 0; j < vs->nb_streams; j++) {
-            if (vs->streams[j] == st) {
-                if ( st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE ) {
-                    oc = vs->vtt_avf;
-                    stream_index = 0;
-                } else {
-                    oc = vs->avf;
-                    stream_index = j;
-                }
-                break;
-            }
-        }
-
-        if (oc)
-            break;
-    }
-
-    if (!oc) {
-        av_log(s, AV_LOG_ERROR, "Unable to find mapping variant stream\n");
-        return AVERROR(ENOMEM);
-    }
-
     end_pts = hls->recording_time * vs->number;
 
     if (vs->sequence - vs->nb_entries > hls->start_sequence && hls->init_time > 0) {
@@ -2285,6 +2599,11 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
     if (pkt->pts == AV_NOPTS_VALUE)
         is_ref_pkt = can_split = 0;
 
+    if (is_ref_pkt && vs->part_start_pts == AV_NOPTS_VALUE) {
+        vs->part_start_pts   = pkt->pts;
+        vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+    }
+
     if (is_ref_pkt) {
         if (vs->end_pts == AV_NOPTS_VALUE)
             vs->end_pts = pkt->pts;
@@ -2304,28 +2623,33 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 
     }
 
-    if (vs->packets_written && can_split && av_compare_ts(pkt->pts - vs->start_pts, st->time_base,
-                                                          end_pts, AV_TIME_BASE_Q) >= 0) {
+    if (is_ref_pkt && *split >= 0) {
+        do_split = *split && vs->packets_written;
+    } else {
+        do_split = vs->packets_written && can_split &&
+                   av_compare_ts(pkt->pts - vs->start_pts, st->time_base,
+                                 end_pts, AV_TIME_BASE_Q) >= 0;
+        if (is_ref_pkt)
+            *split = do_split;
+    }
+
+    if (do_split) {
         int64_t new_start_pos;
         int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
 
+        if (hls->part_time > 0 && (hls->segment_type != SEGMENT_TYPE_FMP4 || vs->init_range_length)) {
+            ret = hls_finish_parts(s, vs, vs->duration - vs->parts_duration);
+            if (ret < 0)
+                return ret;
+        }
+
         av_write_frame(oc, NULL); /* Flush any buffered data */
         new_start_pos = avio_tell(oc->pb);
         vs->size = new_start_pos - vs->start_pos;
         avio_flush(oc->pb);
         if (hls->segment_type == SEGMENT_TYPE_FMP4) {
-            if (!vs->init_range_length) {
-                range_length = avio_close_dyn_buf(oc->pb, &buffer);
-                avio_write(vs->out, buffer, range_length);
-                av_freep(&buffer);
-                vs->init_range_length = range_length;
-                avio_open_dyn_buf(&oc->pb);
-                vs->packets_written = 0;
-                vs->start_pos = range_length;
-                if (!byterange_mode) {
-                    hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
-                }
-            }
+            if (!vs->init_range_length)
+                write_init_section(s, vs);
         }
         if (!byterange_mode) {
             if (vs->vtt_avf) {
@@ -2417,7 +2741,8 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
 
         // if we're building a VOD playlist, skip writing the manifest multiple times, and just wait until the end
-        if (hls->pl_type != PLAYLIST_TYPE_VOD) {
+        // with parts, it is written once the next segment is started, for its preload hint
+        if (hls->pl_type != PLAYLIST_TYPE_VOD && hls->part_time <= 0) {
             if ((ret = hls_window(s, 0, vs)) < 0) {
                 av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
                 ff_format_io_close(s, &vs->out);
@@ -2455,6 +2780,36 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
             return ret;
         }
 
+        if (hls->part_time > 0) {
+            if (is_ref_pkt) {
+                vs->part_start_pts   = pkt->pts;
+                vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+            }
+            if ((ret = hls_update_window(s, vs)) < 0)
+                return ret;
+        }
+    } else if (hls->part_time > 0 && vs->packets_written && is_ref_pkt && oc == vs->avf &&
+               av_compare_ts(pkt->pts + pkt->duration - vs->part_start_pts, st->time_base,
+                             hls->part_time * AV_TIME_BASE, AV_TIME_BASE_Q) > 0) {
+        /* Cut a part before the packet which would make it exceed the part
+         * target duration. The fMP4 init section is written first, as soon
+         * as the muxer has seen data for all streams. */
+        if (hls->segment_type == SEGMENT_TYPE_FMP4 && !vs->init_range_length) {
+            av_write_frame(oc, NULL);
+            avio_flush(oc->pb);
+            if (avio_tell(oc->pb) > 0)
+                write_init_section(s, vs);
+        }
+        if (hls->segment_type != SEGMENT_TYPE_FMP4 || vs->init_range_length) {
+            ret = hls_write_part(s, vs, (double)(pkt->pts - vs->part_start_pts) *
+                                        st->time_base.num / st->time_base.den);
+            if (ret < 0)
+                return ret;
+            vs->part_start_pts   = pkt->pts;
+            vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+            if ((ret = hls_update_window(s, vs)) < 0)
+                return ret;
+        }
     }
 
     vs->packets_written++;
@@ -2473,6 +2828,49 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
     return ret;
 }
 
+static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    HLSContext *hls = s->priv_data;
+    AVStream *st = s->streams[pkt->stream_index];
+    int ret, i, j, split = -1, found = 0;
+
+    for (i = 0; i < hls->nb_varstreams; i++) {
+        VariantStream *vs = &hls->var_streams[i];
+
+        if (vs->shared)
+            continue;
+        for (j = 0; j < vs->nb_streams; j++) {
+            if (vs->streams[j] == st) {
+                AVFormatContext *oc;
+                int stream_index;
+
+                if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+                    oc = vs->vtt_avf;
+                    stream_index = 0;
+                } else {
+                    oc = vs->avf;
+                    stream_index = j;
+                }
+                if (!oc)
+                    break;
+
+                found = 1;
+                ret = hls_write_variant_packet(s, vs, oc, stream_index, pkt, &split);
+                if (ret < 0)
+                    return ret;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        av_log(s, AV_LOG_ERROR, "Unable to find mapping variant stream\n");
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
 static void hls_free_variant_streams(struct HLSContext *hls)
 {
     int i = 0;
@@ -2496,6 +2894,8 @@ static void hls_free_variant_streams(struct HLSContext *hls)
 
         hls_free_segments(vs->segments);
         hls_free_segments(vs->old_segments);
+        hls_free_parts(vs->parts);
+        ffio_free_dyn_buf(&vs->part_buf);
         av_freep(&vs->m3u8_name);
         av_freep(&vs->streams);
         av_freep(&vs->agroup);
@@ -2523,6 +2923,8 @@ static int hls_write_trailer(struct AVFormatContext *s)
     for (i = 0; i < hls->nb_varstreams; i++) {
         char *filename = NULL;
         vs = &hls->var_streams[i];
+        if (vs->shared)
+            continue;
         oc = vs->avf;
         vtt_oc = vs->vtt_avf;
         old_filename = av_strdup(oc->url);
@@ -2559,11 +2961,16 @@ static int hls_write_trailer(struct AVFormatContext *s)
                 vs->start_pos = range_length;
                 byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
                 if (!byterange_mode) {
-                    ff_format_io_close(s, &vs->out);
                     hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
+                    ff_format_io_close(s, &vs->out);
                 }
             }
         }
+        if (hls->part_time > 0) {
+            ret = hls_finish_parts(s, vs, vs->duration + vs->dpp - vs->parts_duration);
+            if (ret < 0)
+                goto failed;
+        }
         if (!(hls->flags & HLS_SINGLE_FILE)) {
             set_http_options(s, &options, hls);
             ret = hlsenc_io_open(s, &vs->out, filename, &options);
@@ -2624,6 +3031,7 @@ failed:
             if (vtt_oc->pb)
                 av_write_trailer(vtt_oc);
             vs->size = avio_tell(vs->vtt_avf->pb) - vs->start_pos;
+            hlsenc_io_close(s, &vtt_oc->pb, vtt_oc->url);
             ff_format_io_close(s, &vtt_oc->pb);
         }
         ret = hls_window(s, 1, vs);
@@ -2637,6 +3045,15 @@ failed:
         av_free(old_filename);
     }
 
+    /* wait for the queued uploads, only failures are reported here */
+    ret = 0;
+    if (hls->uploader) {
+        ret = ff_uploader_flush(hls->uploader);
+        if (hls->ignore_io_errors)
+            ret = 0;
+        ff_uploader_free(&hls->uploader);
+    }
+
     hls_free_variant_streams(hls);
 
     for (i = 0; i < hls->nb_ccstreams; i++) {
@@ -2652,7 +3069,7 @@ failed:
     av_freep(&hls->var_streams);
     av_freep(&hls->cc_streams);
     av_freep(&hls->master_m3u8_url);
-    return 0;
+    return ret;
 }
 
 
@@ -2742,6 +3159,24 @@ static int hls_init(AVFormatContext *s)
         av_log(hls, AV_LOG_DEBUG, "start_number evaluated to %"PRId64"\n", hls->start_sequence);
     }
 
+    if (hls->part_time > 0 &&
+        ((hls->flags & (HLS_SINGLE_FILE | HLS_I_FRAMES_ONLY)) || hls->max_seg_size > 0 ||
+         hls->key_info_file || hls->encrypt || hls->pl_type == PLAYLIST_TYPE_VOD)) {
+        av_log(s, AV_LOG_WARNING, "Partial segments are not supported with byte range, "
+               "encrypted or VOD playlists, disabling hls_part_time\n");
+        hls->part_time = 0;
+    }
+
+    if (hls->upload_threads > 0 && ff_is_http_proto(s->url)) {
+        if ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0) {
+            av_log(s, AV_LOG_WARNING, "Asynchronous uploads are not supported "
+                   "with byte range playlists, disabling upload_threads\n");
+        } else if ((ret = ff_uploader_alloc(&hls->uploader, s, hls->upload_threads,
+                                            hls->upload_retries, hls->http_persistent)) < 0) {
+            goto fail;
+        }
+    }
+
     hls->recording_time = (hls->init_time ? hls->init_time : hls->time) * AV_TIME_BASE;
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
@@ -2753,6 +3188,7 @@ static int hls_init(AVFormatContext *s)
         vs->sequence       = hls->start_sequence;
         vs->start_pts      = AV_NOPTS_VALUE;
         vs->end_pts      = AV_NOPTS_VALUE;
+        vs->part_start_pts = AV_NOPTS_VALUE;
         vs->current_segment_final_filename_fmt[0] = '\0';
 
         if (hls->flags & HLS_SPLIT_BY_TIME && hls->flags & HLS_INDEPENDENT_SEGMENTS) {
@@ -2779,6 +3215,17 @@ static int hls_init(AVFormatContext *s)
             vs->has_subtitle += vs->streams[j]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE;
         }
 
+        if (vs->shared) {
+            av_freep(&vs->m3u8_name);
+            vs->m3u8_name = av_strdup(vs->shared->m3u8_name);
+            if (!vs->m3u8_name) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            vs->m3u8_created = 1;
+            continue;
+        }
+
         if (vs->has_video > 1)
             av_log(s, AV_LOG_WARNING, "More than a single video stream present, expect issues decoding it.\n");
         if (hls->segment_type == SEGMENT_TYPE_FMP4) {
@@ -2962,6 +3409,7 @@ fail:
         av_freep(&hls->var_streams);
         av_freep(&hls->cc_streams);
         av_freep(&hls->master_m3u8_url);
+        ff_uploader_free(&hls->uploader);
     }
 
     return ret;
@@ -2973,6 +3421,7 @@ static const AVOption options[] = {
     {"start_number",  "set first number in the sequence",        OFFSET(start_sequence),AV_OPT_TYPE_INT64,  {.i64 = 0},     0, INT64_MAX, E},
     {"hls_time",      "set segment length in seconds",           OFFSET(time),    AV_OPT_TYPE_FLOAT,  {.dbl = 2},     0, FLT_MAX, E},
     {"hls_init_time", "set segment length in seconds at init list",           OFFSET(init_time),    AV_OPT_TYPE_FLOAT,  {.dbl = 0},     0, FLT_MAX, E},
+    {"hls_part_time", "set partial segment length in seconds, for low-latency HLS", OFFSET(part_time), AV_OPT_TYPE_FLOAT, {.dbl = 0}, 0, FLT_MAX, E},
     {"hls_list_size", "set maximum number of playlist entries",  OFFSET(max_nb_segments),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_delete_threshold", "set number of unreferenced segments to keep before deleting",  OFFSET(hls_delete_threshold),    AV_OPT_TYPE_INT,    {.i64 = 1},     1, INT_MAX, E},
     {"hls_ts_options","set hls mpegts list of options for the container format used for hls", OFFSET(format_options), AV_OPT_TYPE_DICT, {.str = NULL},  0, 0,    E},
@@ -3010,6 +3459,7 @@ static const AVOption options[] = {
     {"periodic_rekey", "reload keyinfo file periodically for re-keying", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_PERIODIC_REKEY }, 0, UINT_MAX,   E, "flags"},
     {"independent_segments", "add EXT-X-INDEPENDENT-SEGMENTS, whenever applicable", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_INDEPENDENT_SEGMENTS }, 0, UINT_MAX, E, "flags"},
     {"iframes_only", "add EXT-X-I-FRAMES-ONLY, whenever applicable", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_I_FRAMES_ONLY }, 0, UINT_MAX, E, "flags"},
+    {"can_block_reload", "advertise blocking playlist reloads with partial segments", 0, AV_OPT_TYPE_CONST, { .i64 = HLS_CAN_BLOCK_RELOAD }, 0, UINT_MAX, E, "flags"},
 #if FF_API_HLS_USE_LOCALTIME
     {"use_localtime", "set filename expansion with strftime at segment creation(will be deprecated )", OFFSET(use_localtime), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
 #endif
@@ -3035,6 +3485,8 @@ static const AVOption options[] = {
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
+    {"upload_threads", "number of threads uploading segments and playlists over HTTP in the background, 0 to upload them synchronously", OFFSET(upload_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, E },
+    {"upload_retries", "number of times a failed background upload is retried", OFFSET(upload_retries), AV_OPT_TYPE_INT, { .i64 = 2 }, 0, INT_MAX, E },
     { NULL },
 };
 
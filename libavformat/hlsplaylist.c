@@ -161,6 +161,38 @@ int ff_hls_write_file_entry(AVIOContext *out, int insert_discont,
     return 0;
 }
 
+void ff_hls_write_server_control(AVIOContext *out, int can_block_reload,
+                                 double part_target) {
+    if (!out)
+        return;
+    /* Clients must not start playback closer than three part durations
+     * from the live edge. */
+    avio_printf(out, "#EXT-X-SERVER-CONTROL:");
+    if (can_block_reload)
+        avio_printf(out, "CAN-BLOCK-RELOAD=YES,");
+    avio_printf(out, "PART-HOLD-BACK=%f\n", 3 * part_target);
+    avio_printf(out, "#EXT-X-PART-INF:PART-TARGET=%f\n", part_target);
+}
+
+void ff_hls_write_part(AVIOContext *out, double duration, char *baseurl,
+                       const char *filename, int independent) {
+    if (!out || !filename)
+        return;
+    avio_printf(out, "#EXT-X-PART:DURATION=%f,URI=\"%s%s\"", duration,
+                baseurl ? baseurl : "", filename);
+    if (independent)
+        avio_printf(out, ",INDEPENDENT=YES");
+    avio_printf(out, "\n");
+}
+
+void ff_hls_write_preload_hint(AVIOContext *out, char *baseurl,
+                               const char *filename) {
+    if (!out || !filename)
+        return;
+    avio_printf(out, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s%s\"\n",
+                baseurl ? baseurl : "", filename);
+}
+
 void ff_hls_write_end_list (AVIOContext *out) {
     if (!out)
         return;
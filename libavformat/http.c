@@ -30,6 +30,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -50,6 +51,8 @@
 #define HTTP_SINGLE   1
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
+#define POOL_SIZE     16
+#define POOL_MAX_IDLE (60 * 1000000)
 #define WHITESPACES " \n\t\r"
 typedef enum {
     LOWER_PROTO,
@@ -126,6 +129,9 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    int connection_pool;
+    /* key identifying the lower protocol connection in the pool */
+    char *pool_key;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -168,6 +174,7 @@ static const AVOption options[] = {
     { "listen", "listen on HTTP", OFFSET(listen), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 2, D | E },
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
+    { "connection_pool", "reuse idle persistent connections across contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { NULL }
 };
 
@@ -187,6 +194,121 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+typedef struct HTTPPoolEntry {
+    char *key;
+    URLContext *hd;
+    AVIOInterruptCB interrupt_callback;
+    int64_t idle_since;
+} HTTPPoolEntry;
+
+/* Idle persistent connections, shared by all the contexts of the process. */
+static HTTPPoolEntry pool[POOL_SIZE];
+static int pool_nb;
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+
+static char *pool_make_key(const char *lower_url, AVDictionary *options)
+{
+    char *opts = NULL, *key;
+
+    if (av_dict_get_string(options, &opts, '=', ',') < 0)
+        return NULL;
+    key = av_asprintf("%s|%s", lower_url, opts);
+    av_free(opts);
+    return key;
+}
+
+static void pool_remove(int i, HTTPPoolEntry *entry)
+{
+    *entry = pool[i];
+    pool[i] = pool[--pool_nb];
+}
+
+static void pool_entry_free(HTTPPoolEntry *entry)
+{
+    av_freep(&entry->key);
+    ffurl_closep(&entry->hd);
+}
+
+/**
+ * An idle connection must not have anything to read: if it has, the server
+ * closed it or sent unexpected data, it cannot be reused.
+ */
+static int pool_connection_alive(URLContext *hd)
+{
+    struct pollfd p = { ffurl_get_file_handle(hd), POLLIN, 0 };
+
+    return p.fd < 0 || poll(&p, 1, 0) == 0;
+}
+
+/**
+ * Take an idle connection to the given key, opened with the same interrupt
+ * callback, out of the pool.
+ */
+static URLContext *pool_take(const char *key, const AVIOInterruptCB *cb)
+{
+    HTTPPoolEntry entry;
+    int64_t now = av_gettime_relative();
+    int i;
+
+    for (;;) {
+        ff_mutex_lock(&pool_mutex);
+        for (i = 0; i < pool_nb; i++)
+            if (!strcmp(pool[i].key, key) &&
+                pool[i].interrupt_callback.callback == cb->callback &&
+                pool[i].interrupt_callback.opaque   == cb->opaque)
+                break;
+        if (i == pool_nb) {
+            ff_mutex_unlock(&pool_mutex);
+            return NULL;
+        }
+        pool_remove(i, &entry);
+        ff_mutex_unlock(&pool_mutex);
+
+        if (now - entry.idle_since < POOL_MAX_IDLE &&
+            pool_connection_alive(entry.hd)) {
+            av_free(entry.key);
+            return entry.hd;
+        }
+        pool_entry_free(&entry);
+    }
+}
+
+static void pool_put(char *key, URLContext *hd, const AVIOInterruptCB *cb)
+{
+    HTTPPoolEntry entry = { key, hd, *cb, av_gettime_relative() }, old = { 0 };
+    int i, oldest = 0;
+
+    ff_mutex_lock(&pool_mutex);
+    if (pool_nb == POOL_SIZE) {
+        for (i = 1; i < pool_nb; i++)
+            if (pool[i].idle_since < pool[oldest].idle_since)
+                oldest = i;
+        pool_remove(oldest, &old);
+    }
+    pool[pool_nb++] = entry;
+    ff_mutex_unlock(&pool_mutex);
+
+    pool_entry_free(&old);
+}
+
+/**
+ * Check whether the current response has been read entirely, leaving the
+ * connection ready for a new request.
+ */
+static int http_connection_reusable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if (!s->hd || !s->pool_key || s->willclose || (h->flags & AVIO_FLAG_WRITE) ||
+        s->http_code < 200 || s->http_code >= 300 || s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    if (s->end_off)
+        return s->http_code == 206 && s->off == FFMIN(s->end_off, s->filesize);
+    return s->filesize != UINT64_MAX && s->off == s->filesize;
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -194,7 +316,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, pooled = 0;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -232,6 +354,15 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
+    if (!s->hd && s->connection_pool && !(h->flags & AVIO_FLAG_WRITE)) {
+        av_freep(&s->pool_key);
+        if (!(s->pool_key = pool_make_key(buf, *options)))
+            return AVERROR(ENOMEM);
+        s->hd  = pool_take(s->pool_key, &h->interrupt_callback);
+        pooled = !!s->hd;
+    }
+
+retry:
     if (!s->hd) {
         err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
                                    &h->interrupt_callback, options,
@@ -242,6 +373,13 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && pooled) {
+        /* the server may have closed the idle connection in the meantime */
+        av_log(h, AV_LOG_DEBUG, "Reused connection failed, reconnecting\n");
+        ffurl_closep(&s->hd);
+        pooled = 0;
+        goto retry;
+    }
     if (err < 0)
         return err;
 
@@ -577,6 +715,8 @@ static int http_open(URLContext *h, const char *uri, int flags,
     if (s->listen) {
         return http_listen(h, uri, flags, options);
     }
+    if (s->connection_pool)
+        s->multiple_requests = 1;
     ret = http_open_cnx(h, options);
     if (ret < 0)
         av_dict_free(&s->chained_options);
@@ -1684,8 +1824,14 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (http_connection_reusable(h)) {
+        pool_put(s->pool_key, s->hd, &h->interrupt_callback);
+        s->pool_key = NULL;
+        s->hd       = NULL;
+    }
     if (s->hd)
         ffurl_closep(&s->hd);
+    av_freep(&s->pool_key);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1694,6 +1840,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    char *old_pool_key = s->pool_key;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -1731,7 +1878,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd       = NULL;
+    s->pool_key = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -1739,11 +1887,14 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         memcpy(s->buffer, old_buf, old_buf_size);
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
-        s->hd      = old_hd;
-        s->off     = old_off;
+        av_free(s->pool_key);
+        s->hd       = old_hd;
+        s->pool_key = old_pool_key;
+        s->off      = old_off;
         return ret;
     }
     av_dict_free(&options);
+    av_free(old_pool_key);
     ffurl_close(old_hd);
     return off;
 }
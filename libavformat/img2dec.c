@@ -29,6 +29,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -374,6 +375,233 @@ int ff_img_read_header(AVFormatContext *s1)
     return 0;
 }
 
+#if HAVE_THREADS
+typedef struct ImgPrefetchSlot {
+    int number;             ///< image number, -1 if the slot is free
+    int busy;               ///< a thread is reading the file
+    int discard;            ///< the file is no longer wanted
+    int ret;                ///< number of bytes read or error code
+    AVBufferRef *buf;
+    char filename[1024];
+} ImgPrefetchSlot;
+
+typedef struct ImgPrefetch {
+    AVFormatContext *s1;
+    ImgPrefetchSlot *slots;
+    int nb_slots;
+    pthread_t *threads;
+    int nb_threads;
+    int next_number;        ///< next image to hand to a thread
+    int abort;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} ImgPrefetch;
+
+static int get_image_filename(VideoDemuxData *s, int number, char *buf, int size)
+{
+    if (s->use_glob) {
+#if HAVE_GLOB
+        av_strlcpy(buf, s->globstate.gl_pathv[number], size);
+#endif
+    } else if (av_get_frame_filename(buf, size, s->path, number) < 0 && number > 1) {
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+static int prefetch_read_file(AVFormatContext *s1, const char *filename, AVBufferRef **pbuf)
+{
+    AVIOContext *pb = NULL;
+    int64_t size;
+    int ret;
+
+    if (s1->io_open(s1, &pb, filename, AVIO_FLAG_READ, NULL) < 0) {
+        av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n", filename);
+        return AVERROR(EIO);
+    }
+    size = avio_size(pb);
+    if (size < 0) {
+        ret = size;
+    } else if (size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = AVERROR(ERANGE);
+    } else if (!(*pbuf = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE))) {
+        ret = AVERROR(ENOMEM);
+    } else {
+        ret = avio_read(pb, (*pbuf)->data, size);
+        memset((*pbuf)->data + FFMAX(ret, 0), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    }
+    ff_format_io_close(s1, &pb);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    ImgPrefetch *p = arg;
+    AVFormatContext *s1 = p->s1;
+    VideoDemuxData *s = s1->priv_data;
+
+    pthread_mutex_lock(&p->mutex);
+    while (!p->abort) {
+        ImgPrefetchSlot *slot = NULL;
+        AVBufferRef *buf = NULL;
+        int i, ret;
+
+        if (s->loop && p->next_number > s->img_last)
+            p->next_number = s->img_first;
+        if (p->next_number <= s->img_last) {
+            for (i = 0; i < p->nb_slots; i++) {
+                if (p->slots[i].number < 0 && !p->slots[i].busy) {
+                    slot = &p->slots[i];
+                    break;
+                }
+            }
+        }
+        if (!slot) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+            continue;
+        }
+        slot->number = p->next_number++;
+        slot->busy   = 1;
+        ret = get_image_filename(s, slot->number, slot->filename, sizeof(slot->filename));
+        pthread_mutex_unlock(&p->mutex);
+
+        if (ret >= 0)
+            ret = prefetch_read_file(s1, slot->filename, &buf);
+
+        pthread_mutex_lock(&p->mutex);
+        if (slot->discard) {
+            av_buffer_unref(&buf);
+        } else {
+            slot->buf = buf;
+            slot->ret = ret;
+        }
+        slot->busy    = 0;
+        slot->discard = 0;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return NULL;
+}
+
+/**
+ * Wait for the given image to be read by the prefetch threads and take its
+ * data, restarting the read ahead from it after a seek.
+ */
+static int prefetch_get(AVFormatContext *s1, int number, AVBufferRef **buf,
+                        char *filename, int filename_size)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetch *p = s->prefetch_ctx;
+    int i, ret;
+
+    pthread_mutex_lock(&p->mutex);
+    for (;;) {
+        ImgPrefetchSlot *slot = NULL;
+
+        for (i = 0; i < p->nb_slots; i++)
+            if (p->slots[i].number == number)
+                slot = &p->slots[i];
+        if (slot && !slot->busy) {
+            ret       = slot->ret;
+            *buf      = slot->buf;
+            slot->buf = NULL;
+            slot->number = -1;
+            av_strlcpy(filename, slot->filename, filename_size);
+            pthread_cond_broadcast(&p->cond);
+            break;
+        }
+        if (!slot && number != p->next_number) {
+            for (i = 0; i < p->nb_slots; i++) {
+                p->slots[i].discard = p->slots[i].busy;
+                p->slots[i].number  = -1;
+                av_buffer_unref(&p->slots[i].buf);
+            }
+            p->next_number = number;
+            pthread_cond_broadcast(&p->cond);
+        }
+        if (ff_check_interrupt(&s1->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_wait(&p->cond, &p->mutex);
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return ret;
+}
+
+static void prefetch_stop(VideoDemuxData *s)
+{
+    ImgPrefetch *p = s->prefetch_ctx;
+    int i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    p->abort = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    for (i = 0; i < p->nb_threads; i++)
+        pthread_join(p->threads[i], NULL);
+
+    for (i = 0; i < p->nb_slots; i++)
+        av_buffer_unref(&p->slots[i].buf);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    av_freep(&p->slots);
+    av_freep(&p->threads);
+    av_freep(&s->prefetch_ctx);
+}
+
+static int prefetch_start(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgPrefetch *p;
+    int i, ret;
+
+    if (!(p = av_mallocz(sizeof(*p))))
+        return AVERROR(ENOMEM);
+    p->slots   = av_mallocz_array(s->prefetch, sizeof(*p->slots));
+    p->threads = av_mallocz_array(s->prefetch, sizeof(*p->threads));
+    if (!p->slots || !p->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if ((ret = pthread_mutex_init(&p->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&p->cond, NULL))) {
+        pthread_mutex_destroy(&p->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    for (i = 0; i < s->prefetch; i++)
+        p->slots[i].number = -1;
+    p->nb_slots    = s->prefetch;
+    p->s1          = s1;
+    p->next_number = s->img_number;
+    s->prefetch_ctx = p;
+
+    for (; p->nb_threads < s->prefetch; p->nb_threads++) {
+        if ((ret = pthread_create(&p->threads[p->nb_threads], NULL, prefetch_thread, p))) {
+            av_log(s1, AV_LOG_ERROR, "Could not create prefetch thread: %s\n", av_err2str(AVERROR(ret)));
+            prefetch_stop(s);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+
+fail:
+    av_freep(&p->slots);
+    av_freep(&p->threads);
+    av_freep(&p);
+    return ret;
+}
+#endif
+
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -382,6 +610,7 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     int i, res;
     int size[3]           = { 0 }, ret[3] = { 0 };
     AVIOContext *f[3]     = { NULL };
+    AVBufferRef *buf      = NULL;
     AVCodecParameters *par = s1->streams[0]->codecpar;
 
     if (!s->is_pipe) {
@@ -403,6 +632,15 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
                                   s->img_number) < 0 && s->img_number > 1)
             return AVERROR(EIO);
         }
+#if HAVE_THREADS
+        if (s->prefetch_ctx) {
+            filename = filename_bytes;
+            res = prefetch_get(s1, s->img_number, &buf, filename_bytes, sizeof(filename_bytes));
+            if (res < 0)
+                return res;
+            size[0] = res;
+        } else
+#endif
         for (i = 0; i < 3; i++) {
             if (s1->pb &&
                 !strcmp(filename_bytes, s->path) &&
@@ -430,11 +668,16 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
             int ret;
             int score = 0;
 
-            ret = avio_read(f[0], header, PROBE_BUF_MIN);
-            if (ret < 0)
-                return ret;
+            if (buf) {
+                ret = FFMIN(size[0], PROBE_BUF_MIN);
+                memcpy(header, buf->data, ret);
+            } else {
+                ret = avio_read(f[0], header, PROBE_BUF_MIN);
+                if (ret < 0)
+                    return ret;
+                avio_skip(f[0], -ret);
+            }
             memset(header + ret, 0, sizeof(header) - ret);
-            avio_skip(f[0], -ret);
             pd.buf = header;
             pd.buf_size = ret;
             pd.filename = filename;
@@ -461,9 +704,16 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
     }
 
-    res = av_new_packet(pkt, size[0] + size[1] + size[2]);
-    if (res < 0) {
-        goto fail;
+    if (buf) {
+        /* the prefetched data is padded already */
+        pkt->buf  = buf;
+        pkt->data = buf->data;
+        buf       = NULL;
+    } else {
+        res = av_new_packet(pkt, size[0] + size[1] + size[2]);
+        if (res < 0) {
+            goto fail;
+        }
     }
     pkt->stream_index = 0;
     pkt->flags       |= AV_PKT_FLAG_KEY;
@@ -487,6 +737,8 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         pkt->pos = avio_tell(f[0]);
 
     pkt->size = 0;
+    if (pkt->buf && !f[0])
+        pkt->size = ret[0] = size[0];
     for (i = 0; i < 3; i++) {
         if (f[i]) {
             ret[i] = avio_read(f[i], pkt->data + pkt->size, size[i]);
@@ -523,6 +775,7 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     }
 
 fail:
+    av_buffer_unref(&buf);
     if (!s->is_pipe) {
         for (i = 0; i < 3; i++) {
             if (f[i] != s1->pb)
@@ -532,10 +785,28 @@ fail:
     return res;
 }
 
+static int img_read_header(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    int ret = ff_img_read_header(s1);
+
+    if (ret < 0)
+        return ret;
+#if HAVE_THREADS
+    if (s->prefetch > 0 && !s->is_pipe && !s->split_planes &&
+        s->pattern_type != PT_NONE)
+        return prefetch_start(s1);
+#endif
+    return 0;
+}
+
 static int img_read_close(struct AVFormatContext* s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+#if HAVE_THREADS
+    prefetch_stop(s);
+#endif
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -582,6 +853,7 @@ const AVOption ff_img_options[] = {
     { "start_number", "set first number in the sequence",    OFFSET(start_number), AV_OPT_TYPE_INT,    {.i64 = 0   }, INT_MIN, INT_MAX, DEC },
     { "start_number_range", "set range for looking at the first sequence number", OFFSET(start_number_range), AV_OPT_TYPE_INT, {.i64 = 5}, 1, INT_MAX, DEC },
     { "ts_from_file", "set frame timestamp from file's one", OFFSET(ts_from_file), AV_OPT_TYPE_INT,    {.i64 = 0   }, 0, 2,       DEC, "ts_type" },
+    { "prefetch",     "set number of files read ahead in parallel", OFFSET(prefetch), AV_OPT_TYPE_INT, {.i64 = 0   }, 0, 64,      DEC },
     { "none", "none",                   0, AV_OPT_TYPE_CONST,    {.i64 = 0   }, 0, 2,       DEC, "ts_type" },
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, "ts_type" },
@@ -599,7 +871,7 @@ AVInputFormat ff_image2_demuxer = {
     .long_name      = NULL_IF_CONFIG_SMALL("image2 sequence"),
     .priv_data_size = sizeof(VideoDemuxData),
     .read_probe     = img_read_probe,
-    .read_header    = ff_img_read_header,
+    .read_header    = img_read_header,
     .read_packet    = ff_img_read_packet,
     .read_close     = img_read_close,
     .read_seek      = img_read_seek,
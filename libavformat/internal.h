@@ -142,6 +142,28 @@ struct AVFormatInternal {
      * Prefer the codec framerate for avg_frame_rate computation.
      */
     int prefer_codec_framerate;
+
+    /**
+     * Min-heap of the indexes of the streams with packets queued in the
+     * default dts interleaver, ordered by their first queued packet.
+     * Muxing only, used instead of packet_buffer when the output format has
+     * no interleave_packet callback and chunking is disabled.
+     */
+    int *interleave_heap;
+    int nb_interleave_heap;
+
+    /**
+     * Number of streams whose lack of packets delays the dts interleaver
+     * (not attachments, VP8 or VP9), and how many of them are in the heap.
+     */
+    int nb_delaying_streams;
+    int nb_delaying_queued;
+
+    /**
+     * Largest dts of the queued packets in AV_TIME_BASE, for
+     * max_interleave_delta.
+     */
+    int64_t interleave_max_dts;
 };
 
 struct AVStreamInternal {
@@ -173,6 +195,16 @@ struct AVStreamInternal {
      */
     int avctx_inited;
 
+    /**
+     * Decoder opened by avformat_find_stream_info() and kept for the caller,
+     * see av_stream_take_probe_decoder().
+     */
+    AVCodecContext *probe_decoder;
+    /**
+     * 1 if data has been sent to the decoder in avformat_find_stream_info()
+     */
+    int probe_decoder_used;
+
     enum AVCodecID orig_codec_id;
 
     /* the context for extracting extradata in find_stream_info()
@@ -190,6 +222,12 @@ struct AVStreamInternal {
     int need_context_update;
 
     FFFrac *priv_pts;
+
+    /**
+     * Packets of this stream queued in the default dts interleaver, in dts
+     * order. The last one is also AVStream.last_in_packet_buffer.
+     */
+    struct AVPacketList *interleave_queue;
 };
 
 #ifdef __GNUC__
@@ -494,6 +532,14 @@ int ff_framehash_write_header(AVFormatContext *s);
  */
 int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Like av_get_packet(), but make the packet reference the I/O memory
+ * instead of copying the data when possible, see ffio_read_ref(). The packet
+ * data may then be read-only, it must only be modified after
+ * av_packet_make_writable().
+ */
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size);
+
 /**
  * Interleave a packet per dts in an output media file.
  *
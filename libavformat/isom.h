@@ -240,6 +240,9 @@ typedef struct MOVStreamContext {
         AVEncryptionInfo *default_encrypted_sample;
         MOVEncryptionIndex *encryption_index;
     } cenc;
+
+    int64_t *rfps_dts;    ///< dts passed to ff_rfps_add_frame(), for the index cache
+    int nb_rfps_dts;
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -277,6 +280,7 @@ typedef struct MOVContext {
     int use_mfra_for;
     int has_looked_for_mfra;
     MOVFragmentIndex frag_index;
+    int frag_index_from_mfra; ///< frag_index was completed from the mfra atom
     int atom_depth;
     unsigned int aax_mode;  ///< 'aax' file has been detected
     uint8_t file_key[20];
@@ -290,6 +294,17 @@ typedef struct MOVContext {
     int decryption_key_len;
     int enable_drefs;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
+
+    char *index_cache;            ///< directory of the sample index cache
+    char *index_cache_path;
+    int index_cache_hit;          ///< the sample tables are read from index_cache_in
+    int64_t index_cache_file_size;
+    int64_t index_cache_moov_pos;
+    int64_t index_cache_moov_size;
+    uint32_t index_cache_moov_crc;
+    AVIOContext *index_cache_out; ///< dynamic buffer the index is stored in on a miss
+    AVIOContext index_cache_in;
+    uint8_t *index_cache_buf;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -21,6 +21,7 @@
  * Haivision Open SRT (Secure Reliable Transport) protocol
  */
 
+#include <float.h>
 #include <srt/srt.h>
 
 #include "libavutil/avassert.h"
@@ -90,6 +91,17 @@ typedef struct SRTContext {
     int messageapi;
     SRT_TRANSTYPE transtype;
     int linger;
+    int64_t stats_interval;
+    int64_t last_stats;
+
+    /* statistics exported by libsrt_update_stats() */
+    double rtt;
+    double bandwidth;
+    double send_rate;
+    double recv_rate;
+    int64_t pkt_loss;
+    int64_t pkt_retrans;
+    int64_t pkt_drop;
 } SRTContext;
 
 #define D AV_OPT_FLAG_DECODING_PARAM
@@ -140,6 +152,14 @@ static const AVOption libsrt_options[] = {
     { "live",           NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRTT_LIVE }, INT_MIN, INT_MAX, .flags = D|E, "transtype" },
     { "file",           NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRTT_FILE }, INT_MIN, INT_MAX, .flags = D|E, "transtype" },
     { "linger",         "Number of seconds that the socket waits for unsent data when closing", OFFSET(linger),           AV_OPT_TYPE_INT,      { .i64 = -1 }, -1, INT_MAX,   .flags = D|E },
+    { "stats_interval", "Interval in microseconds between statistics reports, 0 to disable",   OFFSET(stats_interval),   AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = D|E },
+    { "rtt",            "Smoothed round trip time in milliseconds",                             OFFSET(rtt),              AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "bandwidth",      "Estimated link bandwidth in Mbps",                                     OFFSET(bandwidth),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "send_rate",      "Sending rate in Mbps",                                                 OFFSET(send_rate),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "recv_rate",      "Receiving rate in Mbps",                                               OFFSET(recv_rate),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "pkt_loss",       "Number of lost packets, sent and received",                            OFFSET(pkt_loss),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "pkt_retrans",    "Number of retransmitted packets",                                      OFFSET(pkt_retrans),      AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "pkt_drop",       "Number of packets dropped as too late, sent and received",             OFFSET(pkt_drop),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { NULL }
 };
 
@@ -479,6 +499,7 @@ static int libsrt_setup(URLContext *h, const char *uri, int flags)
 
     h->is_streamed = 1;
     s->fd = fd;
+    s->last_stats = av_gettime_relative();
 
     freeaddrinfo(ai);
     return 0;
@@ -630,6 +651,9 @@ static int libsrt_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "linger", p)) {
             s->linger = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "stats_interval", p)) {
+            s->stats_interval = strtoll(buf, NULL, 10);
+        }
     }
     return libsrt_setup(h, uri, flags);
 err:
@@ -638,6 +662,36 @@ err:
     return ret;
 }
 
+/* Export the connection statistics every stats_interval microseconds. */
+static void libsrt_update_stats(URLContext *h)
+{
+    SRTContext *s = h->priv_data;
+    SRT_TRACEBSTATS perf;
+    int64_t now;
+
+    if (!s->stats_interval)
+        return;
+    now = av_gettime_relative();
+    if (now - s->last_stats < s->stats_interval)
+        return;
+    s->last_stats = now;
+
+    if (srt_bstats(s->fd, &perf, 0) < 0)
+        return;
+    s->rtt         = perf.msRTT;
+    s->bandwidth   = perf.mbpsBandwidth;
+    s->send_rate   = perf.mbpsSendRate;
+    s->recv_rate   = perf.mbpsRecvRate;
+    s->pkt_loss    = (int64_t)perf.pktSndLossTotal + perf.pktRcvLossTotal;
+    s->pkt_retrans = perf.pktRetransTotal;
+    s->pkt_drop    = (int64_t)perf.pktSndDropTotal + perf.pktRcvDropTotal;
+
+    av_log(h, AV_LOG_INFO, "rtt:%.3fms bandwidth:%.3fMbps send:%.3fMbps recv:%.3fMbps "
+           "loss:%"PRId64" retrans:%"PRId64" drop:%"PRId64"\n",
+           s->rtt, s->bandwidth, s->send_rate, s->recv_rate,
+           s->pkt_loss, s->pkt_retrans, s->pkt_drop);
+}
+
 static int libsrt_read(URLContext *h, uint8_t *buf, int size)
 {
     SRTContext *s = h->priv_data;
@@ -652,6 +706,8 @@ static int libsrt_read(URLContext *h, uint8_t *buf, int size)
     ret = srt_recvmsg(s->fd, buf, size);
     if (ret < 0) {
         ret = libsrt_neterrno(h);
+    } else {
+        libsrt_update_stats(h);
     }
 
     return ret;
@@ -671,6 +727,8 @@ static int libsrt_write(URLContext *h, const uint8_t *buf, int size)
     ret = srt_sendmsg(s->fd, buf, size, -1, 0);
     if (ret < 0) {
         ret = libsrt_neterrno(h);
+    } else {
+        libsrt_update_stats(h);
     }
 
     return ret;
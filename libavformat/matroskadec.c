@@ -978,10 +978,30 @@ static int ebml_read_ascii(AVIOContext *pb, int size, char **str)
  * 0 is success, < 0 or NEEDS_CHECKING is failure.
  */
 static int ebml_read_binary(AVIOContext *pb, int length,
-                            int64_t pos, EbmlBin *bin)
+                            int64_t pos, EbmlBin *bin, int ref)
 {
     int ret;
 
+    if (ref) {
+        AVBufferRef *buf;
+        const uint8_t *data;
+
+        if ((ret = ffio_read_ref(pb, length, &buf, &data)) < 0)
+            return ret;
+        if (ret) {
+            av_buffer_unref(&bin->buf);
+            bin->buf  = buf;
+            bin->data = (uint8_t *)data;
+            bin->size = length;
+            bin->pos  = pos;
+            return 0;
+        }
+    }
+
+    /* do not copy the old contents of a buffer which cannot be reused */
+    if (bin->buf && !av_buffer_is_writable(bin->buf))
+        av_buffer_unref(&bin->buf);
+
     ret = av_buffer_realloc(&bin->buf, length + AV_INPUT_BUFFER_PADDING_SIZE);
     if (ret < 0)
         return ret;
@@ -1377,7 +1397,10 @@ static int ebml_parse(MatroskaDemuxContext *matroska,
         res = ebml_read_ascii(pb, length, data);
         break;
     case EBML_BIN:
-        res = ebml_read_binary(pb, length, pos_alt, data);
+        /* blocks are not modified in place, they can reference the input */
+        res = ebml_read_binary(pb, length, pos_alt, data,
+                               id == MATROSKA_ID_SIMPLEBLOCK ||
+                               id == MATROSKA_ID_BLOCK);
         break;
     case EBML_LEVEL1:
     case EBML_NEST:
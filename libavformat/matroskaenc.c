@@ -89,6 +89,7 @@ typedef struct mkv_cues {
     int64_t         segment_offset;
     mkv_cuepoint    *entries;
     int             num_entries;
+    unsigned int    alloc_size;
 } mkv_cues;
 
 typedef struct mkv_track {
@@ -539,7 +540,10 @@ static int mkv_add_cuepoint(mkv_cues *cues, int stream, int tracknum, int64_t ts
     if (ts < 0)
         return 0;
 
-    entries = av_realloc_array(entries, cues->num_entries + 1, sizeof(mkv_cuepoint));
+    if ((unsigned)cues->num_entries + 1 >= UINT_MAX / sizeof(mkv_cuepoint))
+        return AVERROR(ENOMEM);
+    entries = av_fast_realloc(entries, &cues->alloc_size,
+                              (cues->num_entries + 1) * sizeof(mkv_cuepoint));
     if (!entries)
         return AVERROR(ENOMEM);
     cues->entries = entries;
@@ -2359,6 +2363,9 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt, int add_
     int64_t ts = track->write_dts ? pkt->dts : pkt->pts;
     int64_t relative_packet_pos;
     int tracknum = mkv->is_dash ? mkv->dash_track_number : pkt->stream_index + 1;
+    /* Cues are only written for seekable non-live output, so do not let
+     * them pile up in memory otherwise. */
+    int write_cues = (s->pb->seekable & AVIO_SEEKABLE_NORMAL) && !mkv->is_live;
 
     if (ts == AV_NOPTS_VALUE) {
         av_log(s, AV_LOG_ERROR, "Can't write packet with unknown timestamp\n");
@@ -2392,7 +2399,7 @@ static int mkv_write_packet_internal(AVFormatContext *s, AVPacket *pkt, int add_
 
     if (par->codec_type != AVMEDIA_TYPE_SUBTITLE) {
         mkv_write_block(s, pb, MATROSKA_ID_SIMPLEBLOCK, pkt, keyframe);
-        if ((s->pb->seekable & AVIO_SEEKABLE_NORMAL) && (par->codec_type == AVMEDIA_TYPE_VIDEO && keyframe || add_cue)) {
+        if (write_cues && (par->codec_type == AVMEDIA_TYPE_VIDEO && keyframe || add_cue)) {
             ret = mkv_add_cuepoint(mkv->cues, pkt->stream_index, tracknum, ts, mkv->cluster_pos, relative_packet_pos, -1);
             if (ret < 0) return ret;
         }
@@ -2417,7 +2424,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
             end_ebml_master(pb, blockgroup);
         }
 
-        if (s->pb->seekable & AVIO_SEEKABLE_NORMAL) {
+        if (write_cues) {
             ret = mkv_add_cuepoint(mkv->cues, pkt->stream_index, tracknum, ts,
                                    mkv->cluster_pos, relative_packet_pos, duration);
             if (ret < 0)
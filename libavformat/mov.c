@@ -29,6 +29,7 @@
 
 #include "libavutil/attributes.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/crc.h"
 #include "libavutil/internal.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/intfloat.h"
@@ -75,6 +76,7 @@ typedef struct MOVParseTableEntry {
 
 static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom);
 static int mov_read_mfra(MOVContext *c, AVIOContext *f);
+static int mov_switch_root(AVFormatContext *s, int64_t target, int index);
 static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, unsigned int* allocated_size,
                               int count, int duration);
 
@@ -1136,6 +1138,388 @@ static int mov_read_ftyp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 }
 
 /* this atom should contain all header atoms */
+/*
+ * Sample index cache
+ *
+ * The index built from the sample tables of a moov atom is stored in a file
+ * named after the CRC and size of the moov atom and the size of the file.
+ * When the file is opened again, the large per-sample tables (stsz, stco,
+ * stss, stps, ctts) are skipped and the state mov_build_index() derived
+ * from them is read back instead.
+ * Computing the key reads the whole moov atom once more on every open, hit
+ * or miss. This is a sequential read of data that is then parsed anyway,
+ * so it costs far less than the table parsing and index building it saves,
+ * but it is not free for files whose moov atom is behind a slow protocol.
+ * For each track, the cache holds the values set by the skipped atoms,
+ * written after the trak atom is parsed, followed by the index itself,
+ * written after mov_build_index(). Index entries are delta coded with
+ * variable length integers, so samples contiguous in a chunk with a
+ * constant duration cost only a few bytes each.
+ */
+
+#define INDEX_CACHE_MAGIC   MKBETAG('F','F','M','I')
+#define INDEX_CACHE_VERSION 1
+#define INDEX_CACHE_HEADER_SIZE 40
+
+static void index_cache_put_sv(AVIOContext *pb, int64_t v)
+{
+    ff_put_v(pb, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static int64_t index_cache_get_sv(AVIOContext *pb)
+{
+    uint64_t v = ffio_read_varlen(pb);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int index_cache_options(MOVContext *c)
+{
+    return c->advanced_editlist | c->ignore_editlist << 1;
+}
+
+static int index_cache_moov_crc(AVIOContext *pb, int64_t size, uint32_t *crc)
+{
+    const AVCRC *table = av_crc_get_table(AV_CRC_32_IEEE_LE);
+    int64_t pos = avio_tell(pb);
+    uint8_t buf[4096];
+
+    *crc = UINT32_MAX;
+    while (size > 0) {
+        int len = avio_read(pb, buf, FFMIN(size, sizeof(buf)));
+        if (len <= 0)
+            break;
+        *crc = av_crc(table, *crc, buf, len);
+        size -= len;
+    }
+    if (avio_seek(pb, pos, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    return size ? AVERROR_INVALIDDATA : 0;
+}
+
+static int index_cache_load(MOVContext *c, const char *path)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *in = NULL;
+    uint8_t header[INDEX_CACHE_HEADER_SIZE];
+    uint32_t size, crc;
+    int ret;
+
+    if (s->io_open(s, &in, path, AVIO_FLAG_READ, NULL) < 0)
+        return 0;
+
+    ret = avio_read(in, header, sizeof(header));
+    if (ret != sizeof(header) ||
+        AV_RB32(header)      != INDEX_CACHE_MAGIC ||
+        header[4]            != INDEX_CACHE_VERSION ||
+        header[5]            != index_cache_options(c) ||
+        AV_RB64(header +  8) != c->index_cache_file_size ||
+        AV_RB64(header + 16) != c->index_cache_moov_pos ||
+        AV_RB64(header + 24) != c->index_cache_moov_size ||
+        AV_RB32(header + 32) != c->index_cache_moov_crc) {
+        ret = 0;
+        goto end;
+    }
+    size = AV_RB32(header + 36);
+
+    c->index_cache_buf = av_malloc(size + 4);
+    if (!c->index_cache_buf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avio_read(in, c->index_cache_buf, size + 4);
+    crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX,
+                 c->index_cache_buf, size);
+    if (ret != size + 4 || AV_RB32(c->index_cache_buf + size) != crc) {
+        av_log(s, AV_LOG_WARNING, "Ignoring corrupted index cache %s\n", path);
+        av_freep(&c->index_cache_buf);
+        ret = 0;
+        goto end;
+    }
+
+    ffio_init_context(&c->index_cache_in, c->index_cache_buf, size,
+                      0, NULL, NULL, NULL, NULL);
+    c->index_cache_hit = 1;
+    av_log(s, AV_LOG_VERBOSE, "Using index cache %s\n", path);
+    ret = 0;
+
+end:
+    ff_format_io_close(s, &in);
+    return ret;
+}
+
+/**
+ * Look up the index of the moov atom starting at the current position in
+ * the cache, or prepare for storing it there.
+ */
+static int index_cache_open(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    int ret;
+
+    if (pb != c->fc->pb || !(pb->seekable & AVIO_SEEKABLE_NORMAL) ||
+        c->aax_mode || c->decryption_key || atom.size <= 0)
+        return 0;
+
+    c->index_cache_file_size = avio_size(pb);
+    c->index_cache_moov_pos  = avio_tell(pb);
+    c->index_cache_moov_size = atom.size;
+    if (c->index_cache_file_size < 0 ||
+        index_cache_moov_crc(pb, atom.size, &c->index_cache_moov_crc) < 0)
+        return 0;
+
+    c->index_cache_path = av_asprintf("%s/%08"PRIx32"-%"PRIx64"-%"PRIx64".idx",
+                                      c->index_cache, c->index_cache_moov_crc,
+                                      atom.size, c->index_cache_file_size);
+    if (!c->index_cache_path)
+        return AVERROR(ENOMEM);
+
+    if ((ret = index_cache_load(c, c->index_cache_path)) < 0 || c->index_cache_hit)
+        return ret;
+
+    return avio_open_dyn_buf(&c->index_cache_out);
+}
+
+static void index_cache_write(MOVContext *c)
+{
+    AVFormatContext *s = c->fc;
+    AVIOContext *out = NULL;
+    uint8_t *payload;
+    char *tmp;
+    int i, size;
+
+    size = avio_close_dyn_buf(c->index_cache_out, &payload);
+    c->index_cache_out = NULL;
+
+    /* fragments and encryption data are read past the sample tables */
+    if (c->frag_index.nb_items || c->trex_data)
+        goto end;
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        if (sc->cenc.encryption_index || sc->cenc.default_encrypted_sample)
+            goto end;
+    }
+
+    tmp = av_asprintf("%s.tmp", c->index_cache_path);
+    if (!tmp)
+        goto end;
+    if (s->io_open(s, &out, tmp, AVIO_FLAG_WRITE, NULL) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not create index cache %s\n", tmp);
+        av_free(tmp);
+        goto end;
+    }
+    avio_wb32(out, INDEX_CACHE_MAGIC);
+    avio_w8  (out, INDEX_CACHE_VERSION);
+    avio_w8  (out, index_cache_options(c));
+    avio_wb16(out, 0);
+    avio_wb64(out, c->index_cache_file_size);
+    avio_wb64(out, c->index_cache_moov_pos);
+    avio_wb64(out, c->index_cache_moov_size);
+    avio_wb32(out, c->index_cache_moov_crc);
+    avio_wb32(out, size);
+    avio_write(out, payload, size);
+    avio_wb32(out, av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX,
+                          payload, size));
+    avio_flush(out);
+    if (out->error >= 0) {
+        ff_format_io_close(s, &out);
+        ff_rename(tmp, c->index_cache_path, s);
+    } else {
+        ff_format_io_close(s, &out);
+        avpriv_io_delete(tmp);
+    }
+    av_free(tmp);
+
+end:
+    av_free(payload);
+}
+
+/* values set by the atoms skipped when the cache is used */
+static void index_cache_write_tables(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIOContext *out = c->index_cache_out;
+
+    index_cache_put_sv(out, st->id);
+    ff_put_v(out, sc->sample_count);
+    ff_put_v(out, sc->sample_size);
+    ff_put_v(out, sc->stsz_sample_size);
+    ff_put_v(out, sc->data_size);
+    ff_put_v(out, sc->chunk_count);
+    ff_put_v(out, sc->keyframe_count);
+    ff_put_v(out, sc->keyframe_absent);
+    ff_put_v(out, sc->stps_count);
+    index_cache_put_sv(out, sc->dts_shift);
+    ff_put_v(out, st->need_parsing);
+}
+
+static int index_cache_read_tables(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIOContext *in = &c->index_cache_in;
+
+    if (index_cache_get_sv(in) != st->id) {
+        av_log(c->fc, AV_LOG_ERROR, "Index cache does not match track %d\n", st->id);
+        return AVERROR_INVALIDDATA;
+    }
+    sc->sample_count     = ffio_read_varlen(in);
+    sc->sample_size      = ffio_read_varlen(in);
+    sc->stsz_sample_size = ffio_read_varlen(in);
+    sc->data_size        = ffio_read_varlen(in);
+    sc->chunk_count      = ffio_read_varlen(in);
+    sc->keyframe_count   = ffio_read_varlen(in);
+    sc->keyframe_absent  = ffio_read_varlen(in);
+    sc->stps_count       = ffio_read_varlen(in);
+    sc->dts_shift        = index_cache_get_sv(in);
+    st->need_parsing     = ffio_read_varlen(in);
+
+    return in->eof_reached ? AVERROR_INVALIDDATA : 0;
+}
+
+/* state built by mov_build_index() */
+static void index_cache_write_index(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIOContext *out = c->index_cache_out;
+    int64_t pos = 0, dts = 0, delta = 0;
+    int i, distance = -1;
+
+    ff_put_v(out, sc->stsz_sample_size);
+    index_cache_put_sv(out, sc->time_offset);
+    index_cache_put_sv(out, sc->min_corrected_pts);
+    index_cache_put_sv(out, sc->start_pad);
+    index_cache_put_sv(out, sc->current_index);
+    index_cache_put_sv(out, st->start_time);
+    index_cache_put_sv(out, st->duration);
+    index_cache_put_sv(out, st->skip_samples);
+    index_cache_put_sv(out, st->codecpar->bit_rate);
+    index_cache_put_sv(out, st->codecpar->video_delay);
+
+    ff_put_v(out, sc->nb_rfps_dts);
+    for (i = 0; i < sc->nb_rfps_dts; i++)
+        index_cache_put_sv(out, sc->rfps_dts[i]);
+    av_freep(&sc->rfps_dts);
+    sc->nb_rfps_dts = 0;
+
+    ff_put_v(out, sc->ctts_count);
+    for (i = 0; i < sc->ctts_count;) {
+        int run = 1;
+        while (i + run < sc->ctts_count &&
+               sc->ctts_data[i + run].count    == sc->ctts_data[i].count &&
+               sc->ctts_data[i + run].duration == sc->ctts_data[i].duration)
+            run++;
+        ff_put_v(out, run);
+        ff_put_v(out, sc->ctts_data[i].count);
+        index_cache_put_sv(out, sc->ctts_data[i].duration);
+        i += run;
+    }
+
+    i = 0;
+    if (sc->index_ranges)
+        while (sc->index_ranges[i++].end);
+    ff_put_v(out, i);
+    for (i--; i >= 0; i--) {
+        index_cache_put_sv(out, sc->index_ranges[i].start);
+        index_cache_put_sv(out, sc->index_ranges[i].end);
+    }
+
+    ff_put_v(out, st->nb_index_entries);
+    for (i = 0; i < st->nb_index_entries; i++) {
+        const AVIndexEntry *e = &st->index_entries[i];
+        ff_put_v(out, e->size);
+        index_cache_put_sv(out, e->pos - pos);
+        index_cache_put_sv(out, e->timestamp - dts - delta);
+        ff_put_v(out, (e->min_distance == distance + 1 ? 0 : e->min_distance + 1LL) << 2 |
+                      (e->flags & 3));
+        delta    = e->timestamp - dts;
+        pos      = e->pos + e->size;
+        dts      = e->timestamp;
+        distance = e->min_distance;
+    }
+}
+
+static int index_cache_read_index(MOVContext *c, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIOContext *in = &c->index_cache_in;
+    int64_t pos = 0, dts = 0, delta = 0;
+    unsigned i, j, n;
+    int distance = -1;
+
+    sc->stsz_sample_size       = ffio_read_varlen(in);
+    sc->time_offset            = index_cache_get_sv(in);
+    sc->min_corrected_pts      = index_cache_get_sv(in);
+    sc->start_pad              = index_cache_get_sv(in);
+    sc->current_index          = index_cache_get_sv(in);
+    st->start_time             = index_cache_get_sv(in);
+    st->duration               = index_cache_get_sv(in);
+    st->skip_samples           = index_cache_get_sv(in);
+    st->codecpar->bit_rate     = index_cache_get_sv(in);
+    st->codecpar->video_delay  = index_cache_get_sv(in);
+
+    n = ffio_read_varlen(in);
+    for (i = 0; i < n && !in->eof_reached; i++)
+        ff_rfps_add_frame(c->fc, st, index_cache_get_sv(in));
+
+    n = ffio_read_varlen(in);
+    if (n) {
+        if (n >= UINT_MAX / sizeof(*sc->ctts_data))
+            return AVERROR_INVALIDDATA;
+        sc->ctts_allocated_size = n * sizeof(*sc->ctts_data);
+        if (!(sc->ctts_data = av_malloc(sc->ctts_allocated_size)))
+            return AVERROR(ENOMEM);
+        for (i = 0; i < n && !in->eof_reached;) {
+            unsigned run = ffio_read_varlen(in);
+            int count    = ffio_read_varlen(in);
+            int duration = index_cache_get_sv(in);
+            if (!run || run > n - i)
+                return AVERROR_INVALIDDATA;
+            for (j = 0; j < run; j++, i++) {
+                sc->ctts_data[i].count    = count;
+                sc->ctts_data[i].duration = duration;
+            }
+        }
+        sc->ctts_count = n;
+    }
+
+    n = ffio_read_varlen(in);
+    if (n) {
+        if (n >= UINT_MAX / sizeof(*sc->index_ranges))
+            return AVERROR_INVALIDDATA;
+        if (!(sc->index_ranges = av_malloc_array(n, sizeof(*sc->index_ranges))))
+            return AVERROR(ENOMEM);
+        for (i = n; i > 0; i--) {
+            sc->index_ranges[i - 1].start = index_cache_get_sv(in);
+            sc->index_ranges[i - 1].end   = index_cache_get_sv(in);
+        }
+        sc->current_index_range = sc->index_ranges;
+    }
+
+    n = ffio_read_varlen(in);
+    if (n) {
+        if (n >= UINT_MAX / sizeof(*st->index_entries))
+            return AVERROR_INVALIDDATA;
+        if (!(st->index_entries = av_malloc_array(n, sizeof(*st->index_entries))))
+            return AVERROR(ENOMEM);
+        st->index_entries_allocated_size = n * sizeof(*st->index_entries);
+        for (i = 0; i < n && !in->eof_reached; i++) {
+            AVIndexEntry *e = &st->index_entries[i];
+            unsigned flags;
+            e->size         = ffio_read_varlen(in);
+            e->pos          = pos + index_cache_get_sv(in);
+            e->timestamp    = dts + delta + index_cache_get_sv(in);
+            flags           = ffio_read_varlen(in);
+            e->flags        = flags & 3;
+            e->min_distance = flags >> 2 ? (flags >> 2) - 1 : distance + 1;
+            delta    = e->timestamp - dts;
+            pos      = e->pos + e->size;
+            dts      = e->timestamp;
+            distance = e->min_distance;
+        }
+        st->nb_index_entries = i;
+    }
+
+    return in->eof_reached ? AVERROR_INVALIDDATA : 0;
+}
+
 static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     int ret;
@@ -1146,6 +1530,9 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
+    if (c->index_cache && (ret = index_cache_open(c, pb, atom)) < 0)
+        return ret;
+
     if ((ret = mov_read_default(c, pb, atom)) < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
@@ -1243,9 +1630,16 @@ static int64_t get_stream_info_time(MOVFragmentStreamInfo * frag_stream_info)
     return frag_stream_info->tfdt_dts;
 }
 
-static int64_t get_frag_time(MOVFragmentIndex *frag_index,
+/**
+ * Get the time of a fragment, in the timebase of st if it is not NULL.
+ * The time of st itself is used if known, as the other streams may start
+ * at a different time in the fragment.
+ */
+static int64_t get_frag_time(AVFormatContext *s, AVStream *st,
                              int index, int track_id)
 {
+    MOVContext *mov = s->priv_data;
+    MOVFragmentIndex *frag_index = &mov->frag_index;
     MOVFragmentStreamInfo * frag_stream_info;
     int64_t timestamp;
     int i;
@@ -1255,18 +1649,32 @@ static int64_t get_frag_time(MOVFragmentIndex *frag_index,
         return frag_stream_info->sidx_pts;
     }
 
+    if (st) {
+        frag_stream_info = get_frag_stream_info(frag_index, index, st->id);
+        if (frag_stream_info &&
+            (timestamp = get_stream_info_time(frag_stream_info)) != AV_NOPTS_VALUE)
+            return timestamp;
+    }
+
     for (i = 0; i < frag_index->item[index].nb_stream_info; i++) {
         frag_stream_info = &frag_index->item[index].stream_info[i];
         timestamp = get_stream_info_time(frag_stream_info);
-        if (timestamp != AV_NOPTS_VALUE)
+        if (timestamp != AV_NOPTS_VALUE) {
+            // stream_info is in the order of the streams
+            if (st && i < s->nb_streams)
+                timestamp = av_rescale_q(timestamp, s->streams[i]->time_base,
+                                         st->time_base);
             return timestamp;
+        }
     }
     return AV_NOPTS_VALUE;
 }
 
-static int search_frag_timestamp(MOVFragmentIndex *frag_index,
+static int search_frag_timestamp(AVFormatContext *s,
                                  AVStream *st, int64_t timestamp)
 {
+    MOVContext *mov = s->priv_data;
+    MOVFragmentIndex *frag_index = &mov->frag_index;
     int a, b, m, m0;
     int64_t frag_time;
     int id = -1;
@@ -1286,7 +1694,7 @@ static int search_frag_timestamp(MOVFragmentIndex *frag_index,
         m0 = m = (a + b) >> 1;
 
         while (m < b &&
-               (frag_time = get_frag_time(frag_index, m, id)) == AV_NOPTS_VALUE)
+               (frag_time = get_frag_time(s, st, m, id)) == AV_NOPTS_VALUE)
             m++;
 
         if (m < b && frag_time <= timestamp)
@@ -1382,6 +1790,11 @@ static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
             if ((ret = mov_read_mfra(c, pb)) < 0) {
                 av_log(c->fc, AV_LOG_VERBOSE, "found a moof box but failed to "
                         "read the mfra (may be a live ismv)\n");
+            } else if (c->frag_index.nb_items && !c->frag_index.complete) {
+                // The tfra entries give the time of each random access
+                // fragment, the others are read when playback reaches them.
+                c->frag_index.complete = 1;
+                c->frag_index_from_mfra = 1;
             }
         } else {
             av_log(c->fc, AV_LOG_VERBOSE, "found a moof box but stream is not "
@@ -1391,6 +1804,8 @@ static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     c->fragment.moof_offset = c->fragment.implicit_offset = avio_tell(pb) - 8;
     av_log(c->fc, AV_LOG_TRACE, "moof offset %"PRIx64"\n", c->fragment.moof_offset);
     c->frag_index.current = update_frag_index(c, c->fragment.moof_offset);
+    if (c->frag_index.current >= 0)
+        c->frag_index.item[c->frag_index.current].headers_read = 1;
     return mov_read_default(c, pb, atom);
 }
 
@@ -1980,6 +2395,8 @@ static int mov_read_stco(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
     sc = st->priv_data;
+    if (c->index_cache_hit)
+        return 0;
 
     avio_r8(pb); /* version */
     avio_rb24(pb); /* flags */
@@ -2713,6 +3130,8 @@ static int mov_read_stps(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
     sc = st->priv_data;
+    if (c->index_cache_hit)
+        return 0;
 
     avio_rb32(pb); // version + flags
 
@@ -2749,6 +3168,8 @@ static int mov_read_stss(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
     sc = st->priv_data;
+    if (c->index_cache_hit)
+        return 0;
 
     avio_r8(pb); /* version */
     avio_rb24(pb); /* flags */
@@ -2801,6 +3222,8 @@ static int mov_read_stsz(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
     sc = st->priv_data;
+    if (c->index_cache_hit)
+        return 0;
 
     avio_r8(pb); /* version */
     avio_rb24(pb); /* flags */
@@ -3007,6 +3430,8 @@ static int mov_read_ctts(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     st = c->fc->streams[c->fc->nb_streams-1];
     sc = st->priv_data;
+    if (c->index_cache_hit)
+        return 0;
 
     avio_r8(pb); /* version */
     avio_rb24(pb); /* flags */
@@ -3917,8 +4342,17 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                     av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
                             "size %u, distance %u, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
+                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100) {
                         ff_rfps_add_frame(mov->fc, st, current_dts);
+                        if (mov->index_cache_out) {
+                            if (av_reallocp_array(&sc->rfps_dts, sc->nb_rfps_dts + 1,
+                                                  sizeof(*sc->rfps_dts)) < 0) {
+                                sc->nb_rfps_dts = 0;
+                                ffio_free_dyn_buf(&mov->index_cache_out);
+                            } else
+                                sc->rfps_dts[sc->nb_rfps_dts++] = current_dts;
+                        }
+                    }
                 }
 
                 current_offset += sample_size;
@@ -4206,6 +4640,12 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     c->trak_index = -1;
 
+    if (c->index_cache_hit) {
+        if ((ret = index_cache_read_tables(c, st)) < 0)
+            return ret;
+    } else if (c->index_cache_out)
+        index_cache_write_tables(c, st);
+
     // Here stsc refers to a chunk not described in stco. This is technically invalid,
     // but we can overlook it (clearing stsc) whenever stts_count == 0 (indicating no samples).
     if (!sc->chunk_count && !sc->stts_count && sc->stsc_count) {
@@ -4231,7 +4671,14 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     avpriv_set_pts_info(st, 64, 1, sc->time_scale);
 
-    mov_build_index(c, st);
+    if (c->index_cache_hit) {
+        if ((ret = index_cache_read_index(c, st)) < 0)
+            return ret;
+    } else {
+        mov_build_index(c, st);
+        if (c->index_cache_out)
+            index_cache_write_index(c, st);
+    }
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -4793,6 +5240,11 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
             dts = frag_stream_info->tfdt_dts - sc->time_offset;
             av_log(c->fc, AV_LOG_DEBUG, "found tfdt time %"PRId64
                     ", using it for dts\n", dts);
+        } else if (frag_stream_info->first_tfra_pts != AV_NOPTS_VALUE &&
+                   c->use_mfra_for == FF_MOV_FLAG_MFRA_DTS) {
+            dts = frag_stream_info->first_tfra_pts - sc->time_offset;
+            av_log(c->fc, AV_LOG_DEBUG, "found mfra time %"PRId64
+                    ", using it for dts\n", dts);
         } else {
             dts = sc->track_end - sc->time_offset;
             av_log(c->fc, AV_LOG_DEBUG, "found track end time %"PRId64
@@ -4989,8 +5441,10 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     int64_t offset = avio_tell(pb) + atom.size, pts, timestamp;
+    int64_t sidx_pos = avio_tell(pb) - 8;
     uint8_t version;
     unsigned i, j, track_id, item_count;
+    int index, is_child;
     AVStream *st = NULL;
     AVStream *ref_st = NULL;
     MOVStreamContext *sc, *ref_sc = NULL;
@@ -5018,6 +5472,14 @@ static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     sc = st->priv_data;
 
+    // A sidx referenced by another one already has its own entry in the
+    // fragment index, from where the referenced subsegments are loaded.
+    index = search_frag_moof_offset(&c->frag_index, sidx_pos);
+    is_child = index < c->frag_index.nb_items &&
+               c->frag_index.item[index].moof_offset == sidx_pos;
+    if (is_child)
+        c->frag_index.item[index].headers_read = 1;
+
     timescale = av_make_q(1, avio_rb32(pb));
 
     if (timescale.den <= 0) {
@@ -5038,14 +5500,12 @@ static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     item_count = avio_rb16(pb);
 
     for (i = 0; i < item_count; i++) {
-        int index;
         MOVFragmentStreamInfo * frag_stream_info;
         uint32_t size = avio_rb32(pb);
         uint32_t duration = avio_rb32(pb);
-        if (size & 0x80000000) {
-            avpriv_request_sample(c->fc, "sidx reference_type 1");
-            return AVERROR_PATCHWELCOME;
-        }
+        // reference_type 1 points to another sidx. It gets an entry like a
+        // moof, so that it is only read once a seek or playback reaches it.
+        size &= 0x7FFFFFFF;
         avio_rb32(pb); // sap_flags
         timestamp = av_rescale_q(pts, timescale, st->time_base);
 
@@ -5058,10 +5518,13 @@ static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         pts += duration;
     }
 
-    st->duration = sc->track_end = pts;
-
     sc->has_sidx = 1;
 
+    if (is_child)
+        return 0;
+
+    st->duration = sc->track_end = pts;
+
     if (offset == avio_size(pb)) {
         // Find first entry in fragment index that came from an sidx.
         // This will pretty much always be the first entry.
@@ -7262,6 +7725,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->stts_data);
         av_freep(&sc->sdtp_data);
         av_freep(&sc->stps_data);
+        av_freep(&sc->rfps_dts);
         av_freep(&sc->elst_data);
         av_freep(&sc->rap_group);
         av_freep(&sc->display_matrix);
@@ -7310,6 +7774,10 @@ static int mov_read_close(AVFormatContext *s)
     av_freep(&mov->aes_decrypt);
     av_freep(&mov->chapter_tracks);
 
+    ffio_free_dyn_buf(&mov->index_cache_out);
+    av_freep(&mov->index_cache_buf);
+    av_freep(&mov->index_cache_path);
+
     return 0;
 }
 
@@ -7447,6 +7915,51 @@ fail:
     return ret;
 }
 
+/**
+ * Read the fragments from the last one listed in the mfra atom to the end
+ * of the file, so that the duration of the tracks is known without reading
+ * all the fragments in between.
+ */
+static void mov_read_last_fragments(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    MOVFragment fragment = mov->fragment;
+    int64_t pos = avio_tell(s->pb);
+    int64_t next_root_atom = mov->next_root_atom;
+    int current = mov->frag_index.current;
+    int64_t *track_end;
+    int i, ret;
+
+    if (mov->frag_index.item[mov->frag_index.nb_items - 1].headers_read)
+        return;
+    track_end = av_malloc_array(s->nb_streams, sizeof(*track_end));
+    if (!track_end)
+        return;
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        track_end[i] = sc->track_end;
+    }
+
+    ret = mov_switch_root(s, -1, mov->frag_index.nb_items - 1);
+    while (ret > 0 && mov->next_root_atom)
+        ret = mov_switch_root(s, mov->next_root_atom, -1);
+    if (ret < 0 && ret != AVERROR_EOF)
+        av_log(s, AV_LOG_WARNING, "Could not read the last fragments\n");
+
+    // fragments without timestamps continue from the previous one read
+    for (i = 0; i < s->nb_streams; i++) {
+        MOVStreamContext *sc = s->streams[i]->priv_data;
+        sc->track_end = track_end[i];
+    }
+    av_free(track_end);
+
+    mov->fragment            = fragment;
+    mov->frag_index.current  = current;
+    mov->next_root_atom      = next_root_atom;
+    mov->found_mdat          = 1;
+    avio_seek(s->pb, pos, SEEK_SET);
+}
+
 static int mov_read_header(AVFormatContext *s)
 {
     MOVContext *mov = s->priv_data;
@@ -7484,6 +7997,8 @@ static int mov_read_header(AVFormatContext *s)
         mov_read_close(s);
         return AVERROR_INVALIDDATA;
     }
+    if (mov->index_cache_out)
+        index_cache_write(mov);
     av_log(mov->fc, AV_LOG_TRACE, "on_parse_exit_offset=%"PRId64"\n", avio_tell(pb));
 
     if (pb->seekable & AVIO_SEEKABLE_NORMAL) {
@@ -7654,6 +8169,9 @@ static int mov_read_header(AVFormatContext *s)
         if (mov->frag_index.item[i].moof_offset <= mov->fragment.moof_offset)
             mov->frag_index.item[i].headers_read = 1;
 
+    if (mov->frag_index_from_mfra)
+        mov_read_last_fragments(s);
+
     return 0;
 }
 
@@ -7792,7 +8310,12 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             goto retry;
         }
 
-        ret = av_get_packet(sc->pb, pkt, sample->size);
+        /* the dv demuxer and decryption work on the packet data in place */
+        if (mov->aax_mode || mov->decryption_key ||
+            (mov->dv_demux && sc->dv_audio_container))
+            ret = av_get_packet(sc->pb, pkt, sample->size);
+        else
+            ret = ff_get_packet_ref(sc->pb, pkt, sample->size);
         if (ret < 0) {
             if (should_retry(sc->pb, ret)) {
                 mov_current_sample_dec(sc);
@@ -7892,16 +8415,23 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp)
 {
     MOVContext *mov = s->priv_data;
-    int index;
+    int index, ret;
 
     if (!mov->frag_index.complete)
         return 0;
 
-    index = search_frag_timestamp(&mov->frag_index, st, timestamp);
-    if (index < 0)
-        index = 0;
-    if (!mov->frag_index.item[index].headers_read)
-        return mov_switch_root(s, -1, index);
+    // Reading a fragment can add entries to the index, when it is a sidx
+    // referencing subsegments, so search again until the fragment found
+    // has been read.
+    for (;;) {
+        index = search_frag_timestamp(s, st, timestamp);
+        if (index < 0)
+            index = 0;
+        if (mov->frag_index.item[index].headers_read)
+            break;
+        if ((ret = mov_switch_root(s, -1, index)) < 0)
+            return ret;
+    }
     if (index + 1 < mov->frag_index.nb_items)
         mov->next_root_atom = mov->frag_index.item[index + 1].moof_offset;
 
@@ -7962,6 +8492,16 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     return sample;
 }
 
+static int64_t mov_count_index_entries(AVFormatContext *s)
+{
+    int64_t nb_index_entries = 0;
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++)
+        nb_index_entries += s->streams[i]->nb_index_entries;
+    return nb_index_entries;
+}
+
 static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_time, int flags)
 {
     MOVContext *mc = s->priv_data;
@@ -7978,20 +8518,33 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return sample;
 
     if (mc->seek_individually) {
-        /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
+        int64_t nb_index_entries;
 
-        for (i = 0; i < s->nb_streams; i++) {
-            int64_t timestamp;
-            MOVStreamContext *sc = s->streams[i]->priv_data;
-            st = s->streams[i];
-            st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
+        while (1) {
+            /* adjust seek timestamp to found sample timestamp */
+            int64_t seek_timestamp = s->streams[stream_index]->index_entries[sample].timestamp;
 
-            if (stream_index == i)
-                continue;
+            nb_index_entries = mov_count_index_entries(s);
+            for (i = 0; i < s->nb_streams; i++) {
+                int64_t timestamp;
+                MOVStreamContext *sc = s->streams[i]->priv_data;
+                st = s->streams[i];
+                st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
+
+                if (stream_index == i)
+                    continue;
+
+                timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
+                mov_seek_stream(s, st, timestamp, flags);
+            }
+            if (nb_index_entries == mov_count_index_entries(s))
+                break;
 
-            timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
-            mov_seek_stream(s, st, timestamp, flags);
+            /* Fragments read for the other streams may have been inserted
+             * before the samples found for the streams seeked before. */
+            sample = mov_seek_stream(s, s->streams[stream_index], sample_time, flags);
+            if (sample < 0)
+                return sample;
         }
     } else {
         for (i = 0; i < s->nb_streams; i++) {
@@ -8057,6 +8610,8 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "index_cache", "Directory the sample index of the moov atom is cached in.", OFFSET(index_cache), AV_OPT_TYPE_STRING,
+        {.str = NULL}, 0, 0, FLAGS },
 
     { NULL },
 };
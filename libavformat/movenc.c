@@ -68,6 +68,7 @@ static const AVOption options[] = {
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "faststart", "Run a second pass to put the index (moov atom) at the beginning of the file", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "reserve_moov", "Reserve space for the moov atom at the beginning of the file, and only shift the data if it is too small", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RESERVE_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "omit_tfhd_offset", "Omit the base data offset in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_OMIT_TFHD_OFFSET}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "disable_chpl", "Disable Nero chapter atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DISABLE_CHPL}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "default_base_moof", "Set the default-base-is-moof flag in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DEFAULT_BASE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -6180,6 +6181,16 @@ static int mov_init(AVFormatContext *s)
         mov->flags &= ~FF_MOV_FLAG_SKIP_SIDX;
     }
 
+    if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV) {
+        if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
+            av_log(s, AV_LOG_WARNING, "reserve_moov is not supported with fragmented output\n");
+            mov->flags &= ~FF_MOV_FLAG_RESERVE_MOOV;
+        } else {
+            /* the data is only shifted if the reserved space is too small */
+            mov->flags &= ~FF_MOV_FLAG_FASTSTART;
+        }
+    }
+
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
         mov->reserved_moov_size = -1;
     }
@@ -6447,6 +6458,63 @@ static int mov_init(AVFormatContext *s)
     return 0;
 }
 
+/**
+ * Estimate the size of the moov atom from the duration and bitrate of the
+ * streams, assuming that every sample is in its own chunk.
+ *
+ * @return the estimated size, or 0 if the duration is unknown
+ */
+static int64_t estimate_stream_duration(AVFormatContext *s, AVStream *st)
+{
+    if (st->duration > 0)
+        return av_rescale_q(st->duration, st->time_base, AV_TIME_BASE_Q);
+    return FFMAX(s->duration, 0);
+}
+
+static int estimate_moov_size(AVFormatContext *s)
+{
+    int64_t size = 4096 + 64 * s->nb_chapters, data_size = 0;
+    int i, offset_size;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        int64_t duration = estimate_stream_duration(s, st);
+        if (!duration)
+            return 0;
+        data_size += av_rescale(FFMAX(st->codecpar->bit_rate, 0), duration, 8 * AV_TIME_BASE);
+    }
+    offset_size = data_size > UINT32_MAX ? 8 : 4;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVCodecParameters *par = s->streams[i]->codecpar;
+        /* stsz, stsc and chunk offsets */
+        int sample_size = 4 + 12 + offset_size;
+        double rate;
+
+        switch (par->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            rate = av_q2d(s->streams[i]->avg_frame_rate);
+            if (rate <= 0)
+                rate = av_q2d(s->streams[i]->r_frame_rate);
+            if (rate <= 0)
+                rate = 60;
+            /* ctts, stss and variable durations */
+            sample_size += 16;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            rate = par->sample_rate / (double)(par->frame_size > 0 ? par->frame_size : 1024);
+            break;
+        default:
+            rate = 2;
+            break;
+        }
+        size += 1024 + par->extradata_size + sample_size * rate *
+                estimate_stream_duration(s, s->streams[i]) / AV_TIME_BASE;
+    }
+
+    return size > INT_MAX ? 0 : size;
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -6512,6 +6580,19 @@ static int mov_write_header(AVFormatContext *s)
             return ret;
     }
 
+    if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV && !mov->reserved_moov_size) {
+        mov->reserved_moov_size = estimate_moov_size(s);
+        if (!mov->reserved_moov_size) {
+            av_log(s, AV_LOG_WARNING, "Unknown duration, the moov atom will "
+                   "be moved to the beginning of the file in a second pass\n");
+            mov->flags |= FF_MOV_FLAG_FASTSTART;
+            mov->reserved_moov_size = -1;
+        } else {
+            av_log(s, AV_LOG_VERBOSE, "Reserving %d bytes for the moov atom\n",
+                   mov->reserved_moov_size);
+        }
+    }
+
     if (mov->reserved_moov_size){
         mov->reserved_header_pos = avio_tell(pb);
         if (mov->reserved_moov_size > 0)
@@ -6659,28 +6740,25 @@ static int compute_sidx_size(AVFormatContext *s)
     return sidx_size;
 }
 
-static int shift_data(AVFormatContext *s)
+/*
+ * Move the data from pos to pos_end forward by shift bytes.
+ */
+static int move_data(AVFormatContext *s, int64_t pos, int64_t pos_end, int shift)
 {
-    int ret = 0, moov_size;
-    MOVMuxContext *mov = s->priv_data;
-    int64_t pos, pos_end = avio_tell(s->pb);
+    int ret = 0;
     uint8_t *buf, *read_buf[2];
     int read_buf_id = 0;
     int read_size[2];
+    /* blocks must be at least as large as the shift, as each one is read
+     * before the previous one is written */
+    int block_size = FFMAX(shift, 1 << 16);
     AVIOContext *read_pb;
 
-    if (mov->flags & FF_MOV_FLAG_FRAGMENT)
-        moov_size = compute_sidx_size(s);
-    else
-        moov_size = compute_moov_size(s);
-    if (moov_size < 0)
-        return moov_size;
-
-    buf = av_malloc(moov_size * 2);
+    buf = av_malloc(block_size * 2);
     if (!buf)
         return AVERROR(ENOMEM);
     read_buf[0] = buf;
-    read_buf[1] = buf + moov_size;
+    read_buf[1] = buf + block_size;
 
     /* Shift the data: the AVIO context of the output can only be used for
      * writing, so we re-open the same output, but for reading. It also avoids
@@ -6693,21 +6771,18 @@ static int shift_data(AVFormatContext *s)
         goto end;
     }
 
-    /* mark the end of the shift to up to the last data we wrote, and get ready
-     * for writing */
-    pos_end = avio_tell(s->pb);
-    avio_seek(s->pb, mov->reserved_header_pos + moov_size, SEEK_SET);
+    /* get ready for writing */
+    avio_seek(s->pb, pos + shift, SEEK_SET);
 
-    /* start reading at where the new moov will be placed */
-    avio_seek(read_pb, mov->reserved_header_pos, SEEK_SET);
-    pos = avio_tell(read_pb);
+    /* start reading at the first data to move */
+    avio_seek(read_pb, pos, SEEK_SET);
 
 #define READ_BLOCK do {                                                             \
-    read_size[read_buf_id] = avio_read(read_pb, read_buf[read_buf_id], moov_size);  \
+    read_size[read_buf_id] = avio_read(read_pb, read_buf[read_buf_id], block_size); \
     read_buf_id ^= 1;                                                               \
 } while (0)
 
-    /* shift data by chunk of at most moov_size */
+    /* shift data by chunk of at most block_size */
     READ_BLOCK;
     do {
         int n;
@@ -6715,6 +6790,7 @@ static int shift_data(AVFormatContext *s)
         n = read_size[read_buf_id];
         if (n <= 0)
             break;
+        n = FFMIN(n, pos_end - pos);
         avio_write(s->pb, read_buf[read_buf_id], n);
         pos += n;
     } while (pos < pos_end);
@@ -6725,6 +6801,61 @@ end:
     return ret;
 }
 
+static int shift_data(AVFormatContext *s)
+{
+    int moov_size;
+    MOVMuxContext *mov = s->priv_data;
+    /* shift up to the last data we wrote */
+    int64_t pos_end = avio_tell(s->pb);
+
+    if (mov->flags & FF_MOV_FLAG_FRAGMENT)
+        moov_size = compute_sidx_size(s);
+    else
+        moov_size = compute_moov_size(s);
+    if (moov_size < 0)
+        return moov_size;
+
+    return move_data(s, mov->reserved_header_pos, pos_end, moov_size);
+}
+
+/*
+ * Make the space reserved for the moov atom large enough for it and a
+ * free atom, by moving the data after it if needed. This also updates the
+ * chunk offset tables.
+ */
+static int grow_reserved_moov(AVFormatContext *s, int64_t pos_end)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int i, moov_size, shift = 0, ret;
+
+    while (1) {
+        int missing;
+
+        moov_size = get_moov_size(s);
+        if (moov_size < 0)
+            return moov_size;
+        missing = moov_size + 8 - (mov->reserved_moov_size + shift);
+        if (missing <= 0)
+            break;
+        /* the chunk offsets may switch from stco to co64 when shifted, so
+         * the size is checked again */
+        for (i = 0; i < mov->nb_streams; i++)
+            mov->tracks[i].data_offset += missing;
+        shift += missing;
+    }
+    if (!shift)
+        return 0;
+
+    av_log(s, AV_LOG_INFO, "Reserved moov size is %d bytes too small, "
+           "moving the data in a second pass\n", shift);
+    ret = move_data(s, mov->reserved_header_pos + mov->reserved_moov_size,
+                    pos_end, shift);
+    if (ret < 0)
+        return ret;
+    mov->reserved_moov_size += shift;
+    return shift;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6800,6 +6931,12 @@ static int mov_write_trailer(AVFormatContext *s)
                 return res;
         } else if (mov->reserved_moov_size > 0) {
             int64_t size;
+            if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV) {
+                if ((res = grow_reserved_moov(s, moov_pos)) < 0)
+                    return res;
+                moov_pos += res;
+                avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+            }
             if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
                 return res;
             size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_header_pos);
@@ -157,6 +157,13 @@ struct MpegTSContext {
     int resync_size;
     int merge_pmt_versions;
 
+    /** lists of the programs and PIDs to demux, all if not set */
+    char *programs_str;
+    char *pids_str;
+    /** bitmaps parsed from the lists above, NULL if not set */
+    uint8_t *selected_programs;
+    uint8_t *selected_pids;
+
     /******************************************/
     /* private mpegts data */
     /* scan context */
@@ -191,6 +198,10 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"skip_clear", "skip clearing programs", offsetof(MpegTSContext, skip_clear), AV_OPT_TYPE_BOOL,
      {.i64 = 0}, 0, 1, 0 },
+    {"programs", "comma separated list of the program numbers to demux", offsetof(MpegTSContext, programs_str), AV_OPT_TYPE_STRING,
+     {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
+    {"pids", "comma separated list of the elementary stream PIDs to demux", offsetof(MpegTSContext, pids_str), AV_OPT_TYPE_STRING,
+     {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -368,6 +379,41 @@ static void update_av_program_info(AVFormatContext *s, unsigned int programid,
     }
 }
 
+/**
+ * Check whether id is set in a bitmap from parse_selection(), a NULL map
+ * selects everything.
+ */
+static int is_selected(const uint8_t *map, unsigned int id)
+{
+    return !map || map[id >> 3] & (1 << (id & 7));
+}
+
+/**
+ * Parse a comma separated list of ids into a bitmap.
+ */
+static int parse_selection(AVFormatContext *s, const char *list,
+                           unsigned int max, uint8_t **map)
+{
+    const char *p = list;
+
+    if (!list || !*list)
+        return 0;
+    *map = av_mallocz(max / 8 + 1);
+    if (!*map)
+        return AVERROR(ENOMEM);
+    while (*p) {
+        char *end;
+        long id = strtol(p, &end, 0);
+        if (end == p || id < 0 || id > max || (*end && *end != ',')) {
+            av_log(s, AV_LOG_ERROR, "Invalid id list '%s'\n", list);
+            return AVERROR(EINVAL);
+        }
+        (*map)[id >> 3] |= 1 << (id & 7);
+        p = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
 /**
  * @brief discard_pid() decides if the pid is to be discarded according
  *                      to caller's programs selection
@@ -2253,6 +2299,8 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
     if (ts->skip_unknown_pmt && !get_program(ts, h->id))
         return;
+    if (!is_selected(ts->selected_programs, h->id))
+        return;
     if (!ts->skip_clear)
         clear_program(ts, h->id);
 
@@ -2316,6 +2364,17 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         if (pid == ts->current_pid)
             goto out;
 
+        if (!is_selected(ts->selected_pids, pid)) {
+            /* skip the descriptors, no filter is opened for this pid */
+            desc_list_len = get16(&p, p_end);
+            if (desc_list_len < 0)
+                goto out;
+            p += desc_list_len & 0xfff;
+            if (p > p_end)
+                goto out;
+            continue;
+        }
+
         if (ts->merge_pmt_versions)
             stream_identifier = parse_stream_identifier_desc(p, p_end);
 
@@ -2468,6 +2527,8 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
         if (sid == 0x0000) {
             /* NIT info */
+        } else if (!is_selected(ts->selected_programs, sid)) {
+            av_log(ts->stream, AV_LOG_TRACE, "skipping program 0x%x\n", sid);
         } else {
             MpegTSFilter *fil = ts->pids[pmt_pid];
             program = av_new_program(ts->stream, sid);
@@ -2619,7 +2680,7 @@ static void sdt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
                 if (!provider_name)
                     break;
                 name = getstr8(&p, p_end);
-                if (name) {
+                if (name && is_selected(ts->selected_programs, sid)) {
                     AVProgram *program = av_new_program(ts->stream, sid);
                     if (program) {
                         av_dict_set(&program->metadata, "service_name", name, 0);
@@ -2643,18 +2704,20 @@ static int parse_pcr(int64_t *ppcr_high, int *ppcr_low,
                      const uint8_t *packet);
 
 /* handle one TS packet */
-static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
+/* handle one TS packet, pos is the position right after it */
+static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 {
     MpegTSFilter *tss;
     int len, pid, cc, expected_cc, cc_ok, afc, is_start, is_discontinuity,
         has_adaptation, has_payload;
     const uint8_t *p, *p_end;
-    int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
-    if (ts->auto_guess && !tss && is_start) {
+    /* with a program selection, only the PIDs of its PMTs are wanted */
+    if (ts->auto_guess && !tss && is_start && !ts->selected_programs &&
+        is_selected(ts->selected_pids, pid)) {
         add_pes_stream(ts, pid, -1);
         tss = ts->pids[pid];
     }
@@ -2716,7 +2779,6 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     if (p >= p_end || !has_payload)
         return 0;
 
-    pos = avio_tell(ts->stream->pb);
     if (pos >= 0) {
         av_assert0(pos >= TS_PACKET_SIZE);
         ts->pos47_full = pos - TS_PACKET_SIZE;
@@ -2833,15 +2895,32 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
         return 0;
     }
 
-    for (i = 0; i < ts->resync_size; i++) {
-        c = avio_r8(pb);
-        if (avio_feof(pb))
-            return AVERROR_EOF;
-        if (c == 0x47) {
-            avio_seek(pb, -1, SEEK_CUR);
+    for (i = 0; i < ts->resync_size;) {
+        /* search the buffered data directly, and only go through
+         * avio_r8() to refill the buffer */
+        int len = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i);
+        const uint8_t *p;
+
+        if (len <= 0) {
+            c = avio_r8(pb);
+            if (avio_feof(pb))
+                return AVERROR_EOF;
+            if (c == 0x47) {
+                avio_seek(pb, -1, SEEK_CUR);
+                reanalyze(s->priv_data);
+                return 0;
+            }
+            i++;
+            continue;
+        }
+        p = memchr(pb->buf_ptr, 0x47, len);
+        if (p) {
+            pb->buf_ptr += p - pb->buf_ptr;
             reanalyze(s->priv_data);
             return 0;
         }
+        pb->buf_ptr += len;
+        i += len;
     }
     av_log(s, AV_LOG_ERROR,
            "max resync size reached, could not find sync byte\n");
@@ -2886,6 +2965,7 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
+    AVIOContext *pb = s->pb;
     uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
     const uint8_t *data;
     int64_t packet_num;
@@ -2924,10 +3004,23 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        /* Take the packets still in the I/O buffer directly from it, which
+         * saves a read, a position lookup and a skip call per packet. */
+        if (pb->buf_end - pb->buf_ptr >= ts->raw_packet_size &&
+            pb->buf_ptr[0] == 0x47) {
+            data         = pb->buf_ptr;
+            pb->buf_ptr += TS_PACKET_SIZE;
+            ret = handle_packet(ts, data, pb->pos - (pb->buf_end - pb->buf_ptr));
+            pb->buf_ptr += ts->raw_packet_size - TS_PACKET_SIZE;
+            if (ret != 0)
+                break;
+            continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
-        ret = handle_packet(ts, data);
+        ret = handle_packet(ts, data, avio_tell(s->pb));
         finished_reading_packet(s, ts->raw_packet_size);
         if (ret != 0)
             break;
@@ -3019,9 +3112,17 @@ static int mpegts_read_header(AVFormatContext *s)
     MpegTSContext *ts = s->priv_data;
     AVIOContext *pb   = s->pb;
     int64_t pos, probesize = s->probesize;
+    int ret;
 
     s->internal->prefer_codec_framerate = 1;
 
+    if ((ret = parse_selection(s, ts->programs_str, 0xffff, &ts->selected_programs)) < 0 ||
+        (ret = parse_selection(s, ts->pids_str, NB_PID_MAX - 1, &ts->selected_pids)) < 0) {
+        av_freep(&ts->selected_programs);
+        av_freep(&ts->selected_pids);
+        return ret;
+    }
+
     if (ffio_ensure_seekback(pb, probesize) < 0)
         av_log(s, AV_LOG_WARNING, "Failed to allocate buffers for seekback\n");
 
@@ -3054,7 +3155,7 @@ static int mpegts_read_header(AVFormatContext *s)
         s->ctx_flags |= AVFMTCTX_NOHEADER;
     } else {
         AVStream *st;
-        int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
+        int pcr_pid, pid, nb_packets, nb_pcrs, pcr_l;
         int64_t pcrs[2], pcr_h;
         int packet_count[2];
         uint8_t packet[TS_PACKET_SIZE];
@@ -3206,6 +3307,9 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+
+    av_freep(&ts->selected_programs);
+    av_freep(&ts->selected_pids);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
@@ -3322,7 +3426,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
             buf++;
             len--;
         } else {
-            handle_packet(ts, buf);
+            handle_packet(ts, buf, avio_tell(ts->stream->pb));
             buf += TS_PACKET_SIZE;
             len -= TS_PACKET_SIZE;
             if (ts->stop_parse == 1)
@@ -1149,6 +1149,33 @@ static uint8_t *get_ts_payload_start(uint8_t *pkt)
         return pkt + 4;
 }
 
+#define PES_BATCH_PACKETS 16
+
+/* Write the full packets in the middle of a PES, which have neither an
+ * adaptation field nor a PES header, with one write per batch. At least one
+ * byte of payload is left for the last packet, which the caller writes.
+ * Returns the size of the payload written. */
+static int mpegts_write_pes_batch(AVFormatContext *s, MpegTSWriteStream *ts_st,
+                                  const uint8_t *payload, int payload_size)
+{
+    uint8_t buf[PES_BATCH_PACKETS * TS_PACKET_SIZE];
+    int nb_packets = FFMIN((payload_size - 1) / (TS_PACKET_SIZE - 4),
+                           PES_BATCH_PACKETS);
+    int i;
+
+    for (i = 0; i < nb_packets; i++) {
+        uint8_t *q = buf + i * TS_PACKET_SIZE;
+        ts_st->cc = ts_st->cc + 1 & 0xf;
+        q[0] = 0x47;
+        q[1] = ts_st->pid >> 8;
+        q[2] = ts_st->pid;
+        q[3] = 0x10 | ts_st->cc; // payload indicator + CC
+        memcpy(q + 4, payload + i * (TS_PACKET_SIZE - 4), TS_PACKET_SIZE - 4);
+    }
+    avio_write(s->pb, buf, nb_packets * TS_PACKET_SIZE);
+    return nb_packets * (TS_PACKET_SIZE - 4);
+}
+
 /* Add a PES header to the front of the payload, and segment into an integer
  * number of TS packets. The final TS packet is padded using an oversized
  * adaptation header to exactly fill the last TS packet.
@@ -1181,6 +1208,20 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
     is_start = 1;
     while (payload_size > 0) {
         int64_t pcr = AV_NOPTS_VALUE;
+
+        /* Without a mux rate, the PCR and the SI retransmissions only depend
+         * on the dts, so after the first packet there is nothing to insert
+         * until the next PES. */
+        if (!is_start && ts->mux_rate <= 1 && !ts->m2ts_mode &&
+            ts->pat_period > 0 && ts->sdt_period > 0 &&
+            payload_size > TS_PACKET_SIZE - 4) {
+            len = mpegts_write_pes_batch(s, ts_st, payload, payload_size);
+            payload      += len;
+            payload_size -= len;
+            if (payload_size > TS_PACKET_SIZE - 4)
+                continue;
+        }
+
         if (ts->mux_rate > 1)
             pcr = get_pcr(ts, s->pb);
         else if (dts != AV_NOPTS_VALUE)
@@ -36,6 +36,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/time.h"
+#include "libavutil/trace.h"
 #include "riff.h"
 #include "audiointerleave.h"
 #include "url.h"
@@ -382,6 +383,10 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT)
             s->internal->nb_interleaved_streams++;
+        if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+            par->codec_id != AV_CODEC_ID_VP8 &&
+            par->codec_id != AV_CODEC_ID_VP9)
+            s->internal->nb_delaying_streams++;
     }
 
     if (!s->priv_data && of->priv_data_size > 0) {
@@ -923,30 +928,41 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
 
 #define CHUNK_START 0x1000
 
-int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
-                             int (*compare)(AVFormatContext *, const AVPacket *, const AVPacket *))
+static AVPacketList *alloc_packet_list(AVPacket *pkt, int *ret)
 {
-    int ret;
-    AVPacketList **next_point, *this_pktl;
-    AVStream *st   = s->streams[pkt->stream_index];
-    int chunked    = s->max_chunk_size || s->max_chunk_duration;
+    AVPacketList *pktl = av_mallocz(sizeof(AVPacketList));
 
-    this_pktl      = av_mallocz(sizeof(AVPacketList));
-    if (!this_pktl)
-        return AVERROR(ENOMEM);
+    *ret = AVERROR(ENOMEM);
+    if (!pktl)
+        return NULL;
     if ((pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
         av_assert0(pkt->size == UNCODED_FRAME_PACKET_SIZE);
         av_assert0(((AVFrame *)pkt->data)->buf);
-        this_pktl->pkt = *pkt;
+        pktl->pkt = *pkt;
         pkt->buf = NULL;
         pkt->side_data = NULL;
         pkt->side_data_elems = 0;
     } else {
-        if ((ret = av_packet_ref(&this_pktl->pkt, pkt)) < 0) {
-            av_free(this_pktl);
-            return ret;
+        if ((*ret = av_packet_ref(&pktl->pkt, pkt)) < 0) {
+            av_free(pktl);
+            return NULL;
         }
     }
+    *ret = 0;
+    return pktl;
+}
+
+int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
+                             int (*compare)(AVFormatContext *, const AVPacket *, const AVPacket *))
+{
+    int ret;
+    AVPacketList **next_point, *this_pktl;
+    AVStream *st   = s->streams[pkt->stream_index];
+    int chunked    = s->max_chunk_size || s->max_chunk_duration;
+
+    this_pktl      = alloc_packet_list(pkt, &ret);
+    if (!this_pktl)
+        return ret;
 
     if (s->streams[pkt->stream_index]->last_in_packet_buffer) {
         next_point = &(st->last_in_packet_buffer->next);
@@ -1031,6 +1047,161 @@ static int interleave_compare_dts(AVFormatContext *s, const AVPacket *next,
     return comp > 0;
 }
 
+/*
+ * Without chunking or a custom interleaver, the packets are kept in a queue
+ * per stream and the streams in a heap ordered by their first packet, so
+ * that queuing and outputting a packet cost O(log(nb_streams)) instead of
+ * a walk through the single list of all the buffered packets.
+ */
+static int use_interleave_heap(AVFormatContext *s)
+{
+    return !s->oformat->interleave_packet &&
+           !s->max_chunk_size && !s->max_chunk_duration;
+}
+
+static int heap_is_before(AVFormatContext *s, int a, int b)
+{
+    return interleave_compare_dts(s, &s->streams[b]->internal->interleave_queue->pkt,
+                                     &s->streams[a]->internal->interleave_queue->pkt);
+}
+
+static void heap_sift_up(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+
+    while (i > 0) {
+        int parent = (i - 1) >> 1;
+        if (!heap_is_before(s, heap[i], heap[parent]))
+            break;
+        FFSWAP(int, heap[i], heap[parent]);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+    int n     = s->internal->nb_interleave_heap;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && heap_is_before(s, heap[child + 1], heap[child]))
+            child++;
+        if (!heap_is_before(s, heap[child], heap[i]))
+            break;
+        FFSWAP(int, heap[i], heap[child]);
+        i = child;
+    }
+}
+
+static int is_delaying_stream(const AVStream *st)
+{
+    return st->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           st->codecpar->codec_id != AV_CODEC_ID_VP8 &&
+           st->codecpar->codec_id != AV_CODEC_ID_VP9;
+}
+
+static int interleave_queue_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    AVFormatInternal *si = s->internal;
+    AVStream *st = s->streams[pkt->stream_index];
+    AVPacketList *pktl;
+    int64_t dts;
+    int ret;
+
+    if (!si->interleave_heap) {
+        si->interleave_heap = av_malloc_array(s->nb_streams, sizeof(*si->interleave_heap));
+        if (!si->interleave_heap)
+            return AVERROR(ENOMEM);
+    }
+
+    pktl = alloc_packet_list(pkt, &ret);
+    if (!pktl)
+        return ret;
+
+    dts = av_rescale_q(pktl->pkt.dts, st->time_base, AV_TIME_BASE_Q);
+    if (!si->nb_interleave_heap || dts > si->interleave_max_dts)
+        si->interleave_max_dts = dts;
+
+    if (st->last_in_packet_buffer) {
+        st->last_in_packet_buffer->next = pktl;
+    } else {
+        st->internal->interleave_queue = pktl;
+        si->interleave_heap[si->nb_interleave_heap++] = st->index;
+        si->nb_delaying_queued += is_delaying_stream(st);
+        heap_sift_up(s, si->nb_interleave_heap - 1);
+    }
+    st->last_in_packet_buffer = pktl;
+
+    av_packet_unref(pkt);
+    return 0;
+}
+
+/**
+ * @return the first buffered packet in interleaving order, or NULL
+ */
+static AVPacketList *interleave_peek_first(AVFormatContext *s)
+{
+    AVFormatInternal *si = s->internal;
+
+    if (!use_interleave_heap(s))
+        return si->packet_buffer;
+    if (!si->nb_interleave_heap)
+        return NULL;
+    return s->streams[si->interleave_heap[0]]->internal->interleave_queue;
+}
+
+/**
+ * Remove the first buffered packet in interleaving order and return it.
+ */
+static AVPacketList *interleave_get_first(AVFormatContext *s)
+{
+    AVFormatInternal *si = s->internal;
+    AVPacketList *pktl;
+    AVStream *st;
+
+    if (!use_interleave_heap(s)) {
+        pktl = si->packet_buffer;
+        st   = s->streams[pktl->pkt.stream_index];
+
+        si->packet_buffer = pktl->next;
+        if (!si->packet_buffer)
+            si->packet_buffer_end = NULL;
+
+        if (st->last_in_packet_buffer == pktl)
+            st->last_in_packet_buffer = NULL;
+        return pktl;
+    }
+
+    st   = s->streams[si->interleave_heap[0]];
+    pktl = st->internal->interleave_queue;
+    st->internal->interleave_queue = pktl->next;
+    if (!pktl->next) {
+        int64_t dts = av_rescale_q(pktl->pkt.dts, st->time_base, AV_TIME_BASE_Q);
+        int i;
+
+        st->last_in_packet_buffer = NULL;
+        si->nb_delaying_queued   -= is_delaying_stream(st);
+        si->interleave_heap[0]    = si->interleave_heap[--si->nb_interleave_heap];
+        /* the largest dts may only leave along with the last packet of its
+         * stream, which is rare enough to look for the new one */
+        if (dts >= si->interleave_max_dts) {
+            si->interleave_max_dts = INT64_MIN;
+            for (i = 0; i < si->nb_interleave_heap; i++) {
+                const AVStream *st2 = s->streams[si->interleave_heap[i]];
+                si->interleave_max_dts = FFMAX(si->interleave_max_dts,
+                                               av_rescale_q(st2->last_in_packet_buffer->pkt.dts,
+                                                            st2->time_base, AV_TIME_BASE_Q));
+            }
+        }
+    }
+    pktl->next = NULL;
+    heap_sift_down(s, 0);
+    return pktl;
+}
+
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush)
 {
@@ -1039,47 +1210,61 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     int noninterleaved_count = 0;
     int i, ret;
     int eof = flush;
+    int heap = use_interleave_heap(s);
 
     if (pkt) {
-        if ((ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts)) < 0)
+        if (heap)
+            ret = interleave_queue_packet(s, pkt);
+        else
+            ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts);
+        if (ret < 0)
             return ret;
     }
 
-    for (i = 0; i < s->nb_streams; i++) {
-        if (s->streams[i]->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP8 &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP9) {
-            ++noninterleaved_count;
+    if (heap) {
+        stream_count         = s->internal->nb_interleave_heap;
+        noninterleaved_count = s->internal->nb_delaying_streams -
+                               s->internal->nb_delaying_queued;
+    } else {
+        for (i = 0; i < s->nb_streams; i++) {
+            if (s->streams[i]->last_in_packet_buffer) {
+                ++stream_count;
+            } else if (is_delaying_stream(s->streams[i])) {
+                ++noninterleaved_count;
+            }
         }
     }
 
     if (s->internal->nb_interleaved_streams == stream_count)
         flush = 1;
 
+    pktl = interleave_peek_first(s);
     if (s->max_interleave_delta > 0 &&
-        s->internal->packet_buffer &&
+        pktl &&
         !flush &&
         s->internal->nb_interleaved_streams == stream_count+noninterleaved_count
     ) {
-        AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
+        AVPacket *top_pkt = &pktl->pkt;
         int64_t delta_dts = INT64_MIN;
         int64_t top_dts = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
 
-        for (i = 0; i < s->nb_streams; i++) {
-            int64_t last_dts;
-            const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
+        if (heap) {
+            delta_dts = s->internal->interleave_max_dts - top_dts;
+        } else {
+            for (i = 0; i < s->nb_streams; i++) {
+                int64_t last_dts;
+                const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
 
-            if (!last)
-                continue;
+                if (!last)
+                    continue;
 
-            last_dts = av_rescale_q(last->pkt.dts,
-                                    s->streams[i]->time_base,
-                                    AV_TIME_BASE_Q);
-            delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+                last_dts = av_rescale_q(last->pkt.dts,
+                                        s->streams[i]->time_base,
+                                        AV_TIME_BASE_Q);
+                delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+            }
         }
 
         if (delta_dts > s->max_interleave_delta) {
@@ -1091,11 +1276,11 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
         }
     }
 
-    if (s->internal->packet_buffer &&
+    if (pktl &&
         eof &&
         (s->flags & AVFMT_FLAG_SHORTEST) &&
         s->internal->shortest_end == AV_NOPTS_VALUE) {
-        AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
+        AVPacket *top_pkt = &pktl->pkt;
 
         s->internal->shortest_end = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
@@ -1103,9 +1288,8 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     }
 
     if (s->internal->shortest_end != AV_NOPTS_VALUE) {
-        while (s->internal->packet_buffer) {
-            AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
-            AVStream *st;
+        while ((pktl = interleave_peek_first(s))) {
+            AVPacket *top_pkt = &pktl->pkt;
             int64_t top_dts = av_rescale_q(top_pkt->dts,
                                         s->streams[top_pkt->stream_index]->time_base,
                                         AV_TIME_BASE_Q);
@@ -1113,16 +1297,7 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
             if (s->internal->shortest_end + 1 >= top_dts)
                 break;
 
-            pktl = s->internal->packet_buffer;
-            st   = s->streams[pktl->pkt.stream_index];
-
-            s->internal->packet_buffer = pktl->next;
-            if (!s->internal->packet_buffer)
-                s->internal->packet_buffer_end = NULL;
-
-            if (st->last_in_packet_buffer == pktl)
-                st->last_in_packet_buffer = NULL;
-
+            pktl = interleave_get_first(s);
             av_packet_unref(&pktl->pkt);
             av_freep(&pktl);
             flush = 0;
@@ -1130,17 +1305,8 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
     }
 
     if (stream_count && flush) {
-        AVStream *st;
-        pktl = s->internal->packet_buffer;
+        pktl = interleave_get_first(s);
         *out = pktl->pkt;
-        st   = s->streams[out->stream_index];
-
-        s->internal->packet_buffer = pktl->next;
-        if (!s->internal->packet_buffer)
-            s->internal->packet_buffer_end = NULL;
-
-        if (st->last_in_packet_buffer == pktl)
-            st->last_in_packet_buffer = NULL;
         av_freep(&pktl);
 
         return 1;
@@ -1154,6 +1320,9 @@ int ff_interleaved_peek(AVFormatContext *s, int stream,
                         AVPacket *pkt, int add_offset)
 {
     AVPacketList *pktl = s->internal->packet_buffer;
+
+    if (use_interleave_heap(s))
+        pktl = s->streams[stream]->internal->interleave_queue;
     while (pktl) {
         if (pktl->pkt.stream_index == stream) {
             *pkt = pktl->pkt;
@@ -1196,7 +1365,7 @@ static int interleave_packet(AVFormatContext *s, AVPacket *out, AVPacket *in, in
         return ff_interleave_packet_per_dts(s, out, in, flush);
 }
 
-int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+static int interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
 {
     int ret, flush = 0;
 
@@ -1258,6 +1427,16 @@ fail:
     return ret;
 }
 
+int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    int ret;
+
+    av_trace_begin("interleaved_write_frame", pkt ? pkt->pts : AV_NOPTS_VALUE);
+    ret = interleaved_write_frame(s, pkt);
+    av_trace_end("interleaved_write_frame");
+    return ret;
+}
+
 int av_write_trailer(AVFormatContext *s)
 {
     int ret, i;
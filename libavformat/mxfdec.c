@@ -261,6 +261,9 @@ typedef struct MXFIndexTable {
     int64_t *ptses;             /* maps EditUnit -> PTS */
     int nb_segments;
     MXFIndexTableSegment **segments;    /* sorted by IndexStartPosition */
+    int64_t *segment_ends;      /* largest end EditUnit of segments 0..i */
+    int64_t *segment_offsets;   /* StreamOffset of segment i according to the CBR segments before it */
+    int last_segment;           /* segment found by the last EditUnit lookup */
     AVIndexEntry *fake_index;   /* used for calling ff_index_search_timestamp() */
     int8_t *offsets;            /* temporal offsets for display order to stored order conversion */
 } MXFIndexTable;
@@ -1413,11 +1416,32 @@ static MXFWrappingScheme mxf_get_wrapping_kind(UID *essence_container_ul)
     return UnknownWrapped;
 }
 
+typedef struct MXFSortedSegment {
+    MXFIndexTableSegment *segment;
+    int pos;
+} MXFSortedSegment;
+
+static int mxf_compare_segments(const void *a, const void *b)
+{
+    const MXFSortedSegment *sa = a, *sb = b;
+    const MXFIndexTableSegment *s1 = sa->segment, *s2 = sb->segment;
+
+    if (s1->body_sid != s2->body_sid)
+        return FFDIFFSIGN(s1->body_sid, s2->body_sid);
+    if (s1->index_sid != s2->index_sid)
+        return FFDIFFSIGN(s1->index_sid, s2->index_sid);
+    if (s1->index_start_position != s2->index_start_position)
+        return FFDIFFSIGN(s1->index_start_position, s2->index_start_position);
+    /* prefer the longest of the segments starting at the same position */
+    if (s1->index_duration != s2->index_duration)
+        return FFDIFFSIGN(s2->index_duration, s1->index_duration);
+    return FFDIFFSIGN(sa->pos, sb->pos);
+}
+
 static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segments, MXFIndexTableSegment ***sorted_segments)
 {
-    int i, j, nb_segments = 0;
-    MXFIndexTableSegment **unsorted_segments;
-    int last_body_sid = -1, last_index_sid = -1, last_index_start = -1;
+    int i, nb_segments = 0;
+    MXFSortedSegment *unsorted_segments;
 
     /* count number of segments, allocate arrays and copy unsorted segments */
     for (i = 0; i < mxf->metadata_sets_count; i++)
@@ -1437,9 +1461,11 @@ static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segment
     for (i = nb_segments = 0; i < mxf->metadata_sets_count; i++) {
         if (mxf->metadata_sets[i]->type == IndexTableSegment) {
             MXFIndexTableSegment *s = (MXFIndexTableSegment*)mxf->metadata_sets[i];
-            if (s->edit_unit_byte_count || s->nb_index_entries)
-                unsorted_segments[nb_segments++] = s;
-            else
+            if (s->edit_unit_byte_count || s->nb_index_entries) {
+                unsorted_segments[nb_segments].segment = s;
+                unsorted_segments[nb_segments].pos     = nb_segments;
+                nb_segments++;
+            } else
                 av_log(mxf->fc, AV_LOG_WARNING, "IndexSID %i segment at %"PRId64" missing EditUnitByteCount and IndexEntryArray\n",
                        s->index_sid, s->index_start_position);
         }
@@ -1451,45 +1477,25 @@ static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segment
         return AVERROR_INVALIDDATA;
     }
 
-    *nb_sorted_segments = 0;
+    /* sort segments by {BodySID, IndexSID, IndexStartPosition}, remove duplicates while we're at it.
+     * Files with one index segment per body partition can have thousands of them,
+     * so this has to be O(n log n). Of the segments with the same keys the one
+     * with the largest IndexDuration sorts first, and is the one kept.
+     */
+    qsort(unsorted_segments, nb_segments, sizeof(*unsorted_segments), mxf_compare_segments);
 
-    /* sort segments by {BodySID, IndexSID, IndexStartPosition}, remove duplicates while we're at it */
+    *nb_sorted_segments = 0;
     for (i = 0; i < nb_segments; i++) {
-        int best = -1, best_body_sid = -1, best_index_sid = -1, best_index_start = -1;
-        uint64_t best_index_duration = 0;
+        MXFIndexTableSegment *s = unsorted_segments[i].segment;
 
-        for (j = 0; j < nb_segments; j++) {
-            MXFIndexTableSegment *s = unsorted_segments[j];
-
-            /* Require larger BosySID, IndexSID or IndexStartPosition then the previous entry. This removes duplicates.
-             * We want the smallest values for the keys than what we currently have, unless this is the first such entry this time around.
-             * If we come across an entry with the same IndexStartPosition but larger IndexDuration, then we'll prefer it over the one we currently have.
-             */
-            if ((i == 0 ||
-                 s->body_sid >  last_body_sid ||
-                 s->body_sid == last_body_sid && s->index_sid >  last_index_sid ||
-                 s->body_sid == last_body_sid && s->index_sid == last_index_sid && s->index_start_position > last_index_start) &&
-                (best == -1 ||
-                 s->body_sid <  best_body_sid ||
-                 s->body_sid == best_body_sid && s->index_sid <  best_index_sid ||
-                 s->body_sid == best_body_sid && s->index_sid == best_index_sid && s->index_start_position <  best_index_start ||
-                 s->body_sid == best_body_sid && s->index_sid == best_index_sid && s->index_start_position == best_index_start && s->index_duration > best_index_duration)) {
-                best             = j;
-                best_body_sid    = s->body_sid;
-                best_index_sid   = s->index_sid;
-                best_index_start = s->index_start_position;
-                best_index_duration = s->index_duration;
-            }
+        if (*nb_sorted_segments) {
+            MXFIndexTableSegment *last = (*sorted_segments)[*nb_sorted_segments - 1];
+            if (s->body_sid             == last->body_sid  &&
+                s->index_sid            == last->index_sid &&
+                s->index_start_position == last->index_start_position)
+                continue;
         }
-
-        /* no suitable entry found -> we're done */
-        if (best == -1)
-            break;
-
-        (*sorted_segments)[(*nb_sorted_segments)++] = unsorted_segments[best];
-        last_body_sid    = best_body_sid;
-        last_index_sid   = best_index_sid;
-        last_index_start = best_index_start;
+        (*sorted_segments)[(*nb_sorted_segments)++] = s;
     }
 
     av_free(unsorted_segments);
@@ -1563,12 +1569,30 @@ static int64_t mxf_essence_container_end(MXFContext *mxf, int body_sid)
 /* EditUnit -> absolute offset */
 static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_table, int64_t edit_unit, AVRational edit_rate, int64_t *edit_unit_out, int64_t *offset_out, MXFPartition **partition_out, int nag)
 {
-    int i;
-    int64_t offset_temp = 0;
+    const int64_t *ends = index_table->segment_ends;
+    int i = index_table->last_segment, a, b, m;
+    int64_t offset_temp;
 
     edit_unit = av_rescale_q(edit_unit, index_table->segments[0]->index_edit_rate, edit_rate);
 
-    for (i = 0; i < index_table->nb_segments; i++) {
+    /* find the first segment ending after edit_unit, reads are mostly
+     * sequential so try the segment of the previous lookup first */
+    if (edit_unit < 0 || edit_unit >= ends[index_table->nb_segments - 1])
+        goto fail;
+    if (ends[i] <= edit_unit || i > 0 && ends[i - 1] > edit_unit) {
+        a = -1;
+        b = index_table->nb_segments - 1;
+        while (b - a > 1) {
+            m = (a + b) >> 1;
+            if (ends[m] > edit_unit)
+                b = m;
+            else
+                a = m;
+        }
+        i = b;
+    }
+
+    for (; i < index_table->nb_segments; i++) {
         MXFIndexTableSegment *s = index_table->segments[i];
 
         edit_unit = FFMAX(edit_unit, s->index_start_position);  /* clamp if trying to seek before start */
@@ -1576,6 +1600,7 @@ static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_t
         if (edit_unit < s->index_start_position + s->index_duration) {
             int64_t index = edit_unit - s->index_start_position;
 
+            offset_temp = index_table->segment_offsets[i];
             if (s->edit_unit_byte_count)
                 offset_temp += s->edit_unit_byte_count * index;
             else {
@@ -1591,22 +1616,49 @@ static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_t
                 offset_temp = s->stream_offset_entries[index];
             }
 
+            index_table->last_segment = i;
+
             if (edit_unit_out)
                 *edit_unit_out = av_rescale_q(edit_unit, edit_rate, s->index_edit_rate);
 
             return mxf_absolute_bodysid_offset(mxf, index_table->body_sid, offset_temp, offset_out, partition_out);
-        } else {
-            /* EditUnitByteCount == 0 for VBR indexes, which is fine since they use explicit StreamOffsets */
-            offset_temp += s->edit_unit_byte_count * s->index_duration;
         }
     }
 
+fail:
     if (nag)
         av_log(mxf->fc, AV_LOG_ERROR, "failed to map EditUnit %"PRId64" in IndexSID %i to an offset\n", edit_unit, index_table->index_sid);
 
     return AVERROR_INVALIDDATA;
 }
 
+/**
+ * Computes the tables used by mxf_edit_unit_absolute_offset() to find the
+ * segment of an EditUnit with a binary search.
+ */
+static int mxf_compute_segment_offsets(MXFIndexTable *index_table)
+{
+    int64_t end = 0, offset = 0;
+    int i;
+
+    index_table->segment_ends    = av_malloc_array(index_table->nb_segments, sizeof(*index_table->segment_ends));
+    index_table->segment_offsets = av_malloc_array(index_table->nb_segments, sizeof(*index_table->segment_offsets));
+    if (!index_table->segment_ends || !index_table->segment_offsets)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < index_table->nb_segments; i++) {
+        MXFIndexTableSegment *s = index_table->segments[i];
+
+        end = FFMAX(end, (int64_t)(s->index_start_position + s->index_duration));
+        index_table->segment_ends[i]    = end;
+        index_table->segment_offsets[i] = offset;
+        /* EditUnitByteCount == 0 for VBR indexes, which is fine since they use explicit StreamOffsets */
+        offset += s->edit_unit_byte_count * s->index_duration;
+    }
+
+    return 0;
+}
+
 static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_table)
 {
     int i, j, x;
@@ -1831,6 +1883,9 @@ static int mxf_compute_index_tables(MXFContext *mxf)
             t->segments[k]->index_duration = mxf_track->original_duration;
             break;
         }
+
+        if ((ret = mxf_compute_segment_offsets(t)) < 0)
+            goto finish_decoding_index;
     }
 
     ret = 0;
@@ -3541,7 +3596,7 @@ static int mxf_read_packet(AVFormatContext *s, AVPacket *pkt)
                     return ret;
                 }
             } else {
-                ret = av_get_packet(s->pb, pkt, klv.length);
+                ret = ff_get_packet_ref(s->pb, pkt, klv.length);
                 if (ret < 0) {
                     mxf->current_klv_data = (KLVPacket){{0}};
                     return ret;
@@ -3592,6 +3647,8 @@ static int mxf_read_close(AVFormatContext *s)
     if (mxf->index_tables) {
         for (i = 0; i < mxf->nb_index_tables; i++) {
             av_freep(&mxf->index_tables[i].segments);
+            av_freep(&mxf->index_tables[i].segment_ends);
+            av_freep(&mxf->index_tables[i].segment_offsets);
             av_freep(&mxf->index_tables[i].ptses);
             av_freep(&mxf->index_tables[i].fake_index);
             av_freep(&mxf->index_tables[i].offsets);
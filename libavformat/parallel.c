@@ -0,0 +1,425 @@
+/*
+ * Parallel byte range reading protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Parallel byte range reading protocol.
+ *
+ * The input is split into chunks of a fixed size which are fetched by
+ * several worker threads, each with its own connection, and handed to the
+ * reader in order. Every chunk is requested with the offset and end_offset
+ * options, so connections to HTTP servers are only kept open across chunks
+ * through the connection pool.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "url.h"
+
+#define MAX_CONNECTIONS  64
+#define READ_BLOCK_SIZE  (64 * 1024)
+
+typedef struct Chunk {
+    uint8_t *buf;
+    int64_t  index;     ///< index of the chunk in the input, -1 if unassigned
+    int      size;      ///< expected size of the chunk
+    int      filled;    ///< number of bytes downloaded so far
+    int      busy;      ///< a worker is downloading into this slot
+    int      discard;   ///< the reader is no longer interested in the data
+    int      error;
+} Chunk;
+
+typedef struct ParallelContext {
+    const AVClass  *class;
+    URLContext     *inner;      ///< only used when the input cannot be split
+    char           *url;
+    AVDictionary   *inner_options;
+
+    int             connections;
+    int             chunk_size;
+
+    int64_t         logical_pos;
+    int64_t         logical_size;
+    int64_t         next_chunk; ///< next chunk to hand to a worker
+
+    Chunk          *chunks;
+    int             nb_chunks;
+    pthread_t      *workers;
+    int             nb_workers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int             abort_request;
+    AVIOInterruptCB interrupt_callback;
+} ParallelContext;
+
+static int parallel_check_interrupt(void *arg)
+{
+    URLContext *h = arg;
+    ParallelContext *c = h->priv_data;
+
+    if (c->abort_request)
+        return 1;
+
+    if (ff_check_interrupt(&c->interrupt_callback))
+        c->abort_request = 1;
+
+    return c->abort_request;
+}
+
+/* must be called with the mutex held */
+static Chunk *find_chunk(ParallelContext *c, int64_t index)
+{
+    int i;
+
+    for (i = 0; i < c->nb_chunks; i++)
+        if (c->chunks[i].index == index)
+            return &c->chunks[i];
+    return NULL;
+}
+
+/* must be called with the mutex held */
+static void restart_at(ParallelContext *c, int64_t index)
+{
+    int i;
+
+    for (i = 0; i < c->nb_chunks; i++) {
+        Chunk *chunk = &c->chunks[i];
+
+        if (chunk->busy)
+            chunk->discard = 1;
+        chunk->index  = -1;
+        chunk->filled = 0;
+        chunk->error  = 0;
+    }
+    c->next_chunk = index;
+    pthread_cond_broadcast(&c->cond);
+}
+
+static int fetch_chunk(URLContext *h, Chunk *chunk, int64_t start)
+{
+    ParallelContext *c = h->priv_data;
+    AVIOInterruptCB interrupt_callback = { .callback = parallel_check_interrupt, .opaque = h };
+    AVDictionary *opts = NULL;
+    URLContext *inner = NULL;
+    int filled = 0, ret;
+
+    av_dict_copy(&opts, c->inner_options, 0);
+    av_dict_set_int(&opts, "offset", start, 0);
+    av_dict_set_int(&opts, "end_offset", start + chunk->size, 0);
+    av_dict_set(&opts, "connection_pool", "1", 0);
+    ret = ffurl_open_whitelist(&inner, c->url, AVIO_FLAG_READ, &interrupt_callback,
+                               &opts, h->protocol_whitelist, h->protocol_blacklist, h);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    if ((ret = ffurl_seek(inner, start, SEEK_SET)) < 0)
+        goto end;
+
+    while (filled < chunk->size) {
+        ret = ffurl_read(inner, chunk->buf + filled,
+                         FFMIN(chunk->size - filled, READ_BLOCK_SIZE));
+        if (ret == 0 || ret == AVERROR_EOF) {
+            av_log(h, AV_LOG_ERROR, "Chunk at %"PRId64" ends prematurely\n", start);
+            ret = AVERROR(EIO);
+        }
+        if (ret < 0)
+            goto end;
+        filled += ret;
+
+        pthread_mutex_lock(&c->mutex);
+        if (chunk->discard || c->abort_request) {
+            pthread_mutex_unlock(&c->mutex);
+            break;
+        }
+        chunk->filled = filled;
+        pthread_cond_broadcast(&c->cond);
+        pthread_mutex_unlock(&c->mutex);
+    }
+    ret = 0;
+
+end:
+    ffurl_closep(&inner);
+    return ret;
+}
+
+static void *parallel_worker(void *arg)
+{
+    URLContext *h = arg;
+    ParallelContext *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort_request) {
+        Chunk *chunk = NULL;
+        int64_t start;
+        int i, ret;
+
+        /* chunks before the read position are kept for short backward
+         * seeks until their slot is needed */
+        if (c->next_chunk * c->chunk_size < c->logical_size) {
+            int64_t current = c->logical_pos / c->chunk_size;
+
+            for (i = 0; i < c->nb_chunks; i++) {
+                Chunk *slot = &c->chunks[i];
+
+                if (!slot->busy && slot->index < current &&
+                    (!chunk || slot->index < chunk->index))
+                    chunk = slot;
+            }
+        }
+        if (!chunk) {
+            pthread_cond_wait(&c->cond, &c->mutex);
+            continue;
+        }
+
+        chunk->index  = c->next_chunk++;
+        chunk->busy   = 1;
+        chunk->filled = 0;
+        chunk->error  = 0;
+        start         = chunk->index * c->chunk_size;
+        chunk->size   = FFMIN(c->chunk_size, c->logical_size - start);
+        pthread_mutex_unlock(&c->mutex);
+
+        ret = fetch_chunk(h, chunk, start);
+
+        pthread_mutex_lock(&c->mutex);
+        if (!chunk->discard && ret < 0)
+            chunk->error = ret;
+        chunk->busy    = 0;
+        chunk->discard = 0;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static int parallel_close(URLContext *h)
+{
+    ParallelContext *c = h->priv_data;
+    int i;
+
+    if (c->nb_workers) {
+        pthread_mutex_lock(&c->mutex);
+        c->abort_request = 1;
+        pthread_cond_broadcast(&c->cond);
+        pthread_mutex_unlock(&c->mutex);
+
+        for (i = 0; i < c->nb_workers; i++)
+            pthread_join(c->workers[i], NULL);
+    }
+    if (c->chunks) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->mutex);
+        for (i = 0; i < c->nb_chunks; i++)
+            av_freep(&c->chunks[i].buf);
+    }
+    av_freep(&c->workers);
+    av_freep(&c->chunks);
+    av_freep(&c->url);
+    av_dict_free(&c->inner_options);
+    ffurl_closep(&c->inner);
+    return 0;
+}
+
+static int parallel_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    ParallelContext *c = h->priv_data;
+    AVIOInterruptCB interrupt_callback = { .callback = parallel_check_interrupt, .opaque = h };
+    int i, ret;
+
+    av_strstart(arg, "parallel:", &arg);
+
+    /* wrap interrupt callback */
+    c->interrupt_callback = h->interrupt_callback;
+
+    if (!(c->url = av_strdup(arg))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if (options && (ret = av_dict_copy(&c->inner_options, *options, 0)) < 0)
+        goto fail;
+
+    ret = ffurl_open_whitelist(&c->inner, arg, flags, &interrupt_callback, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (ret < 0)
+        goto fail;
+
+    c->logical_size = ffurl_size(c->inner);
+    if (c->connections < 2 || c->logical_size <= c->chunk_size ||
+        c->inner->is_streamed) {
+        av_log(h, AV_LOG_VERBOSE, "Not splitting the input\n");
+        h->is_streamed = c->inner->is_streamed;
+        return 0;
+    }
+    ffurl_closep(&c->inner);
+
+    if ((ret = pthread_mutex_init(&c->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&c->cond, NULL))) {
+        pthread_mutex_destroy(&c->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    c->nb_chunks = c->connections + 1;
+    if (!(c->chunks = av_mallocz_array(c->nb_chunks, sizeof(*c->chunks)))) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->mutex);
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < c->nb_chunks; i++) {
+        c->chunks[i].index = -1;
+        if (!(c->chunks[i].buf = av_malloc(c->chunk_size))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    if (!(c->workers = av_mallocz_array(c->connections, sizeof(*c->workers)))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (; c->nb_workers < c->connections; c->nb_workers++) {
+        if ((ret = pthread_create(&c->workers[c->nb_workers], NULL, parallel_worker, h))) {
+            av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+
+    return 0;
+fail:
+    parallel_close(h);
+    return ret;
+}
+
+static int parallel_read(URLContext *h, unsigned char *buf, int size)
+{
+    ParallelContext *c = h->priv_data;
+    int ret;
+
+    if (c->inner)
+        return ffurl_read(c->inner, buf, size);
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int64_t index = c->logical_pos / c->chunk_size;
+        int offset    = c->logical_pos % c->chunk_size;
+        Chunk *chunk;
+
+        if (c->logical_pos >= c->logical_size) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        chunk = find_chunk(c, index);
+        if (chunk && chunk->filled > offset) {
+            ret = FFMIN(size, chunk->filled - offset);
+            memcpy(buf, chunk->buf + offset, ret);
+            c->logical_pos += ret;
+            if (offset + ret == chunk->size)
+                pthread_cond_broadcast(&c->cond);
+            break;
+        }
+        if (chunk && chunk->error) {
+            ret = chunk->error;
+            break;
+        }
+        /* after a backward seek the following chunks may have been reused */
+        if (!chunk && index != c->next_chunk)
+            restart_at(c, index);
+        if (parallel_check_interrupt(h)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_wait(&c->cond, &c->mutex);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t parallel_seek(URLContext *h, int64_t pos, int whence)
+{
+    ParallelContext *c = h->priv_data;
+    int64_t index;
+    Chunk *chunk;
+
+    if (c->inner)
+        return ffurl_seek(c->inner, pos, whence);
+
+    if (whence == AVSEEK_SIZE)
+        return c->logical_size;
+    else if (whence == SEEK_CUR)
+        pos += c->logical_pos;
+    else if (whence == SEEK_END)
+        pos += c->logical_size;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+    c->logical_pos = pos;
+    index = pos / c->chunk_size;
+    chunk = find_chunk(c, index);
+    if (pos < c->logical_size && (chunk ? chunk->error : index != c->next_chunk))
+        restart_at(c, index);
+    else
+        pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+
+    return pos;
+}
+
+#define OFFSET(x) offsetof(ParallelContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "connections", "number of chunks which are fetched at the same time", OFFSET(connections), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, MAX_CONNECTIONS, D },
+    { "range_size", "size of the byte ranges which are requested", OFFSET(chunk_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, READ_BLOCK_SIZE, INT_MAX / 2, D },
+    { NULL },
+};
+
+#undef D
+#undef OFFSET
+
+static const AVClass parallel_context_class = {
+    .class_name = "Parallel",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+const URLProtocol ff_parallel_protocol = {
+    .name                = "parallel",
+    .url_open2           = parallel_open,
+    .url_read            = parallel_read,
+    .url_seek            = parallel_seek,
+    .url_close           = parallel_close,
+    .priv_data_size      = sizeof(ParallelContext),
+    .priv_data_class     = &parallel_context_class,
+};
@@ -0,0 +1,384 @@
+/*
+ * Background segment prefetching for segmented stream demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "avio_internal.h"
+#include "internal.h"
+#include "prefetch.h"
+
+#if HAVE_THREADS
+
+#define PREFETCH_CHUNK_SIZE 32768
+
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE,
+};
+
+typedef struct PrefetchSegment {
+    enum PrefetchState state;
+    int stale;              ///< dropped while running, the result is discarded
+    int64_t id;
+    char *url;
+    int64_t offset;
+    int64_t size;
+    uint8_t *data;
+    int data_size;
+    int ret;
+} PrefetchSegment;
+
+struct FFPrefetch {
+    AVFormatContext *s;
+    FFPrefetchOpenFunc open;
+    void *opaque;
+    AVDictionary *opts;
+    int keepalive;
+
+    PrefetchSegment *segments;
+    int nb_segments;
+
+    AVIOContext *pb;        ///< only accessed by the prefetch thread
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int abort;
+};
+
+static void reset_segment(PrefetchSegment *seg)
+{
+    av_freep(&seg->url);
+    av_freep(&seg->data);
+    seg->data_size = 0;
+    seg->stale     = 0;
+    seg->state     = PREFETCH_FREE;
+}
+
+static int download(FFPrefetch *pf, PrefetchSegment *seg, const char *url,
+                    int64_t offset, int64_t size)
+{
+    uint8_t buf[PREFETCH_CHUNK_SIZE];
+    AVIOContext *dyn = NULL;
+    uint8_t *data;
+    int64_t total = 0;
+    int ret, stop = 0;
+
+    ret = pf->open(pf->opaque, &pf->pb, url, offset, size, &pf->opts);
+    if (ret < 0)
+        return ret;
+
+    ret = avio_open_dyn_buf(&dyn);
+    if (ret < 0)
+        goto end;
+
+    while (!stop && (size < 0 || total < size)) {
+        int len = size < 0 ? sizeof(buf) : FFMIN(sizeof(buf), size - total);
+
+        ret = avio_read(pf->pb, buf, len);
+        if (ret == AVERROR_EOF || !ret)
+            break;
+        if (ret < 0)
+            goto end;
+        avio_write(dyn, buf, ret);
+        total += ret;
+
+        if (ff_check_interrupt(&pf->s->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            goto end;
+        }
+        pthread_mutex_lock(&pf->mutex);
+        stop = pf->abort || seg->stale;
+        pthread_mutex_unlock(&pf->mutex);
+    }
+
+    ret = avio_close_dyn_buf(dyn, &data);
+    dyn = NULL;
+    if (!data) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (stop) {
+        av_free(data);
+        ret = AVERROR_EXIT;
+        goto end;
+    }
+
+    pthread_mutex_lock(&pf->mutex);
+    seg->data      = data;
+    seg->data_size = ret;
+    pthread_mutex_unlock(&pf->mutex);
+    ret = 0;
+
+end:
+    if (dyn)
+        ffio_free_dyn_buf(&dyn);
+    /* only HTTP connections can be reused for the next request, and only
+     * if this one was read to the end */
+    if (ret < 0 || !pf->keepalive || !av_strstart(url, "http", NULL))
+        ff_format_io_close(pf->s, &pf->pb);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    FFPrefetch *pf = arg;
+
+    pthread_mutex_lock(&pf->mutex);
+    while (!pf->abort) {
+        PrefetchSegment *seg = NULL;
+        char *url;
+        int64_t offset, size;
+        int i, ret;
+
+        for (i = 0; i < pf->nb_segments; i++) {
+            PrefetchSegment *cur = &pf->segments[i];
+            if (cur->state == PREFETCH_QUEUED && (!seg || cur->id < seg->id))
+                seg = cur;
+        }
+        if (!seg) {
+            pthread_cond_wait(&pf->cond, &pf->mutex);
+            continue;
+        }
+
+        /* The segment is only freed by the caller once it is done, so its
+         * fields can be used without the lock while downloading. */
+        seg->state = PREFETCH_RUNNING;
+        url    = seg->url;
+        offset = seg->offset;
+        size   = seg->size;
+        pthread_mutex_unlock(&pf->mutex);
+
+        av_log(pf->s, AV_LOG_DEBUG, "Prefetching segment %"PRId64" from '%s'\n",
+               seg->id, url);
+        ret = download(pf, seg, url, offset, size);
+
+        pthread_mutex_lock(&pf->mutex);
+        if (seg->stale) {
+            reset_segment(seg);
+        } else {
+            seg->ret   = ret;
+            seg->state = PREFETCH_DONE;
+        }
+        pthread_cond_broadcast(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    return NULL;
+}
+
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s, int depth,
+                      FFPrefetchOpenFunc open, void *opaque,
+                      AVDictionary *opts, int keepalive)
+{
+    FFPrefetch *pf;
+    int ret;
+
+    pf = av_mallocz(sizeof(*pf));
+    if (!pf)
+        return AVERROR(ENOMEM);
+
+    pf->segments = av_mallocz_array(depth, sizeof(*pf->segments));
+    if (!pf->segments) {
+        av_free(pf);
+        return AVERROR(ENOMEM);
+    }
+    pf->nb_segments = depth;
+    pf->s           = s;
+    pf->open        = open;
+    pf->opaque      = opaque;
+    pf->keepalive   = keepalive;
+
+    ret = av_dict_copy(&pf->opts, opts, 0);
+    if (ret < 0)
+        goto fail;
+
+    if ((ret = pthread_mutex_init(&pf->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&pf->cond, NULL))) {
+        pthread_mutex_destroy(&pf->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_create(&pf->thread, NULL, prefetch_thread, pf))) {
+        pthread_cond_destroy(&pf->cond);
+        pthread_mutex_destroy(&pf->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+
+    *ppf = pf;
+    return 0;
+
+fail:
+    av_dict_free(&pf->opts);
+    av_free(pf->segments);
+    av_free(pf);
+    return ret;
+}
+
+int ff_prefetch_add(FFPrefetch *pf, int64_t id, const char *url,
+                    int64_t offset, int64_t size)
+{
+    PrefetchSegment *seg = NULL;
+    int i, ret = 0;
+
+    pthread_mutex_lock(&pf->mutex);
+    for (i = 0; i < pf->nb_segments; i++) {
+        PrefetchSegment *cur = &pf->segments[i];
+        if (cur->state != PREFETCH_FREE && !cur->stale && cur->id == id)
+            goto end;
+        if (cur->state == PREFETCH_FREE && !seg)
+            seg = cur;
+    }
+    if (!seg)
+        goto end;
+
+    seg->url = av_strdup(url);
+    if (!seg->url) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    seg->id     = id;
+    seg->offset = offset;
+    seg->size   = size;
+    seg->ret    = 0;
+    seg->state  = PREFETCH_QUEUED;
+    pthread_cond_broadcast(&pf->cond);
+    ret = 1;
+
+end:
+    pthread_mutex_unlock(&pf->mutex);
+    return ret;
+}
+
+void ff_prefetch_discard(FFPrefetch *pf, int64_t first, int64_t last)
+{
+    int i;
+
+    pthread_mutex_lock(&pf->mutex);
+    for (i = 0; i < pf->nb_segments; i++) {
+        PrefetchSegment *seg = &pf->segments[i];
+        if (seg->state == PREFETCH_FREE || (seg->id >= first && seg->id <= last))
+            continue;
+        if (seg->state == PREFETCH_RUNNING)
+            seg->stale = 1;
+        else
+            reset_segment(seg);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+}
+
+int ff_prefetch_get(FFPrefetch *pf, int64_t id, uint8_t **data, int *size)
+{
+    PrefetchSegment *seg = NULL;
+    int i, ret = AVERROR(ENOENT);
+
+    pthread_mutex_lock(&pf->mutex);
+    for (i = 0; i < pf->nb_segments; i++) {
+        PrefetchSegment *cur = &pf->segments[i];
+        if (cur->state != PREFETCH_FREE && !cur->stale && cur->id == id) {
+            seg = cur;
+            break;
+        }
+    }
+    if (!seg)
+        goto end;
+
+    if (seg->state == PREFETCH_QUEUED) {
+        reset_segment(seg);
+        goto end;
+    }
+    while (seg->state == PREFETCH_RUNNING)
+        pthread_cond_wait(&pf->cond, &pf->mutex);
+
+    ret = seg->ret;
+    if (ret >= 0) {
+        *data     = seg->data;
+        *size     = seg->data_size;
+        seg->data = NULL;
+    }
+    reset_segment(seg);
+
+end:
+    pthread_mutex_unlock(&pf->mutex);
+    return ret;
+}
+
+void ff_prefetch_free(FFPrefetch **ppf)
+{
+    FFPrefetch *pf = *ppf;
+    int i;
+
+    if (!pf)
+        return;
+
+    pthread_mutex_lock(&pf->mutex);
+    pf->abort = 1;
+    pthread_cond_broadcast(&pf->cond);
+    pthread_mutex_unlock(&pf->mutex);
+    pthread_join(pf->thread, NULL);
+
+    for (i = 0; i < pf->nb_segments; i++)
+        reset_segment(&pf->segments[i]);
+    ff_format_io_close(pf->s, &pf->pb);
+
+    pthread_cond_destroy(&pf->cond);
+    pthread_mutex_destroy(&pf->mutex);
+    av_dict_free(&pf->opts);
+    av_freep(&pf->segments);
+    av_freep(ppf);
+}
+
+#else
+
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s, int depth,
+                      FFPrefetchOpenFunc open, void *opaque,
+                      AVDictionary *opts, int keepalive)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_prefetch_add(FFPrefetch *pf, int64_t id, const char *url,
+                    int64_t offset, int64_t size)
+{
+    return 0;
+}
+
+void ff_prefetch_discard(FFPrefetch *pf, int64_t first, int64_t last)
+{
+}
+
+int ff_prefetch_get(FFPrefetch *pf, int64_t id, uint8_t **data, int *size)
+{
+    return AVERROR(ENOENT);
+}
+
+void ff_prefetch_free(FFPrefetch **ppf)
+{
+}
+
+#endif /* HAVE_THREADS */
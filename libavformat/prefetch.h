@@ -0,0 +1,101 @@
+/*
+ * Background segment prefetching for segmented stream demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_PREFETCH_H
+#define AVFORMAT_PREFETCH_H
+
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+
+#include "avformat.h"
+#include "avio.h"
+
+/**
+ * Downloads the upcoming segments of a segmented stream (HLS, DASH) into
+ * memory on a background thread, so that the demuxer does not have to wait
+ * for a new request at every segment boundary.
+ *
+ * Segments are identified by a caller chosen, increasing id (e.g. the
+ * sequence number) and are downloaded in ascending id order. At most depth
+ * segments are queued or held at any time.
+ */
+typedef struct FFPrefetch FFPrefetch;
+
+/**
+ * Open url for reading the bytes [offset, offset + size) of it, with size
+ * -1 meaning the rest of the resource. This is called on the prefetch
+ * thread, so it must not modify any demuxer state. If *pb is not NULL it
+ * is an HTTP connection left open by the previous request, which may be
+ * reused.
+ */
+typedef int (*FFPrefetchOpenFunc)(void *opaque, AVIOContext **pb,
+                                  const char *url, int64_t offset,
+                                  int64_t size, AVDictionary **opts);
+
+/**
+ * Allocate a prefetcher and start its thread.
+ *
+ * @param s         the demuxer, used for logging, interruption and closing
+ * @param depth     maximum number of segments queued or held at once
+ * @param open      callback opening a segment
+ * @param opaque    passed to open
+ * @param opts      options passed to open, copied
+ * @param keepalive keep HTTP connections open between segments
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s, int depth,
+                      FFPrefetchOpenFunc open, void *opaque,
+                      AVDictionary *opts, int keepalive);
+
+/**
+ * Queue a segment for download. Nothing is done if a segment with this id
+ * is already queued or if the queue is full.
+ *
+ * @return 1 if the segment was queued, 0 if not, a negative AVERROR code
+ *         on failure
+ */
+int ff_prefetch_add(FFPrefetch *pf, int64_t id, const char *url,
+                    int64_t offset, int64_t size);
+
+/**
+ * Drop all segments with an id outside of [first, last].
+ */
+void ff_prefetch_discard(FFPrefetch *pf, int64_t first, int64_t last);
+
+/**
+ * Take the segment with the given id out of the prefetcher, waiting for its
+ * download to finish if it is in progress. A segment which is queued but
+ * not started yet is dropped, as the caller can fetch it just as fast.
+ *
+ * @param data set to the segment data, to be freed with av_free()
+ * @param size set to the size of data
+ * @return 0 on success, AVERROR(ENOENT) if the segment is not available,
+ *         another negative AVERROR code if its download failed
+ */
+int ff_prefetch_get(FFPrefetch *pf, int64_t id, uint8_t **data, int *size);
+
+/**
+ * Stop the prefetch thread and free the prefetcher and all the data it
+ * holds.
+ */
+void ff_prefetch_free(FFPrefetch **ppf);
+
+#endif /* AVFORMAT_PREFETCH_H */
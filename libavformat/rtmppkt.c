@@ -310,11 +310,36 @@ int ff_rtmp_packet_read_internal(URLContext *h, RTMPPacket *p, int chunk_size,
     }
 }
 
+#define WRITE_BUFFER_SIZE 16384
+
+/**
+ * Append data to the write buffer, flushing it when it is full. Data too
+ * large for the buffer is sent directly after it.
+ */
+static int buffered_write(URLContext *h, uint8_t *buf, int *buf_len,
+                          const uint8_t *data, int size)
+{
+    int ret;
+
+    if (*buf_len + size > WRITE_BUFFER_SIZE) {
+        if (*buf_len && (ret = ffurl_write(h, buf, *buf_len)) < 0)
+            return ret;
+        *buf_len = 0;
+        if (size > WRITE_BUFFER_SIZE)
+            return ffurl_write(h, data, size);
+    }
+    memcpy(buf + *buf_len, data, size);
+    *buf_len += size;
+    return 0;
+}
+
 int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket **prev_pkt_ptr,
                          int *nb_prev_pkt)
 {
+    uint8_t buf[WRITE_BUFFER_SIZE];
     uint8_t pkt_hdr[16], *p = pkt_hdr;
+    int buf_len = 0;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
     int written = 0;
@@ -382,28 +407,31 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     prev_pkt[pkt->channel_id].ts_field   = pkt->ts_field;
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    if ((ret = ffurl_write(h, pkt_hdr, p - pkt_hdr)) < 0)
+    /* gather the headers and the small chunks, so that a packet split
+     * into many chunks does not cost a write call for each of them */
+    if ((ret = buffered_write(h, buf, &buf_len, pkt_hdr, p - pkt_hdr)) < 0)
         return ret;
     written = p - pkt_hdr + pkt->size;
     while (off < pkt->size) {
         int towrite = FFMIN(chunk_size, pkt->size - off);
-        if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
+        if ((ret = buffered_write(h, buf, &buf_len, pkt->data + off, towrite)) < 0)
             return ret;
         off += towrite;
         if (off < pkt->size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            if ((ret = ffurl_write(h, &marker, 1)) < 0)
-                return ret;
+            uint8_t marker[5];
+            marker[0] = 0xC0 | pkt->channel_id;
             written++;
             if (pkt->ts_field == 0xFFFFFF) {
-                uint8_t ts_header[4];
-                AV_WB32(ts_header, timestamp);
-                if ((ret = ffurl_write(h, ts_header, 4)) < 0)
-                    return ret;
+                AV_WB32(marker + 1, timestamp);
                 written += 4;
             }
+            if ((ret = buffered_write(h, buf, &buf_len, marker,
+                                      pkt->ts_field == 0xFFFFFF ? 5 : 1)) < 0)
+                return ret;
         }
     }
+    if (buf_len && (ret = ffurl_write(h, buf, buf_len)) < 0)
+        return ret;
     return written;
 }
 
@@ -113,6 +113,7 @@ typedef struct RTMPContext {
     char*         pageurl;                    ///< url of the web page
     char*         subscribe;                  ///< name of live stream to subscribe
     int           max_sent_unacked;           ///< max unacked sent bytes
+    int           chunk_size;                 ///< outgoing chunk size requested by the user, 0 to follow the server
     int           client_buffer_time;         ///< client buffer time in ms
     int           flush_interval;             ///< number of packets flushed in the same request (RTMPT only)
     int           encrypted;                  ///< use an encrypted connection (RTMPE only)
@@ -589,6 +590,29 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     return ret;
 }
 
+/**
+ * Generate 'Set Chunk Size' message and send it to the server.
+ */
+static int gen_chunk_size(URLContext *s, RTMPContext *rt, int chunk_size)
+{
+    RTMPPacket pkt;
+    uint8_t *p;
+    int ret;
+
+    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL,
+                                     RTMP_PT_CHUNK_SIZE, 0, 4)) < 0)
+        return ret;
+
+    av_log(s, AV_LOG_DEBUG, "Setting outgoing chunk size to %d\n", chunk_size);
+    p = pkt.data;
+    bytestream_put_be32(&p, chunk_size);
+
+    if ((ret = rtmp_send_packet(rt, &pkt, 0)) < 0)
+        return ret;
+    rt->out_chunk_size = chunk_size;
+    return 0;
+}
+
 /**
  * Generate 'releaseStream' call and send it to the server. It should make
  * the server release some channel for media streams.
@@ -1499,7 +1523,7 @@ static int handle_chunk_size(URLContext *s, RTMPPacket *pkt)
         return AVERROR_INVALIDDATA;
     }
 
-    if (!rt->is_input) {
+    if (!rt->is_input && !rt->chunk_size) {
         /* Send the same chunk size change packet back to the server,
          * setting the outgoing chunk size to the same as the incoming one. */
         if ((ret = ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
@@ -2809,6 +2833,9 @@ reconnect:
     av_log(s, AV_LOG_DEBUG, "Proto = %s, path = %s, app = %s, fname = %s\n",
            proto, path, rt->app, rt->playpath);
     if (!rt->listen) {
+        if (!rt->is_input && rt->chunk_size &&
+            (ret = gen_chunk_size(s, rt, rt->chunk_size)) < 0)
+            goto fail;
         if ((ret = gen_connect(s, rt)) < 0)
             goto fail;
     } else {
@@ -3099,6 +3126,7 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 static const AVOption rtmp_options[] = {
     {"rtmp_app", "Name of application to connect to on the RTMP server", OFFSET(app), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_buffer", "Set buffer time in milliseconds. The default is 3000.", OFFSET(client_buffer_time), AV_OPT_TYPE_INT, {.i64 = 3000}, 0, INT_MAX, DEC|ENC},
+    {"rtmp_chunk_size", "Size of the chunks outgoing packets are divided into when publishing. 0 to use the size chosen by the server.", OFFSET(chunk_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 0xFFFFFF, ENC},
     {"rtmp_conn", "Append arbitrary AMF data to the Connect message", OFFSET(conn), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flashver", "Version of the Flash plugin used to run the SWF player.", OFFSET(flashver), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flush_interval", "Number of packets flushed in the same request (RTMPT only).", OFFSET(flush_interval), AV_OPT_TYPE_INT, {.i64 = 10}, 0, INT_MAX, ENC},
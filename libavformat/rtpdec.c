@@ -32,6 +32,9 @@
 #include "rtpdec_formats.h"
 
 #define MIN_FEEDBACK_INTERVAL 200000 /* 200 ms in us */
+#define MAX_NACK_ENTRIES 16 /* generic NACK entries sent in one RTCP packet */
+#define MIN_REORDER_DELAY 10000 /* 10 ms in us */
+#define REORDER_JITTER_FACTOR 4
 
 static RTPDynamicProtocolHandler l24_dynamic_handler = {
     .enc_name   = "L24",
@@ -437,55 +440,50 @@ void ff_rtp_send_punch_packets(URLContext *rtp_handle)
     av_free(buf);
 }
 
+/**
+ * Collect the sequence numbers missing before the last queued packet as
+ * generic NACK entries: a packet id and a bitmask of the 16 following ones.
+ * @return the number of entries
+ */
 static int find_missing_packets(RTPDemuxContext *s, uint16_t *first_missing,
                                 uint16_t *missing_mask)
 {
-    int i;
-    uint16_t next_seq = s->seq + 1;
-    RTPPacket *pkt = s->queue;
+    uint16_t seq;
+    int nb = 0;
 
-    if (!pkt || pkt->seq == next_seq)
+    if (!s->queue_len)
         return 0;
 
-    *missing_mask = 0;
-    for (i = 1; i <= 16; i++) {
-        uint16_t missing_seq = next_seq + i;
-        while (pkt) {
-            int16_t diff = pkt->seq - missing_seq;
-            if (diff >= 0)
+    for (seq = s->seq + 1; seq != s->queue_last; seq++) {
+        uint16_t offset;
+        if (s->queue[seq & (s->queue_slots - 1)].len)
+            continue;
+        offset = seq - (nb ? first_missing[nb - 1] : 0);
+        if (nb && offset <= 16) {
+            missing_mask[nb - 1] |= 1 << (offset - 1);
+        } else {
+            if (nb == MAX_NACK_ENTRIES)
                 break;
-            pkt = pkt->next;
+            first_missing[nb]  = seq;
+            missing_mask[nb++] = 0;
         }
-        if (!pkt)
-            break;
-        if (pkt->seq == missing_seq)
-            continue;
-        *missing_mask |= 1 << (i - 1);
     }
 
-    *first_missing = next_seq;
-    return 1;
+    return nb;
 }
 
 int ff_rtp_send_rtcp_feedback(RTPDemuxContext *s, URLContext *fd,
                               AVIOContext *avio)
 {
-    int len, need_keyframe, missing_packets;
+    int i, len, need_keyframe, missing_packets;
     AVIOContext *pb;
     uint8_t *buf;
     int64_t now;
-    uint16_t first_missing = 0, missing_mask = 0;
+    uint16_t first_missing[MAX_NACK_ENTRIES], missing_mask[MAX_NACK_ENTRIES];
 
     if (!fd && !avio)
         return -1;
 
-    need_keyframe = s->handler && s->handler->need_keyframe &&
-                    s->handler->need_keyframe(s->dynamic_protocol_context);
-    missing_packets = find_missing_packets(s, &first_missing, &missing_mask);
-
-    if (!need_keyframe && !missing_packets)
-        return 0;
-
     /* Send new feedback if enough time has elapsed since the last
      * feedback packet. */
 
@@ -493,6 +491,14 @@ int ff_rtp_send_rtcp_feedback(RTPDemuxContext *s, URLContext *fd,
     if (s->last_feedback_time &&
         (now - s->last_feedback_time) < MIN_FEEDBACK_INTERVAL)
         return 0;
+
+    need_keyframe = s->handler && s->handler->need_keyframe &&
+                    s->handler->need_keyframe(s->dynamic_protocol_context);
+    missing_packets = find_missing_packets(s, first_missing, missing_mask);
+
+    if (!need_keyframe && !missing_packets)
+        return 0;
+
     s->last_feedback_time = now;
 
     if (!fd)
@@ -512,12 +518,14 @@ int ff_rtp_send_rtcp_feedback(RTPDemuxContext *s, URLContext *fd,
     if (missing_packets) {
         avio_w8(pb, (RTP_VERSION << 6) | 1); /* NACK */
         avio_w8(pb, RTCP_RTPFB);
-        avio_wb16(pb, 3); /* length in words - 1 */
+        avio_wb16(pb, 2 + missing_packets); /* length in words - 1 */
         avio_wb32(pb, s->ssrc + 1);
         avio_wb32(pb, s->ssrc); // server SSRC
 
-        avio_wb16(pb, first_missing);
-        avio_wb16(pb, missing_mask);
+        for (i = 0; i < missing_packets; i++) {
+            avio_wb16(pb, first_missing[i]);
+            avio_wb16(pb, missing_mask[i]);
+        }
     }
 
     avio_flush(pb);
@@ -709,39 +717,81 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_freep(&s->queue->buf);
-        av_freep(&s->queue);
-        s->queue = next;
-    }
+    int i;
+
+    /* keep the packet buffers around for reuse */
+    for (i = 0; i < s->queue_slots; i++)
+        s->queue[i].len = 0;
     s->seq       = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
 }
 
-static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+/**
+ * Reallocate the queue with at least min_slots entries. The queued packets
+ * all lie within queue_slots sequence numbers after s->seq, so that each of
+ * them has its own entry.
+ */
+static int resize_queue(RTPDemuxContext *s, int min_slots)
 {
-    uint16_t seq   = AV_RB16(buf + 2);
-    RTPPacket **cur = &s->queue, *packet;
+    RTPPacket *queue;
+    int i, slots = FFMAX(s->queue_slots, 16);
 
-    /* Find the correct place in the queue to insert the packet */
-    while (*cur) {
-        int16_t diff = seq - (*cur)->seq;
-        if (diff < 0)
-            break;
-        cur = &(*cur)->next;
+    while (slots < min_slots)
+        slots <<= 1;
+
+    queue = av_mallocz_array(slots, sizeof(*queue));
+    if (!queue)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->queue_slots; i++) {
+        RTPPacket *packet = &s->queue[i];
+        if (packet->len)
+            queue[packet->seq & (slots - 1)] = *packet;
+        else
+            av_freep(&packet->buf);
+    }
+    av_free(s->queue);
+    s->queue       = queue;
+    s->queue_slots = slots;
+
+    return 0;
+}
+
+static int enqueue_packet(RTPDemuxContext *s, const uint8_t *buf, int len)
+{
+    uint16_t seq  = AV_RB16(buf + 2);
+    uint16_t diff = seq - s->seq;
+    RTPPacket *packet;
+    int ret;
+
+    if (diff > s->queue_slots) {
+        /* diff is below 1 << 15, and so is the number of slots */
+        ret = resize_queue(s, FFMAX(diff, FFMIN(s->queue_size, 1 << 15)));
+        if (ret < 0)
+            return ret;
+    }
+
+    packet = &s->queue[seq & (s->queue_slots - 1)];
+    if (packet->len) {
+        av_log(s->ic, AV_LOG_DEBUG, "RTP: dropping duplicate packet %d\n", seq);
+        return 0;
     }
 
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
+    av_fast_malloc(&packet->buf, &packet->buf_size, len);
+    if (!packet->buf) {
+        packet->buf_size = 0;
         return AVERROR(ENOMEM);
+    }
+    memcpy(packet->buf, buf, len);
     packet->recvtime = av_gettime_relative();
     packet->seq      = seq;
     packet->len      = len;
-    packet->buf      = buf;
-    packet->next     = *cur;
-    *cur = packet;
+
+    if (!s->queue_len || (int16_t)(seq - s->queue_first) < 0)
+        s->queue_first = seq;
+    if (!s->queue_len || (int16_t)(seq - s->queue_last) > 0)
+        s->queue_last = seq;
     s->queue_len++;
 
     return 0;
@@ -749,33 +799,47 @@ static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    return s->queue_len && s->queue_first == (uint16_t) (s->seq + 1);
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    return s->queue_len ? s->queue[s->queue_first & (s->queue_slots - 1)].recvtime : 0;
+}
+
+int64_t ff_rtp_reorder_delay(RTPDemuxContext *s, int64_t max_delay)
+{
+    int64_t jitter;
+
+    /* the jitter is only estimated for streams with a known clock rate,
+     * and needs a few packets to settle */
+    if (!s->st || s->statistics.received < 16)
+        return max_delay;
+
+    jitter = av_rescale_q(s->statistics.jitter >> 4, s->st->time_base,
+                          AV_TIME_BASE_Q);
+    return av_clip64(REORDER_JITTER_FACTOR * jitter,
+                     FFMIN(MIN_REORDER_DELAY, max_delay), max_delay);
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
     int rv;
-    RTPPacket *next;
+    RTPPacket *packet;
 
     if (s->queue_len <= 0)
         return -1;
 
     if (!has_next_packet(s))
-        av_log(s->ic, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+        av_log(s->ic, AV_LOG_WARNING, "RTP: missed %d packets\n",
+               (uint16_t) (s->queue_first - s->seq - 1));
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_freep(&s->queue->buf);
-    av_freep(&s->queue);
-    s->queue = next;
-    s->queue_len--;
+    packet = &s->queue[s->queue_first & (s->queue_slots - 1)];
+    rv     = rtp_parse_packet_internal(s, pkt, packet->buf, packet->len);
+    packet->len = 0;
+    if (--s->queue_len)
+        while (!s->queue[++s->queue_first & (s->queue_slots - 1)].len);
     return rv;
 }
 
@@ -825,7 +889,7 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         rtcp_update_jitter(&s->statistics, timestamp, arrival_ts);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    if ((s->seq == 0 && !s->queue_len) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
@@ -845,7 +909,6 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
             rv = enqueue_packet(s, buf, len);
             if (rv < 0)
                 return rv;
-            *bufptr = NULL;
             /* Return the first enqueued packet if the queue is full,
              * even if we're missing something */
             if (s->queue_len >= s->queue_size) {
@@ -881,7 +944,11 @@ int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_parse_close(RTPDemuxContext *s)
 {
-    ff_rtp_reset_packet_queue(s);
+    int i;
+
+    for (i = 0; i < s->queue_slots; i++)
+        av_freep(&s->queue[i].buf);
+    av_freep(&s->queue);
     ff_srtp_free(&s->srtp);
     av_free(s);
 }
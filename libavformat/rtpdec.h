@@ -52,6 +52,15 @@ void ff_rtp_parse_close(RTPDemuxContext *s);
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s);
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s);
 
+/**
+ * Get how long a packet may wait in the reordering queue for the packets
+ * missing before it, derived from the interarrival jitter of the stream.
+ *
+ * @param max_delay upper bound of the returned delay, in microseconds
+ * @return the delay in microseconds
+ */
+int64_t ff_rtp_reorder_delay(RTPDemuxContext *s, int64_t max_delay);
+
 /**
  * Send a dummy packet on both port pairs to set up the connection
  * state in potential NAT routers, so that we're able to receive
@@ -141,9 +150,9 @@ struct RTPDynamicProtocolHandler {
 typedef struct RTPPacket {
     uint16_t seq;
     uint8_t *buf;
-    int len;
+    unsigned int buf_size; ///< allocated size of buf, kept when the slot is reused
+    int len;               ///< length of the packet, 0 if the slot is empty
     int64_t recvtime;
-    struct RTPPacket *next;
 } RTPPacket;
 
 struct RTPDemuxContext {
@@ -168,9 +177,12 @@ struct RTPDemuxContext {
 
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
-    RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket *queue; ///< Buffered packets not yet returned, indexed by sequence number modulo queue_slots
+    int queue_slots;  ///< The number of entries allocated in queue, a power of two
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    uint16_t queue_first; ///< The lowest sequence number in queue, if queue_len > 0
+    uint16_t queue_last;  ///< The highest sequence number in queue, if queue_len > 0
     /*@}*/
 
     /* rtcp sender statistics receive */
@@ -330,9 +330,16 @@ static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time, int bye)
 /* send an rtp packet. sequence number is incremented, but the caller
    must update the timestamp itself */
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
+{
+    ff_rtp_send_data_hdr(s1, NULL, 0, buf1, len, m);
+}
+
+void ff_rtp_send_data_hdr(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m)
 {
     RTPMuxContext *s = s1->priv_data;
 
+    len += hdr_len;
     av_log(s1, AV_LOG_TRACE, "rtp_send_data size=%d\n", len);
 
     /* build the RTP header */
@@ -342,7 +349,9 @@ void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
     avio_wb32(s1->pb, s->timestamp);
     avio_wb32(s1->pb, s->ssrc);
 
-    avio_write(s1->pb, buf1, len);
+    if (hdr_len)
+        avio_write(s1->pb, hdr, hdr_len);
+    avio_write(s1->pb, buf1, len - hdr_len);
     avio_flush(s1->pb);
 
     s->seq = (s->seq + 1) & 0xffff;
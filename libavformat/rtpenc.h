@@ -80,6 +80,12 @@ typedef struct RTPMuxContext RTPMuxContext;
     { "send_bye", "Send RTCP BYE packets when finishing", 0, AV_OPT_TYPE_CONST, {.i64 = FF_RTP_FLAG_SEND_BYE}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "rtpflags" } \
 
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m);
+/**
+ * Send an RTP packet whose payload is hdr followed by buf1, without
+ * assembling them in a separate buffer first.
+ */
+void ff_rtp_send_data_hdr(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m);
 
 void ff_rtp_send_h264_hevc(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_h261(AVFormatContext *s1, const uint8_t *buf1, int size);
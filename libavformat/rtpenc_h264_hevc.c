@@ -164,16 +164,17 @@ static void nal_send(AVFormatContext *s1, const uint8_t *buf, int size, int last
             header_size = 3;
         }
 
+        /* s->buf only holds the FU headers, the fragments are sent from
+         * the NAL unit itself */
         while (size + header_size > s->max_payload_size) {
-            memcpy(&s->buf[header_size], buf, s->max_payload_size - header_size);
-            ff_rtp_send_data(s1, s->buf, s->max_payload_size, 0);
+            ff_rtp_send_data_hdr(s1, s->buf, header_size, buf,
+                                 s->max_payload_size - header_size, 0);
             buf  += s->max_payload_size - header_size;
             size -= s->max_payload_size - header_size;
             s->buf[flag_byte] &= ~(1 << 7);
         }
         s->buf[flag_byte] |= 1 << 6;
-        memcpy(&s->buf[header_size], buf, size);
-        ff_rtp_send_data(s1, s->buf, size + header_size, last);
+        ff_rtp_send_data_hdr(s1, s->buf, header_size, buf, size, last);
     }
 }
 
@@ -26,6 +26,7 @@
 
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -60,8 +61,25 @@ typedef struct RTPContext {
     char *sources;
     char *block;
     char *fec_options_str;
+    int64_t bitrate;
+    int pacing;
+    int batch_size;
+    uint32_t batch_timestamp;
 } RTPContext;
 
+/* values of the pacing option, forwarded as is to the udp protocol */
+enum RTPPacing {
+    RTP_PACING_RATE = 1,
+    RTP_PACING_TXTIME,
+    RTP_PACING_TXTIME_TAI,
+};
+
+static const char *const pacing_names[] = {
+    [RTP_PACING_RATE]       = "rate",
+    [RTP_PACING_TXTIME]     = "txtime",
+    [RTP_PACING_TXTIME_TAI] = "txtime_tai",
+};
+
 #define OFFSET(x) offsetof(RTPContext, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
 #define E AV_OPT_FLAG_ENCODING_PARAM
@@ -78,6 +96,12 @@ static const AVOption options[] = {
     { "sources",            "Source list",                                                      OFFSET(sources),         AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",              "Block list",                                                       OFFSET(block),           AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "fec",                "FEC",                                                              OFFSET(fec_options_str), AV_OPT_TYPE_STRING, { .str = NULL },               .flags = E },
+    { "bitrate",            "Bits to send per second, paced by the kernel",                     OFFSET(bitrate),         AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
+    { "pacing",             "How the kernel paces the packets at the bitrate",                  OFFSET(pacing),          AV_OPT_TYPE_INT,    { .i64 = RTP_PACING_RATE }, RTP_PACING_RATE, RTP_PACING_TXTIME_TAI, E, "pacing" },
+    {     "rate",           "pace the socket (SO_MAX_PACING_RATE)",                             0,                       AV_OPT_TYPE_CONST,  { .i64 = RTP_PACING_RATE },       0, 0, E, "pacing" },
+    {     "txtime",         "give each packet a launch time (SO_TXTIME, monotonic clock)",      0,                       AV_OPT_TYPE_CONST,  { .i64 = RTP_PACING_TXTIME },     0, 0, E, "pacing" },
+    {     "txtime_tai",     "give each packet a launch time (SO_TXTIME, TAI clock)",            0,                       AV_OPT_TYPE_CONST,  { .i64 = RTP_PACING_TXTIME_TAI }, 0, 0, E, "pacing" },
+    { "batch_size",         "Number of RTP packets of a frame sent per system call",            OFFSET(batch_size),      AV_OPT_TYPE_INT,    { .i64 =  1 },     1, INT_MAX, .flags = E },
     { NULL }
 };
 
@@ -173,7 +197,8 @@ static void build_udp_url(RTPContext *s,
                           const char *hostname,
                           int port, int local_port,
                           const char *include_sources,
-                          const char *exclude_sources)
+                          const char *exclude_sources,
+                          int media)
 {
     ff_url_join(buf, buf_size, "udp", NULL, hostname, port, NULL);
     if (local_port >= 0)
@@ -189,6 +214,14 @@ static void build_udp_url(RTPContext *s,
     if (s->dscp >= 0)
         url_add_option(buf, buf_size, "dscp=%d", s->dscp);
     url_add_option(buf, buf_size, "fifo_size=0");
+    /* only the RTP packets are paced and batched, RTCP is not part of the
+     * bitrate and is sent one packet at a time */
+    if (media && s->bitrate > 0) {
+        url_add_option(buf, buf_size, "bitrate=%"PRId64, s->bitrate);
+        url_add_option(buf, buf_size, "pacing=%s", pacing_names[s->pacing]);
+    }
+    if (media && s->batch_size > 1)
+        url_add_option(buf, buf_size, "batch_size=%d", s->batch_size);
     if (include_sources && include_sources[0])
         url_add_option(buf, buf_size, "sources=%s", include_sources);
     if (exclude_sources && exclude_sources[0])
@@ -207,6 +240,9 @@ static void build_udp_url(RTPContext *s,
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
  *         'dscp=n'           : set DSCP value to n (QoS)
+ *         'bitrate=n'        : pace the RTP packets at n bits per second
+ *         'pacing=rate|txtime|txtime_tai' : how the kernel paces them
+ *         'batch_size=n'     : send up to n RTP packets of a frame per system call
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -265,6 +301,16 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "dscp", p)) {
             s->dscp = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "pacing", p)) {
+            if (av_opt_set(s, "pacing", buf, 0) < 0)
+                av_log(h, AV_LOG_WARNING, "Unknown pacing '%s'\n", buf);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             av_strlcpy(include_sources, buf, sizeof(include_sources));
             ff_ip_parse_sources(h, buf, &s->filters);
@@ -309,7 +355,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     for (i = 0; i < max_retry_count; i++) {
         build_udp_url(s, buf, sizeof(buf),
                       hostname, rtp_port, s->local_rtpport,
-                      sources, block);
+                      sources, block, 1);
         if (ffurl_open_whitelist(&s->rtp_hd, buf, flags, &h->interrupt_callback,
                                  NULL, h->protocol_whitelist, h->protocol_blacklist, h) < 0)
             goto fail;
@@ -323,7 +369,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
             s->local_rtcpport = s->local_rtpport + 1;
             build_udp_url(s, buf, sizeof(buf),
                           hostname, s->rtcp_port, s->local_rtcpport,
-                          sources, block);
+                          sources, block, 0);
             if (ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags,
                                      &h->interrupt_callback, NULL,
                                      h->protocol_whitelist, h->protocol_blacklist, h) < 0) {
@@ -334,7 +380,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
         build_udp_url(s, buf, sizeof(buf),
                       hostname, s->rtcp_port, s->local_rtcpport,
-                      sources, block);
+                      sources, block, 0);
         if (ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags, &h->interrupt_callback,
                                  NULL, h->protocol_whitelist, h->protocol_blacklist, h) < 0)
             goto fail;
@@ -417,7 +463,7 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
 static int rtp_write(URLContext *h, const uint8_t *buf, int size)
 {
     RTPContext *s = h->priv_data;
-    int ret, ret_fec;
+    int ret, ret_fec, ret_flush;
     URLContext *hd;
 
     if (size < 2)
@@ -484,12 +530,26 @@ static int rtp_write(URLContext *h, const uint8_t *buf, int size)
     } else {
         /* RTP payload type */
         hd = s->rtp_hd;
+        if (s->batch_size > 1 && size >= 8) {
+            /* The packets of a frame are sent together once its last one,
+             * carrying the marker bit, has been queued. Without a marker,
+             * as for most audio, a new timestamp ends the previous frame. */
+            uint32_t timestamp = AV_RB32(buf + 4);
+            if (timestamp != s->batch_timestamp &&
+                (ret_flush = ff_udp_flush(hd)) < 0)
+                return ret_flush;
+            s->batch_timestamp = timestamp;
+        }
     }
 
     if ((ret = ffurl_write(hd, buf, size)) < 0) {
         return ret;
     }
 
+    if (hd == s->rtp_hd && s->batch_size > 1 && (buf[1] & 0x80) &&
+        (ret_flush = ff_udp_flush(hd)) < 0)
+        return ret_flush;
+
     if (s->fec_hd && !RTP_PT_IS_RTCP(buf[1])) {
         if ((ret_fec = ffurl_write(s->fec_hd, buf, size)) < 0) {
             av_log(h, AV_LOG_ERROR, "Failed to send FEC\n");
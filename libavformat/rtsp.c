@@ -65,7 +65,8 @@
 
 #define RTSP_FLAG_OPTS(name, longname) \
     { name, longname, OFFSET(rtsp_flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, DEC, "rtsp_flags" }, \
-    { "filter_src", "only receive packets from the negotiated peer IP", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_FILTER_SRC}, 0, 0, DEC, "rtsp_flags" }
+    { "filter_src", "only receive packets from the negotiated peer IP", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_FILTER_SRC}, 0, 0, DEC, "rtsp_flags" }, \
+    { "adaptive_delay", "derive the reordering delay from the measured jitter", 0, AV_OPT_TYPE_CONST, {.i64 = RTSP_FLAG_ADAPTIVE_DELAY}, 0, 0, DEC, "rtsp_flags" }
 
 #define RTSP_MEDIATYPE_OPTS(name, longname) \
     { name, longname, OFFSET(media_type_mask), AV_OPT_TYPE_FLAGS, { .i64 = (1 << (AVMEDIA_TYPE_SUBTITLE+1)) - 1 }, INT_MIN, INT_MAX, DEC, "allowed_media_types" }, \
@@ -2181,14 +2182,20 @@ redo:
             if (!rtpctx)
                 continue;
             queue_time = ff_rtp_queued_packet_time(rtpctx);
-            if (queue_time && (queue_time - first_queue_time < 0 ||
-                               !first_queue_time)) {
+            if (!queue_time)
+                continue;
+            /* deadline by which the missing packets are given up on */
+            if (rt->rtsp_flags & RTSP_FLAG_ADAPTIVE_DELAY)
+                queue_time += ff_rtp_reorder_delay(rtpctx, s->max_delay);
+            else
+                queue_time += s->max_delay;
+            if (queue_time - first_queue_time < 0 || !first_queue_time) {
                 first_queue_time = queue_time;
                 first_queue_st   = rt->rtsp_streams[i];
             }
         }
         if (first_queue_time) {
-            wait_end = first_queue_time + s->max_delay;
+            wait_end = first_queue_time;
         } else {
             wait_end = 0;
             first_queue_st = NULL;
@@ -30,6 +30,9 @@
 #include "url.h"
 #if HAVE_POLL_H
 #include <poll.h>
+#if HAVE_WRITEV && HAVE_STRUCT_MSGHDR_MSG_FLAGS
+#include <sys/uio.h>
+#endif
 #endif
 
 typedef struct TCPContext {
@@ -261,6 +264,30 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if HAVE_WRITEV && HAVE_STRUCT_MSGHDR_MSG_FLAGS
+static int tcp_writev(URLContext *h, const URLIOVec *vec, int nb_vec)
+{
+    TCPContext *s = h->priv_data;
+    struct iovec iov[URL_IOVEC_MAX];
+    struct msghdr msg = { 0 };
+    int i, ret;
+
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd_timeout(s->fd, 1, h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+    for (i = 0; i < nb_vec; i++) {
+        iov[i].iov_base = (void *)vec[i].data;
+        iov[i].iov_len  = vec[i].size;
+    }
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = nb_vec;
+    ret = sendmsg(s->fd, &msg, MSG_NOSIGNAL);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+#endif
+
 static int tcp_shutdown(URLContext *h, int flags)
 {
     TCPContext *s = h->priv_data;
@@ -316,6 +343,9 @@ const URLProtocol ff_tcp_protocol = {
     .url_accept          = tcp_accept,
     .url_read            = tcp_read,
     .url_write           = tcp_write,
+#if HAVE_WRITEV && HAVE_STRUCT_MSGHDR_MSG_FLAGS
+    .url_writev          = tcp_writev,
+#endif
     .url_close           = tcp_close,
     .url_get_file_handle = tcp_get_file_handle,
     .url_get_short_seek  = tcp_get_window_size,
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for sendmmsg() and recvmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -65,6 +66,15 @@
 #include <pthread.h>
 #endif
 
+#if HAVE_SENDMMSG || HAVE_RECVMMSG
+#include <netinet/udp.h>
+#endif
+
+#if HAVE_STRUCT_SOCK_TXTIME_CLOCKID
+#include <time.h>
+#include <linux/net_tstamp.h>
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -73,6 +83,20 @@
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH 64
+/* largest payload, and number of datagrams, sent with one UDP_SEGMENT buffer */
+#define UDP_GSO_MAX_SIZE 65507
+#define UDP_GSO_MAX_SEGMENTS 64
+/* how far ahead of their launch time datagrams are handed to the kernel
+ * with SO_TXTIME pacing, in nanoseconds */
+#define UDP_TXTIME_LEAD 10000000
+
+enum UDPPacing {
+    UDP_PACING_SLEEP,       ///< sleep in the circular buffer thread
+    UDP_PACING_RATE,        ///< SO_MAX_PACING_RATE, for the fq qdisc
+    UDP_PACING_TXTIME,      ///< SO_TXTIME with CLOCK_MONOTONIC, for the fq qdisc
+    UDP_PACING_TXTIME_TAI,  ///< SO_TXTIME with CLOCK_TAI, for the etf qdisc
+};
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -96,6 +120,11 @@ typedef struct UDPContext {
     int circular_buffer_error;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
+    int pacing;
+    int use_txtime;
+    int txtime_clock;
+    int64_t txtime_start;           ///< start of the launch time schedule, in ns
+    int64_t txtime_bits;            ///< bits scheduled since txtime_start
     int close_req;
 #if HAVE_PTHREAD_CANCEL
     pthread_t circular_buffer_thread;
@@ -111,6 +140,18 @@ typedef struct UDPContext {
     char *sources;
     char *block;
     IPSourceFilters filters;
+
+    /* batched I/O with sendmmsg()/recvmmsg() */
+    int batch_size;
+    int segment_offload;
+    uint8_t *batch_buf;
+    int batch_buf_size;
+    int batch_len[UDP_MAX_BATCH];   ///< size of each queued/received datagram, -1 if filtered
+    int batch_seg[UDP_MAX_BATCH];   ///< GRO segment size of each received datagram, 0 if none
+    int batch_nb;                   ///< number of queued/received datagrams
+    int batch_fill;                 ///< bytes queued for sending
+    int batch_pos;                  ///< next received datagram to return
+    int batch_off;                  ///< offset of the next GRO segment in it
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -120,6 +161,11 @@ static const AVOption options[] = {
     { "buffer_size",    "System data size (in bytes)",                     OFFSET(buffer_size),    AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "bitrate",        "Bits to send per second",                         OFFSET(bitrate),        AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
     { "burst_bits",     "Max length of bursts in bits (when using bitrate)", OFFSET(burst_bits),   AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
+    { "pacing",         "How to send at the given bitrate",                OFFSET(pacing),         AV_OPT_TYPE_INT,    { .i64 = UDP_PACING_SLEEP }, 0, UDP_PACING_TXTIME_TAI, E, "pacing" },
+    {     "sleep",      "sleep between packets in the circular buffer thread", 0,                  AV_OPT_TYPE_CONST,  { .i64 = UDP_PACING_SLEEP },      0, 0, E, "pacing" },
+    {     "rate",       "let the kernel pace the socket (SO_MAX_PACING_RATE)", 0,                  AV_OPT_TYPE_CONST,  { .i64 = UDP_PACING_RATE },       0, 0, E, "pacing" },
+    {     "txtime",     "give each packet a launch time (SO_TXTIME, monotonic clock)", 0,          AV_OPT_TYPE_CONST,  { .i64 = UDP_PACING_TXTIME },     0, 0, E, "pacing" },
+    {     "txtime_tai", "give each packet a launch time (SO_TXTIME, TAI clock)", 0,                AV_OPT_TYPE_CONST,  { .i64 = UDP_PACING_TXTIME_TAI }, 0, 0, E, "pacing" },
     { "localport",      "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, D|E },
     { "local_port",     "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "localaddr",      "Local address",                                   OFFSET(localaddr),      AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -135,6 +181,8 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Number of datagrams sent or received per system call", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 },  1, UDP_MAX_BATCH, .flags = D|E },
+    { "segment_offload", "Use UDP segmentation (GSO) / receive (GRO) offload", OFFSET(segment_offload), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1,       .flags = D|E },
     { NULL }
 };
 
@@ -453,7 +501,334 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+/**
+ * Let the kernel pace the output at the requested bitrate.
+ */
+static int udp_set_pacing(URLContext *h, int sockfd)
+{
+    UDPContext *s = h->priv_data;
+
+    if (s->pacing == UDP_PACING_RATE) {
+#ifdef SO_MAX_PACING_RATE
+        /* in bytes per second, ~0U means unlimited */
+        unsigned rate = FFMIN(s->bitrate / 8, UINT_MAX - 1);
+        int ret;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0) {
+            ret = ff_neterrno();
+            ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_MAX_PACING_RATE)");
+            return ret;
+        }
+        return 0;
+#endif
+    } else {
+#if HAVE_STRUCT_SOCK_TXTIME_CLOCKID && defined(CLOCK_TAI)
+        struct sock_txtime txtime = { 0 };
+        struct timespec ts;
+        int ret;
+
+        txtime.clockid = s->pacing == UDP_PACING_TXTIME_TAI ? CLOCK_TAI : CLOCK_MONOTONIC;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) < 0) {
+            ret = ff_neterrno();
+            ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_TXTIME)");
+            return ret;
+        }
+        clock_gettime(txtime.clockid, &ts);
+        s->txtime_clock = txtime.clockid;
+        s->txtime_start = ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+        s->txtime_bits  = 0;
+        s->use_txtime   = 1;
+        return 0;
+#endif
+    }
+    av_log(h, AV_LOG_WARNING, "The requested pacing is not supported on this build\n");
+    return AVERROR(ENOSYS);
+}
+
+#if HAVE_STRUCT_SOCK_TXTIME_CLOCKID
+/**
+ * Return the launch time of the next len bytes. Datagrams are scheduled at
+ * the bitrate, and the caller is put to sleep if it gets too far ahead of
+ * the schedule instead of queueing into the kernel without bound.
+ */
+static uint64_t udp_next_txtime(UDPContext *s, int len)
+{
+    int64_t burst = av_rescale(s->burst_bits, 1000000000, s->bitrate);
+    struct timespec ts;
+    int64_t now, t;
+
+    clock_gettime(s->txtime_clock, &ts);
+    now = ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+    t   = s->txtime_start + av_rescale(s->txtime_bits, 1000000000, s->bitrate);
+    if (now - burst > t) {
+        /* idle or late, restart the schedule allowing one burst */
+        s->txtime_start = t = now - burst;
+        s->txtime_bits  = 0;
+    } else if (t - now > 2 * UDP_TXTIME_LEAD) {
+        av_usleep((t - now - UDP_TXTIME_LEAD) / 1000);
+    }
+    s->txtime_bits += len * 8;
+    return FFMAX(t, now);
+}
+
+static void udp_set_txtime(UDPContext *s, struct msghdr *msg, char *control,
+                           int control_size, int len)
+{
+    uint64_t txtime = udp_next_txtime(s, len);
+    struct cmsghdr *cmsg;
+
+    msg->msg_control    = control;
+    msg->msg_controllen = control_size;
+    cmsg = CMSG_FIRSTHDR(msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_TXTIME;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(txtime));
+    memcpy(CMSG_DATA(cmsg), &txtime, sizeof(txtime));
+}
+
+static int udp_send_txtime(UDPContext *s, const uint8_t *buf, int size)
+{
+    union {
+        char buf[CMSG_SPACE(sizeof(uint64_t))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { (uint8_t *)buf, size };
+    struct msghdr msg = { 0 };
+
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+    if (!s->is_connected) {
+        msg.msg_name    = &s->dest_addr;
+        msg.msg_namelen = s->dest_addr_len;
+    }
+    udp_set_txtime(s, &msg, control.buf, sizeof(control.buf), size);
+    return sendmsg(s->udp_fd, &msg, 0);
+}
+#endif
+
+#if HAVE_SENDMMSG
+/**
+ * Send nb datagrams stored back to back in buf with a single sendmmsg()
+ * call where possible. With segment offload, runs of datagrams of the same
+ * size are handed to the kernel as one buffer to be split by UDP_SEGMENT.
+ */
+static int udp_send_batch(URLContext *h, const uint8_t *buf, const int *len, int nb)
+{
+    UDPContext *s = h->priv_data;
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    struct iovec iov[UDP_MAX_BATCH];
+    int first[UDP_MAX_BATCH], offset[UDP_MAX_BATCH];
+    /* large enough for either UDP_SEGMENT or SCM_TXTIME */
+    union {
+        char buf[CMSG_SPACE(sizeof(uint64_t))];
+        struct cmsghdr align;
+    } control[UDP_MAX_BATCH];
+    int i, n = 0, pos = 0, sent = 0;
+
+    av_assert0(nb <= UDP_MAX_BATCH);
+    memset(msgs, 0, sizeof(*msgs) * nb);
+    for (i = 0; i < nb; n++) {
+        int seg = len[i], total = len[i], j = i + 1;
+
+        if (s->segment_offload) {
+            /* all segments but the last one must have the same size */
+            while (j < nb && len[j] <= seg && total + len[j] <= UDP_GSO_MAX_SIZE &&
+                   j - i < UDP_GSO_MAX_SEGMENTS) {
+                total += len[j];
+                if (len[j++] < seg)
+                    break;
+            }
+        }
+
+        iov[n].iov_base = (uint8_t *)buf + pos;
+        iov[n].iov_len  = total;
+        msgs[n].msg_hdr.msg_iov    = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        if (!s->is_connected) {
+            msgs[n].msg_hdr.msg_name    = &s->dest_addr;
+            msgs[n].msg_hdr.msg_namelen = s->dest_addr_len;
+        }
+#if HAVE_STRUCT_SOCK_TXTIME_CLOCKID
+        if (s->use_txtime)
+            udp_set_txtime(s, &msgs[n].msg_hdr, control[n].buf,
+                           sizeof(control[n].buf), total);
+#endif
+#ifdef UDP_SEGMENT
+        if (j - i > 1) {
+            struct cmsghdr *cmsg;
+            uint16_t gso_size = seg;
+
+            msgs[n].msg_hdr.msg_control    = control[n].buf;
+            msgs[n].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(gso_size));
+            cmsg = CMSG_FIRSTHDR(&msgs[n].msg_hdr);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(gso_size));
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        }
+#endif
+        first[n]  = i;
+        offset[n] = pos;
+        pos += total;
+        i    = j;
+    }
+
+    while (sent < n) {
+        int ret = sendmmsg(s->udp_fd, msgs + sent, n - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR))
+                continue;
+            /* the device or the segment size may not be suitable for
+             * segmentation offload, e.g. with UDP-Lite or IP fragmentation */
+            if (s->segment_offload && (ret == AVERROR(EIO) || ret == AVERROR(EINVAL))) {
+                av_log(h, AV_LOG_WARNING, "UDP segmentation offload failed, disabling it\n");
+                s->segment_offload = 0;
+                return udp_send_batch(h, buf + offset[sent], len + first[sent],
+                                      nb - first[sent]);
+            }
+            return ret;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+
+static int udp_flush_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int ret;
+
+    if (!s->batch_nb)
+        return 0;
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd(s->udp_fd, 1);
+        if (ret < 0)
+            return ret;
+    }
+    ret = udp_send_batch(h, s->batch_buf, s->batch_len, s->batch_nb);
+    s->batch_nb = s->batch_fill = 0;
+    return ret;
+}
+#endif
+
+#if HAVE_RECVMMSG
+/**
+ * Receive up to batch_size datagrams into the batch buffer, waiting for
+ * the first one if the socket is blocking.
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    struct iovec iov[UDP_MAX_BATCH];
+    struct sockaddr_storage addr[UDP_MAX_BATCH];
+#ifdef UDP_GRO
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control[UDP_MAX_BATCH];
+#endif
+    int i, ret;
+
+    memset(msgs, 0, sizeof(*msgs) * s->batch_size);
+    for (i = 0; i < s->batch_size; i++) {
+        iov[i].iov_base = s->batch_buf + i * UDP_MAX_PKT_SIZE;
+        iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        msgs[i].msg_hdr.msg_iov     = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+        msgs[i].msg_hdr.msg_name    = &addr[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+#ifdef UDP_GRO
+        if (s->segment_offload) {
+            msgs[i].msg_hdr.msg_control    = control[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+        }
+#endif
+    }
+
+    ret = recvmmsg(s->udp_fd, msgs, s->batch_size, MSG_WAITFORONE, NULL);
+    if (ret < 0)
+        return ff_neterrno();
+
+    for (i = 0; i < ret; i++) {
+        s->batch_len[i] = FFMIN(msgs[i].msg_len, UDP_MAX_PKT_SIZE);
+        s->batch_seg[i] = 0;
+        if (ff_ip_check_source_lists(&addr[i], &s->filters))
+            s->batch_len[i] = -1;
+#ifdef UDP_GRO
+        if (s->segment_offload) {
+            struct cmsghdr *cmsg;
+            for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg;
+                 cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+                    memcpy(&s->batch_seg[i], CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+#endif
+    }
+    s->batch_nb  = ret;
+    s->batch_pos = 0;
+    s->batch_off = 0;
+    return ret;
+}
+
+/**
+ * Return the next datagram received by udp_recv_batch(), splitting the
+ * ones coalesced by GRO.
+ *
+ * @return the size of the datagram, AVERROR(EAGAIN) if there is none left
+ */
+static int udp_next_datagram(UDPContext *s, uint8_t **data)
+{
+    while (s->batch_pos < s->batch_nb) {
+        int len = s->batch_len[s->batch_pos] - s->batch_off;
+        int seg = s->batch_seg[s->batch_pos];
+
+        if (s->batch_len[s->batch_pos] < 0) {
+            s->batch_pos++;
+            s->batch_off = 0;
+            continue;
+        }
+        if (seg > 0 && len > seg)
+            len = seg;
+        *data = s->batch_buf + s->batch_pos * UDP_MAX_PKT_SIZE + s->batch_off;
+        s->batch_off += len;
+        if (s->batch_off >= s->batch_len[s->batch_pos]) {
+            s->batch_pos++;
+            s->batch_off = 0;
+        }
+        return len;
+    }
+    return AVERROR(EAGAIN);
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
+/* Called with the mutex held. */
+static int circular_buffer_put(URLContext *h, const uint8_t *data, int len)
+{
+    UDPContext *s = h->priv_data;
+    uint8_t tmp[4];
+
+    if(av_fifo_space(s->fifo) < len + 4) {
+        /* No Space left */
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 0;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            return AVERROR(EIO);
+        }
+    }
+    AV_WL32(tmp, len);
+    av_fifo_generic_write(s->fifo, tmp, 4, NULL);
+    av_fifo_generic_write(s->fifo, (uint8_t *)data, len, NULL);
+    pthread_cond_signal(&s->cond);
+    return 0;
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -468,7 +843,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, ret;
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
 
@@ -477,7 +852,12 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+#if HAVE_RECVMMSG
+        if (s->batch_buf)
+            len = udp_recv_batch(s);
+        else
+#endif
+        len = recvfrom(s->udp_fd, s->tmp, sizeof(s->tmp), 0, (struct sockaddr *)&addr, &addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
         if (len < 0) {
@@ -487,26 +867,24 @@ static void *circular_buffer_task_rx( void *_URLContext)
             }
             continue;
         }
+#if HAVE_RECVMMSG
+        if (s->batch_buf) {
+            uint8_t *data;
+            while ((len = udp_next_datagram(s, &data)) >= 0) {
+                if ((ret = circular_buffer_put(h, data, len)) < 0) {
+                    s->circular_buffer_error = ret;
+                    goto end;
+                }
+            }
+            continue;
+        }
+#endif
         if (ff_ip_check_source_lists(&addr, &s->filters))
             continue;
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
-            }
+        if ((ret = circular_buffer_put(h, s->tmp, len)) < 0) {
+            s->circular_buffer_error = ret;
+            goto end;
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
     }
 
 end:
@@ -558,6 +936,24 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len >= 0);
         av_assert0(len <= sizeof(s->tmp));
 
+#if HAVE_SENDMMSG
+        if (s->batch_buf) {
+            /* take as many of the queued datagrams as fit in one batch */
+            for (;;) {
+                av_fifo_generic_read(s->fifo, s->batch_buf + s->batch_fill, len, NULL);
+                s->batch_len[s->batch_nb++] = len;
+                s->batch_fill += len;
+                if (s->batch_nb == s->batch_size || av_fifo_size(s->fifo) < 4)
+                    break;
+                av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+                len = AV_RL32(tmp);
+                if (s->batch_fill + len > s->batch_buf_size)
+                    break;
+                av_fifo_drain(s->fifo, 4);
+            }
+            len = s->batch_fill;
+        } else
+#endif
         av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
 
         pthread_mutex_unlock(&s->mutex);
@@ -583,6 +979,19 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+#if HAVE_SENDMMSG
+        if (s->batch_buf) {
+            int ret = udp_send_batch(h, s->batch_buf, s->batch_len, s->batch_nb);
+            s->batch_nb = s->batch_fill = 0;
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            len = 0;
+        }
+#endif
         p = s->tmp;
         while (len) {
             int ret;
@@ -709,6 +1118,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
             s->burst_bits = strtoll(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "pacing", p)) {
+            if (av_opt_set(s, "pacing", buf, 0) < 0)
+                av_log(h, AV_LOG_WARNING, "Unknown pacing '%s'\n", buf);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "segment_offload", p)) {
+            s->segment_offload = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -876,6 +1295,53 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    if (is_output && s->bitrate && s->pacing != UDP_PACING_SLEEP &&
+        udp_set_pacing(h, udp_fd) < 0) {
+        av_log(h, AV_LOG_WARNING, "Kernel pacing is not available, falling back "
+               "to pacing in the circular buffer thread\n");
+        s->pacing = UDP_PACING_SLEEP;
+    }
+    if (s->use_txtime && s->segment_offload) {
+        /* a whole segmentation buffer would get a single launch time */
+        av_log(h, AV_LOG_WARNING, "'segment_offload' is not used with txtime pacing\n");
+        s->segment_offload = 0;
+    }
+
+    if (s->batch_size > 1 || s->segment_offload) {
+        if (is_output ? !HAVE_SENDMMSG : !HAVE_RECVMMSG) {
+            av_log(h, AV_LOG_WARNING,
+                   "'batch_size' and 'segment_offload' options were set but they are "
+                   "not supported on this build (%s is required)\n",
+                   is_output ? "sendmmsg()" : "recvmmsg()");
+            s->batch_size      = 1;
+            s->segment_offload = 0;
+        }
+    }
+    if (s->segment_offload) {
+        int ret = AVERROR(ENOSYS);
+        /* probe for UDP_SEGMENT support, the segment size itself is set
+         * per message */
+#if defined(UDP_SEGMENT) && defined(UDP_GRO)
+        tmp = !is_output;
+        ret = setsockopt(udp_fd, IPPROTO_UDP, is_output ? UDP_SEGMENT : UDP_GRO,
+                         &tmp, sizeof(tmp));
+#endif
+        if (ret < 0) {
+            ff_log_net_error(h, AV_LOG_WARNING, is_output ? "setsockopt(UDP_SEGMENT)" :
+                                                            "setsockopt(UDP_GRO)");
+            s->segment_offload = 0;
+        }
+    }
+    if (s->batch_size > 1 || s->segment_offload) {
+        /* received datagrams get a slot each, as GRO can coalesce them up to
+         * the maximum size, sent ones are stored back to back */
+        s->batch_buf_size = is_output ? FFMAX(s->batch_size * h->max_packet_size, (int)sizeof(s->tmp)) :
+                                        s->batch_size * UDP_MAX_PKT_SIZE;
+        s->batch_buf = av_malloc(s->batch_buf_size);
+        if (!s->batch_buf)
+            goto fail;
+    }
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
@@ -883,12 +1349,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
       2. Output and bitrate and circular_buffer_size is set
     */
 
-    if (is_output && s->bitrate && !s->circular_buffer_size) {
+    if (is_output && s->bitrate && s->pacing == UDP_PACING_SLEEP && !s->circular_buffer_size) {
         /* Warn user in case of 'circular_buffer_size' is not set */
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && s->bitrate && s->pacing == UDP_PACING_SLEEP && s->circular_buffer_size)) {
         int ret;
 
         /* start the task going */
@@ -923,6 +1390,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    av_freep(&s->batch_buf);
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -988,6 +1456,32 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     }
 #endif
 
+#if HAVE_RECVMMSG
+    if (s->batch_buf) {
+        uint8_t *data;
+
+        ret = udp_next_datagram(s, &data);
+        if (ret == AVERROR(EAGAIN)) {
+            if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+                ret = ff_network_wait_fd(s->udp_fd, 0);
+                if (ret < 0)
+                    return ret;
+            }
+            ret = udp_recv_batch(s);
+            if (ret < 0)
+                return ret;
+            ret = udp_next_datagram(s, &data);
+            /* every datagram was filtered out */
+            if (ret < 0)
+                return AVERROR(EINTR);
+        }
+        /* like recvfrom(), drop what does not fit */
+        ret = FFMIN(ret, size);
+        memcpy(buf, data, ret);
+        return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -1001,6 +1495,22 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret;
 }
 
+/**
+ * Send the datagrams queued for a batched write right away, e.g. at the end
+ * of a frame, instead of waiting for batch_size of them.
+ * @param h media file context
+ */
+int ff_udp_flush(URLContext *h)
+{
+#if HAVE_SENDMMSG
+    UDPContext *s = h->priv_data;
+
+    if (!(h->flags & AVIO_FLAG_READ) && !s->fifo && s->batch_buf)
+        return udp_flush_batch(h);
+#endif
+    return 0;
+}
+
 static int udp_write(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
@@ -1034,6 +1544,28 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
         pthread_mutex_unlock(&s->mutex);
         return size;
     }
+#endif
+#if HAVE_SENDMMSG
+    /* Datagrams are queued and sent once batch_size of them are. An error
+     * is only reported for the write which triggers the send. */
+    if (s->batch_buf && size <= s->batch_buf_size) {
+        if (s->batch_nb == s->batch_size || s->batch_fill + size > s->batch_buf_size) {
+            ret = udp_flush_batch(h);
+            if (ret < 0)
+                return ret;
+        }
+        memcpy(s->batch_buf + s->batch_fill, buf, size);
+        s->batch_len[s->batch_nb++] = size;
+        s->batch_fill += size;
+        if (s->batch_nb == s->batch_size) {
+            ret = udp_flush_batch(h);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                return ret;
+        }
+        return size;
+    }
+    if ((ret = udp_flush_batch(h)) < 0)
+        return ret;
 #endif
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
@@ -1041,6 +1573,11 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return ret;
     }
 
+#if HAVE_STRUCT_SOCK_TXTIME_CLOCKID
+    if (s->use_txtime)
+        ret = udp_send_txtime(s, buf, size);
+    else
+#endif
     if (!s->is_connected) {
         ret = sendto (s->udp_fd, buf, size, 0,
                       (struct sockaddr *) &s->dest_addr,
@@ -1055,6 +1592,15 @@ static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+#if HAVE_SENDMMSG
+    if (!(h->flags & AVIO_FLAG_READ) && !s->fifo && s->batch_buf) {
+        int ret = udp_flush_batch(h);
+        if (ret < 0)
+            av_log(h, AV_LOG_ERROR, "Failed to send the last datagrams: %s\n",
+                   av_err2str(ret));
+    }
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     // Request close once writing is finished
     if (s->thread_started && !(h->flags & AVIO_FLAG_READ)) {
@@ -1082,6 +1628,7 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+    av_freep(&s->batch_buf);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
@@ -0,0 +1,387 @@
+/*
+ * Background upload of segments and manifests for segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "avio_internal.h"
+#if CONFIG_HTTP_PROTOCOL
+#include "http.h"
+#endif
+#include "internal.h"
+#include "uploader.h"
+#include "url.h"
+
+#if HAVE_THREADS
+
+/* queued files per thread before ff_uploader_add() blocks */
+#define MAX_QUEUED_PER_THREAD 8
+
+typedef struct UploadJob {
+    char *url;
+    AVDictionary *opts;
+    uint8_t *data;
+    int size;
+    int flags;
+    int running;
+    struct UploadJob *next;
+} UploadJob;
+
+typedef struct UploadThread {
+    FFUploader *u;
+    pthread_t thread;
+    AVIOContext *pb;        ///< connection kept open for the next file
+} UploadThread;
+
+struct FFUploader {
+    AVFormatContext *s;
+    int max_retries;
+    int keepalive;
+
+    UploadThread *threads;
+    int nb_threads;
+
+    UploadJob *queue;       ///< queued and running files, in order
+    int nb_queued;
+    int max_queued;
+    int error;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int abort;
+};
+
+static void free_job(UploadJob *job)
+{
+    av_freep(&job->url);
+    av_dict_free(&job->opts);
+    av_freep(&job->data);
+    av_free(job);
+}
+
+static void remove_job(FFUploader *u, UploadJob *job)
+{
+    UploadJob **p = &u->queue;
+
+    while (*p != job)
+        p = &(*p)->next;
+    *p = job->next;
+    u->nb_queued--;
+    free_job(job);
+}
+
+static UploadJob *next_job(FFUploader *u)
+{
+    UploadJob *job, *prev;
+
+    for (job = u->queue; job; job = job->next) {
+        if (job->running)
+            continue;
+        for (prev = u->queue; prev != job; prev = prev->next)
+            if ((job->flags & FF_UPLOADER_MANIFEST) || !strcmp(prev->url, job->url))
+                break;
+        if (prev == job)
+            return job;
+    }
+    return NULL;
+}
+
+static int write_file(FFUploader *u, AVIOContext **pb, UploadJob *job)
+{
+    AVFormatContext *s = u->s;
+    int http = ff_is_http_proto(job->url);
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if ((ret = av_dict_copy(&opts, job->opts, 0)) < 0)
+        goto end;
+
+    /* only HTTP connections are kept open, and only to the same server */
+    if (*pb) {
+        ret = AVERROR(EINVAL);
+#if CONFIG_HTTP_PROTOCOL
+        if (http && ffio_geturlcontext(*pb))
+            ret = ff_http_do_new_request2(ffio_geturlcontext(*pb), job->url, &opts);
+#endif
+        if (ret < 0)
+            ff_format_io_close(s, pb);
+    }
+    if (!*pb) {
+        ret = s->io_open(s, pb, job->url, AVIO_FLAG_WRITE, &opts);
+        if (ret < 0)
+            goto end;
+    }
+
+    avio_write(*pb, job->data, job->size);
+    avio_flush(*pb);
+    ret = (*pb)->error;
+#if CONFIG_HTTP_PROTOCOL
+    /* the HTTP reply is only read when the request is finished */
+    if (ret >= 0 && http && ffio_geturlcontext(*pb)) {
+        URLContext *h = ffio_geturlcontext(*pb);
+        ffurl_shutdown(h, AVIO_FLAG_WRITE);
+        ret = ff_http_get_shutdown_status(h);
+    }
+#endif
+
+end:
+    av_dict_free(&opts);
+    if (ret < 0 || !http || !u->keepalive)
+        ff_format_io_close(s, pb);
+    return ret;
+}
+
+static int upload(UploadThread *t, UploadJob *job)
+{
+    FFUploader *u = t->u;
+    int ret, i;
+
+    for (i = 0; i <= u->max_retries; i++) {
+        if (i)
+            av_log(u->s, AV_LOG_WARNING, "Upload of '%s' failed, retrying\n",
+                   job->url);
+        ret = write_file(u, &t->pb, job);
+        if (ret >= 0 || ff_check_interrupt(&u->s->interrupt_callback))
+            break;
+    }
+    if (ret < 0)
+        av_log(u->s, AV_LOG_ERROR, "Failed to upload '%s': %s\n", job->url,
+               av_err2str(ret));
+    return ret;
+}
+
+static void *upload_thread(void *arg)
+{
+    UploadThread *t = arg;
+    FFUploader *u = t->u;
+
+    pthread_mutex_lock(&u->mutex);
+    for (;;) {
+        UploadJob *job = next_job(u);
+        int ret;
+
+        if (!job) {
+            if (u->abort && !u->queue)
+                break;
+            pthread_cond_wait(&u->cond, &u->mutex);
+            continue;
+        }
+
+        /* A running job is only removed by the thread running it, so it
+         * can be used without the lock. */
+        job->running = 1;
+        pthread_mutex_unlock(&u->mutex);
+
+        ret = upload(t, job);
+
+        pthread_mutex_lock(&u->mutex);
+        if (ret < 0 && !u->error)
+            u->error = ret;
+        remove_job(u, job);
+        pthread_cond_broadcast(&u->cond);
+    }
+    pthread_mutex_unlock(&u->mutex);
+
+    ff_format_io_close(u->s, &t->pb);
+    return NULL;
+}
+
+static void stop_threads(FFUploader *u, int nb_threads)
+{
+    int i;
+
+    pthread_mutex_lock(&u->mutex);
+    u->abort = 1;
+    pthread_cond_broadcast(&u->cond);
+    pthread_mutex_unlock(&u->mutex);
+
+    for (i = 0; i < nb_threads; i++)
+        pthread_join(u->threads[i].thread, NULL);
+}
+
+int ff_uploader_alloc(FFUploader **pu, AVFormatContext *s, int nb_threads,
+                      int max_retries, int keepalive)
+{
+    FFUploader *u;
+    int i, ret;
+
+    u = av_mallocz(sizeof(*u));
+    if (!u)
+        return AVERROR(ENOMEM);
+
+    u->threads = av_mallocz_array(nb_threads, sizeof(*u->threads));
+    if (!u->threads) {
+        av_free(u);
+        return AVERROR(ENOMEM);
+    }
+    u->s           = s;
+    u->nb_threads  = nb_threads;
+    u->max_retries = max_retries;
+    u->keepalive   = keepalive;
+    u->max_queued  = nb_threads * MAX_QUEUED_PER_THREAD;
+
+    if ((ret = pthread_mutex_init(&u->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&u->cond, NULL))) {
+        pthread_mutex_destroy(&u->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    for (i = 0; i < nb_threads; i++) {
+        u->threads[i].u = u;
+        if ((ret = pthread_create(&u->threads[i].thread, NULL, upload_thread,
+                                  &u->threads[i]))) {
+            stop_threads(u, i);
+            pthread_cond_destroy(&u->cond);
+            pthread_mutex_destroy(&u->mutex);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+
+    *pu = u;
+    return 0;
+
+fail:
+    av_free(u->threads);
+    av_free(u);
+    return ret;
+}
+
+int ff_uploader_add(FFUploader *u, const char *url, AVDictionary *opts,
+                    uint8_t *data, int size, int flags)
+{
+    UploadJob *job, **p;
+
+    job = av_mallocz(sizeof(*job));
+    if (!job) {
+        av_free(data);
+        return AVERROR(ENOMEM);
+    }
+    job->data  = data;
+    job->size  = size;
+    job->flags = flags;
+    job->url   = av_strdup(url);
+    if (!job->url || av_dict_copy(&job->opts, opts, 0) < 0) {
+        free_job(job);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_lock(&u->mutex);
+    /* only the latest version of a manifest needs to be written */
+    if (flags & FF_UPLOADER_MANIFEST) {
+        UploadJob *cur;
+        for (cur = u->queue; cur; cur = cur->next) {
+            if (!cur->running && (cur->flags & FF_UPLOADER_MANIFEST) &&
+                !strcmp(cur->url, url)) {
+                remove_job(u, cur);
+                break;
+            }
+        }
+    }
+    while (u->nb_queued >= u->max_queued)
+        pthread_cond_wait(&u->cond, &u->mutex);
+
+    for (p = &u->queue; *p; p = &(*p)->next)
+        ;
+    *p = job;
+    u->nb_queued++;
+    pthread_cond_broadcast(&u->cond);
+    pthread_mutex_unlock(&u->mutex);
+
+    return 0;
+}
+
+int ff_uploader_error(FFUploader *u)
+{
+    int ret;
+
+    pthread_mutex_lock(&u->mutex);
+    ret = u->error;
+    u->error = 0;
+    pthread_mutex_unlock(&u->mutex);
+
+    return ret;
+}
+
+int ff_uploader_flush(FFUploader *u)
+{
+    int ret;
+
+    pthread_mutex_lock(&u->mutex);
+    while (u->queue)
+        pthread_cond_wait(&u->cond, &u->mutex);
+    ret = u->error;
+    u->error = 0;
+    pthread_mutex_unlock(&u->mutex);
+
+    return ret;
+}
+
+void ff_uploader_free(FFUploader **pu)
+{
+    FFUploader *u = *pu;
+
+    if (!u)
+        return;
+
+    stop_threads(u, u->nb_threads);
+
+    pthread_cond_destroy(&u->cond);
+    pthread_mutex_destroy(&u->mutex);
+    av_freep(&u->threads);
+    av_freep(pu);
+}
+
+#else
+
+int ff_uploader_alloc(FFUploader **pu, AVFormatContext *s, int nb_threads,
+                      int max_retries, int keepalive)
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_uploader_add(FFUploader *u, const char *url, AVDictionary *opts,
+                    uint8_t *data, int size, int flags)
+{
+    av_free(data);
+    return AVERROR(ENOSYS);
+}
+
+int ff_uploader_error(FFUploader *u)
+{
+    return 0;
+}
+
+int ff_uploader_flush(FFUploader *u)
+{
+    return 0;
+}
+
+void ff_uploader_free(FFUploader **pu)
+{
+}
+
+#endif /* HAVE_THREADS */
@@ -0,0 +1,94 @@
+/*
+ * Background upload of segments and manifests for segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_UPLOADER_H
+#define AVFORMAT_UPLOADER_H
+
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+
+#include "avformat.h"
+
+/**
+ * Writes the files produced by a segmenting muxer (HLS, DASH) on a pool of
+ * background threads, so that a slow server does not stall the muxer.
+ *
+ * Files are written in the order they are added, but several of them may be
+ * in flight at once: a file is only started once all the earlier writes of
+ * the same url are done, and a manifest (FF_UPLOADER_MANIFEST) only once all
+ * the earlier writes are done, so that it never references a segment which
+ * is not available yet.
+ *
+ * The files are opened with the io_open() callback of the muxer from the
+ * upload threads, so it must be thread safe.
+ */
+typedef struct FFUploader FFUploader;
+
+/**
+ * The file must only be written after all the previously added ones. A
+ * manifest still queued is replaced by a newer version of it.
+ */
+#define FF_UPLOADER_MANIFEST 1
+
+/**
+ * Allocate an uploader and start its threads.
+ *
+ * @param s           the muxer, used for logging, interruption and io_open()
+ * @param nb_threads  number of files written concurrently
+ * @param max_retries number of times a failed write is retried
+ * @param keepalive   keep HTTP connections open between files
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_uploader_alloc(FFUploader **pu, AVFormatContext *s, int nb_threads,
+                      int max_retries, int keepalive);
+
+/**
+ * Queue a file for writing, waiting for room in the queue if it is full.
+ *
+ * @param opts  options passed to io_open(), copied
+ * @param data  the file contents, owned and freed by the uploader, also on
+ *              failure
+ * @param flags a combination of FF_UPLOADER_* flags
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_uploader_add(FFUploader *u, const char *url, AVDictionary *opts,
+                    uint8_t *data, int size, int flags);
+
+/**
+ * Return the error of a write which failed even after retries since the
+ * last call, if any, and clear it. Failed writes are logged by the uploader.
+ */
+int ff_uploader_error(FFUploader *u);
+
+/**
+ * Wait until all queued files are written.
+ *
+ * @return 0 on success, the error of a write which failed since the last
+ *         call if any
+ */
+int ff_uploader_flush(FFUploader *u);
+
+/**
+ * Write all queued files, stop the threads and free the uploader.
+ */
+void ff_uploader_free(FFUploader **pu);
+
+#endif /* AVFORMAT_UPLOADER_H */
@@ -27,6 +27,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -51,6 +52,16 @@ typedef struct URLContext {
     int min_packet_size;        /**< if non zero, the stream is packetized with this min packet size */
 } URLContext;
 
+/**
+ * Maximum number of buffers passed to URLProtocol.url_writev() at once.
+ */
+#define URL_IOVEC_MAX 16
+
+typedef struct URLIOVec {
+    const uint8_t *data;
+    int size;
+} URLIOVec;
+
 typedef struct URLProtocol {
     const char *name;
     int     (*url_open)( URLContext *h, const char *url, int flags);
@@ -77,6 +88,12 @@ typedef struct URLProtocol {
      */
     int     (*url_read)( URLContext *h, unsigned char *buf, int size);
     int     (*url_write)(URLContext *h, const unsigned char *buf, int size);
+    /**
+     * Write the concatenation of nb_vec buffers, at most URL_IOVEC_MAX, as
+     * url_write() would, with the same return value. Only for stream
+     * protocols, the data is not written as a single packet.
+     */
+    int     (*url_writev)(URLContext *h, const URLIOVec *vec, int nb_vec);
     int64_t (*url_seek)( URLContext *h, int64_t pos, int whence);
     int     (*url_close)(URLContext *h);
     int (*url_read_pause)(URLContext *h, int pause);
@@ -86,6 +103,12 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    /**
+     * Return a reference to a read-only memory mapping of the whole
+     * resource. The size of the mapping is returned separately, as it may
+     * not fit into the buffer size.
+     */
+    int (*url_get_mapping)(URLContext *h, AVBufferRef **buf, int64_t *size);
     int (*url_shutdown)(URLContext *h, int flags);
     int priv_data_size;
     const AVClass *priv_data_class;
@@ -202,6 +225,15 @@ int ffurl_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int ffurl_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * Write the concatenation of nb_vec buffers to the resource accessed by h,
+ * with a single vectored write if the protocol supports it.
+ *
+ * @return the number of bytes written on success, a negative AVERROR code
+ *         on failure
+ */
+int ffurl_writev(URLContext *h, const URLIOVec *vec, int nb_vec);
+
 /**
  * Change the position that will be used by the next read/write
  * operation on the resource accessed by h.
@@ -257,6 +289,17 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Return a memory mapping of the whole resource, for protocols which
+ * support it.
+ *
+ * @param buf  set to a new reference to the mapping, starting at offset 0
+ * @param size set to the size of the mapping
+ * @return 0 on success, AVERROR(ENOSYS) if the resource is not mapped,
+ *         another negative AVERROR code on failure
+ */
+int ffurl_get_mapping(URLContext *h, AVBufferRef **buf, int64_t *size);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -278,6 +321,7 @@ int ff_check_interrupt(AVIOInterruptCB *cb);
 /* udp.c */
 int ff_udp_set_remote_url(URLContext *h, const char *uri);
 int ff_udp_get_local_port(URLContext *h);
+int ff_udp_flush(URLContext *h);
 
 /**
  * Assemble a URL string from components. This is the reverse operation
@@ -39,6 +39,7 @@
 
 #include "libavcodec/bytestream.h"
 #include "libavcodec/internal.h"
+#include "libavcodec/mpeg4audio.h"
 #include "libavcodec/raw.h"
 
 #include "audiointerleave.h"
@@ -151,6 +152,13 @@ struct AVCodecParserContext *av_stream_get_parser(const AVStream *st)
     return st->parser;
 }
 
+AVCodecContext *av_stream_take_probe_decoder(AVStream *st)
+{
+    AVCodecContext *avctx = st->internal->probe_decoder;
+    st->internal->probe_decoder = NULL;
+    return avctx;
+}
+
 void av_format_inject_global_side_data(AVFormatContext *s)
 {
     int i;
@@ -317,6 +325,25 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     return append_packet_chunked(s, pkt, size);
 }
 
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size)
+{
+    AVBufferRef *buf;
+    const uint8_t *data;
+    int64_t pos = avio_tell(s);
+    int ret;
+
+    ret = ffio_read_ref(s, size, &buf, &data);
+    if (ret <= 0)
+        return ret < 0 ? ret : av_get_packet(s, pkt, size);
+
+    av_init_packet(pkt);
+    pkt->buf  = buf;
+    pkt->data = (uint8_t *)data;
+    pkt->size = size;
+    pkt->pos  = pos;
+    return size;
+}
+
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
@@ -1996,6 +2023,7 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 {
     AVIndexEntry *entries, *ie;
     int index;
+    size_t min_size_needed, requested_size;
 
     if ((unsigned) *nb_index_entries + 1 >= UINT_MAX / sizeof(AVIndexEntry))
         return -1;
@@ -2009,10 +2037,18 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
     if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
         timestamp -= RELATIVE_TS_BASE;
 
+    // Double the allocation each time, long recordings can accumulate
+    // millions of entries which would otherwise be reallocated every 1/16
+    // of growth.
+    min_size_needed = (*nb_index_entries + 1) * sizeof(AVIndexEntry);
+    requested_size  = min_size_needed > *index_entries_allocated_size ?
+                      FFMAX(min_size_needed,
+                            FFMIN(2 * (size_t)*index_entries_allocated_size, INT_MAX)) :
+                      min_size_needed;
+
     entries = av_fast_realloc(*index_entries,
                               index_entries_allocated_size,
-                              (*nb_index_entries + 1) *
-                              sizeof(AVIndexEntry));
+                              requested_size);
     if (!entries)
         return -1;
 
@@ -2168,6 +2204,18 @@ int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
                                      wanted_timestamp, flags);
 }
 
+int avformat_index_get_entries_count(const AVStream *st)
+{
+    return st->nb_index_entries;
+}
+
+const AVIndexEntry *avformat_index_get_entry(const AVStream *st, int idx)
+{
+    if (idx < 0 || idx >= st->nb_index_entries)
+        return NULL;
+    return &st->index_entries[idx];
+}
+
 static int64_t ff_read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
                                  int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ))
 {
@@ -3105,10 +3153,13 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st,
 
     while ((pkt.size > 0 || (!pkt.data && got_picture)) &&
            ret >= 0 &&
-           (!has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
-            (!st->codec_info_nb_frames &&
-             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))) {
+           (!has_codec_parameters(st, NULL) ||
+            (!(s->flags & AVFMT_FLAG_FAST_PROBE) &&
+             (!has_decode_delay_been_guessed(st) ||
+              (!st->codec_info_nb_frames &&
+               (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))))) {
         got_picture = 0;
+        st->internal->probe_decoder_used = 1;
         if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ||
             avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
             ret = avcodec_send_packet(avctx, &pkt);
@@ -3598,6 +3649,79 @@ static int extract_extradata(AVStream *st, const AVPacket *pkt)
     return 0;
 }
 
+/* Get the pixel format from the parser rather than by decoding a frame. The
+ * parser only sees the packets here when they are not parsed for splitting,
+ * and is then only used for their headers. */
+static void fast_probe_parse(AVFormatContext *s, AVStream *st, const AVPacket *pkt)
+{
+    AVCodecContext *avctx = st->internal->avctx;
+    AVCodecParserContext *parser = st->parser;
+
+#if CONFIG_AAC_DECODER
+    /* the profile is otherwise set by the decoder */
+    if (avctx->codec_id == AV_CODEC_ID_AAC && avctx->profile == FF_PROFILE_UNKNOWN &&
+        avctx->extradata_size) {
+        MPEG4AudioConfig cfg;
+        if (avpriv_mpeg4audio_get_config2(&cfg, avctx->extradata,
+                                          avctx->extradata_size, 1, s) >= 0)
+            avctx->profile = cfg.ps  > 0 ? FF_PROFILE_AAC_HE_V2 :
+                             cfg.sbr > 0 ? FF_PROFILE_AAC_HE    :
+                                           cfg.object_type - 1;
+    }
+#endif
+
+    if (!parser || avctx->codec_type != AVMEDIA_TYPE_VIDEO ||
+        avctx->pix_fmt != AV_PIX_FMT_NONE)
+        return;
+
+    if (!st->need_parsing) {
+        uint8_t *out;
+        int out_size;
+
+        parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+        av_parser_parse2(parser, avctx, &out, &out_size, pkt->data, pkt->size,
+                         pkt->pts, pkt->dts, pkt->pos);
+    }
+    if (parser->format >= 0)
+        avctx->pix_fmt = parser->format;
+}
+
+/* Hand the decoder of an audio stream over to the caller if it is still as
+ * freshly opened with the final parameters of the stream, and replace it
+ * with a new context. */
+static int keep_probe_decoder(AVStream *st)
+{
+    AVCodecContext *avctx = st->internal->avctx, *new_avctx;
+    AVCodecParameters *par = st->codecpar;
+    int ret;
+
+    if (par->codec_type != AVMEDIA_TYPE_AUDIO || !avcodec_is_open(avctx) ||
+        st->internal->probe_decoder_used ||
+        avctx->codec_id       != par->codec_id       ||
+        avctx->sample_rate    != par->sample_rate    ||
+        avctx->channels       != par->channels       ||
+        avctx->channel_layout != par->channel_layout ||
+        avctx->extradata_size != par->extradata_size ||
+        (par->extradata_size &&
+         memcmp(avctx->extradata, par->extradata, par->extradata_size)))
+        return 0;
+
+    new_avctx = avcodec_alloc_context3(NULL);
+    if (!new_avctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(new_avctx, par);
+    if (ret < 0) {
+        avcodec_free_context(&new_avctx);
+        return ret;
+    }
+    new_avctx->time_base = avctx->time_base;
+
+    avcodec_free_context(&st->internal->probe_decoder);
+    st->internal->probe_decoder = avctx;
+    st->internal->avctx         = new_avctx;
+    return 0;
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count = 0, ret = 0, j;
@@ -3937,6 +4061,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
+        if (ic->flags & AVFMT_FLAG_FAST_PROBE)
+            fast_probe_parse(ic, st, pkt);
         try_decode_frame(ic, st, pkt,
                          (options && i < orig_nb_streams) ? &options[i] : NULL);
 
@@ -4192,6 +4318,11 @@ find_stream_info_err:
         st = ic->streams[i];
         if (st->info)
             av_freep(&st->info->duration_error);
+        if (ret >= 0 && ic->flags & AVFMT_FLAG_KEEP_DECODERS) {
+            int err = keep_probe_decoder(st);
+            if (err < 0)
+                ret = err;
+        }
         avcodec_close(ic->streams[i]->internal->avctx);
         av_freep(&ic->streams[i]->info);
         av_bsf_free(&ic->streams[i]->internal->extract_extradata.bsf);
@@ -4391,11 +4522,14 @@ static void free_stream(AVStream **pst)
 
     if (st->internal) {
         avcodec_free_context(&st->internal->avctx);
+        avcodec_free_context(&st->internal->probe_decoder);
         for (i = 0; i < st->internal->nb_bsfcs; i++) {
             av_bsf_free(&st->internal->bsfcs[i]);
             av_freep(&st->internal->bsfcs);
         }
         av_freep(&st->internal->priv_pts);
+        ff_packet_list_free(&st->internal->interleave_queue,
+                            &st->last_in_packet_buffer);
         av_bsf_free(&st->internal->extract_extradata.bsf);
         av_packet_free(&st->internal->extract_extradata.pkt);
     }
@@ -4465,6 +4599,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_dict_free(&s->internal->id3v2_meta);
+    av_freep(&s->internal->interleave_heap);
     av_freep(&s->streams);
     flush_packet_queue(s);
     av_freep(&s->internal);
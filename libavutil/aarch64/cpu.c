@@ -20,11 +20,77 @@
 #include "libavutil/cpu_internal.h"
 #include "config.h"
 
+#if defined __linux__ || defined __ANDROID__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define AT_HWCAP        16
+
+/* Relevant HWCAP values from kernel headers */
+#define HWCAP_AES       (1 << 3)
+#define HWCAP_CRC32     (1 << 7)
+
+static int get_hwcap(uint64_t *hwcap)
+{
+    struct { uint64_t a_type; uint64_t a_val; } auxv;
+    FILE *f = fopen("/proc/self/auxv", "r");
+    int err = -1;
+
+    if (!f)
+        return -1;
+
+    while (fread(&auxv, sizeof(auxv), 1, f) > 0) {
+        if (auxv.a_type == AT_HWCAP) {
+            *hwcap = auxv.a_val;
+            err = 0;
+            break;
+        }
+    }
+
+    fclose(f);
+    return err;
+}
+
+static int detect_flags(void)
+{
+    uint64_t hwcap;
+    int flags = 0;
+
+    if (get_hwcap(&hwcap) < 0)
+        return 0;
+
+    if (hwcap & HWCAP_AES)
+        flags |= AV_CPU_FLAG_AES;
+    if (hwcap & HWCAP_CRC32)
+        flags |= AV_CPU_FLAG_CRC32;
+
+    return flags;
+}
+
+#elif defined __APPLE__
+
+/* all Apple ARMv8 CPUs implement the Cryptographic and CRC32 extensions */
+static int detect_flags(void)
+{
+    return AV_CPU_FLAG_AES | AV_CPU_FLAG_CRC32;
+}
+
+#else
+
+static int detect_flags(void)
+{
+    return 0;
+}
+
+#endif
+
 int ff_get_cpu_flags_aarch64(void)
 {
     return AV_CPU_FLAG_ARMV8 * HAVE_ARMV8 |
            AV_CPU_FLAG_NEON  * HAVE_NEON  |
-           AV_CPU_FLAG_VFP   * HAVE_VFP;
+           AV_CPU_FLAG_VFP   * HAVE_VFP   |
+           detect_flags();
 }
 
 size_t ff_get_cpu_max_align_aarch64(void)
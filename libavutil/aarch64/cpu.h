@@ -25,5 +25,9 @@
 #define have_armv8(flags) CPUEXT(flags, ARMV8)
 #define have_neon(flags) CPUEXT(flags, NEON)
 #define have_vfp(flags)  CPUEXT(flags, VFP)
+/* the AES instructions are part of the optional Cryptographic Extension */
+#define have_aes(flags)  (HAVE_NEON && ((flags) & AV_CPU_FLAG_AES))
+/* the CRC32 instructions are optional in ARMv8.0 */
+#define have_crc32(flags) (HAVE_ARMV8 && ((flags) & AV_CPU_FLAG_CRC32))
 
 #endif /* AVUTIL_AARCH64_CPU_H */
@@ -230,6 +230,11 @@ int av_aes_init(AVAES *a, const uint8_t *key, int key_bits, int decrypt)
 
     a->rounds = rounds;
 
+    if (ARCH_AARCH64)
+        ff_init_aes_aarch64(a, decrypt);
+    if (ARCH_X86)
+        ff_init_aes_x86(a, decrypt);
+
     memcpy(tk, key, KC * 4);
     memcpy(a->round_key[0].u8, key, KC * 4);
 
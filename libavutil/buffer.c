@@ -24,6 +24,7 @@
 #include "buffer_internal.h"
 #include "common.h"
 #include "mem.h"
+#include "mem_internal.h"
 #include "thread.h"
 
 AVBufferRef *av_buffer_create(uint8_t *data, int size,
@@ -65,6 +66,27 @@ void av_buffer_default_free(void *opaque, uint8_t *data)
     av_free(data);
 }
 
+static void buffer_account(AVBuffer *b)
+{
+    if (ff_mem_accounting_enabled()) {
+        b->mem_tag  = AV_MEM_TAG_BUFFER;
+        b->mem_size = b->size;
+        ff_mem_account(b->mem_tag, b->mem_size, 1);
+    }
+}
+
+void av_buffer_set_mem_tag(AVBufferRef *buf, enum AVMemTag tag)
+{
+    AVBuffer *b = buf->buffer;
+
+    if (!b->mem_size || b->mem_tag == tag || (unsigned)tag >= AV_MEM_TAG_NB)
+        return;
+
+    ff_mem_account(b->mem_tag, -b->mem_size, -1);
+    ff_mem_account(tag,         b->mem_size,  1);
+    b->mem_tag = tag;
+}
+
 AVBufferRef *av_buffer_alloc(int size)
 {
     AVBufferRef *ret = NULL;
@@ -77,6 +99,8 @@ AVBufferRef *av_buffer_alloc(int size)
     ret = av_buffer_create(data, size, av_buffer_default_free, NULL, 0);
     if (!ret)
         av_freep(&data);
+    else
+        buffer_account(ret->buffer);
 
     return ret;
 }
@@ -118,6 +142,8 @@ static void buffer_replace(AVBufferRef **dst, AVBufferRef **src)
         av_freep(dst);
 
     if (atomic_fetch_sub_explicit(&b->refcount, 1, memory_order_acq_rel) == 1) {
+        if (b->mem_size)
+            ff_mem_account(b->mem_tag, -b->mem_size, 0);
         b->free(b->opaque, b->data);
         av_freep(&b);
     }
@@ -186,6 +212,7 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
         }
 
         buf->buffer->flags |= BUFFER_FLAG_REALLOCATABLE;
+        buffer_account(buf->buffer);
         *pbuf = buf;
 
         return 0;
@@ -202,6 +229,8 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
             return AVERROR(ENOMEM);
 
         memcpy(new->data, buf->data, FFMIN(size, buf->size));
+        if (buf->buffer->mem_size)
+            av_buffer_set_mem_tag(new, buf->buffer->mem_tag);
 
         buffer_replace(pbuf, &new);
         return 0;
@@ -213,6 +242,10 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
 
     buf->buffer->data = buf->data = tmp;
     buf->buffer->size = buf->size = size;
+    if (buf->buffer->mem_size) {
+        ff_mem_account(buf->buffer->mem_tag, size - buf->buffer->mem_size, 0);
+        buf->buffer->mem_size = size;
+    }
     return 0;
 }
 
@@ -232,6 +265,8 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
+    atomic_init(&pool->nb_idle, 0);
 
     return pool;
 }
@@ -248,22 +283,40 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
+    atomic_init(&pool->nb_idle, 0);
 
     return pool;
 }
 
+static void pool_free_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    if (buf->mem_size)
+        ff_mem_account(pool->mem_tag, -buf->mem_size, 0);
+    buf->free(buf->opaque, buf->data);
+    av_free(buf);
+}
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+    BufferPoolEntry *released = (BufferPoolEntry *)atomic_load(&pool->released);
+
+    while (released) {
+        BufferPoolEntry *buf = released;
+        released   = buf->next;
+        buf->next  = pool->pool;
+        pool->pool = buf;
+    }
+
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
 
-        buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
+        pool_free_entry(pool, buf);
     }
     ff_mutex_destroy(&pool->mutex);
 
@@ -290,14 +343,24 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
+    int nb_idle = atomic_fetch_add_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+    intptr_t head;
 
-    if(CONFIG_MEMORY_POISONING)
-        memset(buf->data, FF_MEMORY_POISON, pool->size);
-
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    if (pool->max_idle && nb_idle >= pool->max_idle) {
+        atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
+        pool_free_entry(pool, buf);
+    } else {
+        if(CONFIG_MEMORY_POISONING)
+            memset(buf->data, FF_MEMORY_POISON, pool->size);
+
+        head = atomic_load_explicit(&pool->released, memory_order_relaxed);
+        do {
+            buf->next = (BufferPoolEntry *)head;
+        } while (!atomic_compare_exchange_weak_explicit(&pool->released, &head,
+                                                        (intptr_t)buf,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+    }
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -329,6 +392,13 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     ret->buffer->opaque = buf;
     ret->buffer->free   = pool_release_buffer;
 
+    /* the data now lives as long as the pool entry */
+    if (ret->buffer->mem_size) {
+        av_buffer_set_mem_tag(ret, pool->mem_tag);
+        buf->mem_size         = ret->buffer->mem_size;
+        ret->buffer->mem_size = 0;
+    }
+
     return ret;
 }
 
@@ -339,17 +409,28 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 
     ff_mutex_lock(&pool->mutex);
     buf = pool->pool;
+    if (!buf)
+        buf = (BufferPoolEntry *)atomic_exchange_explicit(&pool->released, 0,
+                                                          memory_order_acquire);
     if (buf) {
+        pool->pool = buf->next;
+        ff_mutex_unlock(&pool->mutex);
+
+        buf->next = NULL;
         ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                                buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
+        if (!ret) {
+            ff_mutex_lock(&pool->mutex);
+            buf->next  = pool->pool;
+            pool->pool = buf;
+            ff_mutex_unlock(&pool->mutex);
+        } else {
+            atomic_fetch_sub_explicit(&pool->nb_idle, 1, memory_order_relaxed);
         }
     } else {
         ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
@@ -357,6 +438,17 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     return ret;
 }
 
+void av_buffer_pool_set_mem_tag(AVBufferPool *pool, enum AVMemTag tag)
+{
+    if ((unsigned)tag < AV_MEM_TAG_NB)
+        pool->mem_tag = tag;
+}
+
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle)
+{
+    pool->max_idle = FFMAX(max_idle, 0);
+}
+
 void *av_buffer_pool_buffer_get_opaque(AVBufferRef *ref)
 {
     BufferPoolEntry *buf = ref->buffer->opaque;
@@ -27,6 +27,8 @@
 
 #include <stdint.h>
 
+#include "mem.h"
+
 /**
  * @defgroup lavu_buffer AVBuffer
  * @ingroup lavu_data
@@ -197,6 +199,14 @@ int av_buffer_make_writable(AVBufferRef **buf);
  */
 int av_buffer_realloc(AVBufferRef **buf, int size);
 
+/**
+ * Count the data of a buffer under another memory accounting tag. Does
+ * nothing if the data is not counted.
+ *
+ * @see lavu_mem_accounting
+ */
+void av_buffer_set_mem_tag(AVBufferRef *buf, enum AVMemTag tag);
+
 /**
  * @}
  */
@@ -297,6 +307,25 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
  */
 void *av_buffer_pool_buffer_get_opaque(AVBufferRef *ref);
 
+/**
+ * Set the memory accounting tag the buffers allocated by the pool are
+ * counted under from now on. By default they are counted under
+ * AV_MEM_TAG_BUFFER.
+ *
+ * @see lavu_mem_accounting
+ */
+void av_buffer_pool_set_mem_tag(AVBufferPool *pool, enum AVMemTag tag);
+
+/**
+ * Limit the number of unused buffers kept by the pool. A buffer returned to
+ * the pool while it already holds max_idle unused buffers is freed instead.
+ * This must not be called while other threads use the pool.
+ *
+ * @param max_idle maximum number of unused buffers, 0 for no limit (the
+ *                 default)
+ */
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle);
+
 /**
  * @}
  */
@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 #include "buffer.h"
+#include "mem.h"
 #include "thread.h"
 
 /**
@@ -57,6 +58,13 @@ struct AVBuffer {
      * A combination of BUFFER_FLAG_*
      */
     int flags;
+
+    /**
+     * Memory accounting tag and the size counted under it, 0 if the data
+     * is not counted.
+     */
+    enum AVMemTag mem_tag;
+    int mem_size;
 };
 
 typedef struct BufferPoolEntry {
@@ -71,12 +79,24 @@ typedef struct BufferPoolEntry {
 
     AVBufferPool *pool;
     struct BufferPoolEntry *next;
+
+    /* size of data counted under the memory accounting tag of the pool */
+    int mem_size;
 } BufferPoolEntry;
 
 struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Buffers returned to the pool are pushed onto this lock-free stack
+     * (a BufferPoolEntry pointer), so that pool_release_buffer() never
+     * needs the mutex. av_buffer_pool_get() moves the whole stack onto
+     * pool->pool when that runs empty. Only one thread at a time takes
+     * entries off it, which keeps the stack free of the ABA problem.
+     */
+    atomic_intptr_t released;
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
@@ -88,7 +108,15 @@ struct AVBufferPool {
      */
     atomic_uint refcount;
 
+    /*
+     * Number of unused buffers, in pool->pool or on the released stack, and
+     * the number above which returned buffers are freed, 0 for no limit.
+     */
+    atomic_int nb_idle;
+    int max_idle;
+
     int size;
+    enum AVMemTag mem_tag;
     void *opaque;
     AVBufferRef* (*alloc)(int size);
     AVBufferRef* (*alloc2)(void *opaque, int size);
@@ -16,6 +16,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+/* must come before any system header for cpu_set_t and its macros */
+#if HAVE_SCHED_GETAFFINITY
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#endif
+
 #include <stddef.h>
 #include <stdint.h>
 #include <stdatomic.h>
@@ -28,9 +37,6 @@
 #include "common.h"
 
 #if HAVE_SCHED_GETAFFINITY
-#ifndef _GNU_SOURCE
-# define _GNU_SOURCE
-#endif
 #include <sched.h>
 #endif
 #if HAVE_GETPROCESSAFFINITYMASK || HAVE_WINRT
@@ -127,6 +133,7 @@ int av_parse_cpu_flags(const char *s)
 #define CPUFLAG_AVX2     (AV_CPU_FLAG_AVX2     | CPUFLAG_AVX)
 #define CPUFLAG_BMI2     (AV_CPU_FLAG_BMI2     | AV_CPU_FLAG_BMI1)
 #define CPUFLAG_AESNI    (AV_CPU_FLAG_AESNI    | CPUFLAG_SSE42)
+#define CPUFLAG_CLMUL    (AV_CPU_FLAG_CLMUL    | CPUFLAG_SSE42)
 #define CPUFLAG_AVX512   (AV_CPU_FLAG_AVX512   | CPUFLAG_AVX2)
     static const AVOption cpuflags_opts[] = {
         { "flags"   , NULL, 0, AV_OPT_TYPE_FLAGS, { .i64 = 0 }, INT64_MIN, INT64_MAX, .unit = "flags" },
@@ -156,6 +163,7 @@ int av_parse_cpu_flags(const char *s)
         { "3dnowext", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = CPUFLAG_3DNOWEXT     },    .unit = "flags" },
         { "cmov",     NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_CMOV     },    .unit = "flags" },
         { "aesni"   , NULL, 0, AV_OPT_TYPE_CONST, { .i64 = CPUFLAG_AESNI        },    .unit = "flags" },
+        { "clmul"   , NULL, 0, AV_OPT_TYPE_CONST, { .i64 = CPUFLAG_CLMUL        },    .unit = "flags" },
         { "avx512"  , NULL, 0, AV_OPT_TYPE_CONST, { .i64 = CPUFLAG_AVX512       },    .unit = "flags" },
 #elif ARCH_ARM
         { "armv5te",  NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_ARMV5TE  },    .unit = "flags" },
@@ -169,6 +177,8 @@ int av_parse_cpu_flags(const char *s)
         { "armv8",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_ARMV8    },    .unit = "flags" },
         { "neon",     NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_NEON     },    .unit = "flags" },
         { "vfp",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_VFP      },    .unit = "flags" },
+        { "aes",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_AES      },    .unit = "flags" },
+        { "crc32",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_CRC32    },    .unit = "flags" },
 #endif
         { NULL },
     };
@@ -219,6 +229,7 @@ int av_parse_cpu_caps(unsigned *flags, const char *s)
         { "3dnowext", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_3DNOWEXT },    .unit = "flags" },
         { "cmov",     NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_CMOV     },    .unit = "flags" },
         { "aesni",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_AESNI    },    .unit = "flags" },
+        { "clmul",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_CLMUL    },    .unit = "flags" },
         { "avx512"  , NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_AVX512   },    .unit = "flags" },
 
 #define CPU_FLAG_P2 AV_CPU_FLAG_CMOV | AV_CPU_FLAG_MMX
@@ -250,6 +261,8 @@ int av_parse_cpu_caps(unsigned *flags, const char *s)
         { "armv8",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_ARMV8    },    .unit = "flags" },
         { "neon",     NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_NEON     },    .unit = "flags" },
         { "vfp",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_VFP      },    .unit = "flags" },
+        { "aes",      NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_AES      },    .unit = "flags" },
+        { "crc32",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AV_CPU_FLAG_CRC32    },    .unit = "flags" },
 #endif
         { NULL },
     };
@@ -306,6 +319,89 @@ int av_cpu_count(void)
     return nb_cpus;
 }
 
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+static int parse_cpu_list(cpu_set_t *set, const char *list)
+{
+    const char *p = list;
+
+    CPU_ZERO(set);
+    while (*p) {
+        char *end;
+        long first, last;
+
+        first = last = strtol(p, &end, 10);
+        if (end == p || first < 0)
+            return AVERROR(EINVAL);
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+                return AVERROR(EINVAL);
+        }
+        if (last >= CPU_SETSIZE)
+            return AVERROR(EINVAL);
+        for (; first <= last; first++)
+            CPU_SET(first, set);
+
+        p = end;
+        if (*p == ',')
+            p++;
+        else if (*p && *p != '\n')
+            return AVERROR(EINVAL);
+        else
+            break;
+    }
+    return 0;
+}
+
+static int get_node_cpus(cpu_set_t *set, int numa_node)
+{
+    char path[64], list[4096];
+    FILE *f;
+    int ret;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numa_node);
+    if (!(f = fopen(path, "r")))
+        return AVERROR(errno);
+    ret = fgets(list, sizeof(list), f) ? parse_cpu_list(set, list) : AVERROR(EIO);
+    fclose(f);
+    return ret;
+}
+#endif
+
+int avpriv_set_thread_affinity(const char *cpus, int numa_node)
+{
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+    cpu_set_t set, node_set;
+    int ret;
+
+    if (!cpus && numa_node < 0)
+        return 0;
+
+    if (cpus) {
+        if ((ret = parse_cpu_list(&set, cpus)) < 0)
+            return ret;
+    } else if (sched_getaffinity(0, sizeof(set), &set)) {
+        return AVERROR(errno);
+    }
+
+    if (numa_node >= 0) {
+        if ((ret = get_node_cpus(&node_set, numa_node)) < 0)
+            return ret;
+        CPU_AND(&set, &set, &node_set);
+    }
+
+    if (!CPU_COUNT(&set))
+        return AVERROR(EINVAL);
+    /* with pid 0, only the calling thread is affected */
+    if (sched_setaffinity(0, sizeof(set), &set))
+        return AVERROR(errno);
+    return 0;
+#else
+    return cpus || numa_node >= 0 ? AVERROR(ENOSYS) : 0;
+#endif
+}
+
 size_t av_cpu_max_align(void)
 {
     if (ARCH_AARCH64)
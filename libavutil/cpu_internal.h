@@ -51,4 +51,20 @@ size_t ff_get_cpu_max_align_arm(void);
 size_t ff_get_cpu_max_align_ppc(void);
 size_t ff_get_cpu_max_align_x86(void);
 
+/**
+ * Restrict the calling thread to a set of CPUs.
+ *
+ * Memory is usually placed on the NUMA node of the CPU touching it first,
+ * so buffers allocated and filled by a thread restricted to one node end up
+ * local to this node.
+ *
+ * @param cpus      list of CPUs and ranges of CPUs, e.g. "0-7,16,18", or NULL
+ *                  to keep the current set
+ * @param numa_node further restrict the set to the CPUs of this NUMA node,
+ *                  or -1
+ * @return 0 on success, a negative AVERROR code on failure or if setting the
+ *         affinity is not supported on this platform
+ */
+int avpriv_set_thread_affinity(const char *cpus, int numa_node);
+
 #endif /* AVUTIL_CPU_INTERNAL_H */
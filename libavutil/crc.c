@@ -25,6 +25,7 @@
 #include "bswap.h"
 #include "common.h"
 #include "crc.h"
+#include "crc_internal.h"
 
 #if CONFIG_HARDCODED_TABLES
 static const AVCRC av_crc_table[AV_CRC_MAX][257] = {
@@ -338,6 +339,14 @@ DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_32_IEEE_LE, 1, 32, 0xEDB88320)
 DECLARE_CRC_INIT_TABLE_ONCE(AV_CRC_16_ANSI_LE, 1, 16,     0xA001)
 #endif
 
+static CRCDSPContext crc_dsp;
+static AVOnce crc_dsp_once = AV_ONCE_INIT;
+
+static void crc_dsp_init_once(void)
+{
+    ff_crc_dsp_init(&crc_dsp);
+}
+
 int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size)
 {
     unsigned i, j;
@@ -386,11 +395,13 @@ const AVCRC *av_crc_get_table(AVCRCId crc_id)
     default: av_assert0(0);
     }
 #endif
+    if (crc_id == AV_CRC_32_IEEE || crc_id == AV_CRC_32_IEEE_LE)
+        ff_thread_once(&crc_dsp_once, crc_dsp_init_once);
     return av_crc_table[crc_id];
 }
 
-uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
-                const uint8_t *buffer, size_t length)
+static uint32_t crc_table(const AVCRC *ctx, uint32_t crc,
+                          const uint8_t *buffer, size_t length)
 {
     const uint8_t *end = buffer + length;
 
@@ -413,3 +424,45 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
 
     return crc;
 }
+
+uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
+                const uint8_t *buffer, size_t length)
+{
+    /* the built-in CRC-32 tables can only be obtained through
+     * av_crc_get_table(), which has initialized crc_dsp */
+    if (length >= 64) {
+        size_t blocks = length & ~(size_t)15;
+
+        if (ctx == av_crc_table[AV_CRC_32_IEEE_LE])
+            crc = crc_dsp.crc32_le(crc, buffer, blocks);
+        else if (ctx == av_crc_table[AV_CRC_32_IEEE])
+            crc = crc_dsp.crc32_be(crc, buffer, blocks);
+        else
+            blocks = 0;
+        buffer += blocks;
+        length -= blocks;
+    }
+
+    return crc_table(ctx, crc, buffer, length);
+}
+
+static uint32_t crc32_le_c(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    return crc_table(av_crc_get_table(AV_CRC_32_IEEE_LE), crc, buf, len);
+}
+
+static uint32_t crc32_be_c(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    return crc_table(av_crc_get_table(AV_CRC_32_IEEE), crc, buf, len);
+}
+
+av_cold void ff_crc_dsp_init(CRCDSPContext *c)
+{
+    c->crc32_le = crc32_le_c;
+    c->crc32_be = crc32_be_c;
+
+    if (ARCH_AARCH64)
+        ff_crc_dsp_init_aarch64(c);
+    if (ARCH_X86)
+        ff_crc_dsp_init_x86(c);
+}
@@ -0,0 +1,41 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_CRC_INTERNAL_H
+#define AVUTIL_CRC_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct CRCDSPContext {
+    /**
+     * Update crc with the bytes of buf, equivalent to av_crc() with the
+     * AV_CRC_32_IEEE_LE (crc32_le) or AV_CRC_32_IEEE (crc32_be) table.
+     *
+     * @param len number of bytes, a multiple of 16 and at least 64;
+     *            buf has no alignment requirement
+     */
+    uint32_t (*crc32_le)(uint32_t crc, const uint8_t *buf, size_t len);
+    uint32_t (*crc32_be)(uint32_t crc, const uint8_t *buf, size_t len);
+} CRCDSPContext;
+
+void ff_crc_dsp_init(CRCDSPContext *c);
+void ff_crc_dsp_init_aarch64(CRCDSPContext *c);
+void ff_crc_dsp_init_x86(CRCDSPContext *c);
+
+#endif /* AVUTIL_CRC_INTERNAL_H */
@@ -18,6 +18,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
 #include <string.h>
 
 #include "avstring.h"
@@ -30,6 +31,12 @@
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    unsigned int elems_size;
+    /* number of owners, a shared dictionary is copied before it is modified */
+    atomic_int refcount;
+    /* set when keys may match case-insensitively, so that copying the
+     * dictionary with av_dict_copy() would not give the same entries */
+    int dup_keys;
 };
 
 int av_dict_count(const AVDictionary *m)
@@ -67,13 +74,77 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     return NULL;
 }
 
+static void dict_unref(AVDictionary **pm)
+{
+    AVDictionary *m = *pm;
+
+    if (m && atomic_fetch_sub_explicit(&m->refcount, 1,
+                                       memory_order_acq_rel) == 1) {
+        while (m->count--) {
+            av_freep(&m->elems[m->count].key);
+            av_freep(&m->elems[m->count].value);
+        }
+        av_freep(&m->elems);
+        av_free(m);
+    }
+    *pm = NULL;
+}
+
+static int dict_make_writable(AVDictionary **pm)
+{
+    AVDictionary *m = *pm, *copy;
+    int i;
+
+    if (!m || atomic_load_explicit(&m->refcount, memory_order_acquire) == 1)
+        return 0;
+
+    copy = av_mallocz(sizeof(*copy));
+    if (!copy)
+        return AVERROR(ENOMEM);
+    atomic_init(&copy->refcount, 1);
+    copy->dup_keys = m->dup_keys;
+    copy->elems    = av_malloc_array(m->count, sizeof(*copy->elems));
+    if (!copy->elems)
+        goto fail;
+    copy->elems_size = m->count * sizeof(*copy->elems);
+
+    for (i = 0; i < m->count; i++) {
+        AVDictionaryEntry *e = &copy->elems[copy->count];
+        e->key   = av_strdup(m->elems[i].key);
+        e->value = av_strdup(m->elems[i].value);
+        if (!e->key || !e->value) {
+            av_free(e->key);
+            av_free(e->value);
+            goto fail;
+        }
+        copy->count++;
+    }
+
+    dict_unref(pm);
+    *pm = copy;
+    return 0;
+
+fail:
+    dict_unref(&copy);
+    return AVERROR(ENOMEM);
+}
+
 int av_dict_set(AVDictionary **pm, const char *key, const char *value,
                 int flags)
 {
-    AVDictionary *m = *pm;
+    AVDictionary *m;
     AVDictionaryEntry *tag = NULL;
     char *oldval = NULL, *copy_key = NULL, *copy_value = NULL;
 
+    if (dict_make_writable(pm) < 0) {
+        if (flags & AV_DICT_DONT_STRDUP_KEY)
+            av_free((void *)key);
+        if (flags & AV_DICT_DONT_STRDUP_VAL)
+            av_free((void *)value);
+        return AVERROR(ENOMEM);
+    }
+    m = *pm;
+
     if (!(flags & AV_DICT_MULTIKEY)) {
         tag = av_dict_get(m, key, NULL, flags);
     }
@@ -85,8 +156,11 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         copy_value = (void *)value;
     else if (copy_key)
         copy_value = av_strdup(value);
-    if (!m)
+    if (!m) {
         m = *pm = av_mallocz(sizeof(*m));
+        if (m)
+            atomic_init(&m->refcount, 1);
+    }
     if (!m || (key && !copy_key) || (value && !copy_value))
         goto err_out;
 
@@ -103,11 +177,18 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         av_free(tag->key);
         *tag = m->elems[--m->count];
     } else if (copy_value) {
-        AVDictionaryEntry *tmp = av_realloc(m->elems,
-                                            (m->count + 1) * sizeof(*m->elems));
+        AVDictionaryEntry *tmp;
+
+        if (m->count >= INT_MAX / sizeof(*m->elems) - 1)
+            goto err_out;
+        /* grow by half to keep the number of reallocations logarithmic */
+        tmp = av_fast_realloc(m->elems, &m->elems_size,
+                              (m->count + 1 + (m->count >> 1)) * sizeof(*m->elems));
         if (!tmp)
             goto err_out;
         m->elems = tmp;
+        if (flags & (AV_DICT_MULTIKEY | AV_DICT_MATCH_CASE))
+            m->dup_keys = 1;
     }
     if (copy_value) {
         m->elems[m->count].key = copy_key;
@@ -202,16 +283,7 @@ int av_dict_parse_string(AVDictionary **pm, const char *str,
 
 void av_dict_free(AVDictionary **pm)
 {
-    AVDictionary *m = *pm;
-
-    if (m) {
-        while (m->count--) {
-            av_freep(&m->elems[m->count].key);
-            av_freep(&m->elems[m->count].value);
-        }
-        av_freep(&m->elems);
-    }
-    av_freep(pm);
+    dict_unref(pm);
 }
 
 int av_dict_copy(AVDictionary **dst, const AVDictionary *src, int flags)
@@ -227,6 +299,16 @@ int av_dict_copy(AVDictionary **dst, const AVDictionary *src, int flags)
     return 0;
 }
 
+int ff_dict_ref(AVDictionary **dst, AVDictionary *src)
+{
+    if (*dst || !src || src->dup_keys)
+        return av_dict_copy(dst, src, 0);
+
+    atomic_fetch_add_explicit(&src->refcount, 1, memory_order_relaxed);
+    *dst = src;
+    return 0;
+}
+
 int av_dict_get_string(const AVDictionary *m, char **buffer,
                        const char key_val_sep, const char pairs_sep)
 {
@@ -174,8 +174,25 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprInsn *insns;     ///< compiled program, root node only
+    int nb_insns;
+    int nb_consts;              ///< 1 + highest constant index used, root node only
 };
 
+/**
+ * One instruction of a compiled expression. Every instruction writes its
+ * own register, params are the registers of the operands or -1.
+ */
+typedef struct ExprInsn {
+    const AVExpr *e;
+    int type;
+    double value;
+    int param[3];
+} ExprInsn;
+
+#define EXPR_BLOCK            16
+#define EXPR_MAX_STACK_INSNS 256
+
 static double etime(double v)
 {
     return av_gettime() * 0.000001;
@@ -331,6 +348,92 @@ static double eval_expr(Parser *p, AVExpr *e)
     return NAN;
 }
 
+/**
+ * Run one instruction of a compiled expression on n elements.
+ * The operand registers are stride doubles apart in regs, the values of
+ * the constants overridden by var_arrays are read from them at offset.
+ */
+static void exec_insn(const ExprInsn *in, double *dst, const double *regs, int stride, int n,
+                      const double *const_values, const double * const *var_arrays,
+                      int offset, const double *var, void *opaque)
+{
+    const AVExpr *e = in->e;
+    const double *a = in->param[0] >= 0 ? regs + in->param[0] * stride : NULL;
+    const double *b = in->param[1] >= 0 ? regs + in->param[1] * stride : NULL;
+    const double *c = in->param[2] >= 0 ? regs + in->param[2] * stride : NULL;
+    const double v = in->value;
+    int i;
+
+#define UNARY(expr)   for (i = 0; i < n; i++) { double d = a[i];                                dst[i] = (expr); } break
+#define BINARY(expr)  for (i = 0; i < n; i++) { double d = a[i], d2 = b[i];                     dst[i] = (expr); } break
+#define TERNARY(expr) for (i = 0; i < n; i++) { double d = a[i], d2 = b[i], d3 = c ? c[i] : 0; dst[i] = (expr); } break
+
+    switch (in->type) {
+    case e_value:
+        for (i = 0; i < n; i++)
+            dst[i] = v;
+        break;
+    case e_const: {
+        const double *arr = var_arrays ? var_arrays[e->const_index] : NULL;
+        if (arr) {
+            for (i = 0; i < n; i++)
+                dst[i] = v * arr[offset + i];
+        } else {
+            for (i = 0; i < n; i++)
+                dst[i] = v * const_values[e->const_index];
+        }
+        break;
+    }
+    case e_func0:  UNARY(v * e->a.func0(d));
+    case e_func1:  UNARY(v * e->a.func1(opaque, d));
+    case e_func2:  BINARY(v * e->a.func2(opaque, d, d2));
+    case e_squish: UNARY(1/(1+exp(4*d)));
+    case e_gauss:  UNARY(exp(-d*d/2)/sqrt(2*M_PI));
+    case e_ld:     UNARY(v * var[av_clip(d, 0, VARS-1)]);
+    case e_isnan:  UNARY(v * !!isnan(d));
+    case e_isinf:  UNARY(v * !!isinf(d));
+    case e_floor:  UNARY(v * floor(d));
+    case e_ceil:   UNARY(v * ceil (d));
+    case e_trunc:  UNARY(v * trunc(d));
+    case e_round:  UNARY(v * round(d));
+    case e_sgn:    UNARY(v * FFDIFFSIGN(d, 0));
+    case e_sqrt:   UNARY(v * sqrt (d));
+    case e_not:    UNARY(v * (d == 0));
+    case e_if:     TERNARY(v * ( d ? d2 : d3));
+    case e_ifnot:  TERNARY(v * (!d ? d2 : d3));
+    case e_clip:   TERNARY(isnan(d2) || isnan(d3) || isnan(d) || d2 > d3 ? NAN : v * av_clipd(d, d2, d3));
+    case e_between:TERNARY(v * (d >= d2 && d <= d3));
+    case e_lerp:   TERNARY(d + (d2 - d) * d3);
+    case e_mod:    BINARY(v * (d - floor((!CONFIG_FTRAPV || d2) ? d / d2 : d * INFINITY) * d2));
+    case e_gcd:    BINARY(v * av_gcd(d,d2));
+    case e_max:    BINARY(v * (d >  d2 ?   d : d2));
+    case e_min:    BINARY(v * (d <  d2 ?   d : d2));
+    case e_eq:     BINARY(v * (d == d2 ? 1.0 : 0.0));
+    case e_gt:     BINARY(v * (d >  d2 ? 1.0 : 0.0));
+    case e_gte:    BINARY(v * (d >= d2 ? 1.0 : 0.0));
+    case e_lt:     BINARY(v * (d <  d2 ? 1.0 : 0.0));
+    case e_lte:    BINARY(v * (d <= d2 ? 1.0 : 0.0));
+    case e_pow:    BINARY(v * pow(d, d2));
+    case e_mul:    BINARY(v * (d * d2));
+    case e_div:    BINARY(v * ((!CONFIG_FTRAPV || d2 ) ? (d / d2) : d * INFINITY));
+    case e_add:    BINARY(v * (d + d2));
+    case e_last:
+        for (i = 0; i < n; i++)
+            dst[i] = v * b[i];
+        break;
+    case e_hypot:  BINARY(v * hypot(d, d2));
+    case e_atan2:  BINARY(v * atan2(d, d2));
+    case e_bitand: BINARY(isnan(d) || isnan(d2) ? NAN : v * ((long int)d & (long int)d2));
+    case e_bitor:  BINARY(isnan(d) || isnan(d2) ? NAN : v * ((long int)d | (long int)d2));
+    default:
+        for (i = 0; i < n; i++)
+            dst[i] = NAN;
+    }
+#undef UNARY
+#undef BINARY
+#undef TERNARY
+}
+
 static int parse_expr(AVExpr **e, Parser *p);
 
 void av_expr_free(AVExpr *e)
@@ -340,6 +443,7 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    av_freep(&e->insns);
     av_freep(&e);
 }
 
@@ -682,6 +786,118 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/**
+ * Check whether e can be run as a straight-line program. Both sides of
+ * the conditional operators are evaluated by a program, so the parts of
+ * the tree the walker may skip or evaluate twice must not call back into
+ * the user functions; nodes with side effects or loops are never compiled.
+ */
+static int expr_compilable(const AVExpr *e, int speculative)
+{
+    if (!e) return 1;
+    switch (e->type) {
+        case e_st:
+        case e_while:
+        case e_taylor:
+        case e_root:
+        case e_random:
+        case e_print:
+            return 0;
+        case e_func1:
+        case e_func2:
+            if (speculative)
+                return 0;
+            break;
+        default:
+            break;
+        case e_if:
+        case e_ifnot:
+            return expr_compilable(e->param[0], speculative) &&
+                   expr_compilable(e->param[1], 1) &&
+                   expr_compilable(e->param[2], 1);
+        case e_between:
+            return expr_compilable(e->param[0], speculative) &&
+                   expr_compilable(e->param[1], speculative) &&
+                   expr_compilable(e->param[2], 1);
+        case e_clip:
+            return expr_compilable(e->param[0], 1) &&
+                   expr_compilable(e->param[1], speculative) &&
+                   expr_compilable(e->param[2], speculative);
+    }
+    return expr_compilable(e->param[0], speculative) &&
+           expr_compilable(e->param[1], speculative) &&
+           expr_compilable(e->param[2], speculative);
+}
+
+/* whether e evaluates to the same value every time and can be folded */
+static int expr_is_constant(const AVExpr *e)
+{
+    if (!e) return 1;
+    if (e->type == e_const || e->type == e_ld ||
+        e->type == e_func1 || e->type == e_func2 ||
+        (e->type == e_func0 && e->a.func0 == etime))
+        return 0;
+    return expr_is_constant(e->param[0]) &&
+           expr_is_constant(e->param[1]) &&
+           expr_is_constant(e->param[2]);
+}
+
+static int expr_nb_nodes(const AVExpr *e)
+{
+    if (!e) return 0;
+    return 1 + expr_nb_nodes(e->param[0]) + expr_nb_nodes(e->param[1]) + expr_nb_nodes(e->param[2]);
+}
+
+static int expr_nb_consts(const AVExpr *e)
+{
+    int n;
+    if (!e) return 0;
+    n = e->type == e_const ? e->const_index + 1 : 0;
+    n = FFMAX(n, expr_nb_consts(e->param[0]));
+    n = FFMAX(n, expr_nb_consts(e->param[1]));
+    return FFMAX(n, expr_nb_consts(e->param[2]));
+}
+
+/* emit the instructions computing e, operands first, return its register */
+static int compile_expr(AVExpr *root, AVExpr *e)
+{
+    ExprInsn *in;
+    int i, param[3] = { -1, -1, -1 };
+
+    if (expr_is_constant(e)) {
+        Parser p = { 0 };
+        in = &root->insns[root->nb_insns];
+        in->e     = e;
+        in->type  = e_value;
+        in->value = eval_expr(&p, e);
+        in->param[0] = in->param[1] = in->param[2] = -1;
+        return root->nb_insns++;
+    }
+
+    for (i = 0; i < 3; i++)
+        if (e->param[i])
+            param[i] = compile_expr(root, e->param[i]);
+
+    in = &root->insns[root->nb_insns];
+    in->e     = e;
+    in->type  = e->type;
+    in->value = e->value;
+    memcpy(in->param, param, sizeof(param));
+    return root->nb_insns++;
+}
+
+static int expr_compile(AVExpr *e)
+{
+    if (!expr_compilable(e, 0))
+        return 0;
+    e->insns = av_malloc_array(expr_nb_nodes(e), sizeof(*e->insns));
+    if (!e->insns)
+        return AVERROR(ENOMEM);
+    e->nb_insns = 0;
+    compile_expr(e, e);
+    return 0;
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -729,6 +945,9 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(ENOMEM);
         goto end;
     }
+    e->nb_consts = expr_nb_consts(e);
+    if ((ret = expr_compile(e)) < 0)
+        goto end;
     *expr = e;
     e = NULL;
 end:
@@ -766,6 +985,17 @@ int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg)
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
+
+    if (e->insns && e->nb_insns <= EXPR_MAX_STACK_INSNS) {
+        double regs[EXPR_MAX_STACK_INSNS];
+        int i;
+
+        for (i = 0; i < e->nb_insns; i++)
+            exec_insn(&e->insns[i], &regs[i], regs, 1, 1,
+                      const_values, NULL, 0, e->var, opaque);
+        return regs[e->nb_insns - 1];
+    }
+
     p.var= e->var;
 
     p.const_values = const_values;
@@ -773,6 +1003,82 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
     return eval_expr(&p, e);
 }
 
+static int expr_eval_array_walk(AVExpr *e, double *res, int nb,
+                                const double *const_values,
+                                const double * const *var_arrays, void *opaque)
+{
+    Parser p = { 0 };
+    double *values = av_malloc_array(FFMAX(e->nb_consts, 1), sizeof(*values));
+    int i, j;
+
+    if (!values)
+        return AVERROR(ENOMEM);
+    if (e->nb_consts)
+        memcpy(values, const_values, e->nb_consts * sizeof(*values));
+
+    p.var          = e->var;
+    p.const_values = values;
+    p.opaque       = opaque;
+    for (i = 0; i < nb; i++) {
+        for (j = 0; j < e->nb_consts; j++)
+            if (var_arrays && var_arrays[j])
+                values[j] = var_arrays[j][i];
+        res[i] = eval_expr(&p, e);
+    }
+    av_free(values);
+    return 0;
+}
+
+int av_expr_eval_array(AVExpr *e, double *res, int nb,
+                       const double *const_values,
+                       const double * const *var_arrays, void *opaque)
+{
+    const ExprInsn *insns = e->insns;
+    double *regs;
+    uint8_t *varying;
+    int i, j, k;
+
+    if (!insns)
+        return expr_eval_array_walk(e, res, nb, const_values, var_arrays, opaque);
+
+    regs = av_malloc_array(e->nb_insns, EXPR_BLOCK * sizeof(*regs) + 1);
+    if (!regs)
+        return AVERROR(ENOMEM);
+    varying = (uint8_t *)(regs + e->nb_insns * EXPR_BLOCK);
+
+    /* the instructions not depending on the arrays are run only once */
+    for (i = 0; i < e->nb_insns; i++) {
+        const ExprInsn *in = &insns[i];
+        double *dst = regs + i * EXPR_BLOCK;
+
+        varying[i] = (in->type == e_const && var_arrays && var_arrays[in->e->const_index]) ||
+                     (in->type == e_func0 && in->e->a.func0 == etime);
+        for (j = 0; j < 3; j++)
+            if (in->param[j] >= 0)
+                varying[i] |= varying[in->param[j]];
+        if (!varying[i]) {
+            exec_insn(in, dst, regs, EXPR_BLOCK, 1,
+                      const_values, var_arrays, 0, e->var, opaque);
+            for (k = 1; k < EXPR_BLOCK; k++)
+                dst[k] = dst[0];
+        }
+    }
+
+    for (k = 0; k < nb; k += EXPR_BLOCK) {
+        const int n = FFMIN(nb - k, EXPR_BLOCK);
+        const double *out = regs + (e->nb_insns - 1) * EXPR_BLOCK;
+
+        for (i = 0; i < e->nb_insns; i++)
+            if (varying[i])
+                exec_insn(&insns[i], regs + i * EXPR_BLOCK, regs, EXPR_BLOCK, n,
+                          const_values, var_arrays, k, e->var, opaque);
+        memcpy(res + k, out, n * sizeof(*res));
+    }
+
+    av_free(regs);
+    return 0;
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -86,6 +86,30 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for an array of values of some
+ * of its constants.
+ *
+ * This is equivalent to calling av_expr_eval() nb times, with the constants
+ * for which var_arrays has a non-NULL entry taking the values of that array,
+ * but is faster for expressions which can be compiled. The functions from
+ * funcs1 and funcs2 must be free of side effects, as they may be called
+ * fewer times or in a different order than by av_expr_eval().
+ *
+ * @param res an array of nb doubles where the results are stored
+ * @param nb number of values to evaluate the expression for
+ * @param const_values an array of values for the identifiers from av_expr_parse() const_names
+ * @param var_arrays an array indexed like const_values, either NULL or
+ * containing for each identifier NULL or an array of nb values overriding
+ * its entry in const_values
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ * @return >= 0 in case of success, a negative value corresponding to an
+ * AVERROR code otherwise
+ */
+int av_expr_eval_array(AVExpr *e, double *res, int nb,
+                       const double *const_values,
+                       const double * const *var_arrays, void *opaque);
+
 /**
  * Track the presence of variables and their number of occurrences in a parsed expression
  *
@@ -23,6 +23,7 @@
 #include "dict.h"
 #include "frame.h"
 #include "imgutils.h"
+#include "internal.h"
 #include "mem.h"
 #include "samplefmt.h"
 
@@ -247,6 +248,7 @@ static int get_video_buffer(AVFrame *frame, int align)
         ret = AVERROR(ENOMEM);
         goto fail;
     }
+    av_buffer_set_mem_tag(frame->buf[0], AV_MEM_TAG_FRAME);
 
     if ((ret = av_image_fill_pointers(frame->data, frame->format, padded_height,
                                       frame->buf[0]->data, frame->linesize)) < 0)
@@ -307,6 +309,7 @@ static int get_audio_buffer(AVFrame *frame, int align)
             av_frame_unref(frame);
             return AVERROR(ENOMEM);
         }
+        av_buffer_set_mem_tag(frame->buf[i], AV_MEM_TAG_FRAME);
         frame->extended_data[i] = frame->data[i] = frame->buf[i]->data;
     }
     for (i = 0; i < planes - AV_NUM_DATA_POINTERS; i++) {
@@ -315,6 +318,7 @@ static int get_audio_buffer(AVFrame *frame, int align)
             av_frame_unref(frame);
             return AVERROR(ENOMEM);
         }
+        av_buffer_set_mem_tag(frame->extended_buf[i], AV_MEM_TAG_FRAME);
         frame->extended_data[i + AV_NUM_DATA_POINTERS] = frame->extended_buf[i]->data;
     }
     return 0;
@@ -374,7 +378,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     dst->color_range            = src->color_range;
     dst->chroma_location        = src->chroma_location;
 
-    av_dict_copy(&dst->metadata, src->metadata, 0);
+    ff_dict_ref(&dst->metadata, src->metadata);
 
 #if FF_API_ERROR_FRAME
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -405,7 +409,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 return AVERROR(ENOMEM);
             }
         }
-        av_dict_copy(&sd_dst->metadata, sd_src->metadata, 0);
+        ff_dict_ref(&sd_dst->metadata, sd_src->metadata);
     }
 
 #if FF_API_FRAME_QP
@@ -126,6 +126,14 @@ typedef struct OpenCLDeviceContext {
 #endif
 } OpenCLDeviceContext;
 
+#if HAVE_OPENCL_VAAPI_INTEL_MEDIA
+typedef struct OpenCLVAMapping {
+    VASurfaceID             va_surface;
+    cl_mem_flags            cl_flags;
+    AVOpenCLFrameDescriptor *desc;
+} OpenCLVAMapping;
+#endif
+
 typedef struct OpenCLFramesContext {
     // Command queue used for transfer/mapping operations on this frames
     // context.  If the user supplies one, this is a reference to it.
@@ -140,6 +148,14 @@ typedef struct OpenCLFramesContext {
     int                   nb_mapped_frames;
     AVOpenCLFrameDescriptor *mapped_frames;
 #endif
+#if HAVE_OPENCL_VAAPI_INTEL_MEDIA
+    // When mapping from the internal pool of the frames context this one
+    // was derived from, the OpenCL images created for each VA surface are
+    // kept here and reused, so that only the acquire/release steps are
+    // needed for each mapping.
+    int                   nb_va_mapped_frames;
+    OpenCLVAMapping      *va_mapped_frames;
+#endif
 } OpenCLFramesContext;
 
 
@@ -1710,8 +1726,11 @@ static void opencl_frames_uninit(AVHWFramesContext *hwfc)
     OpenCLFramesContext *priv = hwfc->internal->priv;
     cl_int cle;
 
-#if HAVE_OPENCL_DXVA2 || HAVE_OPENCL_D3D11
+#if HAVE_OPENCL_DXVA2 || HAVE_OPENCL_D3D11 || HAVE_OPENCL_VAAPI_INTEL_MEDIA
     int i, p;
+#endif
+
+#if HAVE_OPENCL_DXVA2 || HAVE_OPENCL_D3D11
     for (i = 0; i < priv->nb_mapped_frames; i++) {
         AVOpenCLFrameDescriptor *desc = &priv->mapped_frames[i];
         for (p = 0; p < desc->nb_planes; p++) {
@@ -1726,6 +1745,23 @@ static void opencl_frames_uninit(AVHWFramesContext *hwfc)
     av_freep(&priv->mapped_frames);
 #endif
 
+#if HAVE_OPENCL_VAAPI_INTEL_MEDIA
+    for (i = 0; i < priv->nb_va_mapped_frames; i++) {
+        AVOpenCLFrameDescriptor *desc = priv->va_mapped_frames[i].desc;
+        for (p = 0; p < desc->nb_planes; p++) {
+            cle = clReleaseMemObject(desc->planes[p]);
+            if (cle != CL_SUCCESS) {
+                av_log(hwfc, AV_LOG_ERROR, "Failed to release CL "
+                       "image of plane %d of QSV/VAAPI surface %#x: %d.\n",
+                       p, priv->va_mapped_frames[i].va_surface, cle);
+            }
+        }
+        av_free(desc);
+    }
+    av_freep(&priv->va_mapped_frames);
+    priv->nb_va_mapped_frames = 0;
+#endif
+
     if (priv->command_queue) {
         cle = clReleaseCommandQueue(priv->command_queue);
         if (cle != CL_SUCCESS) {
@@ -2197,15 +2233,13 @@ static inline cl_mem_flags opencl_mem_flags_for_mapping(int map_flags)
 
 #if HAVE_OPENCL_VAAPI_INTEL_MEDIA
 
-static void opencl_unmap_from_qsv(AVHWFramesContext *dst_fc,
-                                  HWMapDescriptor *hwmap)
+static void opencl_release_qsv(AVHWFramesContext *dst_fc,
+                               AVOpenCLFrameDescriptor *desc)
 {
-    AVOpenCLFrameDescriptor    *desc = hwmap->priv;
     OpenCLDeviceContext *device_priv = dst_fc->device_ctx->internal->priv;
     OpenCLFramesContext *frames_priv = dst_fc->internal->priv;
     cl_event event;
     cl_int cle;
-    int p;
 
     av_log(dst_fc, AV_LOG_DEBUG, "Unmap QSV/VAAPI surface from OpenCL.\n");
 
@@ -2218,6 +2252,16 @@ static void opencl_unmap_from_qsv(AVHWFramesContext *dst_fc,
     }
 
     opencl_wait_events(dst_fc, &event, 1);
+}
+
+static void opencl_unmap_from_qsv(AVHWFramesContext *dst_fc,
+                                  HWMapDescriptor *hwmap)
+{
+    AVOpenCLFrameDescriptor *desc = hwmap->priv;
+    cl_int cle;
+    int p;
+
+    opencl_release_qsv(dst_fc, desc);
 
     for (p = 0; p < desc->nb_planes; p++) {
         cle = clReleaseMemObject(desc->planes[p]);
@@ -2231,20 +2275,59 @@ static void opencl_unmap_from_qsv(AVHWFramesContext *dst_fc,
     av_free(desc);
 }
 
+static void opencl_unmap_from_qsv_cached(AVHWFramesContext *dst_fc,
+                                         HWMapDescriptor *hwmap)
+{
+    // The images stay in the frames context cache.
+    opencl_release_qsv(dst_fc, hwmap->priv);
+}
+
+static int opencl_create_qsv_images(AVHWFramesContext *dst_fc,
+                                    VASurfaceID va_surface,
+                                    cl_mem_flags cl_flags,
+                                    AVOpenCLFrameDescriptor *desc)
+{
+    AVOpenCLDeviceContext   *dst_dev = dst_fc->device_ctx->hwctx;
+    OpenCLDeviceContext *device_priv = dst_fc->device_ctx->internal->priv;
+    cl_int cle;
+    int p;
+
+    memset(desc, 0, sizeof(*desc));
+
+    // The cl_intel_va_api_media_sharing extension only supports NV12
+    // surfaces, so for now there are always exactly two planes.
+    desc->nb_planes = 2;
+
+    for (p = 0; p < desc->nb_planes; p++) {
+        desc->planes[p] =
+            device_priv->clCreateFromVA_APIMediaSurfaceINTEL(
+                dst_dev->context, cl_flags, &va_surface, p, &cle);
+        if (!desc->planes[p]) {
+            av_log(dst_fc, AV_LOG_ERROR, "Failed to create CL "
+                   "image from plane %d of QSV/VAAPI surface "
+                   "%#x: %d.\n", p, va_surface, cle);
+            while (p--)
+                clReleaseMemObject(desc->planes[p]);
+            return AVERROR(EIO);
+        }
+    }
+
+    return 0;
+}
+
 static int opencl_map_from_qsv(AVHWFramesContext *dst_fc, AVFrame *dst,
                                const AVFrame *src, int flags)
 {
     AVHWFramesContext *src_fc =
         (AVHWFramesContext*)src->hw_frames_ctx->data;
-    AVOpenCLDeviceContext   *dst_dev = dst_fc->device_ctx->hwctx;
     OpenCLDeviceContext *device_priv = dst_fc->device_ctx->internal->priv;
     OpenCLFramesContext *frames_priv = dst_fc->internal->priv;
-    AVOpenCLFrameDescriptor *desc;
+    AVOpenCLFrameDescriptor *desc = NULL;
     VASurfaceID va_surface;
     cl_mem_flags cl_flags;
     cl_event event;
     cl_int cle;
-    int err, p;
+    int cache, err, p;
 
 #if CONFIG_LIBMFX
     if (src->format == AV_PIX_FMT_QSV) {
@@ -2265,29 +2348,55 @@ static int opencl_map_from_qsv(AVHWFramesContext *dst_fc, AVFrame *dst,
     av_log(src_fc, AV_LOG_DEBUG, "Map QSV/VAAPI surface %#x to "
            "OpenCL.\n", va_surface);
 
-    desc = av_mallocz(sizeof(*desc));
-    if (!desc)
-        return AVERROR(ENOMEM);
+    // Surfaces can only be cached if they are known to live at least as
+    // long as this frames context, which is the case for the internal
+    // pool of the frames context we were derived from.
+    cache = dst_fc->internal->source_frames &&
+            dst_fc->internal->source_frames->data == (uint8_t*)src_fc &&
+            src_fc->internal->pool_internal;
+
+    if (cache) {
+        for (p = 0; p < frames_priv->nb_va_mapped_frames; p++) {
+            OpenCLVAMapping *map = &frames_priv->va_mapped_frames[p];
+            if (map->va_surface == va_surface && map->cl_flags == cl_flags) {
+                desc = map->desc;
+                break;
+            }
+        }
+    }
 
-    // The cl_intel_va_api_media_sharing extension only supports NV12
-    // surfaces, so for now there are always exactly two planes.
-    desc->nb_planes = 2;
+    if (!desc) {
+        desc = av_malloc(sizeof(*desc));
+        if (!desc)
+            return AVERROR(ENOMEM);
 
-    for (p = 0; p < desc->nb_planes; p++) {
-        desc->planes[p] =
-            device_priv->clCreateFromVA_APIMediaSurfaceINTEL(
-                dst_dev->context, cl_flags, &va_surface, p, &cle);
-        if (!desc->planes[p]) {
-            av_log(dst_fc, AV_LOG_ERROR, "Failed to create CL "
-                   "image from plane %d of QSV/VAAPI surface "
-                   "%#x: %d.\n", p, va_surface, cle);
-            err = AVERROR(EIO);
-            goto fail;
+        err = opencl_create_qsv_images(dst_fc, va_surface, cl_flags, desc);
+        if (err < 0) {
+            av_free(desc);
+            return err;
         }
 
-        dst->data[p] = (uint8_t*)desc->planes[p];
+        if (cache) {
+            OpenCLVAMapping *maps =
+                av_realloc_array(frames_priv->va_mapped_frames,
+                                 frames_priv->nb_va_mapped_frames + 1,
+                                 sizeof(*maps));
+            if (!maps) {
+                err = AVERROR(ENOMEM);
+                goto fail_uncached;
+            }
+            frames_priv->va_mapped_frames = maps;
+            maps[frames_priv->nb_va_mapped_frames++] = (OpenCLVAMapping) {
+                .va_surface = va_surface,
+                .cl_flags   = cl_flags,
+                .desc       = desc,
+            };
+        }
     }
 
+    for (p = 0; p < desc->nb_planes; p++)
+        dst->data[p] = (uint8_t*)desc->planes[p];
+
     cle = device_priv->clEnqueueAcquireVA_APIMediaSurfacesINTEL(
         frames_priv->command_queue, desc->nb_planes, desc->planes,
         0, NULL, &event);
@@ -2303,7 +2412,8 @@ static int opencl_map_from_qsv(AVHWFramesContext *dst_fc, AVFrame *dst,
         goto fail;
 
     err = ff_hwframe_map_create(dst->hw_frames_ctx, dst, src,
-                                &opencl_unmap_from_qsv, desc);
+                                cache ? &opencl_unmap_from_qsv_cached
+                                      : &opencl_unmap_from_qsv, desc);
     if (err < 0)
         goto fail;
 
@@ -2313,9 +2423,12 @@ static int opencl_map_from_qsv(AVHWFramesContext *dst_fc, AVFrame *dst,
     return 0;
 
 fail:
+    // Cached images are released with the frames context.
+    if (cache)
+        return err;
+fail_uncached:
     for (p = 0; p < desc->nb_planes; p++)
-        if (desc->planes[p])
-            clReleaseMemObject(desc->planes[p]);
+        clReleaseMemObject(desc->planes[p]);
     av_freep(&desc);
     return err;
 }
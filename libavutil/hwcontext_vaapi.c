@@ -71,6 +71,14 @@ typedef struct VAAPIDeviceContext {
     int              nb_formats;
 } VAAPIDeviceContext;
 
+#if CONFIG_LIBDRM && VA_CHECK_VERSION(1, 1, 0)
+typedef struct VAAPIDRMExport {
+    VASurfaceID surface_id;
+    uint32_t    export_flags;
+    AVDRMFrameDescriptor *desc;
+} VAAPIDRMExport;
+#endif
+
 typedef struct VAAPIFramesContext {
     // Surface attributes set at create time.
     VASurfaceAttrib *attributes;
@@ -79,6 +87,13 @@ typedef struct VAAPIFramesContext {
     unsigned int rt_format;
     // Whether vaDeriveImage works.
     int derive_works;
+#if CONFIG_LIBDRM && VA_CHECK_VERSION(1, 1, 0)
+    // Surfaces of the internal pool which have already been exported as
+    // DRM PRIME objects.  They stay exported until the frames context is
+    // destroyed, so that mapping a pooled surface again is free.
+    VAAPIDRMExport *drm_exports;
+    int          nb_drm_exports;
+#endif
 } VAAPIFramesContext;
 
 typedef struct VAAPIMapping {
@@ -639,6 +654,19 @@ static void vaapi_frames_uninit(AVHWFramesContext *hwfc)
     AVVAAPIFramesContext *avfc = hwfc->hwctx;
     VAAPIFramesContext    *ctx = hwfc->internal->priv;
 
+#if CONFIG_LIBDRM && VA_CHECK_VERSION(1, 1, 0)
+    int i, j;
+
+    for (i = 0; i < ctx->nb_drm_exports; i++) {
+        AVDRMFrameDescriptor *desc = ctx->drm_exports[i].desc;
+        for (j = 0; j < desc->nb_objects; j++)
+            close(desc->objects[j].fd);
+        av_free(desc);
+    }
+    av_freep(&ctx->drm_exports);
+    ctx->nb_drm_exports = 0;
+#endif
+
     av_freep(&avfc->surface_ids);
     av_freep(&ctx->attributes);
 }
@@ -1126,11 +1154,16 @@ static int vaapi_map_to_drm_esh(AVHWFramesContext *hwfc, AVFrame *dst,
                                 const AVFrame *src, int flags)
 {
     AVVAAPIDeviceContext *hwctx = hwfc->device_ctx->hwctx;
+    VAAPIFramesContext      *ctx = hwfc->internal->priv;
     VASurfaceID surface_id;
     VAStatus vas;
     VADRMPRIMESurfaceDescriptor va_desc;
     AVDRMFrameDescriptor *drm_desc = NULL;
     uint32_t export_flags;
+    // Surfaces of the internal pool live as long as the frames context,
+    // so their exports can be kept and reused.  Surfaces from a user pool
+    // may be destroyed behind our back and are exported on every call.
+    int cache = !!hwfc->internal->pool_internal;
     int err, i, j;
 
     surface_id = (VASurfaceID)(uintptr_t)src->data[3];
@@ -1141,6 +1174,28 @@ static int vaapi_map_to_drm_esh(AVHWFramesContext *hwfc, AVFrame *dst,
     if (flags & AV_HWFRAME_MAP_WRITE)
         export_flags |= VA_EXPORT_SURFACE_WRITE_ONLY;
 
+    if (cache) {
+        for (i = 0; i < ctx->nb_drm_exports; i++) {
+            if (ctx->drm_exports[i].surface_id   == surface_id &&
+                ctx->drm_exports[i].export_flags == export_flags) {
+                drm_desc = ctx->drm_exports[i].desc;
+                break;
+            }
+        }
+        if (drm_desc) {
+            err = ff_hwframe_map_create(src->hw_frames_ctx, dst, src,
+                                        NULL, drm_desc);
+            if (err < 0)
+                return err;
+
+            dst->width   = src->width;
+            dst->height  = src->height;
+            dst->data[0] = (uint8_t*)drm_desc;
+
+            return 0;
+        }
+    }
+
     vas = vaExportSurfaceHandle(hwctx->display, surface_id,
                                 VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
                                 export_flags, &va_desc);
@@ -1180,10 +1235,32 @@ static int vaapi_map_to_drm_esh(AVHWFramesContext *hwfc, AVFrame *dst,
         }
     }
 
-    err = ff_hwframe_map_create(src->hw_frames_ctx, dst, src,
-                                &vaapi_unmap_to_drm_esh, drm_desc);
-    if (err < 0)
-        goto fail;
+    if (cache) {
+        VAAPIDRMExport *exports = av_realloc_array(ctx->drm_exports,
+                                                   ctx->nb_drm_exports + 1,
+                                                   sizeof(*exports));
+        if (!exports) {
+            err = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ctx->drm_exports = exports;
+        exports[ctx->nb_drm_exports++] = (VAAPIDRMExport) {
+            .surface_id   = surface_id,
+            .export_flags = export_flags,
+            .desc         = drm_desc,
+        };
+
+        // The descriptor is owned by the cache from now on.
+        err = ff_hwframe_map_create(src->hw_frames_ctx, dst, src,
+                                    NULL, drm_desc);
+        if (err < 0)
+            return err;
+    } else {
+        err = ff_hwframe_map_create(src->hw_frames_ctx, dst, src,
+                                    &vaapi_unmap_to_drm_esh, drm_desc);
+        if (err < 0)
+            goto fail;
+    }
 
     dst->width   = src->width;
     dst->height  = src->height;
@@ -360,6 +360,16 @@ void ff_check_pixfmt_descriptors(void);
  */
 int avpriv_dict_set_timestamp(AVDictionary **dict, const char *key, int64_t timestamp);
 
+/**
+ * Make *dst a reference to src if *dst is empty, otherwise add the entries
+ * of src to *dst like av_dict_copy() with no flags. A dictionary with more
+ * than one reference is copied on the first av_dict_set() through any of
+ * them.
+ *
+ * @return <0 on error
+ */
+int ff_dict_ref(AVDictionary **dst, AVDictionary *src);
+
 // Helper macro for AV_PIX_FMT_FLAG_PSEUDOPAL deprecation. Code inside FFmpeg
 // should always use FF_PSEUDOPAL. Once the public API flag gets removed, all
 // code using it is dead code.
@@ -29,6 +29,7 @@
 #include "config.h"
 
 #include <limits.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,6 +43,7 @@
 #include "dynarray.h"
 #include "intreadwrite.h"
 #include "mem.h"
+#include "thread.h"
 
 #ifdef MALLOC_PREFIX
 
@@ -506,3 +508,54 @@ void av_fast_mallocz(void *ptr, unsigned int *size, size_t min_size)
 {
     ff_fast_malloc(ptr, size, min_size, 1);
 }
+
+static atomic_int mem_accounting;
+static AVMutex mem_stats_lock = AV_MUTEX_INITIALIZER;
+static AVMemStats mem_stats[AV_MEM_TAG_NB];
+
+static const char *const mem_tag_names[AV_MEM_TAG_NB] = {
+    [AV_MEM_TAG_BUFFER] = "buffer",
+    [AV_MEM_TAG_FRAME]  = "frame",
+    [AV_MEM_TAG_PACKET] = "packet",
+    [AV_MEM_TAG_CODEC]  = "codec",
+    [AV_MEM_TAG_FILTER] = "filter",
+};
+
+void av_mem_accounting_enable(int enable)
+{
+    atomic_store(&mem_accounting, !!enable);
+}
+
+int ff_mem_accounting_enabled(void)
+{
+    return atomic_load_explicit(&mem_accounting, memory_order_relaxed);
+}
+
+void ff_mem_account(enum AVMemTag tag, int64_t size, int nb_allocs)
+{
+    AVMemStats *stats = &mem_stats[tag];
+
+    ff_mutex_lock(&mem_stats_lock);
+    stats->nb_allocs += nb_allocs;
+    stats->size      += size;
+    stats->peak_size  = FFMAX(stats->peak_size, stats->size);
+    ff_mutex_unlock(&mem_stats_lock);
+}
+
+int av_mem_get_stats(enum AVMemTag tag, AVMemStats *stats)
+{
+    if ((unsigned)tag >= AV_MEM_TAG_NB)
+        return AVERROR(EINVAL);
+
+    ff_mutex_lock(&mem_stats_lock);
+    *stats = mem_stats[tag];
+    ff_mutex_unlock(&mem_stats_lock);
+    return 0;
+}
+
+const char *av_mem_tag_name(enum AVMemTag tag)
+{
+    if ((unsigned)tag >= AV_MEM_TAG_NB)
+        return NULL;
+    return mem_tag_names[tag];
+}
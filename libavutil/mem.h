@@ -692,6 +692,64 @@ static inline int av_size_mult(size_t a, size_t b, size_t *r)
  */
 void av_max_alloc(size_t max);
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup lavu_mem_accounting Memory Accounting
+ *
+ * Opt-in accounting of the memory held by reference-counted buffers.
+ *
+ * While accounting is enabled, the data of buffers allocated with
+ * av_buffer_alloc(), av_buffer_allocz() and av_buffer_realloc(), including
+ * the buffers of pools using them, is counted under a tag until it is freed.
+ * Buffers allocated while accounting was disabled are never counted.
+ *
+ * @{
+ */
+
+/**
+ * Memory accounting tags, identifying what a buffer is used for.
+ */
+enum AVMemTag {
+    AV_MEM_TAG_BUFFER,  ///< buffers not tagged with anything else
+    AV_MEM_TAG_FRAME,   ///< frame data from av_frame_get_buffer() and decoder frame pools
+    AV_MEM_TAG_PACKET,  ///< packet data
+    AV_MEM_TAG_CODEC,   ///< codec internal buffer pools
+    AV_MEM_TAG_FILTER,  ///< filter frame pools
+    AV_MEM_TAG_NB       ///< Not part of ABI
+};
+
+/**
+ * Memory accounting counters of one tag.
+ */
+typedef struct AVMemStats {
+    int64_t nb_allocs;  ///< number of buffers allocated
+    int64_t size;       ///< size in bytes of the buffers currently allocated
+    int64_t peak_size;  ///< highest value of size
+} AVMemStats;
+
+/**
+ * Enable or disable memory accounting. It is disabled by default.
+ *
+ * Buffers counted while accounting was enabled are still uncounted when
+ * they are freed after accounting was disabled.
+ */
+void av_mem_accounting_enable(int enable);
+
+/**
+ * Get the memory accounting counters of a tag.
+ *
+ * @return 0 on success, AVERROR(EINVAL) for an invalid tag
+ */
+int av_mem_get_stats(enum AVMemTag tag, AVMemStats *stats);
+
+/**
+ * @return the name of a memory accounting tag, or NULL for an invalid tag
+ */
+const char *av_mem_tag_name(enum AVMemTag tag);
+
 /**
  * @}
  * @}
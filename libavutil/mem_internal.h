@@ -21,9 +21,22 @@
 #ifndef AVUTIL_MEM_INTERNAL_H
 #define AVUTIL_MEM_INTERNAL_H
 
+#include <stdint.h>
+
 #include "avassert.h"
 #include "mem.h"
 
+/**
+ * @return nonzero if memory accounting is enabled
+ */
+int ff_mem_accounting_enabled(void);
+
+/**
+ * Add size bytes and nb_allocs allocations, which may be negative, to the
+ * memory accounting counters of tag.
+ */
+void ff_mem_account(enum AVMemTag tag, int64_t size, int nb_allocs);
+
 static inline int ff_fast_malloc(void *ptr, unsigned int *size, size_t min_size, int zero_realloc)
 {
     void *val;
@@ -21,15 +21,21 @@
 #include "mem.h"
 #include "thread.h"
 #include "avassert.h"
+#include "cpu.h"
+#include "cpu_internal.h"
+#include "trace.h"
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
 
+typedef struct SlicePool SlicePool;
+
 typedef struct WorkerContext {
     AVSliceThread   *ctx;
     pthread_mutex_t mutex;
     pthread_cond_t  cond;
     pthread_t       thread;
     int             done;
+    unsigned        affinity_gen;
 } WorkerContext;
 
 struct AVSliceThread {
@@ -48,8 +54,38 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    char            *affinity_cpus;
+    int             affinity_node;
+    unsigned        affinity_gen;   ///< incremented on each affinity change
+
+    /* shared pool clients only, protected by the pool mutex */
+    SlicePool       *pool;
+    AVSliceThread   *next;
+    int             nb_slots;
+    int             nb_running;
+    pthread_cond_t  running_cond;
 };
 
+/**
+ * Process-wide pool of workers serving all the shared contexts. An idle
+ * worker takes a thread slot from the oldest running execution which still
+ * has some, then keeps taking jobs from it until none are left.
+ */
+struct SlicePool {
+    pthread_t       *threads;
+    int             nb_threads;
+    int             refcount;
+    int             finished;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    AVSliceThread   *queue;     ///< executions with thread slots left
+};
+
+static SlicePool *shared_pool;
+static AVMutex shared_pool_lock = AV_MUTEX_INITIALIZER;
+
 static int run_jobs(AVSliceThread *ctx)
 {
     unsigned nb_jobs    = ctx->nb_jobs;
@@ -57,9 +93,11 @@ static int run_jobs(AVSliceThread *ctx)
     unsigned first_job    = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
     unsigned current_job  = first_job;
 
+    av_trace_begin("slice_jobs", AV_NOPTS_VALUE);
     do {
         ctx->worker_func(ctx->priv, current_job, first_job, nb_jobs, nb_active_threads);
     } while ((current_job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs);
+    av_trace_end("slice_jobs");
 
     return current_job == nb_jobs + nb_active_threads - 1;
 }
@@ -82,6 +120,11 @@ static void *attribute_align_arg thread_worker(void *v)
             return NULL;
         }
 
+        if (w->affinity_gen != ctx->affinity_gen) {
+            w->affinity_gen = ctx->affinity_gen;
+            avpriv_set_thread_affinity(ctx->affinity_cpus, ctx->affinity_node);
+        }
+
         if (run_jobs(ctx)) {
             pthread_mutex_lock(&ctx->done_mutex);
             ctx->done = 1;
@@ -91,6 +134,173 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+/* must be called with the pool mutex held */
+static void take_slot(SlicePool *pool, AVSliceThread *ctx)
+{
+    if (!--ctx->nb_slots) {
+        AVSliceThread **p = &pool->queue;
+        while (*p != ctx)
+            p = &(*p)->next;
+        *p = ctx->next;
+        ctx->next = NULL;
+    }
+}
+
+static void *attribute_align_arg pool_worker(void *v)
+{
+    SlicePool *pool = v;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        AVSliceThread *ctx;
+
+        while (!pool->queue && !pool->finished)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        if (pool->finished)
+            break;
+
+        ctx = pool->queue;
+        take_slot(pool, ctx);
+        ctx->nb_running++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_jobs(ctx);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!--ctx->nb_running)
+            pthread_cond_signal(&ctx->running_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static void pool_free(SlicePool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool->threads);
+    av_free(pool);
+}
+
+static SlicePool *pool_ref(void)
+{
+    SlicePool *pool;
+    int nb_threads;
+
+    ff_mutex_lock(&shared_pool_lock);
+    if (shared_pool) {
+        shared_pool->refcount++;
+        pool = shared_pool;
+        goto end;
+    }
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        goto end;
+    nb_threads = av_cpu_count();
+    if (nb_threads > 1 && !(pool->threads = av_calloc(nb_threads, sizeof(*pool->threads)))) {
+        av_freep(&pool);
+        goto end;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pool->refcount = 1;
+
+    /* with a single CPU, the callers run all the jobs themselves */
+    for (; nb_threads > 1 && pool->nb_threads < nb_threads; pool->nb_threads++) {
+        if (pthread_create(&pool->threads[pool->nb_threads], NULL, pool_worker, pool)) {
+            pool_free(pool);
+            pool = NULL;
+            goto end;
+        }
+    }
+    shared_pool = pool;
+
+end:
+    ff_mutex_unlock(&shared_pool_lock);
+    return pool;
+}
+
+static void pool_unref(SlicePool *pool)
+{
+    ff_mutex_lock(&shared_pool_lock);
+    if (!--pool->refcount) {
+        shared_pool = NULL;
+        pool_free(pool);
+    }
+    ff_mutex_unlock(&shared_pool_lock);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    AVSliceThread *ctx;
+    SlicePool *pool;
+
+    av_assert0(nb_threads >= 0);
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    if (!(pool = pool_ref())) {
+        av_freep(pctx);
+        return AVERROR(ENOMEM);
+    }
+
+    /* the caller takes part in every execution */
+    if (!nb_threads || nb_threads > pool->nb_threads + 1)
+        nb_threads = pool->nb_threads + 1;
+
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->nb_threads  = nb_threads;
+    ctx->pool        = pool;
+    atomic_init(&ctx->first_job, 0);
+    atomic_init(&ctx->current_job, 0);
+    pthread_cond_init(&ctx->running_cond, NULL);
+
+    return nb_threads;
+}
+
+static void execute_shared(AVSliceThread *ctx)
+{
+    SlicePool *pool = ctx->pool;
+    AVSliceThread **p;
+
+    pthread_mutex_lock(&pool->mutex);
+    ctx->nb_slots = ctx->nb_active_threads;
+    for (p = &pool->queue; *p; p = &(*p)->next);
+    *p = ctx;
+    if (ctx->nb_slots > 1)
+        pthread_cond_broadcast(&pool->cond);
+
+    /* Run the slots no worker took, so that the execution completes even
+     * when the whole pool is busy elsewhere. */
+    while (ctx->nb_slots) {
+        take_slot(pool, ctx);
+        pthread_mutex_unlock(&pool->mutex);
+        run_jobs(ctx);
+        pthread_mutex_lock(&pool->mutex);
+    }
+
+    while (ctx->nb_running)
+        pthread_cond_wait(&ctx->running_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
@@ -170,6 +380,12 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
     atomic_store_explicit(&ctx->current_job, ctx->nb_active_threads, memory_order_relaxed);
+
+    if (ctx->pool) {
+        execute_shared(ctx);
+        return;
+    }
+
     nb_workers             = ctx->nb_active_threads;
     if (!ctx->main_func || !execute_main)
         nb_workers--;
@@ -188,14 +404,33 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
         is_last = run_jobs(ctx);
 
     if (!is_last) {
+        av_trace_begin("await_slices", AV_NOPTS_VALUE);
         pthread_mutex_lock(&ctx->done_mutex);
         while (!ctx->done)
             pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
         ctx->done = 0;
         pthread_mutex_unlock(&ctx->done_mutex);
+        av_trace_end("await_slices");
     }
 }
 
+int avpriv_slicethread_set_affinity(AVSliceThread *ctx, const char *cpus, int numa_node)
+{
+    char *affinity_cpus = NULL;
+
+    if (ctx->pool)
+        return 0;
+
+    if (cpus && !(affinity_cpus = av_strdup(cpus)))
+        return AVERROR(ENOMEM);
+
+    av_free(ctx->affinity_cpus);
+    ctx->affinity_cpus = affinity_cpus;
+    ctx->affinity_node = numa_node;
+    ctx->affinity_gen++;
+    return 0;
+}
+
 void avpriv_slicethread_free(AVSliceThread **pctx)
 {
     AVSliceThread *ctx;
@@ -205,6 +440,14 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+
+    if (ctx->pool) {
+        pthread_cond_destroy(&ctx->running_cond);
+        pool_unref(ctx->pool);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -227,6 +470,7 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
 
     pthread_cond_destroy(&ctx->done_cond);
     pthread_mutex_destroy(&ctx->done_mutex);
+    av_freep(&ctx->affinity_cpus);
     av_freep(&ctx->workers);
     av_freep(pctx);
 }
@@ -242,11 +486,25 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(EINVAL);
 }
 
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(EINVAL);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
 }
 
+int avpriv_slicethread_set_affinity(AVSliceThread *ctx, const char *cpus, int numa_node)
+{
+    av_assert0(0);
+    return AVERROR(EINVAL);
+}
+
 void avpriv_slicethread_free(AVSliceThread **pctx)
 {
     av_assert0(!pctx || !*pctx);
@@ -35,6 +35,23 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Create a slice threading context running its jobs on the process-wide
+ * pool shared by all such contexts, instead of on threads of its own.
+ * Executions of different contexts may run concurrently; the calling thread
+ * always takes part in the executions and runs the jobs no pool thread
+ * picked up.
+ * @param pctx slice threading context returned here
+ * @param priv private pointer to be passed to callback function
+ * @param worker_func callback function to be executed
+ * @param nb_threads maximum number of threads running jobs of one execution,
+ *                   0 for automatic, must be >= 0
+ * @return return number of threads or negative AVERROR on failure
+ */
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
@@ -43,6 +60,17 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
  */
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main);
 
+/**
+ * Restrict the worker threads of a context to a set of CPUs, see
+ * avpriv_set_thread_affinity(). The setting applies from the next
+ * execution on and is ignored for contexts using the shared pool.
+ * @param ctx slice threading context
+ * @param cpus list of CPUs, may be NULL
+ * @param numa_node NUMA node to restrict the threads to, or -1
+ * @return 0 on success, negative AVERROR on failure
+ */
+int avpriv_slicethread_set_affinity(AVSliceThread *ctx, const char *cpus, int numa_node);
+
 /**
  * Destroy slice threading context.
  * @param pctx pointer to context
@@ -0,0 +1,178 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program checks that an AVBufferPool shared by several threads
+ * never hands out the same buffer twice, also when it is limited in the
+ * number of unused buffers it keeps, and that it keeps no more than that.
+ * With -b it also prints the get/release throughput for an increasing number
+ * of threads.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS  16
+#define ITERATIONS   100000
+#define HELD_BUFFERS 4
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadArg;
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *bufs[HELD_BUFFERS] = { NULL };
+    int i, j;
+
+    for (i = 0; i < arg->iterations; i++) {
+        for (j = 0; j < HELD_BUFFERS; j++) {
+            bufs[j] = av_buffer_pool_get(arg->pool);
+            if (!bufs[j]) {
+                arg->errors++;
+                continue;
+            }
+            memset(bufs[j]->data, arg->id, bufs[j]->size);
+        }
+        for (j = 0; j < HELD_BUFFERS; j++) {
+            int k;
+
+            if (!bufs[j])
+                continue;
+            for (k = 0; k < bufs[j]->size; k++)
+                if (bufs[j]->data[k] != arg->id) {
+                    arg->errors++;
+                    break;
+                }
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+    return NULL;
+}
+
+static int run(int nb_threads, int iterations, int max_idle, int64_t *time)
+{
+    ThreadArg args[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    AVBufferPool *pool;
+    int64_t start;
+    int i, ret, errors = 0;
+
+    pool = av_buffer_pool_init(64, NULL);
+    if (!pool)
+        return -1;
+    av_buffer_pool_set_max_idle(pool, max_idle);
+
+    start = av_gettime_relative();
+    for (i = 0; i < nb_threads; i++) {
+        args[i].pool       = pool;
+        args[i].id         = i + 1;
+        args[i].iterations = iterations;
+        args[i].errors     = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &args[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            nb_threads = i;
+            errors++;
+            break;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    *time = av_gettime_relative() - start;
+
+    av_buffer_pool_uninit(&pool);
+    return errors;
+}
+
+static int nb_allocs;
+
+static AVBufferRef *counting_alloc(int size)
+{
+    nb_allocs++;
+    return av_buffer_alloc(size);
+}
+
+/* release more buffers than the pool may keep and count the reallocations */
+static int check_max_idle(void)
+{
+    AVBufferRef *bufs[4 * HELD_BUFFERS] = { NULL };
+    AVBufferPool *pool;
+    int i, pass, errors = 0;
+
+    pool = av_buffer_pool_init(64, counting_alloc);
+    if (!pool)
+        return -1;
+    av_buffer_pool_set_max_idle(pool, HELD_BUFFERS);
+
+    for (pass = 0; pass < 2; pass++) {
+        int expected = pass ? FF_ARRAY_ELEMS(bufs) - HELD_BUFFERS : FF_ARRAY_ELEMS(bufs);
+
+        nb_allocs = 0;
+        for (i = 0; i < FF_ARRAY_ELEMS(bufs); i++)
+            if (!(bufs[i] = av_buffer_pool_get(pool)))
+                errors++;
+        for (i = 0; i < FF_ARRAY_ELEMS(bufs); i++)
+            av_buffer_unref(&bufs[i]);
+        if (nb_allocs != expected) {
+            fprintf(stderr, "pass %d: %d buffers allocated instead of %d\n",
+                    pass, nb_allocs, expected);
+            errors++;
+        }
+    }
+
+    av_buffer_pool_uninit(&pool);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = argc > 1 && !strcmp(argv[1], "-b");
+    int nb_threads;
+
+    if (check_max_idle())
+        return 1;
+
+    for (nb_threads = 1; nb_threads <= MAX_THREADS; nb_threads *= 2) {
+        int iterations = bench ? ITERATIONS : ITERATIONS / 100;
+        int64_t time;
+        int errors = run(nb_threads, iterations, 0, &time);
+
+        if (!errors && !bench)
+            errors = run(nb_threads, iterations, HELD_BUFFERS, &time);
+        if (errors) {
+            fprintf(stderr, "%d threads: %d errors\n", nb_threads, errors);
+            return 1;
+        }
+        if (bench)
+            printf("%2d threads: %8.0f get+release/s per thread\n", nb_threads,
+                   iterations * HELD_BUFFERS * 1000000.0 / FFMAX(time, 1));
+    }
+
+    return 0;
+}
@@ -132,5 +132,29 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting ff_dict_ref()\n");
+    {
+        AVDictionary *ref = NULL;
+        av_dict_set(&dict, "a", "a", 0);
+        av_dict_set(&dict, "b", "b", 0);
+        ff_dict_ref(&ref, dict);
+        printf("shared %d\n", ref == dict);
+        av_dict_set(&ref, "a", "ref", 0);
+        av_dict_set(&ref, "c", "c", 0);
+        print_dict(dict);
+        print_dict(ref);
+        av_dict_free(&dict);
+        print_dict(ref);
+        av_dict_free(&ref);
+
+        av_dict_set(&dict, "a", "a", 0);
+        av_dict_set(&dict, "A", "A", AV_DICT_MATCH_CASE);
+        ff_dict_ref(&ref, dict);
+        printf("shared %d\n", ref == dict);
+        print_dict(ref);
+        av_dict_free(&ref);
+        av_dict_free(&dict);
+    }
+
     return 0;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "libavutil/common.h"
 #include "libavutil/libm.h"
 #include "libavutil/eval.h"
 
@@ -168,6 +169,46 @@ int main(int argc, char **argv)
     if (ret < 0)
         printf("av_expr_parse_and_eval failed\n");
 
+    {
+        static const char *const var_names[] = { "X", "Y", NULL };
+        static const char *const array_exprs[] = {
+            "X*Y+sin(X)-2^X",
+            "if(gt(X,Y),X-Y,hypot(X,Y))",
+            "ifnot(mod(X,3),X,-Y)",
+            "clip(X,Y,10)+between(X,Y,20)",
+            "lerp(X,Y,X/32)*sgn(X-16)",
+            "bitand(X,Y)+bitor(X,5)+floor(X/3)",
+            "st(0,X);ld(0)*Y",
+            "while(lt(ld(0),X),st(0,ld(0)+1))",
+            NULL
+        };
+        double xs[37], res[37], values[2] = { 0, 7 };
+        const double *arrays[2] = { xs, NULL };
+
+        for (i = 0; i < FF_ARRAY_ELEMS(xs); i++)
+            xs[i] = i - 2;
+        for (expr = array_exprs; *expr; expr++) {
+            AVExpr *e;
+            int ok = 1;
+
+            if (av_expr_parse(&e, *expr, var_names, NULL, NULL, NULL, NULL, 0, NULL) < 0 ||
+                av_expr_eval_array(e, res, FF_ARRAY_ELEMS(xs), values, arrays, NULL) < 0) {
+                printf("'%s' array evaluation failed\n", *expr);
+                continue;
+            }
+            av_expr_free(e);
+            av_expr_parse(&e, *expr, var_names, NULL, NULL, NULL, NULL, 0, NULL);
+            for (i = 0; i < FF_ARRAY_ELEMS(xs); i++) {
+                values[0] = xs[i];
+                d = av_expr_eval(e, values, NULL);
+                if (d != res[i] && !(isnan(d) && isnan(res[i])))
+                    ok = 0;
+            }
+            av_expr_free(e);
+            printf("'%s' array evaluation %s\n", *expr, ok ? "ok" : "mismatch");
+        }
+    }
+
     if (argc > 1 && !strcmp(argv[1], "-t")) {
         for (i = 0; i < 1050; i++) {
             START_TIMER;
@@ -18,28 +18,51 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
+#include "cpu.h"
 #include "fifo.h"
 #include "threadmessage.h"
 #include "thread.h"
 
+/* bounds of the number of polls before a SPSC queue end goes to sleep */
+#define SPIN_MIN 16
+#define SPIN_MAX 4096
+
 struct AVThreadMessageQueue {
 #if HAVE_THREADS
     AVFifoBuffer *fifo;
     pthread_mutex_t lock;
     pthread_cond_t cond_recv;
     pthread_cond_t cond_send;
-    int err_send;
-    int err_recv;
+    atomic_int err_send;
+    atomic_int err_recv;
     unsigned elsize;
     void (*free_func)(void *msg);
+
+    /* AV_THREAD_MESSAGE_QUEUE_SPSC: the fifo is replaced by a ring buffer
+     * whose read and write positions are owned by the receiving and sending
+     * thread respectively, only the message count is shared. */
+    unsigned flags;
+    uint8_t *buf;
+    unsigned nelem;
+    unsigned rpos;
+    unsigned wpos;
+    atomic_uint count;
+    atomic_int recv_waiting;
+    atomic_int send_waiting;
+    int spin_recv;
+    int spin_send;
+    int spin_max;
 #else
     int dummy;
 #endif
 };
 
-int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
-                                  unsigned nelem,
-                                  unsigned elsize)
+int av_thread_message_queue_alloc2(AVThreadMessageQueue **mq,
+                                   unsigned nelem,
+                                   unsigned elsize,
+                                   unsigned flags)
 {
 #if HAVE_THREADS
     AVThreadMessageQueue *rmq;
@@ -47,6 +70,8 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
 
     if (nelem > INT_MAX / elsize)
         return AVERROR(EINVAL);
+    if ((flags & AV_THREAD_MESSAGE_QUEUE_SPSC) && !nelem)
+        return AVERROR(EINVAL);
     if (!(rmq = av_mallocz(sizeof(*rmq))))
         return AVERROR(ENOMEM);
     if ((ret = pthread_mutex_init(&rmq->lock, NULL))) {
@@ -64,14 +89,28 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
         av_free(rmq);
         return AVERROR(ret);
     }
-    if (!(rmq->fifo = av_fifo_alloc(elsize * nelem))) {
+    if (flags & AV_THREAD_MESSAGE_QUEUE_SPSC)
+        rmq->buf  = av_malloc_array(nelem, elsize);
+    else
+        rmq->fifo = av_fifo_alloc(elsize * nelem);
+    if (!rmq->buf && !rmq->fifo) {
         pthread_cond_destroy(&rmq->cond_send);
         pthread_cond_destroy(&rmq->cond_recv);
         pthread_mutex_destroy(&rmq->lock);
         av_free(rmq);
         return AVERROR(ENOMEM);
     }
+    atomic_init(&rmq->err_send, 0);
+    atomic_init(&rmq->err_recv, 0);
+    atomic_init(&rmq->count, 0);
+    atomic_init(&rmq->recv_waiting, 0);
+    atomic_init(&rmq->send_waiting, 0);
     rmq->elsize = elsize;
+    rmq->flags  = flags;
+    rmq->nelem  = nelem;
+    /* spinning only helps if the other end runs on another CPU */
+    rmq->spin_max  = av_cpu_count() > 1 ? SPIN_MAX : 0;
+    rmq->spin_recv = rmq->spin_send = FFMIN(SPIN_MIN, rmq->spin_max);
     *mq = rmq;
     return 0;
 #else
@@ -80,6 +119,13 @@ int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
 #endif /* HAVE_THREADS */
 }
 
+int av_thread_message_queue_alloc(AVThreadMessageQueue **mq,
+                                  unsigned nelem,
+                                  unsigned elsize)
+{
+    return av_thread_message_queue_alloc2(mq, nelem, elsize, 0);
+}
+
 void av_thread_message_queue_set_free_func(AVThreadMessageQueue *mq,
                                            void (*free_func)(void *msg))
 {
@@ -94,6 +140,7 @@ void av_thread_message_queue_free(AVThreadMessageQueue **mq)
     if (*mq) {
         av_thread_message_flush(*mq);
         av_fifo_freep(&(*mq)->fifo);
+        av_freep(&(*mq)->buf);
         pthread_cond_destroy(&(*mq)->cond_send);
         pthread_cond_destroy(&(*mq)->cond_recv);
         pthread_mutex_destroy(&(*mq)->lock);
@@ -106,6 +153,8 @@ int av_thread_message_queue_nb_elems(AVThreadMessageQueue *mq)
 {
 #if HAVE_THREADS
     int ret;
+    if (mq->flags & AV_THREAD_MESSAGE_QUEUE_SPSC)
+        return atomic_load(&mq->count);
     pthread_mutex_lock(&mq->lock);
     ret = av_fifo_size(mq->fifo);
     pthread_mutex_unlock(&mq->lock);
@@ -121,13 +170,13 @@ static int av_thread_message_queue_send_locked(AVThreadMessageQueue *mq,
                                                void *msg,
                                                unsigned flags)
 {
-    while (!mq->err_send && av_fifo_space(mq->fifo) < mq->elsize) {
+    while (!atomic_load(&mq->err_send) && av_fifo_space(mq->fifo) < mq->elsize) {
         if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
             return AVERROR(EAGAIN);
         pthread_cond_wait(&mq->cond_send, &mq->lock);
     }
-    if (mq->err_send)
-        return mq->err_send;
+    if (atomic_load(&mq->err_send))
+        return atomic_load(&mq->err_send);
     av_fifo_generic_write(mq->fifo, msg, mq->elsize, NULL);
     /* one message is sent, signal one receiver */
     pthread_cond_signal(&mq->cond_recv);
@@ -138,19 +187,106 @@ static int av_thread_message_queue_recv_locked(AVThreadMessageQueue *mq,
                                                void *msg,
                                                unsigned flags)
 {
-    while (!mq->err_recv && av_fifo_size(mq->fifo) < mq->elsize) {
+    while (!atomic_load(&mq->err_recv) && av_fifo_size(mq->fifo) < mq->elsize) {
         if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
             return AVERROR(EAGAIN);
         pthread_cond_wait(&mq->cond_recv, &mq->lock);
     }
     if (av_fifo_size(mq->fifo) < mq->elsize)
-        return mq->err_recv;
+        return atomic_load(&mq->err_recv);
     av_fifo_generic_read(mq->fifo, msg, mq->elsize, NULL);
     /* one message space appeared, signal one sender */
     pthread_cond_signal(&mq->cond_send);
     return 0;
 }
 
+static int spsc_can_proceed(AVThreadMessageQueue *mq, int recv)
+{
+    unsigned count = atomic_load(&mq->count);
+    return recv ? count || atomic_load(&mq->err_recv)
+                : count < mq->nelem || atomic_load(&mq->err_send);
+}
+
+/**
+ * Wait until the calling end of a SPSC queue can proceed: poll the queue
+ * for a while, then sleep on the lock. The polling budget doubles each time
+ * polling was enough and halves each time it was not.
+ *
+ * The waiting flag is set before checking the queue a last time, and the
+ * other end updates the count before checking the flag, so one of them
+ * always sees the other and no wakeup is lost.
+ */
+static void spsc_wait(AVThreadMessageQueue *mq, int recv)
+{
+    atomic_int *waiting = recv ? &mq->recv_waiting : &mq->send_waiting;
+    pthread_cond_t *cond = recv ? &mq->cond_recv : &mq->cond_send;
+    int *spin = recv ? &mq->spin_recv : &mq->spin_send;
+    int i;
+
+    for (i = 0; i < *spin; i++) {
+        if (spsc_can_proceed(mq, recv)) {
+            *spin = FFMIN(*spin * 2, mq->spin_max);
+            return;
+        }
+    }
+    *spin = FFMIN(FFMAX(*spin / 2, SPIN_MIN), mq->spin_max);
+
+    pthread_mutex_lock(&mq->lock);
+    atomic_store(waiting, 1);
+    while (!spsc_can_proceed(mq, recv))
+        pthread_cond_wait(cond, &mq->lock);
+    atomic_store(waiting, 0);
+    pthread_mutex_unlock(&mq->lock);
+}
+
+/* wake up the receiving end if recv is set, the sending end otherwise */
+static void spsc_wake(AVThreadMessageQueue *mq, int recv)
+{
+    if (atomic_load(recv ? &mq->recv_waiting : &mq->send_waiting)) {
+        pthread_mutex_lock(&mq->lock);
+        pthread_cond_signal(recv ? &mq->cond_recv : &mq->cond_send);
+        pthread_mutex_unlock(&mq->lock);
+    }
+}
+
+static int spsc_send(AVThreadMessageQueue *mq, void *msg, unsigned flags)
+{
+    int err;
+
+    if (!spsc_can_proceed(mq, 0)) {
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        spsc_wait(mq, 0);
+    }
+    if ((err = atomic_load(&mq->err_send)))
+        return err;
+
+    memcpy(mq->buf + mq->wpos * mq->elsize, msg, mq->elsize);
+    if (++mq->wpos == mq->nelem)
+        mq->wpos = 0;
+    atomic_fetch_add(&mq->count, 1);
+    spsc_wake(mq, 1);
+    return 0;
+}
+
+static int spsc_recv(AVThreadMessageQueue *mq, void *msg, unsigned flags)
+{
+    if (!spsc_can_proceed(mq, 1)) {
+        if ((flags & AV_THREAD_MESSAGE_NONBLOCK))
+            return AVERROR(EAGAIN);
+        spsc_wait(mq, 1);
+    }
+    if (!atomic_load(&mq->count))
+        return atomic_load(&mq->err_recv);
+
+    memcpy(msg, mq->buf + mq->rpos * mq->elsize, mq->elsize);
+    if (++mq->rpos == mq->nelem)
+        mq->rpos = 0;
+    atomic_fetch_sub(&mq->count, 1);
+    spsc_wake(mq, 0);
+    return 0;
+}
+
 #endif /* HAVE_THREADS */
 
 int av_thread_message_queue_send(AVThreadMessageQueue *mq,
@@ -160,6 +296,9 @@ int av_thread_message_queue_send(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
+    if (mq->flags & AV_THREAD_MESSAGE_QUEUE_SPSC)
+        return spsc_send(mq, msg, flags);
+
     pthread_mutex_lock(&mq->lock);
     ret = av_thread_message_queue_send_locked(mq, msg, flags);
     pthread_mutex_unlock(&mq->lock);
@@ -176,6 +315,9 @@ int av_thread_message_queue_recv(AVThreadMessageQueue *mq,
 #if HAVE_THREADS
     int ret;
 
+    if (mq->flags & AV_THREAD_MESSAGE_QUEUE_SPSC)
+        return spsc_recv(mq, msg, flags);
+
     pthread_mutex_lock(&mq->lock);
     ret = av_thread_message_queue_recv_locked(mq, msg, flags);
     pthread_mutex_unlock(&mq->lock);
@@ -190,7 +332,7 @@ void av_thread_message_queue_set_err_send(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_send = err;
+    atomic_store(&mq->err_send, err);
     pthread_cond_broadcast(&mq->cond_send);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
@@ -201,7 +343,7 @@ void av_thread_message_queue_set_err_recv(AVThreadMessageQueue *mq,
 {
 #if HAVE_THREADS
     pthread_mutex_lock(&mq->lock);
-    mq->err_recv = err;
+    atomic_store(&mq->err_recv, err);
     pthread_cond_broadcast(&mq->cond_recv);
     pthread_mutex_unlock(&mq->lock);
 #endif /* HAVE_THREADS */
@@ -213,6 +355,20 @@ static void free_func_wrap(void *arg, void *msg, int size)
     AVThreadMessageQueue *mq = arg;
     mq->free_func(msg);
 }
+
+static void spsc_flush(AVThreadMessageQueue *mq)
+{
+    unsigned i, used = atomic_load(&mq->count);
+
+    for (i = 0; i < used; i++) {
+        if (mq->free_func)
+            mq->free_func(mq->buf + mq->rpos * mq->elsize);
+        if (++mq->rpos == mq->nelem)
+            mq->rpos = 0;
+    }
+    atomic_fetch_sub(&mq->count, used);
+    spsc_wake(mq, 0);
+}
 #endif
 
 void av_thread_message_flush(AVThreadMessageQueue *mq)
@@ -221,6 +377,11 @@ void av_thread_message_flush(AVThreadMessageQueue *mq)
     int used, off;
     void *free_func = mq->free_func;
 
+    if (mq->flags & AV_THREAD_MESSAGE_QUEUE_SPSC) {
+        spsc_flush(mq);
+        return;
+    }
+
     pthread_mutex_lock(&mq->lock);
     used = av_fifo_size(mq->fifo);
     if (free_func)
@@ -0,0 +1,218 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "avutil.h"
+#include "error.h"
+#include "log.h"
+#include "mem.h"
+#include "thread.h"
+#include "time.h"
+#include "trace.h"
+
+/* recording stops once this many events are stored */
+#define MAX_EVENTS (1 << 22)
+
+typedef struct TraceEvent {
+    const char *name;
+    int64_t ts;
+    int64_t pts;
+    int tid;
+    char phase;
+} TraceEvent;
+
+static atomic_int trace_active;
+static AVMutex trace_lock = AV_MUTEX_INITIALIZER;
+
+static char *trace_filename;
+static int64_t trace_start_time;
+static TraceEvent *events;
+static unsigned nb_events, nb_events_allocated;
+static int trace_truncated;
+
+#if HAVE_THREADS
+static pthread_t *threads;
+static int nb_threads;
+#endif
+
+/* small per-process thread index, as pthread_t is not an integer everywhere */
+static int thread_index(void)
+{
+#if HAVE_THREADS
+    pthread_t self = pthread_self();
+    pthread_t *tmp;
+    int i;
+
+    for (i = 0; i < nb_threads; i++)
+        if (pthread_equal(threads[i], self))
+            return i;
+
+    tmp = av_realloc_array(threads, nb_threads + 1, sizeof(*threads));
+    if (!tmp)
+        return -1;
+    threads = tmp;
+    threads[nb_threads] = self;
+    return nb_threads++;
+#else
+    return 0;
+#endif
+}
+
+static void add_event(const char *name, char phase, int64_t pts)
+{
+    int64_t ts;
+    int tid;
+
+    if (!atomic_load_explicit(&trace_active, memory_order_relaxed))
+        return;
+
+    ts = av_gettime_relative();
+
+    ff_mutex_lock(&trace_lock);
+    if (!atomic_load_explicit(&trace_active, memory_order_relaxed))
+        goto end;
+
+    if (nb_events == nb_events_allocated) {
+        unsigned size = FFMAX(nb_events_allocated * 2, 4096);
+        TraceEvent *tmp = NULL;
+
+        if (size <= MAX_EVENTS)
+            tmp = av_realloc_array(events, size, sizeof(*events));
+        if (!tmp) {
+            trace_truncated = 1;
+            atomic_store(&trace_active, 0);
+            goto end;
+        }
+        events              = tmp;
+        nb_events_allocated = size;
+    }
+
+    tid = thread_index();
+    if (tid < 0)
+        goto end;
+
+    events[nb_events++] = (TraceEvent) {
+        .name  = name,
+        .ts    = ts - trace_start_time,
+        .pts   = pts,
+        .tid   = tid,
+        .phase = phase,
+    };
+
+end:
+    ff_mutex_unlock(&trace_lock);
+}
+
+void av_trace_begin(const char *name, int64_t pts)
+{
+    add_event(name, 'B', pts);
+}
+
+void av_trace_end(const char *name)
+{
+    add_event(name, 'E', AV_NOPTS_VALUE);
+}
+
+int av_trace_start(const char *filename)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&trace_lock);
+    if (trace_filename)
+        goto end;
+
+    trace_filename = av_strdup(filename);
+    if (!trace_filename) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    trace_start_time = av_gettime_relative();
+    trace_truncated  = 0;
+    atomic_store(&trace_active, 1);
+
+end:
+    ff_mutex_unlock(&trace_lock);
+    return ret;
+}
+
+static int write_events(const char *filename)
+{
+    FILE *f = av_fopen_utf8(filename, "w");
+    unsigned i;
+    int ret = 0;
+
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(NULL, AV_LOG_ERROR, "Could not open trace file '%s': %s\n",
+               filename, av_err2str(ret));
+        return ret;
+    }
+
+    fprintf(f, "{\"traceEvents\":[");
+    for (i = 0; i < nb_events; i++) {
+        const TraceEvent *e = &events[i];
+
+        fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%"PRId64","
+                "\"pid\":0,\"tid\":%d", i ? "," : "", e->name, e->phase,
+                e->ts, e->tid);
+        if (e->pts != AV_NOPTS_VALUE)
+            fprintf(f, ",\"args\":{\"pts\":%"PRId64"}", e->pts);
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    if (ferror(f))
+        ret = AVERROR(EIO);
+    if (fclose(f) && !ret)
+        ret = AVERROR(errno);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Error writing trace file '%s': %s\n",
+               filename, av_err2str(ret));
+    return ret;
+}
+
+int av_trace_stop(void)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&trace_lock);
+    if (!trace_filename)
+        goto end;
+
+    atomic_store(&trace_active, 0);
+    if (trace_truncated)
+        av_log(NULL, AV_LOG_WARNING, "Trace truncated after %u events\n",
+               nb_events);
+    ret = write_events(trace_filename);
+
+    av_freep(&trace_filename);
+    av_freep(&events);
+    nb_events = nb_events_allocated = 0;
+#if HAVE_THREADS
+    av_freep(&threads);
+    nb_threads = 0;
+#endif
+
+end:
+    ff_mutex_unlock(&trace_lock);
+    return ret;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_trace
+ * Process-wide recording of trace events.
+ */
+
+#ifndef AVUTIL_TRACE_H
+#define AVUTIL_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup lavu_trace Trace events
+ * @ingroup lavu_misc
+ *
+ * Spans of work and waits, recorded with the thread they ran on and the
+ * timestamp of the frame or packet they processed, and written in the Chrome
+ * trace event JSON format, which chrome://tracing and Perfetto can display.
+ *
+ * The libraries record spans around frame and slice threading, filter
+ * activation and interleaved muxing. Recording costs one atomic load per
+ * span while no trace is started.
+ *
+ * @{
+ */
+
+/**
+ * Start recording trace events in memory. Does nothing if a trace is
+ * already being recorded.
+ *
+ * @param filename name of the file the events are written to by
+ *                 av_trace_stop()
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_trace_start(const char *filename);
+
+/**
+ * Stop recording and write the recorded events to the file given to
+ * av_trace_start().
+ *
+ * @return 0 on success or if no trace was started, a negative AVERROR code
+ *         on failure
+ */
+int av_trace_stop(void);
+
+/**
+ * Begin a span on the calling thread.
+ *
+ * @param name name of the span; must be a static string which needs no
+ *             escaping in JSON
+ * @param pts  timestamp of the frame or packet processed by the span, or
+ *             AV_NOPTS_VALUE
+ */
+void av_trace_begin(const char *name, int64_t pts);
+
+/**
+ * End the innermost span begun on the calling thread.
+ *
+ * @param name name given to av_trace_begin()
+ */
+void av_trace_end(const char *name);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_TRACE_H */
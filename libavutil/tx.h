@@ -60,7 +60,7 @@ enum AVTXType {
  * is not allowed.
  *
  * @param s the transform context
- * @param out the output array
+ * @param out the output array, must be aligned as done by av_malloc()
  * @param in the input array
  * @param stride the input or output stride (depending on transform direction)
  * in bytes, currently implemented for all MDCT transforms
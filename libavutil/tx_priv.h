@@ -67,6 +67,9 @@ struct AVTXContext {
     FFTComplex *tmp;    /* Temporary buffer needed for all compound transforms */
     int        *pfatab; /* Input/Output mapping for compound transforms */
     int        *revtab; /* Input mapping for power of two transforms */
+
+    /* Power of two FFT of size 1 << nbits, the input permuted with revtab */
+    void (*fft)(FFTComplex *z, int nbits);
 };
 
 /* Shared functions */
@@ -97,6 +100,8 @@ int ff_tx_init_mdct_fft_double(AVTXContext *s, av_tx_fn *tx,
                                enum AVTXType type, int inv, int len,
                                const void *scale, uint64_t flags);
 
+void ff_tx_init_float_x86(AVTXContext *s);
+
 typedef struct CosTabsInitOnce {
     void (*func)(void);
     AVOnce control;
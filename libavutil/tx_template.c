@@ -363,6 +363,11 @@ static void (* const fft_dispatch[])(FFTComplex*) = {
     fft2048, fft4096, fft8192, fft16384, fft32768, fft65536, fft131072
 };
 
+static void fft_ptwo(FFTComplex *z, int nbits)
+{
+    fft_dispatch[nbits - 2](z);
+}
+
 #define DECL_COMP_FFT(N)                                                       \
 static void compound_fft_##N##xM(AVTXContext *s, void *_out,                   \
                                  void *_in, ptrdiff_t stride)                  \
@@ -371,7 +376,7 @@ static void compound_fft_##N##xM(AVTXContext *s, void *_out,                   \
     FFTComplex *in = _in;                                                      \
     FFTComplex *out = _out;                                                    \
     FFTComplex fft##N##in[N];                                                  \
-    void (*fftp)(FFTComplex *z) = fft_dispatch[av_log2(m) - 2];                \
+    const int mb = av_log2(m);                                                 \
                                                                                \
     for (int i = 0; i < m; i++) {                                              \
         for (int j = 0; j < N; j++)                                            \
@@ -380,7 +385,7 @@ static void compound_fft_##N##xM(AVTXContext *s, void *_out,                   \
     }                                                                          \
                                                                                \
     for (int i = 0; i < N; i++)                                                \
-        fftp(s->tmp + m*i);                                                    \
+        s->fft(s->tmp + m*i, mb);                                              \
                                                                                \
     for (int i = 0; i < N*m; i++)                                              \
         out[i] = s->tmp[out_map[i]];                                           \
@@ -395,10 +400,10 @@ static void monolithic_fft(AVTXContext *s, void *_out, void *_in,
 {
     FFTComplex *in = _in;
     FFTComplex *out = _out;
-    int m = s->m, mb = av_log2(m) - 2;
+    int m = s->m, mb = av_log2(m);
     for (int i = 0; i < m; i++)
         out[s->revtab[i]] = in[i];
-    fft_dispatch[mb](out);
+    s->fft(out, mb);
 }
 
 #define DECL_COMP_IMDCT(N)                                                     \
@@ -410,7 +415,7 @@ static void compound_imdct_##N##xM(AVTXContext *s, void *_dst, void *_src,     \
     const int m = s->m, len8 = N*m >> 1;                                       \
     const int *in_map = s->pfatab, *out_map = in_map + N*m;                    \
     const FFTSample *src = _src, *in1, *in2;                                   \
-    void (*fftp)(FFTComplex *) = fft_dispatch[av_log2(m) - 2];                 \
+    const int mb = av_log2(m);                                                 \
                                                                                \
     stride /= sizeof(*src); /* To convert it from bytes */                     \
     in1 = src;                                                                 \
@@ -426,7 +431,7 @@ static void compound_imdct_##N##xM(AVTXContext *s, void *_dst, void *_src,     \
     }                                                                          \
                                                                                \
     for (int i = 0; i < N; i++)                                                \
-        fftp(s->tmp + m*i);                                                    \
+        s->fft(s->tmp + m*i, mb);                                              \
                                                                                \
     for (int i = 0; i < len8; i++) {                                           \
         const int i0 = len8 + i, i1 = len8 - i - 1;                            \
@@ -451,7 +456,7 @@ static void compound_mdct_##N##xM(AVTXContext *s, void *_dst, void *_src,      \
     FFTComplex *exp = s->exptab, tmp, fft##N##in[N];                           \
     const int m = s->m, len4 = N*m, len3 = len4 * 3, len8 = len4 >> 1;         \
     const int *in_map = s->pfatab, *out_map = in_map + N*m;                    \
-    void (*fftp)(FFTComplex *) = fft_dispatch[av_log2(m) - 2];                 \
+    const int mb = av_log2(m);                                                 \
                                                                                \
     stride /= sizeof(*dst);                                                    \
                                                                                \
@@ -472,7 +477,7 @@ static void compound_mdct_##N##xM(AVTXContext *s, void *_dst, void *_src,      \
     }                                                                          \
                                                                                \
     for (int i = 0; i < N; i++)                                                \
-        fftp(s->tmp + m*i);                                                    \
+        s->fft(s->tmp + m*i, mb);                                              \
                                                                                \
     for (int i = 0; i < len8; i++) {                                           \
         const int i0 = len8 + i, i1 = len8 - i - 1;                            \
@@ -497,7 +502,7 @@ static void monolithic_imdct(AVTXContext *s, void *_dst, void *_src,
     FFTComplex *z = _dst, *exp = s->exptab;
     const int m = s->m, len8 = m >> 1;
     const FFTSample *src = _src, *in1, *in2;
-    void (*fftp)(FFTComplex *) = fft_dispatch[av_log2(m) - 2];
+    const int mb = av_log2(m);
 
     stride /= sizeof(*src);
     in1 = src;
@@ -508,7 +513,7 @@ static void monolithic_imdct(AVTXContext *s, void *_dst, void *_src,
         CMUL3(z[s->revtab[i]], tmp, exp[i]);
     }
 
-    fftp(z);
+    s->fft(z, mb);
 
     for (int i = 0; i < len8; i++) {
         const int i0 = len8 + i, i1 = len8 - i - 1;
@@ -526,7 +531,7 @@ static void monolithic_mdct(AVTXContext *s, void *_dst, void *_src,
     FFTSample *src = _src, *dst = _dst;
     FFTComplex *exp = s->exptab, tmp, *z = _dst;
     const int m = s->m, len4 = m, len3 = len4 * 3, len8 = len4 >> 1;
-    void (*fftp)(FFTComplex *) = fft_dispatch[av_log2(m) - 2];
+    const int mb = av_log2(m);
 
     stride /= sizeof(*dst);
 
@@ -543,7 +548,7 @@ static void monolithic_mdct(AVTXContext *s, void *_dst, void *_src,
              exp[i].re, exp[i].im);
     }
 
-    fftp(z);
+    s->fft(z, mb);
 
     for (int i = 0; i < len8; i++) {
         const int i0 = len8 + i, i1 = len8 - i - 1;
@@ -604,6 +609,7 @@ int TX_NAME(ff_tx_init_mdct_fft)(AVTXContext *s, av_tx_fn *tx,
     s->m = m;
     s->inv = inv;
     s->type = type;
+    s->fft = fft_ptwo;
 
     /* Filter out direct 3, 5 and 15 transforms, too niche */
     if (len > 1 || m == 1) {
@@ -631,9 +637,14 @@ int TX_NAME(ff_tx_init_mdct_fft)(AVTXContext *s, av_tx_fn *tx,
     if (n != 1)
         init_cos_tabs(0);
     if (m != 1) {
-        ff_tx_gen_ptwo_revtab(s);
+        if ((err = ff_tx_gen_ptwo_revtab(s)))
+            return err;
         for (int i = 4; i <= av_log2(m); i++)
             init_cos_tabs(i);
+#ifdef TX_FLOAT
+        if (ARCH_X86)
+            ff_tx_init_float_x86(s);
+#endif
     }
 
     if (is_mdct)
@@ -0,0 +1,179 @@
+;******************************************************************************
+;* AES-NI accelerated AES encryption and decryption
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+; The round keys are stored in the order used by the C code: round_key[rounds]
+; is added first and round_key[0] last. For decryption the middle keys have
+; already gone through InvMixColumns, which is what aesdec expects.
+
+; %1 = aes instruction suffix, %2 = number of blocks in m0-m3, %3 = round key
+%macro AES_ROUND 3
+    mova        m7, [ctxq + 16*%3]
+    aes%1       m0, m7
+%if %2 == 4
+    aes%1       m1, m7
+    aes%1       m2, m7
+    aes%1       m3, m7
+%endif
+%endmacro
+
+; %1 = enc or dec, %2 = number of blocks in m0-m3
+; expects roundsq to hold 2 * rounds
+%macro AES_BLOCKS 2
+    mova        m7, [ctxq + 8*roundsq]
+    pxor        m0, m7
+%if %2 == 4
+    pxor        m1, m7
+    pxor        m2, m7
+    pxor        m3, m7
+%endif
+    cmp     roundsd, 24
+    jl %%rounds10
+    je %%rounds12
+    AES_ROUND   %1, %2, 13
+    AES_ROUND   %1, %2, 12
+%%rounds12:
+    AES_ROUND   %1, %2, 11
+    AES_ROUND   %1, %2, 10
+%%rounds10:
+    AES_ROUND   %1, %2, 9
+    AES_ROUND   %1, %2, 8
+    AES_ROUND   %1, %2, 7
+    AES_ROUND   %1, %2, 6
+    AES_ROUND   %1, %2, 5
+    AES_ROUND   %1, %2, 4
+    AES_ROUND   %1, %2, 3
+    AES_ROUND   %1, %2, 2
+    AES_ROUND   %1, %2, 1
+    AES_ROUND   %{1}last, %2, 0
+%endmacro
+
+%macro LOAD4 0
+    movu        m0, [srcq]
+    movu        m1, [srcq + 16]
+    movu        m2, [srcq + 32]
+    movu        m3, [srcq + 48]
+%endmacro
+
+%macro STORE4 0
+    movu [dstq],      m0
+    movu [dstq + 16], m1
+    movu [dstq + 32], m2
+    movu [dstq + 48], m3
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_aes_{en,de}crypt_aesni(AVAES *a, uint8_t *dst, const uint8_t *src,
+;                                int count, uint8_t *iv, int rounds)
+;------------------------------------------------------------------------------
+; ECB and CBC decryption process four independent blocks per iteration to
+; hide the latency of the aes instructions, CBC encryption is serial.
+; %1 = encrypt or decrypt, %2 = enc or dec
+%macro AES_CRYPT 2
+cglobal aes_%1, 6, 6, 8, ctx, dst, src, count, iv, rounds
+    test    countd, countd
+    jle .end
+    add     roundsd, roundsd
+    test       ivq, ivq
+    jnz .cbc
+
+    sub     countd, 4
+    jl .ecb_tail
+.ecb_loop4:
+    LOAD4
+    AES_BLOCKS  %2, 4
+    STORE4
+    add       srcq, 64
+    add       dstq, 64
+    sub     countd, 4
+    jge .ecb_loop4
+.ecb_tail:
+    add     countd, 4
+    jz .end
+.ecb_loop1:
+    movu        m0, [srcq]
+    AES_BLOCKS  %2, 1
+    movu    [dstq], m0
+    add       srcq, 16
+    add       dstq, 16
+    dec     countd
+    jg .ecb_loop1
+.end:
+    RET
+
+.cbc:
+    movu        m4, [ivq]
+%ifidn %2, enc
+.cbc_loop1:
+    movu        m0, [srcq]
+    pxor        m0, m4
+    AES_BLOCKS  enc, 1
+    mova        m4, m0
+    movu    [dstq], m0
+    add       srcq, 16
+    add       dstq, 16
+    dec     countd
+    jg .cbc_loop1
+%else
+    sub     countd, 4
+    jl .cbc_tail
+.cbc_loop4:
+    LOAD4
+    AES_BLOCKS  dec, 4
+    ; src is still intact here even when decrypting in place
+    pxor        m0, m4
+    movu        m5, [srcq]
+    movu        m6, [srcq + 16]
+    pxor        m1, m5
+    pxor        m2, m6
+    movu        m5, [srcq + 32]
+    movu        m4, [srcq + 48]
+    pxor        m3, m5
+    STORE4
+    add       srcq, 64
+    add       dstq, 64
+    sub     countd, 4
+    jge .cbc_loop4
+.cbc_tail:
+    add     countd, 4
+    jz .cbc_end
+.cbc_loop1:
+    movu        m0, [srcq]
+    mova        m5, m0
+    AES_BLOCKS  dec, 1
+    pxor        m0, m4
+    mova        m4, m5
+    movu    [dstq], m0
+    add       srcq, 16
+    add       dstq, 16
+    dec     countd
+    jg .cbc_loop1
+.cbc_end:
+%endif
+    movu     [ivq], m4
+    RET
+%endmacro
+
+INIT_XMM aesni
+AES_CRYPT encrypt, enc
+AES_CRYPT decrypt, dec
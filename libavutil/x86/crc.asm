@@ -0,0 +1,169 @@
+;******************************************************************************
+;* CRC-32 using carry-less multiplication
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION_RODATA
+
+; The input is folded 4x128 bits at a time with the constants
+; x^(512+64) and x^512 mod P, then 128 bits at a time with x^(128+64) and
+; x^128 mod P, and the remaining 128 bits are reduced with a Barrett
+; reduction. The constants of the reflected variant are bit-reversed and
+; shifted by one.
+crc32_le_fold4:   dq 0x0000000154442bd4, 0x00000001c6e41596
+crc32_le_fold1:   dq 0x00000001751997d0, 0x00000000ccaa009e
+crc32_le_k5:      dq 0x0000000163cd6124, 0
+crc32_le_barrett: dq 0x00000001db710641, 0x00000001f7011641 ; P', mu'
+crc32_be_fold4:   dq 0x00000000e6228b11, 0x000000008833794c
+crc32_be_fold1:   dq 0x00000000e8a45605, 0x00000000c5b9cd4c
+crc32_be_k5k6:    dq 0x00000000f200aa66, 0x00000000490d678d ; x^96, x^64 mod P
+crc32_be_barrett: dq 0x0000000104d101df, 0x0000000104c11db7 ; mu, P
+crc32_mask_lo:    dd -1,  0,  0, 0
+crc32_mask_mid:   dd  0, -1, -1, 0
+pb_reverse:       db 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+
+SECTION .text
+
+; %1 = destination, %2 = source address
+%macro LOAD 2
+    movu            %1, %2
+%if BE
+    pshufb          %1, m7
+%endif
+%endmacro
+
+; %1 = accumulator, %2 = next block, m4 = fold constants
+%macro FOLD 2
+    mova            m5, %1
+    pclmulqdq       %1, m4, 0x00
+    pclmulqdq       m5, m4, 0x11
+    pxor            %1, m5
+    pxor            %1, %2
+%endmacro
+
+;------------------------------------------------------------------------------
+; uint32_t ff_crc32_{le,be}_clmul(uint32_t crc, const uint8_t *buf, size_t len)
+;------------------------------------------------------------------------------
+; len is a multiple of 16 and at least 64
+; %1 = le or be
+%macro CRC32 1
+%ifidn %1, be
+    %define BE 1
+%else
+    %define BE 0
+%endif
+cglobal crc32_%1, 3, 3, 8, crc, buf, len
+%if BE
+    mova            m7, [pb_reverse]
+%endif
+    movd            m4, crcd
+    movu            m0, [bufq]
+    pxor            m0, m4
+%if BE
+    pshufb          m0, m7
+%endif
+    LOAD            m1, [bufq + 16]
+    LOAD            m2, [bufq + 32]
+    LOAD            m3, [bufq + 48]
+    add           bufq, 64
+    sub           lenq, 64
+    cmp           lenq, 64
+    jb .fold1
+    mova            m4, [crc32_%1_fold4]
+.loop64:
+    LOAD            m6, [bufq]
+    FOLD            m0, m6
+    LOAD            m6, [bufq + 16]
+    FOLD            m1, m6
+    LOAD            m6, [bufq + 32]
+    FOLD            m2, m6
+    LOAD            m6, [bufq + 48]
+    FOLD            m3, m6
+    add           bufq, 64
+    sub           lenq, 64
+    cmp           lenq, 64
+    jae .loop64
+.fold1:
+    mova            m4, [crc32_%1_fold1]
+    FOLD            m0, m1
+    FOLD            m0, m2
+    FOLD            m0, m3
+    test          lenq, lenq
+    jz .reduce
+.loop16:
+    LOAD            m1, [bufq]
+    FOLD            m0, m1
+    add           bufq, 16
+    sub           lenq, 16
+    jnz .loop16
+.reduce:
+%if BE
+    ; 128 -> 96 bits: hi64 * (x^96 mod P) + lo64 * x^32
+    mova            m4, [crc32_be_k5k6]
+    mova            m5, m0
+    pclmulqdq       m5, m4, 0x01
+    pslldq          m0, 4
+    pand            m0, [crc32_mask_mid]
+    pxor            m0, m5
+    ; 96 -> 64 bits: hi32 * (x^64 mod P) + lo64
+    mova            m5, m0
+    psrldq          m5, 8
+    pclmulqdq       m5, m4, 0x10
+    movq            m0, m0
+    pxor            m0, m5
+    ; Barrett reduction to 32 bits
+    mova            m4, [crc32_be_barrett]
+    mova            m5, m0
+    psrlq           m5, 32
+    pclmulqdq       m5, m4, 0x00
+    psrlq           m5, 32
+    pclmulqdq       m5, m4, 0x10
+    pxor            m0, m5
+    movd           eax, m0
+    bswap          eax
+%else
+    ; 128 -> 64 bits
+    pclmulqdq       m4, m0, 0x01
+    psrldq          m0, 8
+    pxor            m0, m4
+    ; 64 -> 32 bits
+    mova            m5, m0
+    psrldq          m5, 4
+    pand            m0, [crc32_mask_lo]
+    pclmulqdq       m0, [crc32_le_k5], 0x00
+    pxor            m0, m5
+    ; Barrett reduction
+    mova            m4, [crc32_le_barrett]
+    mova            m5, m0
+    pand            m0, [crc32_mask_lo]
+    pclmulqdq       m0, m4, 0x10
+    pand            m0, [crc32_mask_lo]
+    pclmulqdq       m0, m4, 0x00
+    pxor            m0, m5
+    psrldq          m0, 4
+    movd           eax, m0
+%endif
+    RET
+%undef BE
+%endmacro
+
+INIT_XMM clmul
+CRC32 le
+CRC32 be
@@ -0,0 +1,86 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define TX_FLOAT
+#include "libavutil/tx_priv.h"
+#include "libavutil/attributes.h"
+#include "libavutil/x86/cpu.h"
+
+void ff_tx_fft_float_sse(FFTComplex *z, int nbits);
+void ff_tx_fft_float_avx(FFTComplex *z, int nbits);
+
+static const int avx_tab[] = {
+    0, 4, 1, 5, 8, 12, 9, 13, 2, 6, 3, 7, 10, 14, 11, 15
+};
+
+static int is_second_half_of_fft32(int i, int n)
+{
+    if (n <= 32)
+        return i >= 16;
+    else if (i < n/2)
+        return is_second_half_of_fft32(i, n/2);
+    else if (i < 3*n/4)
+        return is_second_half_of_fft32(i - n/2, n/4);
+    else
+        return is_second_half_of_fft32(i - 3*n/4, n/4);
+}
+
+/* The SSE codelets work on blocks of 2 complex values */
+static void gen_revtab_sse(AVTXContext *s)
+{
+    const int m = s->m, inv = s->inv;
+
+    for (int i = 0; i < m; i++) {
+        int j = (i & ~3) | ((i >> 1) & 1) | ((i << 1) & 2);
+        s->revtab[-split_radix_permutation(i, m, inv) & (m - 1)] = j;
+    }
+}
+
+/* The AVX codelets work on blocks of 4 complex values, except for the
+ * second half of each FFT32 */
+static void gen_revtab_avx(AVTXContext *s)
+{
+    const int m = s->m, inv = s->inv;
+
+    for (int i = 0; i < m; i += 16) {
+        const int second_half = is_second_half_of_fft32(i, m);
+        for (int k = 0; k < 16; k++) {
+            int j = i + k;
+            if (second_half)
+                j = i + avx_tab[k];
+            else
+                j = (j & ~7) | ((j >> 1) & 3) | ((j << 2) & 4);
+            s->revtab[-split_radix_permutation(i + k, m, inv) & (m - 1)] = j;
+        }
+    }
+}
+
+av_cold void ff_tx_init_float_x86(AVTXContext *s)
+{
+    int cpu_flags = av_get_cpu_flags();
+    const int nbits = av_log2(s->m);
+
+    if (EXTERNAL_SSE(cpu_flags)) {
+        s->fft = ff_tx_fft_float_sse;
+        gen_revtab_sse(s);
+    }
+    if (EXTERNAL_AVX_FAST(cpu_flags) && nbits >= 5) {
+        s->fft = ff_tx_fft_float_avx;
+        gen_revtab_avx(s);
+    }
+}
@@ -96,6 +96,7 @@ static int ff_resample_common_##TYPE##_neon(ResampleContext *c, void *dest, cons
 
 #define OUT(d, v) d = v
 DECLARE_RESAMPLE_COMMON_TEMPLATE(float, float, float, float, OUT)
+DECLARE_RESAMPLE_COMMON_TEMPLATE(double, double, double, double, OUT)
 #undef OUT
 
 #define OUT(d, v) (v) = ((v) + (1<<(14)))>>15; (d) = av_clip_int16(v)
@@ -113,6 +114,9 @@ av_cold void swri_resample_dsp_aarch64_init(ResampleContext *c)
     case AV_SAMPLE_FMT_FLTP:
         c->dsp.resample_common = ff_resample_common_float_neon;
         break;
+    case AV_SAMPLE_FMT_DBLP:
+        c->dsp.resample_common = ff_resample_common_double_neon;
+        break;
     case AV_SAMPLE_FMT_S16P:
         c->dsp.resample_common = ff_resample_common_s16_neon;
         break;
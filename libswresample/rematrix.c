@@ -481,6 +481,12 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->matrix_ch[i][0]= ch_in;
     }
 
+    if (s->int_sample_fmt == AV_SAMPLE_FMT_FLTP || s->int_sample_fmt == AV_SAMPLE_FMT_DBLP) {
+        s->fdsp = avpriv_float_dsp_alloc(0);
+        if (!s->fdsp)
+            return AVERROR(ENOMEM);
+    }
+
     if(HAVE_X86ASM && HAVE_MMX)
         return swri_rematrix_init_x86(s);
 
@@ -492,10 +498,90 @@ av_cold void swri_rematrix_free(SwrContext *s){
     av_freep(&s->native_one);
     av_freep(&s->native_simd_matrix);
     av_freep(&s->native_simd_one);
+    av_freep(&s->fdsp);
+}
+
+#define MIX_BLOCK_SIZE 1024
+
+/**
+ * Mix the output channels that have more than two non zero coefficients.
+ * The samples are processed in blocks, so that the inputs of a block stay
+ * in cache while all output channels are computed from them, and each
+ * output channel is accumulated one input at a time with float_dsp when
+ * all planes are suitably aligned.
+ */
+static void mix_many(SwrContext *s, AudioData *out, AudioData *in,
+                     const uint8_t *out_ch, int nb_out_ch, int len)
+{
+    int simd = !!s->fdsp;
+    int pos, k, i, j, in_i;
+
+    for (k = 0; k < nb_out_ch && simd; k++) {
+        const uint8_t *ch = s->matrix_ch[out_ch[k]];
+        simd = !((uintptr_t)out->ch[out_ch[k]] & 31);
+        for (j = 0; j < ch[0] && simd; j++)
+            simd = !((uintptr_t)in->ch[ch[1 + j]] & 31);
+    }
+
+    for (pos = 0; pos < len; pos += MIX_BLOCK_SIZE) {
+        const int block = FFMIN(MIX_BLOCK_SIZE, len - pos);
+        const int block1 = simd ? block & ~15 : 0;
+
+        for (k = 0; k < nb_out_ch; k++) {
+            const int out_i = out_ch[k];
+            const uint8_t *ch = s->matrix_ch[out_i];
+
+            if (s->int_sample_fmt == AV_SAMPLE_FMT_FLTP) {
+                float *dst = (float *)out->ch[out_i] + pos;
+#define SRC(j) ((const float *)in->ch[ch[1 + (j)]] + pos)
+                if (block1) {
+                    s->fdsp->vector_fmul_scalar(dst, SRC(0), s->matrix_flt[out_i][ch[1]], block1);
+                    for (j = 1; j < ch[0]; j++)
+                        s->fdsp->vector_fmac_scalar(dst, SRC(j), s->matrix_flt[out_i][ch[1 + j]], block1);
+                }
+#undef SRC
+                for (i = pos + block1; i < pos + block; i++) {
+                    float v = 0;
+                    for (j = 0; j < ch[0]; j++) {
+                        in_i = ch[1 + j];
+                        v += ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
+                    }
+                    ((float*)out->ch[out_i])[i] = v;
+                }
+            } else if (s->int_sample_fmt == AV_SAMPLE_FMT_DBLP) {
+                double *dst = (double *)out->ch[out_i] + pos;
+#define SRC(j) ((const double *)in->ch[ch[1 + (j)]] + pos)
+                if (block1) {
+                    s->fdsp->vector_dmul_scalar(dst, SRC(0), s->matrix[out_i][ch[1]], block1);
+                    for (j = 1; j < ch[0]; j++)
+                        s->fdsp->vector_dmac_scalar(dst, SRC(j), s->matrix[out_i][ch[1 + j]], block1);
+                }
+#undef SRC
+                for (i = pos + block1; i < pos + block; i++) {
+                    double v = 0;
+                    for (j = 0; j < ch[0]; j++) {
+                        in_i = ch[1 + j];
+                        v += ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
+                    }
+                    ((double*)out->ch[out_i])[i] = v;
+                }
+            } else {
+                for (i = pos; i < pos + block; i++) {
+                    int v = 0;
+                    for (j = 0; j < ch[0]; j++) {
+                        in_i = ch[1 + j];
+                        v += ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
+                    }
+                    ((int16_t*)out->ch[out_i])[i] = (v + 16384)>>15;
+                }
+            }
+        }
+    }
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
+    uint8_t many[SWR_CH_MAX];
+    int out_i, in_i, nb_many = 0;
     int len1 = 0;
     int off = 0;
 
@@ -542,35 +628,12 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
         default:
-            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
-            }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
-            }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
-            }
+            many[nb_many++] = out_i;
         }
     }
+
+    if (nb_many)
+        mix_many(s, out, in, many, nb_many, len);
+
     return 0;
 }
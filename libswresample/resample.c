@@ -27,6 +27,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/thread.h"
 #include "resample.h"
 
 static inline double eval_poly(const double *coeff, int size, double x) {
@@ -276,17 +277,138 @@ fail:
     return ret;
 }
 
+/**
+ * Filter banks in use, shared between the resamplers with the same filter
+ * parameters, as building large ones is slow. An entry is dropped when the
+ * cache holds the last reference to it.
+ */
+typedef struct FilterBankEntry {
+    enum AVSampleFormat format;
+    double factor;
+    int filter_length;
+    int filter_alloc;
+    int phase_count;
+    enum SwrFilterType filter_type;
+    double kaiser_beta;
+    AVBufferRef *buf;
+    struct FilterBankEntry *next;
+} FilterBankEntry;
+
+static AVMutex filter_banks_mutex = AV_MUTEX_INITIALIZER;
+static FilterBankEntry *filter_banks;
+
+static int get_filter_bank(ResampleContext *c, int phase_count, AVBufferRef **pbuf)
+{
+    FilterBankEntry *e;
+    AVBufferRef *buf;
+    uint8_t *bank;
+    int ret = 0;
+
+    ff_mutex_lock(&filter_banks_mutex);
+    for (e = filter_banks; e; e = e->next) {
+        if (e->format        == c->format        && e->factor      == c->factor      &&
+            e->filter_length == c->filter_length && e->filter_alloc == c->filter_alloc &&
+            e->phase_count   == phase_count      && e->filter_type  == c->filter_type  &&
+            e->kaiser_beta   == c->kaiser_beta) {
+            if (!(*pbuf = av_buffer_ref(e->buf)))
+                ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    e   = av_mallocz(sizeof(*e));
+    buf = av_buffer_allocz(c->filter_alloc * (phase_count + 1) * c->felem_size);
+    if (!e || !buf) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    bank = buf->data;
+    ret  = build_filter(c, bank, c->factor, c->filter_length, c->filter_alloc,
+                        phase_count, 1 << c->filter_shift, c->filter_type, c->kaiser_beta);
+    if (ret < 0)
+        goto fail;
+    memcpy(bank + (c->filter_alloc*phase_count+1)*c->felem_size, bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(bank + (c->filter_alloc*phase_count  )*c->felem_size, bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+
+    if (!(e->buf = av_buffer_ref(buf))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    e->format        = c->format;
+    e->factor        = c->factor;
+    e->filter_length = c->filter_length;
+    e->filter_alloc  = c->filter_alloc;
+    e->phase_count   = phase_count;
+    e->filter_type   = c->filter_type;
+    e->kaiser_beta   = c->kaiser_beta;
+    e->next          = filter_banks;
+    filter_banks     = e;
+    *pbuf            = buf;
+    goto end;
+
+fail:
+    av_buffer_unref(&buf);
+    av_free(e);
+end:
+    ff_mutex_unlock(&filter_banks_mutex);
+    return ret;
+}
+
+static void release_filter_bank(AVBufferRef **pbuf)
+{
+    FilterBankEntry **pe;
+
+    if (!*pbuf)
+        return;
+
+    ff_mutex_lock(&filter_banks_mutex);
+    for (pe = &filter_banks; *pe; pe = &(*pe)->next)
+        if ((*pe)->buf->data == (*pbuf)->data)
+            break;
+    av_buffer_unref(pbuf);
+    if (*pe && av_buffer_get_ref_count((*pe)->buf) == 1) {
+        FilterBankEntry *e = *pe;
+        *pe = e->next;
+        av_buffer_unref(&e->buf);
+        av_free(e);
+    }
+    ff_mutex_unlock(&filter_banks_mutex);
+}
+
 static void resample_free(ResampleContext **cc){
     ResampleContext *c = *cc;
     if(!c)
         return;
-    av_freep(&c->filter_bank);
+    release_filter_bank(&c->filter_bank_buf);
+    avpriv_slicethread_free(&c->slicethread);
     av_freep(cc);
 }
 
+static void resample_channels(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ResampleContext *c = priv;
+    const int ch_count = c->job.dst->ch_count;
+    const int start = (ch_count *  jobnr     ) / nb_jobs;
+    const int end   = (ch_count * (jobnr + 1)) / nb_jobs;
+
+    for (int i = start; i < end; i++) {
+        if (i + 1 == ch_count) {
+            /* the other channels must not see the updated position */
+            ResampleContext last = *c;
+
+            c->job.consumed = c->job.func(&last, c->job.dst->ch[i], c->job.src->ch[i],
+                                          c->job.size, 1);
+            c->job.index    = last.index;
+            c->job.frac     = last.frac;
+        } else {
+            c->job.func(c, c->job.dst->ch[i], c->job.src->ch[i], c->job.size, 0);
+        }
+    }
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta,
-                                    double precision, int cheby, int exact_rational)
+                                    double precision, int cheby, int exact_rational, int nb_threads)
 {
     double cutoff = cutoff0? cutoff0 : 0.97;
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -345,16 +467,12 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->factor        = factor;
         c->filter_length = filter_length;
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
         c->phase_count_compensation = phase_count_compensation;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
+        if (get_filter_bank(c, phase_count, &c->filter_bank_buf) < 0)
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+        c->filter_bank   = c->filter_bank_buf->data;
     }
 
     c->compensation_distance= 0;
@@ -371,18 +489,31 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
     c->index= -phase_count*((c->filter_length-1)/2);
     c->frac= 0;
 
+    if (!c->thread_count || c->nb_threads != nb_threads) {
+        avpriv_slicethread_free(&c->slicethread);
+        c->nb_threads   = nb_threads;
+        c->thread_count = 1;
+        if (nb_threads != 1) {
+            int ret = avpriv_slicethread_create(&c->slicethread, c, resample_channels,
+                                                NULL, nb_threads);
+            if (ret > 1)
+                c->thread_count = ret;
+            else
+                avpriv_slicethread_free(&c->slicethread);
+        }
+    }
+
     swri_resample_dsp_init(c);
 
     return c;
 error:
-    av_freep(&c->filter_bank);
-    av_free(c);
+    resample_free(&c);
     return NULL;
 }
 
 static int rebuild_filter_bank_with_compensation(ResampleContext *c)
 {
-    uint8_t *new_filter_bank;
+    AVBufferRef *new_filter_bank = NULL;
     int new_src_incr, new_dst_incr;
     int phase_count = c->phase_count_compensation;
     int ret;
@@ -392,23 +523,14 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
 
     av_assert0(!c->frac && !c->dst_incr_mod);
 
-    new_filter_bank = av_calloc(c->filter_alloc, (phase_count + 1) * c->felem_size);
-    if (!new_filter_bank)
-        return AVERROR(ENOMEM);
-
-    ret = build_filter(c, new_filter_bank, c->factor, c->filter_length, c->filter_alloc,
-                       phase_count, 1 << c->filter_shift, c->filter_type, c->kaiser_beta);
-    if (ret < 0) {
-        av_freep(&new_filter_bank);
+    ret = get_filter_bank(c, phase_count, &new_filter_bank);
+    if (ret < 0)
         return ret;
-    }
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_alloc-1)*c->felem_size);
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, new_filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
 
     if (!av_reduce(&new_src_incr, &new_dst_incr, c->src_incr,
                    c->dst_incr * (int64_t)(phase_count/c->phase_count), INT32_MAX/2))
     {
-        av_freep(&new_filter_bank);
+        release_filter_bank(&new_filter_bank);
         return AVERROR(EINVAL);
     }
 
@@ -423,8 +545,9 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
     c->dst_incr_mod   = c->dst_incr % c->src_incr;
     c->index         *= phase_count / c->phase_count;
     c->phase_count    = phase_count;
-    av_freep(&c->filter_bank);
-    c->filter_bank = new_filter_bank;
+    release_filter_bank(&c->filter_bank_buf);
+    c->filter_bank_buf = new_filter_bank;
+    c->filter_bank     = new_filter_bank->data;
     return 0;
 }
 
@@ -494,8 +617,20 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (c->slicethread && dst->ch_count > 1 && !need_emms) {
+                c->job.func = resample_func;
+                c->job.dst  = dst;
+                c->job.src  = src;
+                c->job.size = dst_size;
+                avpriv_slicethread_execute(c->slicethread,
+                                           FFMIN(dst->ch_count, c->thread_count), 0);
+                c->index  = c->job.index;
+                c->frac   = c->job.frac;
+                *consumed = c->job.consumed;
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
@@ -22,14 +22,17 @@
 #ifndef SWRESAMPLE_RESAMPLE_H
 #define SWRESAMPLE_RESAMPLE_H
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/slicethread.h"
 
 #include "swresample_internal.h"
 
 typedef struct ResampleContext {
     const AVClass *av_class;
     uint8_t *filter_bank;
+    AVBufferRef *filter_bank_buf;      /* shared with identical resamplers */
     int filter_length;
     int filter_alloc;
     int ideal_dst_incr;
@@ -58,6 +61,19 @@ typedef struct ResampleContext {
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
     } dsp;
+
+    int nb_threads;                    /* requested number of threads */
+    int thread_count;                  /* number of threads of slicethread */
+    AVSliceThread *slicethread;
+
+    /* state of the channels resampled by the threads */
+    struct {
+        int (*func)(struct ResampleContext *c, void *dst,
+                    const void *src, int n, int update_ctx);
+        AudioData *dst, *src;
+        int size;
+        int consumed, index, frac;
+    } job;
 } ResampleContext;
 
 void swri_resample_dsp_init(ResampleContext *c);
@@ -0,0 +1,136 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/aarch64/cpu.h"
+#include "libavutil/cpu.h"
+#include "libswscale/rgb2rgb.h"
+
+void ff_interleave_bytes_row_neon(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, int width);
+void ff_deinterleave_bytes_row_neon(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, int width);
+void ff_interleave_words_row_neon(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, int width, int shift);
+void ff_deinterleave_words_row_neon(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, int width, int shift);
+
+static void interleave_bytes_neon(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, int width, int height,
+                                  int src1Stride, int src2Stride, int dstStride)
+{
+    const int simd = width & ~15;
+    int w, h;
+
+    for (h = 0; h < height; h++) {
+        if (simd)
+            ff_interleave_bytes_row_neon(src1, src2, dst, simd);
+        for (w = simd; w < width; w++) {
+            dst[2 * w + 0] = src1[w];
+            dst[2 * w + 1] = src2[w];
+        }
+        src1 += src1Stride;
+        src2 += src2Stride;
+        dst  += dstStride;
+    }
+}
+
+static void deinterleave_bytes_neon(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, int width, int height,
+                                    int srcStride, int dst1Stride, int dst2Stride)
+{
+    const int simd = width & ~15;
+    int w, h;
+
+    for (h = 0; h < height; h++) {
+        if (simd)
+            ff_deinterleave_bytes_row_neon(src, dst1, dst2, simd);
+        for (w = simd; w < width; w++) {
+            dst1[w] = src[2 * w + 0];
+            dst2[w] = src[2 * w + 1];
+        }
+        src  += srcStride;
+        dst1 += dst1Stride;
+        dst2 += dst2Stride;
+    }
+}
+
+static void interleave_words_neon(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, int width, int height,
+                                  int src1Stride, int src2Stride, int dstStride,
+                                  int shift)
+{
+    const int simd = width & ~7;
+    int w, h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s1 = (const uint16_t *)src1;
+        const uint16_t *s2 = (const uint16_t *)src2;
+        uint16_t *d = (uint16_t *)dst;
+
+        if (simd)
+            ff_interleave_words_row_neon(src1, src2, dst, simd, shift);
+        for (w = simd; w < width; w++) {
+            d[2 * w + 0] = s1[w] << shift;
+            d[2 * w + 1] = s2[w] << shift;
+        }
+        src1 += src1Stride;
+        src2 += src2Stride;
+        dst  += dstStride;
+    }
+}
+
+static void deinterleave_words_neon(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, int width, int height,
+                                    int srcStride, int dst1Stride, int dst2Stride,
+                                    int shift)
+{
+    const int simd = width & ~7;
+    int w, h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d1 = (uint16_t *)dst1;
+        uint16_t *d2 = (uint16_t *)dst2;
+
+        if (simd)
+            ff_deinterleave_words_row_neon(src, dst1, dst2, simd, shift);
+        for (w = simd; w < width; w++) {
+            d1[w] = s[2 * w + 0] >> shift;
+            d2[w] = s[2 * w + 1] >> shift;
+        }
+        src  += srcStride;
+        dst1 += dst1Stride;
+        dst2 += dst2Stride;
+    }
+}
+
+av_cold void rgb2rgb_init_aarch64(void)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (have_neon(cpu_flags)) {
+        interleaveBytes   = interleave_bytes_neon;
+        deinterleaveBytes = deinterleave_bytes_neon;
+        interleaveWords   = interleave_words_neon;
+        deinterleaveWords = deinterleave_words_neon;
+    }
+}
@@ -25,9 +25,58 @@ void ff_hscale_8_to_15_neon(SwsContext *c, int16_t *dst, int dstW,
                             const uint8_t *src, const int16_t *filter,
                             const int32_t *filterPos, int filterSize);
 
-void ff_yuv2planeX_8_neon(const int16_t *filter, int filterSize,
-                          const int16_t **src, uint8_t *dest, int dstW,
-                          const uint8_t *dither, int offset);
+#define SCALE_FUNC(size, opt) \
+void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
+                                        const int16_t **src, uint8_t *dest, int dstW, \
+                                        const uint8_t *dither, int offset); \
+void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dest, int dstW, \
+                                        const uint8_t *dither, int offset)
+
+SCALE_FUNC(8,  neon);
+SCALE_FUNC(9,  neon);
+SCALE_FUNC(10, neon);
+SCALE_FUNC(16, neon);
+
+#define INPUT_FUNCS(fmt, opt) \
+void ff_ ## fmt ## ToY_  ## opt(uint8_t *dst, const uint8_t *src, \
+                                const uint8_t *unused1, const uint8_t *unused2, \
+                                int w, uint32_t *rgb2yuv); \
+void ff_ ## fmt ## ToUV_ ## opt(uint8_t *dstU, uint8_t *dstV, \
+                                const uint8_t *unused0, const uint8_t *src1, \
+                                const uint8_t *src2, int w, uint32_t *rgb2yuv)
+
+INPUT_FUNCS(rgb24, neon);
+INPUT_FUNCS(bgr24, neon);
+INPUT_FUNCS(rgba,  neon);
+INPUT_FUNCS(bgra,  neon);
+INPUT_FUNCS(argb,  neon);
+INPUT_FUNCS(abgr,  neon);
+
+#define ASSIGN_VSCALE_FUNCS(opt) \
+    switch (c->dstBpc) { \
+    case 16: if (is16BPS(c->dstFormat) && !isBE(c->dstFormat)) { \
+                 c->yuv2planeX = ff_yuv2planeX_16_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_16_ ## opt; \
+             } break; \
+    case 10: if (!isBE(c->dstFormat) && c->dstFormat != AV_PIX_FMT_P010LE) { \
+                 c->yuv2planeX = ff_yuv2planeX_10_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_10_ ## opt; \
+             } break; \
+    case 9:  if (!isBE(c->dstFormat)) { \
+                 c->yuv2planeX = ff_yuv2planeX_9_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_9_ ## opt; \
+             } break; \
+    case 8:  c->yuv2planeX = ff_yuv2planeX_8_ ## opt; \
+             c->yuv2plane1 = ff_yuv2plane1_8_ ## opt; \
+             break; \
+    }
+
+#define case_rgb(x, X, opt) \
+        case AV_PIX_FMT_ ## X: \
+            c->lumToYV12 = ff_ ## x ## ToY_ ## opt; \
+            if (!c->chrSrcHSubSample) \
+                c->chrToYV12 = ff_ ## x ## ToUV_ ## opt; \
+            break
 
 av_cold void ff_sws_init_swscale_aarch64(SwsContext *c)
 {
@@ -37,8 +86,16 @@ av_cold void ff_sws_init_swscale_aarch64(SwsContext *c)
         if (c->srcBpc == 8 && c->dstBpc <= 14) {
             c->hyScale = c->hcScale = ff_hscale_8_to_15_neon;
         }
-        if (c->dstBpc == 8) {
-            c->yuv2planeX = ff_yuv2planeX_8_neon;
+        ASSIGN_VSCALE_FUNCS(neon);
+        switch (c->srcFormat) {
+        case_rgb(rgb24, RGB24, neon);
+        case_rgb(bgr24, BGR24, neon);
+        case_rgb(rgba,  RGBA,  neon);
+        case_rgb(bgra,  BGRA,  neon);
+        case_rgb(argb,  ARGB,  neon);
+        case_rgb(abgr,  ABGR,  neon);
+        default:
+            break;
         }
     }
 }
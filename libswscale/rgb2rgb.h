@@ -142,6 +142,23 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * Interleave two planes of native endian 16-bit samples, shifting the samples
+ * left by shift bits. Width is in samples, strides are in bytes.
+ */
+extern void (*interleaveWords)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                               int width, int height, int src1Stride,
+                               int src2Stride, int dstStride, int shift);
+
+/**
+ * Deinterleave a plane of native endian 16-bit samples, shifting the samples
+ * right by shift bits. Width is in samples per output plane, strides are in
+ * bytes.
+ */
+extern void (*deinterleaveWords)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride, int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -169,6 +186,7 @@ extern void (*yuyvtoyuv422)(uint8_t *ydst, uint8_t *udst, uint8_t *vdst, const u
 
 void ff_sws_rgb2rgb_init(void);
 
+void rgb2rgb_init_aarch64(void);
 void rgb2rgb_init_x86(void);
 
 #endif /* SWSCALE_RGB2RGB_H */
@@ -234,14 +234,16 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+static int swscale_slice(SwsContext *c, const uint8_t *src[],
+                         int srcStride[], int srcSliceY,
+                         int srcSliceH, uint8_t *dst[], int dstStride[],
+                         int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
     const int dstW                   = c->dstW;
     const int dstH                   = c->dstH;
+    const int dstSliceEnd            = dstSliceY + dstSliceH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -338,7 +340,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -355,8 +357,8 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             srcSliceY, srcSliceH, chrSrcSliceY, chrSrcSliceH, 1);
 
     ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
-            dstY, dstH, dstY >> c->chrDstVSubSample,
-            AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
+            dstY, dstSliceH, dstY >> c->chrDstVSubSample,
+            AV_CEIL_RSHIFT(dstSliceH, c->chrDstVSubSample), 0);
     if (srcSliceY == 0) {
         hout_slice->plane[0].sliceY = lastInLumBuf + 1;
         hout_slice->plane[1].sliceY = lastInChrBuf + 1;
@@ -370,7 +372,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -532,6 +534,69 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_slice(c, src, srcStride, srcSliceY, srcSliceH,
+                         dst, dstStride, 0, c->dstH);
+}
+
+int ff_sws_slice_threads_supported(SwsContext *c)
+{
+    /* Error diffusion carries state from one line to the next and the
+     * XYZ output conversion works on the lines returned by the last call. */
+    return c->swscale == swscale && !c->cascaded_context[0] &&
+           c->dither != SWS_DITHER_ED && !c->dstXYZ;
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext      *c = parent->slice_ctx[threadnr];
+    const int slice_h  = FFALIGN((c->dstH + nb_jobs - 1) / nb_jobs,
+                                 1 << c->chrDstVSubSample);
+    const int slice_y  = jobnr * slice_h;
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    if (slice_y >= c->dstH)
+        return;
+
+    /* swscale_slice() modifies the pointer and stride arrays it is given */
+    memcpy(src,       parent->slice_src,        sizeof(src));
+    memcpy(srcStride, parent->slice_src_stride, sizeof(srcStride));
+    memcpy(dst,       parent->slice_dst,        sizeof(dst));
+    memcpy(dstStride, parent->slice_dst_stride, sizeof(dstStride));
+
+    swscale_slice(c, src, srcStride, 0, c->srcH, dst, dstStride,
+                  slice_y, FFMIN(slice_h, c->dstH - slice_y));
+}
+
+static int scale_threaded(SwsContext *c, const uint8_t *src[], int srcStride[],
+                          uint8_t *dst[], int dstStride[])
+{
+    int i;
+
+    if (usePal(c->srcFormat)) {
+        for (i = 0; i < c->nb_slice_ctx; i++) {
+            memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+            memcpy(c->slice_ctx[i]->pal_rgb, c->pal_rgb, sizeof(c->pal_rgb));
+        }
+    }
+
+    memcpy(c->slice_src,        src,       sizeof(c->slice_src));
+    memcpy(c->slice_src_stride, srcStride, sizeof(c->slice_src_stride));
+    memcpy(c->slice_dst,        dst,       sizeof(c->slice_dst));
+    memcpy(c->slice_dst_stride, dstStride, sizeof(c->slice_dst_stride));
+
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+
+    return c->dstH;
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -975,7 +1040,10 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (c->slicethread && !srcSliceY_internal && srcSliceH == c->srcH)
+        ret = scale_threaded(c, src2, srcStride2, dst2, dstStride2);
+    else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
         int dstY = c->dstY ? c->dstY : srcSliceY + srcSliceH;
@@ -26,11 +26,13 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/ppc/util_altivec.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
@@ -321,6 +323,16 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    int nb_threads;               ///< Number of threads used for scaling whole frames.
+    struct SwsContext **slice_ctx; ///< Per-thread contexts, each scaling a band of destination lines.
+    int nb_slice_ctx;
+    AVSliceThread *slicethread;
+    /* per-frame parameters of sliced scaling */
+    const uint8_t *slice_src[4];
+    int slice_src_stride[4];
+    uint8_t *slice_dst[4];
+    int slice_dst_stride[4];
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -383,6 +395,7 @@ typedef struct SwsContext {
     int hChrFilterSize;           ///< Horizontal filter size for chroma     pixels.
     int vLumFilterSize;           ///< Vertical   filter size for luma/alpha pixels.
     int vChrFilterSize;           ///< Vertical   filter size for chroma     pixels.
+    AVBufferRef *filter_buf[4];   ///< Shared filter cache buffers holding the h/v luma and chroma filters, if any.
     //@}
 
     int lumMmxextFilterCodeSize;  ///< Runtime-generated MMXEXT horizontal fast bilinear scaler code size for luma/alpha planes.
@@ -858,6 +871,15 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Check whether whole frames scaled with c may be split into bands of
+ * destination lines processed concurrently.
+ */
+int ff_sws_slice_threads_supported(SwsContext *c);
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
@@ -230,7 +230,7 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
     const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
     const uint16_t **src = (const uint16_t**)src8;
     uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
-    uint16_t *dstUV = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+    uint8_t *dstUV = dstParam8[1] + dstStride[1] * srcSliceY / 2;
     int x, y;
 
     /* Calculate net shift required for values. */
@@ -246,6 +246,8 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
     av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 || srcStride[2] % 2 ||
                  dstStride[0] % 2 || dstStride[1] % 2));
 
+    av_assert1(shift[1] == shift[2]);
+
     for (y = 0; y < srcSliceH; y++) {
         uint16_t *tdstY = dstY;
         const uint16_t *tsrc0 = src[0];
@@ -254,21 +256,51 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
         }
         src[0] += srcStride[0] / 2;
         dstY += dstStride[0] / 2;
+    }
 
-        if (!(y & 1)) {
-            uint16_t *tdstUV = dstUV;
-            const uint16_t *tsrc1 = src[1];
-            const uint16_t *tsrc2 = src[2];
-            for (x = c->srcW / 2; x > 0; x--) {
-                *tdstUV++ = *tsrc1++ << shift[1];
-                *tdstUV++ = *tsrc2++ << shift[2];
-            }
-            src[1] += srcStride[1] / 2;
-            src[2] += srcStride[2] / 2;
-            dstUV += dstStride[1] / 2;
+    interleaveWords(src8[1], src8[2], dstUV, c->srcW / 2, (srcSliceH + 1) / 2,
+                    srcStride[1], srcStride[2], dstStride[1], shift[1]);
+
+    return srcSliceH;
+}
+
+static int p01xToPlanarWrapper(SwsContext *c, const uint8_t *src8[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam8[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
+    const uint16_t *srcY = (const uint16_t*)src8[0];
+    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
+    uint8_t *dstU = dstParam8[1] + dstStride[1] * srcSliceY / 2;
+    uint8_t *dstV = dstParam8[2] + dstStride[2] * srcSliceY / 2;
+    int x, y;
+
+    /* Calculate net shift required for values. */
+    const int shift[2] = {
+        src_format->comp[0].depth + src_format->comp[0].shift -
+        dst_format->comp[0].depth - dst_format->comp[0].shift,
+        src_format->comp[1].depth + src_format->comp[1].shift -
+        dst_format->comp[1].depth - dst_format->comp[1].shift,
+    };
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 ||
+                 dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    for (y = 0; y < srcSliceH; y++) {
+        uint16_t *tdstY = dstY;
+        const uint16_t *tsrc0 = srcY;
+        for (x = c->srcW; x > 0; x--) {
+            *tdstY++ = *tsrc0++ >> shift[0];
         }
+        srcY += srcStride[0] / 2;
+        dstY += dstStride[0] / 2;
     }
 
+    deinterleaveWords(src8[1], dstU, dstV, c->chrSrcW, (srcSliceH + 1) / 2,
+                      srcStride[1], dstStride[1], dstStride[2], shift[1]);
+
     return srcSliceH;
 }
 
@@ -1942,6 +1974,11 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
         c->swscale = planarToP01xWrapper;
     }
+    /* p01x_to_yuv420p1x, only where no bits are dropped */
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16)) {
+        c->swscale = p01xToPlanarWrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
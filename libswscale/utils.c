@@ -49,6 +49,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavutil/ppc/cpu.h"
 #include "libavutil/x86/asm.h"
@@ -725,6 +726,141 @@ fail:
     return ret;
 }
 
+/* Filters computed without user vectors only depend on these parameters,
+ * so they are kept in a small process-wide cache and shared between
+ * contexts. */
+typedef struct FilterCacheKey {
+    double param[2];
+    int xInc, srcW, dstW, filterAlign, one;
+    int flags, cpu_flags, srcPos, dstPos;
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    AVBufferRef *buf;       ///< filter positions followed by the coefficients
+    int filter_size;
+    int filter_offset;
+    unsigned last_use;
+} FilterCacheEntry;
+
+#define FILTER_CACHE_SIZE 32
+
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry filter_cache[FILTER_CACHE_SIZE];
+static unsigned filter_cache_clock;
+
+/**
+ * Same as initFilter(), but the result is taken from or added to the
+ * filter cache when there are no user filter vectors. In that case *buf
+ * holds the arrays, which must not be freed directly.
+ */
+static av_cold int initFilterCached(AVBufferRef **buf, int16_t **outFilter,
+                                    int32_t **filterPos, int *outFilterSize,
+                                    int xInc, int srcW, int dstW,
+                                    int filterAlign, int one,
+                                    int flags, int cpu_flags,
+                                    SwsVector *srcFilter, SwsVector *dstFilter,
+                                    double param[2], int srcPos, int dstPos)
+{
+    FilterCacheKey key;
+    FilterCacheEntry *e, *lru = NULL;
+    AVBufferRef *ref;
+    int pos_size, filter_size;
+    int i, ret;
+
+    if (srcFilter || dstFilter)
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW,
+                          dstW, filterAlign, one, flags, cpu_flags,
+                          srcFilter, dstFilter, param, srcPos, dstPos);
+
+    /* compared with memcmp(), so clear the padding */
+    memset(&key, 0, sizeof(key));
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (i = 0; i < FILTER_CACHE_SIZE; i++) {
+        e = &filter_cache[i];
+        if (e->buf && !memcmp(&e->key, &key, sizeof(key))) {
+            ref = av_buffer_ref(e->buf);
+            if (!ref)
+                break;
+            e->last_use    = ++filter_cache_clock;
+            *buf           = ref;
+            *filterPos     = (int32_t *)ref->data;
+            *outFilter     = (int16_t *)(ref->data + e->filter_offset);
+            *outFilterSize = e->filter_size;
+            ff_mutex_unlock(&filter_cache_mutex);
+            return 0;
+        }
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, NULL, NULL,
+                     param, srcPos, dstPos);
+    if (ret < 0)
+        return ret;
+
+    /* same sizes and alignment as the arrays allocated by initFilter() */
+    pos_size    = FFALIGN((dstW + 3) * sizeof(**filterPos), 64);
+    filter_size = (dstW + 3) * *outFilterSize * sizeof(**outFilter);
+    ref = av_buffer_alloc(pos_size + filter_size);
+    if (!ref)
+        return 0;
+    memcpy(ref->data,            *filterPos, (dstW + 3) * sizeof(**filterPos));
+    memcpy(ref->data + pos_size, *outFilter, filter_size);
+    av_freep(filterPos);
+    av_freep(outFilter);
+    *buf       = ref;
+    *filterPos = (int32_t *)ref->data;
+    *outFilter = (int16_t *)(ref->data + pos_size);
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (i = 0; i < FILTER_CACHE_SIZE; i++) {
+        e = &filter_cache[i];
+        if (e->buf && !memcmp(&e->key, &key, sizeof(key))) {
+            lru = NULL; // added by another thread meanwhile
+            break;
+        }
+        if (!lru || e->last_use < lru->last_use)
+            lru = e;
+    }
+    if (lru) {
+        av_buffer_unref(&lru->buf);
+        lru->buf           = av_buffer_ref(ref);
+        lru->key           = key;
+        lru->filter_size   = *outFilterSize;
+        lru->filter_offset = pos_size;
+        lru->last_use      = ++filter_cache_clock;
+    }
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    return 0;
+}
+
+static av_cold void freeFilter(AVBufferRef **buf, int16_t **filter,
+                               int32_t **filterPos)
+{
+    if (*buf) {
+        av_buffer_unref(buf);
+        *filter    = NULL;
+        *filterPos = NULL;
+    } else {
+        av_freep(filter);
+        av_freep(filterPos);
+    }
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -862,6 +998,15 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        int ret = sws_setColorspaceDetails(c->slice_ctx[i], inv_table,
+                                           srcRange, table, dstRange,
+                                           brightness, contrast, saturation);
+        if (ret < 0)
+            return ret;
+    }
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1162,8 +1307,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int context_init_single(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1673,7 +1818,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     PPC_ALTIVEC(cpu_flags) ? 8 :
                                     have_neon(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilterCached(&c->filter_buf[0], &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1682,7 +1827,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, 0, 0, 0),
                            get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilterCached(&c->filter_buf[1], &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1700,7 +1845,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilterCached(&c->filter_buf[2], &c->vLumFilter,
+                       &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1708,7 +1854,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilterCached(&c->filter_buf[3], &c->vChrFilter,
+                       &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1863,6 +2010,71 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+static av_cold int context_init_threaded(SwsContext *c, SwsContext *opts,
+                                         SwsFilter *srcFilter, SwsFilter *dstFilter)
+{
+    int i, ret;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, ff_sws_slice_worker,
+                                    NULL, c->nb_threads);
+    if (ret == AVERROR(ENOSYS)) {
+        c->nb_threads = 1;
+        return 0;
+    } else if (ret < 0)
+        return ret;
+
+    c->nb_threads = ret;
+    if (c->nb_threads <= 1) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz_array(c->nb_threads, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < c->nb_threads; i++) {
+        SwsContext *slice = c->slice_ctx[i] = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->nb_slice_ctx++;
+
+        ret = av_opt_copy(slice, opts);
+        if (ret < 0)
+            return ret;
+        slice->nb_threads = 1;
+
+        ret = context_init_single(slice, srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    SwsContext *opts;
+    int ret;
+
+    if (c->nb_threads == 1)
+        return context_init_single(c, srcFilter, dstFilter);
+
+    /* context_init_single() rewrites some of the options, the per-thread
+     * contexts must start from the values set by the caller. */
+    opts = sws_alloc_context();
+    if (!opts)
+        return AVERROR(ENOMEM);
+    ret = av_opt_copy(opts, c);
+    if (ret >= 0)
+        ret = context_init_single(c, srcFilter, dstFilter);
+    if (ret >= 0 && ff_sws_slice_threads_supported(c))
+        ret = context_init_threaded(c, opts, srcFilter, dstFilter);
+    sws_freeContext(opts);
+    return ret;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2314,23 +2526,23 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
-    av_freep(&c->vLumFilter);
-    av_freep(&c->vChrFilter);
-    av_freep(&c->hLumFilter);
-    av_freep(&c->hChrFilter);
+    freeFilter(&c->filter_buf[0], &c->hLumFilter, &c->hLumFilterPos);
+    freeFilter(&c->filter_buf[1], &c->hChrFilter, &c->hChrFilterPos);
+    freeFilter(&c->filter_buf[2], &c->vLumFilter, &c->vLumFilterPos);
+    freeFilter(&c->filter_buf[3], &c->vChrFilter, &c->vChrFilterPos);
 #if HAVE_ALTIVEC
     av_freep(&c->vYCoeffsBank);
     av_freep(&c->vCCoeffsBank);
 #endif
 
-    av_freep(&c->vLumFilterPos);
-    av_freep(&c->vChrFilterPos);
-    av_freep(&c->hLumFilterPos);
-    av_freep(&c->hChrFilterPos);
-
 #if HAVE_MMX_INLINE
 #if USE_MMAP
     if (c->lumMmxextFilterCode)
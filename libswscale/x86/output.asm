@@ -22,14 +22,14 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
+yuv2yuvX_10_start:  times 8 dd 0x10000
+yuv2yuvX_9_start:   times 8 dd 0x20000
+yuv2yuvX_10_upper:  times 16 dw 0x3ff
+yuv2yuvX_9_upper:   times 16 dw 0x1ff
 minshort:      times 8 dw 0x8000
 yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
-yuv2yuvX_10_start:  times 4 dd 0x10000
-yuv2yuvX_9_start:   times 4 dd 0x20000
-yuv2yuvX_10_upper:  times 8 dw 0x3ff
-yuv2yuvX_9_upper:   times 8 dw 0x1ff
 pd_4:          times 4 dd 4
 pd_4min0x40000:times 4 dd 4 - (0x40000)
 pw_16:         times 8 dw 16
@@ -61,8 +61,8 @@ SECTION .text
     ; 8 pixels but we can only handle 2 pixels per register, and thus 4
     ; pixels per iteration. In order to not have to keep track of where
     ; we are w.r.t. dithering, we unroll the MMX/8-bit loop x2.
-%if %1 == 8
-%assign %%repcnt 16/mmsize
+%if %1 == 8 && mmsize == 8
+%assign %%repcnt 2
 %else
 %assign %%repcnt 1
 %endif
@@ -88,6 +88,8 @@ SECTION .text
 %if %1 == 16
     mova            m3, [r6+r5*4]
     mova            m5, [r6+r5*4+mmsize]
+%elif mmsize == 32 ; %1 == 8/9/10, lines are only 16-byte aligned
+    movu            m3, [r6+r5*2]
 %else ; %1 == 8/9/10
     mova            m3, [r6+r5*2]
 %endif ; %1 == 8/9/10/16
@@ -95,12 +97,18 @@ SECTION .text
 %if %1 == 16
     mova            m4, [r6+r5*4]
     mova            m6, [r6+r5*4+mmsize]
+%elif mmsize == 32
+    movu            m4, [r6+r5*2]
 %else ; %1 == 8/9/10
     mova            m4, [r6+r5*2]
 %endif ; %1 == 8/9/10/16
 
     ; coefficients
+%if mmsize == 32
+    vpbroadcastd    m0, [filterq+2*cntr_reg-4] ; coeff[0], coeff[1]
+%else
     movd            m0, [filterq+2*cntr_reg-4] ; coeff[0], coeff[1]
+%endif
 %if %1 == 16
     pshuflw         m7,  m0,  0          ; coeff[0]
     pshuflw         m0,  m0,  0x55       ; coeff[1]
@@ -119,7 +127,9 @@ SECTION .text
 %else ; %1 == 10/9/8
     punpcklwd       m5,  m3,  m4
     punpckhwd       m3,  m4
+%if mmsize != 32
     SPLATD          m0
+%endif
 
     pmaddwd         m5,  m0
     pmaddwd         m3,  m0
@@ -142,7 +152,12 @@ SECTION .text
 %if %1 == 8
     packssdw        m2,  m1
     packuswb        m2,  m2
+%if mmsize == 32
+    vpermq          m2,  m2,  q3120
+    movu   [dstq+r5*1], xm2
+%else
     movh   [dstq+r5*1],  m2
+%endif
 %else ; %1 == 9/10/16
 %if %1 == 16
     packssdw        m2,  m1
@@ -187,20 +202,22 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 %assign pad 0x2c - (stack_offset & 15)
     SUB             rsp, pad
 %define m_dith m7
+%define xm_dith m7
 %else ; x86-64
 %define m_dith m9
+%define xm_dith xm9
 %endif ; x86-32
 
     ; create registers holding dither
-    movq        m_dith, [ditherq]        ; dither
+    movq       xm_dith, [ditherq]        ; dither
     test        offsetd, offsetd
     jz              .no_rot
-%if mmsize == 16
+%if mmsize >= 16
     punpcklqdq  m_dith,  m_dith
-%endif ; mmsize == 16
+%endif ; mmsize >= 16
     PALIGNR     m_dith,  m_dith,  3,  m0
 .no_rot:
-%if mmsize == 16
+%if mmsize >= 16
     punpcklbw   m_dith,  m6
 %if ARCH_X86_64
     punpcklwd       m8,  m_dith,  m6
@@ -211,6 +228,11 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 %endif ; x86-32/64
     punpckhwd   m_dith,  m6
     pslld       m_dith,  12
+%if mmsize == 32
+    ; the dither pattern repeats every 8 pixels, one copy per lane
+    vpermq          m8,  m8,      q1010
+    vpermq      m_dith,  m_dith,  q1010
+%endif
 %if ARCH_X86_32
     mova      [rsp+ 0],  m5
     mova      [rsp+16],  m_dith
@@ -237,8 +259,8 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 
 %if mmsize == 8 || %1 == 8
     yuv2planeX_mainloop %1, a
-%else ; mmsize == 16
-    test          dstq, 15
+%else ; mmsize >= 16
+    test          dstq, mmsize - 1
     jnz .unaligned
     yuv2planeX_mainloop %1, a
     REP_RET
@@ -281,6 +303,13 @@ INIT_XMM avx
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+yuv2planeX_fn  8, 10, 7
+yuv2planeX_fn  9,  7, 5
+yuv2planeX_fn 10,  7, 5
+%endif
 %endif
 
 ; %1=outout-bpc, %2=alignment (u/a)
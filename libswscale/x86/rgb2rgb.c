@@ -160,6 +160,69 @@ void ff_uyvytoyuv422_avx(uint8_t *ydst, uint8_t *udst, uint8_t *vdst,
                          int lumStride, int chromStride, int srcStride);
 #endif
 
+void ff_interleave_words_row_sse2(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, intptr_t w, int shift);
+void ff_interleave_words_row_avx2(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dst, intptr_t w, int shift);
+void ff_deinterleave_words_row_sse2(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, intptr_t w, int shift);
+void ff_deinterleave_words_row_avx2(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, intptr_t w, int shift);
+
+#define WORDS_FUNCS(opt, mmsize)                                              \
+static void interleave_words_##opt(const uint8_t *src1, const uint8_t *src2, \
+                                   uint8_t *dst, int width, int height,      \
+                                   int src1Stride, int src2Stride,           \
+                                   int dstStride, int shift)                 \
+{                                                                             \
+    const int simd = (width * 2) & ~(mmsize - 1);                             \
+    int w, h;                                                                 \
+                                                                              \
+    for (h = 0; h < height; h++) {                                            \
+        const uint16_t *s1 = (const uint16_t *)src1;                          \
+        const uint16_t *s2 = (const uint16_t *)src2;                          \
+        uint16_t *d = (uint16_t *)dst;                                        \
+                                                                              \
+        if (simd)                                                             \
+            ff_interleave_words_row_##opt(src1, src2, dst, simd, shift);      \
+        for (w = simd / 2; w < width; w++) {                                  \
+            d[2 * w + 0] = s1[w] << shift;                                    \
+            d[2 * w + 1] = s2[w] << shift;                                    \
+        }                                                                     \
+        src1 += src1Stride;                                                   \
+        src2 += src2Stride;                                                   \
+        dst  += dstStride;                                                    \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void deinterleave_words_##opt(const uint8_t *src, uint8_t *dst1,      \
+                                     uint8_t *dst2, int width, int height,   \
+                                     int srcStride, int dst1Stride,          \
+                                     int dst2Stride, int shift)              \
+{                                                                             \
+    const int simd = (width * 2) & ~(mmsize - 1);                             \
+    int w, h;                                                                 \
+                                                                              \
+    for (h = 0; h < height; h++) {                                            \
+        const uint16_t *s = (const uint16_t *)src;                            \
+        uint16_t *d1 = (uint16_t *)dst1;                                      \
+        uint16_t *d2 = (uint16_t *)dst2;                                      \
+                                                                              \
+        if (simd)                                                             \
+            ff_deinterleave_words_row_##opt(src, dst1, dst2, simd, shift);    \
+        for (w = simd / 2; w < width; w++) {                                  \
+            d1[w] = s[2 * w + 0] >> shift;                                    \
+            d2[w] = s[2 * w + 1] >> shift;                                    \
+        }                                                                     \
+        src  += srcStride;                                                    \
+        dst1 += dst1Stride;                                                   \
+        dst2 += dst2Stride;                                                   \
+    }                                                                         \
+}
+
+WORDS_FUNCS(sse2, 16)
+WORDS_FUNCS(avx2, 32)
+
 av_cold void rgb2rgb_init_x86(void)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -181,6 +244,8 @@ av_cold void rgb2rgb_init_x86(void)
         shuffle_bytes_2103 = ff_shuffle_bytes_2103_mmxext;
     }
     if (EXTERNAL_SSE2(cpu_flags)) {
+        interleaveWords   = interleave_words_sse2;
+        deinterleaveWords = deinterleave_words_sse2;
 #if ARCH_X86_64
         uyvytoyuv422 = ff_uyvytoyuv422_sse2;
 #endif
@@ -197,4 +262,8 @@ av_cold void rgb2rgb_init_x86(void)
         uyvytoyuv422 = ff_uyvytoyuv422_avx;
 #endif
     }
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        interleaveWords   = interleave_words_avx2;
+        deinterleaveWords = deinterleave_words_avx2;
+    }
 }
@@ -298,3 +298,81 @@ UYVY_TO_YUV422
 INIT_XMM avx
 UYVY_TO_YUV422
 %endif
+
+;------------------------------------------------------------------------------
+; void ff_interleave_words_row(const uint8_t *src1, const uint8_t *src2,
+;                              uint8_t *dst, intptr_t w, int shift)
+; w is the size of a source row in bytes and a multiple of mmsize
+;------------------------------------------------------------------------------
+%macro INTERLEAVE_WORDS 0
+cglobal interleave_words_row, 5, 5, 4, src1, src2, dst, w, shift
+    movd          xm2, shiftd
+    add         src1q, wq
+    add         src2q, wq
+    lea          dstq, [dstq + 2 * wq]
+    neg            wq
+
+.loop:
+    movu           m0, [src1q + wq]
+    movu           m1, [src2q + wq]
+    psllw          m0, xm2
+    psllw          m1, xm2
+%if cpuflag(avx2)
+    vpermq         m0, m0, q3120
+    vpermq         m1, m1, q3120
+%endif
+    SBUTTERFLY     wd, 0, 1, 3
+    movu [dstq + 2 * wq],          m0
+    movu [dstq + 2 * wq + mmsize], m1
+    add            wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_deinterleave_words_row(const uint8_t *src, uint8_t *dst1,
+;                                uint8_t *dst2, intptr_t w, int shift)
+; w is the size of a destination row in bytes and a multiple of mmsize
+;------------------------------------------------------------------------------
+%macro DEINTERLEAVE_WORDS 0
+cglobal deinterleave_words_row, 5, 5, 5, src, dst1, dst2, w, shift
+    movd          xm4, shiftd
+    lea          srcq, [srcq + 2 * wq]
+    add         dst1q, wq
+    add         dst2q, wq
+    neg            wq
+
+.loop:
+    movu           m0, [srcq + 2 * wq]
+    movu           m1, [srcq + 2 * wq + mmsize]
+    psrlw          m0, xm4
+    psrlw          m1, xm4
+    ; even words to the low and odd words to the high qword of each lane
+    pshuflw        m0, m0, q3120
+    pshuflw        m1, m1, q3120
+    pshufhw        m0, m0, q3120
+    pshufhw        m1, m1, q3120
+    pshufd         m0, m0, q3120
+    pshufd         m1, m1, q3120
+    punpckhqdq     m2, m0, m1
+    punpcklqdq     m0, m1
+%if cpuflag(avx2)
+    vpermq         m0, m0, q3120
+    vpermq         m2, m2, q3120
+%endif
+    movu [dst1q + wq], m0
+    movu [dst2q + wq], m2
+    add            wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+INTERLEAVE_WORDS
+DEINTERLEAVE_WORDS
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+INTERLEAVE_WORDS
+DEINTERLEAVE_WORDS
+%endif
@@ -21,8 +21,9 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
+hscale8_perm:  dd 0, 4, 1, 5, 2, 6, 3, 7
 max_19bit_int: times 4 dd 0x7ffff
 max_19bit_flt: times 4 dd 524287.0
 minshort:      times 8 dw 0x8000
@@ -421,3 +422,171 @@ INIT_XMM ssse3
 SCALE_FUNCS2 6, 6, 8
 INIT_XMM sse4
 SCALE_FUNCS2 6, 6, 8
+
+;-----------------------------------------------------------------------------
+; AVX2 versions of the 4- and 8-tap scalers, 8 output pixels per iteration.
+; dstW must be a multiple of 8, as filter and filterPos are read in groups of
+; 8 output pixels.
+;-----------------------------------------------------------------------------
+
+; SCALE_FUNC_AVX2 source_width, intermediate_nbits, filtersize
+%macro SCALE_FUNC_AVX2 3
+cglobal hscale%1to%2_%3, 6, 9, 9, pos0, dst, w, src, filter, fltpos, pos1, pos2, pos3
+%if %2 == 19
+    vpbroadcastd  m2, [max_19bit_int]
+%endif ; %2 == 19
+%if %1 == 16
+    vbroadcasti128 m6, [minshort]
+    vpbroadcastd  m7, [unicoeff]
+%endif ; %1 == 16
+%if %3 == 8
+    mova          m8, [hscale8_perm]
+%endif ; %3 == 8
+
+.loop:
+%if %3 == 4 ; filterSize == 4 scaling
+    ; load 8x4 source pixels into m0/m1, two output pixels per lane
+    movsxd     pos0q, dword [fltposq+ 0]
+    movsxd     pos1q, dword [fltposq+ 4]
+    movsxd     pos2q, dword [fltposq+ 8]
+    movsxd     pos3q, dword [fltposq+12]
+%if %1 == 8
+    movd         xm0, [srcq+pos0q]              ; src[filterPos[0] + {0,1,2,3}]
+    pinsrd       xm0, [srcq+pos1q], 1           ; src[filterPos[1] + {0,1,2,3}]
+    pinsrd       xm0, [srcq+pos2q], 2           ; src[filterPos[2] + {0,1,2,3}]
+    pinsrd       xm0, [srcq+pos3q], 3           ; src[filterPos[3] + {0,1,2,3}]
+%else ; %1 == 9-16
+    movq         xm0, [srcq+pos0q*2]            ; src[filterPos[0] + {0,1,2,3}]
+    movhps       xm0, [srcq+pos1q*2]            ; src[filterPos[1] + {0,1,2,3}]
+    movq         xm4, [srcq+pos2q*2]            ; src[filterPos[2] + {0,1,2,3}]
+    movhps       xm4, [srcq+pos3q*2]            ; src[filterPos[3] + {0,1,2,3}]
+%endif ; %1 == 8/9-16
+    movsxd     pos0q, dword [fltposq+16]
+    movsxd     pos1q, dword [fltposq+20]
+    movsxd     pos2q, dword [fltposq+24]
+    movsxd     pos3q, dword [fltposq+28]
+%if %1 == 8
+    movd         xm1, [srcq+pos0q]              ; src[filterPos[4] + {0,1,2,3}]
+    pinsrd       xm1, [srcq+pos1q], 1           ; src[filterPos[5] + {0,1,2,3}]
+    pinsrd       xm1, [srcq+pos2q], 2           ; src[filterPos[6] + {0,1,2,3}]
+    pinsrd       xm1, [srcq+pos3q], 3           ; src[filterPos[7] + {0,1,2,3}]
+    pmovzxbw      m0, xm0                       ; byte -> word
+    pmovzxbw      m1, xm1                       ; byte -> word
+%else ; %1 == 9-16
+    movq         xm1, [srcq+pos0q*2]            ; src[filterPos[4] + {0,1,2,3}]
+    movhps       xm1, [srcq+pos1q*2]            ; src[filterPos[5] + {0,1,2,3}]
+    movq         xm5, [srcq+pos2q*2]            ; src[filterPos[6] + {0,1,2,3}]
+    movhps       xm5, [srcq+pos3q*2]            ; src[filterPos[7] + {0,1,2,3}]
+    vinserti128   m0, m0, xm4, 1
+    vinserti128   m1, m1, xm5, 1
+%endif ; %1 == 8/9-16
+
+    ; multiply with filter coefficients
+%if %1 == 16 ; pmaddwd needs signed adds, so this moves unsigned -> signed, we'll
+             ; add back 0x8000 * sum(coeffs) after the horizontal add
+    psubw         m0, m6
+    psubw         m1, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+mmsize*0]        ; *= filter[{0,1,..,14,15}]
+    pmaddwd       m1, [filterq+mmsize*1]        ; *= filter[{16,17,..,30,31}]
+
+    ; add up horizontally (4 srcpix * 4 coefficients -> 1 dstpix)
+    phaddd        m0, m1                        ; dstpix {0,1,4,5 | 2,3,6,7}
+    vpermq        m0, m0, q3120                 ; dstpix {0,1,2,3 | 4,5,6,7}
+%else ; %3 == 8, i.e. filterSize == 8 scaling
+    ; load 8x8 source pixels into m0, m1, m4 and m5, one output pixel per lane
+    movsxd     pos0q, dword [fltposq+ 0]
+    movsxd     pos1q, dword [fltposq+ 4]
+    movsxd     pos2q, dword [fltposq+ 8]
+    movsxd     pos3q, dword [fltposq+12]
+%if %1 == 8
+    movq         xm0, [srcq+pos0q]              ; src[filterPos[0] + {0,1,..,6,7}]
+    movhps       xm0, [srcq+pos1q]              ; src[filterPos[1] + {0,1,..,6,7}]
+    movq         xm1, [srcq+pos2q]              ; src[filterPos[2] + {0,1,..,6,7}]
+    movhps       xm1, [srcq+pos3q]              ; src[filterPos[3] + {0,1,..,6,7}]
+%else ; %1 == 9-16
+    movu         xm0, [srcq+pos0q*2]            ; src[filterPos[0] + {0,1,..,6,7}]
+    vinserti128   m0, m0, [srcq+pos1q*2], 1     ; src[filterPos[1] + {0,1,..,6,7}]
+    movu         xm1, [srcq+pos2q*2]            ; src[filterPos[2] + {0,1,..,6,7}]
+    vinserti128   m1, m1, [srcq+pos3q*2], 1     ; src[filterPos[3] + {0,1,..,6,7}]
+%endif ; %1 == 8/9-16
+    movsxd     pos0q, dword [fltposq+16]
+    movsxd     pos1q, dword [fltposq+20]
+    movsxd     pos2q, dword [fltposq+24]
+    movsxd     pos3q, dword [fltposq+28]
+%if %1 == 8
+    movq         xm4, [srcq+pos0q]              ; src[filterPos[4] + {0,1,..,6,7}]
+    movhps       xm4, [srcq+pos1q]              ; src[filterPos[5] + {0,1,..,6,7}]
+    movq         xm5, [srcq+pos2q]              ; src[filterPos[6] + {0,1,..,6,7}]
+    movhps       xm5, [srcq+pos3q]              ; src[filterPos[7] + {0,1,..,6,7}]
+    pmovzxbw      m0, xm0                       ; byte -> word
+    pmovzxbw      m1, xm1                       ; byte -> word
+    pmovzxbw      m4, xm4                       ; byte -> word
+    pmovzxbw      m5, xm5                       ; byte -> word
+%else ; %1 == 9-16
+    movu         xm4, [srcq+pos0q*2]            ; src[filterPos[4] + {0,1,..,6,7}]
+    vinserti128   m4, m4, [srcq+pos1q*2], 1     ; src[filterPos[5] + {0,1,..,6,7}]
+    movu         xm5, [srcq+pos2q*2]            ; src[filterPos[6] + {0,1,..,6,7}]
+    vinserti128   m5, m5, [srcq+pos3q*2], 1     ; src[filterPos[7] + {0,1,..,6,7}]
+%endif ; %1 == 8/9-16
+
+    ; multiply
+%if %1 == 16 ; pmaddwd needs signed adds, so this moves unsigned -> signed, we'll
+             ; add back 0x8000 * sum(coeffs) after the horizontal add
+    psubw         m0, m6
+    psubw         m1, m6
+    psubw         m4, m6
+    psubw         m5, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+mmsize*0]        ; *= filter[{0,1,..,14,15}]
+    pmaddwd       m1, [filterq+mmsize*1]        ; *= filter[{16,17,..,30,31}]
+    pmaddwd       m4, [filterq+mmsize*2]        ; *= filter[{32,33,..,46,47}]
+    pmaddwd       m5, [filterq+mmsize*3]        ; *= filter[{48,49,..,62,63}]
+
+    ; add up horizontally (8 srcpix * 8 coefficients -> 1 dstpix)
+    phaddd        m0, m1
+    phaddd        m4, m5
+    phaddd        m0, m4                        ; dstpix {0,2,4,6 | 1,3,5,7}
+    vpermd        m0, m8, m0                    ; dstpix {0,1,2,3 | 4,5,6,7}
+%endif ; %3 == 4/8
+
+%if %1 == 16 ; add 0x8000 * sum(coeffs), i.e. back from signed -> unsigned
+    paddd         m0, m7
+%endif ; %1 == 16
+
+    ; clip, store
+    psrad         m0, 14 + %1 - %2
+%if %2 == 15
+    vextracti128 xm1, m0, 1
+    packssdw     xm0, xm1
+    movu      [dstq], xm0
+    add         dstq, 16
+%else ; %2 == 19
+    pminsd        m0, m2
+    movu      [dstq], m0
+    add         dstq, 32
+%endif ; %2 == 15/19
+    add      fltposq, 32
+    add      filterq, 16 * %3
+    sub           wd, 8
+    jg .loop
+    RET
+%endmacro
+
+; SCALE_FUNCS_AVX2 source_width
+%macro SCALE_FUNCS_AVX2 1
+SCALE_FUNC_AVX2 %1, 15, 4
+SCALE_FUNC_AVX2 %1, 15, 8
+SCALE_FUNC_AVX2 %1, 19, 4
+SCALE_FUNC_AVX2 %1, 19, 8
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SCALE_FUNCS_AVX2  8
+SCALE_FUNCS_AVX2  9
+SCALE_FUNCS_AVX2 10
+SCALE_FUNCS_AVX2 12
+SCALE_FUNCS_AVX2 14
+SCALE_FUNCS_AVX2 16
+%endif
@@ -315,6 +315,10 @@ SCALE_FUNCS_MMX(mmx);
 SCALE_FUNCS_SSE(sse2);
 SCALE_FUNCS_SSE(ssse3);
 SCALE_FUNCS_SSE(sse4);
+#if ARCH_X86_64
+SCALE_FUNCS(4, avx2);
+SCALE_FUNCS(8, avx2);
+#endif
 
 #define VSCALEX_FUNC(size, opt) \
 void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
@@ -332,6 +336,9 @@ VSCALEX_FUNCS(sse2);
 VSCALEX_FUNCS(sse4);
 VSCALEX_FUNC(16, sse4);
 VSCALEX_FUNCS(avx);
+#if ARCH_X86_64
+VSCALEX_FUNCS(avx2);
+#endif
 
 #define VSCALE_FUNC(size, opt) \
 void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
@@ -581,4 +588,21 @@ switch(c->dstBpc){ \
             break;
         }
     }
+
+#if ARCH_X86_64
+#define ASSIGN_AVX2_SCALE_FUNC(hscalefn, filtersize) \
+    switch (filtersize) { \
+    case 4:  ASSIGN_SCALE_FUNC2(hscalefn, 4, avx2, avx2); break; \
+    case 8:  ASSIGN_SCALE_FUNC2(hscalefn, 8, avx2, avx2); break; \
+    }
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        /* the AVX2 functions process 8 (hscale) or 16 (vscale) pixels at once */
+        if (!(c->dstW & 7))
+            ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize);
+        if (!(c->chrDstW & 7))
+            ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
+        if (!(c->dstW & 15) && !(c->chrDstW & 15))
+            ASSIGN_VSCALEX_FUNC(c->yuv2planeX, avx2, , 1);
+    }
+#endif
 }
@@ -52,6 +52,9 @@ struct message {
 
 #define MAGIC 0xdeadc0de
 
+/* the queue is in SPSC mode, only the receiver may flush it */
+static int spsc;
+
 static void free_frame(void *arg)
 {
     struct message *msg = arg;
@@ -66,7 +69,7 @@ static void *sender_thread(void *arg)
 
     av_log(NULL, AV_LOG_INFO, "sender #%d: workload=%d\n", wd->id, wd->workload);
     for (i = 0; i < wd->workload; i++) {
-        if (rand() % wd->workload < wd->workload / 10) {
+        if (!spsc && rand() % wd->workload < wd->workload / 10) {
             av_log(NULL, AV_LOG_INFO, "sender #%d: flushing the queue\n", wd->id);
             av_thread_message_flush(wd->queue);
         } else {
@@ -171,12 +174,13 @@ int main(int ac, char **av)
     struct receiver_data *receivers;
     AVThreadMessageQueue *queue = NULL;
 
-    if (ac != 8) {
+    if (ac != 8 && !(ac == 9 && !strcmp(av[8], "spsc"))) {
         av_log(NULL, AV_LOG_ERROR, "%s <max_queue_size> "
                "<nb_senders> <sender_min_send> <sender_max_send> "
-               "<nb_receivers> <receiver_min_recv> <receiver_max_recv>\n", av[0]);
+               "<nb_receivers> <receiver_min_recv> <receiver_max_recv> [spsc]\n", av[0]);
         return 1;
     }
+    spsc = ac == 9;
 
     max_queue_size    = atoi(av[1]);
     nb_senders        = atoi(av[2]);
@@ -192,6 +196,10 @@ int main(int ac, char **av)
         av_log(NULL, AV_LOG_ERROR, "negative values not allowed\n");
         return 1;
     }
+    if (spsc && (nb_senders != 1 || nb_receivers != 1)) {
+        av_log(NULL, AV_LOG_ERROR, "spsc requires one sender and one receiver\n");
+        return 1;
+    }
 
     av_log(NULL, AV_LOG_INFO, "qsize:%d / %d senders sending [%d-%d] / "
            "%d receivers receiving [%d-%d]\n", max_queue_size,
@@ -205,7 +213,8 @@ int main(int ac, char **av)
         goto end;
     }
 
-    ret = av_thread_message_queue_alloc(&queue, max_queue_size, sizeof(struct message));
+    ret = av_thread_message_queue_alloc2(&queue, max_queue_size, sizeof(struct message),
+                                         spsc ? AV_THREAD_MESSAGE_QUEUE_SPSC : 0);
     if (ret < 0)
         goto end;
 
@@ -0,0 +1,83 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavutil/aes.h"
+#include "libavutil/aes_internal.h"
+#include "libavutil/mem.h"
+
+#define MAX_BLOCKS 64
+
+static const int counts[] = { 1, 3, 4, 7, MAX_BLOCKS };
+
+static void check_aes_crypt(AVAES *a, int key_bits, int decrypt, int cbc)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [MAX_BLOCKS * 16]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [MAX_BLOCKS * 16]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [MAX_BLOCKS * 16]);
+    uint8_t key[32], iv0[16], iv1[16];
+    int i, j;
+
+    declare_func(void, AVAES *a, uint8_t *dst, const uint8_t *src,
+                 int count, uint8_t *iv, int rounds);
+
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = rnd();
+    av_aes_init(a, key, key_bits, decrypt);
+
+    if (check_func(a->crypt, "aes_%s_%s_%d", decrypt ? "decrypt" : "encrypt",
+                   cbc ? "cbc" : "ecb", key_bits)) {
+        for (i = 0; i < FF_ARRAY_ELEMS(counts); i++) {
+            for (j = 0; j < MAX_BLOCKS * 16; j++)
+                src[j] = rnd();
+            for (j = 0; j < 16; j++)
+                iv0[j] = iv1[j] = rnd();
+            call_ref(a, dst0, src, counts[i], cbc ? iv0 : NULL, a->rounds);
+            call_new(a, dst1, src, counts[i], cbc ? iv1 : NULL, a->rounds);
+            if (memcmp(dst0, dst1, counts[i] * 16) || memcmp(iv0, iv1, 16))
+                fail();
+
+            /* in place */
+            memcpy(dst0, src, counts[i] * 16);
+            memcpy(dst1, src, counts[i] * 16);
+            call_ref(a, dst0, dst0, counts[i], cbc ? iv0 : NULL, a->rounds);
+            call_new(a, dst1, dst1, counts[i], cbc ? iv1 : NULL, a->rounds);
+            if (memcmp(dst0, dst1, counts[i] * 16) || memcmp(iv0, iv1, 16))
+                fail();
+        }
+        bench_new(a, dst1, src, MAX_BLOCKS, cbc ? iv1 : NULL, a->rounds);
+    }
+}
+
+void checkasm_check_aes(void)
+{
+    AVAES *a = av_aes_alloc();
+    int key_bits, decrypt, cbc;
+
+    if (!a)
+        return;
+
+    for (key_bits = 128; key_bits <= 256; key_bits += 64)
+        for (decrypt = 0; decrypt <= 1; decrypt++)
+            for (cbc = 0; cbc <= 1; cbc++)
+                check_aes_crypt(a, key_bits, decrypt, cbc);
+    report("crypt");
+
+    av_free(a);
+}
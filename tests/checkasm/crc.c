@@ -0,0 +1,61 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "checkasm.h"
+#include "libavutil/crc_internal.h"
+#include "libavutil/mem.h"
+
+#define BUF_SIZE 4096
+
+static const int lengths[] = { 64, 80, 112, 128, 208, 1040, BUF_SIZE };
+
+static void check_crc32(uint32_t (*func)(uint32_t crc, const uint8_t *buf, size_t len),
+                        const char *name, const uint8_t *buf)
+{
+    int i;
+
+    declare_func(uint32_t, uint32_t crc, const uint8_t *buf, size_t len);
+
+    if (check_func(func, "crc32_%s", name)) {
+        for (i = 0; i < FF_ARRAY_ELEMS(lengths); i++) {
+            /* odd offset to check unaligned loads */
+            const uint8_t *p = buf + (lengths[i] < BUF_SIZE);
+            uint32_t crc = rnd();
+
+            if (call_ref(crc, p, lengths[i]) != call_new(crc, p, lengths[i]))
+                fail();
+        }
+        bench_new(rnd(), buf, BUF_SIZE);
+    }
+}
+
+void checkasm_check_crc(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, buf, [BUF_SIZE + 1]);
+    CRCDSPContext c;
+    int i;
+
+    for (i = 0; i < BUF_SIZE + 1; i++)
+        buf[i] = rnd();
+
+    ff_crc_dsp_init(&c);
+
+    check_crc32(c.crc32_le, "le", buf);
+    check_crc32(c.crc32_be, "be", buf);
+    report("crc32");
+}
@@ -0,0 +1,182 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define BUF_STRIDE   (16 * 2)
+#define BUF_SIZE     (BUF_STRIDE * 16)
+
+static void set_pixel(uint8_t *buf, int bit_depth, ptrdiff_t offset, int v)
+{
+    v = av_clip(v, 0, (1 << bit_depth) - 1);
+    if (bit_depth > 8)
+        AV_WN16A(buf + offset, v);
+    else
+        buf[offset] = v;
+}
+
+/**
+ * Fill the 8 lines crossing an edge with content which, depending on a
+ * random choice per 4 line segment, is left alone, weakly filtered or
+ * strongly filtered, so that all the paths of the filters are exercised.
+ *
+ * @param nb_side number of pixels read on each side of the edge
+ */
+static void randomize_edge(uint8_t *pix, ptrdiff_t xstride, ptrdiff_t ystride,
+                           int nb_side, int tc, int bit_depth)
+{
+    const int max   = (1 << bit_depth) - 1;
+    const int scale = 1 << (bit_depth - 8);
+    int i, j, k;
+
+    for (j = 0; j < 2; j++) {
+        int type  = rnd() % 3;
+        int base  = rnd() % (max + 1);
+        int slope = (rnd() % 3 - 1) * (rnd() % 4) * scale;
+        int step  = (rnd() % (3 * tc + 2) - (3 * tc + 1) / 2) * scale;
+
+        for (i = 4 * j; i < 4 * j + 4; i++) {
+            for (k = -nb_side; k < nb_side; k++) {
+                int v;
+
+                if (type == 0)
+                    v = rnd() % (max + 1);
+                else if (type == 1)
+                    v = base + (k >= 0 ? step : 0);
+                else
+                    v = base + k * slope + (k >= 0 ? step : 0);
+                set_pixel(pix, bit_depth, i * ystride + k * xstride, v);
+            }
+        }
+    }
+}
+
+static void check_deblock_luma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    const ptrdiff_t pixel = SIZEOF_PIXEL;
+    uint8_t no_p[2], no_q[2];
+    int tc[2], beta, dir, i;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *pix, ptrdiff_t stride,
+                      int beta, int *tc, uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        /* the edge is in the middle of the buffer, pix points to q0 */
+        const ptrdiff_t xstride = dir ? BUF_STRIDE : pixel;
+        const ptrdiff_t ystride = dir ? pixel      : BUF_STRIDE;
+        const ptrdiff_t offset  = 8 * xstride + 4 * ystride;
+
+        if (!check_func(dir ? h->hevc_h_loop_filter_luma : h->hevc_v_loop_filter_luma,
+                        "hevc_%s_loop_filter_luma_%d", dir ? "h" : "v", bit_depth))
+            continue;
+
+        for (i = 0; i < 32; i++) {
+            beta    = rnd() % 65;
+            tc[0]   = rnd() % 25;
+            tc[1]   = rnd() % 25;
+            no_p[0] = !(rnd() % 4);
+            no_p[1] = !(rnd() % 4);
+            no_q[0] = !(rnd() % 4);
+            no_q[1] = !(rnd() % 4);
+
+            memset(buf0, 0, BUF_SIZE);
+            randomize_edge(buf0 + offset, xstride, ystride, 4,
+                           FFMAX(tc[0], tc[1]), bit_depth);
+            memcpy(buf1, buf0, BUF_SIZE);
+
+            call_ref(buf0 + offset, BUF_STRIDE, beta, tc, no_p, no_q);
+            call_new(buf1 + offset, BUF_STRIDE, beta, tc, no_p, no_q);
+            if (memcmp(buf0, buf1, BUF_SIZE))
+                fail();
+        }
+        bench_new(buf1 + offset, BUF_STRIDE, beta, tc, no_p, no_q);
+    }
+}
+
+static void check_deblock_chroma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    const ptrdiff_t pixel = SIZEOF_PIXEL;
+    uint8_t no_p[2], no_q[2];
+    int tc[2], dir, i;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *pix, ptrdiff_t stride,
+                      int *tc, uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        const ptrdiff_t xstride = dir ? BUF_STRIDE : pixel;
+        const ptrdiff_t ystride = dir ? pixel      : BUF_STRIDE;
+        const ptrdiff_t offset  = 8 * xstride + 4 * ystride;
+
+        if (!check_func(dir ? h->hevc_h_loop_filter_chroma : h->hevc_v_loop_filter_chroma,
+                        "hevc_%s_loop_filter_chroma_%d", dir ? "h" : "v", bit_depth))
+            continue;
+
+        for (i = 0; i < 32; i++) {
+            tc[0]   = rnd() % 25;
+            tc[1]   = rnd() % 25;
+            no_p[0] = !(rnd() % 4);
+            no_p[1] = !(rnd() % 4);
+            no_q[0] = !(rnd() % 4);
+            no_q[1] = !(rnd() % 4);
+
+            memset(buf0, 0, BUF_SIZE);
+            randomize_edge(buf0 + offset, xstride, ystride, 2,
+                           FFMAX(tc[0], tc[1]), bit_depth);
+            memcpy(buf1, buf0, BUF_SIZE);
+
+            call_ref(buf0 + offset, BUF_STRIDE, tc, no_p, no_q);
+            call_new(buf1 + offset, BUF_STRIDE, tc, no_p, no_q);
+            if (memcmp(buf0, buf1, BUF_SIZE))
+                fail();
+        }
+        bench_new(buf1 + offset, BUF_STRIDE, tc, no_p, no_q);
+    }
+}
+
+void checkasm_check_hevc_deblock(void)
+{
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_luma(&h, bit_depth);
+    }
+    report("loop_filter_luma");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_chroma(&h, bit_depth);
+    }
+    report("loop_filter_chroma");
+}
@@ -0,0 +1,247 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+static const int sizes[] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const char *const types[2][2] = { { "pixels", "h" }, { "v", "hv" } };
+
+#define SRC_EXTRA 8
+#define SRC_STRIDE ((MAX_PB_SIZE + 2 * SRC_EXTRA) * 2)
+#define SRC_BUF_SIZE (SRC_STRIDE * (MAX_PB_SIZE + 2 * SRC_EXTRA))
+#define DST_BUF_SIZE (MAX_PB_SIZE * MAX_PB_SIZE)
+
+#define randomize_buffers(buf, size)                        \
+    do {                                                    \
+        uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];   \
+        int k;                                              \
+        for (k = 0; k < size; k += 4)                       \
+            AV_WN32A(buf + k, rnd() & mask);                \
+    } while (0)
+
+typedef void (*put_func)(int16_t *dst, uint8_t *src, ptrdiff_t srcstride,
+                         int height, intptr_t mx, intptr_t my, int width);
+
+static void check_put_pel(put_func funcs[10][2][2], const char *name,
+                          int max_frac, int bit_depth)
+{
+    int i, j, k, y;
+    LOCAL_ALIGNED_32(uint8_t, src_buf, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [DST_BUF_SIZE]);
+    const int pixel_size = (bit_depth + 7) / 8;
+    uint8_t *src = src_buf + SRC_EXTRA * SRC_STRIDE + SRC_EXTRA * pixel_size;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, int16_t *dst, uint8_t *src,
+                      ptrdiff_t srcstride, int height, intptr_t mx,
+                      intptr_t my, int width);
+
+    randomize_buffers(src_buf, SRC_BUF_SIZE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        const int size = sizes[i];
+
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int mx = k ? 1 + rnd() % max_frac : 0;
+                int my = j ? 1 + rnd() % max_frac : 0;
+
+                if (check_func(funcs[i][j][k], "put_hevc_%s_%s_%d_%d", name,
+                               types[j][k], size, bit_depth)) {
+                    memset(dst0, 0, DST_BUF_SIZE * sizeof(*dst0));
+                    memset(dst1, 0, DST_BUF_SIZE * sizeof(*dst1));
+
+                    call_ref(dst0, src, SRC_STRIDE, size, mx, my, size);
+                    call_new(dst1, src, SRC_STRIDE, size, mx, my, size);
+                    for (y = 0; y < size; y++) {
+                        if (memcmp(dst0 + y * MAX_PB_SIZE, dst1 + y * MAX_PB_SIZE,
+                                   size * sizeof(*dst0))) {
+                            fail();
+                            break;
+                        }
+                    }
+                    bench_new(dst1, src, SRC_STRIDE, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+typedef void (*put_uni_func)(uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                             ptrdiff_t srcstride, int height, intptr_t mx,
+                             intptr_t my, int width);
+
+static void check_put_pel_uni(put_uni_func funcs[10][2][2], const char *name,
+                              int max_frac, int bit_depth)
+{
+    int i, j, k, y;
+    LOCAL_ALIGNED_32(uint8_t, src_buf, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE * 2]);
+    const int pixel_size = (bit_depth + 7) / 8;
+    const ptrdiff_t dst_stride = MAX_PB_SIZE * 2;
+    uint8_t *src = src_buf + SRC_EXTRA * SRC_STRIDE + SRC_EXTRA * pixel_size;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, ptrdiff_t dststride,
+                      uint8_t *src, ptrdiff_t srcstride, int height,
+                      intptr_t mx, intptr_t my, int width);
+
+    randomize_buffers(src_buf, SRC_BUF_SIZE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        const int size = sizes[i];
+
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int mx = k ? 1 + rnd() % max_frac : 0;
+                int my = j ? 1 + rnd() % max_frac : 0;
+
+                if (check_func(funcs[i][j][k], "put_hevc_%s_uni_%s_%d_%d", name,
+                               types[j][k], size, bit_depth)) {
+                    memset(dst0, 0, DST_BUF_SIZE * 2);
+                    memset(dst1, 0, DST_BUF_SIZE * 2);
+
+                    call_ref(dst0, dst_stride, src, SRC_STRIDE, size, mx, my, size);
+                    call_new(dst1, dst_stride, src, SRC_STRIDE, size, mx, my, size);
+                    for (y = 0; y < size; y++) {
+                        if (memcmp(dst0 + y * dst_stride, dst1 + y * dst_stride,
+                                   size * pixel_size)) {
+                            fail();
+                            break;
+                        }
+                    }
+                    bench_new(dst1, dst_stride, src, SRC_STRIDE, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+typedef void (*put_bi_func)(uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                            ptrdiff_t srcstride, int16_t *src2, int height,
+                            intptr_t mx, intptr_t my, int width);
+
+static void check_put_pel_bi(put_bi_func funcs[10][2][2], const char *name,
+                             int max_frac, int bit_depth)
+{
+    int i, j, k, y;
+    LOCAL_ALIGNED_32(uint8_t, src_buf, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE * 2]);
+    const int pixel_size = (bit_depth + 7) / 8;
+    const ptrdiff_t dst_stride = MAX_PB_SIZE * 2;
+    uint8_t *src = src_buf + SRC_EXTRA * SRC_STRIDE + SRC_EXTRA * pixel_size;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, ptrdiff_t dststride,
+                      uint8_t *src, ptrdiff_t srcstride, int16_t *src2,
+                      int height, intptr_t mx, intptr_t my, int width);
+
+    randomize_buffers(src_buf, SRC_BUF_SIZE);
+    /* keep the sums within the range the SIMD versions can hold in 16 bits */
+    for (i = 0; i < DST_BUF_SIZE; i++)
+        src2[i] = rnd() & 0x1fff;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        const int size = sizes[i];
+
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                int mx = k ? 1 + rnd() % max_frac : 0;
+                int my = j ? 1 + rnd() % max_frac : 0;
+
+                if (check_func(funcs[i][j][k], "put_hevc_%s_bi_%s_%d_%d", name,
+                               types[j][k], size, bit_depth)) {
+                    memset(dst0, 0, DST_BUF_SIZE * 2);
+                    memset(dst1, 0, DST_BUF_SIZE * 2);
+
+                    call_ref(dst0, dst_stride, src, SRC_STRIDE, src2, size, mx, my, size);
+                    call_new(dst1, dst_stride, src, SRC_STRIDE, src2, size, mx, my, size);
+                    for (y = 0; y < size; y++) {
+                        if (memcmp(dst0 + y * dst_stride, dst1 + y * dst_stride,
+                                   size * pixel_size)) {
+                            fail();
+                            break;
+                        }
+                    }
+                    bench_new(dst1, dst_stride, src, SRC_STRIDE, src2, size, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+void checkasm_check_hevc_pel(void)
+{
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel(h.put_hevc_qpel, "qpel", 3, bit_depth);
+    }
+    report("qpel");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel_uni(h.put_hevc_qpel_uni, "qpel", 3, bit_depth);
+    }
+    report("qpel_uni");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel_bi(h.put_hevc_qpel_bi, "qpel", 3, bit_depth);
+    }
+    report("qpel_bi");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel(h.put_hevc_epel, "epel", 7, bit_depth);
+    }
+    report("epel");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel_uni(h.put_hevc_epel_uni, "epel", 7, bit_depth);
+    }
+    report("epel_uni");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_put_pel_bi(h.put_hevc_epel_bi, "epel", 7, bit_depth);
+    }
+    report("epel_bi");
+}
@@ -104,7 +104,7 @@ static void check_sao_edge(HEVCDSPContext h, int bit_depth)
     LOCAL_ALIGNED_32(uint8_t, src0, [BUF_SIZE]);
     LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
     int16_t offset_val[OFFSET_LENGTH];
-    int eo = rnd()%4;
+    int eo;
 
     for (i = 0; i <= 4; i++) {
         int block_size = sao_size[i];
@@ -113,17 +113,20 @@ static void check_sao_edge(HEVCDSPContext h, int bit_depth)
         declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src, ptrdiff_t stride_dst,
                           int16_t *sao_offset_val, int eo, int width, int height);
 
-        randomize_buffers(src0, src1, BUF_SIZE);
-        randomize_buffers2(offset_val, OFFSET_LENGTH);
-        memset(dst0, 0, BUF_SIZE);
-        memset(dst1, 0, BUF_SIZE);
-
         if (check_func(h.sao_edge_filter[i], "hevc_sao_edge_%dx%d_%d", block_size, block_size, bit_depth)) {
-            call_ref(dst0, src0 + offset, stride, offset_val, eo, block_size, block_size);
-            call_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
-            if (memcmp(dst0, dst1, BUF_SIZE))
-                fail();
-            bench_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
+            /* all the edge offset classes use different neighbours */
+            for (eo = 0; eo < 4; eo++) {
+                randomize_buffers(src0, src1, BUF_SIZE);
+                randomize_buffers2(offset_val, OFFSET_LENGTH);
+                memset(dst0, 0, BUF_SIZE);
+                memset(dst1, 0, BUF_SIZE);
+
+                call_ref(dst0, src0 + offset, stride, offset_val, eo, block_size, block_size);
+                call_new(dst1, src1 + offset, stride, offset_val, eo, block_size, block_size);
+                if (memcmp(dst0, dst1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(dst1, src1 + offset, stride, offset_val, rnd() % 4, block_size, block_size);
         }
     }
 }
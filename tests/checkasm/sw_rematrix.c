@@ -0,0 +1,173 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/swresample_internal.h"
+
+#include "checkasm.h"
+
+/* the SIMD functions handle multiples of 16 samples of aligned buffers */
+#define LEN 1024
+
+static const enum AVSampleFormat formats[] = {
+    AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P,
+    AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+};
+
+static void randomize_samples(uint8_t *buf, enum AVSampleFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < LEN; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P:
+            AV_WN16A(buf + 2 * i, rnd());
+            break;
+        case AV_SAMPLE_FMT_S32P:
+            AV_WN32A(buf + 4 * i, rnd() >> 1);
+            break;
+        case AV_SAMPLE_FMT_FLTP:
+            ((float *)buf)[i] = (int)rnd() / (float)INT_MAX;
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ((double *)buf)[i] = (int)rnd() / (double)INT_MAX;
+            break;
+        }
+    }
+}
+
+static int compare_samples(const uint8_t *ref, const uint8_t *new,
+                           enum AVSampleFormat fmt)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)ref,
+                                         (const float *)new, 1e-6, LEN);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array((const double *)ref,
+                                          (const double *)new, 1e-12, LEN);
+    default:
+        return memcmp(ref, new, LEN * av_get_bytes_per_sample(fmt));
+    }
+}
+
+/*
+ * A stereo to mono downmix uses mix_2_1; mix_1_1 is run with the
+ * coefficient of the left channel. The SIMD versions take the matrix in
+ * their own layout.
+ */
+static struct SwrContext *alloc_downmix(enum AVSampleFormat fmt)
+{
+    struct SwrContext *s = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_MONO, fmt, 48000,
+                                              AV_CH_LAYOUT_STEREO, fmt, 48000,
+                                              0, NULL);
+
+    if (!s || av_opt_set_int(s, "internal_sample_fmt", fmt, 0) < 0 ||
+        swr_init(s) < 0) {
+        swr_free(&s);
+        fail();
+    }
+    return s;
+}
+
+static void check_mix_1_1(enum AVSampleFormat fmt)
+{
+    LOCAL_ALIGNED_32(uint8_t, in,   [LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [LEN * 8]);
+    struct SwrContext *s = alloc_downmix(fmt);
+    void *matrix;
+
+    declare_func(void, void *out, const void *in, void *coeffp,
+                 integer index, integer len);
+
+    if (!s)
+        return;
+
+    if (check_func(s->mix_1_1_simd ? s->mix_1_1_simd : s->mix_1_1_f,
+                   "mix_1_1_%s", av_get_sample_fmt_name(fmt))) {
+        matrix = func_new == (void *)s->mix_1_1_simd ? s->native_simd_matrix
+                                                     : s->native_matrix;
+        randomize_samples(in, fmt);
+        memset(dst0, 0, LEN * 8);
+        memset(dst1, 0, LEN * 8);
+
+        call_ref(dst0, in, s->native_matrix, 0, LEN);
+        call_new(dst1, in, matrix, 0, LEN);
+        if (compare_samples(dst0, dst1, fmt))
+            fail();
+        bench_new(dst1, in, matrix, 0, LEN);
+    }
+
+    swr_free(&s);
+}
+
+static void check_mix_2_1(enum AVSampleFormat fmt)
+{
+    LOCAL_ALIGNED_32(uint8_t, in1,  [LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, in2,  [LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [LEN * 8]);
+    struct SwrContext *s = alloc_downmix(fmt);
+    void *matrix;
+
+    declare_func(void, void *out, const void *in1, const void *in2,
+                 void *coeffp, integer index1, integer index2, integer len);
+
+    if (!s)
+        return;
+
+    if (check_func(s->mix_2_1_simd ? s->mix_2_1_simd : s->mix_2_1_f,
+                   "mix_2_1_%s", av_get_sample_fmt_name(fmt))) {
+        matrix = func_new == (void *)s->mix_2_1_simd ? s->native_simd_matrix
+                                                     : s->native_matrix;
+        randomize_samples(in1, fmt);
+        randomize_samples(in2, fmt);
+        memset(dst0, 0, LEN * 8);
+        memset(dst1, 0, LEN * 8);
+
+        call_ref(dst0, in1, in2, s->native_matrix, 0, 1, LEN);
+        call_new(dst1, in1, in2, matrix, 0, 1, LEN);
+        if (compare_samples(dst0, dst1, fmt))
+            fail();
+        bench_new(dst1, in1, in2, matrix, 0, 1, LEN);
+    }
+
+    swr_free(&s);
+}
+
+void checkasm_check_sw_rematrix(void)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+        check_mix_1_1(formats[i]);
+    report("mix_1_1");
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+        check_mix_2_1(formats[i]);
+    report("mix_2_1");
+}
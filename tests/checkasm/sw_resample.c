@@ -0,0 +1,130 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define SRC_LEN 2048
+#define DST_LEN 1024
+
+static const enum AVSampleFormat formats[] = {
+    AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P,
+    AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+};
+
+static void randomize_samples(uint8_t *buf, enum AVSampleFormat fmt, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P:
+            AV_WN16A(buf + 2 * i, rnd());
+            break;
+        case AV_SAMPLE_FMT_S32P:
+            AV_WN32A(buf + 4 * i, rnd());
+            break;
+        case AV_SAMPLE_FMT_FLTP:
+            ((float *)buf)[i] = (int)rnd() / (float)INT_MAX;
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ((double *)buf)[i] = (int)rnd() / (double)INT_MAX;
+            break;
+        }
+    }
+}
+
+static int compare_samples(const uint8_t *ref, const uint8_t *new,
+                           enum AVSampleFormat fmt, int len)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)ref,
+                                         (const float *)new, 1e-6, len);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array((const double *)ref,
+                                          (const double *)new, 1e-12, len);
+    default:
+        return memcmp(ref, new, len * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static void check_resample(enum AVSampleFormat fmt, int linear)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [SRC_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_LEN * 8]);
+    struct SwrContext *swr;
+    ResampleContext *c;
+    int consumed0, consumed1;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    swr = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_MONO, fmt, 44100,
+                             AV_CH_LAYOUT_MONO, fmt, 48000, 0, NULL);
+    if (!swr || av_opt_set_int(swr, "linear_interp", linear, 0) < 0 ||
+        swr_init(swr) < 0) {
+        fail();
+        goto end;
+    }
+    c = swr->resample;
+    /* swr starts with a negative index, to be used with padded input */
+    c->index = c->frac = 0;
+
+    if (check_func(linear ? c->dsp.resample_linear : c->dsp.resample_common,
+                   "resample_%s_%s", linear ? "linear" : "common",
+                   av_get_sample_fmt_name(fmt))) {
+        randomize_samples(src, fmt, SRC_LEN);
+        memset(dst0, 0, DST_LEN * 8);
+        memset(dst1, 0, DST_LEN * 8);
+
+        consumed0 = call_ref(c, dst0, src, DST_LEN, 0);
+        consumed1 = call_new(c, dst1, src, DST_LEN, 0);
+        if (consumed0 != consumed1 ||
+            compare_samples(dst0, dst1, fmt, DST_LEN))
+            fail();
+        bench_new(c, dst1, src, DST_LEN, 0);
+    }
+
+end:
+    swr_free(&swr);
+}
+
+void checkasm_check_sw_resample(void)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+        check_resample(formats[i], 0);
+    report("resample_common");
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+        check_resample(formats[i], 1);
+    report("resample_linear");
+}
@@ -111,6 +111,110 @@ static void check_uyvy_to_422p(void)
     }
 }
 
+#define CHECK_INTERLEAVE(...)                                                  \
+    do {                                                                       \
+        for (i = 0; i < 6; i ++) {                                             \
+            memset(dst0, 0, MAX_STRIDE * 4 * MAX_HEIGHT);                      \
+            memset(dst1, 0, MAX_STRIDE * 4 * MAX_HEIGHT);                      \
+            call_ref(src_u, src_v, dst0, planes[i].w, planes[i].h,             \
+                     planes[i].s * bps, planes[i].s * bps,                     \
+                     __VA_ARGS__);                                             \
+            call_new(src_u, src_v, dst1, planes[i].w, planes[i].h,             \
+                     planes[i].s * bps, planes[i].s * bps,                     \
+                     __VA_ARGS__);                                             \
+            if (memcmp(dst0, dst1, MAX_STRIDE * 4 * MAX_HEIGHT))               \
+                fail();                                                        \
+        }                                                                      \
+        bench_new(src_u, src_v, dst1, planes[5].w, planes[5].h,                \
+                  planes[5].s * bps, planes[5].s * bps,                        \
+                  __VA_ARGS__);                                                \
+    } while (0)
+
+static void check_interleave(int bps)
+{
+    int i;
+
+    LOCAL_ALIGNED_32(uint8_t, src_u, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, src_v, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [MAX_STRIDE * 4 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [MAX_STRIDE * 4 * MAX_HEIGHT]);
+
+    randomize_buffers(src_u, MAX_STRIDE * 2 * MAX_HEIGHT);
+    randomize_buffers(src_v, MAX_STRIDE * 2 * MAX_HEIGHT);
+
+    if (bps == 1) {
+        declare_func_emms(AV_CPU_FLAG_MMX, void, const uint8_t *src1, const uint8_t *src2,
+                          uint8_t *dst, int width, int height, int src1Stride,
+                          int src2Stride, int dstStride);
+
+        if (check_func(interleaveBytes, "interleave_bytes"))
+            CHECK_INTERLEAVE(MAX_STRIDE * 2);
+    } else {
+        declare_func(void, const uint8_t *src1, const uint8_t *src2,
+                     uint8_t *dst, int width, int height, int src1Stride,
+                     int src2Stride, int dstStride, int shift);
+
+        /* 10-bit samples, so that shifting them by 6 loses nothing */
+        for (i = 0; i < MAX_STRIDE * 2 * MAX_HEIGHT; i += 2) {
+            AV_WN16(src_u + i, AV_RN16(src_u + i) & 0x3ff);
+            AV_WN16(src_v + i, AV_RN16(src_v + i) & 0x3ff);
+        }
+        if (check_func(interleaveWords, "interleave_words"))
+            CHECK_INTERLEAVE(MAX_STRIDE * 4, 6);
+    }
+}
+
+#define CHECK_DEINTERLEAVE(...)                                                \
+    do {                                                                       \
+        for (i = 0; i < 6; i ++) {                                             \
+            memset(dst_u_0, 0, MAX_STRIDE * 2 * MAX_HEIGHT);                   \
+            memset(dst_u_1, 0, MAX_STRIDE * 2 * MAX_HEIGHT);                   \
+            memset(dst_v_0, 0, MAX_STRIDE * 2 * MAX_HEIGHT);                   \
+            memset(dst_v_1, 0, MAX_STRIDE * 2 * MAX_HEIGHT);                   \
+            call_ref(src, dst_u_0, dst_v_0, planes[i].w, planes[i].h,          \
+                     planes[i].s * 2 * bps, MAX_STRIDE * bps,                  \
+                     __VA_ARGS__);                                             \
+            call_new(src, dst_u_1, dst_v_1, planes[i].w, planes[i].h,          \
+                     planes[i].s * 2 * bps, MAX_STRIDE * bps,                  \
+                     __VA_ARGS__);                                             \
+            if (memcmp(dst_u_0, dst_u_1, MAX_STRIDE * 2 * MAX_HEIGHT) ||       \
+                memcmp(dst_v_0, dst_v_1, MAX_STRIDE * 2 * MAX_HEIGHT))         \
+                fail();                                                        \
+        }                                                                      \
+        bench_new(src, dst_u_1, dst_v_1, planes[5].w, planes[5].h,             \
+                  planes[5].s * 2 * bps, MAX_STRIDE * bps,                     \
+                  __VA_ARGS__);                                                \
+    } while (0)
+
+static void check_deinterleave(int bps)
+{
+    int i;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_STRIDE * 4 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_0, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_1, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_0, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_1, [MAX_STRIDE * 2 * MAX_HEIGHT]);
+
+    randomize_buffers(src, MAX_STRIDE * 4 * MAX_HEIGHT);
+
+    if (bps == 1) {
+        declare_func_emms(AV_CPU_FLAG_MMX, void, const uint8_t *src, uint8_t *dst1,
+                          uint8_t *dst2, int width, int height, int srcStride,
+                          int dst1Stride, int dst2Stride);
+
+        if (check_func(deinterleaveBytes, "deinterleave_bytes"))
+            CHECK_DEINTERLEAVE(MAX_STRIDE);
+    } else {
+        declare_func(void, const uint8_t *src, uint8_t *dst1,
+                     uint8_t *dst2, int width, int height, int srcStride,
+                     int dst1Stride, int dst2Stride, int shift);
+
+        if (check_func(deinterleaveWords, "deinterleave_words"))
+            CHECK_DEINTERLEAVE(MAX_STRIDE * 2, 6);
+    }
+}
+
 void checkasm_check_sw_rgb(void)
 {
     ff_sws_rgb2rgb_init();
@@ -132,4 +236,16 @@ void checkasm_check_sw_rgb(void)
 
     check_uyvy_to_422p();
     report("uyvytoyuv422");
+
+    check_interleave(1);
+    report("interleave_bytes");
+
+    check_interleave(2);
+    report("interleave_words");
+
+    check_deinterleave(1);
+    report("deinterleave_bytes");
+
+    check_deinterleave(2);
+    report("deinterleave_words");
 }
@@ -0,0 +1,352 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j+=4)       \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define SRC_PIXELS 128
+#define MAX_FILTER_WIDTH 12
+
+static void check_hscale(struct SwsContext *ctx)
+{
+    static const int filter_sizes[] = { 4, 8, 12 };
+    static const int src_bpc[]      = { 8, 9, 10, 12, 16 };
+    // the C code for high bit depth input reads the depth from the format
+    static const enum AVPixelFormat src_fmts[] = {
+        AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV420P9,  AV_PIX_FMT_YUV420P10,
+        AV_PIX_FMT_YUV420P12, AV_PIX_FMT_YUV420P16,
+    };
+    static const int dst_bpc[]      = { 8, 16 };
+    static const int widths[]       = { 8, 24, 64, SRC_PIXELS };
+    const enum AVPixelFormat src_fmt = ctx->srcFormat;
+    const int src_bits = ctx->srcBpc;
+    int i, j, sbi, fsi, bpi, wi;
+
+    // padded, 16-bit input samples are read from the same buffer
+    LOCAL_ALIGNED_32(uint16_t, src, [SRC_PIXELS * 2 + MAX_FILTER_WIDTH]);
+    LOCAL_ALIGNED_32(int32_t, dst0, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int32_t, dst1, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, filter, [SRC_PIXELS * MAX_FILTER_WIDTH]);
+    LOCAL_ALIGNED_32(int32_t, filterPos, [SRC_PIXELS]);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, SwsContext *c, int16_t *dst, int dstW,
+                      const uint8_t *src, const int16_t *filter,
+                      const int32_t *filterPos, int filterSize);
+
+    for (sbi = 0; sbi < FF_ARRAY_ELEMS(src_bpc); sbi++) {
+        const int bits = src_bpc[sbi];
+
+        if (bits == 8) {
+            randomize_buffers((uint8_t *)src, SRC_PIXELS * 2 + MAX_FILTER_WIDTH);
+        } else {
+            for (i = 0; i < SRC_PIXELS * 2 + MAX_FILTER_WIDTH; i++)
+                src[i] = rnd() & ((1 << bits) - 1);
+        }
+
+        for (bpi = 0; bpi < FF_ARRAY_ELEMS(dst_bpc); bpi++) {
+            for (fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+                const int size = filter_sizes[fsi];
+
+                for (i = 0; i < SRC_PIXELS; i++) {
+                    int sum = 0;
+
+                    filterPos[i] = rnd() % (SRC_PIXELS * 2 - size);
+                    if (bits == 8) {
+                        // small coefficients keep the sums inside the range
+                        // where the C code does not need to clip
+                        for (j = 0; j < size; j++)
+                            filter[i * size + j] = (rnd() & 0x7ff) - 0x200;
+                        continue;
+                    }
+                    // the C code only clips the positive side and the 16-bit
+                    // SIMD offsets the samples assuming a unity filter, so use
+                    // non-negative coefficients summing to 1 << 14 like sws
+                    for (j = 0; j < size - 1; j++) {
+                        filter[i * size + j] = rnd() % ((1 << 14) / size);
+                        sum += filter[i * size + j];
+                    }
+                    filter[i * size + j] = (1 << 14) - sum;
+                }
+
+                for (wi = 0; wi < FF_ARRAY_ELEMS(widths); wi++) {
+                    const int width = widths[wi];
+
+                    ctx->srcFormat      = src_fmts[sbi];
+                    ctx->srcBpc         = bits;
+                    ctx->dstBpc         = dst_bpc[bpi];
+                    ctx->hLumFilterSize = ctx->hChrFilterSize = size;
+                    ctx->dstW           = ctx->chrDstW        = width;
+                    ff_getSwsFunc(ctx);
+
+                    if (check_func(ctx->hcScale, "hscale_%d_to_%d_%d_%d", bits,
+                                   ctx->dstBpc <= 14 ? 15 : 19, size, width)) {
+                        memset(dst0, 0, SRC_PIXELS * sizeof(*dst0));
+                        memset(dst1, 0, SRC_PIXELS * sizeof(*dst1));
+
+                        call_ref(ctx, (int16_t *)dst0, width, (const uint8_t *)src,
+                                 filter, filterPos, size);
+                        call_new(ctx, (int16_t *)dst1, width, (const uint8_t *)src,
+                                 filter, filterPos, size);
+                        if (memcmp(dst0, dst1, SRC_PIXELS * sizeof(*dst0)))
+                            fail();
+                        bench_new(ctx, (int16_t *)dst0, width, (const uint8_t *)src,
+                                  filter, filterPos, size);
+                    }
+                }
+            }
+        }
+    }
+
+    ctx->srcFormat = src_fmt;
+    ctx->srcBpc    = src_bits;
+}
+
+#define LARGEST_FILTER 16
+
+static void check_yuv2planeX(struct SwsContext *ctx)
+{
+    static const int filter_sizes[] = { 2, 4, 8, 16 };
+    static const int dst_bpc[]      = { 8, 9, 10, 16 };
+    static const int offsets[]      = { 0, 3 };
+    int i, j, fsi, bpi, osi;
+
+    // large enough for the 32-bit intermediates used at 16 bits
+    LOCAL_ALIGNED_32(int32_t, src_pixels, [LARGEST_FILTER * SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, filter, [LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [SRC_PIXELS * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [SRC_PIXELS * 2]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+    const int16_t *src[LARGEST_FILTER];
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, const int16_t *filter, int filterSize,
+                      const int16_t **src, uint8_t *dest, int dstW,
+                      const uint8_t *dither, int offset);
+
+    randomize_buffers(dither, 8);
+
+    for (bpi = 0; bpi < FF_ARRAY_ELEMS(dst_bpc); bpi++) {
+        ctx->dstBpc          = dst_bpc[bpi];
+        ctx->dstFormat       = dst_bpc[bpi] == 8 ? AV_PIX_FMT_YUV420P :
+                               dst_bpc[bpi] == 9 ? AV_PIX_FMT_YUV420P9LE :
+                               dst_bpc[bpi] == 10 ? AV_PIX_FMT_YUV420P10LE :
+                                                   AV_PIX_FMT_YUV420P16LE;
+        // the inline MMX vertical scaler uses a different calling convention
+        ctx->flags          |= SWS_BITEXACT;
+        ctx->dstW            = ctx->chrDstW = SRC_PIXELS;
+        ff_getSwsFunc(ctx);
+
+        if (ctx->dstBpc == 16) {
+            for (i = 0; i < LARGEST_FILTER * SRC_PIXELS; i++)
+                src_pixels[i] = rnd() & 0x7ffff;
+            for (i = 0; i < LARGEST_FILTER; i++)
+                src[i] = (const int16_t *)(src_pixels + i * SRC_PIXELS);
+        } else {
+            int16_t *src16 = (int16_t *)src_pixels;
+            for (i = 0; i < LARGEST_FILTER * SRC_PIXELS; i++)
+                src16[i] = rnd() & 0x7fff;
+            for (i = 0; i < LARGEST_FILTER; i++)
+                src[i] = src16 + i * SRC_PIXELS;
+        }
+
+        for (fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+            const int size = filter_sizes[fsi];
+
+            for (j = 0; j < size; j++)
+                filter[j] = (rnd() & 0x3ff) - 0x100;
+
+            for (osi = 0; osi < FF_ARRAY_ELEMS(offsets); osi++) {
+                if (check_func(ctx->yuv2planeX, "yuv2planeX_%d_%d_%d",
+                               ctx->dstBpc, size, offsets[osi])) {
+                    memset(dst0, 0, SRC_PIXELS * 2);
+                    memset(dst1, 0, SRC_PIXELS * 2);
+
+                    call_ref(filter, size, src, dst0, SRC_PIXELS, dither, offsets[osi]);
+                    call_new(filter, size, src, dst1, SRC_PIXELS, dither, offsets[osi]);
+                    if (memcmp(dst0, dst1, SRC_PIXELS * (ctx->dstBpc > 8 ? 2 : 1)))
+                        fail();
+                    bench_new(filter, size, src, dst0, SRC_PIXELS, dither, offsets[osi]);
+                }
+            }
+        }
+    }
+}
+
+static void check_yuv2plane1(struct SwsContext *ctx)
+{
+    static const int dst_bpc[]      = { 8, 9, 10, 16 };
+    static const int offsets[]      = { 0, 3 };
+    int i, bpi, osi;
+
+    LOCAL_ALIGNED_32(int32_t, src, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [SRC_PIXELS * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [SRC_PIXELS * 2]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, const int16_t *src, uint8_t *dest,
+                      int dstW, const uint8_t *dither, int offset);
+
+    randomize_buffers(dither, 8);
+
+    for (bpi = 0; bpi < FF_ARRAY_ELEMS(dst_bpc); bpi++) {
+        ctx->dstBpc          = dst_bpc[bpi];
+        ctx->dstFormat       = dst_bpc[bpi] == 8 ? AV_PIX_FMT_YUV420P :
+                               dst_bpc[bpi] == 9 ? AV_PIX_FMT_YUV420P9LE :
+                               dst_bpc[bpi] == 10 ? AV_PIX_FMT_YUV420P10LE :
+                                                   AV_PIX_FMT_YUV420P16LE;
+        ctx->dstW            = ctx->chrDstW = SRC_PIXELS;
+        ff_getSwsFunc(ctx);
+
+        // include out of range values so that the clipping is exercised
+        if (ctx->dstBpc == 16) {
+            for (i = 0; i < SRC_PIXELS; i++)
+                src[i] = (rnd() & 0xfffff) - 0x40000;
+        } else {
+            int16_t *src16 = (int16_t *)src;
+            for (i = 0; i < SRC_PIXELS; i++)
+                src16[i] = (rnd() & 0x7fff) - 0x200;
+        }
+
+        for (osi = 0; osi < FF_ARRAY_ELEMS(offsets); osi++) {
+            if (check_func(ctx->yuv2plane1, "yuv2plane1_%d_%d",
+                           ctx->dstBpc, offsets[osi])) {
+                memset(dst0, 0, SRC_PIXELS * 2);
+                memset(dst1, 0, SRC_PIXELS * 2);
+
+                call_ref((const int16_t *)src, dst0, SRC_PIXELS, dither, offsets[osi]);
+                call_new((const int16_t *)src, dst1, SRC_PIXELS, dither, offsets[osi]);
+                if (memcmp(dst0, dst1, SRC_PIXELS * (ctx->dstBpc > 8 ? 2 : 1)))
+                    fail();
+                bench_new((const int16_t *)src, dst0, SRC_PIXELS, dither, offsets[osi]);
+            }
+        }
+    }
+}
+
+static void check_input_rgb(struct SwsContext *ctx)
+{
+    static const enum AVPixelFormat src_fmts[] = {
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+        AV_PIX_FMT_RGBA,  AV_PIX_FMT_BGRA,
+        AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+    };
+    int fi;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_PIXELS * 4]);
+    LOCAL_ALIGNED_32(int16_t, dst0_y, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst1_y, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst0_u, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst1_u, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst0_v, [SRC_PIXELS]);
+    LOCAL_ALIGNED_32(int16_t, dst1_v, [SRC_PIXELS]);
+
+    randomize_buffers(src, SRC_PIXELS * 4);
+
+    for (fi = 0; fi < FF_ARRAY_ELEMS(src_fmts); fi++) {
+        const char *name = av_get_pix_fmt_name(src_fmts[fi]);
+
+        ctx->srcFormat        = src_fmts[fi];
+        ctx->dstFormat        = AV_PIX_FMT_YUV444P;
+        ctx->dstBpc           = 8;
+        ctx->chrSrcHSubSample = 0;
+        ff_getSwsFunc(ctx);
+
+        {
+            declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, const uint8_t *src,
+                              const uint8_t *unused1, const uint8_t *unused2,
+                              int width, uint32_t *rgb2yuv);
+
+            if (check_func(ctx->lumToYV12, "%s_to_y", name)) {
+                memset(dst0_y, 0, SRC_PIXELS * 2);
+                memset(dst1_y, 0, SRC_PIXELS * 2);
+
+                call_ref((uint8_t *)dst0_y, src, NULL, NULL, SRC_PIXELS,
+                         ctx->input_rgb2yuv_table);
+                call_new((uint8_t *)dst1_y, src, NULL, NULL, SRC_PIXELS,
+                         ctx->input_rgb2yuv_table);
+                if (memcmp(dst0_y, dst1_y, SRC_PIXELS * 2))
+                    fail();
+                bench_new((uint8_t *)dst0_y, src, NULL, NULL, SRC_PIXELS,
+                          ctx->input_rgb2yuv_table);
+            }
+        }
+
+        {
+            declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dstU, uint8_t *dstV,
+                              const uint8_t *unused0, const uint8_t *src1,
+                              const uint8_t *src2, int width, uint32_t *rgb2yuv);
+
+            if (check_func(ctx->chrToYV12, "%s_to_uv", name)) {
+                memset(dst0_u, 0, SRC_PIXELS * 2);
+                memset(dst1_u, 0, SRC_PIXELS * 2);
+                memset(dst0_v, 0, SRC_PIXELS * 2);
+                memset(dst1_v, 0, SRC_PIXELS * 2);
+
+                call_ref((uint8_t *)dst0_u, (uint8_t *)dst0_v, NULL, src, src,
+                         SRC_PIXELS, ctx->input_rgb2yuv_table);
+                call_new((uint8_t *)dst1_u, (uint8_t *)dst1_v, NULL, src, src,
+                         SRC_PIXELS, ctx->input_rgb2yuv_table);
+                if (memcmp(dst0_u, dst1_u, SRC_PIXELS * 2) ||
+                    memcmp(dst0_v, dst1_v, SRC_PIXELS * 2))
+                    fail();
+                bench_new((uint8_t *)dst0_u, (uint8_t *)dst0_v, NULL, src, src,
+                          SRC_PIXELS, ctx->input_rgb2yuv_table);
+            }
+        }
+    }
+}
+
+void checkasm_check_sw_scale(void)
+{
+    struct SwsContext *ctx = sws_alloc_context();
+
+    if (!ctx || sws_init_context(ctx, NULL, NULL) < 0) {
+        fail();
+        goto end;
+    }
+
+    check_hscale(ctx);
+    report("hscale");
+
+    check_yuv2planeX(ctx);
+    report("yuv2planeX");
+
+    check_yuv2plane1(ctx);
+    report("yuv2plane1");
+
+    check_input_rgb(ctx);
+    report("input_rgb");
+
+end:
+    sws_freeContext(ctx);
+}
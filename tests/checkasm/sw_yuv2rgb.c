@@ -0,0 +1,160 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j+=4)       \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define WIDTH  128
+#define HEIGHT 16
+#define DST_STRIDE (WIDTH * 4 + 32)
+
+static const enum AVPixelFormat src_fmts[] = {
+    AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P,
+};
+
+static const enum AVPixelFormat dst_fmts[] = {
+    AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24, AV_PIX_FMT_RGB32, AV_PIX_FMT_BGR32,
+};
+
+/* the x86 converters use lower precision coefficients than the C code */
+static int cmp_off_by_n(const uint8_t *ref, const uint8_t *test, int n, int accuracy)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (abs(ref[i] - test[i]) > accuracy)
+            return 1;
+    return 0;
+}
+
+/* the converters may adjust the strides they are given */
+static void setup_strides(int src_stride[4], int dst_stride[4], uint8_t *dst[4],
+                          uint8_t *out)
+{
+    src_stride[0] = WIDTH;
+    src_stride[1] = src_stride[2] = WIDTH / 2;
+    src_stride[3] = 0;
+    dst_stride[0] = DST_STRIDE;
+    dst_stride[1] = dst_stride[2] = dst_stride[3] = 0;
+    dst[0] = out;
+    dst[1] = dst[2] = dst[3] = NULL;
+}
+
+static void check_yuv2rgb(enum AVPixelFormat src_fmt)
+{
+    const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get(src_fmt);
+    const int chroma_h = HEIGHT >> src_desc->log2_chroma_h;
+    int i, y, log_level;
+
+    LOCAL_ALIGNED_32(uint8_t, src_y, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, src_u, [WIDTH / 2 * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, src_v, [WIDTH / 2 * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_STRIDE * HEIGHT]);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, SwsContext *c, const uint8_t *src[],
+                      int srcStride[], int srcSliceY, int srcSliceH,
+                      uint8_t *dst[], int dstStride[]);
+
+    randomize_buffers(src_y, WIDTH * HEIGHT);
+    randomize_buffers(src_u, WIDTH / 2 * chroma_h);
+    randomize_buffers(src_v, WIDTH / 2 * chroma_h);
+    /* the C converters share one chroma line between two luma lines even
+     * for 4:2:2, so frames which differ between line pairs would not match */
+    if (chroma_h == HEIGHT) {
+        for (y = 0; y < HEIGHT; y += 2) {
+            memcpy(src_u + (y + 1) * WIDTH / 2, src_u + y * WIDTH / 2, WIDTH / 2);
+            memcpy(src_v + (y + 1) * WIDTH / 2, src_v + y * WIDTH / 2, WIDTH / 2);
+        }
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(dst_fmts); i++) {
+        const enum AVPixelFormat dst_fmt = dst_fmts[i];
+        const int bpp = av_get_padded_bits_per_pixel(av_pix_fmt_desc_get(dst_fmt)) >> 3;
+        struct SwsContext *ctx;
+        SwsFunc func;
+
+        /* silence the warning about a missing accelerated converter */
+        log_level = av_log_get_level();
+        av_log_set_level(AV_LOG_ERROR);
+        ctx = sws_getContext(WIDTH, HEIGHT, src_fmt, WIDTH, HEIGHT, dst_fmt,
+                             SWS_BILINEAR, NULL, NULL, NULL);
+        func = ctx ? ff_yuv2rgb_get_func_ptr(ctx) : NULL;
+        av_log_set_level(log_level);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+
+        if (check_func(func, "yuv2rgb_%s_%s", av_get_pix_fmt_name(src_fmt),
+                       av_get_pix_fmt_name(dst_fmt))) {
+            const uint8_t *src[4] = { src_y, src_u, src_v, NULL };
+            int src_stride[4], dst_stride[4];
+            uint8_t *dst[4];
+
+            memset(dst0, 0, DST_STRIDE * HEIGHT);
+            memset(dst1, 0, DST_STRIDE * HEIGHT);
+
+            setup_strides(src_stride, dst_stride, dst, dst0);
+            call_ref(ctx, src, src_stride, 0, HEIGHT, dst, dst_stride);
+            setup_strides(src_stride, dst_stride, dst, dst1);
+            call_new(ctx, src, src_stride, 0, HEIGHT, dst, dst_stride);
+
+            for (y = 0; y < HEIGHT; y++)
+                if (cmp_off_by_n(dst0 + y * DST_STRIDE, dst1 + y * DST_STRIDE,
+                                 WIDTH * bpp, 3))
+                    fail();
+
+            /* the C 4:2:2 converters double the chroma strides on every
+             * call, so they cannot be called repeatedly with the same ones */
+            if (chroma_h != HEIGHT) {
+                setup_strides(src_stride, dst_stride, dst, dst1);
+                bench_new(ctx, src, src_stride, 0, HEIGHT, dst, dst_stride);
+            }
+        }
+
+        sws_freeContext(ctx);
+    }
+}
+
+void checkasm_check_sw_yuv2rgb(void)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(src_fmts); i++) {
+        check_yuv2rgb(src_fmts[i]);
+        report("%s", av_get_pix_fmt_name(src_fmts[i]));
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/bwdif.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#define WIDTH  512
+/* in pixels; the SIMD functions may process a few pixels past the width */
+#define STRIDE (WIDTH + 64)
+/* the filtered line has four lines of context above and below it */
+#define LINES  9
+#define OFFSET (4 * STRIDE)
+
+static const int widths[] = { 1, 7, 8, 9, 31, 32, 33, WIDTH };
+
+static void randomize_plane(uint8_t *buf, int depth)
+{
+    const int mask = (1 << depth) - 1;
+    int i;
+
+    for (i = 0; i < STRIDE * LINES; i++) {
+        if (depth > 8)
+            AV_WN16A(buf + 2 * i, rnd() & mask);
+        else
+            buf[i] = rnd() & mask;
+    }
+}
+
+static void check_bwdif(enum AVPixelFormat fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    const int depth = desc->comp[0].depth;
+    const int df = (depth + 7) / 8;
+    const int clip_max = (1 << depth) - 1;
+    const int r = STRIDE;
+    LOCAL_ALIGNED_32(uint8_t, prev, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, cur,  [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, next, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [STRIDE * 2]);
+    uint8_t *p = prev + OFFSET * df, *c = cur + OFFSET * df, *n = next + OFFSET * df;
+    BWDIFContext s = { { 0 } };
+    int i, parity, spat;
+
+    randomize_plane(prev, depth);
+    randomize_plane(cur,  depth);
+    randomize_plane(next, depth);
+
+    s.yadif.csp = desc;
+    ff_bwdif_init(&s);
+
+    {
+        declare_func(void, void *dst, void *prev, void *cur, void *next,
+                     int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                     int prefs3, int mrefs3, int prefs4, int mrefs4,
+                     int parity, int clip_max);
+
+        if (check_func(s.filter_line, "bwdif_filter_line_%d", depth)) {
+            for (parity = 0; parity < 2; parity++) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    memset(dst0, 0, STRIDE * 2);
+                    memset(dst1, 0, STRIDE * 2);
+                    call_ref(dst0, p, c, n, widths[i], r, -r, 2 * r, -2 * r,
+                             3 * r, -3 * r, 4 * r, -4 * r, parity, clip_max);
+                    call_new(dst1, p, c, n, widths[i], r, -r, 2 * r, -2 * r,
+                             3 * r, -3 * r, 4 * r, -4 * r, parity, clip_max);
+                    if (memcmp(dst0, dst1, widths[i] * df))
+                        fail();
+                }
+            }
+            bench_new(dst1, p, c, n, WIDTH, r, -r, 2 * r, -2 * r,
+                      3 * r, -3 * r, 4 * r, -4 * r, 0, clip_max);
+        }
+    }
+
+    {
+        declare_func(void, void *dst, void *prev, void *cur, void *next,
+                     int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                     int parity, int clip_max, int spat);
+
+        if (check_func(s.filter_edge, "bwdif_filter_edge_%d", depth)) {
+            for (parity = 0; parity < 2; parity++) {
+                for (spat = 0; spat < 2; spat++) {
+                    memset(dst0, 0, STRIDE * 2);
+                    memset(dst1, 0, STRIDE * 2);
+                    call_ref(dst0, p, c, n, WIDTH, r, -r, 2 * r, -2 * r,
+                             parity, clip_max, spat);
+                    call_new(dst1, p, c, n, WIDTH, r, -r, 2 * r, -2 * r,
+                             parity, clip_max, spat);
+                    if (memcmp(dst0, dst1, WIDTH * df))
+                        fail();
+                }
+            }
+            bench_new(dst1, p, c, n, WIDTH, r, -r, 2 * r, -2 * r,
+                      0, clip_max, 1);
+        }
+    }
+
+    {
+        declare_func(void, void *dst, void *cur, int w, int prefs, int mrefs,
+                     int prefs3, int mrefs3, int parity, int clip_max);
+
+        if (check_func(s.filter_intra, "bwdif_filter_intra_%d", depth)) {
+            memset(dst0, 0, STRIDE * 2);
+            memset(dst1, 0, STRIDE * 2);
+            call_ref(dst0, c, WIDTH, r, -r, 3 * r, -3 * r, 0, clip_max);
+            call_new(dst1, c, WIDTH, r, -r, 3 * r, -3 * r, 0, clip_max);
+            if (memcmp(dst0, dst1, WIDTH * df))
+                fail();
+            bench_new(dst1, c, WIDTH, r, -r, 3 * r, -3 * r, 0, clip_max);
+        }
+    }
+}
+
+void checkasm_check_vf_bwdif(void)
+{
+    check_bwdif(AV_PIX_FMT_YUV420P);
+    report("bwdif_8");
+
+    check_bwdif(AV_PIX_FMT_YUV420P10);
+    report("bwdif_10");
+
+    check_bwdif(AV_PIX_FMT_YUV420P12);
+    report("bwdif_12");
+
+    check_bwdif(AV_PIX_FMT_YUV420P16);
+    report("bwdif_16");
+}
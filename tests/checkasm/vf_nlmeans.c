@@ -109,5 +109,50 @@ void checkasm_check_nlmeans(void)
         av_freep(&src);
     }
 
+    if (check_func(dsp.compute_weights_line, "weights_line")) {
+#define LUT_SIZE 256
+#define LINE_W   200
+        const int startx = 3;
+        const int endx   = LINE_W - 5;
+        uint32_t iia[LINE_W], iib[LINE_W], iid[LINE_W], iie[LINE_W];
+        uint8_t src[LINE_W + 32];
+        float weight_lut[LUT_SIZE];
+        float total_weight_ref[LINE_W], sum_ref[LINE_W];
+        float total_weight_new[LINE_W], sum_new[LINE_W];
+        int i;
+
+        declare_func(void, const uint32_t *iia, const uint32_t *iib,
+                     const uint32_t *iid, const uint32_t *iie,
+                     const uint8_t *src, float *total_weight, float *sum,
+                     const float *weight_lut, int max_meaningful_diff,
+                     int startx, int endx);
+
+        randomize_buffer(src, sizeof(src));
+        for (i = 0; i < LUT_SIZE; i++)
+            weight_lut[i] = (rnd() & 0xffff) / 65535.f;
+        for (i = 0; i < LINE_W; i++) {
+            /* half of the patch differences are out of the lookup table */
+            iia[i] = rnd();
+            iib[i] = rnd();
+            iid[i] = rnd();
+            iie[i] = iid[i] + iib[i] - iia[i] + rnd() % (2 * LUT_SIZE);
+            total_weight_ref[i] = total_weight_new[i] = (rnd() & 0xffff) / 256.f;
+            sum_ref[i]          = sum_new[i]          = (rnd() & 0xffff) / 2.f;
+        }
+
+        call_ref(iia, iib, iid, iie, src, total_weight_ref, sum_ref,
+                 weight_lut, LUT_SIZE, startx, endx);
+        call_new(iia, iib, iid, iie, src, total_weight_new, sum_new,
+                 weight_lut, LUT_SIZE, startx, endx);
+        if (memcmp(total_weight_ref, total_weight_new, sizeof(total_weight_ref)) ||
+            memcmp(sum_ref, sum_new, sizeof(sum_ref)))
+            fail();
+
+        bench_new(iia, iib, iid, iie, src, total_weight_new, sum_new,
+                  weight_lut, LUT_SIZE, startx, endx);
+#undef LUT_SIZE
+#undef LINE_W
+    }
+
     report("dsp");
 }
@@ -0,0 +1,87 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/vf_overlay.h"
+#include "libavutil/mem.h"
+
+#define WIDTH 1024
+/* the 4:2:0 row reads two lines of alpha */
+#define ALINESIZE (2 * WIDTH + 64)
+
+/* the subsampled rows leave the last pixel to the caller, so widths for them
+ * are odd to keep the number of blended pixels a multiple of the SIMD width */
+static const int widths_44[] = { 8, 16, 64, WIDTH };
+static const int widths_sub[] = { 9, 17, 65, WIDTH / 2 + 1 };
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void check_blend_row(OverlayContext *s, int plane, const int *widths,
+                            const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [WIDTH + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [WIDTH + 64]);
+    LOCAL_ALIGNED_32(uint8_t, src,  [WIDTH + 64]);
+    LOCAL_ALIGNED_32(uint8_t, alpha, [2 * ALINESIZE]);
+    int i;
+
+    declare_func(int, uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a, int w,
+                 ptrdiff_t alinesize);
+
+    if (!check_func(s->blend_row[plane], "overlay_row_%s", name))
+        return;
+
+    randomize_buffer(src, WIDTH + 64);
+    randomize_buffer(alpha, 2 * ALINESIZE);
+
+    for (i = 0; i < 4; i++) {
+        int ret0, ret1;
+
+        randomize_buffer(dst0, WIDTH + 64);
+        memcpy(dst1, dst0, WIDTH + 64);
+        ret0 = call_ref(dst0, NULL, src, alpha, widths[i], ALINESIZE);
+        ret1 = call_new(dst1, NULL, src, alpha, widths[i], ALINESIZE);
+        if (ret0 != ret1 || memcmp(dst0, dst1, ret0))
+            fail();
+    }
+    bench_new(dst1, NULL, src, alpha, widths[3], ALINESIZE);
+}
+
+void checkasm_check_vf_overlay(void)
+{
+    OverlayContext s;
+
+    ff_overlay_init(&s, OVERLAY_FORMAT_YUV444, AV_PIX_FMT_YUV444P, 0, 0);
+    check_blend_row(&s, 0, widths_44, "44");
+    report("overlay_row_44");
+
+    ff_overlay_init(&s, OVERLAY_FORMAT_YUV422, AV_PIX_FMT_YUV422P, 0, 0);
+    check_blend_row(&s, 1, widths_sub, "22");
+    report("overlay_row_22");
+
+    ff_overlay_init(&s, OVERLAY_FORMAT_YUV420, AV_PIX_FMT_YUV420P, 0, 0);
+    check_blend_row(&s, 1, widths_sub, "20");
+    report("overlay_row_20");
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/ssim.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#define WIDTH  1024
+#define STRIDE (WIDTH + 32)
+#define BLOCKS (WIDTH / 4)
+/* the SIMD functions may process a few blocks past the requested width */
+#define SUMS   (BLOCKS + 8)
+
+static const int widths[] = { 1, 3, 4, 5, 15, 16, 17, 63, BLOCKS - 1 };
+
+/* sums of random 4x4 blocks of 8-bit pixels, as ssim_4x4_line() returns them */
+static void randomize_sums(int (*sums)[4], int n)
+{
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+        int s1 = 0, s2 = 0, ss = 0, s12 = 0;
+
+        for (j = 0; j < 16; j++) {
+            int a = rnd() & 0xff;
+            int b = av_clip_uint8(a + (int)(rnd() % 33) - 16);
+
+            s1  += a;
+            s2  += b;
+            ss  += a * a + b * b;
+            s12 += a * b;
+        }
+        sums[i][0] = s1;
+        sums[i][1] = s2;
+        sums[i][2] = ss;
+        sums[i][3] = s12;
+    }
+}
+
+static void check_ssim_4x4_line(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [STRIDE * 4]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [STRIDE * 4]);
+    LOCAL_ALIGNED_32(int, sums0, [SUMS * 4]);
+    LOCAL_ALIGNED_32(int, sums1, [SUMS * 4]);
+    SSIMDSPContext dsp;
+    int i;
+
+    declare_func(void, const uint8_t *buf, ptrdiff_t buf_stride,
+                 const uint8_t *ref, ptrdiff_t ref_stride,
+                 int (*sums)[4], int w);
+
+    for (i = 0; i < STRIDE * 4; i++) {
+        buf[i] = rnd();
+        ref[i] = rnd();
+    }
+
+    ff_ssim_init(&dsp);
+
+    if (check_func(dsp.ssim_4x4_line, "ssim_4x4_line")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            memset(sums0, 0, SUMS * 4 * sizeof(*sums0));
+            memset(sums1, 0, SUMS * 4 * sizeof(*sums1));
+            call_ref(buf, STRIDE, ref, STRIDE, (int (*)[4])sums0, widths[i]);
+            call_new(buf, STRIDE, ref, STRIDE, (int (*)[4])sums1, widths[i]);
+            if (memcmp(sums0, sums1, widths[i] * 4 * sizeof(*sums0)))
+                fail();
+        }
+        bench_new(buf, STRIDE, ref, STRIDE, (int (*)[4])sums1, BLOCKS);
+    }
+}
+
+static void check_ssim_end_line(void)
+{
+    LOCAL_ALIGNED_32(int, sum0, [SUMS * 4]);
+    LOCAL_ALIGNED_32(int, sum1, [SUMS * 4]);
+    SSIMDSPContext dsp;
+    float ssim0, ssim1;
+    int i;
+
+    declare_func(float, const int (*sum0)[4], const int (*sum1)[4], int w);
+
+    randomize_sums((int (*)[4])sum0, SUMS);
+    randomize_sums((int (*)[4])sum1, SUMS);
+
+    ff_ssim_init(&dsp);
+
+    if (check_func(dsp.ssim_end_line, "ssim_end_line")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            ssim0 = call_ref((const int (*)[4])sum0, (const int (*)[4])sum1, widths[i]);
+            ssim1 = call_new((const int (*)[4])sum0, (const int (*)[4])sum1, widths[i]);
+            if (!float_near_abs_eps(ssim0, ssim1, 1e-4 * widths[i]))
+                fail();
+        }
+        bench_new((const int (*)[4])sum0, (const int (*)[4])sum1, BLOCKS - 1);
+    }
+}
+
+void checkasm_check_vf_ssim(void)
+{
+    check_ssim_4x4_line();
+    report("ssim_4x4_line");
+
+    check_ssim_end_line();
+    report("ssim_end_line");
+}
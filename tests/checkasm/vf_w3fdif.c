@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/w3fdif.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#define WIDTH  512
+/* in pixels; the SIMD functions may process a few pixels past the width */
+#define STRIDE (WIDTH + 64)
+#define LINES  5
+
+static const int widths[] = { 1, 7, 16, 33, WIDTH };
+
+static const int16_t coef_lf[2][4] = {{ 16384, 16384,     0,    0},
+                                      {  -852, 17236, 17236, -852}};
+static const int16_t coef_hf[2][5] = {{ -2048,  4096, -2048,     0,    0},
+                                      {  1016, -3801,  5570, -3801, 1016}};
+
+static void randomize_lines(uint8_t *buf, int depth)
+{
+    const int mask = (1 << depth) - 1;
+    int i;
+
+    for (i = 0; i < STRIDE * LINES; i++) {
+        if (depth > 8)
+            AV_WN16A(buf + 2 * i, rnd() & mask);
+        else
+            buf[i] = rnd() & mask;
+    }
+}
+
+static void randomize_work(int32_t *work, int depth)
+{
+    int i;
+
+    for (i = 0; i < STRIDE; i++)
+        work[i] = (int32_t)rnd() >> (24 - depth);
+}
+
+static void check_w3fdif(int depth)
+{
+    const int df = (depth + 7) / 8;
+    const int max = ((1 << depth) - 1) * 256 * 128;
+    LOCAL_ALIGNED_32(uint8_t, cur, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, adj, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(int32_t, work0, [STRIDE]);
+    LOCAL_ALIGNED_32(int32_t, work1, [STRIDE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [STRIDE * 2]);
+    uint8_t *lines_cur[5], *lines_adj[5];
+    W3FDIFDSPContext dsp;
+    int i, j;
+
+    randomize_lines(cur, depth);
+    randomize_lines(adj, depth);
+    for (j = 0; j < 5; j++) {
+        lines_cur[j] = cur + j * STRIDE * df;
+        lines_adj[j] = adj + j * STRIDE * df;
+    }
+
+    ff_w3fdif_init(&dsp, depth);
+
+#define CHECK_LOW(name, n)                                                      \
+    {                                                                           \
+        declare_func(void, int32_t *work_line, uint8_t *in_lines_cur[n],        \
+                     const int16_t *coef, int linesize);                        \
+                                                                                \
+        if (check_func(dsp.filter_##name##_low, "w3fdif_" #name "_low_%d",      \
+                       depth)) {                                                \
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {                      \
+                uint8_t *in0[5], *in1[5];                                       \
+                memcpy(in0, lines_cur, sizeof(in0));                            \
+                memcpy(in1, lines_cur, sizeof(in1));                            \
+                call_ref(work0, in0, coef_lf[n == 4], widths[i] * df);          \
+                call_new(work1, in1, coef_lf[n == 4], widths[i] * df);          \
+                if (memcmp(work0, work1, widths[i] * sizeof(*work0)))           \
+                    fail();                                                     \
+            }                                                                   \
+            bench_new(work1, lines_cur, coef_lf[n == 4], WIDTH * df);           \
+        }                                                                       \
+    }
+
+#define CHECK_HIGH(name, n)                                                     \
+    {                                                                           \
+        declare_func(void, int32_t *work_line, uint8_t *in_lines_cur[n],        \
+                     uint8_t *in_lines_adj[n], const int16_t *coef,             \
+                     int linesize);                                             \
+                                                                                \
+        if (check_func(dsp.filter_##name##_high, "w3fdif_" #name "_high_%d",    \
+                       depth)) {                                                \
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {                      \
+                uint8_t *in0[5], *in1[5], *adj0[5], *adj1[5];                   \
+                memcpy(in0,  lines_cur, sizeof(in0));                           \
+                memcpy(in1,  lines_cur, sizeof(in1));                           \
+                memcpy(adj0, lines_adj, sizeof(adj0));                          \
+                memcpy(adj1, lines_adj, sizeof(adj1));                          \
+                randomize_work(work0, depth);                                   \
+                memcpy(work1, work0, STRIDE * sizeof(*work0));                  \
+                call_ref(work0, in0, adj0, coef_hf[n == 5], widths[i] * df);    \
+                call_new(work1, in1, adj1, coef_hf[n == 5], widths[i] * df);    \
+                if (memcmp(work0, work1, widths[i] * sizeof(*work0)))           \
+                    fail();                                                     \
+            }                                                                   \
+            bench_new(work1, lines_cur, lines_adj, coef_hf[n == 5], WIDTH * df);\
+        }                                                                       \
+    }
+
+    CHECK_LOW(simple, 2)
+    CHECK_LOW(complex, 4)
+    CHECK_HIGH(simple, 3)
+    CHECK_HIGH(complex, 5)
+
+    {
+        declare_func(void, uint8_t *out_pixel, const int32_t *work_pixel,
+                     int linesize, int max);
+
+        if (check_func(dsp.filter_scale, "w3fdif_scale_%d", depth)) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                for (j = 0; j < STRIDE; j++)
+                    work0[j] = (int32_t)rnd() >> (15 - depth);
+                memset(dst0, 0, STRIDE * 2);
+                memset(dst1, 0, STRIDE * 2);
+                call_ref(dst0, work0, widths[i] * df, max);
+                call_new(dst1, work0, widths[i] * df, max);
+                if (memcmp(dst0, dst1, widths[i] * df))
+                    fail();
+            }
+            bench_new(dst1, work0, WIDTH * df, max);
+        }
+    }
+}
+
+void checkasm_check_vf_w3fdif(void)
+{
+    check_w3fdif(8);
+    report("w3fdif_8");
+
+    check_w3fdif(12);
+    report("w3fdif_12");
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/yadif.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#define WIDTH  512
+/* in pixels; the SIMD functions may process a few pixels past the width */
+#define STRIDE (WIDTH + 64)
+/* the filtered line has two lines of context above and below it */
+#define LINES  5
+#define OFFSET (2 * STRIDE + 16)
+
+static const int widths[] = { 1, 7, 8, 9, 31, 32, 33, WIDTH - 6 };
+
+static void randomize_plane(uint8_t *buf, int depth)
+{
+    const int mask = (1 << depth) - 1;
+    int i;
+
+    for (i = 0; i < STRIDE * LINES; i++) {
+        if (depth > 8)
+            AV_WN16A(buf + 2 * i, rnd() & mask);
+        else
+            buf[i] = rnd() & mask;
+    }
+}
+
+static void check_yadif(enum AVPixelFormat fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    const int depth = desc->comp[0].depth;
+    const int df = (depth + 7) / 8;
+    const int refs = STRIDE * df;
+    LOCAL_ALIGNED_32(uint8_t, prev, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, cur,  [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, next, [STRIDE * LINES * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [STRIDE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [STRIDE * 2]);
+    uint8_t *p = prev + OFFSET * df, *c = cur + OFFSET * df, *n = next + OFFSET * df;
+    YADIFContext s = { 0 };
+    int i, parity, mode;
+
+    declare_func(void, void *dst, void *prev, void *cur, void *next,
+                 int w, int prefs, int mrefs, int parity, int mode);
+
+    randomize_plane(prev, depth);
+    randomize_plane(cur,  depth);
+    randomize_plane(next, depth);
+
+    s.csp = desc;
+    ff_yadif_init(&s);
+
+    if (check_func(s.filter_line, "yadif_filter_line_%d", depth)) {
+        for (parity = 0; parity < 2; parity++) {
+            for (mode = 0; mode < 4; mode += 2) {
+                for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                    memset(dst0, 0, STRIDE * 2);
+                    memset(dst1, 0, STRIDE * 2);
+                    call_ref(dst0, p, c, n, widths[i], refs, -refs, parity, mode);
+                    call_new(dst1, p, c, n, widths[i], refs, -refs, parity, mode);
+                    if (memcmp(dst0, dst1, widths[i] * df))
+                        fail();
+                }
+            }
+        }
+        bench_new(dst1, p, c, n, WIDTH - 6, refs, -refs, 0, 0);
+    }
+
+    if (check_func(s.filter_edges, "yadif_filter_edges_%d", depth)) {
+        for (parity = 0; parity < 2; parity++) {
+            memset(dst0, 0, STRIDE * 2);
+            memset(dst1, 0, STRIDE * 2);
+            call_ref(dst0, p, c, n, WIDTH, refs, -refs, parity, 0);
+            call_new(dst1, p, c, n, WIDTH, refs, -refs, parity, 0);
+            if (memcmp(dst0, dst1, WIDTH * df))
+                fail();
+        }
+        bench_new(dst1, p, c, n, WIDTH, refs, -refs, 0, 0);
+    }
+}
+
+void checkasm_check_vf_yadif(void)
+{
+    check_yadif(AV_PIX_FMT_YUV420P);
+    report("yadif_8");
+
+    check_yadif(AV_PIX_FMT_YUV420P10);
+    report("yadif_10");
+
+    check_yadif(AV_PIX_FMT_YUV420P16);
+    report("yadif_16");
+}
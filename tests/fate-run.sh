@@ -243,6 +243,58 @@ stream_remux(){
         -f framecrc - || return
 }
 
+mov_index_cache(){
+    encfile="${outdir}/${test}.mov"
+    cachedir="${outdir}/${test}.cache"
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$cleanfiles $encfile $logfile ${outdir}/${test}.1.crc ${outdir}/${test}.2.crc"
+    tencfile=$(target_path $encfile)
+    tcachedir=$(target_path $cachedir)
+    rm -rf $cachedir && mkdir -p $cachedir || return
+    ffmpeg -f lavfi -i "testsrc=s=64x48:r=25:d=2" -f lavfi -i "sine=d=2" \
+        -c:v mpeg4 -c:a pcm_s16le -flags +bitexact -fflags +bitexact -f mov -y $tencfile || return
+    # the first pass stores the index, the second one must read it back
+    ffmpeg -index_cache $tcachedir -i $tencfile -c copy -bitexact \
+        -f framecrc -y $(target_path ${outdir}/${test}.1.crc) || return
+    ffmpeg -v verbose -index_cache $tcachedir -i $tencfile -c copy -bitexact \
+        -f framecrc -y $(target_path ${outdir}/${test}.2.crc) 2> $logfile || return
+    rm -rf $cachedir
+    grep -q "Using index cache" $logfile || { echo "index cache not used"; return 1; }
+    cmp ${outdir}/${test}.1.crc ${outdir}/${test}.2.crc || return
+    cat ${outdir}/${test}.2.crc
+}
+
+hls_part_playlist(){
+    srcfile="${outdir}/${test}.ts"
+    listfile="${outdir}/${test}.txt"
+    hlsdir="${outdir}/${test}.hls"
+    cleanfiles="$cleanfiles $srcfile $listfile"
+    rm -rf $hlsdir && mkdir -p $hlsdir || return
+    ffmpeg -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=10" \
+        -codec:a mp2fixed -flags +bitexact -fflags +bitexact -f mpegts -y $(target_path $srcfile) || return
+    # the second input is missing, so ffmpeg bails out before the trailer
+    # and the playlist is left as a live client would see it
+    printf "file '%s'\nfile '%s'\n" $(target_path $srcfile) $(target_path ${outdir}/${test}.missing.ts) > $listfile
+    ffmpeg -xerror -f concat -safe 0 -i $(target_path $listfile) -c copy -f hls \
+        -hls_time 3 -hls_part_time 1 -hls_list_size 0 \
+        -hls_segment_filename $(target_path $hlsdir)/out_%d.ts $(target_path $hlsdir)/out.m3u8 2>/dev/null
+    awk -F'[:=,]' '
+        /^#EXT-X-PART-INF:/     { target = $3 }
+        /^#EXT-X-PART:/         { parts++; sum += $3
+                                  if ($3 <= 0 || $3 > target) { print "bad part duration: " $0; bad = 1 } }
+        /^#EXTINF:/             { segs++
+                                  if (sum - $2 > 0.001 || $2 - sum > 0.001) { print "parts do not add up: " $0; bad = 1 }
+                                  sum = 0 }
+        /^#EXT-X-PRELOAD-HINT:/ { hints++ }
+        /^#EXT-X-ENDLIST/       { print "unexpected endlist"; bad = 1 }
+        { print }
+        END { printf "segments %d parts %d preload hints %d\n", segs, parts, hints
+              exit bad || !parts || hints != 1 }' $hlsdir/out.m3u8
+    ret=$?
+    rm -rf $hlsdir
+    return $ret
+}
+
 # FIXME: There is a certain duplication between the avconv-related helper
 # functions above and below that should be refactored.
 ffmpeg2="$target_exec ${target_path}/ffmpeg${PROGSUF}${EXECSUF}"
@@ -482,6 +534,42 @@ null(){
     :
 }
 
+# Run an ffmpeg command $PERF_RUNS times and compare the lowest CPU time
+# against the baseline of this machine, which is recorded when missing or
+# when PERF_UPDATE is set.
+perf(){
+    benchfile="${outdir}/${test}.bench"
+    baseline="${PERF_BASELINE}/${test}"
+    cleanfiles="$cleanfiles $benchfile"
+    best=
+    i=0
+    while [ $i -lt ${PERF_RUNS:-5} ]; do
+        ffmpeg -benchmark "$@" -f null - 2>"$benchfile" || { cat "$benchfile"; return 1; }
+        time=$(sed -n 's/^bench: utime=\([0-9.]*\)s stime=\([0-9.]*\)s.*/\1 \2/p' "$benchfile" |
+               awk '{ print $1 + $2 }')
+        test -n "$time" || { echo "no benchmark output"; return 1; }
+        if [ -z "$best" ] || [ $(awk "BEGIN { print ($time < $best) }") = 1 ]; then
+            best=$time
+        fi
+        i=$((i + 1))
+    done
+
+    if [ "${PERF_UPDATE:-0}" != 0 ] || ! test -e "$baseline"; then
+        mkdir -p "$PERF_BASELINE" && echo $best >"$baseline" || return
+        echo "time ${best}s, recorded as baseline"
+        return 0
+    fi
+
+    awk -v cur=$best -v threshold=${PERF_THRESHOLD:-10} '{
+        change = $1 > 0 ? (cur - $1) * 100 / $1 : 0
+        printf "time %.3fs, baseline %.3fs (%+.1f%%)\n", cur, $1, change
+        if (change > threshold) {
+            printf "slower than the baseline by more than %s%%\n", threshold
+            exit 1
+        }
+    }' "$baseline"
+}
+
 # Disable globbing: command arguments may contain globbing characters and
 # must be kept verbatim
 set -f
@@ -34,6 +34,11 @@ fate-api-threadmessage: $(APITESTSDIR)/api-threadmessage-test$(EXESUF)
 fate-api-threadmessage: CMD = run $(APITESTSDIR)/api-threadmessage-test$(EXESUF) 3 10 30 50 2 20 40
 fate-api-threadmessage: CMP = null
 
+FATE_API-$(HAVE_THREADS) += fate-api-threadmessage-spsc
+fate-api-threadmessage-spsc: $(APITESTSDIR)/api-threadmessage-test$(EXESUF)
+fate-api-threadmessage-spsc: CMD = run $(APITESTSDIR)/api-threadmessage-test$(EXESUF) 3 1 300 500 1 200 400 spsc
+fate-api-threadmessage-spsc: CMP = null
+
 FATE_API_SAMPLES-$(CONFIG_AVFORMAT) += $(FATE_API_SAMPLES_LIBAVFORMAT-yes)
 
 ifdef SAMPLES
@@ -0,0 +1,17 @@
+# Frame-threaded FFV1. The files are encoded with keyframes every 7 frames,
+# so the decoder threads carry the range coder states and context models
+# from one frame to the next.
+FATE_FFV1-$(call ENCDEC, FFV1, NUT) += fate-ffv1-v1-frame-threads
+fate-ffv1-v1-frame-threads: CMD = threads=2 thread_type=frame transcode "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv nut "-c:v ffv1 -level 1 -g 7 -context 1" ""
+
+FATE_FFV1-$(call ENCDEC, FFV1, NUT) += fate-ffv1-v3-frame-threads
+fate-ffv1-v3-frame-threads: CMD = threads=2 thread_type=frame transcode "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv nut "-c:v ffv1 -level 3 -g 7 -slices 4 -slicecrc 1" ""
+
+# Every frame is a keyframe, so the encoder runs frame-threaded too.
+FATE_FFV1-$(call ENCDEC, FFV1, NUT) += fate-ffv1-v3-intra-frame-threads
+fate-ffv1-v3-intra-frame-threads: CMD = threads=2 thread_type=frame transcode "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv nut "-c:v ffv1 -level 3 -g 1 -slices 4 -threads 2 -thread_type frame" ""
+
+$(FATE_FFV1-yes): tests/data/vsynth1.yuv
+
+FATE_FFMPEG += $(FATE_FFV1-yes)
+fate-ffv1: $(FATE_FFV1-yes)
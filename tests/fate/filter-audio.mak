@@ -397,6 +397,10 @@ FATE_AFILTER-yes += fate-filter-formats
 fate-filter-formats: libavfilter/tests/formats$(EXESUF)
 fate-filter-formats: CMD = run libavfilter/tests/formats$(EXESUF)
 
+FATE_AFILTER-$(call ALLYES, SINE_FILTER AFORMAT_FILTER ARESAMPLE_FILTER AMERGE_FILTER PAN_FILTER) += fate-filter-graphtemplate
+fate-filter-graphtemplate: libavfilter/tests/graphtemplate$(EXESUF)
+fate-filter-graphtemplate: CMD = run libavfilter/tests/graphtemplate$(EXESUF) "sine=f=440:d=0.5,aformat=channel_layouts=stereo[a];sine=f=880:d=0.5:sample_rate=22050[b];[a][b]amerge,pan=stereo|c0=c2|c1=0.5*c0+0.5*c1,aformat=s16:44100,abuffersink@out" abuffersink@out
+
 FATE_SAMPLES_AVCONV += $(FATE_AFILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_AFILTER-yes)
 fate-afilter: $(FATE_AFILTER-yes) $(FATE_AFILTER_SAMPLES-yes)
@@ -256,6 +256,13 @@ fate-filter-overlay_gbrap_gbrap:     FILTER = "format=gbrap[over];color=black:12
 
 FATE_FILTER_SAMPLES-$(call ALLYES, PNG_DECODER APNG_DEMUXER FORMAT_FILTER COLOR_FILTER OVERLAY_FILTER) += $(FATE_FILTER_OVERLAY_ALPHA)
 
+# overlays with fully transparent borders, cropped to their visible part
+FATE_FILTER_OVERLAY_BBOX = fate-filter-overlay_bbox_gbrp_gbrap fate-filter-overlay_bbox_yuv420_yuva420
+fate-filter-overlay_bbox_gbrp_gbrap:    CMD = framecrc -lavfi "sws_flags=+accurate_rnd+bitexact;testsrc2=s=128x96:r=5:d=1,format=gbrp[main];color=red:s=40x30:r=5:d=1,format=rgba,pad=72:64:16:18:color=black@0,format=gbrap[over];[main][over]overlay=x=t*20:y=9:format=gbrp" -pix_fmt gbrp
+fate-filter-overlay_bbox_yuv420_yuva420: CMD = framecrc -lavfi "sws_flags=+accurate_rnd+bitexact;testsrc2=s=128x96:r=5:d=1[main];color=red:s=40x30:r=5:d=1,format=yuva420p,pad=72:64:16:18:color=black@0[over];[main][over]overlay=x=t*20:y=9:format=yuv420" -pix_fmt yuv420p
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER COLOR_FILTER FORMAT_FILTER PAD_FILTER SCALE_FILTER OVERLAY_FILTER) += $(FATE_FILTER_OVERLAY_BBOX)
+
 FATE_FILTER_VSYNTH-$(CONFIG_PHASE_FILTER) += fate-filter-phase
 fate-filter-phase: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf phase
 
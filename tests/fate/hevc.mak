@@ -223,6 +223,50 @@ $(foreach N,$(HEVC_SAMPLES_422_10BIN),$(eval $(call FATE_HEVC_TEST_422_10BIN,$(N
 $(foreach N,$(HEVC_SAMPLES_444_8BIT),$(eval $(call FATE_HEVC_TEST_444_8BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_444_12BIT),$(eval $(call FATE_HEVC_TEST_444_12BIT,$(N))))
 
+# decode the slice and WPP samples with frame and slice threading combined,
+# the output must be the same as for the other thread configurations;
+# run fate-hevc-frame-slice in a --toolchain=gcc-tsan build to check for races
+HEVC_SAMPLES_FRAME_SLICE =      \
+    DSLICE_A_HHI_5              \
+    DSLICE_B_HHI_5              \
+    DSLICE_C_HHI_5              \
+    ENTP_A_Qualcomm_1           \
+    ENTP_B_Qualcomm_1           \
+    ENTP_C_Qualcomm_1           \
+    WPP_A_ericsson_MAIN_2       \
+    WPP_B_ericsson_MAIN_2       \
+    WPP_C_ericsson_MAIN_2       \
+    WPP_D_ericsson_MAIN_2       \
+    WPP_E_ericsson_MAIN_2       \
+    WPP_F_ericsson_MAIN_2       \
+
+HEVC_SAMPLES_FRAME_SLICE_10BIT = \
+    WPP_A_ericsson_MAIN10_2     \
+    WPP_B_ericsson_MAIN10_2     \
+    WPP_C_ericsson_MAIN10_2     \
+    WPP_D_ericsson_MAIN10_2     \
+    WPP_E_ericsson_MAIN10_2     \
+    WPP_F_ericsson_MAIN10_2     \
+
+HEVC_FRAME_SLICE_THREADS = 2 3 4
+
+define FATE_HEVC_FRAME_SLICE_TEST
+FATE_HEVC_FRAME_SLICE += fate-hevc-conformance-$(1)-frame-slice-$(2)
+fate-hevc-conformance-$(1)-frame-slice-$(2): CMD = threads=$(2) thread_type=frame+slice framecrc -flags unaligned -slice_threads $(2) -vsync drop -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p
+fate-hevc-conformance-$(1)-frame-slice-$(2): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
+define FATE_HEVC_FRAME_SLICE_TEST_10BIT
+FATE_HEVC_FRAME_SLICE += fate-hevc-conformance-$(1)-frame-slice-$(2)
+fate-hevc-conformance-$(1)-frame-slice-$(2): CMD = threads=$(2) thread_type=frame+slice framecrc -flags unaligned -slice_threads $(2) -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p10le
+fate-hevc-conformance-$(1)-frame-slice-$(2): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
+$(foreach T,$(HEVC_FRAME_SLICE_THREADS),$(foreach N,$(HEVC_SAMPLES_FRAME_SLICE),$(eval $(call FATE_HEVC_FRAME_SLICE_TEST,$(N),$(T)))))
+$(foreach T,$(HEVC_FRAME_SLICE_THREADS),$(foreach N,$(HEVC_SAMPLES_FRAME_SLICE_10BIT),$(eval $(call FATE_HEVC_FRAME_SLICE_TEST_10BIT,$(N),$(T)))))
+
+FATE_HEVC += $(FATE_HEVC_FRAME_SLICE)
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -vsync 0 -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC += fate-hevc-paramchange-yuv420p-yuv420p10
 
@@ -263,3 +307,4 @@ FATE_SAMPLES_AVCONV += $(FATE_HEVC-yes)
 FATE_SAMPLES_FFPROBE += $(FATE_HEVC_FFPROBE-yes)
 
 fate-hevc: $(FATE_HEVC-yes) $(FATE_HEVC_FFPROBE-yes)
+fate-hevc-frame-slice: $(filter $(FATE_HEVC_FRAME_SLICE),$(FATE_HEVC-yes))
@@ -85,6 +85,20 @@ FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FIL
 fate-hls-list-size: tests/data/hls_list_size.m3u8
 fate-hls-list-size: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_list_size.m3u8 -vf setpts=N*23
 
+tests/data/hls_part_time.m3u8: TAG = GEN
+tests/data/hls_part_time.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+	-f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=10" -f hls -hls_time 3 -hls_part_time 1 -map 0 \
+	-hls_list_size 0 -codec:a mp2fixed -hls_segment_filename $(TARGET_PATH)/tests/data/hls_part_time_%d.ts \
+	$(TARGET_PATH)/tests/data/hls_part_time.m3u8 2>/dev/null
+
+FATE_AFILTER-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-part-time
+fate-hls-part-time: tests/data/hls_part_time.m3u8
+fate-hls-part-time: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_part_time.m3u8 -vf setpts=N*23
+
+FATE_AFILTER-$(call ALLYES, HLS_MUXER MPEGTS_MUXER MPEGTS_DEMUXER CONCAT_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-part-playlist
+fate-hls-part-playlist: CMD = hls_part_playlist
+
 tests/data/hls_segment_type_fmp4.m3u8: TAG = GEN
 tests/data/hls_segment_type_fmp4.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
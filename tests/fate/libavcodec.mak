@@ -97,5 +97,10 @@ FATE_LIBAVCODEC-yes += fate-libavcodec-htmlsubtitles
 fate-libavcodec-htmlsubtitles: libavcodec/tests/htmlsubtitles$(EXESUF)
 fate-libavcodec-htmlsubtitles: CMD = run libavcodec/tests/htmlsubtitles$(EXESUF)
 
+FATE_THREAD_LOW_DELAY-$(call ALLYES, MPEG4_ENCODER MPEG4_DECODER) += fate-thread-low-delay
+FATE_LIBAVCODEC-$(HAVE_THREADS) += $(FATE_THREAD_LOW_DELAY-yes)
+fate-thread-low-delay: libavcodec/tests/thread_low_delay$(EXESUF)
+fate-thread-low-delay: CMD = run libavcodec/tests/thread_low_delay$(EXESUF)
+
 FATE-$(CONFIG_AVCODEC) += $(FATE_LIBAVCODEC-yes)
 fate-libavcodec: $(FATE_LIBAVCODEC-yes)
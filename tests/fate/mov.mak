@@ -36,7 +36,14 @@ FATE_SAMPLES_AVCONV += $(FATE_MOV)
 FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE)
 FATE_SAMPLES_FASTSTART += $(FATE_MOV_FASTSTART)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART)
+# Open a file twice with the index cache, the second time from the cache.
+FATE_MOV_FFMPEG-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER \
+                               PCM_S16LE_ENCODER MOV_MUXER MOV_DEMUXER FRAMECRC_MUXER) += fate-mov-index-cache
+fate-mov-index-cache: CMD = mov_index_cache
+
+FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
+
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_FFMPEG-yes)
 
 # Make sure we handle edit lists correctly in normal cases.
 fate-mov-1elist-noctts: CMD = framemd5 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
@@ -0,0 +1,65 @@
+# Timing tests. Each test is run FATE_PERF_RUNS times and its lowest CPU
+# time is compared against the baseline recorded for this machine, failing
+# when it is more than FATE_PERF_THRESHOLD percent slower.
+# "make fate-perf-baseline" records a new baseline.
+
+FATE_PERF_BASELINE  = tests/perf/$(shell uname -n)
+FATE_PERF_THRESHOLD = 10
+FATE_PERF_RUNS      = 5
+
+PERF_VSYNTH = -f rawvideo -s 352x288 -pix_fmt yuv420p -stream_loop 9 -i $(TARGET_PATH)/tests/data/vsynth1.yuv
+PERF_ASYNTH = -stream_loop 19 -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+
+tests/data/perf-mpeg4.avi: TAG = GEN
+tests/data/perf-mpeg4.avi: ffmpeg$(PROGSSUF)$(EXESUF) tests/data/vsynth1.yuv | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin -nostats $(PERF_VSYNTH) \
+        -c:v mpeg4 -qscale:v 3 -flags +bitexact -fflags +bitexact \
+        -y $(TARGET_PATH)/$@ 2>/dev/null
+
+PERF_VSYNTH_DEPS = RAWVIDEO_DEMUXER RAWVIDEO_DECODER NULL_MUXER
+PERF_ASYNTH_DEPS = WAV_DEMUXER PCM_S16LE_DECODER NULL_MUXER
+
+FATE_PERF_VSYNTH-$(call ALLYES, $(PERF_VSYNTH_DEPS) MPEG4_ENCODER) += fate-perf-mpeg4-enc
+fate-perf-mpeg4-enc: CMD = perf $(PERF_VSYNTH) -c:v mpeg4 -qscale:v 3
+
+FATE_PERF_VSYNTH-$(call ALLYES, $(PERF_VSYNTH_DEPS) FFV1_ENCODER) += fate-perf-ffv1-enc
+fate-perf-ffv1-enc: CMD = perf $(PERF_VSYNTH) -c:v ffv1
+
+FATE_PERF_VSYNTH-$(call ALLYES, $(PERF_VSYNTH_DEPS) SCALE_FILTER RAWVIDEO_ENCODER) += fate-perf-scale
+fate-perf-scale: CMD = perf $(PERF_VSYNTH) -vf scale=1280:720:flags=bicubic -c:v rawvideo
+
+FATE_PERF_VSYNTH-$(call ALLYES, $(PERF_VSYNTH_DEPS) YADIF_FILTER RAWVIDEO_ENCODER) += fate-perf-yadif
+fate-perf-yadif: CMD = perf $(PERF_VSYNTH) -vf yadif -c:v rawvideo
+
+$(FATE_PERF_VSYNTH-yes): tests/data/vsynth1.yuv
+
+FATE_PERF-$(call ALLYES, $(PERF_VSYNTH_DEPS) MPEG4_ENCODER AVI_MUXER AVI_DEMUXER MPEG4_DECODER RAWVIDEO_ENCODER) += fate-perf-mpeg4-dec
+fate-perf-mpeg4-dec: tests/data/perf-mpeg4.avi
+fate-perf-mpeg4-dec: CMD = perf -i $(TARGET_PATH)/tests/data/perf-mpeg4.avi -c:v rawvideo
+
+FATE_PERF_ASYNTH-$(call ALLYES, $(PERF_ASYNTH_DEPS) AAC_ENCODER) += fate-perf-aac-enc
+fate-perf-aac-enc: CMD = perf $(PERF_ASYNTH) -c:a aac -b:a 128k
+
+FATE_PERF_ASYNTH-$(call ALLYES, $(PERF_ASYNTH_DEPS) ARESAMPLE_FILTER PCM_S16LE_ENCODER) += fate-perf-aresample
+fate-perf-aresample: CMD = perf $(PERF_ASYNTH) -af aresample=48000 -c:a pcm_s16le
+
+$(FATE_PERF_ASYNTH-yes): tests/data/asynth-44100-2.wav
+
+FATE_PERF_SAMPLES-$(call ALLYES, H264_DEMUXER H264_DECODER RAWVIDEO_ENCODER NULL_MUXER) += fate-perf-h264-dec
+fate-perf-h264-dec: CMD = perf -stream_loop 49 -i $(TARGET_SAMPLES)/h264-conformance/FRext/HPCV_BRCM_A.264 -c:v rawvideo
+
+FATE_PERF_SAMPLES-$(call ALLYES, HEVC_DEMUXER HEVC_DECODER RAWVIDEO_ENCODER NULL_MUXER) += fate-perf-hevc-dec
+fate-perf-hevc-dec: CMD = perf -stream_loop 49 -i $(TARGET_SAMPLES)/hevc-conformance/RAP_A_docomo_4.bit -c:v rawvideo
+
+FATE_PERF += $(FATE_PERF-yes) $(FATE_PERF_VSYNTH-yes) $(FATE_PERF_ASYNTH-yes)
+ifdef SAMPLES
+FATE_PERF += $(FATE_PERF_SAMPLES-yes)
+endif
+
+$(FATE_PERF): ffmpeg$(PROGSSUF)$(EXESUF)
+$(FATE_PERF): CMP = null
+$(FATE_PERF): export PERF_BASELINE = $(FATE_PERF_BASELINE)
+$(FATE_PERF): export PERF_THRESHOLD = $(FATE_PERF_THRESHOLD)
+$(FATE_PERF): export PERF_RUNS = $(FATE_PERF_RUNS)
+
+fate-perf-baseline: export PERF_UPDATE = 1
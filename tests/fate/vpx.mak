@@ -159,6 +159,17 @@ $(eval $(call FATE_VP9_SUITE,trac4359))
 endef
 
 $(eval $(call FATE_VP9_FULL))
+
+# slice threading with more threads than tile columns, so that the spare
+# threads run loop filter jobs next to the tile jobs
+define FATE_VP9_SLICE_SUITE
+FATE_VP9-$(CONFIG_MATROSKA_DEMUXER) += fate-vp9-slice$(2)-$(1)
+fate-vp9-slice$(2)-$(1): CMD = threads=$(2) thread_type=slice framemd5 -i $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-$(1).webm
+fate-vp9-slice$(2)-$(1): REF = $(SRC_PATH)/tests/ref/fate/vp9-$(1)
+endef
+
+$(foreach T,2 4 8,$(eval $(call FATE_VP9_SLICE_SUITE,tiling-pedestrian,$(T))))
+$(foreach T,2 4,$(eval $(call FATE_VP9_SLICE_SUITE,parallelmode-akiyo,$(T))))
 FATE_VP9-$(CONFIG_IVF_DEMUXER) += fate-vp9-05-resize
 fate-vp9-05-resize: CMD = framemd5 -i $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-05-resize.ivf -s 352x288 -sws_flags bitexact+bilinear
 fate-vp9-05-resize: REF = $(SRC_PATH)/tests/ref/fate/vp9-05-resize
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+#
+# Encode the video of a file in parallel by splitting it at keyframes.
+#
+# usage: chunkenc.py [-n chunks] [-j jobs] [-a audio_options]
+#                    [--ffmpeg path] [--ffprobe path] <input> <output> [video_options]
+#
+# The keyframes of the first video stream are found by reading the packets
+# with ffprobe, without decoding. The file is cut at the keyframes closest
+# to equal parts, and every part is decoded, filtered and encoded by its own
+# ffmpeg process with the given video options. Every part starts with a new
+# GOP, so the parts can be joined without reencoding. They are joined with
+# the concat demuxer, and the audio of the input is muxed in with the audio
+# options, by default copied.
+#
+# Example:
+#   chunkenc.py -n 32 -a "-c:a aac -b:a 128k" in.mkv out.mp4 -c:v libx264 -crf 20
+
+import argparse, os, shlex, shutil, subprocess, sys, tempfile, time
+from fractions import Fraction
+
+def probe(ffprobe, args, input):
+    cmd = [ffprobe, '-v', 'error'] + args + [input]
+    return subprocess.check_output(cmd, universal_newlines=True)
+
+def keyframe_times(ffprobe, input):
+    out = probe(ffprobe, ['-select_streams', 'v:0', '-show_entries', 'stream=time_base',
+                          '-of', 'csv=p=0'], input)
+    tb = Fraction(out.split()[0])
+    out = probe(ffprobe, ['-select_streams', 'v:0', '-show_entries', 'packet=pts,flags',
+                          '-of', 'csv=p=0'], input)
+    times = []
+    for line in out.splitlines():
+        pts, flags = line.split(',')[:2]
+        if 'K' in flags and pts != 'N/A':
+            times.append(int(pts) * tb)
+    return sorted(set(times))
+
+def split_points(ffprobe, input, chunks):
+    out = probe(ffprobe, ['-show_entries', 'format=start_time,duration', '-of',
+                          'default=nw=1'], input)
+    fmt = dict(l.split('=', 1) for l in out.splitlines() if '=' in l)
+    start = Fraction(fmt.get('start_time', '0').replace('N/A', '0'))
+    duration = Fraction(fmt['duration'])
+    # -ss is relative to the start of the file; round down to microseconds
+    # so that the keyframe itself is never cut off
+    keys = [Fraction(int((t - start) * 1000000), 1000000)
+            for t in keyframe_times(ffprobe, input)]
+    keys = [t for t in keys if 0 < t < duration]
+    points = set()
+    for i in range(1, chunks):
+        target = duration * i / chunks
+        if keys:
+            points.add(min(keys, key=lambda t: abs(t - target)))
+    return [Fraction(0)] + sorted(points) + [None]
+
+def timestr(t):
+    us = int(t * 1000000)
+    return '%d.%06d' % (us // 1000000, us % 1000000)
+
+# Run the commands, at most jobs at a time. Once one fails, the others are
+# stopped, and every child has exited when this returns, also on exceptions
+# such as KeyboardInterrupt.
+def run_jobs(cmds, jobs):
+    running, ok = [], True
+    try:
+        while ok and (cmds or running):
+            while cmds and len(running) < jobs:
+                running.append(subprocess.Popen(cmds.pop(0)))
+            time.sleep(0.1)
+            for proc in [p for p in running if p.poll() is not None]:
+                running.remove(proc)
+                ok = ok and proc.returncode == 0
+    finally:
+        for proc in running:
+            proc.terminate()
+        for proc in running:
+            proc.wait()
+    return ok
+
+def main():
+    parser = argparse.ArgumentParser(description='Encode the video of a file in parallel chunks.')
+    parser.add_argument('-n', dest='chunks', type=int, default=os.cpu_count() or 1,
+                        help='number of chunks (default: number of CPUs)')
+    parser.add_argument('-j', dest='jobs', type=int, default=os.cpu_count() or 1,
+                        help='number of parallel encodes (default: number of CPUs)')
+    parser.add_argument('-a', dest='audio', default='-c:a copy',
+                        help='audio options for the final mux (default: "-c:a copy")')
+    parser.add_argument('--ffmpeg', default='ffmpeg',
+                        help='ffmpeg executable (default: "ffmpeg")')
+    parser.add_argument('--ffprobe', default='ffprobe',
+                        help='ffprobe executable (default: "ffprobe")')
+    parser.add_argument('input')
+    parser.add_argument('output')
+    parser.add_argument('video', nargs=argparse.REMAINDER,
+                        help='ffmpeg options for encoding the video')
+    args = parser.parse_args()
+
+    points = split_points(args.ffprobe, args.input, max(args.chunks, 1))
+    tmpdir = tempfile.mkdtemp(prefix='chunkenc')
+    try:
+        cmds, parts = [], []
+        for i in range(len(points) - 1):
+            part = os.path.join(tmpdir, 'part%05d.mkv' % i)
+            cmd = [args.ffmpeg, '-nostdin', '-v', 'error', '-ss', timestr(points[i])]
+            if points[i + 1] is not None:
+                cmd += ['-t', timestr(points[i + 1] - points[i])]
+            cmd += ['-i', args.input, '-map', '0:v:0', '-an', '-sn', '-dn']
+            cmds.append(cmd + args.video + [part])
+            parts.append(part)
+
+        if not run_jobs(cmds, max(args.jobs, 1)):
+            sys.exit('encoding a chunk failed')
+
+        concat = os.path.join(tmpdir, 'concat.txt')
+        with open(concat, 'w') as f:
+            for part in parts:
+                f.write("file '%s'\n" % part.replace("'", "'\\''"))
+
+        cmd = [args.ffmpeg, '-nostdin', '-y', '-v', 'error',
+               '-f', 'concat', '-safe', '0', '-i', concat, '-i', args.input,
+               '-map', '0:v', '-map', '1:a?', '-c:v', 'copy']
+        cmd += shlex.split(args.audio) + [args.output]
+        sys.exit(subprocess.call(cmd))
+    finally:
+        shutil.rmtree(tmpdir, ignore_errors=True)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,759 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decoder and encoder throughput benchmark.
+ *
+ * The packets of each input are read into memory first, then decoded once
+ * per configuration of the matrix given on the command line; the frames of
+ * the first input are kept and encoded with each requested encoder in the
+ * same way. One JSON object is printed per configuration.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
+#include "libavutil/hwcontext.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libswscale/swscale.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define MAX_LIST 16
+
+typedef struct List {
+    const char *val[MAX_LIST];
+    int nb;
+} List;
+
+typedef struct Input {
+    const char *filename;
+    AVCodecParameters *par;
+    AVRational time_base;
+    AVRational frame_rate;
+    AVPacket **pkts;
+    int nb_pkts;
+} Input;
+
+typedef struct Config {
+    int threads;
+    const char *thread_type;
+    const char *cpuflags;
+    const char *hwaccel;
+} Config;
+
+typedef struct Result {
+    int64_t frames;
+    int64_t bytes;
+    int64_t real_usec;
+    int64_t cpu_usec;
+} Result;
+
+static List thread_counts, thread_types, cpuflags, hwaccels, encoders;
+static int max_frames;
+static int nb_runs = 1;
+static int no_decode;
+
+static int64_t cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return rusage.ru_utime.tv_sec * 1000000LL + rusage.ru_utime.tv_usec +
+           rusage.ru_stime.tv_sec * 1000000LL + rusage.ru_stime.tv_usec;
+#else
+    return av_gettime_relative();
+#endif
+}
+
+static int64_t peak_rss_kb(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return rusage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+static void list_add(List *l, const char *val)
+{
+    if (l->nb == MAX_LIST) {
+        fprintf(stderr, "At most %d values are supported per option\n",
+                MAX_LIST);
+        exit(1);
+    }
+    l->val[l->nb++] = val;
+}
+
+/* split a comma-separated argument into the list */
+static void list_split(List *l, char *arg)
+{
+    char *saveptr = NULL, *tok;
+
+    for (tok = av_strtok(arg, ",", &saveptr); tok;
+         tok = av_strtok(NULL, ",", &saveptr))
+        list_add(l, tok);
+}
+
+static void print_string(const char *key, const char *s)
+{
+    printf("\"%s\":\"", key);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            printf("\\u%04x", *s);
+        else
+            putchar(*s);
+    }
+    printf("\",");
+}
+
+static int set_cpuflags(const char *s)
+{
+    unsigned flags;
+    int ret;
+
+    av_force_cpu_flags(-1);
+    if (!strcmp(s, "auto"))
+        return 0;
+
+    flags = av_get_cpu_flags();
+    ret = av_parse_cpu_caps(&flags, s);
+    if (ret < 0) {
+        fprintf(stderr, "Invalid CPU flags '%s'\n", s);
+        return ret;
+    }
+    av_force_cpu_flags(flags);
+    return 0;
+}
+
+static int setup_threads(AVCodecContext *avctx, const Config *cfg)
+{
+    avctx->thread_count = cfg->threads;
+    if (!strcmp(cfg->thread_type, "frame")) {
+        avctx->thread_type = FF_THREAD_FRAME;
+    } else if (!strcmp(cfg->thread_type, "slice")) {
+        avctx->thread_type = FF_THREAD_SLICE;
+    } else {
+        fprintf(stderr, "Unknown thread type '%s'\n", cfg->thread_type);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static enum AVPixelFormat get_hw_format(AVCodecContext *avctx,
+                                        const enum AVPixelFormat *fmts)
+{
+    enum AVPixelFormat hw_fmt = (intptr_t)avctx->opaque;
+    const enum AVPixelFormat *p;
+
+    for (p = fmts; *p != AV_PIX_FMT_NONE; p++)
+        if (*p == hw_fmt)
+            return *p;
+
+    av_log(avctx, AV_LOG_WARNING, "The hwaccel cannot decode this stream, "
+           "falling back to software decoding\n");
+    return avcodec_default_get_format(avctx, fmts);
+}
+
+static int setup_hwaccel(AVCodecContext *avctx, const AVCodec *codec,
+                         const char *name)
+{
+    enum AVHWDeviceType type = av_hwdevice_find_type_by_name(name);
+    const AVCodecHWConfig *config;
+    int i, ret;
+
+    if (type == AV_HWDEVICE_TYPE_NONE) {
+        fprintf(stderr, "Unknown hwaccel '%s'\n", name);
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; (config = avcodec_get_hw_config(codec, i)); i++)
+        if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX &&
+            config->device_type == type)
+            break;
+    if (!config) {
+        fprintf(stderr, "Decoder %s does not support the %s hwaccel\n",
+                codec->name, name);
+        return AVERROR(ENOSYS);
+    }
+
+    ret = av_hwdevice_ctx_create(&avctx->hw_device_ctx, type, NULL, NULL, 0);
+    if (ret < 0) {
+        fprintf(stderr, "Could not create a %s device: %s\n",
+                name, av_err2str(ret));
+        return ret;
+    }
+    avctx->opaque     = (void *)(intptr_t)config->pix_fmt;
+    avctx->get_format = get_hw_format;
+    return 0;
+}
+
+static int load_input(Input *in, const char *filename)
+{
+    AVFormatContext *fmt = NULL;
+    AVPacket pkt;
+    AVStream *st;
+    int idx, ret;
+
+    in->filename = filename;
+
+    ret = avformat_open_input(&fmt, filename, NULL, NULL);
+    if (ret < 0)
+        goto fail;
+    ret = avformat_find_stream_info(fmt, NULL);
+    if (ret < 0)
+        goto fail;
+
+    idx = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (idx < 0)
+        idx = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+    if (idx < 0) {
+        ret = idx;
+        goto fail;
+    }
+    st = fmt->streams[idx];
+
+    in->par = avcodec_parameters_alloc();
+    if (!in->par) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ret = avcodec_parameters_copy(in->par, st->codecpar);
+    if (ret < 0)
+        goto fail;
+    in->time_base  = st->time_base;
+    in->frame_rate = av_guess_frame_rate(fmt, st, NULL);
+
+    while (!max_frames || in->nb_pkts < max_frames) {
+        ret = av_read_frame(fmt, &pkt);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            goto fail;
+        if (pkt.stream_index == idx) {
+            AVPacket *clone = av_packet_clone(&pkt);
+
+            ret = clone ? av_dynarray_add_nofree(&in->pkts, &in->nb_pkts, clone)
+                        : AVERROR(ENOMEM);
+            if (ret < 0)
+                av_packet_free(&clone);
+        }
+        av_packet_unref(&pkt);
+        if (ret < 0)
+            goto fail;
+    }
+    ret = 0;
+
+fail:
+    avformat_close_input(&fmt);
+    if (ret < 0)
+        fprintf(stderr, "Could not load '%s': %s\n", filename, av_err2str(ret));
+    return ret;
+}
+
+static void free_input(Input *in)
+{
+    int i;
+
+    for (i = 0; i < in->nb_pkts; i++)
+        av_packet_free(&in->pkts[i]);
+    av_freep(&in->pkts);
+    in->nb_pkts = 0;
+    avcodec_parameters_free(&in->par);
+}
+
+static int add_frame(AVFrame ***frames, int *nb_frames, const AVFrame *frame)
+{
+    AVFrame *clone = av_frame_clone(frame);
+    int ret;
+
+    if (!clone)
+        return AVERROR(ENOMEM);
+    ret = av_dynarray_add_nofree(frames, nb_frames, clone);
+    if (ret < 0)
+        av_frame_free(&clone);
+    return ret;
+}
+
+static int decode_packet(AVCodecContext *avctx, const AVPacket *pkt,
+                         AVFrame *frame, Result *res,
+                         AVFrame ***frames, int *nb_frames)
+{
+    int ret = avcodec_send_packet(avctx, pkt);
+
+    if (ret < 0 && ret != AVERROR_INVALIDDATA)
+        return ret;
+
+    while ((ret = avcodec_receive_frame(avctx, frame)) >= 0) {
+        res->frames++;
+        if (frames)
+            ret = add_frame(frames, nb_frames, frame);
+        av_frame_unref(frame);
+        if (ret < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/* decode all packets of in; the decoded frames are returned if frames is set */
+static int run_decode(const Input *in, const Config *cfg, Result *res,
+                      AVFrame ***frames, int *nb_frames)
+{
+    const AVCodec *codec = avcodec_find_decoder(in->par->codec_id);
+    AVCodecContext *avctx = NULL;
+    AVFrame *frame = NULL;
+    int64_t real, cpu;
+    int i, ret;
+
+    memset(res, 0, sizeof(*res));
+
+    if (!codec) {
+        fprintf(stderr, "No decoder for '%s'\n", in->filename);
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+
+    avctx = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!avctx || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_to_context(avctx, in->par);
+    if (ret < 0)
+        goto end;
+    avctx->pkt_timebase = in->time_base;
+    ret = setup_threads(avctx, cfg);
+    if (ret < 0)
+        goto end;
+    if (cfg->hwaccel) {
+        ret = setup_hwaccel(avctx, codec, cfg->hwaccel);
+        if (ret < 0)
+            goto end;
+    }
+
+    real = av_gettime_relative();
+    cpu  = cpu_time();
+
+    ret = avcodec_open2(avctx, codec, NULL);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i <= in->nb_pkts; i++) {
+        ret = decode_packet(avctx, i < in->nb_pkts ? in->pkts[i] : NULL,
+                            frame, res, frames, nb_frames);
+        if (ret < 0)
+            goto end;
+        res->bytes += i < in->nb_pkts ? in->pkts[i]->size : 0;
+    }
+
+    res->real_usec = av_gettime_relative() - real;
+    res->cpu_usec  = cpu_time() - cpu;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Decoding '%s' failed: %s\n",
+                in->filename, av_err2str(ret));
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+static int receive_packets(AVCodecContext *avctx, AVPacket *pkt, Result *res)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_packet(avctx, pkt)) >= 0) {
+        res->frames++;
+        res->bytes += pkt->size;
+        av_packet_unref(pkt);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int run_encode(AVFrame **frames, int nb_frames, const Input *in,
+                      const AVCodec *codec, const Config *cfg, Result *res)
+{
+    AVRational frame_rate = in->frame_rate.num ? in->frame_rate
+                                               : (AVRational){ 25, 1 };
+    AVCodecContext *avctx = NULL;
+    AVPacket *pkt = NULL;
+    int64_t real, cpu;
+    int i, ret;
+
+    memset(res, 0, sizeof(*res));
+
+    avctx = avcodec_alloc_context3(codec);
+    pkt   = av_packet_alloc();
+    if (!avctx || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->width               = frames[0]->width;
+    avctx->height              = frames[0]->height;
+    avctx->pix_fmt             = frames[0]->format;
+    avctx->sample_aspect_ratio = frames[0]->sample_aspect_ratio;
+    avctx->framerate           = frame_rate;
+    avctx->time_base           = av_inv_q(frame_rate);
+    ret = setup_threads(avctx, cfg);
+    if (ret < 0)
+        goto end;
+
+    real = av_gettime_relative();
+    cpu  = cpu_time();
+
+    ret = avcodec_open2(avctx, codec, NULL);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i <= nb_frames; i++) {
+        if (i < nb_frames)
+            frames[i]->pts = i;
+        ret = avcodec_send_frame(avctx, i < nb_frames ? frames[i] : NULL);
+        if (ret < 0)
+            goto end;
+        ret = receive_packets(avctx, pkt, res);
+        if (ret < 0)
+            goto end;
+    }
+
+    res->real_usec = av_gettime_relative() - real;
+    res->cpu_usec  = cpu_time() - cpu;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Encoding with %s failed: %s\n",
+                codec->name, av_err2str(ret));
+    av_packet_free(&pkt);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+/* convert the source frames to the first format the encoder supports */
+static int convert_frames(AVFrame **src, int nb_frames, const AVCodec *codec,
+                          AVFrame ***dst)
+{
+    enum AVPixelFormat fmt = src[0]->format;
+    struct SwsContext *sws;
+    int i, ret = 0;
+
+    if (codec->type != AVMEDIA_TYPE_VIDEO) {
+        fprintf(stderr, "Only video encoders are supported\n");
+        return AVERROR(ENOSYS);
+    }
+
+    if (codec->pix_fmts) {
+        const enum AVPixelFormat *p;
+        for (p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++)
+            if (*p == fmt)
+                break;
+        if (*p == AV_PIX_FMT_NONE)
+            fmt = codec->pix_fmts[0];
+    }
+
+    *dst = av_mallocz_array(nb_frames, sizeof(**dst));
+    if (!*dst)
+        return AVERROR(ENOMEM);
+
+    if (fmt == src[0]->format) {
+        for (i = 0; i < nb_frames; i++)
+            if (!((*dst)[i] = av_frame_clone(src[i])))
+                return AVERROR(ENOMEM);
+        return 0;
+    }
+
+    sws = sws_getContext(src[0]->width, src[0]->height, src[0]->format,
+                         src[0]->width, src[0]->height, fmt,
+                         SWS_BICUBIC, NULL, NULL, NULL);
+    if (!sws)
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < nb_frames; i++) {
+        AVFrame *frame = (*dst)[i] = av_frame_alloc();
+        if (!frame) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        frame->format = fmt;
+        frame->width  = src[i]->width;
+        frame->height = src[i]->height;
+        frame->sample_aspect_ratio = src[i]->sample_aspect_ratio;
+        ret = av_frame_get_buffer(frame, 0);
+        if (ret < 0)
+            break;
+        sws_scale(sws, (const uint8_t * const *)src[i]->data, src[i]->linesize,
+                  0, src[i]->height, frame->data, frame->linesize);
+    }
+
+    sws_freeContext(sws);
+    return ret;
+}
+
+static void free_frames(AVFrame ***frames, int *nb_frames)
+{
+    int i;
+
+    if (!*frames)
+        return;
+    for (i = 0; i < *nb_frames; i++)
+        av_frame_free(&(*frames)[i]);
+    av_freep(frames);
+    *nb_frames = 0;
+}
+
+static void print_result(const char *mode, const char *input,
+                         const char *codec, const Config *cfg,
+                         const Result *res, double efficiency)
+{
+    double real = res->real_usec / 1000000.0;
+    double cpu  = res->cpu_usec  / 1000000.0;
+
+    printf("{");
+    print_string("mode",        mode);
+    print_string("input",       input);
+    print_string("codec",       codec);
+    printf("\"threads\":%d,", cfg->threads);
+    print_string("thread_type", cfg->thread_type);
+    print_string("cpuflags",    cfg->cpuflags);
+    print_string("hwaccel",     cfg->hwaccel ? cfg->hwaccel : "none");
+    printf("\"frames\":%"PRId64",\"bytes\":%"PRId64",\"real_s\":%.6f,"
+           "\"cpu_s\":%.6f,\"fps\":%.3f,\"cpu_util\":%.3f,"
+           "\"peak_rss_kb\":%"PRId64",\"efficiency\":%.3f}\n",
+           res->frames, res->bytes, real, cpu,
+           real > 0 ? res->frames / real : 0.0,
+           real > 0 ? cpu / real : 0.0,
+           peak_rss_kb(), efficiency);
+    fflush(stdout);
+}
+
+static int effective_threads(int threads)
+{
+    return threads > 0 ? threads : av_cpu_count();
+}
+
+/*
+ * Run one cell of the matrix nb_runs times and keep the fastest run. The
+ * efficiency is relative to the first thread count given for the same
+ * thread type, CPU flags and hwaccel: 1.0 means that the throughput grew
+ * linearly with the number of threads.
+ */
+static int run_config(const Input *in, const AVCodec *enc, AVFrame **frames,
+                      int nb_frames, const Config *cfg, double *base_fps,
+                      int *base_threads)
+{
+    Result res, best = { 0 };
+    double fps, efficiency = 1.0;
+    int i, ret;
+
+    for (i = 0; i < nb_runs; i++) {
+        ret = enc ? run_encode(frames, nb_frames, in, enc, cfg, &res)
+                  : run_decode(in, cfg, &res, NULL, NULL);
+        if (ret < 0)
+            return ret;
+        if (!i || res.real_usec < best.real_usec)
+            best = res;
+    }
+
+    fps = best.real_usec ? best.frames * 1000000.0 / best.real_usec : 0;
+    if (!*base_threads) {
+        *base_fps     = fps;
+        *base_threads = effective_threads(cfg->threads);
+    } else if (*base_fps > 0) {
+        efficiency = fps / *base_fps * *base_threads /
+                     effective_threads(cfg->threads);
+    }
+
+    print_result(enc ? "encode" : "decode", in->filename,
+                 enc ? enc->name : avcodec_get_name(in->par->codec_id),
+                 cfg, &best, efficiency);
+    return 0;
+}
+
+static int run_matrix(const Input *in, const AVCodec *enc,
+                      AVFrame **frames, int nb_frames)
+{
+    int h, c, t, n, ret;
+
+    for (h = 0; h < hwaccels.nb; h++) {
+        const char *hwaccel = strcmp(hwaccels.val[h], "none") ? hwaccels.val[h]
+                                                              : NULL;
+        /* hwaccels only apply to decoding */
+        if (enc && hwaccel)
+            continue;
+
+        for (c = 0; c < cpuflags.nb; c++) {
+            ret = set_cpuflags(cpuflags.val[c]);
+            if (ret < 0)
+                return ret;
+
+            for (t = 0; t < thread_types.nb; t++) {
+                double base_fps  = 0;
+                int base_threads = 0;
+
+                for (n = 0; n < thread_counts.nb; n++) {
+                    Config cfg = {
+                        .threads     = atoi(thread_counts.val[n]),
+                        .thread_type = thread_types.val[t],
+                        .cpuflags    = cpuflags.val[c],
+                        .hwaccel     = hwaccel,
+                    };
+                    ret = run_config(in, enc, frames, nb_frames, &cfg,
+                                     &base_fps, &base_threads);
+                    if (ret < 0)
+                        return ret;
+                }
+            }
+        }
+    }
+    av_force_cpu_flags(-1);
+    return 0;
+}
+
+static int run_encoders(const Input *in)
+{
+    const Config cfg = { .thread_type = "frame", .cpuflags = "auto" };
+    AVFrame **src = NULL, **frames = NULL;
+    int nb_src = 0, nb_frames = 0;
+    Result res;
+    int i, ret;
+
+    ret = run_decode(in, &cfg, &res, &src, &nb_src);
+    if (ret >= 0 && !nb_src) {
+        fprintf(stderr, "No frames decoded from '%s'\n", in->filename);
+        ret = AVERROR_INVALIDDATA;
+    }
+
+    for (i = 0; ret >= 0 && i < encoders.nb; i++) {
+        const AVCodec *codec = avcodec_find_encoder_by_name(encoders.val[i]);
+
+        if (!codec) {
+            fprintf(stderr, "Unknown encoder '%s'\n", encoders.val[i]);
+            ret = AVERROR_ENCODER_NOT_FOUND;
+            break;
+        }
+        nb_frames = nb_src;
+        ret = convert_frames(src, nb_src, codec, &frames);
+        if (ret >= 0)
+            ret = run_matrix(in, codec, frames, nb_frames);
+        free_frames(&frames, &nb_frames);
+    }
+
+    free_frames(&src, &nb_src);
+    return ret;
+}
+
+static av_noreturn void usage(const char *name, int ret)
+{
+    fprintf(stderr,
+            "Usage: %s [options] input [input...]\n"
+            "Decode the best video (or audio) stream of each input and encode\n"
+            "the frames of the first one, for every combination of:\n"
+            "  -t counts   comma-separated thread counts, 0 is auto [1]\n"
+            "  -T types    comma-separated thread types, frame or slice [frame]\n"
+            "  -c flags    CPU flags as for ffmpeg -cpuflags, or auto; may be\n"
+            "              repeated [auto]\n"
+            "  -a hwaccels comma-separated hwaccel device types, or none [none]\n"
+            "Other options:\n"
+            "  -e encoders comma-separated video encoders to benchmark\n"
+            "  -D          skip the decoding benchmarks\n"
+            "  -n frames   use at most this many frames of each input\n"
+            "  -r runs     run each configuration this many times and report\n"
+            "              the fastest run [1]\n"
+            "One JSON object is printed per configuration. peak_rss_kb is the\n"
+            "peak of the whole process so far; run one configuration per\n"
+            "invocation to get the peak of a single configuration.\n",
+            name);
+    exit(ret);
+}
+
+int main(int argc, char **argv)
+{
+    Input *inputs;
+    int i, opt, nb_inputs, ret = 0;
+
+    while ((opt = getopt(argc, argv, "ht:T:c:a:e:Dn:r:")) != -1) {
+        switch (opt) {
+        case 't': list_split(&thread_counts, optarg); break;
+        case 'T': list_split(&thread_types,  optarg); break;
+        case 'c': list_add  (&cpuflags,      optarg); break;
+        case 'a': list_split(&hwaccels,      optarg); break;
+        case 'e': list_split(&encoders,      optarg); break;
+        case 'D': no_decode = 1;                      break;
+        case 'n': max_frames = strtol(optarg, NULL, 0); break;
+        case 'r': nb_runs = FFMAX(strtol(optarg, NULL, 0), 1); break;
+        case 'h': usage(argv[0], 0);
+        default:  usage(argv[0], 1);
+        }
+    }
+    if (optind >= argc)
+        usage(argv[0], 1);
+
+    if (!thread_counts.nb) list_add(&thread_counts, "1");
+    if (!thread_types.nb)  list_add(&thread_types,  "frame");
+    if (!cpuflags.nb)      list_add(&cpuflags,      "auto");
+    if (!hwaccels.nb)      list_add(&hwaccels,      "none");
+
+    nb_inputs = argc - optind;
+    inputs = av_mallocz_array(nb_inputs, sizeof(*inputs));
+    if (!inputs)
+        return 1;
+
+    for (i = 0; i < nb_inputs; i++) {
+        ret = load_input(&inputs[i], argv[optind + i]);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (i = 0; !no_decode && i < nb_inputs; i++) {
+        ret = run_matrix(&inputs[i], NULL, NULL, 0);
+        if (ret < 0)
+            goto end;
+    }
+
+    if (encoders.nb)
+        ret = run_encoders(&inputs[0]);
+
+end:
+    for (i = 0; i < nb_inputs; i++)
+        free_input(&inputs[i]);
+    av_free(inputs);
+    return ret < 0;
+}